@@ -0,0 +1,142 @@
+/*
+ *  SLAMTEC LIDAR
+ *  Batch Decoder of the Captures Recorded by the Driver
+ *
+ *  Decodes a capture of ILidarDriver::startRecording over several threads and writes
+ *  its revolutions into a scan log.
+ *
+ *  Copyright (c) 2009 - 2014 RoboPeak Team
+ *  http://www.robopeak.com
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  *
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sl_lidar.h"
+#include "sl_lidar_driver.h"
+#include "sl_lidar_scan_log.h"
+#include "sl_lidar_batch_decode.h"
+
+using namespace sl;
+
+void print_usage(int argc, const char* argv[])
+{
+    printf("RPLIDAR Capture Batch Decoder.\n"
+        "Version: %s \n"
+        "Usage:\n"
+        " %s <capture> <scan log> --us-per-sample=<us> [--threads=<count>] [--shard-mb=<size>] [--baudrate=<baudrate>]\n"
+        "    [--no-native-timestamps] [--delta]\n"
+        " Decodes the capture over several threads, one per processor by default, and writes its revolutions to the scan log.\n"
+        " The sample duration is the us_per_sample of the scan mode the capture was made in.\n"
+
+        , "SL_LIDAR_SDK_VERSION", argv[0]);
+}
+
+static sl_u64 sdk_now_us()
+{
+    LidarClockInfo info;
+    getLidarClockInfo(info);
+    return info.now_uS;
+}
+
+// appends each revolution to the scan log
+class ScanLogSink : public ILidarBatchScanSink
+{
+public:
+    ScanLogSink(ILidarScanLogWriter* writer)
+        : _writer(writer)
+    {
+    }
+
+    virtual sl_result onScan(const sl_lidar_response_measurement_node_hq_t* nodes, const sl_u64* timestamps_uS, size_t count, sl_u64 timestamp_uS)
+    {
+        return _writer->appendScan(nodes, count, timestamp_uS);
+    }
+
+private:
+    ILidarScanLogWriter* _writer;
+};
+
+int main(int argc, const char* argv[]) {
+    if (argc < 4) {
+        print_usage(argc, argv);
+        return -1;
+    }
+
+    const char* capturePath = argv[1];
+    const char* logPath = argv[2];
+    LidarBatchDecodeOptions options;
+    LidarScanLogEncoding encoding = LIDAR_SCAN_LOG_ENCODING_RAW;
+
+    for (int pos = 3; pos < argc; ++pos) {
+        if (strncmp(argv[pos], "--us-per-sample=", 16) == 0) {
+            options.timing.sample_duration_uS = (sl_u32)atof(argv[pos] + 16);
+        } else if (strncmp(argv[pos], "--threads=", 10) == 0) {
+            options.thread_count = atoi(argv[pos] + 10);
+        } else if (strncmp(argv[pos], "--shard-mb=", 11) == 0) {
+            options.shard_bytes = (size_t)(atof(argv[pos] + 11) * 1024 * 1024);
+        } else if (strncmp(argv[pos], "--baudrate=", 11) == 0) {
+            options.timing.native_baudrate = strtoul(argv[pos] + 11, NULL, 10);
+        } else if (strcmp(argv[pos], "--no-native-timestamps") == 0) {
+            options.timing.native_timestamp_support = false;
+        } else if (strcmp(argv[pos], "--delta") == 0) {
+            encoding = LIDAR_SCAN_LOG_ENCODING_DELTA;
+        } else {
+            print_usage(argc, argv);
+            return -1;
+        }
+    }
+
+    if (!options.timing.sample_duration_uS || !options.shard_bytes) {
+        fprintf(stderr, "The sample duration and the shard size must be set\n");
+        return -1;
+    }
+
+    Result<ILidarScanLogWriter*> writer = createScanLogWriter(logPath, encoding);
+    if (!writer) {
+        fprintf(stderr, "Failed to create the scan log %s\n", logPath);
+        return -1;
+    }
+
+    ScanLogSink sink(*writer);
+    LidarBatchDecodeStats stats;
+    memset(&stats, 0, sizeof(stats));
+    sl_u64 startTs = sdk_now_us();
+    sl_result ans = decodeLidarCapture(capturePath, sink, options, &stats);
+    sl_u64 elapsed_uS = sdk_now_us() - startTs;
+    if (SL_IS_OK(ans)) ans = (*writer)->close();
+    delete *writer;
+
+    if (SL_IS_FAIL(ans)) {
+        fprintf(stderr, "Failed to decode %s, error code: %x\n", capturePath, ans);
+        return -1;
+    }
+
+    printf("%llu sample streams in %llu shards, %llu scans of %llu nodes written to %s\n",
+        (unsigned long long)stats.streams, (unsigned long long)stats.shards,
+        (unsigned long long)stats.scans, (unsigned long long)stats.nodes, logPath);
+    if (elapsed_uS) {
+        printf("Decoded %.1f MB in %.2f s: %.1f MB/s\n", stats.sample_bytes / 1048576.0, elapsed_uS / 1000000.0,
+            stats.sample_bytes / (double)elapsed_uS);
+    }
+    return 0;
+}
@@ -34,6 +34,7 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <string.h>
+#include <vector>
 
 #include "sl_lidar.h" 
 #include "sl_lidar_driver.h"
@@ -65,8 +66,163 @@ void print_usage(int argc, const char* argv[])
         "Usage:\n"
         " %s <com port> [baudrate]\n"
         " The baudrate can be ANY possible values between 115200 to 512000.\n"
+        " %s <com port> --search [--window=<seconds>] [--threshold=<percent>] [--candidates=<baudrate,...>] [--cache=<dir>]\n"
+        " Streams the scan data at each candidate and reports the highest baudrate whose error rate stays under the threshold,\n"
+        " the result is kept in the capability cache in <dir> when given.\n"
 
-        , "SL_LIDAR_SDK_VERSION", argv[0]);
+        , "SL_LIDAR_SDK_VERSION", argv[0], argv[0]);
+}
+
+static const sl_u32 DEFAULT_SEARCH_CANDIDATES[] = { 115200, 230400, 256000, 460800, 512000 };
+static const int    DEFAULT_SEARCH_WINDOW_SECONDS = 5;
+static const double DEFAULT_SEARCH_THRESHOLD_PERCENT = 0.1;
+
+static sl_u64 sdk_now_us()
+{
+    LidarClockInfo info;
+    getLidarClockInfo(info);
+    return info.now_uS;
+}
+
+struct LinkQuality
+{
+    bool    negotiated;
+    sl_u32  detected;       // the baudrate measured by the LIDAR
+    size_t  scans;
+    size_t  timeouts;       // the grabs without a scan
+    sl_u64  packets;
+    sl_u64  errors;         // the packets failing the checksum and the broken packet headers
+};
+
+static void sum_decode_stats(const LidarDecodeStats & stats, sl_u64 & packets, sl_u64 & errors)
+{
+    packets = errors = 0;
+    for (size_t pos = 0; pos < stats.sample_type_count; ++pos) {
+        packets += stats.samples[pos].packets + stats.samples[pos].checksum_errors;
+        errors += stats.samples[pos].checksum_errors + stats.samples[pos].resyncs;
+    }
+}
+
+static double error_rate_percent(const LinkQuality & quality)
+{
+    return quality.packets ? quality.errors * 100.0 / quality.packets : 100.0;
+}
+
+// negotiate the baudrate and stream the scan data over the window, the driver is left disconnected
+static void measure_link(ILidarDriver * drv, const char * port, sl_u32 baudrate, int windowSeconds, LinkQuality & quality)
+{
+    memset(&quality, 0, sizeof(quality));
+
+    IChannel * channel = *createSerialPortChannel(port, baudrate);
+    if (!channel) return;
+
+    do {
+        if (SL_IS_FAIL(drv->connect(channel))) break;
+        if (SL_IS_FAIL(drv->negotiateSerialBaudRate(baudrate, &quality.detected))) break;
+        if (SL_IS_FAIL(drv->connect(channel))) break; // reconnect, otherwise, corrupted data will be retrieved.
+
+        sl_lidar_response_device_info_t devinfo;
+        if (SL_IS_FAIL(drv->getDeviceInfo(devinfo))) break;
+        quality.negotiated = true;
+
+        if (SL_IS_FAIL(drv->startScan(false, true))) break;
+
+        std::vector<sl_lidar_response_measurement_node_hq_t> nodes(8192);
+        size_t count = nodes.size();
+        // the motor spin up is not measured
+        if (SL_IS_FAIL(drv->grabScanDataHq(&nodes[0], count, 3000))) {
+            ++quality.timeouts;
+            break;
+        }
+
+        LidarDecodeStats before, after;
+        drv->getDecodeStats(before);
+        const sl_u64 endTs = sdk_now_us() + (sl_u64)windowSeconds * 1000000;
+        while (sdk_now_us() < endTs) {
+            count = nodes.size();
+            if (SL_IS_OK(drv->grabScanDataHq(&nodes[0], count, 1000))) {
+                ++quality.scans;
+            } else {
+                ++quality.timeouts;
+            }
+        }
+        drv->getDecodeStats(after);
+
+        sl_u64 packetsBefore, errorsBefore;
+        sum_decode_stats(before, packetsBefore, errorsBefore);
+        sum_decode_stats(after, quality.packets, quality.errors);
+        quality.packets -= packetsBefore;
+        quality.errors -= errorsBefore;
+    } while (0);
+
+    drv->stop();
+    drv->disconnect();
+    delete channel;
+}
+
+static bool parse_candidates(const char * list, std::vector<sl_u32> & candidates)
+{
+    candidates.clear();
+    while (*list) {
+        char * end;
+        unsigned long baudrate = strtoul(list, &end, 10);
+        if (end == list || baudrate < 115200 || baudrate > 512000) return false;
+        candidates.push_back((sl_u32)baudrate);
+        list = end;
+        if (*list == ',') ++list;
+        else if (*list) return false;
+    }
+    return !candidates.empty();
+}
+
+// try each candidate and report the highest baudrate whose error rate stays under the threshold
+static int search_max_baudrate(ILidarDriver * drv, const char * port, const std::vector<sl_u32> & candidates,
+    int windowSeconds, double thresholdPercent, const char * cacheDir)
+{
+    sl_u32 best = 0;
+
+    printf("Searching the highest stable baudrate at %s, %d seconds per candidate, error threshold %.3f %%\n",
+        port, windowSeconds, thresholdPercent);
+    printf("%10s %10s %8s %9s %10s %8s %9s\n", "baudrate", "detected", "scans", "timeouts", "packets", "errors", "error %");
+
+    for (size_t pos = 0; pos < candidates.size(); ++pos) {
+        LinkQuality quality;
+        measure_link(drv, port, candidates[pos], windowSeconds, quality);
+
+        if (!quality.negotiated) {
+            printf("%10u %10s negotiation failed\n", candidates[pos], "-");
+            continue;
+        }
+
+        double errorRate = error_rate_percent(quality);
+        bool stable = quality.scans && !quality.timeouts && errorRate <= thresholdPercent;
+        printf("%10u %10u %8u %9u %10llu %8llu %9.3f%s\n", candidates[pos], quality.detected,
+            (unsigned)quality.scans, (unsigned)quality.timeouts, (unsigned long long)quality.packets,
+            (unsigned long long)quality.errors, errorRate, stable ? "" : "  unstable");
+
+        if (stable && candidates[pos] > best) best = candidates[pos];
+    }
+
+    if (!best) {
+        fprintf(stderr, "Error, no candidate baudrate is stable.\n");
+        return -1;
+    }
+    printf("The highest stable baudrate is %u bps.\n", best);
+
+    if (cacheDir) {
+        // the cache is keyed by the serial number, connect once more at the result to store it
+        IChannel * channel = *createSerialPortChannel(port, best);
+        if (channel && SL_IS_OK(drv->setCapabilityCache(cacheDir)) && SL_IS_OK(drv->connect(channel))
+            && SL_IS_OK(drv->negotiateSerialBaudRate(best)) && SL_IS_OK(drv->connect(channel))
+            && SL_IS_OK(drv->setCachedMaxSerialBaudRate(best))) {
+            printf("Kept in the capability cache in %s.\n", cacheDir);
+        } else {
+            fprintf(stderr, "Error, cannot keep the result in the capability cache in %s.\n", cacheDir);
+        }
+        drv->disconnect();
+        delete channel;
+    }
+    return 0;
 }
 
 
@@ -91,6 +247,45 @@ int main(int argc, const char* argv[]) {
         return -1;
     }
 
+    if (argc > 2 && strcmp(argv[2], "--search") == 0)
+    {
+        std::vector<sl_u32> candidates(DEFAULT_SEARCH_CANDIDATES, DEFAULT_SEARCH_CANDIDATES + _countof(DEFAULT_SEARCH_CANDIDATES));
+        int windowSeconds = DEFAULT_SEARCH_WINDOW_SECONDS;
+        double thresholdPercent = DEFAULT_SEARCH_THRESHOLD_PERCENT;
+        const char* cacheDir = NULL;
+
+        for (int pos = 3; pos < argc; ++pos) {
+            if (strncmp(argv[pos], "--window=", 9) == 0) {
+                windowSeconds = atoi(argv[pos] + 9);
+            } else if (strncmp(argv[pos], "--threshold=", 12) == 0) {
+                thresholdPercent = atof(argv[pos] + 12);
+            } else if (strncmp(argv[pos], "--candidates=", 13) == 0) {
+                if (!parse_candidates(argv[pos] + 13, candidates)) {
+                    fprintf(stderr, "The candidates must be baudrates in the range of [115200, 512000] separated by commas\n");
+                    return -1;
+                }
+            } else if (strncmp(argv[pos], "--cache=", 8) == 0) {
+                cacheDir = argv[pos] + 8;
+            } else {
+                print_usage(argc, argv);
+                return -1;
+            }
+        }
+        if (windowSeconds <= 0 || thresholdPercent < 0) {
+            print_usage(argc, argv);
+            return -1;
+        }
+
+        ILidarDriver* drv = *createLidarDriver();
+        if (!drv) {
+            fprintf(stderr, "insufficent memory, exit\n");
+            exit(-2);
+        }
+        int ans = search_max_baudrate(drv, opt_port_dev, candidates, windowSeconds, thresholdPercent, cacheDir);
+        delete drv;
+        return ans;
+    }
+
     if (argc > 2)
     {
         opt_required_baudrate = strtoul(argv[2], NULL, 10);
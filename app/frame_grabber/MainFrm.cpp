@@ -39,6 +39,8 @@
 #include "IpConfigDlg.h"
 
 const int REFRESEH_TIMER = 0x800;
+const int REPLAY_TIMER = 0x801;
+const int REPLAY_TIMELINE_HEIGHT = 28;
 static int lidarType;
 
 BOOL CMainFrame::PreTranslateMessage(MSG* pMsg)
@@ -100,6 +102,22 @@ LRESULT CMainFrame::OnCreate(UINT /*uMsg*/, WPARAM /*wParam*/, LPARAM /*lParam*/
     pLoop->AddIdleHandler(this);
 
     workingMode = WORKING_MODE_IDLE;
+    scanReadyPosted_ = false;
+    refreshTimerArmed_ = false;
+    lastRefreshTick_ = 0;
+    replayLog_ = NULL;
+    replayPos_ = 0;
+    replayPaused_ = false;
+    replayTimeline_.Create(m_hWnd, rcDefault, NULL, WS_CHILD | TBS_HORZ | TBS_NOTICKS, 0, IDC_REPLAY_TIMELINE);
+
+    // pace the redraws to the refresh rate of the display
+    {
+        CClientDC screenDC(NULL);
+        int refreshHz = screenDC.GetDeviceCaps(VREFRESH);
+        if (refreshHz <= 1) refreshHz = 60;
+        refreshIntervalMs_ = 1000 / refreshHz;
+    }
+
     LidarMgr::GetInstance().lidar_drv->getDeviceInfo(devInfo);
 
 
@@ -149,9 +167,7 @@ LRESULT CMainFrame::OnCreate(UINT /*uMsg*/, WPARAM /*wParam*/, LPARAM /*lParam*/
     usingScanMode_ = typicalMode;
     updateControlStatus();
 
-    
-    // setup timer
-    this->SetTimer(REFRESEH_TIMER, 1000/30);
+
     checkDeviceHealth();
     UISetCheck(ID_CMD_STOP, 1);
     forcescan = 0;
@@ -161,6 +177,9 @@ LRESULT CMainFrame::OnCreate(UINT /*uMsg*/, WPARAM /*wParam*/, LPARAM /*lParam*/
 
 LRESULT CMainFrame::OnDestroy(UINT /*uMsg*/, WPARAM /*wParam*/, LPARAM /*lParam*/, BOOL& bHandled)
 {
+    LidarMgr::GetInstance().lidar_drv->setScanListener(NULL);
+    recorder_.stop();
+    closeReplay();
     LidarMgr::GetInstance().lidar_drv->setMotorSpeed(0);
     // unregister message filtering and idle updates
     this->KillTimer(REFRESEH_TIMER);
@@ -265,12 +284,51 @@ LRESULT CMainFrame::OnAppAbout(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCt
 
 void CMainFrame::OnTimer(UINT_PTR nIDEvent)
 {
-    switch (workingMode)
+    if (nIDEvent == REPLAY_TIMER) {
+        onReplayTick();
+        return;
+    }
+    if (nIDEvent != REFRESEH_TIMER) return;
+
+    // one-shot: flush the scan held back by onRefreshScanData
+    this->KillTimer(REFRESEH_TIMER);
+    refreshTimerArmed_ = false;
+    onRefreshScanData();
+}
+
+void CMainFrame::onScanComplete(const LidarScanLease& scan, sl_u64 timestamp_uS)
+{
+    // every scan is recorded, only the display is coalesced
+    recorder_.pushScan(scan);
+
+    bool needPost;
     {
-    case WORKING_MODE_SCAN:
-        onRefreshScanData();
-        break;
+        rp::hal::AutoLocker l(scanLocker_);
+        // a newer scan replaces the one not displayed yet
+        pendingScan_ = scan;
+        needPost = !scanReadyPosted_;
+        scanReadyPosted_ = true;
+    }
+
+    if (needPost) {
+        PostMessage(WM_LIDAR_SCAN_READY);
+    }
+}
+
+LRESULT CMainFrame::OnScanReady(UINT /*uMsg*/, WPARAM /*wParam*/, LPARAM /*lParam*/, BOOL& /*bHandled*/)
+{
+    if (refreshTimerArmed_) return 0;
+
+    DWORD elapsed = GetTickCount() - lastRefreshTick_;
+    if (elapsed < refreshIntervalMs_) {
+        // drawn less than a frame ago, show the newest scan once the frame is over
+        this->SetTimer(REFRESEH_TIMER, refreshIntervalMs_ - elapsed);
+        refreshTimerArmed_ = true;
+        return 0;
     }
+
+    onRefreshScanData();
+    return 0;
 }
 
 LRESULT CMainFrame::OnCmdReset(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOOL& bHandled)
@@ -310,6 +368,7 @@ LRESULT CMainFrame::OnFileDumpdata(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOO
 {
     switch (workingMode) {
     case WORKING_MODE_SCAN:
+    case WORKING_MODE_REPLAY:
         {
             //capture the snapshot
             std::vector<scanDot> snapshot = m_scanview.getScanList();
@@ -332,17 +391,179 @@ LRESULT CMainFrame::OnFileDumpdata(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOO
 }
 
 
-void    CMainFrame::onRefreshScanData()
+LRESULT CMainFrame::OnFileRecord(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOOL& bHandled)
+{
+    if (recorder_.isRecording()) {
+        recorder_.stop();
+        UISetCheck(ID_FILE_RECORD, 0);
+
+        char msg[200];
+        sprintf(msg, "%llu scans recorded, %llu dropped.",
+            (unsigned long long)recorder_.getRecordedCount(), (unsigned long long)recorder_.getDroppedCount());
+        MessageBox(msg, "Recording stopped", MB_OK);
+        return 0;
+    }
+
+    CFileDialog dlg(FALSE, "slog", NULL, OFN_HIDEREADONLY | OFN_OVERWRITEPROMPT, "Scan Log (*.slog)\0*.slog\0All Files (*.*)\0*.*\0");
+    if (dlg.DoModal() != IDOK) return 0;
+
+    if (!recorder_.start(LidarMgr::GetInstance().lidar_drv, dlg.m_szFileName)) {
+        MessageBox("Cannot create the scan log.", "Error", MB_OK);
+        return 0;
+    }
+    UISetCheck(ID_FILE_RECORD, 1);
+    return 0;
+}
+
+LRESULT CMainFrame::OnFileReplay(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOOL& bHandled)
+{
+    CFileDialog dlg(TRUE, "slog", NULL, OFN_HIDEREADONLY | OFN_FILEMUSTEXIST, "Scan Log (*.slog)\0*.slog\0All Files (*.*)\0*.*\0");
+    if (dlg.DoModal() != IDOK) return 0;
+
+    Result<ILidarScanLogReader *> log = createScanLogReader(dlg.m_szFileName);
+    if (!log || (*log)->getScanCount() == 0) {
+        if (log) delete *log;
+        MessageBox("Cannot open the scan log or it is empty.", "Error", MB_OK);
+        return 0;
+    }
+
+    if (recorder_.isRecording()) {
+        recorder_.stop();
+        UISetCheck(ID_FILE_RECORD, 0);
+    }
+
+    onSwitchMode(WORKING_MODE_REPLAY);
+    closeReplay();
+    replayLog_ = *log;
+
+    LidarScanLogEntry first, last;
+    replayLog_->getScan(0, first);
+    replayFirstTs_ = first.timestamp_uS;
+    replayLog_->getScan(replayLog_->getScanCount() - 1, last);
+
+    int durationMs = (int)((last.timestamp_uS - replayFirstTs_) / 1000);
+    replayTimeline_.SetRange(0, durationMs, TRUE);
+    replayTimeline_.SetPageSize(1000);
+    replayTimeline_.ShowWindow(SW_SHOW);
+    UpdateLayout();
+
+    replayPaused_ = false;
+    UISetCheck(ID_CMD_REPLAY_PAUSE, 0);
+    seekReplay(0);
+    this->SetTimer(REPLAY_TIMER, refreshIntervalMs_);
+    return 0;
+}
+
+LRESULT CMainFrame::OnReplayPause(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOOL& bHandled)
+{
+    if (!replayLog_) return 0;
+
+    replayPaused_ = !replayPaused_;
+    UISetCheck(ID_CMD_REPLAY_PAUSE, replayPaused_ ? 1 : 0);
+    // resume from the scan shown, or from the start once the end was reached
+    if (!replayPaused_) {
+        seekReplay(replayPos_ + 1 >= replayLog_->getScanCount() ? 0 : replayPos_);
+    }
+    return 0;
+}
+
+void CMainFrame::OnHScroll(UINT nSBCode, UINT nPos, CScrollBar pScrollBar)
+{
+    if (!replayLog_ || pScrollBar.m_hWnd != replayTimeline_.m_hWnd) return;
+    if (nSBCode == TB_ENDTRACK) return;
+
+    // locate the scan through the timestamp index of the log
+    sl_u64 target = replayFirstTs_ + (sl_u64)replayTimeline_.GetPos() * 1000;
+    seekReplay(replayLog_->findScan(target));
+}
+
+void CMainFrame::seekReplay(size_t index)
+{
+    // the delta encoded nodes are only valid until the next call to getScan, so the next scan is read first
+    LidarScanLogEntry next;
+    bool hasNext = IS_OK(replayLog_->getScan(index + 1, next));
+
+    LidarScanLogEntry scan;
+    if (IS_FAIL(replayLog_->getScan(index, scan))) return;
+
+    // the log has no scan mode, the sample duration is estimated from the next scan
+    float sampleDuration = modeVec_[usingScanMode_].us_per_sample;
+    if (hasNext && scan.count && next.timestamp_uS > scan.timestamp_uS) {
+        sampleDuration = (float)(next.timestamp_uS - scan.timestamp_uS) / scan.count;
+    }
+
+    replayPos_ = index;
+    replayBaseTs_ = scan.timestamp_uS;
+    replayBaseTick_ = GetTickCount();
+    m_scanview.setScanData(scan.nodes, scan.count, sampleDuration);
+    replayTimeline_.SetPos((int)((scan.timestamp_uS - replayFirstTs_) / 1000));
+}
+
+void CMainFrame::onReplayTick()
+{
+    if (!replayLog_ || replayPaused_) return;
+
+    sl_u64 target = replayBaseTs_ + (sl_u64)(GetTickCount() - replayBaseTick_) * 1000;
+    size_t index = replayLog_->findScan(target);
+    if (index == replayPos_) return;
+
+    // keep the wall clock base across the frames, seekReplay resets it to the scan shown
+    DWORD baseTick = replayBaseTick_;
+    sl_u64 baseTs = replayBaseTs_;
+    seekReplay(index);
+    replayBaseTick_ = baseTick;
+    replayBaseTs_ = baseTs;
+
+    if (index + 1 >= replayLog_->getScanCount()) {
+        replayPaused_ = true;
+        UISetCheck(ID_CMD_REPLAY_PAUSE, 1);
+    }
+}
+
+void CMainFrame::closeReplay()
 {
-    sl_lidar_response_measurement_node_hq_t nodes[8192];
-    size_t cnt = _countof(nodes);
-    ILidarDriver * lidar_drv = LidarMgr::GetInstance().lidar_drv;
+    this->KillTimer(REPLAY_TIMER);
+    if (replayTimeline_.IsWindow() && replayTimeline_.IsWindowVisible()) {
+        replayTimeline_.ShowWindow(SW_HIDE);
+        UpdateLayout();
+    }
+    delete replayLog_;
+    replayLog_ = NULL;
+}
 
-    if (IS_OK(lidar_drv->grabScanDataHq(nodes, cnt, 0)))
+void CMainFrame::UpdateLayout(BOOL bResizeBars)
+{
+    RECT rect = { 0 };
+    GetClientRect(&rect);
+    UpdateBarsPosition(rect, bResizeBars);
+
+    // the replay timeline sits between the view and the status bar
+    if (replayTimeline_.IsWindow() && replayTimeline_.IsWindowVisible()) {
+        rect.bottom -= REPLAY_TIMELINE_HEIGHT;
+        replayTimeline_.SetWindowPos(NULL, rect.left, rect.bottom, rect.right - rect.left, REPLAY_TIMELINE_HEIGHT,
+            SWP_NOZORDER | SWP_NOACTIVATE);
+    }
+
+    if (m_hWndClient != NULL) {
+        ::SetWindowPos(m_hWndClient, NULL, rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top,
+            SWP_NOZORDER | SWP_NOACTIVATE);
+    }
+}
+
+void    CMainFrame::onRefreshScanData()
+{
+    LidarScanLease scan;
     {
-        float sampleDurationRefresh = modeVec_[usingScanMode_].us_per_sample;
-        m_scanview.setScanData(nodes, cnt, sampleDurationRefresh);
+        rp::hal::AutoLocker l(scanLocker_);
+        scan.swap(pendingScan_);
+        scanReadyPosted_ = false;
     }
+
+    if (!scan || workingMode != WORKING_MODE_SCAN) return;
+
+    lastRefreshTick_ = GetTickCount();
+    float sampleDurationRefresh = modeVec_[usingScanMode_].us_per_sample;
+    m_scanview.setScanData(scan->nodes, scan->count, sampleDurationRefresh);
 }
 
 void    CMainFrame::updateControlStatus()
@@ -364,9 +585,12 @@ void    CMainFrame::updateControlStatus()
         break;
 
     case WORKING_MODE_SCAN:
+    case WORKING_MODE_REPLAY:
         m_CmdBar.GetMenu().GetSubMenu(2).EnableMenuItem(SCANMODE_SUB, MF_BYPOSITION | MF_DISABLED);
         break;
     }
+    UIEnable(ID_CMD_REPLAY_PAUSE, workingMode == WORKING_MODE_REPLAY);
+    UIEnable(ID_FILE_RECORD, workingMode != WORKING_MODE_REPLAY);
 
     onUpdateTitle();
 }
@@ -382,6 +606,9 @@ void    CMainFrame::onUpdateTitle()
     case WORKING_MODE_SCAN:
         workingmodeDesc = "SCAN";
         break;
+    case WORKING_MODE_REPLAY:
+        workingmodeDesc = "REPLAY";
+        break;
     default:
         assert(!"should not come here");
     }
@@ -422,11 +649,14 @@ void    CMainFrame::onSwitchMode(int newMode)
     // switch mode
     if (newMode == workingMode) return;
 
+    if (workingMode == WORKING_MODE_REPLAY) closeReplay();
+
     switch (newMode) {
     case WORKING_MODE_IDLE:
         {
             // stop the previous operation
             LidarMgr::GetInstance().lidar_drv->stop();
+            LidarMgr::GetInstance().lidar_drv->setScanListener(NULL);
             UISetCheck(ID_CMD_STOP, 1);
             UISetCheck(ID_CMD_GRAB_PEAK, 0);
             UISetCheck(ID_CMD_GRAB_FRAME, 0);
@@ -442,6 +672,7 @@ void    CMainFrame::onSwitchMode(int newMode)
             m_scanview.ShowWindow(SW_SHOW);
             checkDeviceHealth();
             LidarMgr::GetInstance().lidar_drv->setMotorSpeed();
+            LidarMgr::GetInstance().lidar_drv->setScanListener(this);
             LidarMgr::GetInstance().lidar_drv->startScanExpress(forcescan, usingScanMode_);
             UISetCheck(ID_CMD_STOP, 0);
             UISetCheck(ID_CMD_GRAB_PEAK, 0);
@@ -450,6 +681,22 @@ void    CMainFrame::onSwitchMode(int newMode)
             UISetCheck(ID_CMD_GRABFRAMENONEDIFF, 0);
         }
         break;
+    case WORKING_MODE_REPLAY:
+        {
+            // the device is left idle while the log is shown
+            LidarMgr::GetInstance().lidar_drv->stop();
+            LidarMgr::GetInstance().lidar_drv->setScanListener(NULL);
+            CWindow  hwnd = m_hWndClient;
+            hwnd.ShowWindow(SW_HIDE);
+            m_hWndClient = m_scanview;
+            m_scanview.ShowWindow(SW_SHOW);
+            UISetCheck(ID_CMD_STOP, 0);
+            UISetCheck(ID_CMD_GRAB_PEAK, 0);
+            UISetCheck(ID_CMD_GRAB_FRAME, 0);
+            UISetCheck(ID_CMD_SCAN, 0);
+            UISetCheck(ID_CMD_GRABFRAMENONEDIFF, 0);
+        }
+        break;
     default:
         assert(!"unsupported mode");
     }
@@ -32,6 +32,7 @@
 
 #include "drvlogic\lidarmgr.h"
 #include "ChooseConnectionDlg.h"
+#include "drvlogic\scanrecorder.h"
 
 #define FILE_MENU     0
 #define COMMAND_MENU  1
@@ -43,15 +44,20 @@
 #define    DETECTMODE_SUB 3000
 #define    IPCONFIG_SUB   4000
 
+// posted by the scan listener when a new scan is waiting for the display
+#define    WM_LIDAR_SCAN_READY   (WM_APP + 0x10)
+
 class CMainFrame : 
     public CFrameWindowImpl<CMainFrame>, 
     public CUpdateUI<CMainFrame>,
-    public CMessageFilter, public CIdleHandler
+    public CMessageFilter, public CIdleHandler,
+    public IScanListener
 {
 public:
     enum {
         WORKING_MODE_IDLE       = 0,
         WORKING_MODE_SCAN       = 3,
+        WORKING_MODE_REPLAY     = 4,
     };
     enum {
         LIDAR_A_SERIES_MINUM_MAJOR_ID      = 0,
@@ -73,16 +79,23 @@ public:
         UPDATE_ELEMENT(ID_CMD_SCAN, UPDUI_MENUPOPUP| UPDUI_TOOLBAR)
 
         UPDATE_ELEMENT(ID_OPT_FORCESCAN, UPDUI_MENUPOPUP)
+        UPDATE_ELEMENT(ID_FILE_RECORD, UPDUI_MENUPOPUP)
+        UPDATE_ELEMENT(ID_CMD_REPLAY_PAUSE, UPDUI_MENUPOPUP)
     END_UPDATE_UI_MAP()
 
     BEGIN_MSG_MAP(CMainFrame)
         COMMAND_ID_HANDLER(ID_FILE_DUMPDATA, OnFileDumpdata)
+        COMMAND_ID_HANDLER(ID_FILE_RECORD, OnFileRecord)
+        COMMAND_ID_HANDLER(ID_FILE_REPLAY, OnFileReplay)
+        COMMAND_ID_HANDLER(ID_CMD_REPLAY_PAUSE, OnReplayPause)
         COMMAND_ID_HANDLER(ID_OPT_FORCESCAN, OnOptForcescan)
         COMMAND_ID_HANDLER(ID_CMD_SCAN, OnCmdScan)
         COMMAND_ID_HANDLER(ID_CMD_STOP, OnCmdStop)
         COMMAND_ID_HANDLER(ID_CMD_RESET, OnCmdReset)
         COMMAND_ID_HANDLER(ID_CMD_SET_FREQ, OnSetFreq)
         MSG_WM_TIMER(OnTimer)
+        MSG_WM_HSCROLL(OnHScroll)
+        MESSAGE_HANDLER(WM_LIDAR_SCAN_READY, OnScanReady)
         MESSAGE_HANDLER(WM_CREATE, OnCreate)
         MESSAGE_HANDLER(WM_DESTROY, OnDestroy)
         COMMAND_ID_HANDLER(ID_APP_EXIT, OnFileExit)
@@ -102,6 +115,7 @@ public:
     void    scanModeSelect(int mode);
     void    detectModeSelect(int mode);
     void    ipConfig();
+    void    UpdateLayout(BOOL bResizeBars = TRUE);
 
     void    recordChannel(const CChooseConnectionDlg::connection_type_info connectionInfo)
     {
@@ -116,17 +130,28 @@ public:
     LRESULT OnViewStatusBar(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
     LRESULT OnAppAbout(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
     void OnTimer(UINT_PTR nIDEvent);
+    LRESULT OnScanReady(UINT /*uMsg*/, WPARAM /*wParam*/, LPARAM /*lParam*/, BOOL& /*bHandled*/);
     LRESULT OnCmdReset(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOOL& bHandled);
     LRESULT OnSetFreq(WORD /*wNotifyCode*/, WORD /*wID*/, HWND /*hWndCtl*/, BOOL& /*bHandled*/);
     LRESULT OnCmdStop(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOOL& bHandled);
     LRESULT OnCmdScan(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOOL& bHandled);
     LRESULT OnOptForcescan(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOOL& bHandled);
     LRESULT OnFileDumpdata(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOOL& bHandled);
+    LRESULT OnFileRecord(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOOL& bHandled);
+    LRESULT OnFileReplay(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOOL& bHandled);
+    LRESULT OnReplayPause(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOOL& bHandled);
+    void OnHScroll(UINT nSBCode, UINT nPos, CScrollBar pScrollBar);
     BOOL OnMouseWheel(UINT nFlags, short zDelta, CPoint pt);
     LRESULT OnMouseWheel(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled);
-    
+
+    // called on the decoder thread of the driver
+    virtual void onScanComplete(const LidarScanLease& scan, sl_u64 timestamp_uS);
 
 protected:
+    void    closeReplay();
+    void    seekReplay(size_t index);
+    void    onReplayTick();
+
     int     workingMode; // 0 - idle 1 - framegrabber
     bool    forcescan;
     bool    useExpressMode;
@@ -153,4 +178,23 @@ protected:
     size_t scanModeMenuRecBegin_;
     size_t detectModeMenuRecBegin_;
     CChooseConnectionDlg::connection_type_info channelRecord_;
+
+    // the newest scan pushed by the driver, shown at most once per display refresh
+    rp::hal::Locker  scanLocker_;
+    LidarScanLease   pendingScan_;
+    bool             scanReadyPosted_;
+    bool             refreshTimerArmed_;
+    DWORD            lastRefreshTick_;
+    DWORD            refreshIntervalMs_;
+
+    ScanRecorder     recorder_;
+
+    // replay of a scan log, played back against GetTickCount from replayBaseTs_
+    ILidarScanLogReader * replayLog_;
+    CTrackBarCtrl    replayTimeline_;
+    size_t           replayPos_;
+    sl_u64           replayFirstTs_;
+    sl_u64           replayBaseTs_;
+    DWORD            replayBaseTick_;
+    bool             replayPaused_;
 };
\ No newline at end of file
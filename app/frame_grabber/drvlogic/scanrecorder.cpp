@@ -0,0 +1,125 @@
+/*
+ *  SLAMTEC LIDAR
+ *  Win32 Demo Application
+ *
+ *  Copyright (c) 2009 - 2014 RoboPeak Team
+ *  http://www.robopeak.com
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include "scanrecorder.h"
+
+ScanRecorder::ScanRecorder()
+    : _drv(NULL)
+    , _writer(NULL)
+    , _stopping(false)
+    , _recordedCount(0)
+    , _droppedCount(0)
+{
+
+}
+
+ScanRecorder::~ScanRecorder()
+{
+    stop();
+}
+
+bool ScanRecorder::start(ILidarDriver * drv, const char * path)
+{
+    stop();
+
+    Result<ILidarScanLogWriter *> writer = createScanLogWriter(path);
+    if (!writer) return false;
+
+    _drv = drv;
+    _writer = *writer;
+    _stopping = false;
+    _recordedCount = 0;
+    _droppedCount = 0;
+
+    std::string capturePath = std::string(path) + ".raw";
+    _drv->startRecording(capturePath.c_str());
+
+    _thrdWriter = CLASS_THREAD(ScanRecorder, _proc_write);
+    return true;
+}
+
+void ScanRecorder::stop()
+{
+    if (!_writer) return;
+
+    _drv->stopRecording();
+
+    {
+        rp::hal::AutoLocker l(_locker);
+        _stopping = true;
+    }
+    _pendingEvent.set();
+    _thrdWriter.join();
+
+    // the writer has drained the queue, the index is written on close
+    _writer->close();
+    delete _writer;
+    _writer = NULL;
+    _drv = NULL;
+}
+
+void ScanRecorder::pushScan(const LidarScanLease & scan)
+{
+    {
+        rp::hal::AutoLocker l(_locker);
+        if (!_writer || _stopping) return;
+
+        if (_pending.size() >= MAX_PENDING_SCANS) {
+            ++_droppedCount;
+            return;
+        }
+        _pending.push_back(scan);
+    }
+    _pendingEvent.set();
+}
+
+sl_result ScanRecorder::_proc_write(void)
+{
+    std::deque<LidarScanLease> batch;
+    while (true) {
+        bool stopping;
+        {
+            rp::hal::AutoLocker l(_locker);
+            batch.swap(_pending);
+            stopping = _stopping;
+        }
+
+        for (size_t pos = 0; pos < batch.size(); ++pos) {
+            const LidarScanData & scan = *batch[pos];
+            if (IS_OK(_writer->appendScan(scan.nodes, scan.count, scan.timestamp_uS))) {
+                ++_recordedCount;
+            } else {
+                ++_droppedCount;
+            }
+        }
+        batch.clear();
+
+        if (stopping) break;
+        _pendingEvent.wait();
+    }
+    return SL_RESULT_OK;
+}
@@ -0,0 +1,71 @@
+/*
+ *  SLAMTEC LIDAR
+ *  Win32 Demo Application
+ *
+ *  Copyright (c) 2009 - 2014 RoboPeak Team
+ *  http://www.robopeak.com
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+#include "common.h"
+#include "sl_lidar_scan_log.h"
+#include "..\..\sdk\src\hal\locker.h"
+#include "..\..\sdk\src\hal\event.h"
+#include "..\..\sdk\src\hal\thread.h"
+#include <deque>
+
+// Records the scans pushed by the driver into a scan log, next to a raw capture of the channel
+// The scan listener only queues the leases, the log is written by a background thread.
+class ScanRecorder {
+
+public:
+    enum {
+        // the leases kept waiting for the writer before the new scans are dropped
+        MAX_PENDING_SCANS = 64,
+    };
+
+    ScanRecorder();
+    ~ScanRecorder();
+
+    // the raw capture is written to "<path>.raw", it can be replayed through createReplayChannel
+    bool start(ILidarDriver * drv, const char * path);
+    void stop();
+    bool isRecording() const { return _writer != NULL; }
+
+    // called on the decoder thread for each complete scan
+    void pushScan(const LidarScanLease & scan);
+
+    sl_u64 getRecordedCount() const { return _recordedCount; }
+    sl_u64 getDroppedCount() const { return _droppedCount; }
+
+protected:
+    sl_result _proc_write(void);
+
+    ILidarDriver *             _drv;
+    ILidarScanLogWriter *      _writer;
+    rp::hal::Thread            _thrdWriter;
+    rp::hal::Locker            _locker;
+    rp::hal::Event             _pendingEvent;
+    std::deque<LidarScanLease> _pending;
+    bool                       _stopping;
+    volatile sl_u64            _recordedCount;
+    volatile sl_u64            _droppedCount;
+};
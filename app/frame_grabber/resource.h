@@ -34,6 +34,7 @@
 #define IDC_IPADDRESS_SEL               1047
 #define IDC_EDIT_IP_PORT                1048
 #define IDC_BTN_REFRESH                 1049
+#define IDC_REPLAY_TIMELINE             1051
 #define ID_CMD_GRAB_FRAME               32776
 #define ID_CMD_SCAN                     32780
 #define ID_CMD_GRAB_PEAK                32781
@@ -53,14 +54,17 @@
 #define ID_CMD_GRABFRAMENONEDIFF        32798
 #define ID_CMD_SET_FREQ                 32799
 #define ID_OPTION_EXPRESSMODE           32800
+#define ID_FILE_RECORD                  32801
+#define ID_FILE_REPLAY                  32802
+#define ID_CMD_REPLAY_PAUSE             32803
 
 // Next default values for new objects
 // 
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        213
-#define _APS_NEXT_COMMAND_VALUE         32801
-#define _APS_NEXT_CONTROL_VALUE         1051
+#define _APS_NEXT_COMMAND_VALUE         32804
+#define _APS_NEXT_CONTROL_VALUE         1052
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
 #endif
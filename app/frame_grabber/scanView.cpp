@@ -52,6 +52,10 @@ CScanView::CScanView()
     _mouse_angle = 0;
     _mouse_pt.x= _mouse_pt.y = 0;
     _is_scanning = false;
+
+    _frame_bits = NULL;
+    _buffer_size.SetSize(0, 0);
+    _grid_display_range = 0;
 }
 
 BOOL CScanView::PreTranslateMessage(MSG* pMsg)
@@ -66,19 +70,66 @@ void CScanView::DoPaint(CDCHandle dc)
 }
 
 
-void CScanView::onDrawSelf(CDCHandle dc)
+static HBITMAP createFrameBitmap(HDC dc, int width, int height, sl_u32 ** bits)
 {
-    CDC memDC;
-    CBitmap memBitmap;
-    memDC.CreateCompatibleDC(dc);
-    CRect clientRECT;
-    this->GetClientRect(&clientRECT);
+    BITMAPINFO bmi;
+    memset(&bmi, 0, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height; // top-down
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    void * pixels = NULL;
+    HBITMAP bitmap = CreateDIBSection(dc, &bmi, DIB_RGB_COLORS, &pixels, NULL, 0);
+    *bits = bitmap ? (sl_u32 *)pixels : NULL;
+    return bitmap;
+}
+
+void CScanView::_prepareBuffers(CDCHandle dc, const CRect& clientRECT)
+{
+    CSize size(clientRECT.Width(), clientRECT.Height());
+
+    if (size != _buffer_size || _frame_bits == NULL) {
+        if (_frame_dc.IsNull()) {
+            _frame_dc.CreateCompatibleDC(dc);
+            _grid_dc.CreateCompatibleDC(dc);
+        }
 
-    memBitmap.CreateCompatibleBitmap(dc,clientRECT.Width() , clientRECT.Height());
-    HBITMAP oldBitmap = memDC.SelectBitmap(memBitmap);
+        // select the new bitmaps before releasing the old ones
+        CBitmap frameBitmap(createFrameBitmap(dc, size.cx, size.cy, &_frame_bits));
+        CBitmap gridBitmap;
+        gridBitmap.CreateCompatibleBitmap(dc, size.cx, size.cy);
+        if (frameBitmap.IsNull() || gridBitmap.IsNull()) {
+            _frame_bits = NULL;
+            return;
+        }
+
+        _frame_dc.SelectBitmap(frameBitmap);
+        _grid_dc.SelectBitmap(gridBitmap);
+        if (!_frame_bitmap.IsNull()) _frame_bitmap.DeleteObject();
+        if (!_grid_bitmap.IsNull()) _grid_bitmap.DeleteObject();
+        _frame_bitmap.Attach(frameBitmap.Detach());
+        _grid_bitmap.Attach(gridBitmap.Detach());
+
+        _buffer_size = size;
+        _grid_display_range = 0;
+    }
+
+    if (_grid_display_range != _current_display_range) {
+        _drawGrid(clientRECT);
+        _grid_display_range = _current_display_range;
+    }
+}
+
+void CScanView::_drawGrid(const CRect& clientRECT)
+{
+    CDCHandle memDC = _grid_dc.m_hDC;
+
+    memDC.FillSolidRect(0, 0, clientRECT.Width(), clientRECT.Height(), RGB(0, 0, 0));
 
     HPEN oldPen = memDC.SelectStockPen(DC_PEN);
-   
     HBRUSH oldBrush = memDC.SelectStockBrush(NULL_BRUSH);
     HFONT  oldFont  = memDC.SelectFont(stdfont);
 
@@ -118,17 +169,48 @@ void CScanView::onDrawSelf(CDCHandle dc)
         memDC.TextOutA(centerPt.x, centerPt.y-plotR, txtBuffer);
     }
 
-    memDC.SelectStockBrush(DC_BRUSH);
-    memDC.SelectStockPen(NULL_PEN);
+    memDC.SelectFont(oldFont);
+    memDC.SelectBrush(oldBrush);
+    memDC.SelectPen(oldPen);
+}
+
+void CScanView::onDrawSelf(CDCHandle dc)
+{
+    CRect clientRECT;
+    this->GetClientRect(&clientRECT);
+    if (clientRECT.IsRectEmpty()) return;
+
+    _prepareBuffers(dc, clientRECT);
+    if (_frame_bits == NULL) return;
+
+    CDCHandle memDC = _frame_dc.m_hDC;
+    memDC.BitBlt(0, 0, clientRECT.Width(), clientRECT.Height(), _grid_dc, 0, 0, SRCCOPY);
+
+    HPEN oldPen = memDC.SelectStockPen(NULL_PEN);
+    HBRUSH oldBrush = memDC.SelectStockBrush(DC_BRUSH);
+    HFONT  oldFont  = memDC.SelectFont(stdfont);
+
+    memDC.SetBkMode(0);
+
+    CPoint centerPt(clientRECT.Width()/2, clientRECT.Height()/2);
+    const int maxPixelR = min(clientRECT.Width(), clientRECT.Height())/2 - DEF_MARGIN;
+    const float distScale = (float)maxPixelR/_current_display_range;
+
+    char txtBuffer[100];
 
     int picked_point = 0;
     float min_picked_dangle = 100;
 
+    // plot the dots straight into the pixels of the frame, GDI must be done with it first
+    GdiFlush();
+
+    const int width = clientRECT.Width();
+    const int height = clientRECT.Height();
     for (int pos =0; pos < (int)_scan_data.size(); ++pos) {
         float distPixel = _scan_data[pos].dist*distScale;
         float rad = (float)(_scan_data[pos].angle*PI/180.0);
-        float endptX = sin(rad)*(distPixel) + centerPt.x;
-        float endptY = centerPt.y - cos(rad)*(distPixel);
+        int x = (int)(sin(rad)*(distPixel) + centerPt.x) - 1;
+        int y = (int)(centerPt.y - cos(rad)*(distPixel)) - 1;
 
         float dangle = fabs(rad - _mouse_angle);
 
@@ -137,10 +219,17 @@ void CScanView::onDrawSelf(CDCHandle dc)
             picked_point = pos;
         }
 
-        int brightness = (_scan_data[pos].quality<<1) + 128;
+        if (x < 0 || y < 0 || x + 1 >= width || y + 1 >= height) continue;
+
+        sl_u32 brightness = (_scan_data[pos].quality<<1) + 128;
         if (brightness>255) brightness=255;
 
-        memDC.FillSolidRect((int)endptX-1,(int)endptY-1, 2, 2,RGB(0,brightness,brightness));
+        // RGB(0, brightness, brightness) in the 0x00RRGGBB layout of the DIB
+        sl_u32 color = (brightness << 8) | brightness;
+        sl_u32 * row = _frame_bits + y * width + x;
+        row[0] = row[1] = color;
+        row += width;
+        row[0] = row[1] = color;
     }
 
     memDC.SelectFont(bigfont);
@@ -188,9 +277,6 @@ void CScanView::onDrawSelf(CDCHandle dc)
     memDC.SelectFont(oldFont);
     memDC.SelectBrush(oldBrush);
     memDC.SelectPen(oldPen);
-    memDC.SelectBitmap(oldBitmap);
-
-    
 }
 
 
@@ -250,7 +336,7 @@ BOOL CScanView::OnMouseWheel(UINT nFlags, short zDelta, CPoint pt)
     return 0;
 }
 
-void CScanView::setScanData(sl_lidar_response_measurement_node_hq_t *buffer, size_t count, float sampleDuration)
+void CScanView::setScanData(const sl_lidar_response_measurement_node_hq_t *buffer, size_t count, float sampleDuration)
 {
     _scan_data.clear();
     _is_scanning = true;
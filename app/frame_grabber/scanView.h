@@ -62,7 +62,7 @@ public:
 
 
     void onDrawSelf(CDCHandle dc);
-    void setScanData(sl_lidar_response_measurement_node_hq_t *buffer, size_t count, float sampleDuration);
+    void setScanData(const sl_lidar_response_measurement_node_hq_t *buffer, size_t count, float sampleDuration);
     void stopScan();
     CScanView();
 
@@ -72,6 +72,9 @@ public:
     void OnPaint(CDCHandle dc);
     BOOL OnMouseWheel(UINT nFlags, short zDelta, CPoint pt);
 protected:
+    void _prepareBuffers(CDCHandle dc, const CRect& clientRECT);
+    void _drawGrid(const CRect& clientRECT);
+
     CFont stdfont;
     CFont bigfont;
     POINT                _mouse_pt;
@@ -83,4 +86,15 @@ protected:
     int                  _sample_counter;
     sl_u64                 _last_update_ts;
     bool                 _is_scanning;
+
+    // the grid and rings are drawn once per size and zoom into _grid_dc,
+    // each frame starts from a copy of it in the DIB section of _frame_dc
+    // the bitmaps are declared first so that the DCs holding them are released before them
+    CBitmap              _grid_bitmap;
+    CBitmap              _frame_bitmap;
+    CDC                  _grid_dc;
+    CDC                  _frame_dc;
+    sl_u32 *             _frame_bits;
+    CSize                _buffer_size;
+    float                _grid_display_range;
 };
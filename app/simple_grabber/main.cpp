@@ -27,6 +27,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <vector>
+#include <string>
+#include <algorithm>
 
 #include "sl_lidar.h" 
 #include "sl_lidar_driver.h"
@@ -40,6 +43,7 @@
 #define delay(x)   ::Sleep(x)
 #else
 #include <unistd.h>
+#include <dirent.h>
 static inline void delay(sl_word_size_t ms){
     while (ms>=1000){
         usleep(1000*1000);
@@ -52,18 +56,22 @@ static inline void delay(sl_word_size_t ms){
 
 using namespace sl;
 
+static const int DEFAULT_BENCH_SECONDS = 10;
+
 void print_usage(int argc, const char * argv[])
 {
     printf("Simple LIDAR data grabber for SLAMTEC LIDAR.\n"
            "Version:  %s \n"
            "Usage:\n"
-           " For serial channel %s --channel --serial <com port> [baudrate]\n"
+           " For serial channel %s --channel --serial <com port> [baudrate] [--bench[=seconds]]\n"
            " The baudrate used by different models is as follows:\n"
            "  A1(115200),A2M7(256000),A2M8(115200),A2M12(256000),"
            "A3(256000),S1(256000),S2(1000000),S3(1000000)\n"
-		   " For udp channel %s --channel --udp <ipaddr> [port NO.]\n"
+		   " For udp channel %s --channel --udp <ipaddr> [port NO.] [--bench[=seconds]]\n"
            "The LPX default ipaddr is 192.168.11.2,and the port NO.is 8089. Please refer to the datasheet for details.\n"
-           , SL_LIDAR_SDK_VERSION,  argv[0], argv[0]);
+           " For a recording %s --channel --replay <file> [--bench[=seconds]]\n"
+           " --bench measures the throughput and the latency of the sdk on this host for %d seconds by default\n"
+           , SL_LIDAR_SDK_VERSION,  argv[0], argv[0], argv[0], DEFAULT_BENCH_SECONDS);
 }
 
 
@@ -141,6 +149,178 @@ sl_result capture_and_display(ILidarDriver * drv)
     return ans;
 }
 
+struct ThreadCpuTime {
+    long        tid;
+    std::string name;
+    double      cpu_s;
+};
+
+// the user and system time of each thread of the process, only available on Linux
+static bool sample_thread_cpu(std::vector<ThreadCpuTime> & threads)
+{
+    threads.clear();
+#if defined(__linux__)
+    DIR * dir = opendir("/proc/self/task");
+    if (!dir) return false;
+
+    const double ticksPerSecond = (double)sysconf(_SC_CLK_TCK);
+    while (struct dirent * ent = readdir(dir)) {
+        if (ent->d_name[0] == '.') continue;
+
+        char path[300];
+        char stat[512];
+        snprintf(path, sizeof(path), "/proc/self/task/%s/stat", ent->d_name);
+        FILE * fp = fopen(path, "r");
+        if (!fp) continue;
+        size_t len = fread(stat, 1, sizeof(stat) - 1, fp);
+        fclose(fp);
+        stat[len] = 0;
+
+        // the name is within parentheses and may hold spaces, utime and stime are the 14th and 15th fields
+        char * nameBegin = strchr(stat, '(');
+        char * nameEnd = strrchr(stat, ')');
+        unsigned long utime, stime;
+        if (!nameBegin || !nameEnd || nameEnd < nameBegin) continue;
+        if (sscanf(nameEnd + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) continue;
+
+        ThreadCpuTime thread;
+        thread.tid = atol(ent->d_name);
+        thread.name.assign(nameBegin + 1, nameEnd - nameBegin - 1);
+        thread.cpu_s = (utime + stime) / ticksPerSecond;
+        threads.push_back(thread);
+    }
+    closedir(dir);
+    return true;
+#else
+    return false;
+#endif
+}
+
+static sl_u64 sdk_now_us()
+{
+    LidarClockInfo info;
+    getLidarClockInfo(info);
+    return info.now_uS;
+}
+
+static sl_u64 percentile(const std::vector<sl_u64> & sorted, double p)
+{
+    if (sorted.empty()) return 0;
+    return sorted[(size_t)((sorted.size() - 1) * p)];
+}
+
+static void sum_sample_stats(const LidarDecodeStats & stats, sl_u64 & checksumErrors, sl_u64 & resyncs, sl_u64 & skippedBytes)
+{
+    checksumErrors = resyncs = 0;
+    skippedBytes = stats.skipped_bytes;
+    for (size_t pos = 0; pos < stats.sample_type_count; ++pos) {
+        checksumErrors += stats.samples[pos].checksum_errors;
+        resyncs += stats.samples[pos].resyncs;
+        skippedBytes += stats.samples[pos].skipped_bytes;
+    }
+}
+
+// grab the scans for the given time and report how the sdk performs on this host
+// returns false if no scan was received
+bool run_benchmark(ILidarDriver * drv, int seconds)
+{
+    static const char * stageNames[LIDAR_LATENCY_STAGE_COUNT] = {
+        "rx read", "rx queue", "codec decode", "unpacker decode", "scan publish", "consumer grab",
+    };
+
+    LidarScanLease scan;
+    printf("waiting for the first scan...\n");
+    // the first scan only starts the clock, it may have waited for the motor
+    if (SL_IS_FAIL(drv->grabScanDataHqLease(scan))) {
+        fprintf(stderr, "Error, no scan received.\n");
+        return false;
+    }
+
+    printf("benchmarking for %d seconds...\n", seconds);
+
+    LidarDecodeStats decodeBegin, decodeEnd;
+    std::vector<ThreadCpuTime> cpuBegin, cpuEnd;
+    drv->getDecodeStats(decodeBegin);
+    drv->resetLatencyStats();
+    bool hasThreadCpu = sample_thread_cpu(cpuBegin);
+
+    std::vector<sl_u64> latencies;
+    sl_u64 scans = 0, samples = 0, missed = 0, timeouts = 0;
+    sl_u64 lastSequence = scan->sequence;
+    const sl_u64 beginTs = sdk_now_us();
+    const sl_u64 endTs = beginTs + (sl_u64)seconds * 1000000;
+    sl_u64 now = beginTs;
+
+    while (now < endTs) {
+        sl_result ans = drv->grabScanDataHqLease(scan, 1000);
+        now = sdk_now_us();
+        if (SL_IS_FAIL(ans)) {
+            ++timeouts;
+            continue;
+        }
+
+        // from the last sample of the scan, which the sync sample of the next one closes, to the grab return
+        if (now >= scan->end_timestamp_uS) latencies.push_back(now - scan->end_timestamp_uS);
+        if (scan->sequence > lastSequence + 1) missed += scan->sequence - lastSequence - 1;
+        lastSequence = scan->sequence;
+        ++scans;
+        samples += scan->count;
+    }
+    scan.reset();
+
+    const double elapsed = (now - beginTs) / 1000000.0;
+    drv->getDecodeStats(decodeEnd);
+    sample_thread_cpu(cpuEnd);
+    LidarRxQueueStats rxQueue;
+    drv->getRxQueueStats(rxQueue);
+
+    printf("\nBenchmark: %.1f seconds\n", elapsed);
+    printf("  scans:        %llu (%.2f scans/s), %llu missed, %llu grab timeouts\n",
+        (unsigned long long)scans, scans / elapsed, (unsigned long long)missed, (unsigned long long)timeouts);
+    printf("  samples:      %llu (%.0f samples/s)\n", (unsigned long long)samples, samples / elapsed);
+
+    std::sort(latencies.begin(), latencies.end());
+    printf("  grab latency: p50 %llu us, p90 %llu us, p99 %llu us, p99.9 %llu us, max %llu us\n",
+        (unsigned long long)percentile(latencies, 0.5), (unsigned long long)percentile(latencies, 0.9),
+        (unsigned long long)percentile(latencies, 0.99), (unsigned long long)percentile(latencies, 0.999),
+        (unsigned long long)(latencies.empty() ? 0 : latencies.back()));
+
+    sl_u64 crcBegin, resyncBegin, skippedBegin, crcEnd, resyncEnd, skippedEnd;
+    sum_sample_stats(decodeBegin, crcBegin, resyncBegin, skippedBegin);
+    sum_sample_stats(decodeEnd, crcEnd, resyncEnd, skippedEnd);
+    printf("  rx:           %llu bytes (%.0f bytes/s), %llu checksum errors, %llu resyncs, %llu bytes skipped\n",
+        (unsigned long long)(decodeEnd.rx_bytes - decodeBegin.rx_bytes), (decodeEnd.rx_bytes - decodeBegin.rx_bytes) / elapsed,
+        (unsigned long long)(crcEnd - crcBegin), (unsigned long long)(resyncEnd - resyncBegin),
+        (unsigned long long)(skippedEnd - skippedBegin));
+    printf("  rx queue:     high water %llu of %llu bytes, %llu overflows (%llu bytes dropped)\n",
+        (unsigned long long)rxQueue.high_water_bytes, (unsigned long long)rxQueue.capacity,
+        (unsigned long long)rxQueue.overflow_count, (unsigned long long)rxQueue.overflow_bytes);
+
+    if (hasThreadCpu) {
+        printf("  cpu:\n");
+        for (size_t pos = 0; pos < cpuEnd.size(); ++pos) {
+            double begin = 0;
+            for (size_t prev = 0; prev < cpuBegin.size(); ++prev) {
+                if (cpuBegin[prev].tid == cpuEnd[pos].tid) begin = cpuBegin[prev].cpu_s;
+            }
+            printf("    %-16s %5.1f%%\n", cpuEnd[pos].name.c_str(), (cpuEnd[pos].cpu_s - begin) * 100.0 / elapsed);
+        }
+    } else {
+        printf("  cpu:          the per thread time is only reported on Linux\n");
+    }
+
+    // only compiled in with SL_LIDAR_LATENCY_PROFILING
+    for (int stage = 0; stage < LIDAR_LATENCY_STAGE_COUNT; ++stage) {
+        LidarLatencyStats stats;
+        if (SL_IS_FAIL(drv->getLatencyStats((LidarLatencyStage)stage, stats))) break;
+        if (stage == 0) printf("  sdk stages:\n");
+        printf("    %-16s p50 %llu us, p99 %llu us, max %llu us\n", stageNames[stage],
+            (unsigned long long)stats.p50_uS, (unsigned long long)stats.p99_uS, (unsigned long long)stats.max_uS);
+    }
+
+    return scans != 0;
+}
+
 int main(int argc, const char * argv[]) {
 	const char *opt_channel = NULL;
     const char *opt_channel_param_first = NULL;
@@ -149,8 +329,26 @@ int main(int argc, const char * argv[]) {
 	int         opt_channel_type = CHANNEL_TYPE_SERIALPORT;
 
     IChannel* _channel;
+    int         opt_bench_seconds = 0;
+
+    // take the options out, so that the positional arguments keep their place
+    int positional = 1;
+    for (int pos = 1; pos < argc; ++pos) {
+        if (strcmp(argv[pos], "--bench") == 0) {
+            opt_bench_seconds = DEFAULT_BENCH_SECONDS;
+        } else if (strncmp(argv[pos], "--bench=", 8) == 0) {
+            opt_bench_seconds = atoi(argv[pos] + 8);
+            if (opt_bench_seconds <= 0) {
+                print_usage(argc, argv);
+                return -1;
+            }
+        } else {
+            argv[positional++] = argv[pos];
+        }
+    }
+    argc = positional;
 
-    if (argc < 5) {
+    if (argc < 4 || (argc < 5 && strcmp(argv[2], "--replay") != 0)) {
         print_usage(argc, argv);
         return -1;
     }
@@ -170,6 +368,11 @@ int main(int argc, const char * argv[]) {
 			if (argc>4) opt_channel_param_second = strtoul(argv[4], NULL, 10);
 			opt_channel_type = CHANNEL_TYPE_UDP;
 		}
+		else if(strcmp(opt_channel, "--replay")==0)
+		{
+			opt_channel_param_first = argv[3];
+			opt_channel_type = CHANNEL_TYPE_REPLAY;
+		}
 		else
 		{
 			print_usage(argc, argv);
@@ -200,6 +403,9 @@ int main(int argc, const char * argv[]) {
         else if (opt_channel_type == CHANNEL_TYPE_UDP) {
             _channel = *createUdpChannel(opt_channel_param_first, opt_channel_param_second);
         }
+        else if (opt_channel_type == CHANNEL_TYPE_REPLAY) {
+            _channel = *createReplayChannel(opt_channel_param_first);
+        }
         
         if (SL_IS_FAIL((drv)->connect(_channel))) {
 			switch (opt_channel_type) {	
@@ -211,6 +417,10 @@ int main(int argc, const char * argv[]) {
 					fprintf(stderr, "Error, cannot connect to the ip addr %s with the udp port %u.\n"
 						, opt_channel_param_first, opt_channel_param_second);
 					break;
+				case CHANNEL_TYPE_REPLAY:
+					fprintf(stderr, "Error, cannot replay the recording %s.\n"
+						, opt_channel_param_first);
+					break;
 			}
         }
 
@@ -292,6 +502,13 @@ int main(int argc, const char * argv[]) {
             break;
         }
 
+        if (opt_bench_seconds) {
+            if (!run_benchmark(drv, opt_bench_seconds)) {
+                fprintf(stderr, "Error, the benchmark received no scan.\n");
+            }
+            break;
+        }
+
 		delay(3000);
 
         if (SL_IS_FAIL(capture_and_display(drv))) {
@@ -28,6 +28,8 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <string.h>
+#include <stdarg.h>
+#include <string>
 
 #include "sl_lidar.h" 
 #include "sl_lidar_driver.h"
@@ -37,6 +39,8 @@
 
 #ifdef _WIN32
 #include <Windows.h>
+#include <io.h>
+#include <fcntl.h>
 #define delay(x)   ::Sleep(x)
 #else
 #include <unistd.h>
@@ -52,18 +56,121 @@ static inline void delay(sl_word_size_t ms){
 
 using namespace sl;
 
+enum OutputFormat {
+    OUTPUT_FORMAT_TEXT = 0,
+    OUTPUT_FORMAT_BIN,
+    OUTPUT_FORMAT_CSV,
+    OUTPUT_FORMAT_NDJSON,
+};
+
+// Each scan of --format=bin is this header followed by node_count sl_lidar_response_measurement_node_hq_t,
+// all the fields are little endian
+struct ScanStreamHeader {
+    char   magic[4];        // "SLSC"
+    sl_u16 version;
+    sl_u16 node_size;       // sizeof(sl_lidar_response_measurement_node_hq_t)
+    sl_u32 node_count;
+    sl_u32 reserved;
+    sl_u64 timestamp_uS;
+    sl_u64 sequence;
+};
+
+static const size_t OUTPUT_BUFFER_SIZE = 1024 * 1024;
+
+// the messages go to stderr when the scans are piped out of stdout in a machine format
+static FILE * info_out = stdout;
+
 void print_usage(int argc, const char * argv[])
 {
     printf("Usage:\n"
-           " For serial channel\n %s --channel --serial <com port> [baudrate]\n"
+           " For serial channel\n %s --channel --serial <com port> [baudrate] [options]\n"
            " The baudrate used by different models is as follows:\n"
            "  A1(115200),A2M7(256000),A2M8(115200),A2M12(256000),"
            "A3(256000),S1(256000),S2(1000000),S3(1000000)\n"
-		   " For udp channel\n %s --channel --udp <ipaddr> [port NO.]\n"
+		   " For udp channel\n %s --channel --udp <ipaddr> [port NO.] [options]\n"
            " The T1 default ipaddr is 192.168.11.2,and the port NO.is 8089. Please refer to the datasheet for details.\n"
+           " Options:\n"
+           "  --format=text|bin|csv|ndjson  The output of the scans, text by default\n"
+           "      bin writes each scan as a 32 bytes header (\"SLSC\", version, node size, node count,\n"
+           "      reserved, timestamp in us, sequence) followed by the raw nodes, little endian\n"
+           "  --output=<file>               Write the scans to the file instead of stdout\n"
            , argv[0], argv[0]);
 }
 
+static bool parseOutputFormat(const char * name, OutputFormat & format)
+{
+    if (strcmp(name, "text") == 0) format = OUTPUT_FORMAT_TEXT;
+    else if (strcmp(name, "bin") == 0) format = OUTPUT_FORMAT_BIN;
+    else if (strcmp(name, "csv") == 0) format = OUTPUT_FORMAT_CSV;
+    else if (strcmp(name, "ndjson") == 0) format = OUTPUT_FORMAT_NDJSON;
+    else return false;
+    return true;
+}
+
+static void appendText(std::string & out, const char * fmt, ...)
+{
+    char line[128];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len > 0) out.append(line, len < (int)sizeof(line) ? len : (int)sizeof(line) - 1);
+}
+
+// format a whole scan so that it is written by a single fwrite
+static void formatScan(OutputFormat format, const sl_lidar_response_measurement_node_hq_t * nodes, size_t count,
+                       sl_u64 timestamp_uS, sl_u64 sequence, std::string & out)
+{
+    out.clear();
+
+    switch (format) {
+    case OUTPUT_FORMAT_BIN:
+        {
+            ScanStreamHeader header;
+            memcpy(header.magic, "SLSC", 4);
+            header.version = 1;
+            header.node_size = sizeof(sl_lidar_response_measurement_node_hq_t);
+            header.node_count = (sl_u32)count;
+            header.reserved = 0;
+            header.timestamp_uS = timestamp_uS;
+            header.sequence = sequence;
+            out.append((const char *)&header, sizeof(header));
+            out.append((const char *)nodes, count * sizeof(*nodes));
+        }
+        break;
+    case OUTPUT_FORMAT_CSV:
+        for (size_t pos = 0; pos < count; ++pos) {
+            appendText(out, "%llu,%llu,%.2f,%.2f,%d,%d\n",
+                (unsigned long long)sequence, (unsigned long long)timestamp_uS,
+                (nodes[pos].angle_z_q14 * 90.f) / 16384.f,
+                nodes[pos].dist_mm_q2/4.0f,
+                nodes[pos].quality >> SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT,
+                (nodes[pos].flag & SL_LIDAR_RESP_HQ_FLAG_SYNCBIT) ? 1 : 0);
+        }
+        break;
+    case OUTPUT_FORMAT_NDJSON:
+        appendText(out, "{\"sequence\":%llu,\"timestamp_us\":%llu,\"nodes\":[",
+            (unsigned long long)sequence, (unsigned long long)timestamp_uS);
+        for (size_t pos = 0; pos < count; ++pos) {
+            appendText(out, "%s[%.2f,%.2f,%d]", pos ? "," : "",
+                (nodes[pos].angle_z_q14 * 90.f) / 16384.f,
+                nodes[pos].dist_mm_q2/4.0f,
+                nodes[pos].quality >> SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT);
+        }
+        out.append("]}\n");
+        break;
+    default:
+        for (size_t pos = 0; pos < count; ++pos) {
+            appendText(out, "%s theta: %03.2f Dist: %08.2f Q: %d \n",
+                (nodes[pos].flag & SL_LIDAR_RESP_HQ_FLAG_SYNCBIT) ?"S ":"  ",
+                (nodes[pos].angle_z_q14 * 90.f) / 16384.f,
+                nodes[pos].dist_mm_q2/4.0f,
+                nodes[pos].quality >> SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT);
+        }
+        break;
+    }
+}
+
 bool checkSLAMTECLIDARHealth(ILidarDriver * drv)
 {
     sl_result     op_result;
@@ -71,7 +178,7 @@ bool checkSLAMTECLIDARHealth(ILidarDriver * drv)
 
     op_result = drv->getHealth(healthinfo);
     if (SL_IS_OK(op_result)) { // the macro IS_OK is the preperred way to judge whether the operation is succeed.
-        printf("SLAMTEC Lidar health status : %d\n", healthinfo.status);
+        fprintf(info_out, "SLAMTEC Lidar health status : %d\n", healthinfo.status);
         if (healthinfo.status == SL_LIDAR_STATUS_ERROR) {
             fprintf(stderr, "Error, slamtec lidar internal error detected. Please reboot the device to retry.\n");
             // enable the following code if you want slamtec lidar to be reboot by software
@@ -106,7 +213,50 @@ int main(int argc, const char * argv[]) {
 
     IChannel* _channel;
 
-    printf("Ultra simple LIDAR data grabber for SLAMTEC LIDAR.\n"
+    OutputFormat opt_format = OUTPUT_FORMAT_TEXT;
+    const char * opt_output = NULL;
+    FILE * scan_out = stdout;
+    std::string scan_buffer;
+    sl_u64 scans_written = 0;
+    sl_u64 scans_missed = 0;
+    sl_u64 last_sequence = 0;
+
+    // take the options out, so that the positional arguments keep their place
+    int positional = 1;
+    for (int pos = 1; pos < argc; ++pos) {
+        if (strncmp(argv[pos], "--format=", 9) == 0) {
+            if (!parseOutputFormat(argv[pos] + 9, opt_format)) {
+                print_usage(argc, argv);
+                return -1;
+            }
+        } else if (strncmp(argv[pos], "--output=", 9) == 0) {
+            opt_output = argv[pos] + 9;
+        } else {
+            argv[positional++] = argv[pos];
+        }
+    }
+    argc = positional;
+
+    if (opt_output) {
+        scan_out = fopen(opt_output, opt_format == OUTPUT_FORMAT_BIN ? "wb" : "w");
+        if (!scan_out) {
+            fprintf(stderr, "Error, cannot create the output file %s.\n", opt_output);
+            return -1;
+        }
+    } else if (opt_format != OUTPUT_FORMAT_TEXT) {
+        info_out = stderr;
+#ifdef _WIN32
+        if (opt_format == OUTPUT_FORMAT_BIN) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    }
+    // a whole scan is written at once, let the stdio buffer hold many of them
+    setvbuf(scan_out, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+#ifndef _WIN32
+    // a closed pipe fails the fwrite instead of killing the process
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    fprintf(info_out, "Ultra simple LIDAR data grabber for SLAMTEC LIDAR.\n"
            "Version: %s\n", SL_LIDAR_SDK_VERSION);
 
 	 
@@ -193,23 +343,22 @@ int main(int argc, const char * argv[]) {
         }
         else{
             size_t baudRateArraySize = (sizeof(baudrateArray))/ (sizeof(baudrateArray[0]));
-			for(size_t i = 0; i < baudRateArraySize; ++i)
-			{
-				_channel = (*createSerialPortChannel(opt_channel_param_first, baudrateArray[i]));
+            sl_u32 baudrateDetected;
+            if (SL_IS_OK(drv->autodetectSerialBaudRate(opt_channel_param_first, baudrateArray, baudRateArraySize, baudrateDetected))) {
+                _channel = (*createSerialPortChannel(opt_channel_param_first, baudrateDetected));
                 if (SL_IS_OK((drv)->connect(_channel))) {
                     op_result = drv->getDeviceInfo(devinfo);
 
                     if (SL_IS_OK(op_result)) 
                     {
 	                    connectSuccess = true;
-                        break;
                     }
                     else{
                         delete drv;
 					    drv = NULL;
                     }
                 }
-			}
+            }
         }
     }
     else if(opt_channel_type == CHANNEL_TYPE_UDP){
@@ -239,12 +388,12 @@ int main(int argc, const char * argv[]) {
     }
 
     // print out the device serial number, firmware and hardware version number..
-    printf("SLAMTEC LIDAR S/N: ");
+    fprintf(info_out, "SLAMTEC LIDAR S/N: ");
     for (int pos = 0; pos < 16 ;++pos) {
-        printf("%02X", devinfo.serialnum[pos]);
+        fprintf(info_out, "%02X", devinfo.serialnum[pos]);
     }
 
-    printf("\n"
+    fprintf(info_out, "\n"
             "Firmware Ver: %d.%02d\n"
             "Hardware Rev: %d\n"
             , devinfo.firmware_version>>8
@@ -262,31 +411,47 @@ int main(int argc, const char * argv[]) {
     
 	if(opt_channel_type == CHANNEL_TYPE_SERIALPORT)
         drv->setMotorSpeed();
+    // the scans are ascended by the driver as they are completed
+    drv->setScanAscending(true);
     // start scan...
     drv->startScan(0,1);
 
+    if (opt_format == OUTPUT_FORMAT_CSV) {
+        fprintf(scan_out, "sequence,timestamp_us,angle_deg,dist_mm,quality,sync\n");
+    }
+
     // fetech result and print it out...
     while (1) {
-        sl_lidar_response_measurement_node_hq_t nodes[8192];
-        size_t   count = _countof(nodes);
+        static sl_lidar_response_measurement_node_hq_t nodes[8192];
+        LidarScanLease scan;
 
-        op_result = drv->grabScanDataHq(nodes, count);
+        op_result = drv->grabScanDataHqLease(scan);
 
         if (SL_IS_OK(op_result)) {
-            drv->ascendScanData(nodes, count);
-            for (int pos = 0; pos < (int)count ; ++pos) {
-                printf("%s theta: %03.2f Dist: %08.2f Q: %d \n", 
-                    (nodes[pos].flag & SL_LIDAR_RESP_HQ_FLAG_SYNCBIT) ?"S ":"  ", 
-                    (nodes[pos].angle_z_q14 * 90.f) / 16384.f,
-                    nodes[pos].dist_mm_q2/4.0f,
-                    nodes[pos].quality >> SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT);
+            size_t count = scan->count < (size_t)_countof(nodes) ? scan->count : _countof(nodes);
+            memcpy(nodes, scan->nodes, count * sizeof(nodes[0]));
+            if (!scan->ascended) drv->ascendScanData(nodes, count);
+
+            if (scans_written && scan->sequence > last_sequence + 1) {
+                scans_missed += scan->sequence - last_sequence - 1;
+            }
+            last_sequence = scan->sequence;
+
+            formatScan(opt_format, nodes, count, scan->timestamp_uS, scan->sequence, scan_buffer);
+            if (fwrite(scan_buffer.data(), 1, scan_buffer.size(), scan_out) != scan_buffer.size()) {
+                fprintf(stderr, "Error, cannot write the scan data.\n");
+                break;
             }
+            ++scans_written;
         }
 
         if (ctrl_c_pressed){ 
             break;
         }
     }
+    fflush(scan_out);
+    fprintf(info_out, "%llu scans written, %llu scans missed\n",
+        (unsigned long long)scans_written, (unsigned long long)scans_missed);
 
     drv->stop();
 	delay(200);
@@ -298,6 +463,9 @@ on_finished:
         delete drv;
         drv = NULL;
     }
+    if (scan_out != stdout) {
+        fclose(scan_out);
+    }
     return 0;
 }
 
@@ -0,0 +1,3761 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+// Decode throughput benchmarks of the protocol codec, the sample data unpackers
+// and the scan assembly path, and of the whole driver against a simulated device.
+// The driver/legacy cases run the same through the RPlidarDriver wrapper, with the legacy nodes drained as well.
+// The driver/noalloc cases count the heap allocations of the streaming driver as errors,
+// and the process exits with 1 when any case reports an error.
+//
+// The byte streams are synthesized for each registered sample answer type, or
+// loaded from a raw capture file of the wire data via -s.
+// Use --json to get a machine readable report that can be compared between releases.
+
+#include "sdkcommon.h"
+#include "hal/abs_rxtx.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "hal/assert.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "hal/notifier.h"
+#include "hal/byteorder.h"
+#include "hal/cpu_features.h"
+#include "hal/socket.h"
+#include "sl_lidar.h"
+#include "rplidar_driver.h"
+#include "sl_crc.h"
+
+#include "dataunpacker/dataunpacker.h"
+#include "dataunpacker/dataunnpacker_commondef.h"
+#include "dataunpacker/dataunnpacker_internal.h"
+#include "dataunpacker/unpacker/handler_capsules.h"
+#include "dataunpacker/unpacker/handler_hqnode.h"
+#include "dataunpacker/unpacker/handler_normalnode.h"
+#include "dataunpacker/dataunpacker_static.h"
+#include "sl_async_transceiver.h"
+#include "sl_lidarprotocol_codec.h"
+#include "sl_lidar_scan_holder.h"
+#include "sl_channel_recorder.h"
+#include "sl_lidar_scan_log_codec.h"
+#include "sl_lidar_scan_shm.h"
+#include "sl_lidar_fixed.h"
+#include "sl_lidar_batch_decode.h"
+#include "sl_lidar_occupancy_grid.h"
+#include "sl_lidar_group.h"
+#include "sl_lidar_metrics.h"
+#include "sl_lidar_share.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <atomic>
+#include <new>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <dirent.h>
+#endif
+
+using namespace sl;
+using namespace sl::internal;
+
+static const size_t SAMPLES_PER_REVOLUTION = 3200;
+static const size_t REVOLUTIONS_PER_STREAM = 8;
+
+struct BenchOptions {
+    _u64        minDuration_uS;
+    size_t      chunkSize;
+    bool        jsonOutput;
+    const char* filter;
+    const char* streamFile;
+};
+
+struct BenchResult {
+    std::string name;
+    _u64        iterations;
+    _u64        bytes;
+    _u64        nodes;
+    _u64        errors;
+    _u64        elapsed_uS;
+};
+
+static std::vector<BenchResult> g_results;
+
+// all the heap allocations of the process are counted while g_countAllocations is set
+static std::atomic<bool> g_countAllocations(false);
+static std::atomic<_u64> g_allocationCount(0);
+
+void* operator new(size_t size)
+{
+    if (g_countAllocations.load(std::memory_order_relaxed)) {
+        g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+
+// deterministic pseudo random source, the streams must be identical between runs
+class StreamRandom
+{
+public:
+    StreamRandom() : _state(0x12345678) {}
+
+    _u32 next()
+    {
+        _state = _state * 1664525 + 1013904223;
+        return _state >> 8;
+    }
+
+    // distance in mm with about 5% of the samples being invalid
+    _u32 nextDistance()
+    {
+        _u32 v = next();
+        if ((v % 100) < 5) return 0;
+        return 150 + (v % 12000);
+    }
+
+private:
+    _u32 _state;
+};
+
+struct SampleStreamDesc {
+    _u8         ansType;
+    const char* name;
+    size_t      packetSize;
+    size_t      samplesPerPacket;
+};
+
+static const SampleStreamDesc g_sampleStreams[] = {
+    { SL_LIDAR_ANS_TYPE_MEASUREMENT,                      "normal",       sizeof(sl_lidar_response_measurement_node_t), 1 },
+    { SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ,                   "hq",           sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t), 96 },
+    { SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED,             "capsule",      sizeof(sl_lidar_response_capsule_measurement_nodes_t), 32 },
+    { SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA,       "ultra_capsule", sizeof(sl_lidar_response_ultra_capsule_measurement_nodes_t), 96 },
+    { SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED,       "dense_capsule", sizeof(sl_lidar_response_dense_capsule_measurement_nodes_t), 40 },
+    { SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED, "ultra_dense_capsule", sizeof(sl_lidar_response_ultra_dense_capsule_measurement_nodes_t), 64 },
+};
+
+static void _sealExpressCapsule(_u8* packet, size_t size)
+{
+    // the checksum covers everything after the two sync/checksum bytes
+    _u8 checksum = 0;
+    for (size_t pos = 2; pos < size; ++pos) {
+        checksum ^= packet[pos];
+    }
+    packet[0] = (_u8)((SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_1 << 4) | (checksum & 0xF));
+    packet[1] = (_u8)((SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_2 << 4) | (checksum >> 4));
+}
+
+// the sync bit is left cleared: the stream is replayed in a loop and a sync bit on its first
+// capsule would be reported as an encoder reset on every pass
+static _u16 _startAngleSync(size_t sampleIdx)
+{
+    _u16 angle_q6 = (_u16)(((sampleIdx % SAMPLES_PER_REVOLUTION) * (360 << 6)) / SAMPLES_PER_REVOLUTION);
+    return cpu_to_le16(angle_q6);
+}
+
+static void _synthesizePacket(const SampleStreamDesc& desc, size_t packetIdx, StreamRandom& rand, _u8* packet)
+{
+    size_t firstSample = packetIdx * desc.samplesPerPacket;
+    memset(packet, 0, desc.packetSize);
+
+    switch (desc.ansType) {
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT:
+    {
+        sl_lidar_response_measurement_node_t node;
+        bool syncBit = (firstSample % SAMPLES_PER_REVOLUTION) == 0;
+        _u16 angle_q6 = (_u16)(((firstSample % SAMPLES_PER_REVOLUTION) * (360 << 6)) / SAMPLES_PER_REVOLUTION);
+        _u32 dist = rand.nextDistance();
+
+        node.sync_quality = (_u8)((syncBit ? 0x1 : 0x2) | ((dist ? 47 : 0) << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT));
+        node.angle_q6_checkbit = cpu_to_le16((_u16)((angle_q6 << SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) | SL_LIDAR_RESP_MEASUREMENT_CHECKBIT));
+        node.distance_q2 = cpu_to_le16((_u16)(dist << 2));
+        memcpy(packet, &node, sizeof(node));
+    }
+    break;
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ:
+    {
+        sl_lidar_response_hq_capsule_measurement_nodes_t capsule;
+        capsule.sync_byte = SL_LIDAR_RESP_MEASUREMENT_HQ_SYNC;
+        capsule.time_stamp = cpu_to_le64((_u64)packetIdx * 1000);
+        for (size_t pos = 0; pos < _countof(capsule.node_hq); ++pos) {
+            size_t sampleIdx = (firstSample + pos) % SAMPLES_PER_REVOLUTION;
+            _u32 dist = rand.nextDistance();
+            capsule.node_hq[pos].angle_z_q14 = cpu_to_le16((_u16)((sampleIdx << 14) / SAMPLES_PER_REVOLUTION));
+            capsule.node_hq[pos].dist_mm_q2 = cpu_to_le32(dist << 2);
+            capsule.node_hq[pos].quality = dist ? (47 << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
+            capsule.node_hq[pos].flag = (sampleIdx == 0) ? SL_LIDAR_RESP_HQ_FLAG_SYNCBIT : 0;
+        }
+        capsule.crc32 = 0;
+        memcpy(packet, &capsule, sizeof(capsule));
+        _u32 crc = crc32::getResult(packet, (_u32)(sizeof(capsule) - 4));
+        crc = cpu_to_le32(crc);
+        memcpy(packet + sizeof(capsule) - 4, &crc, 4);
+    }
+    break;
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED:
+    {
+        sl_lidar_response_capsule_measurement_nodes_t capsule;
+        memset(&capsule, 0, sizeof(capsule));
+        capsule.start_angle_sync_q6 = _startAngleSync(firstSample);
+        for (size_t pos = 0; pos < _countof(capsule.cabins); ++pos) {
+            capsule.cabins[pos].distance_angle_1 = cpu_to_le16((_u16)((rand.nextDistance() << 2) & 0xFFFC));
+            capsule.cabins[pos].distance_angle_2 = cpu_to_le16((_u16)((rand.nextDistance() << 2) & 0xFFFC));
+            capsule.cabins[pos].offset_angles_q3 = (_u8)(rand.next() & 0x77);
+        }
+        memcpy(packet, &capsule, sizeof(capsule));
+        _sealExpressCapsule(packet, sizeof(capsule));
+    }
+    break;
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA:
+    {
+        sl_lidar_response_ultra_capsule_measurement_nodes_t capsule;
+        memset(&capsule, 0, sizeof(capsule));
+        capsule.start_angle_sync_q6 = _startAngleSync(firstSample);
+        for (size_t pos = 0; pos < _countof(capsule.ultra_cabins); ++pos) {
+            // major distance with small positive predicts
+            _u32 major = rand.nextDistance() & 0xFFF;
+            _u32 predict1 = rand.next() & 0x3F;
+            _u32 predict2 = rand.next() & 0x3F;
+            capsule.ultra_cabins[pos].combined_x3 = cpu_to_le32(major | (predict1 << 12) | (predict2 << 22));
+        }
+        memcpy(packet, &capsule, sizeof(capsule));
+        _sealExpressCapsule(packet, sizeof(capsule));
+    }
+    break;
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED:
+    {
+        sl_lidar_response_dense_capsule_measurement_nodes_t capsule;
+        memset(&capsule, 0, sizeof(capsule));
+        capsule.start_angle_sync_q6 = _startAngleSync(firstSample);
+        for (size_t pos = 0; pos < _countof(capsule.cabins); ++pos) {
+            capsule.cabins[pos].distance = cpu_to_le16((_u16)rand.nextDistance());
+        }
+        memcpy(packet, &capsule, sizeof(capsule));
+        _sealExpressCapsule(packet, sizeof(capsule));
+    }
+    break;
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED:
+    {
+        sl_lidar_response_ultra_dense_capsule_measurement_nodes_t capsule;
+        memset(&capsule, 0, sizeof(capsule));
+        capsule.time_stamp = cpu_to_le32((_u32)packetIdx * 1000);
+        capsule.start_angle_sync_q6 = _startAngleSync(firstSample);
+        for (size_t pos = 0; pos < _countof(capsule.cabins); ++pos) {
+            capsule.cabins[pos].qualityl_distance_scale[0] = cpu_to_le16((_u16)rand.nextDistance());
+            capsule.cabins[pos].qualityl_distance_scale[1] = cpu_to_le16((_u16)rand.nextDistance());
+            capsule.cabins[pos].qualityh_array = (_u8)rand.next();
+        }
+        memcpy(packet, &capsule, sizeof(capsule));
+        _sealExpressCapsule(packet, sizeof(capsule));
+    }
+    break;
+    }
+}
+
+// returns the concatenated payloads of all the packets in the stream
+static void _synthesizeSampleStream(const SampleStreamDesc& desc, std::vector<_u8>& payload)
+{
+    size_t packetCount = (SAMPLES_PER_REVOLUTION * REVOLUTIONS_PER_STREAM) / desc.samplesPerPacket;
+    StreamRandom rand;
+
+    payload.resize(packetCount * desc.packetSize);
+    for (size_t pos = 0; pos < packetCount; ++pos) {
+        _synthesizePacket(desc, pos, rand, &payload[pos * desc.packetSize]);
+    }
+}
+
+// the answer header that switches the codec into the loop mode of the given type
+static void _makeLoopModeHeader(_u8 ansType, size_t packetSize, std::vector<_u8>& header)
+{
+    _u32 sizeFlag = cpu_to_le32((_u32)(packetSize & SL_LIDAR_ANS_HEADER_SIZE_MASK)
+        | ((_u32)SL_LIDAR_ANS_PKTFLAG_LOOP << SL_LIDAR_ANS_HEADER_SUBTYPE_SHIFT));
+
+    header.clear();
+    header.push_back(SL_LIDAR_ANS_SYNC_BYTE1);
+    header.push_back(SL_LIDAR_ANS_SYNC_BYTE2);
+    header.insert(header.end(), reinterpret_cast<_u8*>(&sizeFlag), reinterpret_cast<_u8*>(&sizeFlag) + 4);
+    header.push_back(ansType);
+}
+
+
+class CountingSampleListener : public LIDARSampleDataListener
+{
+public:
+    CountingSampleListener() : nodeCount(0), errorCount(0) {}
+
+    virtual void onHQNodeScanResetReq() {}
+
+    virtual void onHQNodeDecoded(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node)
+    {
+        ++nodeCount;
+    }
+
+    virtual void onHQNodesDecoded(const rplidar_response_measurement_node_hq_t* nodes, const _u64* timestamps_uS, size_t count)
+    {
+        nodeCount += count;
+    }
+
+    virtual void onDecodingError(int errMsg, _u8 ansType, const void* payload, size_t size)
+    {
+        ++errorCount;
+    }
+
+    _u64 nodeCount;
+    _u64 errorCount;
+};
+
+// keeps the decoded nodes to compare the output of two unpackers
+class RecordingSampleListener : public LIDARSampleDataListener
+{
+public:
+    virtual void onHQNodeScanResetReq() {}
+
+    virtual void onHQNodeDecoded(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node)
+    {
+        nodes.push_back(*node);
+    }
+
+    virtual void onHQNodesDecoded(const rplidar_response_measurement_node_hq_t* nodes, const _u64* timestamps_uS, size_t count)
+    {
+        this->nodes.insert(this->nodes.end(), nodes, nodes + count);
+    }
+
+    std::vector<rplidar_response_measurement_node_hq_t> nodes;
+};
+
+// mirrors the way the driver dispatches the decoded messages
+class UnpackerForwarder : public IProtocolMessageListener
+{
+public:
+    UnpackerForwarder(LIDARSampleDataUnpacker* unpacker)
+        : messageCount(0)
+        , _unpacker(unpacker)
+    {
+    }
+
+    virtual void onProtocolMessageDecoded(const ProtocolMessage& msg)
+    {
+        ++messageCount;
+        if (_unpacker) {
+            _unpacker->onSampleData(msg.cmd, msg.getDataBuf(), msg.getPayloadSize());
+        }
+    }
+
+    _u64 messageCount;
+
+private:
+    LIDARSampleDataUnpacker* _unpacker;
+};
+
+
+static void _setupUnpacker(LIDARSampleDataUnpacker& unpacker)
+{
+    // the timing of a typical 8K sample/s device over a 1M bps UART link
+    SlamtecLidarTimingDesc timing;
+    memset(&timing, 0, sizeof(timing));
+    timing.sample_duration_uS = 125;
+    timing.native_baudrate = 1000000;
+    timing.native_interface_type = LIDAR_INTERFACE_UART;
+    unpacker.updateUnpackerContext(LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_LIDAR_TIMING, &timing, sizeof(timing));
+    unpacker.enable();
+}
+
+static LIDARSampleDataUnpacker* _createUnpacker(LIDARSampleDataListener& listener)
+{
+    LIDARSampleDataUnpacker* unpacker = LIDARSampleDataUnpacker::CreateInstance(listener);
+    if (!unpacker) return NULL;
+
+    _setupUnpacker(*unpacker);
+    return unpacker;
+}
+
+// the formats left out of the build by UNPACKER_HANDLERS are not benchmarked, and the driver of a build with
+// SL_LIDAR_STATIC_UNPACKER_HANDLER decodes the format of that handler only
+static bool _isSampleTypeCompiled(_u8 ansType)
+{
+#if defined(SL_LIDAR_STATIC_UNPACKER_HANDLER)
+    unpacker::SL_LIDAR_STATIC_UNPACKER_HANDLER staticHandler;
+    if (ansType != staticHandler.getSampleAnswerType()) return false;
+#endif
+
+    CountingSampleListener listener;
+    LIDARSampleDataUnpacker* unpacker = LIDARSampleDataUnpacker::CreateInstance(listener);
+    if (!unpacker) return false;
+
+    LidarSampleDecodeStats stats[LIDAR_DECODE_STATS_MAX_SAMPLE_TYPES];
+    size_t count = unpacker->getDecodeStats(stats, _countof(stats));
+    LIDARSampleDataUnpacker::ReleaseInstance(unpacker);
+    for (size_t pos = 0; pos < count; ++pos) {
+        if (stats[pos].ans_type == ansType) return true;
+    }
+    return false;
+}
+
+static bool _isSelected(const BenchOptions& opt, const std::string& name)
+{
+    return !opt.filter || name.find(opt.filter) != std::string::npos;
+}
+
+static void _report(const BenchOptions& opt, const BenchResult& result)
+{
+    g_results.push_back(result);
+    if (opt.jsonOutput) return;
+
+    double seconds = result.elapsed_uS / 1e6;
+    printf("%-36s %10llu iters %10.2f MB/s %12.0f nodes/s %8llu errors\n"
+        , result.name.c_str()
+        , (unsigned long long)result.iterations
+        , seconds > 0 ? result.bytes / seconds / 1e6 : 0.0
+        , seconds > 0 ? result.nodes / seconds : 0.0
+        , (unsigned long long)result.errors);
+}
+
+static void _printJsonReport()
+{
+    printf("{\"sdk_version\":\"%s\",\"results\":[", SL_LIDAR_SDK_VERSION);
+    for (size_t pos = 0; pos < g_results.size(); ++pos) {
+        const BenchResult& r = g_results[pos];
+        double seconds = r.elapsed_uS / 1e6;
+        printf("%s\n{\"name\":\"%s\",\"iterations\":%llu,\"bytes\":%llu,\"nodes\":%llu,\"errors\":%llu,\"elapsed_us\":%llu,\"bytes_per_s\":%.0f,\"nodes_per_s\":%.0f}"
+            , pos ? "," : ""
+            , r.name.c_str()
+            , (unsigned long long)r.iterations
+            , (unsigned long long)r.bytes
+            , (unsigned long long)r.nodes
+            , (unsigned long long)r.errors
+            , (unsigned long long)r.elapsed_uS
+            , seconds > 0 ? r.bytes / seconds : 0.0
+            , seconds > 0 ? r.nodes / seconds : 0.0);
+    }
+    printf("\n]}\n");
+}
+
+
+static void _feedInChunks(RPLidarProtocolCodec& codec, const std::vector<_u8>& data, size_t chunkSize)
+{
+    for (size_t pos = 0; pos < data.size(); pos += chunkSize) {
+        codec.onDecodeData(&data[pos], std::min(chunkSize, data.size() - pos));
+    }
+}
+
+static void _benchUnpacker(const BenchOptions& opt, const SampleStreamDesc& desc, const std::vector<_u8>& payload)
+{
+    std::string name = std::string("unpacker/") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    CountingSampleListener listener;
+    LIDARSampleDataUnpacker* unpacker = _createUnpacker(listener);
+    if (!unpacker) return;
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    do {
+        for (size_t pos = 0; pos < payload.size(); pos += desc.packetSize) {
+            unpacker->onSampleData(desc.ansType, &payload[pos], desc.packetSize);
+        }
+        result.bytes += payload.size();
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    result.nodes = listener.nodeCount;
+    result.errors = listener.errorCount;
+    LIDARSampleDataUnpacker::ReleaseInstance(unpacker);
+    _report(opt, result);
+}
+
+template <class THandler>
+static void _benchStaticUnpacker(const BenchOptions& opt, const SampleStreamDesc& desc, const std::vector<_u8>& payload)
+{
+    typedef StaticSampleDataUnpacker<THandler, CountingSampleListener> static_unpacker_t;
+
+    std::string name = std::string("static_unpacker/") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+
+    // one pass of both unpackers, any difference of the decoded nodes counts as an error
+    RecordingSampleListener refListener, staticListener;
+    LIDARSampleDataUnpacker* refUnpacker = _createUnpacker(refListener);
+    if (!refUnpacker) return;
+    StaticSampleDataUnpacker<THandler, RecordingSampleListener> checkUnpacker(staticListener);
+    _setupUnpacker(checkUnpacker);
+    for (size_t pos = 0; pos < payload.size(); pos += desc.packetSize) {
+        refUnpacker->onSampleData(desc.ansType, &payload[pos], desc.packetSize);
+        checkUnpacker.onSampleData(desc.ansType, &payload[pos], desc.packetSize);
+    }
+    LIDARSampleDataUnpacker::ReleaseInstance(refUnpacker);
+    if (refListener.nodes.size() != staticListener.nodes.size()
+        || (refListener.nodes.size() && memcmp(&refListener.nodes[0], &staticListener.nodes[0], refListener.nodes.size() * sizeof(refListener.nodes[0])))) {
+        ++result.errors;
+    }
+
+    CountingSampleListener listener;
+    static_unpacker_t unpacker(listener);
+    _setupUnpacker(unpacker);
+
+    _u64 startTs = getus();
+    do {
+        for (size_t pos = 0; pos < payload.size(); pos += desc.packetSize) {
+            unpacker.onSampleData(desc.ansType, &payload[pos], desc.packetSize);
+        }
+        result.bytes += payload.size();
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    result.nodes = listener.nodeCount;
+    result.errors += listener.errorCount;
+    _report(opt, result);
+}
+
+static void _benchStaticUnpacker(const BenchOptions& opt, const SampleStreamDesc& desc, const std::vector<_u8>& payload)
+{
+    switch (desc.ansType) {
+#if SL_LIDAR_UNPACKER_WITH_NORMALNODE
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT:
+        _benchStaticUnpacker<internal::unpacker::UnpackerHandler_NormalNode>(opt, desc, payload);
+        break;
+#endif
+#if SL_LIDAR_UNPACKER_WITH_HQNODE
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ:
+        _benchStaticUnpacker<internal::unpacker::UnpackerHandler_HQNode>(opt, desc, payload);
+        break;
+#endif
+#if SL_LIDAR_UNPACKER_WITH_CAPSULE
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED:
+        _benchStaticUnpacker<internal::unpacker::UnpackerHandler_CapsuleNode>(opt, desc, payload);
+        break;
+#endif
+#if SL_LIDAR_UNPACKER_WITH_ULTRA_CAPSULE
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA:
+        _benchStaticUnpacker<internal::unpacker::UnpackerHandler_UltraCapsuleNode>(opt, desc, payload);
+        break;
+#endif
+#if SL_LIDAR_UNPACKER_WITH_DENSE_CAPSULE
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED:
+        _benchStaticUnpacker<internal::unpacker::UnpackerHandler_DenseCapsuleNode>(opt, desc, payload);
+        break;
+#endif
+#if SL_LIDAR_UNPACKER_WITH_ULTRA_DENSE_CAPSULE
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED:
+        _benchStaticUnpacker<internal::unpacker::UnpackerHandler_UltraDenseCapsuleNode>(opt, desc, payload);
+        break;
+#endif
+    }
+}
+
+static void _benchCodec(const BenchOptions& opt, const SampleStreamDesc& desc, const std::vector<_u8>& payload, bool withUnpacker)
+{
+    std::string name = std::string(withUnpacker ? "codec+unpacker/" : "codec/") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    CountingSampleListener listener;
+    LIDARSampleDataUnpacker* unpacker = NULL;
+    if (withUnpacker) {
+        unpacker = _createUnpacker(listener);
+        if (!unpacker) return;
+    }
+
+    UnpackerForwarder forwarder(unpacker);
+    RPLidarProtocolCodec codec;
+    codec.setMessageListener(&forwarder);
+
+    std::vector<_u8> header;
+    _makeLoopModeHeader(desc.ansType, desc.packetSize, header);
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    codec.onDecodeData(&header[0], header.size());
+    do {
+        // the codec stays in the loop mode, only the payload is repeated
+        _feedInChunks(codec, payload, opt.chunkSize);
+        result.bytes += payload.size();
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    result.bytes += header.size();
+    // without the unpacker, count the nodes carried by the framed messages
+    result.nodes = withUnpacker ? listener.nodeCount : forwarder.messageCount * desc.samplesPerPacket;
+    result.errors = listener.errorCount;
+    if (unpacker) LIDARSampleDataUnpacker::ReleaseInstance(unpacker);
+    _report(opt, result);
+}
+
+// a burst of line noise holding no sync pattern, neither the answer sync byte nor the capsule sync nibble
+static void _synthesizeNoise(size_t size, std::vector<_u8>& noise)
+{
+    StreamRandom rand;
+    noise.resize(size);
+    for (size_t pos = 0; pos < size; ++pos) {
+        noise[pos] = (_u8)(rand.next() & 0x7F);
+    }
+}
+
+// the codec waiting for an answer header behind a noise burst, each iteration is the burst and one answer;
+// the answer missed counts as an error
+static void _benchCodecResync(const BenchOptions& opt)
+{
+    std::string name = "resync/codec";
+    if (!_isSelected(opt, name)) return;
+
+    const size_t noiseSize = 64 * 1024;
+    std::vector<_u8> noise;
+    _synthesizeNoise(noiseSize, noise);
+
+    sl_lidar_response_device_health_t health;
+    memset(&health, 0, sizeof(health));
+    std::vector<_u8> answer;
+    answer.push_back(SL_LIDAR_ANS_SYNC_BYTE1);
+    answer.push_back(SL_LIDAR_ANS_SYNC_BYTE2);
+    _u32 sizeFlag = cpu_to_le32((_u32)sizeof(health));
+    answer.insert(answer.end(), reinterpret_cast<_u8*>(&sizeFlag), reinterpret_cast<_u8*>(&sizeFlag) + 4);
+    answer.push_back(SL_LIDAR_ANS_TYPE_DEVHEALTH);
+    answer.insert(answer.end(), reinterpret_cast<_u8*>(&health), reinterpret_cast<_u8*>(&health) + sizeof(health));
+
+    UnpackerForwarder forwarder(NULL);
+    RPLidarProtocolCodec codec;
+    codec.setMessageListener(&forwarder);
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    do {
+        _feedInChunks(codec, noise, opt.chunkSize);
+        _feedInChunks(codec, answer, opt.chunkSize);
+        result.bytes += noise.size() + answer.size();
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    result.errors = result.iterations - forwarder.messageCount;
+    _report(opt, result);
+}
+
+// the capsule handlers hunting for their sync nibble through a noise burst framed as loop mode packets,
+// each iteration is the burst and the stream; the stream must decode as it does from a fresh start
+static void _benchUnpackerResync(const BenchOptions& opt, const SampleStreamDesc& desc, const std::vector<_u8>& payload)
+{
+    switch (desc.ansType) {
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED:
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA:
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED:
+    case SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED:
+        break;
+    default:
+        return;
+    }
+
+    std::string name = std::string("resync/") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    std::vector<_u8> noise;
+    _synthesizeNoise((64 * 1024 / desc.packetSize) * desc.packetSize, noise);
+
+    CountingSampleListener refListener;
+    LIDARSampleDataUnpacker* refUnpacker = _createUnpacker(refListener);
+    if (!refUnpacker) return;
+    for (size_t pos = 0; pos < payload.size(); pos += desc.packetSize) {
+        refUnpacker->onSampleData(desc.ansType, &payload[pos], desc.packetSize);
+    }
+    LIDARSampleDataUnpacker::ReleaseInstance(refUnpacker);
+
+    CountingSampleListener listener;
+    LIDARSampleDataUnpacker* unpacker = _createUnpacker(listener);
+    if (!unpacker) return;
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    do {
+        for (size_t pos = 0; pos < noise.size(); pos += desc.packetSize) {
+            unpacker->onSampleData(desc.ansType, &noise[pos], desc.packetSize);
+        }
+        for (size_t pos = 0; pos < payload.size(); pos += desc.packetSize) {
+            unpacker->onSampleData(desc.ansType, &payload[pos], desc.packetSize);
+        }
+        result.bytes += noise.size() + payload.size();
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    result.nodes = listener.nodeCount;
+    result.errors = listener.errorCount + refListener.errorCount
+        + (listener.nodeCount != refListener.nodeCount * result.iterations ? 1 : 0);
+    LIDARSampleDataUnpacker::ReleaseInstance(unpacker);
+    _report(opt, result);
+}
+
+static void _benchRecordedStream(const BenchOptions& opt, const std::vector<_u8>& stream)
+{
+    std::string name = std::string("stream/") + opt.streamFile;
+    if (!_isSelected(opt, name)) return;
+
+    CountingSampleListener listener;
+    LIDARSampleDataUnpacker* unpacker = _createUnpacker(listener);
+    if (!unpacker) return;
+
+    UnpackerForwarder forwarder(unpacker);
+    RPLidarProtocolCodec codec;
+    codec.setMessageListener(&forwarder);
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    do {
+        // the capture starts with the answer header, replay it from a clean state
+        codec.onDecodeReset();
+        unpacker->reset();
+        _feedInChunks(codec, stream, opt.chunkSize);
+        result.bytes += stream.size();
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    result.nodes = listener.nodeCount;
+    result.errors = listener.errorCount;
+    LIDARSampleDataUnpacker::ReleaseInstance(unpacker);
+    _report(opt, result);
+}
+
+// a full revolution in the order of arrival: starts in the middle of the scan and wraps around
+static void _synthesizeRevolution(std::vector<sl_lidar_response_measurement_node_hq_t>& nodes)
+{
+    StreamRandom rand;
+    nodes.resize(SAMPLES_PER_REVOLUTION);
+    for (size_t pos = 0; pos < nodes.size(); ++pos) {
+        size_t sampleIdx = (pos + SAMPLES_PER_REVOLUTION / 2) % SAMPLES_PER_REVOLUTION;
+        _u32 dist = rand.nextDistance();
+        nodes[pos].angle_z_q14 = (_u16)((sampleIdx << 14) / SAMPLES_PER_REVOLUTION);
+        nodes[pos].dist_mm_q2 = dist << 2;
+        nodes[pos].quality = dist ? (47 << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
+        nodes[pos].flag = pos == 0 ? SL_LIDAR_RESP_HQ_FLAG_SYNCBIT : 0;
+    }
+}
+
+static void _benchAscendScanData(const BenchOptions& opt)
+{
+    std::string name = "ascend_scan_data/hq";
+    if (!_isSelected(opt, name)) return;
+
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution, work;
+    _synthesizeRevolution(revolution);
+    work.resize(revolution.size());
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    do {
+        work = revolution;
+        ascendScanData_(&work[0], work.size());
+        result.nodes += work.size();
+        result.bytes += work.size() * sizeof(work[0]);
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    _report(opt, result);
+}
+
+static void _benchScanDataHolder(const BenchOptions& opt, bool lease)
+{
+    std::string name = lease ? "scan_holder/push_lease" : "scan_holder/push_grab";
+    if (!_isSelected(opt, name)) return;
+
+    // the batch size of the most common capsule formats
+    const size_t batchSize = 32;
+
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution, grabbed;
+    std::vector<_u64> timestamps(batchSize, 0);
+    _synthesizeRevolution(revolution);
+
+    ScanDataHolder<sl_lidar_response_measurement_node_hq_t> holder;
+    grabbed.resize(holder.getMaxCacheCount());
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    do {
+        for (size_t pos = 0; pos < revolution.size(); pos += batchSize) {
+            holder.pushScanNodesData(&timestamps[0], &revolution[pos], std::min(batchSize, revolution.size() - pos));
+        }
+
+        // the previous revolution is published once the sync node of this one arrives
+        if (lease) {
+            LidarScanLease scan = holder.waitAndLeaseNewestScan(0);
+            if (scan) {
+                result.nodes += scan->count;
+            }
+        }
+        else {
+            const ScanBuffer<sl_lidar_response_measurement_node_hq_t>* scan = holder.waitAndTakeNewestScan(0);
+            if (scan) {
+                memcpy(&grabbed[0], &scan->nodes[0], scan->nodes.size() * sizeof(grabbed[0]));
+                result.nodes += scan->nodes.size();
+            }
+        }
+        result.bytes += revolution.size() * sizeof(revolution[0]);
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    _report(opt, result);
+}
+
+// the scans ascended by the holder as they are completed, in both layouts: the nodes must be the ones of ascendScanData
+// and the timestamps, holding the position each node was sampled at, and the SoA arrays must follow them. The last
+// iterations keep the SoA layout only, which is sorted on its angles. Any scan off counts as an error.
+static void _benchAscendingHolder(const BenchOptions& opt)
+{
+    std::string name = "scan_holder/ascending";
+    if (!_isSelected(opt, name)) return;
+
+    const size_t batchSize = 32;
+    const float radPerQ14 = (float)(2 * 3.14159265358979323846 / 65536);
+
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution, expected;
+    std::vector<_u64> timestamps;
+    _synthesizeRevolution(revolution);
+    // a few samples without distance, at the start, the end and in the middle of the scan
+    revolution[0].dist_mm_q2 = revolution[1].dist_mm_q2 = revolution[revolution.size() - 1].dist_mm_q2 = 0;
+    revolution[revolution.size() / 3].dist_mm_q2 = 0;
+    for (size_t pos = 0; pos < revolution.size(); ++pos) {
+        timestamps.push_back(pos);
+    }
+    expected = revolution;
+    ascendScanData_(&expected[0], expected.size());
+
+    ScanDataHolder<sl_lidar_response_measurement_node_hq_t> holder;
+    holder.setLayout(LIDAR_SCAN_LAYOUT_AOS_SOA);
+    holder.setAscending(true);
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    bool isSoAOnly = false;
+    _u64 startTs = getus();
+    do {
+        for (size_t pos = 0; pos < revolution.size(); pos += batchSize) {
+            holder.pushScanNodesData(&timestamps[pos], &revolution[pos], std::min(batchSize, revolution.size() - pos));
+        }
+
+        LidarScanLease scan = holder.waitAndLeaseNewestScan(0);
+        if (scan) {
+            bool hasNodes = scan->nodes != NULL;
+            const LidarScanSoA& soa = scan->soa;
+            size_t count = hasNodes ? scan->count : soa.count;
+            bool isGood = scan->ascended && count == revolution.size() && (hasNodes || soa.angle_rad);
+            if (isGood && hasNodes) isGood = !memcmp(scan->nodes, &expected[0], count * sizeof(expected[0]));
+            for (size_t pos = 0; isGood && pos < count; ++pos) {
+                const sl_lidar_response_measurement_node_hq_t& sampled = revolution[(size_t)scan->timestamps_uS[pos]];
+                if (hasNodes) {
+                    isGood = sampled.dist_mm_q2 == scan->nodes[pos].dist_mm_q2 && sampled.quality == scan->nodes[pos].quality;
+                }
+                if (isGood && soa.angle_rad) {
+                    float angle = hasNodes ? scan->nodes[pos].angle_z_q14 * radPerQ14 : sampled.angle_z_q14 * radPerQ14;
+                    isGood = soa.angle_rad[pos] == angle && soa.range_m[pos] == sampled.dist_mm_q2 / 4000.f && soa.quality[pos] == sampled.quality
+                        && (!pos || soa.angle_rad[pos - 1] <= soa.angle_rad[pos]);
+                }
+            }
+            if (!isGood) ++result.errors;
+            result.nodes += count;
+        }
+        result.bytes += revolution.size() * sizeof(revolution[0]);
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+
+        if (!isSoAOnly && result.elapsed_uS >= opt.minDuration_uS * 3 / 4) {
+            holder.setLayout(LIDAR_SCAN_LAYOUT_SOA);
+            isSoAOnly = true;
+        }
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    _report(opt, result);
+}
+
+// two pollers of the newest scan since the last one each got: the fast one polls twice per revolution and must get
+// each scan on its first poll and nothing on its second, the slow one polls every third revolution and must get the same
+// scan with a step of three in the sequence. A scan got again after reset() counts as an error as well; the nodes are
+// the ones copied by the pollers.
+static void _benchScanSince(const BenchOptions& opt)
+{
+    std::string name = "scan_holder/since";
+    if (!_isSelected(opt, name)) return;
+
+    const size_t batchSize = 32;
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution, grabbed;
+    std::vector<_u64> timestamps;
+    _synthesizeRevolution(revolution);
+    timestamps.resize(revolution.size(), 0);
+    grabbed.resize(revolution.size());
+
+    ScanDataHolder<sl_lidar_response_measurement_node_hq_t> holder;
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 fastSequence = 0, slowSequence = 0;
+    _u64 startTs = getus();
+    do {
+        for (size_t pos = 0; pos < revolution.size(); pos += batchSize) {
+            holder.pushScanNodesData(&timestamps[pos], &revolution[pos], std::min(batchSize, revolution.size() - pos));
+        }
+        ++result.iterations;
+        // the first revolution is published once the sync node of the second one arrives
+        if (result.iterations == 1) continue;
+
+        const ScanBuffer<sl_lidar_response_measurement_node_hq_t>* scan = holder.takeNewestScanSince(fastSequence);
+        if (!scan || scan->view.sequence != fastSequence + 1 || scan->view.count != revolution.size()) {
+            ++result.errors;
+        }
+        else {
+            memcpy(&grabbed[0], scan->view.nodes, scan->view.count * sizeof(grabbed[0]));
+            fastSequence = scan->view.sequence;
+            result.nodes += scan->view.count;
+        }
+        if (holder.takeNewestScanSince(fastSequence)) ++result.errors;
+
+        if (result.iterations % 3 == 0) {
+            scan = holder.takeNewestScanSince(slowSequence);
+            if (!scan || scan->view.sequence != fastSequence || (slowSequence && scan->view.sequence != slowSequence + 3)) {
+                ++result.errors;
+            }
+            else {
+                memcpy(&grabbed[0], scan->view.nodes, scan->view.count * sizeof(grabbed[0]));
+                slowSequence = scan->view.sequence;
+                result.nodes += scan->view.count;
+            }
+        }
+        result.bytes += revolution.size() * sizeof(revolution[0]);
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    holder.reset();
+    if (holder.takeNewestScanSince(0)) ++result.errors;
+    _report(opt, result);
+}
+
+// the decoder and a consumer on two threads, like the driver: the decoder pushes the revolutions into the scan and the
+// raw sample holders while the consumer grabs and fetches them; the bytes and nodes are the ones pushed.
+// Build with SL_CACHE_LINE_SIZE=0 to compare against the natural layout of the holders.
+// A scan grabbed not of the revolution size counts as an error. With the block policy, a scan or a sample
+// the consumer never gets counts as an error as well.
+struct ConcurrentHolders {
+    ScanDataHolder<sl_lidar_response_measurement_node_hq_t>      scanHolder;
+    RawSampleNodeHolder<sl_lidar_response_measurement_node_hq_t> rawHolder;
+    const std::vector<sl_lidar_response_measurement_node_hq_t>*   revolution;
+    _u64                 duration_uS;
+    _u64                 pushedRevolutions;
+    std::atomic<bool>    isProducing;
+};
+
+static _word_size_t THREAD_PROC _concurrentProducerProc(void* data)
+{
+    ConcurrentHolders* holders = (ConcurrentHolders*)data;
+    const std::vector<sl_lidar_response_measurement_node_hq_t>& revolution = *holders->revolution;
+    const size_t batchSize = 32;
+    std::vector<_u64> timestamps(batchSize, 0);
+
+    _u64 startTs = getus();
+    do {
+        for (size_t pos = 0; pos < revolution.size(); pos += batchSize) {
+            size_t count = std::min(batchSize, revolution.size() - pos);
+            holders->scanHolder.pushScanNodesData(&timestamps[0], &revolution[pos], count);
+            holders->rawHolder.pushNodes(&timestamps[0], &revolution[pos], count);
+        }
+        ++holders->pushedRevolutions;
+    } while (getus() - startTs < holders->duration_uS);
+
+    holders->isProducing = false;
+    return 0;
+}
+
+static void _benchConcurrentHolders(const BenchOptions& opt, bool block)
+{
+    std::string name = block ? "scan_holder/concurrent_block" : "scan_holder/concurrent";
+    if (!_isSelected(opt, name)) return;
+
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution;
+    _synthesizeRevolution(revolution);
+
+    ConcurrentHolders holders;
+    holders.revolution = &revolution;
+    holders.duration_uS = opt.minDuration_uS;
+    holders.pushedRevolutions = 0;
+    holders.isProducing = true;
+    if (block) {
+        holders.scanHolder.setBackpressurePolicy(LIDAR_BACKPRESSURE_BLOCK, 1000);
+        holders.rawHolder.setBackpressurePolicy(LIDAR_BACKPRESSURE_BLOCK, 1000);
+    }
+
+    std::vector<sl_lidar_response_measurement_node_hq_t> fetched(256);
+    _u64 fetchedCount = 0;
+    _u64 lastSequence = 0;
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    rp::hal::Thread producer = rp::hal::Thread::create(_concurrentProducerProc, &holders);
+    while (holders.isProducing) {
+        LidarScanLease scan = holders.scanHolder.waitAndLeaseNewestScan(0);
+        if (scan) {
+            if (scan->count != revolution.size()) ++result.errors;
+            if (block && lastSequence && scan->sequence != lastSequence + 1) ++result.errors;
+            lastSequence = scan->sequence;
+            ++result.iterations;
+        }
+        size_t count;
+        while ((count = holders.rawHolder.waitAndFetch(&fetched[0], fetched.size(), 0)) != 0) {
+            fetchedCount += count;
+        }
+    }
+    producer.join();
+    result.elapsed_uS = getus() - startTs;
+
+    if (block) {
+        size_t count;
+        while ((count = holders.rawHolder.waitAndFetch(&fetched[0], fetched.size(), 0)) != 0) {
+            fetchedCount += count;
+        }
+        if (fetchedCount != holders.pushedRevolutions * revolution.size()) ++result.errors;
+    }
+
+    result.nodes = holders.pushedRevolutions * revolution.size();
+    result.bytes = result.nodes * sizeof(revolution[0]) * 2;
+    _report(opt, result);
+}
+
+// one producer and several readers of the raw sample holder, each with its cursor: every sample is numbered by its
+// position, so a reader checks it got each one once, in order, either read or counted as missed.
+// The last reader sleeps between the reads to be lapped. A span still valid with a sample out of place, or a reader whose
+// samples read and missed do not add up to the samples pushed, counts as an error; the nodes are the ones read.
+struct SampleCursorReader {
+    RawSampleNodeHolder<sl_lidar_response_measurement_node_hq_t>* holder;
+    std::atomic<bool>*   isProducing;
+    bool                 isSlow;
+    LidarSampleCursor    cursor;
+    _u64                 readCount;
+    _u64                 errors;
+};
+
+static bool _readSampleCursor(SampleCursorReader* reader)
+{
+    LidarSampleSpan span;
+    if (!reader->holder->readCursor(reader->cursor, span)) return false;
+
+    _u64 position = span.sequence;
+    bool isInOrder = true;
+    for (size_t run = 0; run < 2; ++run) {
+        for (size_t pos = 0; pos < span.counts[run]; ++pos, ++position) {
+            if (span.timestamps_uS[run][pos] != position || span.nodes[run][pos].dist_mm_q2 != (sl_u32)position) isInOrder = false;
+        }
+    }
+    if (!isInOrder && reader->holder->isSpanIntact(span)) ++reader->errors;
+    reader->readCount += span.counts[0] + span.counts[1];
+    return true;
+}
+
+static _word_size_t THREAD_PROC _sampleCursorReaderProc(void* data)
+{
+    SampleCursorReader* reader = (SampleCursorReader*)data;
+    while (*reader->isProducing) {
+        if (!_readSampleCursor(reader) || reader->isSlow) delay(1);
+    }
+    _readSampleCursor(reader);
+    return 0;
+}
+
+static void _benchSampleCursors(const BenchOptions& opt)
+{
+    std::string name = "raw_holder/cursors";
+    if (!_isSelected(opt, name)) return;
+
+    const size_t readerCount = 3;
+    const size_t batchSize = 32;
+    RawSampleNodeHolder<sl_lidar_response_measurement_node_hq_t> holder(4096);
+    std::atomic<bool> isProducing(true);
+
+    SampleCursorReader readers[readerCount];
+    rp::hal::Thread threads[readerCount];
+    for (size_t pos = 0; pos < readerCount; ++pos) {
+        readers[pos].holder = &holder;
+        readers[pos].isProducing = &isProducing;
+        readers[pos].isSlow = pos == readerCount - 1;
+        readers[pos].readCount = 0;
+        readers[pos].errors = 0;
+        holder.openCursor(readers[pos].cursor);
+    }
+    for (size_t pos = 0; pos < readerCount; ++pos) {
+        threads[pos] = rp::hal::Thread::create(_sampleCursorReaderProc, &readers[pos]);
+    }
+
+    std::vector<sl_lidar_response_measurement_node_hq_t> nodes(batchSize);
+    std::vector<_u64> timestamps(batchSize);
+    memset(&nodes[0], 0, nodes.size() * sizeof(nodes[0]));
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 pushed = 0;
+    _u64 startTs = getus();
+    do {
+        for (size_t pos = 0; pos < batchSize; ++pos, ++pushed) {
+            timestamps[pos] = pushed;
+            nodes[pos].dist_mm_q2 = (sl_u32)pushed;
+        }
+        holder.pushNodes(&timestamps[0], &nodes[0], batchSize);
+        ++result.iterations;
+    } while (getus() - startTs < opt.minDuration_uS);
+    isProducing = false;
+    for (size_t pos = 0; pos < readerCount; ++pos) {
+        threads[pos].join();
+    }
+    result.elapsed_uS = getus() - startTs;
+
+    for (size_t pos = 0; pos < readerCount; ++pos) {
+        const SampleCursorReader& reader = readers[pos];
+        result.errors += reader.errors;
+        if (reader.cursor.sequence != pushed || reader.readCount + reader.cursor.missed_count != pushed) ++result.errors;
+        result.nodes += reader.readCount;
+    }
+    // the samples of the span are read from the ring, not copied out
+    result.bytes = result.nodes * (sizeof(nodes[0]) + sizeof(_u64));
+    _report(opt, result);
+}
+
+static void _benchCartesian(const BenchOptions& opt, bool soa)
+{
+    std::string name = soa ? "cartesian/soa" : "cartesian/hq";
+    if (!_isSelected(opt, name)) return;
+
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution;
+    _synthesizeRevolution(revolution);
+
+    std::vector<float> angles(revolution.size()), ranges(revolution.size());
+    for (size_t pos = 0; pos < revolution.size(); ++pos) {
+        angles[pos] = getAngle(revolution[pos]) * (float)(3.14159265358979323846 / 180);
+        ranges[pos] = getDistanceQ2(revolution[pos]) / 4000.f;
+    }
+    LidarScanSoA scan = { &angles[0], &ranges[0], NULL, NULL, revolution.size() };
+
+    std::vector<float> x(revolution.size()), y(revolution.size());
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    do {
+        if (soa) {
+            convertScanToCartesian(scan, &x[0], &y[0]);
+        }
+        else {
+            convertScanToCartesian(&revolution[0], revolution.size(), &x[0], &y[0]);
+        }
+        result.nodes += revolution.size();
+        result.bytes += revolution.size() * (soa ? sizeof(float) * 2 : sizeof(revolution[0]));
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    _report(opt, result);
+}
+
+// the bytes are the HQ and legacy nodes read and written;
+// a legacy node not given back by a round trip counts as an error, the angle may lose a q6 step in the two roundings
+static void _benchLegacyNodes(const BenchOptions& opt, bool fromLegacy)
+{
+    std::string name = fromLegacy ? "node_convert/from_legacy" : "node_convert/to_legacy";
+    if (!_isSelected(opt, name)) return;
+
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution, converted;
+    _synthesizeRevolution(revolution);
+    converted.resize(revolution.size());
+    std::vector<sl_lidar_response_measurement_node_t> legacy(revolution.size()), roundTrip(revolution.size());
+    convertNodesToLegacy(&revolution[0], revolution.size(), &legacy[0]);
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    do {
+        if (fromLegacy) {
+            convertNodesFromLegacy(&legacy[0], legacy.size(), &converted[0]);
+        }
+        else {
+            convertNodesToLegacy(&revolution[0], revolution.size(), &roundTrip[0]);
+        }
+        result.nodes += revolution.size();
+        result.bytes += revolution.size() * (sizeof(revolution[0]) + sizeof(legacy[0]));
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    if (fromLegacy) {
+        convertNodesToLegacy(&converted[0], converted.size(), &roundTrip[0]);
+    }
+    for (size_t pos = 0; pos < legacy.size(); ++pos) {
+        int angleDiff = (legacy[pos].angle_q6_checkbit >> SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) - (roundTrip[pos].angle_q6_checkbit >> SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT);
+        if (roundTrip[pos].sync_quality != legacy[pos].sync_quality || roundTrip[pos].distance_q2 != legacy[pos].distance_q2
+            || angleDiff < 0 || angleDiff > 1) {
+            ++result.errors;
+        }
+    }
+    _report(opt, result);
+}
+
+// the conversion of a revolution moved by a constant twist, with the poses integrated for each scan like the driver does
+static void _benchDeskew(const BenchOptions& opt)
+{
+    std::string name = "cartesian/deskew";
+    if (!_isSelected(opt, name)) return;
+
+    const _u64 revolution_uS = 100000;
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution;
+    _synthesizeRevolution(revolution);
+
+    std::vector<_u64> timestamps(revolution.size());
+    for (size_t pos = 0; pos < revolution.size(); ++pos) {
+        timestamps[pos] = revolution_uS * pos / revolution.size();
+    }
+
+    const LidarTwist2D twist = { 1.f, 0.f, 0.5f };
+    LidarPose2D poses[LIDAR_DESKEW_POSE_COUNT];
+    std::vector<float> x(revolution.size()), y(revolution.size());
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    do {
+        integrateLidarTwist(twist, timestamps.back(), poses, LIDAR_DESKEW_POSE_COUNT);
+        if (IS_FAIL(deskewScanToCartesian(&revolution[0], &timestamps[0], revolution.size(), 0, timestamps.back(),
+            poses, LIDAR_DESKEW_POSE_COUNT, &x[0], &y[0]))) {
+            ++result.errors;
+        }
+        result.nodes += revolution.size();
+        result.bytes += revolution.size() * (sizeof(revolution[0]) + sizeof(_u64));
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    _report(opt, result);
+}
+
+// the usual chain of a consumer on the SoA ranges of a revolution, a chain that keeps no sample counts as an error
+static void _benchScanFilter(const BenchOptions& opt)
+{
+    std::string name = "scan_filter/chain";
+    if (!_isSelected(opt, name)) return;
+
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution;
+    _synthesizeRevolution(revolution);
+
+    const LidarScanFilter filters[] = {
+        { LIDAR_SCAN_FILTER_DROP_INVALID, 0, 0, 0, 0 },
+        { LIDAR_SCAN_FILTER_RANGE_LIMIT, 0.15f, 12.f, 0, 0 },
+        { LIDAR_SCAN_FILTER_MEDIAN, 0, 0, 5, 0 },
+        { LIDAR_SCAN_FILTER_OUTLIER, 0, 0, 0, 0.5f },
+    };
+    std::vector<float> ranges(revolution.size()), work(revolution.size()), scratch(getScanFilterScratchSize(revolution.size()));
+    std::vector<sl_u8> qualities(revolution.size()), workQualities(revolution.size());
+    std::vector<sl_u32> index(revolution.size());
+    for (size_t pos = 0; pos < revolution.size(); ++pos) {
+        ranges[pos] = getDistanceQ2(revolution[pos]) / 4000.f;
+        qualities[pos] = revolution[pos].quality;
+    }
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    do {
+        work = ranges;
+        workQualities = qualities;
+        if (!filterScan(filters, _countof(filters), &work[0], &workQualities[0], &index[0], work.size(), &scratch[0])) {
+            ++result.errors;
+        }
+        result.nodes += revolution.size();
+        result.bytes += revolution.size() * (sizeof(float) + sizeof(sl_u8));
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    _report(opt, result);
+}
+
+// the revolution raycast into a cleared grid for each round. A wall all around at a fixed range is raycast first:
+// an occupied cell off the wall or a free cell beyond it counts as an error, and so does each cell the SoA path
+// sets differently
+static void _benchOccupancyGrid(const BenchOptions& opt, bool soa)
+{
+    std::string name = soa ? "occupancy_grid/soa" : "occupancy_grid/hq";
+    if (!_isSelected(opt, name)) return;
+
+    LidarScanMode mode;
+    memset(&mode, 0, sizeof(mode));
+    mode.max_distance = 12.f;
+    LidarOccupancyGridSpec spec;
+    Result<ILidarOccupancyGrid*> grid = createLidarOccupancyGrid(spec, mode);
+    Result<ILidarOccupancyGrid*> refGrid = createLidarOccupancyGrid(spec, mode);
+    if (!grid || !refGrid) return;
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    const float wallRange_m = 3.f;
+    std::vector<sl_lidar_response_measurement_node_hq_t> wall;
+    _synthesizeRevolution(wall);
+    for (size_t pos = 0; pos < wall.size(); ++pos) {
+        wall[pos].dist_mm_q2 = (_u32)(wallRange_m * 4000);
+    }
+    (*grid)->integrate(&wall[0], wall.size());
+    for (size_t cellY = 0; cellY < spec.height; ++cellY) {
+        for (size_t cellX = 0; cellX < spec.width; ++cellX) {
+            float dx = (cellX + 0.5f) * spec.resolution_m - spec.lidar_x_m;
+            float dy = (cellY + 0.5f) * spec.resolution_m - spec.lidar_y_m;
+            float cellsOff = (sqrtf(dx * dx + dy * dy) - wallRange_m) / spec.resolution_m;
+            sl_s8 cell = (*grid)->getCells()[cellY * spec.width + cellX];
+            if ((cell > 0 && fabsf(cellsOff) > 1.5f) || (cell < 0 && cellsOff > 1.5f)) ++result.errors;
+        }
+    }
+
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution;
+    _synthesizeRevolution(revolution);
+    std::vector<float> angles(revolution.size()), ranges(revolution.size());
+    for (size_t pos = 0; pos < revolution.size(); ++pos) {
+        angles[pos] = getAngle(revolution[pos]) * (float)(3.14159265358979323846 / 180);
+        ranges[pos] = getDistanceQ2(revolution[pos]) / 4000.f;
+    }
+    LidarScanSoA scan = { &angles[0], &ranges[0], NULL, NULL, revolution.size() };
+
+    _u64 startTs = getus();
+    do {
+        (*grid)->clear();
+        if (soa) {
+            (*grid)->integrate(scan);
+        }
+        else {
+            (*grid)->integrate(&revolution[0], revolution.size());
+        }
+        result.nodes += revolution.size();
+        result.bytes += revolution.size() * (soa ? sizeof(float) * 2 : sizeof(revolution[0]));
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    if (soa) {
+        (*refGrid)->integrate(&revolution[0], revolution.size());
+    }
+    else {
+        (*refGrid)->integrate(scan);
+    }
+    for (size_t pos = 0; pos < spec.width * spec.height; ++pos) {
+        if ((*grid)->getCells()[pos] != (*refGrid)->getCells()[pos]) ++result.errors;
+    }
+
+    delete *grid;
+    delete *refGrid;
+    _report(opt, result);
+}
+
+enum FixedPointKernel {
+    FIXED_POINT_ASCEND = 0,
+    FIXED_POINT_BINS,
+    FIXED_POINT_FILTER,
+    FIXED_POINT_CARTESIAN,
+};
+
+// the integer kernels for the hosts without an FPU, each result off the float path by more than the documented error counts as an error
+static void _benchFixedPoint(const BenchOptions& opt, FixedPointKernel kernel)
+{
+    static const char* const names[] = { "fixed/ascend", "fixed/bins", "fixed/filter", "fixed/cartesian" };
+    std::string name = names[kernel];
+    if (!_isSelected(opt, name)) return;
+
+    // the full circle, the runs without distance at both ends are filled by the ascend
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution;
+    _synthesizeRevolution(revolution);
+    for (size_t pos = 0; pos < revolution.size(); ++pos) {
+        size_t sampleIdx = (pos + revolution.size() / 2) % revolution.size();
+        revolution[pos].angle_z_q14 = (_u16)((sampleIdx << 16) / revolution.size());
+    }
+    revolution[0].dist_mm_q2 = revolution[1].dist_mm_q2 = 0;
+    revolution[revolution.size() - 1].dist_mm_q2 = revolution[revolution.size() - 2].dist_mm_q2 = 0;
+
+    const size_t binCount = 720;
+    const LidarScanFilter filters[] = {
+        { LIDAR_SCAN_FILTER_DROP_INVALID, 0, 0, 0, 0 },
+        { LIDAR_SCAN_FILTER_RANGE_LIMIT, 0.15f, 12.f, 0, 0 },
+        { LIDAR_SCAN_FILTER_MEDIAN, 0, 0, 5, 0 },
+        { LIDAR_SCAN_FILTER_OUTLIER, 0, 0, 0, 0.5f },
+    };
+    const LidarScanFilterFixed fixedFilters[] = {
+        { LIDAR_SCAN_FILTER_DROP_INVALID, 0, 0, 0, 0 },
+        { LIDAR_SCAN_FILTER_RANGE_LIMIT, 600, 48000, 0, 0 },
+        { LIDAR_SCAN_FILTER_MEDIAN, 0, 0, 5, 0 },
+        { LIDAR_SCAN_FILTER_OUTLIER, 0, 0, 0, 2000 },
+    };
+
+    const size_t count = revolution.size();
+    std::vector<sl_lidar_response_measurement_node_hq_t> work(count), bins(binCount);
+    std::vector<sl_u32> ranges(count), workRanges(count), index(count), scratch(getScanFilterScratchSize(count));
+    std::vector<sl_u8> qualities(count, 0), workQualities(count);
+    std::vector<sl_s32> x(count), y(count);
+    for (size_t pos = 0; pos < count; ++pos) {
+        ranges[pos] = revolution[pos].dist_mm_q2;
+        qualities[pos] = revolution[pos].quality;
+    }
+    size_t kept = 0;
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    do {
+        switch (kernel) {
+        case FIXED_POINT_ASCEND:
+            work = revolution;
+            ascendScanDataFixed(&work[0], count);
+            break;
+        case FIXED_POINT_BINS:
+            resampleScanToBinsFixed(&revolution[0], count, binCount, LIDAR_SCAN_BIN_NEAREST_ANGLE, &bins[0]);
+            break;
+        case FIXED_POINT_FILTER:
+            workRanges = ranges;
+            workQualities = qualities;
+            kept = filterScanFixed(fixedFilters, _countof(fixedFilters), &workRanges[0], &workQualities[0], &index[0], count, &scratch[0]);
+            break;
+        case FIXED_POINT_CARTESIAN:
+            convertScanToCartesianFixed(&revolution[0], count, &x[0], &y[0]);
+            break;
+        }
+        result.nodes += count;
+        result.bytes += count * sizeof(revolution[0]);
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    switch (kernel) {
+    case FIXED_POINT_ASCEND:
+        {
+            // the float path drifts by a step for each of the 2 nodes filled at the ends
+            std::vector<sl_lidar_response_measurement_node_hq_t> expected = revolution;
+            ascendScanData_(&expected[0], count);
+            for (size_t pos = 0; pos < count; ++pos) {
+                if (work[pos].dist_mm_q2 != expected[pos].dist_mm_q2
+                    || std::abs((int)work[pos].angle_z_q14 - (int)expected[pos].angle_z_q14) > 3) {
+                    ++result.errors;
+                }
+            }
+        }
+        break;
+    case FIXED_POINT_BINS:
+        {
+            // the bins of the scan holder, the revolution is published by the sync node of the next one
+            ScanDataHolder<sl_lidar_response_measurement_node_hq_t> holder;
+            std::vector<_u64> timestamps(count, 0);
+            holder.setBinning(binCount, LIDAR_SCAN_BIN_NEAREST_ANGLE, false);
+            holder.pushScanNodesData(&timestamps[0], &revolution[0], count);
+            holder.pushScanNodesData(&timestamps[0], &revolution[0], count);
+            const ScanBuffer<sl_lidar_response_measurement_node_hq_t>* scan = holder.waitAndTakeNewestScan(0);
+            if (!scan || scan->bins.size() != binCount) {
+                ++result.errors;
+                break;
+            }
+            for (size_t pos = 0; pos < binCount; ++pos) {
+                if (memcmp(&bins[pos], &scan->bins[pos], sizeof(bins[pos]))) {
+                    ++result.errors;
+                }
+            }
+        }
+        break;
+    case FIXED_POINT_FILTER:
+        {
+            std::vector<float> expected(count), scratchf(getScanFilterScratchSize(count));
+            std::vector<sl_u32> expectedIndex(count);
+            for (size_t pos = 0; pos < count; ++pos) {
+                expected[pos] = ranges[pos] / 4000.f;
+            }
+            workQualities = qualities;
+            size_t expectedKept = filterScan(filters, _countof(filters), &expected[0], &workQualities[0], &expectedIndex[0], count, &scratchf[0]);
+            if (!kept || kept != expectedKept) {
+                ++result.errors;
+                break;
+            }
+            for (size_t pos = 0; pos < kept; ++pos) {
+                if (index[pos] != expectedIndex[pos] || workRanges[pos] / 4000.f != expected[pos]) {
+                    ++result.errors;
+                }
+            }
+        }
+        break;
+    case FIXED_POINT_CARTESIAN:
+        {
+            std::vector<float> xf(count), yf(count);
+            convertScanToCartesian(&revolution[0], count, &xf[0], &yf[0]);
+            for (size_t pos = 0; pos < count; ++pos) {
+                // the documented bound, with the rounding of the float path on top
+                double range = revolution[pos].dist_mm_q2;
+                double tolerance = 0.5 + range / 65536 + range * 1e-6;
+                if (fabs(x[pos] - xf[pos] * 4000.0) > tolerance || fabs(y[pos] - yf[pos] * 4000.0) > tolerance) {
+                    ++result.errors;
+                }
+            }
+        }
+        break;
+    }
+    _report(opt, result);
+}
+
+// the dispatched capsule angle decoder, each mismatch against the generic one counts as an error
+static void _benchCapsuleAngles(const BenchOptions& opt)
+{
+    std::string name = "capsule_angles/ultra_dense";
+    if (!_isSelected(opt, name)) return;
+
+    const int samplesPerCapsule = 64;
+    const int capsuleCount = SAMPLES_PER_REVOLUTION / samplesPerCapsule;
+    const int angleInc_q16 = (360 << 16) / SAMPLES_PER_REVOLUTION;
+
+    _u32 angles[samplesPerCapsule], syncBits[samplesPerCapsule];
+    _u32 refAngles[samplesPerCapsule], refSyncBits[samplesPerCapsule];
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    do {
+        for (int capsule = 0; capsule < capsuleCount; ++capsule) {
+            int startAngle_q16 = (capsule * samplesPerCapsule * angleInc_q16 + (int)result.iterations) % (360 << 16);
+            internal::unpacker::decodeCapsuleSampleAngles(startAngle_q16, angleInc_q16, samplesPerCapsule, angles, syncBits);
+
+            if (result.iterations < 16) {
+                internal::unpacker::decodeCapsuleSampleAnglesGeneric(startAngle_q16, angleInc_q16, samplesPerCapsule, refAngles, refSyncBits);
+                if (memcmp(angles, refAngles, sizeof(angles)) || memcmp(syncBits, refSyncBits, sizeof(syncBits))) {
+                    ++result.errors;
+                }
+            }
+        }
+        result.nodes += capsuleCount * samplesPerCapsule;
+        result.bytes += capsuleCount * sizeof(rplidar_response_ultra_dense_capsule_measurement_nodes_t);
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    _report(opt, result);
+}
+
+// the outputs of the SIMD kernels of each family bound for the cpu features
+struct KernelOutputs
+{
+    std::vector<sl_u32> crcs;
+    std::vector<_u32> angles;
+    std::vector<float> cartesian;
+    std::vector<sl_lidar_response_measurement_node_t> legacy;
+    std::vector<sl_lidar_response_measurement_node_hq_t> fromLegacy;
+};
+
+static void _runKernels(const std::vector<sl_lidar_response_measurement_node_hq_t>& revolution, const LidarScanSoA& scan, KernelOutputs& out)
+{
+    // every length up to a few folding rounds, from every alignment
+    const sl_u8* bytes = reinterpret_cast<const sl_u8*>(&revolution[0]);
+    out.crcs.clear();
+    for (size_t len = 0; len < 300; ++len) {
+        out.crcs.push_back(crc32::getResult(bytes + (len & 0xF), (sl_u32)len));
+    }
+
+    const int angleInc_q16 = (360 << 16) / SAMPLES_PER_REVOLUTION;
+    _u32 angles[64], syncBits[64];
+    out.angles.clear();
+    for (int capsule = 0; capsule < 64; ++capsule) {
+        int count = 1 + capsule % 64;
+        internal::unpacker::decodeCapsuleSampleAngles((capsule * 257 * angleInc_q16) % (360 << 16), angleInc_q16 + capsule, count, angles, syncBits);
+        out.angles.insert(out.angles.end(), angles, angles + count);
+        out.angles.insert(out.angles.end(), syncBits, syncBits + count);
+    }
+
+    std::vector<float> x(revolution.size()), y(revolution.size());
+    out.cartesian.clear();
+    convertScanToCartesian(&revolution[0], revolution.size(), &x[0], &y[0]);
+    out.cartesian.insert(out.cartesian.end(), x.begin(), x.end());
+    out.cartesian.insert(out.cartesian.end(), y.begin(), y.end());
+    convertScanToCartesian(scan, &x[0], &y[0]);
+    out.cartesian.insert(out.cartesian.end(), x.begin(), x.end());
+    out.cartesian.insert(out.cartesian.end(), y.begin(), y.end());
+
+    out.legacy.resize(revolution.size());
+    out.fromLegacy.resize(revolution.size());
+    convertNodesToLegacy(&revolution[0], revolution.size(), &out.legacy[0]);
+    convertNodesFromLegacy(&out.legacy[0], out.legacy.size(), &out.fromLegacy[0]);
+}
+
+template <class T>
+static size_t _countMismatches(const std::vector<T>& a, const std::vector<T>& b)
+{
+    if (a.size() != b.size()) return a.size() + b.size();
+    size_t mismatches = 0;
+    for (size_t pos = 0; pos < a.size(); ++pos) {
+        if (memcmp(&a[pos], &b[pos], sizeof(T))) ++mismatches;
+    }
+    return mismatches;
+}
+
+// the kernels bound with all the features detected, with each of them left out, and with none; every output
+// of them not matching the scalar kernels counts as an error
+static void _benchCpuDispatch(const BenchOptions& opt)
+{
+    std::string name = "dispatch/kernels";
+    if (!_isSelected(opt, name)) return;
+
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution;
+    _synthesizeRevolution(revolution);
+    std::vector<float> angles(revolution.size()), ranges(revolution.size());
+    for (size_t pos = 0; pos < revolution.size(); ++pos) {
+        angles[pos] = getAngle(revolution[pos]) * (float)(3.14159265358979323846 / 180);
+        ranges[pos] = getDistanceQ2(revolution[pos]) / 4000.f;
+    }
+    LidarScanSoA scan = { &angles[0], &ranges[0], NULL, NULL, revolution.size() };
+
+    const _u32 detected = rp::hal::getDetectedCpuFeatures();
+    std::vector<_u32> masks(1, ~(_u32)0);
+    for (int bit = 0; bit < 32; ++bit) {
+        if (detected & (1u << bit)) masks.push_back(~(1u << bit));
+    }
+
+    KernelOutputs reference, outputs;
+    rp::hal::setCpuFeatureMask(0);
+    _runKernels(revolution, scan, reference);
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    for (size_t pos = 0; pos < masks.size(); ++pos) {
+        rp::hal::setCpuFeatureMask(masks[pos]);
+        _runKernels(revolution, scan, outputs);
+        result.errors += _countMismatches(outputs.crcs, reference.crcs) + _countMismatches(outputs.angles, reference.angles)
+            + _countMismatches(outputs.cartesian, reference.cartesian) + _countMismatches(outputs.legacy, reference.legacy)
+            + _countMismatches(outputs.fromLegacy, reference.fromLegacy);
+        result.nodes += revolution.size();
+        result.bytes += revolution.size() * sizeof(revolution[0]);
+        ++result.iterations;
+    }
+    result.elapsed_uS = getus() - startTs;
+    rp::hal::setCpuFeatureMask(~(_u32)0);
+
+    _report(opt, result);
+}
+
+// the delta coding of the scan log, the bytes are the raw nodes; a scan not decoded back as is counts as an error
+static void _benchScanLogCodec(const BenchOptions& opt, bool decode)
+{
+    std::string name = decode ? "scan_log/delta_decode" : "scan_log/delta_encode";
+    if (!_isSelected(opt, name)) return;
+
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution, decoded;
+    _synthesizeRevolution(revolution);
+    decoded.resize(revolution.size());
+
+    std::vector<_u8> encoded;
+    encodeScanNodes(&revolution[0], revolution.size(), encoded);
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    _u64 startTs = getus();
+    do {
+        if (decode) {
+            if (!decodeScanNodes(&encoded[0], encoded.size(), &decoded[0], decoded.size())
+                || memcmp(&decoded[0], &revolution[0], revolution.size() * sizeof(revolution[0]))) {
+                ++result.errors;
+            }
+        }
+        else {
+            encoded.clear();
+            encodeScanNodes(&revolution[0], revolution.size(), encoded);
+        }
+        result.nodes += revolution.size();
+        result.bytes += revolution.size() * sizeof(revolution[0]);
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    _report(opt, result);
+}
+
+// one revolution published into a scan ring and read back in place by a reader of the same process;
+// a view not matching the published nodes or overwritten before it is checked counts as an error
+static void _benchScanShm(const BenchOptions& opt)
+{
+    std::string name = "scan_shm/publish_read";
+    if (!_isSelected(opt, name)) return;
+
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution;
+    _synthesizeRevolution(revolution);
+
+    // unique per run, the benchmarks of several processes may run at once
+    char segmentName[64];
+    snprintf(segmentName, sizeof(segmentName), "sl_lidar_bench_%llu", (unsigned long long)getus());
+    Result<ILidarScanShmWriter*> writer = createScanShmWriter(segmentName);
+    Result<ILidarScanShmReader*> reader = createScanShmReader(segmentName);
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    if (!writer || !reader) {
+        ++result.errors;
+        _report(opt, result);
+        if (reader) delete *reader;
+        if (writer) delete *writer;
+        return;
+    }
+
+    sl_u64 lastSequence = 0;
+    _u64 startTs = getus();
+    do {
+        LidarSharedScanView view;
+        if (IS_FAIL((*writer)->publishScan(&revolution[0], revolution.size(), startTs, startTs))
+            || IS_FAIL((*reader)->getNextScan(lastSequence, view))
+            || view.sequence != lastSequence + 1 || view.count != revolution.size()
+            || memcmp(view.nodes, &revolution[0], revolution.size() * sizeof(revolution[0]))
+            || !(*reader)->isScanValid(view)) {
+            ++result.errors;
+        }
+        lastSequence = view.sequence;
+        result.nodes += revolution.size();
+        result.bytes += revolution.size() * sizeof(revolution[0]);
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    delete *reader;
+    delete *writer;
+    _report(opt, result);
+}
+
+// the whole driver against a simulated device in real time, the node rate follows the simulated
+// sample rate; a failed grab or a revolution not of the simulated size counts as an error
+static void _benchSimulatedDriver(const BenchOptions& opt, const SampleStreamDesc& desc)
+{
+    std::string name = std::string("driver/simulated_") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    const float scanFrequency = 20;
+    LidarSimulatorConfig config = { desc.ansType, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return; // not a simulated answer type
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) {
+        delete *channel;
+        return;
+    }
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    if (IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->startScan(false, true))) {
+        ++result.errors;
+    }
+    else {
+        std::vector<sl_lidar_response_measurement_node_hq_t> nodes(SAMPLES_PER_REVOLUTION * 2);
+        _u64 startTs = getus();
+        do {
+            size_t count = nodes.size();
+            if (IS_FAIL((*driver)->grabScanDataHq(&nodes[0], count, 1000))
+                || count + 1 < SAMPLES_PER_REVOLUTION || count > SAMPLES_PER_REVOLUTION + 1) {
+                ++result.errors;
+            }
+            result.nodes += count;
+            result.bytes += count * desc.packetSize / desc.samplesPerPacket;
+            ++result.iterations;
+            result.elapsed_uS = getus() - startTs;
+        } while (result.elapsed_uS < opt.minDuration_uS);
+        (*driver)->stop();
+    }
+
+    delete *driver;
+    delete *channel;
+    _report(opt, result);
+}
+
+// the raw sample stream of the simulated driver with the other sample paths disabled, the node rate follows the
+// simulated sample rate; a scan grab not refused or a read getting no sample for a revolution counts as an error
+static void _benchIntervalOnlyDriver(const BenchOptions& opt, const SampleStreamDesc& desc)
+{
+    std::string name = std::string("driver/interval_") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    const float scanFrequency = 20;
+    LidarSimulatorConfig config = { desc.ansType, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return; // not a simulated answer type
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) {
+        delete *channel;
+        return;
+    }
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    (*driver)->setSamplePaths(LIDAR_SAMPLE_PATH_INTERVAL);
+    if (IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->startScan(false, true))) {
+        ++result.errors;
+    }
+    else {
+        std::vector<sl_lidar_response_measurement_node_hq_t> nodes(SAMPLES_PER_REVOLUTION * 2);
+        size_t count = nodes.size();
+        if ((*driver)->grabScanDataHq(&nodes[0], count, 0) != SL_RESULT_OPERATION_NOT_SUPPORT) {
+            ++result.errors;
+        }
+
+        _u64 startTs = getus();
+        do {
+            _u64 readStartTs = getus();
+            size_t received = 0;
+            while (received < SAMPLES_PER_REVOLUTION && getus() - readStartTs < 1000000) {
+                count = nodes.size();
+                if (IS_FAIL((*driver)->getScanDataWithIntervalHq(&nodes[0], count))) break;
+                if (!count) delay(1);
+                received += count;
+            }
+            if (received < SAMPLES_PER_REVOLUTION) ++result.errors;
+            result.nodes += received;
+            result.bytes += received * desc.packetSize / desc.samplesPerPacket;
+            ++result.iterations;
+            result.elapsed_uS = getus() - startTs;
+        } while (result.elapsed_uS < opt.minDuration_uS);
+        (*driver)->stop();
+    }
+
+    delete *driver;
+    delete *channel;
+    _report(opt, result);
+}
+
+// the simulated driver case with the buffers prefaulted, the scans are expected to match the plain driver case
+static void _benchRealtimeDriver(const BenchOptions& opt, const SampleStreamDesc& desc)
+{
+    std::string name = std::string("driver/realtime_") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    const float scanFrequency = 20;
+    LidarSimulatorConfig config = { desc.ansType, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return; // not a simulated answer type
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) {
+        delete *channel;
+        return;
+    }
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    LidarRealtimeOptions realtime = { true, false, 256 * 1024 };
+    if (IS_FAIL((*driver)->setRealtimeOptions(realtime))
+        || IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->startScan(false, true))) {
+        ++result.errors;
+    }
+    else {
+        std::vector<sl_lidar_response_measurement_node_hq_t> nodes(SAMPLES_PER_REVOLUTION * 2);
+        _u64 startTs = getus();
+        do {
+            size_t count = nodes.size();
+            if (IS_FAIL((*driver)->grabScanDataHq(&nodes[0], count, 1000))
+                || count + 1 < SAMPLES_PER_REVOLUTION || count > SAMPLES_PER_REVOLUTION + 1) {
+                ++result.errors;
+            }
+            result.nodes += count;
+            result.bytes += count * desc.packetSize / desc.samplesPerPacket;
+            ++result.iterations;
+            result.elapsed_uS = getus() - startTs;
+        } while (result.elapsed_uS < opt.minDuration_uS);
+        (*driver)->stop();
+    }
+
+    delete *driver;
+    delete *channel;
+    _report(opt, result);
+}
+
+// reads the raw samples and their timestamps of a driver for about duration_uS, or until the stream has been idle for
+// idle_uS once some samples have been read
+static void _readIntervalTimestamps(ILidarDriver* driver, _u64 duration_uS, _u64 idle_uS, std::vector<_u64>& timestamps)
+{
+    std::vector<sl_lidar_response_measurement_node_hq_t> nodes(SAMPLES_PER_REVOLUTION);
+    std::vector<sl_u64> batch(SAMPLES_PER_REVOLUTION);
+    _u64 startTs = getus();
+    _u64 lastDataTs = startTs;
+    while (getus() - startTs < duration_uS) {
+        size_t count = nodes.size();
+        if (IS_FAIL(driver->getScanDataWithIntervalHqAndTimeStamps(&nodes[0], &batch[0], count))) break;
+        if (count) {
+            timestamps.insert(timestamps.end(), batch.begin(), batch.begin() + count);
+            lastDataTs = getus();
+        } else {
+            if (!timestamps.empty() && getus() - lastDataTs > idle_uS) break;
+            delay(1);
+        }
+    }
+}
+
+// records a run of the simulated driver, the timestamps of the samples read meanwhile are returned
+// the reading stops early once no sample came for idle_uS
+// false if the answer type is not simulated, errors counts the failures
+static bool _recordSimulatedRun(const SampleStreamDesc& desc, const char* path, _u64 duration_uS, _u64 idle_uS, std::vector<_u64>& timestamps, _u64& errors)
+{
+    const float scanFrequency = 20;
+    LidarSimulatorConfig config = { desc.ansType, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return false; // not a simulated answer type
+
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver || IS_FAIL((*driver)->startRecording(path))
+        || IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->startScan(false, true))) {
+        ++errors;
+    }
+    else {
+        _readIntervalTimestamps(*driver, duration_uS, idle_uS, timestamps);
+        (*driver)->stop();
+    }
+    if (driver) {
+        (*driver)->stopRecording();
+        delete *driver;
+    }
+    delete *channel;
+    return true;
+}
+
+// a simulated run is recorded, then replayed as fast as possible on the clock of the replay channel: the samples
+// are expected to get the timestamps of the original run, a replayed timestamp not found there counts as an error
+static void _benchReplayClock(const BenchOptions& opt, const SampleStreamDesc& desc)
+{
+    std::string name = std::string("driver/replay_clock_") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    const char* recordPath = "sl_lidar_bench_replay.rec";
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    std::vector<_u64> recorded;
+    if (!_recordSimulatedRun(desc, recordPath, 300000, 0, recorded, result.errors)) return;
+
+    Result<IChannel*> channel = createReplayChannel(recordPath, 0);
+    Result<ILidarClock*> clock = getReplayChannelClock(channel ? *channel : NULL);
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!channel || !clock || !driver || recorded.empty()) {
+        ++result.errors;
+    }
+    else {
+        (*driver)->setClock(*clock);
+        (*driver)->setBackpressurePolicy(LIDAR_SAMPLE_PATH_INTERVAL, LIDAR_BACKPRESSURE_BLOCK);
+        if (IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->startScan(false, true))) {
+            ++result.errors;
+        }
+        else {
+            std::vector<_u64> replayed;
+            _u64 startTs = getus();
+            _readIntervalTimestamps(*driver, 5000000, 100000, replayed);
+            result.elapsed_uS = getus() - startTs;
+            (*driver)->stop();
+
+            std::sort(recorded.begin(), recorded.end());
+            for (size_t pos = 0; pos < replayed.size(); ++pos) {
+                if (!std::binary_search(recorded.begin(), recorded.end(), replayed[pos])) ++result.errors;
+            }
+            if (replayed.size() * 2 < recorded.size()) ++result.errors;
+            result.nodes = replayed.size();
+            result.bytes = replayed.size() * desc.packetSize / desc.samplesPerPacket;
+            result.iterations = 1;
+        }
+    }
+
+    if (driver) delete *driver;
+    if (channel) delete *channel;
+    remove(recordPath);
+    _report(opt, result);
+}
+
+// keeps the revolutions decoded from a capture
+class CollectingBatchSink : public ILidarBatchScanSink
+{
+public:
+    virtual sl_result onScan(const sl_lidar_response_measurement_node_hq_t* nodes, const sl_u64* timestamps_uS, size_t count, sl_u64 timestamp_uS)
+    {
+        scanStarts.push_back(timestamp_uS);
+        for (size_t pos = 0; pos < count; ++pos) {
+            scanNodes.push_back(((_u64)nodes[pos].angle_z_q14 << 48) | ((_u64)nodes[pos].dist_mm_q2 << 16) | nodes[pos].quality);
+            scanTimestamps.push_back(timestamps_uS[pos]);
+        }
+        return SL_RESULT_OK;
+    }
+
+    std::vector<_u64> scanStarts;
+    std::vector<_u64> scanNodes;      // angle, distance and quality of each node
+    std::vector<_u64> scanTimestamps;
+};
+
+// a simulated run is recorded, then decoded offline in shards of a few packets over several threads: the revolutions
+// and their timestamps are expected to match the ones decoded in a single shard, as each shard fits the device clock
+// on the same packets; each decoding differing counts as an error
+static void _benchBatchDecode(const BenchOptions& opt, const SampleStreamDesc& desc)
+{
+    std::string name = std::string("batch/decode_") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    const char* recordPath = "sl_lidar_bench_batch.rec";
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    std::vector<_u64> recorded;
+    if (!_recordSimulatedRun(desc, recordPath, 600000, 600000, recorded, result.errors)) return;
+
+    LidarBatchDecodeOptions options;
+    options.timing.sample_duration_uS = 1000000 / (SAMPLES_PER_REVOLUTION * 20);
+    options.thread_count = 1;
+    options.shard_bytes = (size_t)-1;
+    CollectingBatchSink reference;
+    LidarBatchDecodeStats stats;
+    if (IS_FAIL(decodeLidarCapture(recordPath, reference, options, &stats)) || stats.shards != 1 || reference.scanStarts.empty()) {
+        ++result.errors;
+    }
+
+    options.thread_count = 4;
+    options.shard_bytes = desc.packetSize * 3;
+    _u64 startTs = getus();
+    do {
+        CollectingBatchSink sharded;
+        if (IS_FAIL(decodeLidarCapture(recordPath, sharded, options, &stats)) || stats.shards < 2
+            || sharded.scanStarts != reference.scanStarts || sharded.scanNodes != reference.scanNodes
+            || sharded.scanTimestamps != reference.scanTimestamps) {
+            ++result.errors;
+        }
+        result.nodes += stats.nodes;
+        result.bytes += stats.sample_bytes;
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    remove(recordPath);
+    _report(opt, result);
+}
+
+// keeps the arrival time of each scan
+class DeliveryTimesListener : public IScanListener
+{
+public:
+    DeliveryTimesListener()
+        : nodes(0)
+    {
+    }
+
+    virtual void onScanComplete(const LidarScanLease& scan, sl_u64 timestamp_uS)
+    {
+        rp::hal::AutoLocker l(locker);
+        deliveries_uS.push_back(getus());
+        nodes += scan->count;
+    }
+
+    rp::hal::Locker locker;
+    std::vector<_u64> deliveries_uS;
+    _u64 nodes;
+};
+
+// the simulated driver delivering its scans through a jitter buffer of two scans: past the first few scans, a delivery
+// interval off the period by more than a quarter of it and the scheduler margin counts as an error, and so does a p99
+// added latency beyond the buffer depth and a period
+static void _benchPacedDelivery(const BenchOptions& opt, const SampleStreamDesc& desc)
+{
+    std::string name = std::string("driver/paced_") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    const float scanFrequency = 20;
+    LidarSimulatorConfig config = { desc.ansType, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return; // not a simulated answer type
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) {
+        delete *channel;
+        return;
+    }
+
+    const LidarPacedDeliveryOptions options = { 2, 0 };
+    DeliveryTimesListener listener;
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    LidarPacedDeliveryStats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (IS_FAIL((*driver)->setPacedDelivery(options)) || IS_FAIL((*driver)->setScanListener(&listener))
+        || IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->startScan(false, true))) {
+        ++result.errors;
+    }
+    else {
+        _u64 startTs = getus();
+        do {
+            delay(10);
+            result.elapsed_uS = getus() - startTs;
+        } while (result.elapsed_uS < std::max<_u64>(opt.minDuration_uS, 1000000));
+        (*driver)->setScanListener(NULL);
+        (*driver)->getPacedDeliveryStats(stats);
+        (*driver)->stop();
+    }
+
+    const size_t SETTLING_SCANS = 4;
+    // the wakeup of the delivery thread may wait for a time slice of the other runnable threads of a loaded host,
+    // a few milliseconds each on Linux; the deliveries are paced on deadlines, a late one also shortens the next interval
+    const _u64 SCHEDULER_MARGIN_US = 10000;
+    _u64 period = stats.period_uS;
+    for (size_t pos = SETTLING_SCANS + 1; pos < listener.deliveries_uS.size(); ++pos) {
+        _u64 interval = listener.deliveries_uS[pos] - listener.deliveries_uS[pos - 1];
+        if (std::max(interval, period) - std::min(interval, period) > period / 4 + SCHEDULER_MARGIN_US) ++result.errors;
+    }
+    if (listener.deliveries_uS.size() <= SETTLING_SCANS || stats.latency.p99_uS > (options.buffer_depth + 1) * period) ++result.errors;
+
+    result.iterations = stats.delivered;
+    result.nodes = listener.nodes;
+    result.bytes = listener.nodes * desc.packetSize / desc.samplesPerPacket;
+    delete *driver;
+    delete *channel;
+    _report(opt, result);
+}
+
+// checks the points of each merged scan against the downsampling of the group
+class DownsamplingGroupListener : public ILidarGroupListener
+{
+public:
+    DownsamplingGroupListener(const LidarGroupDownsampling& downsampling, size_t lidarCount)
+        : scans(0)
+        , points(0)
+        , downsampled(0)
+        , errors(0)
+        , _downsampling(downsampling)
+        , _lidarCount(lidarCount)
+    {
+    }
+
+    virtual void onMergedScan(const LidarMergedScan& scan)
+    {
+        // a point per angle bin of each LIDAR at most, then a point per voxel
+        size_t binCount = (size_t)ceilf(360.f / _downsampling.angular_step_deg);
+        if (scan.count > binCount * _lidarCount) ++errors;
+
+        std::set<std::pair<int, int> > voxels;
+        for (size_t pos = 0; pos < scan.count; ++pos) {
+            std::pair<int, int> voxel((int)floorf(scan.x_m[pos] / _downsampling.voxel_size_m), (int)floorf(scan.y_m[pos] / _downsampling.voxel_size_m));
+            if (!voxels.insert(voxel).second) ++errors;
+        }
+        ++scans;
+        points += scan.count;
+        downsampled += scan.downsampled_count;
+    }
+
+    std::atomic<_u64> scans;
+    std::atomic<_u64> points;
+    std::atomic<_u64> downsampled;
+    std::atomic<_u64> errors;
+
+private:
+    LidarGroupDownsampling _downsampling;
+    size_t _lidarCount;
+};
+
+// two simulated LIDARs merged by a group with both downsampling stages, the nodes count the points before the
+// downsampling; a merged scan breaking the downsampling counts as an error, and so does a run leaving nothing out
+static void _benchGroupDownsampling(const BenchOptions& opt)
+{
+    std::string name = "group/downsampling";
+    if (!_isSelected(opt, name)) return;
+    // the simulated lidars stream HQ samples
+    if (!_isSampleTypeCompiled(SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ)) return;
+
+    const float scanFrequency = 20;
+    LidarSimulatorConfig config = { SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channels[2] = { createSimulatorChannel(config), createSimulatorChannel(config) };
+    LidarGroupOptions options;
+    memset(&options, 0, sizeof(options));
+    Result<ILidarGroup*> group = createLidarGroup(options);
+    if (!channels[0] || !channels[1] || !group) {
+        if (group) delete *group;
+        for (size_t pos = 0; pos < _countof(channels); ++pos) {
+            if (channels[pos]) delete *channels[pos];
+        }
+        return;
+    }
+
+    const LidarGroupDownsampling downsampling = { 1.f, 0.2f };
+    DownsamplingGroupListener listener(downsampling, _countof(channels));
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    const LidarPose2D extrinsics[2] = { { 0.3f, 0.f, 0.f }, { -0.3f, 0.f, 3.14159265f } };
+    for (size_t pos = 0; pos < _countof(channels); ++pos) {
+        if (IS_FAIL((*group)->addLidar(*channels[pos], extrinsics[pos]))) ++result.errors;
+    }
+    if (!result.errors && SL_IS_OK((*group)->setDownsampling(downsampling)) && SL_IS_OK((*group)->setMergedScanListener(&listener))) {
+        for (size_t pos = 0; pos < _countof(channels); ++pos) {
+            if (IS_FAIL((*group)->getDriver(pos)->startScan(false, true))) ++result.errors;
+        }
+
+        _u64 startTs = getus();
+        do {
+            delay(10);
+            result.elapsed_uS = getus() - startTs;
+        } while (result.elapsed_uS < std::max<_u64>(opt.minDuration_uS, 500000));
+        for (size_t pos = 0; pos < _countof(channels); ++pos) {
+            (*group)->getDriver(pos)->stop();
+        }
+    }
+    (*group)->setMergedScanListener(NULL);
+
+    result.iterations = listener.scans;
+    result.nodes = listener.points + listener.downsampled;
+    result.bytes = result.nodes * (sizeof(float) * 2 + sizeof(_u64) + 2);
+    result.errors += listener.errors;
+    if (!listener.scans || !listener.downsampled) ++result.errors;
+
+    delete *group;
+    for (size_t pos = 0; pos < _countof(channels); ++pos) {
+        delete *channels[pos];
+    }
+    _report(opt, result);
+}
+
+// the errors of an OpenMetrics exposition: a line neither metadata nor a sample with a number, or a missing EOF
+static _u64 _checkExposition(const std::string& exposition)
+{
+    _u64 errors = 0;
+    if (exposition.size() < 6 || exposition.compare(exposition.size() - 6, 6, "# EOF\n") != 0) ++errors;
+
+    size_t begin = 0;
+    while (begin < exposition.size()) {
+        size_t end = exposition.find('\n', begin);
+        if (end == std::string::npos) end = exposition.size();
+        std::string line = exposition.substr(begin, end - begin);
+        begin = end + 1;
+
+        if (line.compare(0, 7, "# TYPE ") == 0 || line.compare(0, 7, "# HELP ") == 0 || line == "# EOF") continue;
+        size_t nameSize = strspn(line.c_str(), "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_:");
+        size_t valuePos = line.rfind("} ");
+        if (!nameSize || line[nameSize] != '{' || valuePos == std::string::npos) {
+            ++errors;
+            continue;
+        }
+        char* valueEnd = NULL;
+        strtod(line.c_str() + valuePos + 2, &valueEnd);
+        if (valueEnd == line.c_str() + valuePos + 2 || *valueEnd) ++errors;
+    }
+    return errors;
+}
+
+// the value of the sample beginning with prefix, -1 if missing
+static double _exposedValue(const std::string& exposition, const std::string& prefix)
+{
+    size_t pos = exposition.find(prefix);
+    if (pos == std::string::npos) return -1;
+    return strtod(exposition.c_str() + pos + prefix.size(), NULL);
+}
+
+// a single HTTP/1.1 request to the loopback endpoint, the answer is read up to the close of the connection
+static bool _httpGet(int port, const char* path, std::string& answer)
+{
+    rp::net::StreamSocket* socket = rp::net::StreamSocket::CreateSocket();
+    if (!socket) return false;
+    rp::net::SocketAddress address("127.0.0.1", port);
+    socket->setTimeout(2000);
+    bool ok = IS_OK(socket->connect(address));
+    if (ok) {
+        std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nAccept: application/openmetrics-text\r\n\r\n";
+        ok = IS_OK(socket->send(request.data(), request.size()));
+    }
+    answer.clear();
+    char buffer[4096];
+    size_t received = 0;
+    while (ok && IS_OK(socket->recv(buffer, sizeof(buffer), received)) && received) {
+        answer.append(buffer, received);
+    }
+    socket->dispose();
+    return ok && !answer.empty();
+}
+
+#if !defined(_WIN32)
+// accepts one push of the exporter and reads it up to the close of the connection
+static bool _receivePush(int listenFd, std::string& exposition)
+{
+    fd_set rdset;
+    FD_ZERO(&rdset);
+    FD_SET(listenFd, &rdset);
+    timeval tv = { 2, 0 };
+    if (::select(listenFd + 1, &rdset, NULL, NULL, &tv) <= 0) return false;
+    int fd = ::accept(listenFd, NULL, NULL);
+    if (fd < 0) return false;
+
+    exposition.clear();
+    char buffer[4096];
+    ssize_t received;
+    while ((received = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        exposition.append(buffer, (size_t)received);
+    }
+    ::close(fd);
+    return received == 0;
+}
+#endif
+
+// a simulated driver exported over HTTP and over a Unix socket; the iterations are the expositions rendered
+// in place, a malformed exposition, a wrong answer of the endpoint or a lost push counts as an error
+static void _benchMetricsExport(const BenchOptions& opt)
+{
+    std::string name = "metrics/export";
+    if (!_isSelected(opt, name)) return;
+    // the simulated lidar streams HQ samples
+    if (!_isSampleTypeCompiled(SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ)) return;
+
+    const float scanFrequency = 20;
+    LidarSimulatorConfig config = { SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return;
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) {
+        delete *channel;
+        return;
+    }
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    LidarMetricsExporterOptions options;
+    memset(&options, 0, sizeof(options));
+    options.http_address = "127.0.0.1";
+    options.push_period_ms = 50;
+
+#if !defined(_WIN32)
+    char pushPath[64];
+    snprintf(pushPath, sizeof(pushPath), "/tmp/sl_bench_metrics_%d.sock", (int)getpid());
+    ::unlink(pushPath);
+    int pushFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un pushAddress;
+    memset(&pushAddress, 0, sizeof(pushAddress));
+    pushAddress.sun_family = AF_UNIX;
+    strncpy(pushAddress.sun_path, pushPath, sizeof(pushAddress.sun_path) - 1);
+    if (pushFd < 0 || ::bind(pushFd, reinterpret_cast<const sockaddr*>(&pushAddress), sizeof(pushAddress)) || ::listen(pushFd, 4)) ++result.errors;
+    options.push_socket_path = pushPath;
+#endif
+
+    // the first free port from the default one
+    Result<ILidarMetricsExporter*> exporter(SL_RESULT_OPERATION_FAIL);
+    for (options.http_port = LIDAR_METRICS_DEFAULT_HTTP_PORT; options.http_port < LIDAR_METRICS_DEFAULT_HTTP_PORT + 16; ++options.http_port) {
+        exporter = createLidarMetricsExporter(options);
+        if (exporter || exporter.err != SL_RESULT_OPERATION_FAIL) break;
+    }
+
+    if (!exporter || IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->startScan(false, true))
+        || IS_FAIL((*exporter)->addDevice(*driver, "bench \"sim\""))) {
+        ++result.errors;
+    }
+    else {
+        delay(300);
+
+        std::string exposition;
+        _u64 startTs = getus();
+        do {
+            (*exporter)->render(exposition);
+            ++result.iterations;
+            result.bytes += exposition.size();
+            result.elapsed_uS = getus() - startTs;
+        } while (result.elapsed_uS < opt.minDuration_uS);
+
+        // the rate is taken over the window since the previous scrape
+        delay(100);
+        (*exporter)->render(exposition);
+
+        const std::string device = "{device=\"bench \\\"sim\\\"\"";
+        char sampleTypeLabel[32];
+        snprintf(sampleTypeLabel, sizeof(sampleTypeLabel), ",ans_type=\"0x%02X\"} ", SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ);
+        result.errors += _checkExposition(exposition);
+        if (_exposedValue(exposition, "slamtec_lidar_connected" + device + "} ") != 1) ++result.errors;
+        if (_exposedValue(exposition, "slamtec_lidar_rx_bytes_total" + device + "} ") <= 0) ++result.errors;
+        if (_exposedValue(exposition, "slamtec_lidar_rx_bytes_per_second" + device + "} ") <= 0) ++result.errors;
+        if (_exposedValue(exposition, "slamtec_lidar_sample_packets_total" + device + sampleTypeLabel) <= 0) ++result.errors;
+        if (_exposedValue(exposition, "slamtec_lidar_checksum_errors_total" + device + sampleTypeLabel) != 0) ++result.errors;
+
+        std::string answer;
+        if (!_httpGet(options.http_port, "/metrics", answer) || answer.compare(0, 15, "HTTP/1.1 200 OK") != 0
+            || answer.find("application/openmetrics-text") == std::string::npos || answer.find("\r\n\r\n") == std::string::npos
+            || _checkExposition(answer.substr(answer.find("\r\n\r\n") + 4))) {
+            ++result.errors;
+        }
+        if (!_httpGet(options.http_port, "/missing", answer) || answer.compare(0, 12, "HTTP/1.1 404") != 0) ++result.errors;
+
+#if !defined(_WIN32)
+        // the connections queued by the pushes before the device was added come first
+        bool isPushed = false;
+        for (size_t push = 0; push < 64 && !isPushed && _receivePush(pushFd, answer); ++push) {
+            isPushed = answer.find("slamtec_lidar_rx_bytes_total" + device) != std::string::npos;
+        }
+        if (!isPushed || _checkExposition(answer)) ++result.errors;
+#endif
+
+        // the requests are counted once their connection is closed
+        LidarMetricsExporterStats stats;
+        _u64 statsTs = getus();
+        for (;;) {
+            (*exporter)->getStats(stats);
+            if (stats.http_requests >= 2 || getus() - statsTs > 1000000) break;
+            delay(1);
+        }
+        if (stats.http_requests != 2 || stats.http_errors != 1) ++result.errors;
+        result.nodes = stats.scrapes;
+        (*exporter)->removeDevice(*driver);
+    }
+
+    if (exporter) delete *exporter;
+#if !defined(_WIN32)
+    if (pushFd >= 0) ::close(pushFd);
+    ::unlink(pushPath);
+#endif
+    (*driver)->stop();
+    delete *driver;
+    delete *channel;
+    _report(opt, result);
+}
+
+struct QueryCallers
+{
+    ILidarDriver*       driver;
+    _u64                deadline_uS;
+    std::atomic<_u64>   calls;
+    std::atomic<_u64>   errors;
+};
+
+static _word_size_t THREAD_PROC _queryCallerProc(void* data)
+{
+    QueryCallers* callers = reinterpret_cast<QueryCallers*>(data);
+    while (getus() < callers->deadline_uS) {
+        sl_lidar_response_device_health_t health;
+        memset(&health, 0xFF, sizeof(health));
+        if (IS_FAIL(callers->driver->getHealth(health, 1000)) || health.status != SL_LIDAR_STATUS_OK) ++callers->errors;
+        ++callers->calls;
+    }
+    return 0;
+}
+
+// several threads asking a simulated device for its health, then the same calls within the freshness window;
+// a failed call, a call neither sent nor shared, no call shared or a command sent from the cache counts as an error
+static void _benchQueryCoalescing(const BenchOptions& opt)
+{
+    std::string name = "driver/query_coalescing";
+    if (!_isSelected(opt, name)) return;
+
+    LidarSimulatorConfig config = { SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ, (sl_u32)(SAMPLES_PER_REVOLUTION * 10), 10 };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return;
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) {
+        delete *channel;
+        return;
+    }
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    if (IS_FAIL((*driver)->connect(*channel))) {
+        ++result.errors;
+    }
+    else {
+        const size_t CALLER_COUNT = 4;
+        QueryCallers callers;
+        callers.driver = *driver;
+        callers.calls = 0;
+        callers.errors = 0;
+
+        _u64 startTs = getus();
+        callers.deadline_uS = startTs + std::max<_u64>(opt.minDuration_uS, 200000);
+        std::vector<rp::hal::Thread> threads;
+        for (size_t pos = 0; pos < CALLER_COUNT; ++pos) {
+            threads.push_back(rp::hal::Thread::create(_queryCallerProc, &callers));
+        }
+        for (size_t pos = 0; pos < threads.size(); ++pos) {
+            threads[pos].join();
+        }
+        result.elapsed_uS = getus() - startTs;
+
+        LidarQueryStats stats;
+        (*driver)->getQueryStats(stats);
+        result.errors += callers.errors;
+        if (stats.commands + stats.coalesced != callers.calls || !stats.coalesced || stats.cached) ++result.errors;
+
+        // the answer of the last command is fresh enough for all the calls
+        LidarQueryCacheOptions cache = { 1000, 1000, 0 };
+        (*driver)->setQueryCache(cache);
+        const size_t CACHED_CALLS = 100;
+        for (size_t pos = 0; pos < CACHED_CALLS; ++pos) {
+            sl_lidar_response_device_health_t health;
+            sl_lidar_response_device_info_t info;
+            if (IS_FAIL((*driver)->getHealth(health)) || IS_FAIL((*driver)->getDeviceInfo(info))) ++result.errors;
+        }
+        LidarQueryStats cachedStats;
+        (*driver)->getQueryStats(cachedStats);
+        // a health command if the window had passed, and the first device info
+        if (cachedStats.commands - stats.commands > 2 || cachedStats.cached - stats.cached < CACHED_CALLS * 2 - 2) ++result.errors;
+
+        result.iterations = callers.calls;
+        result.nodes = stats.commands;
+    }
+
+    delete *driver;
+    delete *channel;
+    _report(opt, result);
+}
+
+// the byte of a simulated device datagram, distinct per device and position in its stream
+static _u8 _endpointPatternByte(size_t device, _u64 streamPos)
+{
+    return (_u8)(device * 61 + streamPos * 7 + (streamPos >> 8));
+}
+
+// several devices, a loopback socket each, sending to one shared endpoint, plus a sender without a channel;
+// each channel has to read back the byte stream of its own device only
+static void _benchUdpEndpoint(const BenchOptions& opt)
+{
+    std::string name = "udp/endpoint_demux";
+    if (!_isSelected(opt, name)) return;
+
+    const size_t DEVICE_COUNT = 4;
+    const size_t DATAGRAM_SIZE = 1024;
+    const size_t DATAGRAMS_PER_ROUND = 16;
+
+    UdpChannelOptions options = { 1024 * 1024 };
+    IUdpEndpoint* endpoint = NULL;
+    int endpointPort;
+    for (endpointPort = 21600; endpointPort < 21616 && !endpoint; ++endpointPort) {
+        Result<IUdpEndpoint*> created = createUdpEndpoint("127.0.0.1", endpointPort, options);
+        if (created) endpoint = *created;
+    }
+    --endpointPort;
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    if (!endpoint) {
+        ++result.errors;
+        _report(opt, result);
+        return;
+    }
+
+    rp::net::SocketAddress endpointAddress("127.0.0.1", endpointPort);
+    rp::net::SocketAddress loopback("127.0.0.1", 0);
+    std::vector<rp::net::DGramSocket*> senders;
+    std::vector<IChannel*> channels;
+    for (size_t pos = 0; pos <= DEVICE_COUNT; ++pos) {
+        rp::net::DGramSocket* sender = rp::net::DGramSocket::CreateSocket();
+        rp::net::SocketAddress local;
+        if (!sender || IS_FAIL(sender->bind(loopback)) || IS_FAIL(sender->getLocalAddress(local))) {
+            if (sender) sender->dispose();
+            ++result.errors;
+            break;
+        }
+        senders.push_back(sender);
+        // the last sender is unknown to the endpoint
+        if (pos == DEVICE_COUNT) break;
+
+        Result<IChannel*> channel = endpoint->createChannel("127.0.0.1", local.getPort());
+        if (!channel || !(*channel)->open()) {
+            if (channel) delete *channel;
+            ++result.errors;
+            break;
+        }
+        channels.push_back(*channel);
+    }
+
+    if (!result.errors) {
+        // the commands of a channel reach its own device, from the shared port
+        for (size_t pos = 0; pos < DEVICE_COUNT; ++pos) {
+            _u8 command[2] = { 0xA5, (_u8)pos };
+            _u8 answer[16];
+            size_t answerSize = 0;
+            rp::net::SocketAddress source;
+            if (channels[pos]->write(command, sizeof(command)) != (int)sizeof(command)
+                || senders[pos]->waitforData(1000) != RESULT_OK
+                || IS_FAIL(senders[pos]->recvFrom(answer, sizeof(answer), answerSize, &source))
+                || answerSize != sizeof(command) || memcmp(answer, command, sizeof(command)) || source.getPort() != endpointPort) {
+                ++result.errors;
+            }
+        }
+
+        std::vector<_u64> sentPos(DEVICE_COUNT, 0);
+        std::vector<_u64> readPos(DEVICE_COUNT, 0);
+        std::vector<_u8> datagram(DATAGRAM_SIZE);
+        std::vector<_u8> buffer(DATAGRAMS_PER_ROUND * DATAGRAM_SIZE);
+        size_t strayDatagrams = 0;
+
+        _u64 startTs = getus();
+        do {
+            for (size_t device = 0; device < DEVICE_COUNT; ++device) {
+                for (size_t count = 0; count < DATAGRAMS_PER_ROUND; ++count) {
+                    for (size_t pos = 0; pos < DATAGRAM_SIZE; ++pos) {
+                        datagram[pos] = _endpointPatternByte(device, sentPos[device] + pos);
+                    }
+                    if (IS_FAIL(senders[device]->sendTo(&endpointAddress, &datagram[0], DATAGRAM_SIZE))) ++result.errors;
+                    sentPos[device] += DATAGRAM_SIZE;
+                }
+            }
+            if (IS_OK(senders[DEVICE_COUNT]->sendTo(&endpointAddress, &datagram[0], DATAGRAM_SIZE))) ++strayDatagrams;
+
+            for (size_t device = 0; device < DEVICE_COUNT; ++device) {
+                while (readPos[device] < sentPos[device]) {
+                    size_t ready = 0;
+                    if (IS_FAIL(channels[device]->waitForDataExt(ready, 1000))) {
+                        ++result.errors;
+                        break;
+                    }
+                    int got = channels[device]->read(&buffer[0], buffer.size());
+                    for (int pos = 0; pos < got; ++pos) {
+                        if (buffer[pos] != _endpointPatternByte(device, readPos[device] + pos)) {
+                            ++result.errors;
+                            break;
+                        }
+                    }
+                    readPos[device] += got;
+                    result.bytes += got;
+                }
+                if (readPos[device] != sentPos[device]) {
+                    // resynchronize to the sender after a loss
+                    readPos[device] = sentPos[device];
+                    channels[device]->clearReadCache();
+                }
+            }
+            result.iterations += DEVICE_COUNT * DATAGRAMS_PER_ROUND;
+            result.elapsed_uS = getus() - startTs;
+        } while (result.elapsed_uS < std::max<_u64>(opt.minDuration_uS, 200000) && result.errors < 16);
+
+        // the stray datagrams are counted once the rx thread is through them
+        UdpEndpointStats stats;
+        _u64 waitStart = getms();
+        do {
+            endpoint->getStats(stats);
+            if (stats.unknown_source_datagrams == strayDatagrams) break;
+            delay(1);
+        } while (getms() - waitStart < 1000);
+
+        if (stats.unknown_source_datagrams != strayDatagrams || stats.dropped_datagrams
+            || stats.datagrams != result.iterations + strayDatagrams || !stats.batches) {
+            ++result.errors;
+        }
+        result.nodes = stats.batches;
+    }
+
+    for (size_t pos = 0; pos < channels.size(); ++pos) {
+        delete channels[pos];
+    }
+    for (size_t pos = 0; pos < senders.size(); ++pos) {
+        senders[pos]->dispose();
+    }
+    delete endpoint;
+    _report(opt, result);
+}
+
+// a mostly static scene of fixed angle bins streamed in the delta mode of the scan sharing, next to a server
+// sending the same scans in full; each scan grabbed by the client has to be within the thresholds of the truth
+static void _benchShareDelta(const BenchOptions& opt)
+{
+    std::string name = "share/delta_stream";
+    if (!_isSelected(opt, name)) return;
+
+    const size_t BIN_COUNT = 720;
+    const size_t KEYFRAME_INTERVAL = 10;
+    const sl_u32 DISTANCE_THRESHOLD_MM = 20;
+
+    LidarShareServerOptions fullOptions = { "239.255.0.42", 0, "127.0.0.1", 1, 0, true, 0, 0, 0 };
+    LidarShareServerOptions deltaOptions = fullOptions;
+    deltaOptions.keyframe_interval = KEYFRAME_INTERVAL;
+    deltaOptions.delta_distance_mm = DISTANCE_THRESHOLD_MM;
+    LidarShareClientOptions clientOptions = { "239.255.0.42", 0, "127.0.0.1" };
+
+    // the full scans go to another port, no client listens to them
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    ILidarShareServer* fullServer = NULL;
+    ILidarShareServer* deltaServer = NULL;
+    ILidarShareClient* client = NULL;
+    for (int port = 21590; port < 21600 && !client; port += 2) {
+        deltaOptions.port = clientOptions.port = port;
+        fullOptions.port = port + 1;
+        Result<ILidarShareClient*> created = createLidarShareClient(clientOptions);
+        if (created) client = *created;
+    }
+    Result<ILidarShareServer*> createdFull = createLidarShareServer(fullOptions);
+    Result<ILidarShareServer*> createdDelta = createLidarShareServer(deltaOptions);
+    if (createdFull) fullServer = *createdFull;
+    if (createdDelta) deltaServer = *createdDelta;
+
+    if (!client || !fullServer || !deltaServer) {
+        ++result.errors;
+    }
+    else {
+        StreamRandom rand;
+        std::vector<sl_lidar_response_measurement_node_hq_t> scene(BIN_COUNT), scan(BIN_COUNT), grabbed(BIN_COUNT);
+        for (size_t pos = 0; pos < BIN_COUNT; ++pos) {
+            _u32 dist = rand.nextDistance();
+            scene[pos].angle_z_q14 = (_u16)((pos << 16) / BIN_COUNT);
+            scene[pos].dist_mm_q2 = dist << 2;
+            scene[pos].quality = dist ? (47 << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
+            scene[pos].flag = pos == 0 ? SL_LIDAR_RESP_HQ_FLAG_SYNCBIT : 0;
+        }
+
+        _u64 startTs = getus();
+        do {
+            // the ranging noise stays under the threshold, and an object moves through 2% of the bins
+            scan = scene;
+            for (size_t pos = 0; pos < BIN_COUNT; ++pos) {
+                if (scan[pos].dist_mm_q2) scan[pos].dist_mm_q2 += (rand.next() % (DISTANCE_THRESHOLD_MM * 2));
+            }
+            size_t objectPos = (size_t)(result.iterations * 7) % BIN_COUNT;
+            for (size_t pos = objectPos; pos < objectPos + BIN_COUNT / 50 && pos < BIN_COUNT; ++pos) {
+                scan[pos].dist_mm_q2 = (500 + (_u32)(result.iterations % 100)) << 2;
+                scan[pos].quality = 47 << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT;
+            }
+
+            sl_u64 timestamp_uS = getus();
+            if (IS_FAIL(fullServer->publishScan(&scan[0], BIN_COUNT, timestamp_uS, timestamp_uS))
+                || IS_FAIL(deltaServer->publishScan(&scan[0], BIN_COUNT, timestamp_uS, timestamp_uS))) {
+                ++result.errors;
+            }
+
+            size_t count = grabbed.size();
+            if (IS_FAIL(client->grabScanDataHq(&grabbed[0], count, 1000)) || count != BIN_COUNT) {
+                ++result.errors;
+            }
+            else {
+                for (size_t pos = 0; pos < BIN_COUNT; ++pos) {
+                    _s32 distError = (_s32)(grabbed[pos].dist_mm_q2 - scan[pos].dist_mm_q2);
+                    if ((distError < 0 ? -distError : distError) > (_s32)(DISTANCE_THRESHOLD_MM << 2)
+                        || grabbed[pos].angle_z_q14 != scan[pos].angle_z_q14
+                        || grabbed[pos].quality != scan[pos].quality || grabbed[pos].flag != scan[pos].flag) {
+                        ++result.errors;
+                        break;
+                    }
+                }
+            }
+
+            result.nodes += BIN_COUNT;
+            ++result.iterations;
+            result.elapsed_uS = getus() - startTs;
+        } while ((result.elapsed_uS < opt.minDuration_uS || result.iterations < KEYFRAME_INTERVAL * 3) && result.errors < 16);
+
+        LidarShareServerStats fullStats, deltaStats;
+        LidarShareClientStats clientStats;
+        fullServer->getStats(fullStats);
+        deltaServer->getStats(deltaStats);
+        client->getStats(clientStats);
+        // a keyframe every interval, the deltas being several times smaller
+        if (deltaStats.keyframes_sent != (result.iterations + KEYFRAME_INTERVAL - 1) / KEYFRAME_INTERVAL
+            || clientStats.keyframes_received != deltaStats.keyframes_sent || clientStats.scans_dropped
+            || deltaStats.bytes_sent * 3 > fullStats.bytes_sent) {
+            ++result.errors;
+        }
+        result.bytes = deltaStats.bytes_sent;
+    }
+
+    delete client;
+    delete fullServer;
+    delete deltaServer;
+    _report(opt, result);
+}
+
+#if defined(__linux__)
+// the voluntary and involuntary context switches of the threads of the process with the given name
+static _u64 _threadContextSwitches(const char* threadName)
+{
+    _u64 switches = 0;
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) return 0;
+    while (struct dirent* ent = readdir(dir)) {
+        if (ent->d_name[0] == '.') continue;
+
+        char path[300];
+        char line[256];
+        snprintf(path, sizeof(path), "/proc/self/task/%s/status", ent->d_name);
+        FILE* fp = fopen(path, "r");
+        if (!fp) continue;
+        bool matched = false;
+        while (fgets(line, sizeof(line), fp)) {
+            unsigned long long value;
+            if (strncmp(line, "Name:", 5) == 0) {
+                char* taskName = line + 5;
+                while (*taskName == ' ' || *taskName == '\t') ++taskName;
+                taskName[strcspn(taskName, "\n")] = 0;
+                matched = (strcmp(taskName, threadName) == 0);
+            }
+            else if (matched && (sscanf(line, "voluntary_ctxt_switches: %llu", &value) == 1
+                || sscanf(line, "nonvoluntary_ctxt_switches: %llu", &value) == 1)) {
+                switches += value;
+            }
+        }
+        fclose(fp);
+    }
+    closedir(dir);
+    return switches;
+}
+
+static _u64 _deepIdleSwitches()
+{
+    return _threadContextSwitches("sl_rx") + _threadContextSwitches("sl_decoder") + _threadContextSwitches("sl_decode")
+        + _threadContextSwitches("sl_cmd_timer") + _threadContextSwitches("sl_recovery");
+}
+
+// the ids of the threads of the process with the given name
+static std::vector<std::string> _threadIds(const char* threadName)
+{
+    std::vector<std::string> ids;
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) return ids;
+    while (struct dirent* ent = readdir(dir)) {
+        if (ent->d_name[0] == '.') continue;
+
+        char path[300];
+        char taskName[64] = { 0 };
+        snprintf(path, sizeof(path), "/proc/self/task/%s/comm", ent->d_name);
+        FILE* fp = fopen(path, "r");
+        if (!fp) continue;
+        if (fgets(taskName, sizeof(taskName), fp)) {
+            taskName[strcspn(taskName, "\n")] = 0;
+            if (strcmp(taskName, threadName) == 0) ids.push_back(ent->d_name);
+        }
+        fclose(fp);
+    }
+    closedir(dir);
+    return ids;
+}
+#endif
+
+// a reader of a scan ring waiting on its own thread: it must sleep without any wakeup until the scan is published,
+// then get it within 50 ms. A switch of the waiting thread over the idle period counts as an error, and so does a
+// scan not read or read late. Linux only, the reader sleeps on a futex there and the switches are read from /proc
+struct ScanShmWaiter {
+    ILidarScanShmReader* reader;
+    sl_result            ans;
+    LidarSharedScanView  view;
+    _u64                 wokenTs;
+};
+
+static _word_size_t THREAD_PROC _scanShmWaiterProc(void* data)
+{
+    ScanShmWaiter* waiter = (ScanShmWaiter*)data;
+    rp::hal::Thread::config_t config;
+    memset(&config, 0, sizeof(config));
+    rp::hal::Thread::SetSelfConfig(config, "sl_bench_shm", rp::hal::Thread::PRIORITY_NORMAL);
+    waiter->ans = waiter->reader->waitNextScan(0, waiter->view, 5000);
+    waiter->wokenTs = getus();
+    return 0;
+}
+
+static void _benchScanShmWait(const BenchOptions& opt)
+{
+#if defined(__linux__)
+    std::string name = "scan_shm/wait";
+    if (!_isSelected(opt, name)) return;
+
+    const _u32 idleMs = 300;
+    std::vector<sl_lidar_response_measurement_node_hq_t> revolution;
+    _synthesizeRevolution(revolution);
+
+    char segmentName[64];
+    snprintf(segmentName, sizeof(segmentName), "sl_lidar_bench_wait_%llu", (unsigned long long)getus());
+    Result<ILidarScanShmWriter*> writer = createScanShmWriter(segmentName);
+    Result<ILidarScanShmReader*> reader = createScanShmReader(segmentName);
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    if (!writer || !reader) {
+        ++result.errors;
+    }
+    else {
+        ScanShmWaiter waiter = { *reader, SL_RESULT_OPERATION_FAIL, LidarSharedScanView(), 0 };
+        rp::hal::Thread thread = rp::hal::Thread::create(_scanShmWaiterProc, &waiter);
+
+        // the thread settles in its wait
+        delay(50);
+        _u64 switches = _threadContextSwitches("sl_bench_shm");
+        _u64 startTs = getus();
+        delay(idleMs);
+        result.errors += _threadContextSwitches("sl_bench_shm") - switches;
+
+        _u64 publishTs = getus();
+        if (IS_FAIL((*writer)->publishScan(&revolution[0], revolution.size(), publishTs, publishTs))) ++result.errors;
+        thread.join();
+        result.elapsed_uS = getus() - startTs;
+
+        if (IS_FAIL(waiter.ans) || waiter.view.sequence != 1 || waiter.wokenTs - publishTs > 50000) {
+            ++result.errors;
+        }
+        else {
+            result.nodes += waiter.view.count;
+        }
+        ++result.iterations;
+    }
+
+    if (reader) delete *reader;
+    if (writer) delete *writer;
+    _report(opt, result);
+#endif
+}
+
+// a connected driver not scanning and an idle decode pool sleep without any periodic wakeup: a context switch of
+// their threads over the idle period counts as an error, and so does a scan not grabbed once the period is over.
+// The command timer and the recovery threads are started beforehand by a query and by the auto recovery.
+// Linux only, the switches are read from /proc
+static void _benchDeepIdle(const BenchOptions& opt)
+{
+#if defined(__linux__)
+    std::string name("driver/deep_idle");
+    if (!_isSelected(opt, name)) return;
+    // the simulated lidar streams HQ samples
+    if (!_isSampleTypeCompiled(SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ)) return;
+
+    // past the 1 s timeout the idle threads used to wake up at
+    const _u32 idleMs = 1500;
+    const float scanFrequency = 10;
+    LidarSimulatorConfig config = { SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    Result<ILidarDriver*> driver = createLidarDriver();
+    Result<ILidarDecodePool*> pool = createLidarDecodePool(2);
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    sl_lidar_response_device_info_t devInfo;
+    if (!channel || !driver || !pool || IS_FAIL((*driver)->connect(*channel))
+        || IS_FAIL((*driver)->setAutoRecovery(true)) || IS_FAIL((*driver)->getDeviceInfo(devInfo))) {
+        ++result.errors;
+    }
+    else {
+        // the threads settle in their waits
+        delay(100);
+        if (_threadIds("sl_cmd_timer").empty() || _threadIds("sl_recovery").empty()) ++result.errors;
+        _u64 switches = _deepIdleSwitches();
+        _u64 startTs = getus();
+        delay(idleMs);
+        result.elapsed_uS = getus() - startTs;
+        result.errors += _deepIdleSwitches() - switches;
+        ++result.iterations;
+
+        std::vector<sl_lidar_response_measurement_node_hq_t> nodes(SAMPLES_PER_REVOLUTION * 2);
+        size_t count = nodes.size();
+        if (IS_FAIL((*driver)->startScan(false, true)) || IS_FAIL((*driver)->grabScanDataHq(&nodes[0], count, 2000))) {
+            ++result.errors;
+        }
+        else {
+            result.nodes += count;
+        }
+        (*driver)->stop();
+    }
+
+    if (driver) delete *driver;
+    if (channel) delete *channel;
+    if (pool) delete *pool;
+    _report(opt, result);
+#endif
+}
+
+// a driver connected again and again to a simulated channel: the rx and decoder threads are parked between the
+// connections and bound to the next one, a connection served by other threads counts as an error, and so does a scan
+// not grabbed after the last connection. Linux only, the thread ids are read from /proc
+static void _benchReconnect(const BenchOptions& opt)
+{
+#if defined(__linux__)
+    std::string name("driver/reconnect");
+    if (!_isSelected(opt, name)) return;
+    // the simulated lidar streams HQ samples
+    if (!_isSampleTypeCompiled(SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ)) return;
+
+    const int reconnects = 20;
+    const float scanFrequency = 10;
+    LidarSimulatorConfig config = { SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    Result<ILidarDriver*> driver = createLidarDriver();
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    if (!channel || !driver || IS_FAIL((*driver)->connect(*channel))) {
+        ++result.errors;
+    }
+    else {
+        // the threads name themselves as they start
+        delay(100);
+        std::vector<std::string> rxIds = _threadIds("sl_rx");
+        std::vector<std::string> decoderIds = _threadIds("sl_decoder");
+        if (rxIds.size() != 1 || decoderIds.size() != 1) ++result.errors;
+
+        _u64 startTs = getus();
+        for (int pos = 0; pos < reconnects; ++pos) {
+            (*driver)->disconnect();
+            if (IS_FAIL((*driver)->connect(*channel))) {
+                ++result.errors;
+                break;
+            }
+            if (_threadIds("sl_rx") != rxIds || _threadIds("sl_decoder") != decoderIds) ++result.errors;
+            ++result.iterations;
+        }
+        result.elapsed_uS = getus() - startTs;
+
+        std::vector<sl_lidar_response_measurement_node_hq_t> nodes(SAMPLES_PER_REVOLUTION * 2);
+        size_t count = nodes.size();
+        if (IS_FAIL((*driver)->startScan(false, true)) || IS_FAIL((*driver)->grabScanDataHq(&nodes[0], count, 2000))) {
+            ++result.errors;
+        }
+        else {
+            result.nodes += count;
+        }
+        (*driver)->stop();
+    }
+
+    if (driver) delete *driver;
+    if (channel) delete *channel;
+    _report(opt, result);
+#endif
+}
+
+// the PTP clock on CLOCK_TAI: a converted host time off the TAI time by more than 1 ms counts as an error, and so does
+// a scan of a simulated driver on the clock whose capture times are not converted to the TAI time. Linux only
+static void _benchPtpClock(const BenchOptions& opt)
+{
+#if defined(__linux__)
+    std::string name("clock/ptp_tai");
+    if (!_isSelected(opt, name)) return;
+
+    const _u64 toleranceUs = 1000;
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    Result<ILidarClock*> clock = createPtpClock("CLOCK_TAI");
+    if (!clock) {
+        ++result.errors;
+        _report(opt, result);
+        return;
+    }
+
+    _u64 startTs = getus();
+    do {
+        for (int pos = 0; pos < 1000; ++pos) {
+            sl_u64 converted = (*clock)->fromHostTime_uS(getus());
+            timespec ts;
+            clock_gettime(CLOCK_TAI, &ts);
+            _u64 tai = (_u64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+            // either way, the offset is measured to the microsecond between two host reads
+            if ((converted > tai ? converted - tai : tai - converted) > toleranceUs) ++result.errors;
+        }
+        result.iterations += 1000;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    // the simulator reports the time each packet was due as its capture time
+    const float scanFrequency = 10;
+    LidarSimulatorConfig config = { SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency, true };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!_isSampleTypeCompiled(config.ans_type)) {
+        // the scans are not checked in a build without the HQ samples
+    }
+    else if (!channel || !driver || IS_FAIL((*driver)->setClock(*clock))
+        || IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->startScan(false, true))) {
+        ++result.errors;
+    }
+    else {
+        for (int scan = 0; scan < 3; ++scan) {
+            LidarScanLease lease;
+            if (IS_FAIL((*driver)->grabScanDataHqLease(lease, 2000)) || !lease->count) {
+                ++result.errors;
+                continue;
+            }
+            // the latest sample was due shortly before the scan was grabbed
+            _u64 now = (*clock)->now_uS();
+            if (lease->end_timestamp_uS > now + toleranceUs || now - lease->end_timestamp_uS > 100000) ++result.errors;
+            result.nodes += lease->count;
+        }
+        (*driver)->stop();
+    }
+
+    if (driver) delete *driver;
+    if (channel) delete *channel;
+    delete *clock;
+    _report(opt, result);
+#endif
+}
+
+// the simulated driver case through the legacy wrapper, the node rate is expected to match it;
+// the nodes received meanwhile are drained and converted to the legacy nodes at each grab
+static void _benchLegacyDriver(const BenchOptions& opt, const SampleStreamDesc& desc)
+{
+    std::string name = std::string("driver/legacy_") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    const float scanFrequency = 20;
+    LidarSimulatorConfig config = { desc.ansType, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return; // not a simulated answer type
+    rp::standalone::rplidar::RPlidarDriver* driver = rp::standalone::rplidar::RPlidarDriver::CreateDriver();
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    if (IS_FAIL(driver->connect(*channel)) || IS_FAIL(driver->startScan(false, true))) {
+        ++result.errors;
+    }
+    else {
+        std::vector<sl_lidar_response_measurement_node_hq_t> nodes(SAMPLES_PER_REVOLUTION * 2);
+        std::vector<sl_lidar_response_measurement_node_t> legacyNodes(SAMPLES_PER_REVOLUTION * 2);
+        _u64 startTs = getus();
+        do {
+            size_t count = nodes.size();
+            if (IS_FAIL(driver->grabScanDataHq(&nodes[0], count, 1000))
+                || count + 1 < SAMPLES_PER_REVOLUTION || count > SAMPLES_PER_REVOLUTION + 1) {
+                ++result.errors;
+            }
+            size_t legacyCount = legacyNodes.size();
+            if (IS_FAIL(driver->getScanDataWithInterval(&legacyNodes[0], legacyCount))) {
+                ++result.errors;
+            }
+            result.nodes += count;
+            result.bytes += count * desc.packetSize / desc.samplesPerPacket;
+            ++result.iterations;
+            result.elapsed_uS = getus() - startTs;
+        } while (result.elapsed_uS < opt.minDuration_uS);
+        driver->stop();
+    }
+
+    rp::standalone::rplidar::RPlidarDriver::DisposeDriver(driver);
+    delete *channel;
+    _report(opt, result);
+}
+
+// switches the simulated driver between its two scan modes in place, each switch is an iteration;
+// a switch restarting the scan, a data gap of one revolution or more, or a failed grab right after it counts as an error
+static void _benchScanModeSwitch(const BenchOptions& opt, const SampleStreamDesc& desc)
+{
+    std::string name = std::string("driver/switch_") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    const float scanFrequency = 20;
+    const _u64 revolution_uS = (_u64)(1000000 / scanFrequency);
+    LidarSimulatorConfig config = { desc.ansType, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return; // not a simulated answer type
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) {
+        delete *channel;
+        return;
+    }
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    std::vector<LidarScanMode> modes;
+    if (IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->getAllSupportedScanModes(modes))
+        || modes.size() < 2) {
+        ++result.errors;
+    }
+    else if (!_isSampleTypeCompiled(modes[0].ans_type) || !_isSampleTypeCompiled(modes[1].ans_type)) {
+        // a mode left out of the build by UNPACKER_HANDLERS has no samples to switch to
+        delete *driver;
+        delete *channel;
+        return;
+    }
+    else if (IS_FAIL((*driver)->startScanExpress(false, modes[1].id))) {
+        ++result.errors;
+    }
+    else {
+        std::vector<sl_lidar_response_measurement_node_hq_t> nodes(SAMPLES_PER_REVOLUTION * 2);
+        _u64 startTs = getus();
+        do {
+            LidarScanModeSwitchStats stats;
+            size_t count = nodes.size();
+            if (IS_FAIL((*driver)->switchScanMode(modes[result.iterations % 2].id, 0, NULL, &stats))
+                || !stats.hot_switched || stats.gap_uS >= revolution_uS
+                || IS_FAIL((*driver)->grabScanDataHq(&nodes[0], count, 1000))) {
+                ++result.errors;
+            }
+            result.nodes += count;
+            ++result.iterations;
+            result.elapsed_uS = getus() - startTs;
+        } while (result.elapsed_uS < opt.minDuration_uS);
+        (*driver)->stop();
+    }
+
+    delete *driver;
+    delete *channel;
+    _report(opt, result);
+}
+
+// alternates the motor speed of the simulated driver while it scans, each change is an iteration;
+// a scan skipped or failed right after it, or a gap counted in it, counts as an error
+static void _benchMotorSpeedChange(const BenchOptions& opt, const SampleStreamDesc& desc)
+{
+    std::string name = std::string("driver/motor_") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    const float scanFrequency = 20;
+    const sl_u16 rpms[] = { 600, 1200 };
+    LidarSimulatorConfig config = { desc.ansType, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return; // not a simulated answer type
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) {
+        delete *channel;
+        return;
+    }
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    LidarScanLease scan;
+    if (IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->startScan(false, true))
+        || IS_FAIL((*driver)->grabScanDataHqLease(scan, 1000))) {
+        ++result.errors;
+    }
+    else {
+        sl_u64 lastSequence = scan->sequence;
+        _u64 startTs = getus();
+        do {
+            if (IS_FAIL((*driver)->setMotorSpeed(rpms[result.iterations % 2]))) ++result.errors;
+            for (int pos = 0; pos < 2; ++pos) {
+                if (IS_FAIL((*driver)->grabScanDataHqLease(scan, 1000))) {
+                    ++result.errors;
+                    continue;
+                }
+                if (scan->sequence != lastSequence + 1 || scan->gap_count) ++result.errors;
+                lastSequence = scan->sequence;
+                result.nodes += scan->count;
+            }
+            ++result.iterations;
+            result.elapsed_uS = getus() - startTs;
+        } while (result.elapsed_uS < opt.minDuration_uS);
+        (*driver)->stop();
+    }
+
+    scan.reset();
+    delete *driver;
+    delete *channel;
+    _report(opt, result);
+}
+
+// connects the simulated driver and starts it with startScanFast, each startup is an iteration;
+// a failed start or grab, or a startup timing missing a phase or longer than its total, counts as an error
+static void _benchFastStart(const BenchOptions& opt, const SampleStreamDesc& desc)
+{
+    std::string name = std::string("driver/faststart_") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    const float scanFrequency = 20;
+    LidarSimulatorConfig config = { desc.ansType, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return; // not a simulated answer type
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) {
+        delete *channel;
+        return;
+    }
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    std::vector<sl_lidar_response_measurement_node_hq_t> nodes(SAMPLES_PER_REVOLUTION * 2);
+    _u64 startTs = getus();
+    do {
+        LidarStartupTimings timings;
+        size_t count = nodes.size();
+        if (IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->startScanFast())
+            || IS_FAIL((*driver)->getStartupTimings(timings))
+            || IS_FAIL((*driver)->grabScanDataHq(&nodes[0], count, 1000))) {
+            ++result.errors;
+        }
+        else if (!timings.identify_uS || !timings.scan_command_uS || !timings.first_sample_uS || !timings.first_scan_uS
+            || timings.total_uS < timings.connect_uS + timings.stop_uS + timings.identify_uS + timings.config_uS
+                + timings.motor_uS + timings.scan_command_uS + timings.first_sample_uS + timings.first_scan_uS) {
+            ++result.errors;
+        }
+        (*driver)->stop();
+        (*driver)->disconnect();
+        result.nodes += count;
+        ++result.iterations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    delete *driver;
+    delete *channel;
+    _report(opt, result);
+}
+
+class StallCountingListener : public IStallListener
+{
+public:
+    StallCountingListener() : stalls(0) {}
+
+    virtual void onStreamStalled(const LidarStallEvent& evt)
+    {
+        ++stalls;
+    }
+
+    std::atomic<int> stalls;
+};
+
+// streams the simulated driver with the stall watchdog at its tightest threshold, changing the motor speed
+// every iteration; a failed grab or any stall reported on the healthy stream counts as an error
+static void _benchStallWatchdog(const BenchOptions& opt, const SampleStreamDesc& desc)
+{
+    std::string name = std::string("driver/stall_") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    const float scanFrequency = 20;
+    const sl_u16 rpms[] = { 600, 1200 };
+    LidarSimulatorConfig config = { desc.ansType, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return; // not a simulated answer type
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) {
+        delete *channel;
+        return;
+    }
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    StallCountingListener listener;
+    LidarScanLease scan;
+    if (IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->setStallWatchdog(true, &listener))
+        || IS_FAIL((*driver)->startScan(false, true))) {
+        ++result.errors;
+    }
+    else {
+        _u64 startTs = getus();
+        do {
+            if (IS_FAIL((*driver)->setMotorSpeed(rpms[result.iterations % 2]))) ++result.errors;
+            for (int pos = 0; pos < 2; ++pos) {
+                if (IS_FAIL((*driver)->grabScanDataHqLease(scan, 1000))) {
+                    ++result.errors;
+                    continue;
+                }
+                result.nodes += scan->count;
+            }
+            ++result.iterations;
+            result.elapsed_uS = getus() - startTs;
+        } while (result.elapsed_uS < opt.minDuration_uS);
+        (*driver)->stop();
+    }
+    (*driver)->setStallWatchdog(false);
+    result.errors += listener.stalls;
+
+    scan.reset();
+    delete *driver;
+    delete *channel;
+    _report(opt, result);
+}
+
+// decodes the HQ capsules in place by a handler of the application: the nodes are published straight
+// from the packet, and the device timestamp of each capsule goes to the custom sample listener
+class InPlaceHQHandler : public ILidarSampleHandler, public ILidarSampleHandlerFactory, public ICustomSampleListener
+{
+public:
+    enum {
+        CUSTOM_CODE_DEVICE_TIMESTAMP = 1,
+    };
+
+    InPlaceHQHandler() : payloads(0), misplacedPayloads(0), released(0), _lastPacket(NULL) {}
+
+    virtual ILidarSampleHandler* createHandler(sl_u8 ansType) { return this; }
+    virtual void releaseHandler(ILidarSampleHandler* handler) { ++released; }
+
+    virtual void onSampleData(ILidarSampleSink& sink, const sl_u8* data, size_t size)
+    {
+        typedef sl_lidar_response_hq_capsule_measurement_nodes_t capsule_t;
+        if (size != sizeof(capsule_t)) return;
+
+        const capsule_t* capsule = reinterpret_cast<const capsule_t*>(data);
+        if (crc32::getResult(data, (sl_u32)(size - 4)) != le32_to_cpu(capsule->crc32)) {
+            sink.publishDecodingError(data, size);
+            return;
+        }
+
+        sl_u64 timestamp_uS = sink.getPacketTimestamp_uS();
+        for (size_t pos = 0; pos < _countof(capsule->node_hq); ++pos) {
+            _timestamps_uS[pos] = timestamp_uS;
+        }
+
+        // the bench runs on little endian hosts, the nodes are taken as they are on the wire
+        _lastPacket = data;
+        sink.publishNodes(capsule->node_hq, _timestamps_uS, _countof(capsule->node_hq));
+        sink.publishCustomData(CUSTOM_CODE_DEVICE_TIMESTAMP, &capsule->time_stamp, sizeof(capsule->time_stamp));
+    }
+
+    virtual void onCustomSampleData(sl_u8 ansType, sl_u32 customCode, const void* payload, size_t size, sl_u64 timestamp_uS)
+    {
+        ++payloads;
+        // the payload is the field of the packet itself, not a copy of it
+        if (customCode != CUSTOM_CODE_DEVICE_TIMESTAMP
+            || payload != _lastPacket + offsetof(sl_lidar_response_hq_capsule_measurement_nodes_t, time_stamp)) {
+            ++misplacedPayloads;
+        }
+    }
+
+    _u64 payloads;
+    _u64 misplacedPayloads;
+    int released;
+
+private:
+    const sl_u8* _lastPacket;
+    sl_u64 _timestamps_uS[96];
+};
+
+// the simulated HQ stream decoded by InPlaceHQHandler in place of the built in handler; a failed grab, a revolution
+// not of the simulated size, a timestamp payload copied or missing, or the handler not released counts as an error
+static void _benchCustomSampleHandler(const BenchOptions& opt, const SampleStreamDesc& desc)
+{
+    if (desc.ansType != SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ) return;
+    std::string name = std::string("driver/custom_") + desc.name;
+    if (!_isSelected(opt, name)) return;
+#if defined(SL_LIDAR_STATIC_UNPACKER_HANDLER)
+    // the handler of the driver is bound at compile time, no other one can be registered
+    return;
+#endif
+
+    const float scanFrequency = 20;
+    LidarSimulatorConfig config = { desc.ansType, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return;
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) {
+        delete *channel;
+        return;
+    }
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    InPlaceHQHandler handler;
+    LidarDecodeStats stats;
+    if (IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->registerSampleHandler(desc.ansType, &handler))
+        || IS_FAIL((*driver)->setCustomSampleListener(&handler)) || IS_FAIL((*driver)->startScan(false, true))) {
+        ++result.errors;
+    }
+    else {
+        std::vector<sl_lidar_response_measurement_node_hq_t> nodes(SAMPLES_PER_REVOLUTION * 2);
+        _u64 startTs = getus();
+        do {
+            size_t count = nodes.size();
+            if (IS_FAIL((*driver)->grabScanDataHq(&nodes[0], count, 1000))
+                || count + 1 < SAMPLES_PER_REVOLUTION || count > SAMPLES_PER_REVOLUTION + 1) {
+                ++result.errors;
+            }
+            result.nodes += count;
+            result.bytes += count * desc.packetSize / desc.samplesPerPacket;
+            ++result.iterations;
+            result.elapsed_uS = getus() - startTs;
+        } while (result.elapsed_uS < opt.minDuration_uS);
+        (*driver)->stop();
+
+        // every packet decoded published its timestamp in place
+        (*driver)->getDecodeStats(stats);
+        _u64 packets = 0;
+        for (size_t pos = 0; pos < stats.sample_type_count; ++pos) {
+            if (stats.samples[pos].ans_type == desc.ansType) packets = stats.samples[pos].packets;
+        }
+        if (!packets || packets != handler.payloads) ++result.errors;
+        result.errors += handler.misplacedPayloads;
+
+        // the built in handler takes over again
+        if (IS_FAIL((*driver)->registerSampleHandler(desc.ansType, NULL)) || handler.released != 1) ++result.errors;
+    }
+    (*driver)->setCustomSampleListener(NULL);
+
+    delete *driver;
+    delete *channel;
+    _report(opt, result);
+}
+
+class LeaseKeepingListener : public IScanListener
+{
+public:
+    virtual void onScanComplete(const LidarScanLease& scan, sl_u64 timestamp_uS)
+    {
+        lastScan = scan;
+    }
+
+    LidarScanLease lastScan;
+};
+
+// the same driver once its scans reach the steady state, with the scans both copied out and lent out,
+// and looked up again from the scan history;
+// each heap allocation made meanwhile, through the sdk allocator or not, counts as an error
+static void _benchSteadyStateAllocations(const BenchOptions& opt, const SampleStreamDesc& desc)
+{
+    std::string name = std::string("driver/noalloc_") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    const float scanFrequency = 20;
+    const size_t historyDepth = 4;
+    // each scan kept by the history takes one more buffer to fill
+    const size_t warmupRevolutions = 10 + historyDepth;
+    LidarSimulatorConfig config = { desc.ansType, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return; // not a simulated answer type
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) {
+        delete *channel;
+        return;
+    }
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    LeaseKeepingListener listener;
+    std::vector<sl_lidar_response_measurement_node_hq_t> nodes(SAMPLES_PER_REVOLUTION * 2);
+    LidarScanLease lease;
+    LidarScanLease historyLease;
+
+    (*driver)->setScanListener(&listener);
+    (*driver)->setScanHistoryDepth(historyDepth);
+    if (IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->startScan(false, true))) {
+        ++result.errors;
+    }
+    else {
+        // the same calls as measured, so the warm up sees the leases as well
+        for (size_t pos = 0; pos < warmupRevolutions; ++pos) {
+            size_t count = nodes.size();
+            (*driver)->grabScanDataHq(&nodes[0], count, 1000);
+            if (SL_IS_OK((*driver)->grabScanDataHqLease(lease, 1000))) {
+                (*driver)->getScanHistoryLeaseBySequence(lease->sequence, historyLease);
+            }
+        }
+
+        LidarAllocationStats startStats;
+        getLidarAllocationStats(startStats);
+        g_allocationCount.store(0, std::memory_order_relaxed);
+        g_countAllocations.store(true, std::memory_order_relaxed);
+
+        _u64 startTs = getus();
+        do {
+            size_t count = nodes.size();
+            if (IS_FAIL((*driver)->grabScanDataHq(&nodes[0], count, 1000))
+                || IS_FAIL((*driver)->grabScanDataHqLease(lease, 1000))
+                || IS_FAIL((*driver)->getScanHistoryLeaseBySequence(lease->sequence, historyLease))) {
+                ++result.errors;
+            }
+            result.nodes += count;
+            result.bytes += count * desc.packetSize / desc.samplesPerPacket;
+            ++result.iterations;
+            result.elapsed_uS = getus() - startTs;
+        } while (result.elapsed_uS < opt.minDuration_uS);
+
+        g_countAllocations.store(false, std::memory_order_relaxed);
+        LidarAllocationStats endStats;
+        getLidarAllocationStats(endStats);
+        result.errors += g_allocationCount.load(std::memory_order_relaxed)
+            + (endStats.steady_state_allocation_count - startStats.steady_state_allocation_count);
+        (*driver)->stop();
+    }
+    (*driver)->setScanListener(nullptr);
+
+    delete *driver;
+    delete *channel;
+    _report(opt, result);
+}
+
+// the queries answered by the simulated device while it streams, once the answer buffers are warm;
+// each heap allocation made meanwhile, through the sdk allocator or not, counts as an error
+static void _benchCommandAllocations(const BenchOptions& opt, const SampleStreamDesc& desc)
+{
+    std::string name = std::string("driver/cmdnoalloc_") + desc.name;
+    if (!_isSelected(opt, name)) return;
+
+    const float scanFrequency = 20;
+    const size_t warmupQueries = 8;
+    LidarSimulatorConfig config = { desc.ansType, (sl_u32)(SAMPLES_PER_REVOLUTION * scanFrequency), scanFrequency };
+    Result<IChannel*> channel = createSimulatorChannel(config);
+    if (!channel) return; // not a simulated answer type
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) {
+        delete *channel;
+        return;
+    }
+
+    BenchResult result = { name, 0, 0, 0, 0, 0 };
+    sl_lidar_response_device_info_t info;
+    sl_lidar_response_device_health_t health;
+    if (IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->startScan(false, true))) {
+        ++result.errors;
+    }
+    else {
+        for (size_t pos = 0; pos < warmupQueries; ++pos) {
+            (*driver)->getDeviceInfo(info);
+            (*driver)->getHealth(health);
+        }
+
+        LidarAllocationStats startStats;
+        getLidarAllocationStats(startStats);
+        g_allocationCount.store(0, std::memory_order_relaxed);
+        g_countAllocations.store(true, std::memory_order_relaxed);
+
+        _u64 startTs = getus();
+        do {
+            if (IS_FAIL((*driver)->getDeviceInfo(info)) || IS_FAIL((*driver)->getHealth(health))) {
+                ++result.errors;
+            }
+            result.bytes += sizeof(info) + sizeof(health);
+            ++result.iterations;
+            result.elapsed_uS = getus() - startTs;
+        } while (result.elapsed_uS < opt.minDuration_uS);
+
+        g_countAllocations.store(false, std::memory_order_relaxed);
+        LidarAllocationStats endStats;
+        getLidarAllocationStats(endStats);
+        result.errors += g_allocationCount.load(std::memory_order_relaxed)
+            + (endStats.steady_state_allocation_count - startStats.steady_state_allocation_count);
+        (*driver)->stop();
+    }
+
+    delete *driver;
+    delete *channel;
+    _report(opt, result);
+}
+
+static bool _loadFile(const char* path, std::vector<_u8>& data)
+{
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return false;
+
+    _u8 buffer[4096];
+    size_t readSize;
+    while ((readSize = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        data.insert(data.end(), buffer, buffer + readSize);
+    }
+    fclose(fp);
+    return !data.empty();
+}
+
+// A channel recording is replayed as the concatenation of its rx chunks
+static bool _extractRecordedRx(std::vector<_u8>& data)
+{
+    if (data.size() < sizeof(ChannelRecordFileHeader)) return true;
+    const ChannelRecordFileHeader* fileHeader = reinterpret_cast<const ChannelRecordFileHeader*>(&data[0]);
+    if (le32_to_cpu(fileHeader->magic) != CHANNEL_RECORD_MAGIC) return true;
+    if (le16_to_cpu(fileHeader->version) != CHANNEL_RECORD_VERSION) return false;
+
+    std::vector<_u8> rx;
+    size_t pos = sizeof(ChannelRecordFileHeader);
+    while (pos + sizeof(ChannelRecordHeader) <= data.size()) {
+        const ChannelRecordHeader* header = reinterpret_cast<const ChannelRecordHeader*>(&data[pos]);
+        size_t payloadSize = le32_to_cpu(header->size);
+        pos += sizeof(ChannelRecordHeader);
+        if (payloadSize > data.size() - pos) break; // truncated by an unclean stop
+        if (header->direction == CHANNEL_RECORD_DIR_RX) {
+            rx.insert(rx.end(), data.begin() + pos, data.begin() + pos + payloadSize);
+        }
+        pos += payloadSize;
+    }
+    data.swap(rx);
+    return !data.empty();
+}
+
+static void print_usage(int argc, const char* argv[])
+{
+    printf("Decode throughput benchmark for SLAMTEC LIDAR SDK %s\n"
+           "Usage:\n"
+           " %s [-t <min ms per case>] [-c <rx chunk bytes>] [-f <case filter>] [-s <capture file>] [--json]\n"
+           "  -t  minimal duration of each case in ms, default 500\n"
+           "  -c  size of each chunk fed to the codec, default 4096\n"
+           "  -f  only run the cases whose name contains the given string\n"
+           "  -s  also replay a raw capture of the wire data, or a channel recording, through the codec and unpacker\n"
+           "  --json  print a machine readable report\n"
+           , SL_LIDAR_SDK_VERSION, argv[0]);
+}
+
+int main(int argc, const char* argv[])
+{
+    BenchOptions opt;
+    opt.minDuration_uS = 500 * 1000;
+    opt.chunkSize = 4096;
+    opt.jsonOutput = false;
+    opt.filter = NULL;
+    opt.streamFile = NULL;
+
+    for (int pos = 1; pos < argc; ++pos) {
+        if (strcmp(argv[pos], "--json") == 0) {
+            opt.jsonOutput = true;
+        }
+        else if (strcmp(argv[pos], "-t") == 0 && pos + 1 < argc) {
+            opt.minDuration_uS = (_u64)strtoul(argv[++pos], NULL, 10) * 1000;
+        }
+        else if (strcmp(argv[pos], "-c") == 0 && pos + 1 < argc) {
+            opt.chunkSize = strtoul(argv[++pos], NULL, 10);
+        }
+        else if (strcmp(argv[pos], "-f") == 0 && pos + 1 < argc) {
+            opt.filter = argv[++pos];
+        }
+        else if (strcmp(argv[pos], "-s") == 0 && pos + 1 < argc) {
+            opt.streamFile = argv[++pos];
+        }
+        else {
+            print_usage(argc, argv);
+            return -1;
+        }
+    }
+
+    if (opt.chunkSize == 0) {
+        print_usage(argc, argv);
+        return -1;
+    }
+
+    for (size_t pos = 0; pos < _countof(g_sampleStreams); ++pos) {
+        const SampleStreamDesc& desc = g_sampleStreams[pos];
+        if (!_isSampleTypeCompiled(desc.ansType)) continue;
+
+        std::vector<_u8> payload;
+        _synthesizeSampleStream(desc, payload);
+
+        _benchUnpacker(opt, desc, payload);
+        _benchStaticUnpacker(opt, desc, payload);
+        _benchCodec(opt, desc, payload, false);
+        _benchCodec(opt, desc, payload, true);
+        _benchUnpackerResync(opt, desc, payload);
+        _benchSimulatedDriver(opt, desc);
+        _benchIntervalOnlyDriver(opt, desc);
+        _benchRealtimeDriver(opt, desc);
+        _benchReplayClock(opt, desc);
+        _benchBatchDecode(opt, desc);
+        _benchPacedDelivery(opt, desc);
+        _benchLegacyDriver(opt, desc);
+        _benchScanModeSwitch(opt, desc);
+        _benchMotorSpeedChange(opt, desc);
+        _benchFastStart(opt, desc);
+        _benchStallWatchdog(opt, desc);
+        _benchCustomSampleHandler(opt, desc);
+        _benchSteadyStateAllocations(opt, desc);
+        _benchCommandAllocations(opt, desc);
+    }
+
+    if (opt.streamFile) {
+        std::vector<_u8> stream;
+        if (!_loadFile(opt.streamFile, stream) || !_extractRecordedRx(stream)) {
+            fprintf(stderr, "Error, cannot load the capture file %s.\n", opt.streamFile);
+            return -2;
+        }
+        _benchRecordedStream(opt, stream);
+    }
+
+    _benchCodecResync(opt);
+    _benchAscendScanData(opt);
+    _benchScanDataHolder(opt, false);
+    _benchScanDataHolder(opt, true);
+    _benchAscendingHolder(opt);
+    _benchScanSince(opt);
+    _benchConcurrentHolders(opt, false);
+    _benchConcurrentHolders(opt, true);
+    _benchSampleCursors(opt);
+    _benchCartesian(opt, false);
+    _benchCartesian(opt, true);
+    _benchLegacyNodes(opt, false);
+    _benchLegacyNodes(opt, true);
+    _benchDeskew(opt);
+    _benchScanFilter(opt);
+    _benchOccupancyGrid(opt, false);
+    _benchOccupancyGrid(opt, true);
+    _benchFixedPoint(opt, FIXED_POINT_ASCEND);
+    _benchFixedPoint(opt, FIXED_POINT_BINS);
+    _benchFixedPoint(opt, FIXED_POINT_FILTER);
+    _benchFixedPoint(opt, FIXED_POINT_CARTESIAN);
+    _benchCapsuleAngles(opt);
+    _benchCpuDispatch(opt);
+    _benchScanLogCodec(opt, false);
+    _benchScanLogCodec(opt, true);
+    _benchScanShm(opt);
+    _benchScanShmWait(opt);
+    _benchGroupDownsampling(opt);
+    _benchMetricsExport(opt);
+    _benchQueryCoalescing(opt);
+    _benchUdpEndpoint(opt);
+    _benchShareDelta(opt);
+    _benchDeepIdle(opt);
+    _benchReconnect(opt);
+    _benchPtpClock(opt);
+
+    if (opt.jsonOutput) {
+        _printJsonReport();
+    }
+
+    for (size_t pos = 0; pos < g_results.size(); ++pos) {
+        if (g_results[pos].errors) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,463 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+// Microbenchmarks of the hal synchronization primitives, which sit on every handoff of the data path and are
+// implemented separately for Linux, macOS and Win32:
+//   locker/uncontended     lock() and unlock() on one thread
+//   locker/contended_<n>   n threads incrementing a counter under one locker, counted as errors if it loses updates
+//   event/signalled        set() and then wait() on one thread, the path taken when the data is already there
+//   event/wake             the time from set() to the return of wait() on a thread parked in it
+//   waiter/round_trip      a request handed to a worker thread and its result handed back through a Waiter
+//   thread/create_join     starting a thread and joining it
+// The locker cases run for the default and the adaptive lockers (Locker(false, true)).
+// Run the same build options on each platform and compare the --json reports between builds, e.g. before and
+// after a change of the implementation of a primitive. The process exits with 1 when a case reports an error.
+
+#include "sdkcommon.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "hal/waiter.h"
+#include "sl_lidar.h"
+#include "sl_latency_histogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <atomic>
+
+using namespace sl;
+using namespace sl::internal;
+
+static const int CONTENDED_THREAD_COUNTS[] = { 2, 4, 8 };
+
+struct HalBenchOptions {
+    _u64        minDuration_uS;
+    bool        jsonOutput;
+    const char* filter;
+};
+
+struct HalBenchResult {
+    std::string         name;
+    _u64                operations;
+    _u64                errors;
+    _u64                elapsed_uS;
+    // of the cases timing each operation, all zero for the others
+    LidarLatencyStats   latency;
+};
+
+static std::vector<HalBenchResult> g_results;
+
+static void print_usage(int argc, const char* argv[])
+{
+    printf("hal synchronization microbenchmarks of SLAMTEC LIDAR SDK %s\n"
+        "Usage:\n"
+        " %s [-t <seconds per case>] [-f <case filter>] [--json]\n"
+        "  -t  how long each case runs at least, default 1\n"
+        "  -f  only run the cases whose name contains the filter, e.g. locker/\n"
+        , SL_LIDAR_SDK_VERSION, argv[0]);
+}
+
+static bool _isSelected(const HalBenchOptions& opt, const std::string& name)
+{
+    return !opt.filter || strstr(name.c_str(), opt.filter) != NULL;
+}
+
+static HalBenchResult _makeResult(const std::string& name)
+{
+    HalBenchResult result;
+    result.name = name;
+    result.operations = 0;
+    result.errors = 0;
+    result.elapsed_uS = 0;
+    memset(&result.latency, 0, sizeof(result.latency));
+    return result;
+}
+
+static void _report(const HalBenchOptions& opt, const HalBenchResult& result)
+{
+    g_results.push_back(result);
+    if (opt.jsonOutput) return;
+
+    printf("%-36s %10llu ops %10.1f ns/op", result.name.c_str(), (unsigned long long)result.operations
+        , result.operations ? result.elapsed_uS * 1000.0 / result.operations : 0.0);
+    if (result.latency.count) {
+        printf("  p50 %5llu p99 %5llu max %6llu us"
+            , (unsigned long long)result.latency.p50_uS
+            , (unsigned long long)result.latency.p99_uS
+            , (unsigned long long)result.latency.max_uS);
+    }
+    printf(" %8llu errors\n", (unsigned long long)result.errors);
+}
+
+static void _printJsonReport()
+{
+    printf("{\"sdk_version\":\"%s\",\"results\":[", SL_LIDAR_SDK_VERSION);
+    for (size_t pos = 0; pos < g_results.size(); ++pos) {
+        const HalBenchResult& r = g_results[pos];
+        printf("%s\n{\"name\":\"%s\",\"operations\":%llu,\"errors\":%llu,\"elapsed_us\":%llu,\"ns_per_op\":%.1f,"
+            "\"p50_us\":%llu,\"p99_us\":%llu,\"max_us\":%llu}"
+            , pos ? "," : ""
+            , r.name.c_str()
+            , (unsigned long long)r.operations
+            , (unsigned long long)r.errors
+            , (unsigned long long)r.elapsed_uS
+            , r.operations ? r.elapsed_uS * 1000.0 / r.operations : 0.0
+            , (unsigned long long)r.latency.p50_uS
+            , (unsigned long long)r.latency.p99_uS
+            , (unsigned long long)r.latency.max_uS);
+    }
+    printf("\n]}\n");
+}
+
+static void _benchLockerUncontended(const HalBenchOptions& opt, bool adaptive)
+{
+    HalBenchResult result = _makeResult(adaptive ? "locker/uncontended_adaptive" : "locker/uncontended");
+    if (!_isSelected(opt, result.name)) return;
+
+    rp::hal::Locker locker(false, adaptive);
+    _u64 startTs = getus();
+    do {
+        for (int pos = 0; pos < 10000; ++pos) {
+            if (locker.lock() != rp::hal::Locker::LOCK_OK) ++result.errors;
+            locker.unlock();
+        }
+        result.operations += 10000;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    _report(opt, result);
+}
+
+// increments a counter shared with the other threads under the locker until it is stopped
+class LockerContender
+{
+public:
+    LockerContender(rp::hal::Locker& locker, volatile _u64& counter, const std::atomic<bool>& running)
+        : _locker(locker)
+        , _counter(counter)
+        , _running(running)
+        , _operations(0)
+    {
+        _thread = CLASS_THREAD(LockerContender, _proc_contend);
+    }
+
+    _u64 join()
+    {
+        _thread.join();
+        return _operations;
+    }
+
+private:
+    u_result _proc_contend()
+    {
+        while (_running.load(std::memory_order_relaxed)) {
+            for (int pos = 0; pos < 1000; ++pos) {
+                _locker.lock();
+                _counter = _counter + 1;
+                _locker.unlock();
+            }
+            _operations += 1000;
+        }
+        return RESULT_OK;
+    }
+
+    rp::hal::Locker&            _locker;
+    volatile _u64&              _counter;
+    const std::atomic<bool>&    _running;
+    _u64                        _operations;
+    rp::hal::Thread             _thread;
+};
+
+static void _benchLockerContended(const HalBenchOptions& opt, int threadCount, bool adaptive)
+{
+    char name[64];
+    sprintf(name, "locker/contended_%d%s", threadCount, adaptive ? "_adaptive" : "");
+    HalBenchResult result = _makeResult(name);
+    if (!_isSelected(opt, result.name)) return;
+
+    rp::hal::Locker locker(false, adaptive);
+    volatile _u64 counter = 0;
+    std::atomic<bool> running(true);
+    std::vector<LockerContender*> contenders;
+
+    _u64 startTs = getus();
+    for (int pos = 0; pos < threadCount; ++pos) {
+        contenders.push_back(new LockerContender(locker, counter, running));
+    }
+    delay((_u32)(opt.minDuration_uS / 1000));
+    running = false;
+    for (size_t pos = 0; pos < contenders.size(); ++pos) {
+        result.operations += contenders[pos]->join();
+        delete contenders[pos];
+    }
+    result.elapsed_uS = getus() - startTs;
+
+    // the updates lost to a broken mutual exclusion
+    if (counter != result.operations) result.errors = result.operations > counter ? result.operations - counter : counter - result.operations;
+    _report(opt, result);
+}
+
+static void _benchEventSignalled(const HalBenchOptions& opt)
+{
+    HalBenchResult result = _makeResult("event/signalled");
+    if (!_isSelected(opt, result.name)) return;
+
+    rp::hal::Event evt;
+    _u64 startTs = getus();
+    do {
+        for (int pos = 0; pos < 10000; ++pos) {
+            evt.set();
+            if (evt.wait(0) != rp::hal::Event::EVENT_OK) ++result.errors;
+        }
+        result.operations += 10000;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    _report(opt, result);
+}
+
+// parks in the wait of an event, and records the time from its set() to the wakeup
+class EventWakeTarget
+{
+public:
+    EventWakeTarget(LatencyHistogram& histogram)
+        : _histogram(histogram)
+        , _setTs(0)
+        , _running(true)
+    {
+        _thread = CLASS_THREAD(EventWakeTarget, _proc_wait);
+    }
+
+    // returns false if the target did not wake up
+    bool wake()
+    {
+        _setTs = getus();
+        _evt.set();
+        return _ackEvt.wait(1000) == rp::hal::Event::EVENT_OK;
+    }
+
+    void stop()
+    {
+        _running = false;
+        _evt.set();
+        _thread.join();
+    }
+
+private:
+    u_result _proc_wait()
+    {
+        while (true) {
+            if (_evt.wait() != rp::hal::Event::EVENT_OK) continue;
+            if (!_running) break;
+            _u64 now = getus();
+            _u64 setTs = _setTs;
+            _histogram.record(now > setTs ? now - setTs : 0);
+            _ackEvt.set();
+        }
+        return RESULT_OK;
+    }
+
+    LatencyHistogram&       _histogram;
+    std::atomic<_u64>       _setTs;
+    std::atomic<bool>       _running;
+    rp::hal::Event          _evt;
+    rp::hal::Event          _ackEvt;
+    rp::hal::Thread         _thread;
+};
+
+static void _benchEventWake(const HalBenchOptions& opt)
+{
+    HalBenchResult result = _makeResult("event/wake");
+    if (!_isSelected(opt, result.name)) return;
+
+    LatencyHistogram histogram;
+    EventWakeTarget target(histogram);
+    _u64 startTs = getus();
+    do {
+        // leaves the target the time to park in the kernel
+        delay(1);
+        if (!target.wake()) ++result.errors;
+        ++result.operations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+    target.stop();
+
+    // the time per operation includes the pause, only the latencies are meaningful
+    histogram.getStats(result.latency);
+    _report(opt, result);
+}
+
+// answers the requests posted to it through the waiter of each request
+class WaiterWorker
+{
+public:
+    WaiterWorker()
+        : _request(0)
+        , _waiter(NULL)
+        , _running(true)
+    {
+        _thread = CLASS_THREAD(WaiterWorker, _proc_serve);
+    }
+
+    void post(int request, rp::hal::Waiter<int>* waiter)
+    {
+        _request = request;
+        _waiter = waiter;
+        _requestEvt.set();
+    }
+
+    void stop()
+    {
+        _running = false;
+        _requestEvt.set();
+        _thread.join();
+    }
+
+private:
+    u_result _proc_serve()
+    {
+        while (true) {
+            if (_requestEvt.wait() != rp::hal::Event::EVENT_OK) continue;
+            if (!_running) break;
+            _waiter.load()->setResult(_request + 1);
+        }
+        return RESULT_OK;
+    }
+
+    std::atomic<int>                    _request;
+    std::atomic<rp::hal::Waiter<int>*>  _waiter;
+    std::atomic<bool>                   _running;
+    rp::hal::Event                      _requestEvt;
+    rp::hal::Thread                     _thread;
+};
+
+static void _benchWaiterRoundTrip(const HalBenchOptions& opt)
+{
+    HalBenchResult result = _makeResult("waiter/round_trip");
+    if (!_isSelected(opt, result.name)) return;
+
+    LatencyHistogram histogram;
+    WaiterWorker worker;
+    rp::hal::Waiter<int> waiter;
+    _u64 startTs = getus();
+    do {
+        for (int pos = 0; pos < 1000; ++pos) {
+            _u64 postTs = getus();
+            worker.post(pos, &waiter);
+            if (waiter.waitForResult() != pos + 1) ++result.errors;
+            histogram.record(getus() - postTs);
+        }
+        result.operations += 1000;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+    worker.stop();
+
+    histogram.getStats(result.latency);
+    _report(opt, result);
+}
+
+static _word_size_t THREAD_PROC _emptyThreadProc(void* data)
+{
+    return 0;
+}
+
+static void _benchThreadCreateJoin(const HalBenchOptions& opt)
+{
+    HalBenchResult result = _makeResult("thread/create_join");
+    if (!_isSelected(opt, result.name)) return;
+
+    LatencyHistogram histogram;
+    _u64 startTs = getus();
+    do {
+        _u64 createTs = getus();
+        rp::hal::Thread thread = rp::hal::Thread::create(_emptyThreadProc);
+        if (IS_FAIL(thread.join())) ++result.errors;
+        histogram.record(getus() - createTs);
+        ++result.operations;
+        result.elapsed_uS = getus() - startTs;
+    } while (result.elapsed_uS < opt.minDuration_uS);
+
+    histogram.getStats(result.latency);
+    _report(opt, result);
+}
+
+int main(int argc, const char* argv[])
+{
+    HalBenchOptions opt;
+    opt.minDuration_uS = 1000 * 1000;
+    opt.jsonOutput = false;
+    opt.filter = NULL;
+
+    for (int pos = 1; pos < argc; ++pos) {
+        if (strcmp(argv[pos], "--json") == 0) {
+            opt.jsonOutput = true;
+        }
+        else if (strcmp(argv[pos], "-t") == 0 && pos + 1 < argc) {
+            opt.minDuration_uS = (_u64)(atof(argv[++pos]) * 1000000);
+        }
+        else if (strcmp(argv[pos], "-f") == 0 && pos + 1 < argc) {
+            opt.filter = argv[++pos];
+        }
+        else {
+            print_usage(argc, argv);
+            return -1;
+        }
+    }
+
+    if (!opt.minDuration_uS) {
+        print_usage(argc, argv);
+        return -1;
+    }
+
+    for (int adaptive = 0; adaptive < 2; ++adaptive) {
+        _benchLockerUncontended(opt, adaptive != 0);
+        for (size_t pos = 0; pos < sizeof(CONTENDED_THREAD_COUNTS) / sizeof(CONTENDED_THREAD_COUNTS[0]); ++pos) {
+            _benchLockerContended(opt, CONTENDED_THREAD_COUNTS[pos], adaptive != 0);
+        }
+    }
+    _benchEventSignalled(opt);
+    _benchEventWake(opt);
+    _benchWaiterRoundTrip(opt);
+    _benchThreadCreateJoin(opt);
+
+    if (opt.jsonOutput) _printJsonReport();
+
+    for (size_t pos = 0; pos < g_results.size(); ++pos) {
+        if (g_results[pos].errors) return 1;
+    }
+    return 0;
+}
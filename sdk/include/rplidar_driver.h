@@ -90,6 +90,10 @@ public:
     /// \param flag          other flags
     ///        Reserved for future use, always set to Zero
     u_result connect(const char *path, _u32 portOrBaud, _u32 flag = 0);
+
+    /// Connect to a target RPLIDAR device through an existing channel, such as a simulator channel
+    /// The channel is not owned by the driver, it must outlive the connection.
+    u_result connect(IChannel* channel);
     
     /// Disconnect with the RPLIDAR and close the serial port
     void disconnect();
@@ -200,7 +204,9 @@ public:
     /// The interface will return RESULT_OPERATION_TIMEOUT to indicate that no complete 360-degrees' scan can be retrieved withing the given timeout duration. 
     ///
     /// \The caller application can set the timeout value to Zero(0) to make this interface always returns immediately to achieve non-block operation.
-    u_result grabScanDataHq(rplidar_response_measurement_node_hq_t * nodebuffer, size_t & count, _u32 timeout = DEFAULT_TIMEOUT);
+    u_result grabScanDataHq(rplidar_response_measurement_node_hq_t * nodebuffer, size_t & count, _u32 timeout = DEFAULT_TIMEOUT) {
+        return _lidarDrv->grabScanDataHq(nodebuffer, count, timeout);
+    }
 
     /// Ascending the scan data according to the angle value in the scan.
     ///
@@ -209,7 +215,9 @@ public:
     /// \param count          The caller must initialize this parameter to set the max data count of the provided buffer (in unit of rplidar_response_measurement_node_t).
     ///                       Once the interface returns, this parameter will store the actual received data count.
     /// The interface will return RESULT_OPERATION_FAIL when all the scan data is invalid. 
-    u_result ascendScanData(rplidar_response_measurement_node_hq_t * nodebuffer, size_t count);
+    u_result ascendScanData(rplidar_response_measurement_node_hq_t * nodebuffer, size_t count) {
+        return _lidarDrv->ascendScanData(nodebuffer, count);
+    }
 
     /// Return received scan points even if it's not complete scan
     ///
@@ -218,6 +226,8 @@ public:
     /// \param count          Once the interface returns, this parameter will store the actual received data count.
     ///
     /// The interface will return RESULT_OPERATION_TIMEOUT to indicate that not even a single node can be retrieved since last call. 
+    ///
+    /// The nodes are converted from the HQ nodes received, the quality and the angle lose their lowest bits.
     u_result getScanDataWithInterval(rplidar_response_measurement_node_t * nodebuffer, size_t & count);
 
     /// Return received scan points even if it's not complete scan
@@ -227,7 +237,9 @@ public:
     /// \param count          Once the interface returns, this parameter will store the actual received data count.
     ///
     /// The interface will return RESULT_OPERATION_TIMEOUT to indicate that not even a single node can be retrieved since last call. 
-    u_result getScanDataWithIntervalHq(rplidar_response_measurement_node_hq_t * nodebuffer, size_t & count);
+    u_result getScanDataWithIntervalHq(rplidar_response_measurement_node_hq_t * nodebuffer, size_t & count) {
+        return _lidarDrv->getScanDataWithIntervalHq(nodebuffer, count);
+    }
 
 
     virtual ~RPlidarDriver();
@@ -235,8 +247,11 @@ protected:
     RPlidarDriver();
 
 private:
+    void _releaseChannel();
+
     sl_u32 _channelType;
     IChannel* _channel;
+    bool _ownsChannel;
     ILidarDriver* _lidarDrv;
     
 };
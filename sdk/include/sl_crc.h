@@ -33,11 +33,20 @@
 
 #pragma once
 
+#include <stddef.h>
 #include "sl_lidar_cmd.h"
 
 namespace sl {namespace crc32 {
     sl_u32 bitrev(sl_u32 input, sl_u16 bw);//reflect
     void init(sl_u32 poly); // table init
     sl_u32 cal(sl_u32 crc, void* input, sl_u16 len);
-    sl_result getResult(sl_u8 *ptr, sl_u32 len);
+
+    // CRC32 used by the LIDAR protocol (poly 0x04C11DB7, reflected, init and xorout 0xFFFFFFFF)
+    // the input is padded with (4 - len % 4) zero bytes in the calculation
+    sl_result getResult(const sl_u8 *ptr, sl_u32 len);
+
+    // raw CRC32 (poly 0x04C11DB7, reflected) register update without the init and xorout steps
+    // the fastest implementation available on the running CPU will be used
+    sl_u32 update(sl_u32 crc, const void* input, size_t len);
+    sl_u32 updateZeros(sl_u32 crc, size_t count);
 }}
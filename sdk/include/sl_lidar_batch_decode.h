@@ -0,0 +1,109 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    /**
+    * Offline decoding of the captures made by ILidarDriver::startRecording, over several threads.
+    *
+    * Each sample stream of a capture is split into shards of whole sample packets, counted from its answer header.
+    * The shards are decoded in parallel, each by a protocol codec and a sample unpacker of its own. A shard also
+    * decodes the packets before its first one to warm up the unpacker, and the nodes they produce are dropped. The
+    * nodes of the shards are then assembled into revolutions in the order of the capture, across the shard
+    * boundaries. A sample stream ends where the driver sent its next stop, reset or scan command.
+    *
+    * The warm-up spans the window the device clock is fitted on: the nodes and their timestamps are the ones of a
+    * decoding in a single shard.
+    */
+    struct LidarBatchDecodeOptions
+    {
+        LidarBatchDecodeOptions()
+            : thread_count(0)
+            , shard_bytes(DEFAULT_SHARD_BYTES)
+        {
+            timing.sample_duration_uS = 0;
+            timing.native_baudrate = 0;
+            timing.linkage_delay_uS = 0;
+            timing.native_interface_type = LIDAR_INTERFACE_UART;
+            timing.native_timestamp_support = true;
+        }
+
+        enum {
+            DEFAULT_SHARD_BYTES = 4 * 1024 * 1024,
+        };
+
+        // the decoding threads, 0 for one per processor
+        int     thread_count;
+        // the sample bytes of each shard
+        size_t  shard_bytes;
+        // the timing of the scan mode the capture was made in, sample_duration_uS must be set: the us_per_sample
+        // of its LidarScanMode, with the baudrate and the linkage delay the driver used; native_timestamp_support
+        // follows the device timestamps of the packets, see ILidarDriver::setNativeTimestampsEnabled
+        SlamtecLidarTimingDesc timing;
+    };
+
+    struct LidarBatchDecodeStats
+    {
+        sl_u64  sample_bytes;   // the bytes of the sample streams
+        sl_u64  streams;        // the sample streams, one per scan started in the capture
+        sl_u64  shards;
+        sl_u64  scans;          // the complete revolutions handed to the sink
+        sl_u64  nodes;
+    };
+
+    /**
+    * Receiver of the revolutions decoded by decodeLidarCapture, called on the thread of decodeLidarCapture in the capture order
+    */
+    class ILidarBatchScanSink
+    {
+    public:
+        virtual ~ILidarBatchScanSink() {}
+
+    public:
+        /// A complete revolution, from a sync node to the node before the next one, e.g. to append to a scan log
+        /// The buffers are only valid during the call. A failure stops the decoding and is returned by decodeLidarCapture.
+        virtual sl_result onScan(const sl_lidar_response_measurement_node_hq_t* nodes, const sl_u64* timestamps_uS, size_t count, sl_u64 timestamp_uS) = 0;
+    };
+
+    /**
+    * Decode a capture of ILidarDriver::startRecording into its revolutions
+    * \param path    The capture, a raw capture of the rx data starting with an answer header is also accepted
+    * \param sink    The receiver of the revolutions
+    * \param stats   The amount of data decoded, NULL if not needed
+    */
+    sl_result decodeLidarCapture(const std::string& path, ILidarBatchScanSink& sink, const LidarBatchDecodeOptions& options, LidarBatchDecodeStats* stats = NULL);
+}
@@ -0,0 +1,112 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+/*
+ * A flat C interface to the driver, for the bindings of other runtimes.
+ *
+ * The scans are lent without copies: a lease pins the scan held by the driver until it is released,
+ * and its view gives the nodes as a pointer, a stride in bytes and a count, so that a host runtime can
+ * wrap the memory directly, e.g. through the Python buffer protocol. Taking and releasing a lease does
+ * not allocate. The leases stay valid after the driver has been destroyed.
+ *
+ * The node layout is sl_lidar_response_measurement_node_hq_t, packed and little endian:
+ *   offset 0: sl_u16 angle_z_q14, offset 2: sl_u32 dist_mm_q2, offset 6: sl_u8 quality, offset 7: sl_u8 flag
+ *
+ * The structures and the functions below only get additions, SL_LIDAR_C_ABI_VERSION grows with each of them.
+ */
+
+#include <stddef.h>
+#include "sl_lidar_cmd.h"
+
+#define SL_LIDAR_C_ABI_VERSION      1
+
+// the leases held at the same time in the process, by all the drivers
+#define SL_LIDAR_C_MAX_SCAN_LEASES  64
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sl_lidar_driver sl_lidar_driver_t;
+typedef struct sl_lidar_scan_lease sl_lidar_scan_lease_t;
+
+typedef struct sl_lidar_scan_view
+{
+    // count nodes, node_stride bytes apart; the first one is the first sample of the scan
+    const sl_lidar_response_measurement_node_hq_t* nodes;
+    size_t      node_stride;
+    // the estimated sample time of each node, timestamp_stride bytes apart
+    const sl_u64* timestamps_uS;
+    size_t      timestamp_stride;
+    size_t      count;
+
+    sl_u64      timestamp_uS;       // the sample time of the first node
+    sl_u64      end_timestamp_uS;   // the latest sample time of the scan
+    sl_u64      sequence;           // increases by one for each scan completed by the driver
+} sl_lidar_scan_view_t;
+
+// the SL_LIDAR_C_ABI_VERSION the library was built with
+sl_u32 sl_lidar_c_abi_version(void);
+
+sl_result sl_lidar_create(sl_lidar_driver_t** driver);
+// disconnects first; the leases still held stay valid
+void sl_lidar_destroy(sl_lidar_driver_t* driver);
+
+// each connect replaces the channel of the previous one
+sl_result sl_lidar_connect_serial(sl_lidar_driver_t* driver, const char* device, sl_u32 baudrate);
+sl_result sl_lidar_connect_tcp(sl_lidar_driver_t* driver, const char* ip, sl_u16 port);
+sl_result sl_lidar_connect_udp(sl_lidar_driver_t* driver, const char* ip, sl_u16 port);
+// a simulated device, see sl::createSimulatorChannel
+sl_result sl_lidar_connect_simulator(sl_lidar_driver_t* driver, sl_u8 ans_type, sl_u32 sample_rate, float scan_frequency);
+void sl_lidar_disconnect(sl_lidar_driver_t* driver);
+int sl_lidar_is_connected(sl_lidar_driver_t* driver);
+
+sl_result sl_lidar_get_device_info(sl_lidar_driver_t* driver, sl_lidar_response_device_info_t* info, sl_u32 timeout_ms);
+sl_result sl_lidar_get_health(sl_lidar_driver_t* driver, sl_lidar_response_device_health_t* health, sl_u32 timeout_ms);
+
+// starts the typical scan mode with the motor
+sl_result sl_lidar_start_scan(sl_lidar_driver_t* driver, int force);
+sl_result sl_lidar_stop(sl_lidar_driver_t* driver);
+
+// Wait for the newest complete scan and lend it, see sl::ILidarDriver::grabScanDataHqLease
+// Fails with SL_RESULT_OPERATION_TIMEOUT without a scan within timeout_ms, and with SL_RESULT_INSUFFICIENT_MEMORY
+// while SL_LIDAR_C_MAX_SCAN_LEASES leases are held. The view is valid until the lease is released.
+sl_result sl_lidar_lease_scan(sl_lidar_driver_t* driver, sl_u32 timeout_ms, sl_lidar_scan_lease_t** lease, sl_lidar_scan_view_t* view);
+// can be called from any thread, NULL is ignored
+void sl_lidar_release_scan(sl_lidar_scan_lease_t* lease);
+
+#ifdef __cplusplus
+}
+#endif
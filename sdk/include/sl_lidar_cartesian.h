@@ -0,0 +1,59 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    // Converts the scan into x / y coordinates in meter:
+    // x = distance * cos(angle), y = distance * sin(angle), with the angle of the LIDAR growing clockwise.
+    // The nodes without distance are converted to (0, 0).
+    // The angles are looked up from a table at the q14 resolution of the protocol, and the fastest
+    // implementation available on the running CPU will be used
+    void convertScanToCartesian(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, float* x, float* y);
+    void convertScanToCartesian(const LidarScanSoA& scan, float* x, float* y);
+
+    // Converts the nodes like convertScanToCartesian, then moves each of them by the pose of the LIDAR at its sample time,
+    // so the whole scan is in the frame of the LIDAR at start_uS.
+    // The poses are relative to the one at start_uS, given at poseCount times evenly spread from start_uS to end_uS
+    // and interpolated linearly in between. Up to LIDAR_DESKEW_MAX_POSE_COUNT poses are accepted.
+    sl_result deskewScanToCartesian(const sl_lidar_response_measurement_node_hq_t* nodes, const sl_u64* timestamps_uS, size_t count,
+        sl_u64 start_uS, sl_u64 end_uS, const LidarPose2D* poses, size_t poseCount, float* x, float* y);
+    sl_result deskewScanToCartesian(const LidarScanSoA& scan, sl_u64 start_uS, sl_u64 end_uS,
+        const LidarPose2D* poses, size_t poseCount, float* x, float* y);
+
+    // The poses of a LIDAR moving at a constant twist, at poseCount times evenly spread over duration_uS from its start
+    void integrateLidarTwist(const LidarTwist2D& twist, sl_u64 duration_uS, LidarPose2D* poses, size_t poseCount);
+}
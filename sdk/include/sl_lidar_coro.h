@@ -0,0 +1,342 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+// the awaitable wrappers need C++20 coroutines, the header is empty without them
+#if defined(__has_include)
+#if __has_include(<coroutine>) && (defined(__cpp_impl_coroutine) || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L))
+#define SL_LIDAR_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef SL_LIDAR_HAS_COROUTINES
+
+#include <coroutine>
+#include <atomic>
+#include <mutex>
+#include <string.h>
+
+namespace sl {
+
+    /**
+    * The awaitable of a command answer, see LidarCoroutineDriver
+    * The coroutine is resumed on the executor once the answer arrives, or at once on the awaiting thread
+    * when the command fails before it is sent.
+    */
+    template <class T>
+    class LidarAnswerAwaitable
+    {
+    public:
+        typedef std::function<void(ILidarDriver* driver, const LidarCommandAnswerHandler& handler)> sender_t;
+        typedef T (*parser_t)(const LidarCommandAnswer& answer);
+
+        LidarAnswerAwaitable(ILidarDriver* driver, ILidarExecutor* executor, const sender_t& sender, parser_t parser)
+            : _driver(driver)
+            , _executor(executor)
+            , _sender(sender)
+            , _parser(parser)
+            , _state(STATE_SENDING)
+        {
+        }
+
+        bool await_ready() const { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            _handle = handle;
+            _sender(_driver, [this](const LidarCommandAnswer& answer) { _complete(answer); });
+
+            // not suspended if the answer has come in the meantime
+            return _state.exchange(STATE_SUSPENDED, std::memory_order_acq_rel) != STATE_ANSWERED;
+        }
+
+        T await_resume()
+        {
+            return _parser(_answer);
+        }
+
+    private:
+        enum {
+            STATE_SENDING = 0,
+            STATE_SUSPENDED = 1,
+            STATE_ANSWERED = 2,
+        };
+
+        void _complete(const LidarCommandAnswer& answer)
+        {
+            _answer = answer;
+            if (_state.exchange(STATE_ANSWERED, std::memory_order_acq_rel) != STATE_SUSPENDED) return;
+
+            std::coroutine_handle<> handle = _handle;
+            if (_executor) {
+                _executor->execute([handle]() { handle.resume(); });
+            }
+            else {
+                handle.resume();
+            }
+        }
+
+        ILidarDriver*           _driver;
+        ILidarExecutor*         _executor;
+        sender_t                _sender;
+        parser_t                _parser;
+        std::atomic<int>        _state;
+        std::coroutine_handle<> _handle;
+        LidarCommandAnswer      _answer;
+    };
+
+    /**
+    * Awaitable wrappers of a driver for coroutine based applications, without a thread blocked on each LIDAR:
+    *
+    *     sl::LidarCoroutineDriver lidar(driver, &executor);
+    *     Result<sl_lidar_response_device_health_t> health = co_await lidar.getHealthAsync();
+    *     for (;;) {
+    *         LidarScanLease scan = co_await lidar.nextScan();
+    *         if (!scan) break;
+    *     }
+    *
+    * The coroutines are resumed on the executor, or on the threads of the driver when it is NULL; those must not
+    * call the driver APIs waiting for the LIDAR before their next co_await.
+    * The wrapper registers itself as the scan listener of the driver while it is alive, it must not outlive the driver.
+    */
+    class LidarCoroutineDriver
+    {
+    public:
+        class ScanAwaitable
+        {
+        public:
+            explicit ScanAwaitable(LidarCoroutineDriver* owner)
+                : _owner(owner)
+                , _next(nullptr)
+            {
+            }
+
+            bool await_ready() const { return false; }
+
+            bool await_suspend(std::coroutine_handle<> handle)
+            {
+                _handle = handle;
+                return _owner->_addWaiter(this);
+            }
+
+            // NULL when the wait has been cancelled
+            LidarScanLease await_resume()
+            {
+                return std::move(_scan);
+            }
+
+        private:
+            friend class LidarCoroutineDriver;
+
+            LidarCoroutineDriver*   _owner;
+            ScanAwaitable*          _next;
+            std::coroutine_handle<> _handle;
+            LidarScanLease          _scan;
+        };
+
+        LidarCoroutineDriver(ILidarDriver* driver, ILidarExecutor* executor = NULL)
+            : _driver(driver)
+            , _executor(executor)
+            , _listener(this)
+            , _waiters(nullptr)
+            , _cancelled(false)
+        {
+            _driver->setScanListener(&_listener);
+        }
+
+        ~LidarCoroutineDriver()
+        {
+            _driver->setScanListener(NULL);
+            cancel();
+        }
+
+        ILidarDriver* getDriver() const
+        {
+            return _driver;
+        }
+
+        // resumes with the next scan completed by the driver
+        ScanAwaitable nextScan()
+        {
+            return ScanAwaitable(this);
+        }
+
+        // resumes the coroutines waiting in nextScan with a NULL scan, and the later ones at once,
+        // e.g. before the scan is stopped or the driver is disposed
+        void cancel()
+        {
+            ScanAwaitable* waiters;
+            {
+                std::lock_guard<std::mutex> l(_waiters_locker);
+                _cancelled = true;
+                waiters = _waiters;
+                _waiters = nullptr;
+            }
+            _resumeWaiters(waiters, LidarScanLease());
+        }
+
+        // lets nextScan wait again after cancel
+        void resetCancel()
+        {
+            std::lock_guard<std::mutex> l(_waiters_locker);
+            _cancelled = false;
+        }
+
+        LidarAnswerAwaitable<LidarCommandAnswer> sendCommandAsync(sl_u8 cmd, sl_u8 ansType, const void* payload = NULL, size_t payloadSize = 0, sl_u32 timeout = ILidarDriver::DEFAULT_TIMEOUT)
+        {
+            std::vector<sl_u8> request(static_cast<const sl_u8*>(payload), static_cast<const sl_u8*>(payload) + (payload ? payloadSize : 0));
+            return LidarAnswerAwaitable<LidarCommandAnswer>(_driver, _executor,
+                [cmd, ansType, request, timeout](ILidarDriver* driver, const LidarCommandAnswerHandler& handler) {
+                    driver->sendCommandAsync(cmd, ansType, request.empty() ? NULL : &request[0], request.size(), timeout, handler);
+                }, &_passAnswer);
+        }
+
+        LidarAnswerAwaitable<LidarCommandAnswer> getLidarConfAsync(sl_u32 type, const void* payload = NULL, size_t payloadSize = 0, sl_u32 timeout = ILidarDriver::DEFAULT_TIMEOUT)
+        {
+            std::vector<sl_u8> request(static_cast<const sl_u8*>(payload), static_cast<const sl_u8*>(payload) + (payload ? payloadSize : 0));
+            return LidarAnswerAwaitable<LidarCommandAnswer>(_driver, _executor,
+                [type, request, timeout](ILidarDriver* driver, const LidarCommandAnswerHandler& handler) {
+                    driver->getLidarConfAsync(type, request.empty() ? NULL : &request[0], request.size(), timeout, handler);
+                }, &_passAnswer);
+        }
+
+        LidarAnswerAwaitable<Result<sl_lidar_response_device_health_t> > getHealthAsync(sl_u32 timeout = ILidarDriver::DEFAULT_TIMEOUT)
+        {
+            return LidarAnswerAwaitable<Result<sl_lidar_response_device_health_t> >(_driver, _executor,
+                [timeout](ILidarDriver* driver, const LidarCommandAnswerHandler& handler) {
+                    driver->sendCommandAsync(SL_LIDAR_CMD_GET_DEVICE_HEALTH, SL_LIDAR_ANS_TYPE_DEVHEALTH, NULL, 0, timeout, handler);
+                }, &_parseHealth);
+        }
+
+        LidarAnswerAwaitable<Result<sl_lidar_response_device_info_t> > getDeviceInfoAsync(sl_u32 timeout = ILidarDriver::DEFAULT_TIMEOUT)
+        {
+            return LidarAnswerAwaitable<Result<sl_lidar_response_device_info_t> >(_driver, _executor,
+                [timeout](ILidarDriver* driver, const LidarCommandAnswerHandler& handler) {
+                    driver->sendCommandAsync(SL_LIDAR_CMD_GET_DEVICE_INFO, SL_LIDAR_ANS_TYPE_DEVINFO, NULL, 0, timeout, handler);
+                }, &_parseDeviceInfo);
+        }
+
+    private:
+        class ScanListener : public IScanListener
+        {
+        public:
+            explicit ScanListener(LidarCoroutineDriver* owner) : _owner(owner) {}
+
+            // on the decoder thread, the waiters are resumed on the executor
+            virtual void onScanComplete(const LidarScanLease& scan, sl_u64 timestamp_uS)
+            {
+                (void)timestamp_uS;
+                ScanAwaitable* waiters;
+                {
+                    std::lock_guard<std::mutex> l(_owner->_waiters_locker);
+                    waiters = _owner->_waiters;
+                    _owner->_waiters = nullptr;
+                }
+                _owner->_resumeWaiters(waiters, scan);
+            }
+
+        private:
+            LidarCoroutineDriver* _owner;
+        };
+
+        // false when cancelled, the awaiting coroutine goes on at once
+        bool _addWaiter(ScanAwaitable* waiter)
+        {
+            std::lock_guard<std::mutex> l(_waiters_locker);
+            if (_cancelled) return false;
+            waiter->_next = _waiters;
+            _waiters = waiter;
+            return true;
+        }
+
+        void _resumeWaiters(ScanAwaitable* waiters, const LidarScanLease& scan)
+        {
+            while (waiters) {
+                // the awaitable lives in the frame of the coroutine, it is gone once resumed
+                ScanAwaitable* waiter = waiters;
+                waiters = waiter->_next;
+
+                waiter->_scan = scan;
+                std::coroutine_handle<> handle = waiter->_handle;
+                if (_executor) {
+                    _executor->execute([handle]() { handle.resume(); });
+                }
+                else {
+                    handle.resume();
+                }
+            }
+        }
+
+        static LidarCommandAnswer _passAnswer(const LidarCommandAnswer& answer)
+        {
+            return answer;
+        }
+
+        // the answers are little endian
+        static Result<sl_lidar_response_device_health_t> _parseHealth(const LidarCommandAnswer& answer)
+        {
+            if (SL_IS_FAIL(answer.result)) return answer.result;
+            if (answer.payload.size() < sizeof(sl_lidar_response_device_health_t)) return SL_RESULT_INVALID_DATA;
+
+            sl_lidar_response_device_health_t health;
+            health.status = answer.payload[0];
+            health.error_code = (sl_u16)(answer.payload[1] | (answer.payload[2] << 8));
+            return health;
+        }
+
+        static Result<sl_lidar_response_device_info_t> _parseDeviceInfo(const LidarCommandAnswer& answer)
+        {
+            if (SL_IS_FAIL(answer.result)) return answer.result;
+            if (answer.payload.size() < sizeof(sl_lidar_response_device_info_t)) return SL_RESULT_INVALID_DATA;
+
+            sl_lidar_response_device_info_t info;
+            memcpy(&info, &answer.payload[0], sizeof(info));
+            info.firmware_version = (sl_u16)(answer.payload[1] | (answer.payload[2] << 8));
+            return info;
+        }
+
+        ILidarDriver*   _driver;
+        ILidarExecutor* _executor;
+        ScanListener    _listener;
+        std::mutex      _waiters_locker;
+        ScanAwaitable*  _waiters;
+        bool            _cancelled;
+    };
+
+}
+
+#endif
@@ -0,0 +1,128 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    /**
+    * Discovery of the network LIDARs of the LAN, e.g. the T series and the Ethernet S series.
+    *
+    * Two probes run in parallel, each on a thread of its own, until a short deadline:
+    *   mDNS       a browse of the service type, "_lidar._udp" by default, sent to 224.0.0.251:5353; the answers
+    *              give the name, the address and the port of each device, and the model and the serial number
+    *              if its TXT record has them
+    *   broadcast  a GET_INFO request broadcast to the data port; the devices answer it like on their channel,
+    *              with their model, firmware, hardware and serial number
+    * The devices found by both probes are merged by their address. The discovery keeps the latest answers of
+    * each device, so a tool may first list the cached devices and refresh them in the background.
+    */
+    enum LidarDiscoverySource
+    {
+        LIDAR_DISCOVERY_SOURCE_MDNS = 0x1,
+        LIDAR_DISCOVERY_SOURCE_BROADCAST = 0x2,
+        LIDAR_DISCOVERY_SOURCE_ALL = 0x3,
+    };
+
+    enum {
+        LIDAR_DISCOVERY_DEFAULT_TIMEOUT_MS = 300,
+        LIDAR_DISCOVERY_DEFAULT_PORT = 8089,
+        LIDAR_DISCOVERY_MAX_DEVICES = 64,
+    };
+
+    struct LidarDiscoveredDevice
+    {
+        char    address[48];        // the IPv4 address
+        int     port;               // the data port of the device
+        char    name[64];           // the mDNS instance name, empty if only found by the broadcast
+        sl_u32  sources;            // the LidarDiscoverySource bits of the probes which found it
+
+        // from the answer to the broadcast probe, or the model and sn keys of the TXT record
+        bool    has_device_info;
+        sl_lidar_response_device_info_t device_info;
+
+        // the time of the latest answer, see getLidarClockInfo
+        sl_u64  last_seen_uS;
+    };
+
+    /**
+    * \param sources             The LidarDiscoverySource bits of the probes to run, 0 for all of them
+    * \param port                The data port the broadcast probe goes to, 0 for LIDAR_DISCOVERY_DEFAULT_PORT
+    * \param service_type        The mDNS service type to browse, NULL for "_lidar._udp"
+    * \param broadcast_address   Where the broadcast probe goes to, NULL for 255.255.255.255
+    */
+    struct LidarDiscoveryOptions
+    {
+        sl_u32      sources;
+        int         port;
+        const char* service_type;
+        const char* broadcast_address;
+    };
+
+    /**
+    * Receives the devices as they answer, called on the threads of the probes, one call at a time
+    */
+    class ILidarDiscoveryListener
+    {
+    public:
+        virtual ~ILidarDiscoveryListener() {}
+
+    public:
+        /// A device answered for the first time in this discovery, or some more of its details are known
+        virtual void onLidarDiscovered(const LidarDiscoveredDevice& device) = 0;
+    };
+
+    class ILidarDiscovery
+    {
+    public:
+        virtual ~ILidarDiscovery() {}
+
+    public:
+        /**
+        * Run the probes until the timeout and give the devices found, from this discovery only
+        * \param listener   Optional, gets the devices as soon as they answer
+        * \param timeoutMs  0 for LIDAR_DISCOVERY_DEFAULT_TIMEOUT_MS
+        * \return SL_RESULT_OPERATION_FAIL if no probe could be sent
+        */
+        virtual sl_result discover(std::vector<LidarDiscoveredDevice>& devices, ILidarDiscoveryListener* listener = NULL, sl_u32 timeoutMs = 0) = 0;
+
+        /**
+        * Get the devices of the recent discoveries without probing
+        * \param maxAgeMs  Only the devices which answered within this time, 0 for all of them
+        */
+        virtual void getCachedLidars(std::vector<LidarDiscoveredDevice>& devices, sl_u32 maxAgeMs = 0) = 0;
+    };
+
+    Result<ILidarDiscovery*> createLidarDiscovery(const LidarDiscoveryOptions& options);
+}
@@ -38,6 +38,9 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <memory>
+#include <functional>
+#include <future>
 
 #ifndef DEPRECATED
     #ifdef __GNUC__
@@ -88,6 +91,78 @@ namespace sl {
         char    scan_mode[64];
     };
 
+    /**
+    * The timing of a scan mode switch, see ILidarDriver::switchScanMode
+    */
+    struct LidarScanModeSwitchStats
+    {
+        // true if the scan was switched in place, false if it was stopped and restarted
+        bool    hot_switched;
+
+        // the sample time of the last node of the previous mode, 0 if none
+        sl_u64  last_sample_uS;
+
+        // the sample time of the first node of the new mode, 0 if none arrived within the timeout
+        sl_u64  first_sample_uS;
+
+        // the time without any sample, from the last node of the previous mode to the first one of the new mode
+        sl_u64  gap_uS;
+
+        // the time spent sending the commands of the switch
+        sl_u64  command_uS;
+    };
+
+    /**
+    * What the device answered to startScanFast, see ILidarDriver::startScanFast
+    */
+    struct LidarStartupInfo
+    {
+        // the scan mode started
+        LidarScanMode   scan_mode;
+
+        // the same as getDeviceInfo and getHealth, which would stop the scan once it is started
+        sl_lidar_response_device_info_t   device_info;
+        sl_lidar_response_device_health_t health;
+    };
+
+    /**
+    * The time spent in each phase of the last startScanFast, from connect() to the first complete scan
+    * The phases not done yet are 0.
+    */
+    struct LidarStartupTimings
+    {
+        // connect(), 0 unless it is the first start since the connection
+        sl_u64  connect_uS;
+
+        // the stop of a stream left running by a previous session
+        sl_u64  stop_uS;
+
+        // the device info and the health, queried together
+        sl_u64  identify_uS;
+
+        // the motor control probe, the typical scan mode and the desired motor speed queried together, without motor_uS
+        sl_u64  config_uS;
+
+        // the motor start command, sent once the desired speed is known while the typical scan mode is queried
+        sl_u64  motor_uS;
+
+        // the parameters of the scan mode and the scan command
+        sl_u64  scan_command_uS;
+
+        // from the scan command to the first sample received, mostly the motor spin up
+        sl_u64  first_sample_uS;
+
+        // from the first sample to the first complete scan, 0 with the deferred decoding.
+        // The revolution in progress at the first sample is dropped.
+        sl_u64  first_scan_uS;
+
+        // from connect(), or startScanFast after the first start, to the first complete scan
+        sl_u64  total_uS;
+
+        // true if the typical scan mode and its parameters were known without a query
+        bool    capabilities_cached;
+    };
+
     template <typename T>
     struct Result
     {
@@ -165,6 +240,58 @@ namespace sl {
         bool    native_timestamp_support;
     };
 
+    /**
+    * Tuning of a serial channel, see createSerialPortChannel
+    */
+    struct SerialPortOptions
+    {
+        // ask the serial driver to deliver the received bytes without batching them (ASYNC_LOW_LATENCY, Linux only)
+        // the FTDI adapters also drop their latency timer to 1 ms, at the cost of more wakeups of the rx thread
+        bool    low_latency;
+    };
+
+    /**
+    * The effective settings of a serial channel, see ISerialPortChannel::getSerialPortSettings
+    */
+    struct SerialPortSettings
+    {
+        sl_u32  baudrate;
+        bool    low_latency;
+        // the latency timer of the USB adapter in ms, -1 if it has none
+        sl_s32  latency_timer_ms;
+    };
+
+    /**
+    * Tuning of a CP210x USB channel, see createCp210xUsbChannel
+    */
+    struct UsbChannelOptions
+    {
+        // bytes of each bulk-IN transfer, a multiple of the 64 byte packets of the bridge, 0 for 256
+        // a transfer is handed over once full or on a short packet, the smaller it is the sooner a busy stream gets read
+        sl_u32  transfer_size;
+        // bulk-IN transfers kept in flight so the bridge always has one to fill, 0 for 8
+        sl_u32  transfer_count;
+    };
+
+    /**
+    * Tuning of a TCP channel, see createTcpChannel
+    */
+    struct TcpChannelOptions
+    {
+        // kernel receive buffer of the socket in bytes (SO_RCVBUF), 0 keeps the system default
+        sl_u32  rx_buffer_size;
+    };
+
+    /**
+    * Tuning of a UDP channel, see createUdpChannel
+    */
+    struct UdpChannelOptions
+    {
+        // kernel receive buffer of the socket in bytes (SO_RCVBUF), 0 keeps the system default
+        // a larger buffer absorbs the scheduling hiccups of the rx thread at the full sample rate of the T series
+        sl_u32  rx_buffer_size;
+    };
+
     /**
     * Abstract interface of communication channel
     */
@@ -209,6 +336,18 @@ namespace sl {
         */
         virtual sl_result waitForDataExt(size_t& size_hint, sl_u32 timeoutInMs = 1000) = 0;
 
+        /**
+        * Wake up the threads waiting for data, to close the channel without waiting for their timeout
+        * The waits return RESULT_OPERATION_TIMEOUT from then on, until the channel is opened again
+        */
+        virtual void cancelWaits() {}
+
+        /**
+        * Whether cancelWaits() reliably wakes up the waits at once
+        * The driver then waits for the data without a timeout, and does not wake up at all while the device is idle
+        */
+        virtual bool isWaitCancellable() { return false; }
+
 
         /**
         * Send data to remote endpoint
@@ -226,83 +365,1188 @@ namespace sl {
         */
         virtual int read(void* buffer, size_t size) = 0;
 
+        /**
+        * Read data from the chanel along with the time it was captured
+        * The network channels report the kernel receive time of the latest data read (Linux only),
+        * the sample timestamps are then based on it instead of the time the data gets decoded
+        * \param rxTimestamp_uS The capture time in the time base of the sample timestamps, 0 if unknown
+        * \return Bytes read (negative for read failure)
+        */
+        virtual int readTimestamped(void* buffer, size_t size, sl_u64& rxTimestamp_uS)
+        {
+            rxTimestamp_uS = 0;
+            return read(buffer, size);
+        }
+
         /**
         * Clear read cache
         */
         virtual void clearReadCache() = 0;
 
-        virtual int getChannelType() = 0;
+        virtual int getChannelType() = 0;
+
+        /**
+        * Get the native handle (file descriptor) used by the channel
+        * \return The native handle, -1 if the channel is not opened or there is no such handle
+        */
+        virtual int getNativeHandle() { return -1; }
+
+    private:
+
+    };
+
+    /**
+    * Abstract interface of serial port channel
+    */
+    class ISerialPortChannel : public IChannel
+    {
+    public:
+        virtual ~ISerialPortChannel() {}
+
+    public:
+        virtual void setDTR(bool dtr) = 0;
+
+        /**
+        * Query the settings of the opened port that the serial driver applies
+        * \return SL_RESULT_OPERATION_NOT_SUPPORT if the platform or the driver cannot report them
+        */
+        virtual sl_result getSerialPortSettings(SerialPortSettings& settings) { return SL_RESULT_OPERATION_NOT_SUPPORT; }
+    };
+
+    /**
+    * Create a serial channel
+    * \param device Serial port device
+    *                   e.g. on Windows, it may be com3 or \\.\com10
+    *                   on Unix-Like OS, it may be /dev/ttyS1, /dev/ttyUSB2, etc
+    * \param baudrate Baudrate
+    *                   Please refer to the datasheet for the baudrate (maybe 115200 or 256000)
+    */
+    Result<IChannel*> createSerialPortChannel(const std::string& device, int baudrate);
+
+    /**
+    * Create a serial channel with the given tuning
+    * \param options The tuning applied each time the channel is opened
+    */
+    Result<IChannel*> createSerialPortChannel(const std::string& device, int baudrate, const SerialPortOptions& options);
+
+    /**
+    * Create a channel to a CP210x USB to UART bridge (10c4:ea60) that bypasses the tty layer through libusb
+    * The baudrate and the DTR line are set with the vendor requests of the bridge and the received data is read
+    * by the bulk-IN transfers kept in flight. The kernel driver is detached from the bridge while the channel is open.
+    * The driver controls it as a serial port: it is an ISerialPortChannel of type CHANNEL_TYPE_SERIALPORT.
+    * \param device The bridge: "" for the first one found, "bus:address" as listed by lsusb (e.g. "1:4") or its serial number
+    * \param options The transfers, see UsbChannelOptions
+    *               Note: only built with WITH_LIBUSB=1 (see README), SL_RESULT_OPERATION_NOT_SUPPORT otherwise
+    */
+    Result<IChannel*> createCp210xUsbChannel(const std::string& device, int baudrate, const UsbChannelOptions& options);
+
+    /**
+    * Create a TCP channel
+    * \param ip IP address of the device
+    * \param port TCP port
+    */
+    Result<IChannel*> createTcpChannel(const std::string& ip, int port);
+
+    /**
+    * Create a TCP channel with the given tuning
+    * \param options The tuning applied each time the channel is opened
+    */
+    Result<IChannel*> createTcpChannel(const std::string& ip, int port, const TcpChannelOptions& options);
+
+    /**
+    * Create a UDP channel
+    * \param ip IP address of the device
+    * \param port UDP port
+    */
+    Result<IChannel*> createUdpChannel(const std::string& ip, int port);
+
+    /**
+    * Create a UDP channel with the given tuning
+    * \param options The tuning applied each time the channel is opened
+    */
+    Result<IChannel*> createUdpChannel(const std::string& ip, int port, const UdpChannelOptions& options);
+
+    /**
+    * Traffic counters of a shared UDP endpoint, see IUdpEndpoint::getStats
+    */
+    struct UdpEndpointStats
+    {
+        sl_u64  datagrams;                  // datagrams received on the shared socket
+        sl_u64  bytes;
+        sl_u64  batches;                    // batched reads that returned datagrams
+        sl_u64  unknown_source_datagrams;   // datagrams from a sender without an open channel, discarded
+        sl_u64  dropped_datagrams;          // datagrams discarded because the queue of their channel was full
+    };
+
+    /**
+    * A local UDP port shared by several LIDARs, see createUdpEndpoint
+    * A single rx thread drains the socket in batches and queues each datagram to the channel of its sender,
+    * so the devices cost one socket and one thread instead of one of each per device
+    */
+    class IUdpEndpoint
+    {
+    public:
+        virtual ~IUdpEndpoint() {}
+
+    public:
+        /**
+        * Create a channel to a device over the shared socket, used like the one of createUdpChannel
+        * The channel receives the datagrams sent from ip:port while it is open, a sender is routed to one open channel at most
+        * The channels must be deleted before the endpoint
+        * \param ip IP address of the device
+        * \param port UDP port of the device
+        */
+        virtual Result<IChannel*> createChannel(const std::string& ip, int port) = 0;
+
+        virtual void getStats(UdpEndpointStats& stats) = 0;
+    };
+
+    /**
+    * Create a UDP endpoint receiving from several devices on one local port
+    * \param ip The local address to bind, 0.0.0.0 (or :: for IPv6) for all the interfaces
+    * \param port The local port, the devices answer to it as the commands are sent from it
+    * \param options The tuning of the shared socket, size its receive buffer for all the devices
+    */
+    Result<IUdpEndpoint*> createUdpEndpoint(const std::string& ip, int port, const UdpChannelOptions& options);
+
+    /**
+    * Create a channel replaying a recording made by ILidarDriver::startRecording
+    * \param path The recording, a raw capture of the rx data is also accepted
+    * \param speed The replay speed relative to the recorded timing, 0 to replay as fast as the driver reads
+    *              The data recorded after a command is held until the driver sends the same command
+    */
+    Result<IChannel*> createReplayChannel(const std::string& path, float speed = 1.0f);
+
+    /**
+    * Settings of a simulated device
+    */
+    struct LidarSimulatorConfig
+    {
+        // the answer of the typical scan mode, one of SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ,
+        // SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED or SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED
+        sl_u8   ans_type;
+
+        // samples per second
+        sl_u32  sample_rate;
+
+        // rotations per second, can also be changed by ILidarDriver::setMotorSpeed
+        float   scan_frequency;
+
+        // stamp the received data with the time its samples were due instead of the time it is read, so that the
+        // sample timestamps are the simulated measurement times and the driver latency can be taken from them
+        bool    generation_timestamps;
+    };
+
+    /**
+    * Create a channel to a simulated device for the tests without hardware
+    * The device answers the device info, health and configuration queries, and streams the scans
+    * of a rectangular room once scanning is started, in the standard mode or the given capsules.
+    */
+    Result<IChannel*> createSimulatorChannel(const LidarSimulatorConfig& config);
+
+    enum MotorCtrlSupport
+    {
+        MotorCtrlSupportNone = 0,
+        MotorCtrlSupportPwm = 1,
+        MotorCtrlSupportRpm = 2,
+    };
+
+    enum ChannelType{
+        CHANNEL_TYPE_SERIALPORT = 0x0,
+        CHANNEL_TYPE_TCP = 0x1,
+        CHANNEL_TYPE_UDP = 0x2,
+        CHANNEL_TYPE_REPLAY = 0x3,
+        CHANNEL_TYPE_SIMULATOR = 0x4,
+    };
+
+        /**
+    * Lidar motor info
+    */
+    struct LidarMotorInfo
+    {
+        MotorCtrlSupport motorCtrlSupport;
+
+        // Desire speed
+        sl_u16 desired_speed;
+
+        // Max speed 
+        sl_u16 max_speed;
+
+        // Min speed
+        sl_u16 min_speed;
+    };
+
+    /**
+    * The answer of a command sent by ILidarDriver::sendCommandAsync
+    */
+    struct LidarCommandAnswer
+    {
+        // SL_RESULT_OK once answered, SL_RESULT_OPERATION_TIMEOUT or the failure otherwise
+        sl_result result;
+
+        std::vector<sl_u8> payload;
+    };
+
+    /**
+    * Receives the answer of a command sent by ILidarDriver::sendCommandAsync in place of the future
+    */
+    typedef std::function<void(const LidarCommandAnswer& answer)> LidarCommandAnswerHandler;
+
+    /**
+    * The decoding counters of one sample data format, see ILidarDriver::getDecodeStats
+    */
+    struct LidarSampleDecodeStats
+    {
+        sl_u8   ans_type;           // the answer type of the sample packets, e.g. SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED
+        sl_u64  packets;            // the packets passed the checksum
+        sl_u64  checksum_errors;    // the packets dropped for a bad checksum
+        sl_u64  encoder_resets;     // the unexpected start of a new scan within a capsule stream
+        sl_u64  resyncs;            // the broken packet headers
+        sl_u64  skipped_bytes;      // the bytes dropped while hunting for a packet header
+        sl_u64  capsule_discards;   // the cached capsules dropped before their nodes were decoded
+        sl_u64  region_skips;       // the packets not decoded as they are out of the scan region, see ILidarDriver::setScanRegion
+    };
+
+    enum {
+        LIDAR_DECODE_STATS_MAX_SAMPLE_TYPES = 8,
+    };
+
+    /**
+    * A snapshot of the decoding counters since the driver was created, see ILidarDriver::getDecodeStats
+    */
+    struct LidarDecodeStats
+    {
+        sl_u64  rx_bytes;           // the bytes fed into the protocol decoder
+        sl_u64  messages;           // the decoded answer messages
+        sl_u64  skipped_bytes;      // the bytes dropped while hunting for an answer header
+        sl_u64  decoder_resets;
+
+        // the counters of each sample data format the driver can decode
+        LidarSampleDecodeStats samples[LIDAR_DECODE_STATS_MAX_SAMPLE_TYPES];
+        size_t  sample_type_count;
+    };
+
+    /**
+    * The occupancy of the ring holding the received data until it is decoded, see ILidarDriver::getRxQueueStats
+    */
+    struct LidarRxQueueStats
+    {
+        size_t  capacity;           // in bytes
+        size_t  pending_bytes;      // waiting for the decoder now
+        size_t  high_water_bytes;   // the most waiting for the decoder since the channel was opened
+        sl_u64  overflow_count;     // the times received data was dropped as the ring was full, since the driver was created
+        sl_u64  overflow_bytes;
+    };
+
+    /**
+    * The sector of the samples decoded, see ILidarDriver::setScanRegion
+    */
+    struct LidarScanRegion
+    {
+        float   start_deg;      // in the angle of the nodes
+        float   span_deg;       // from start_deg in the direction the angle grows, 360 for the full circle
+    };
+
+    /**
+    * The mapping of the device clock into the sdk clock, see ILidarDriver::getDeviceClockStats
+    * It is fitted by least squares over the newest 64 sample packets carrying a device timestamp.
+    */
+    struct LidarDeviceClockStats
+    {
+        bool    locked;         // the sample times follow the device clock
+        sl_u64  packets;        // the device timestamps fitted since the scan was started
+        sl_s64  offset_uS;      // the sdk time minus the device time at the newest packet
+        float   drift_ppm;      // how much faster the sdk clock runs than the device clock
+        float   residual_uS;    // the rms distance of the host times of the packets to the fit, their reception jitter
+    };
+
+    /**
+    * The revolution period measured between the sync samples of consecutive scans, see ILidarDriver::getScanRateStats
+    * The smoothed values are exponentially weighted moving averages over about 8 revolutions
+    */
+    struct LidarScanRateStats
+    {
+        sl_u64  revolutions;        // measured since the scan was started, the other fields are 0 until the first one
+        float   frequency_hz;       // of the smoothed period
+        float   period_uS;          // smoothed
+        float   last_period_uS;
+        float   jitter_uS;          // smoothed standard deviation of the periods
+        float   min_period_uS;
+        float   max_period_uS;
+    };
+
+    /**
+    * The stages of the receive pipeline timed by the latency profiling, see ILidarDriver::getLatencyStats
+    * Each stage includes the stages it calls, e.g. the codec decoding includes the unpacker decoding
+    */
+    enum LidarLatencyStage
+    {
+        LIDAR_LATENCY_STAGE_RX_READ = 0,            // reading the received bytes from the channel
+        LIDAR_LATENCY_STAGE_RX_QUEUE = 1,           // the received bytes waiting for the decoder thread
+        LIDAR_LATENCY_STAGE_CODEC_DECODE = 2,       // decoding the received bytes into messages
+        LIDAR_LATENCY_STAGE_UNPACKER_DECODE = 3,    // decoding a sample message into nodes
+        LIDAR_LATENCY_STAGE_SCAN_PUBLISH = 4,       // publishing a completed scan, including the scan listener
+        LIDAR_LATENCY_STAGE_CONSUMER_GRAB = 5,      // a completed scan waiting to be grabbed
+        LIDAR_LATENCY_STAGE_COUNT = 6,
+    };
+
+    /**
+    * The latency distribution of one stage, the percentiles are accurate to 1/8 of their value
+    */
+    struct LidarLatencyStats
+    {
+        sl_u64  count;
+        sl_u64  sum_uS;
+        sl_u64  max_uS;
+        sl_u64  p50_uS;
+        sl_u64  p90_uS;
+        sl_u64  p99_uS;
+        sl_u64  p999_uS;
+    };
+
+    /**
+    * The layouts a scan can be kept in by the driver, see ILidarDriver::setScanLayout
+    */
+    enum LidarScanLayout
+    {
+        LIDAR_SCAN_LAYOUT_AOS = 0x1,     // array of sl_lidar_response_measurement_node_hq_t
+        LIDAR_SCAN_LAYOUT_SOA = 0x2,     // LidarScanSoA
+        LIDAR_SCAN_LAYOUT_AOS_SOA = 0x3,
+    };
+
+    /**
+    * The consumer paths the decoded samples are pushed into, see ILidarDriver::setSamplePaths
+    */
+    enum LidarSamplePath
+    {
+        LIDAR_SAMPLE_PATH_SCANS    = 0x1,   // the complete scans: the grabs, the leases, the scan listener and the scan history
+        LIDAR_SAMPLE_PATH_INTERVAL = 0x2,   // the raw sample stream of getScanDataWithIntervalHq
+        LIDAR_SAMPLE_PATH_SECTORS  = 0x4,   // the sectors of setSectorListener
+        LIDAR_SAMPLE_PATH_ALL      = 0x7,
+    };
+
+    /**
+    * What a sample path does with the new data while its consumer has not read the older one yet, see ILidarDriver::setBackpressurePolicy
+    */
+    enum LidarBackpressurePolicy
+    {
+        LIDAR_BACKPRESSURE_DROP_OLDEST = 0, // the new data replaces the data not read, the default
+        LIDAR_BACKPRESSURE_DROP_NEWEST = 1, // the data not read is kept, the new data is dropped
+        LIDAR_BACKPRESSURE_BLOCK       = 2, // the decoder waits for the consumer, for the offline recordings and the replays
+    };
+
+    /**
+    * The data dropped or held back for the slow consumers since the driver was created, see ILidarDriver::getBackpressureStats
+    */
+    struct LidarBackpressureStats
+    {
+        sl_u64  scans_dropped;      // the complete scans never grabbed, replaced or discarded by the policy of the scan path
+        sl_u64  samples_dropped;    // the samples of getScanDataWithIntervalHq never read, as getScanDataWithIntervalDroppedCount
+        sl_u64  rx_dropped_bytes;   // the received bytes dropped with the rx queue full
+        sl_u64  blocked_uS;         // the time the decoder and the rx threads waited for the consumers
+        sl_u64  block_timeouts;     // the waits cut by maxBlockMs, their data was dropped as with LIDAR_BACKPRESSURE_DROP_OLDEST
+    };
+
+    /**
+    * The position of a reader in the raw sample stream, see ILidarDriver::openSampleCursor
+    * Each reader keeps a cursor of its own, so the readers all get every sample instead of taking them from each other
+    */
+    struct LidarSampleCursor
+    {
+        sl_u64  sequence;       // the position of the next sample to read, the samples are numbered from 0 on as they are pushed
+        sl_u64  missed_count;   // the samples overwritten before this reader got to them since the cursor was opened
+    };
+
+    /**
+    * The samples read by ILidarDriver::readSamples, in place in the ring: in two runs when they wrap around its end
+    */
+    struct LidarSampleSpan
+    {
+        const sl_lidar_response_measurement_node_hq_t* nodes[2];
+        const sl_u64* timestamps_uS[2];
+        size_t  counts[2];
+        sl_u64  sequence;       // the position of the first sample, see ILidarDriver::isSampleSpanValid
+        sl_u64  missed_count;   // the samples overwritten just before the span since the previous read of the cursor
+    };
+
+    /**
+    * The preparation of the driver for a real-time host, see ILidarDriver::setRealtimeOptions
+    */
+    struct LidarRealtimeOptions
+    {
+        bool    prefault_buffers;       // the buffers are allocated and their pages touched at connect and startScan
+        bool    lock_memory;            // the pages of the process, present and future, are locked in RAM
+        size_t  thread_stack_prefault;  // the bytes of stack touched by each SDK thread as it starts, 0 for none
+    };
+
+    enum {
+        LIDAR_PACED_DELIVERY_MAX_DEPTH = 8,
+    };
+
+    /**
+    * The constant period delivery of the scans to the scan listener, see ILidarDriver::setPacedDelivery
+    */
+    struct LidarPacedDeliveryOptions
+    {
+        // the scans the jitter buffer fills up with before delivering, up to LIDAR_PACED_DELIVERY_MAX_DEPTH,
+        // 0 to deliver each scan as soon as it is complete
+        sl_u32  buffer_depth;
+        // the bound of the latency added by the buffer in milliseconds, 0 for none: the scans waiting longer are
+        // skipped while a newer one is buffered
+        sl_u32  max_added_latency_ms;
+    };
+
+    /**
+    * The counters of the paced delivery since it was enabled, see ILidarDriver::getPacedDeliveryStats
+    */
+    struct LidarPacedDeliveryStats
+    {
+        sl_u64  delivered;
+        sl_u64  dropped;        // the scans arriving with the buffer full or skipped over the latency bound
+        sl_u64  underruns;      // the times the buffer ran empty and filled up again before delivering
+        sl_u32  period_uS;      // the delivery period, from the measured rotation
+        // the delivery time minus the time of the last sample of each scan, on the clock of the samples, see ILidarDriver::setClock
+        LidarLatencyStats latency;
+    };
+
+    /**
+    * Structure-of-arrays form of the raw nodes of a scan, each array is aligned to 64 bytes
+    */
+    struct LidarScanSoA
+    {
+        const float*  angle_rad;
+        const float*  range_m;      // 0 for the invalid nodes
+        const sl_u8*  quality;
+        const sl_u64* timestamps_uS;
+        size_t  count;
+    };
+
+    /**
+    * Read-only view of one complete 360 degrees' scan held by the driver
+    */
+    struct LidarScanData
+    {
+        // the nodes of the scan, the first one is the first sample of the scan (start_bit == 1) unless the scan is ascended
+        const sl_lidar_response_measurement_node_hq_t* nodes;
+
+        // the estimated sample time of each node
+        const sl_u64* timestamps_uS;
+        size_t  count;
+
+        // timestamp of the first node, see ILidarDriver::grabScanDataHqWithTimeStamp
+        sl_u64  timestamp_uS;
+
+        // the latest sample time of the scan
+        sl_u64  end_timestamp_uS;
+
+        // increases by one for each scan completed by the driver, gaps indicate the scans not grabbed
+        sl_u64  sequence;
+
+        // the scan resampled into fixed angle bins, see ILidarDriver::setScanBinning; NULL if binning is off
+        // bin i covers the angles within [i, i+1) * 360 / bin_count degree
+        const sl_lidar_response_measurement_node_hq_t* bins;
+        const sl_u64* bin_timestamps_uS;
+        size_t  bin_count;
+
+        // the raw nodes in the SoA layout, see ILidarDriver::setScanLayout; all NULL if not enabled
+        LidarScanSoA soa;
+
+        // the samples received beyond the capacity of the scan, each one replaced the last raw node,
+        // see ILidarDriver::setScanCapacity
+        size_t  overflow_count;
+
+        // the samples received in the scan, kept as nodes or not
+        size_t  sample_count;
+
+        // the samples of the revolution at the sample rate of the scan mode, from the time between the sync of this scan
+        // and the next one; 0 if unknown. Fewer samples received than expected were lost on the way
+        size_t  expected_sample_count;
+
+        // the steps between two consecutive samples wider than 4 sample steps of the previous revolution,
+        // and the widest step in degree
+        size_t  gap_count;
+        float   max_gap_deg;
+
+        // the sample packets discarded for checksum errors while the scan was received
+        size_t  discarded_packet_count;
+
+        // the nodes in x / y in meter like convertScanToCartesian, each one moved by the motion of the LIDAR since the start
+        // of the scan, see ILidarDriver::setScanDeskewPoseProvider; NULL if the de-skew is off.
+        // They follow the nodes, or the SoA arrays if the scan is only kept in the SoA layout
+        const float* deskewed_x_m;
+        const float* deskewed_y_m;
+        size_t  deskewed_count;
+
+        // the samples removed by the filter chain, see ILidarDriver::setScanFilters
+        size_t  filtered_count;
+
+        // the nodes and the SoA arrays are in ascending angle order as ascendScanData leaves them, see ILidarDriver::setScanAscending
+        bool    ascended;
+    };
+
+    /**
+    * How the node of each fixed angle bin is picked from the samples fallen into it, see ILidarDriver::setScanBinning
+    * A sample with distance is always preferred to one without
+    */
+    enum LidarScanBinPolicy
+    {
+        LIDAR_SCAN_BIN_NEAREST_ANGLE = 0, // the sample closest to the center of the bin
+        LIDAR_SCAN_BIN_MIN_RANGE = 1,
+        LIDAR_SCAN_BIN_MAX_RANGE = 2,
+    };
+
+    enum {
+        // the poses asked to ILidarPoseProvider for each scan, evenly spread over the scan
+        LIDAR_DESKEW_POSE_COUNT = 33,
+        LIDAR_DESKEW_MAX_POSE_COUNT = 256,
+    };
+
+    /**
+    * A pose of the LIDAR in the x / y frame of convertScanToCartesian, see ILidarPoseProvider
+    */
+    struct LidarPose2D
+    {
+        float   x_m;
+        float   y_m;
+        float   yaw_rad;        // from x towards y
+    };
+
+    /**
+    * The velocity of the LIDAR in the x / y frame of convertScanToCartesian, see ILidarDriver::setScanDeskewTwist
+    */
+    struct LidarTwist2D
+    {
+        float   vx_mps;
+        float   vy_mps;
+        float   yaw_rate_radps; // from x towards y
+    };
+
+    /**
+    * Gives the motion of the LIDAR during each scan to the de-skew, see ILidarDriver::setScanDeskewPoseProvider
+    */
+    class ILidarPoseProvider
+    {
+    public:
+        virtual ~ILidarPoseProvider() {}
+
+    public:
+        /**
+        * Fill the poses of the LIDAR at the given times, relative to its pose at the first of them, the start of the scan
+        * Called on the decoder thread once per completed scan with LIDAR_DESKEW_POSE_COUNT times, it must return quickly.
+        * \return false to publish the scan without the de-skewed points
+        */
+        virtual bool getRelativePoses(const sl_u64* timestamps_uS, size_t count, LidarPose2D* poses) = 0;
+    };
+
+    /**
+    * The filters of the chain run on each completed scan, see ILidarDriver::setScanFilters
+    */
+    enum LidarScanFilterType
+    {
+        LIDAR_SCAN_FILTER_DROP_INVALID = 0, // drops the samples without distance or with quality 0
+        LIDAR_SCAN_FILTER_RANGE_LIMIT = 1,  // drops the samples out of [min_range_m, max_range_m]
+        LIDAR_SCAN_FILTER_MEDIAN = 2,       // replaces each range by the median of the window of samples around it
+        LIDAR_SCAN_FILTER_OUTLIER = 3,      // drops the samples farther than max_deviation_m from both of their neighbours
+    };
+
+    enum {
+        LIDAR_SCAN_FILTER_MAX_COUNT = 16,
+        LIDAR_SCAN_FILTER_MAX_WINDOW = 9,
+    };
+
+    /**
+    * One filter of the chain, only the fields of its type are used
+    */
+    struct LidarScanFilter
+    {
+        sl_u32  type;               // LidarScanFilterType
+        float   min_range_m;        // LIDAR_SCAN_FILTER_RANGE_LIMIT
+        float   max_range_m;
+        sl_u32  window;             // LIDAR_SCAN_FILTER_MEDIAN, an odd sample count from 3 to LIDAR_SCAN_FILTER_MAX_WINDOW
+        float   max_deviation_m;    // LIDAR_SCAN_FILTER_OUTLIER
+    };
+
+    /**
+    * Reference counted handle of a scan lent by the driver, see ILidarDriver::grabScanDataHqLease
+    * The data stays valid and unchanged as long as any copy of the handle is alive.
+    * The buffer is recycled by the driver once the last copy is released, so release it as soon as possible.
+    * It is safe to keep the handle after the driver has been disposed
+    */
+    typedef std::shared_ptr<const LidarScanData> LidarScanLease;
+
+    /**
+    * Handle of the operating system an event loop can wait on, see ILidarDriver::getScanReadyHandle
+    * A file descriptor to poll for reading on Linux and macOS, an event HANDLE on Windows
+    */
+#ifdef _WIN32
+    typedef void* LidarWaitHandle;
+#else
+    typedef int LidarWaitHandle;
+#endif
+
+    /**
+    * Listener of the complete scans, see ILidarDriver::setScanListener
+    */
+    class IScanListener
+    {
+    public:
+        virtual ~IScanListener() {}
+
+    public:
+        /**
+        * Called each time a complete 360 degrees' scan is formed
+        * \param scan          The handle of the scan, it can be kept after the call returns
+        * \param timestamp_uS  The timestamp of the first node of the scan
+        */
+        virtual void onScanComplete(const LidarScanLease& scan, sl_u64 timestamp_uS) = 0;
+    };
+
+    /**
+    * One angular sector of a scan, see ILidarDriver::setSectorListener
+    */
+    struct LidarScanSector
+    {
+        const sl_lidar_response_measurement_node_hq_t* nodes;
+
+        // the estimated sample time of each node
+        const sl_u64* timestamps_uS;
+        size_t  count;
+
+        // the sector covers the angles within [start_angle, end_angle) in degree,
+        // starting from sector_index 0 at 0 degree
+        size_t  sector_index;
+        float   start_angle;
+        float   end_angle;
+
+        // increases by one for each revolution
+        sl_u64  scan_sequence;
+    };
+
+    /**
+    * Listener of the scan sectors, see ILidarDriver::setSectorListener
+    */
+    class ISectorListener
+    {
+    public:
+        virtual ~ISectorListener() {}
+
+    public:
+        /**
+        * Called each time a sector is complete
+        * \param sector  The sector data, only valid during the call
+        */
+        virtual void onSectorComplete(const LidarScanSector& sector) = 0;
+    };
+
+    /**
+    * Report of a recovery from a channel error, see ILidarDriver::setAutoRecovery
+    */
+    struct LidarRecoveryEvent
+    {
+        // the error the channel failed with
+        sl_result error;
+        // SL_RESULT_OK once reconnected, the reason the recovery was given up otherwise
+        sl_result result;
+        sl_u32    attempts;
+        // from the failure to the reconnection, including the restart of the scan
+        sl_u64    downtime_uS;
+        // a scan was running and has been restarted with the same mode, options and motor speed
+        bool      scan_resumed;
+    };
+
+    /**
+    * How long the answers of the device queries are reused, see ILidarDriver::setQueryCache
+    * An answer younger than its max age is returned without sending the command, 0 to always ask the device.
+    */
+    struct LidarQueryCacheOptions
+    {
+        sl_u32  health_max_age_ms;
+        sl_u32  device_info_max_age_ms;
+        sl_u32  motor_info_max_age_ms;
+    };
+
+    /**
+    * The calls of getHealth, getDeviceInfo and getMotorInfo since the driver was created, see ILidarDriver::getQueryStats
+    */
+    struct LidarQueryStats
+    {
+        sl_u64  commands;   // the calls sending their query to the device
+        sl_u64  coalesced;  // the calls given the answer of the same query in flight for another caller
+        sl_u64  cached;     // the calls answered from the cache of setQueryCache
+    };
+
+    /**
+    * The counters of the recoveries and the stalls since the driver was created, see ILidarDriver::getRecoveryStats
+    */
+    struct LidarRecoveryStats
+    {
+        sl_u64  recoveries;     // the channel failures reconnected by setAutoRecovery
+        sl_u64  failures;       // the recoveries given up or stopped before reconnecting
+        sl_u64  attempts;       // the reconnect attempts of all the recoveries
+        sl_u64  downtime_uS;    // summed over the recoveries, from the failure to the end of the recovery
+        sl_u64  stalls;         // the stalls detected by setStallWatchdog
+    };
+
+    /**
+    * Listener of the recoveries, see ILidarDriver::setAutoRecovery
+    */
+    class IRecoveryListener
+    {
+    public:
+        virtual ~IRecoveryListener() {}
+
+    public:
+        /**
+        * Called on the recovery thread of the driver once a recovery is over
+        */
+        virtual void onRecovery(const LidarRecoveryEvent& event) = 0;
+    };
+
+    /**
+    * A stop of the sample stream, see ILidarDriver::setStallWatchdog
+    */
+    struct LidarStallEvent
+    {
+        // the time the last sample packet was received at
+        sl_u64  last_packet_uS;
+        // the silence of the stream when the stall was detected
+        sl_u64  silence_uS;
+        // the silence allowed by the sample cadence of the scan mode
+        sl_u64  threshold_uS;
+        // the reconnect of setAutoRecovery has been started for it
+        bool    recovery_started;
+    };
+
+    /**
+    * Listener of the stalls of the sample stream, see ILidarDriver::setStallWatchdog
+    */
+    class IStallListener
+    {
+    public:
+        virtual ~IStallListener() {}
+
+    public:
+        /**
+        * Called on the watchdog thread of the driver once the stream has been silent for longer than the threshold
+        */
+        virtual void onStreamStalled(const LidarStallEvent& event) = 0;
+
+        /**
+        * Called on the watchdog thread of the driver once the samples of a stalled stream arrive again
+        * \param stall_uS  The time without any sample
+        */
+        virtual void onStreamResumed(sl_u64 stall_uS) {}
+    };
+
+    /**
+    * Where a custom sample handler publishes what it decodes, see ILidarSampleHandler
+    * It is only valid during the ILidarSampleHandler::onSampleData call it is given to.
+    */
+    class ILidarSampleSink
+    {
+    public:
+        virtual ~ILidarSampleSink() {}
+
+    public:
+        /**
+        * The capture time of the packet being decoded, the timestamps of its samples are based on it
+        */
+        virtual sl_u64 getPacketTimestamp_uS() = 0;
+
+        /**
+        * Add decoded samples to the scans, as the built in formats do
+        * A revolution starts at the node flagged with SL_LIDAR_RESP_HQ_FLAG_SYNCBIT.
+        */
+        virtual void publishNodes(const sl_lidar_response_measurement_node_hq_t* nodes, const sl_u64* timestamps_uS, size_t count) = 0;
+
+        /**
+        * Drop the samples of the scan in progress, e.g. on an encoder reset of the device
+        */
+        virtual void publishScanReset() = 0;
+
+        /**
+        * Hand a payload that is not made of samples to the ICustomSampleListener as is
+        * \param payload  It may point into the packet, it is not copied
+        */
+        virtual void publishCustomData(sl_u32 customCode, const void* payload, size_t size) = 0;
+
+        /**
+        * Report a packet failing its checksum, it is counted as one by ILidarDriver::getDecodeStats
+        */
+        virtual void publishDecodingError(const void* packet, size_t size) = 0;
+    };
+
+    /**
+    * The decoder of the sample packets of a custom answer type, see ILidarDriver::registerSampleHandler
+    * It is called on the decoder thread of the driver only.
+    */
+    class ILidarSampleHandler
+    {
+    public:
+        virtual ~ILidarSampleHandler() {}
+
+    public:
+        /**
+        * Decode a sample packet of the answer type the handler is registered for
+        * \param data  The payload, pointing into the rx buffer of the driver; only valid during the call
+        */
+        virtual void onSampleData(ILidarSampleSink& sink, const sl_u8* data, size_t size) = 0;
+
+        /**
+        * Drop any state carried over from the previous packets, the stream starts again
+        */
+        virtual void reset() {}
+
+        /**
+        * The sample duration of the scan mode being started, in microseconds
+        */
+        virtual void onSampleDurationChanged(sl_u64 sampleDuration_uS) {}
+    };
+
+    /**
+    * Creates the handlers of a custom answer type, one for each driver it is registered with
+    */
+    class ILidarSampleHandlerFactory
+    {
+    public:
+        virtual ~ILidarSampleHandlerFactory() {}
+
+    public:
+        /**
+        * NULL when it cannot be created
+        */
+        virtual ILidarSampleHandler* createHandler(sl_u8 ansType) = 0;
+
+        /**
+        * Called once the driver is done with a handler, when it is replaced or the driver is disposed
+        */
+        virtual void releaseHandler(ILidarSampleHandler* handler) = 0;
+    };
+
+    /**
+    * Listener of the payloads published by the custom sample handlers, see ILidarDriver::setCustomSampleListener
+    */
+    class ICustomSampleListener
+    {
+    public:
+        virtual ~ICustomSampleListener() {}
+
+    public:
+        /**
+        * Called on the decoder thread of the driver
+        * \param payload       As published by the handler, only valid during the call
+        * \param timestamp_uS  The capture time of the packet it was decoded from
+        */
+        virtual void onCustomSampleData(sl_u8 ansType, sl_u32 customCode, const void* payload, size_t size, sl_u64 timestamp_uS) = 0;
+    };
+
+    /**
+    * User supplied executor to run the callbacks of the driver on
+    */
+    class ILidarExecutor
+    {
+    public:
+        virtual ~ILidarExecutor() {}
+
+    public:
+        /**
+        * Queue the task to run on the executor
+        * Note: it is called on the decoder thread of the driver, it should not block
+        */
+        virtual void execute(const std::function<void()>& task) = 0;
+    };
+
+    /**
+    * The scheduling policy of a thread of the sdk, see LidarThreadConfig
+    */
+    enum LidarThreadSchedPolicy
+    {
+        // the sdk default, a raised priority where the process is allowed to
+        LIDAR_THREAD_SCHED_DEFAULT = 0,
+        // time sharing, the priority is the nice value
+        LIDAR_THREAD_SCHED_OTHER = 1,
+        // real time first in first out, the priority is the real time priority
+        LIDAR_THREAD_SCHED_FIFO = 2,
+        // real time round robin, the priority is the real time priority
+        LIDAR_THREAD_SCHED_RR = 3,
+    };
+
+    /**
+    * How a thread of the sdk is named, pinned and scheduled, all zero keeps the defaults
+    * The settings are applied by the thread itself when it starts, a failing one (e.g. the real time
+    * policies without CAP_SYS_NICE) leaves it unchanged and does not prevent the others.
+    */
+    struct LidarThreadConfig
+    {
+        // the name shown by top and perf, NULL for the sdk default; Linux keeps the first 15 characters
+        const char* name;
+        // bit n allows the thread on cpu n, 0 keeps the affinity of the creating thread
+        // Note: not supported on macOS
+        sl_u64  cpu_affinity_mask;
+        LidarThreadSchedPolicy policy;
+        int     priority;
+    };
+
+    /**
+    * The threads created by a driver for the data reception, see createLidarDriver
+    */
+    struct LidarThreadingOptions
+    {
+        // receives the data from the channel, and decodes it when the decoder runs inline
+        LidarThreadConfig rx_thread;
+        // decodes the received data
+        LidarThreadConfig decoder_thread;
+        // the rx thread decodes the data itself and no decoder thread is created, one thread less per driver
+        // Note: the scan callbacks then run on the rx thread and delay the reception, keep them light
+        bool inline_decode;
+    };
+
+    /**
+    * The I/O backend of a shared reactor, see createLidarIOReactor
+    */
+    enum LidarIOReactorBackend
+    {
+        // the threads wait for the channels to become readable (epoll), each driver reads its channel
+        LIDAR_IO_REACTOR_EPOLL = 0,
+        // the threads keep receive operations armed on an io_uring each (Linux 6.0 or later): the TCP and UDP channels
+        // are received into a shared buffer pool without a syscall per read, the serial ports are polled through the ring
+        LIDAR_IO_REACTOR_IO_URING = 1,
+        // the threads serve a completion port (Windows): several overlapped reads are kept outstanding on each
+        // serial port and socket, so that many LIDARs are received at full rate by a few threads
+        LIDAR_IO_REACTOR_IOCP = 2,
+        // the threads wait for the channels to become readable with kqueue (macOS), each driver reads its channel
+        LIDAR_IO_REACTOR_KQUEUE = 3,
+    };
+
+    /**
+    * Abstract interface of shared I/O reactor
+    * A reactor serves the data reception of several LIDAR drivers with a few shared threads,
+    * instead of the private threads created by each driver
+    */
+    class ILidarIOReactor
+    {
+    public:
+        virtual ~ILidarIOReactor() {}
+
+    public:
+        /**
+        * Get the count of the working threads
+        */
+        virtual size_t getThreadCount() = 0;
+
+        /**
+        * Get the I/O backend serving the channels
+        */
+        virtual LidarIOReactorBackend getBackend() = 0;
+    };
+
+    /**
+    * Create a shared I/O reactor
+    * \param threadCount The count of the working threads
+    * \param backend     The I/O backend, SL_RESULT_OPERATION_NOT_SUPPORT is returned if the kernel does not provide it
+    *                    Note: EPOLL and IO_URING are supported on Linux, IOCP on Windows, KQUEUE on macOS, SL_RESULT_OPERATION_NOT_SUPPORT
+    *                          will be returned for the others; the reactor must be alive until all the drivers using it are disconnected
+    */
+    Result<ILidarIOReactor*> createLidarIOReactor(int threadCount = 1, LidarIOReactorBackend backend = LIDAR_IO_REACTOR_EPOLL);
+
+    /**
+    * Create a shared I/O reactor with the given config of its working threads
+    * \param threads The name, affinity and scheduling of all the working threads, the name is copied
+    */
+    Result<ILidarIOReactor*> createLidarIOReactor(int threadCount, LidarIOReactorBackend backend, const LidarThreadConfig& threads);
+
+    /**
+    * Abstract interface of a shared decode pool
+    * A pool decodes the data received by a shared reactor for several LIDAR drivers, so that the reactor threads
+    * only receive. The data of each LIDAR is decoded in order, by one thread at a time, and the LIDARs are decoded
+    * in parallel: a thread out of work takes the pending LIDARs queued on the busy ones.
+    */
+    class ILidarDecodePool
+    {
+    public:
+        virtual ~ILidarDecodePool() {}
+
+    public:
+        /**
+        * Get the count of the decoding threads
+        */
+        virtual size_t getThreadCount() = 0;
+    };
+
+    /**
+    * Create a shared decode pool, see ILidarDriver::setDecodePool
+    * \param threadCount The count of the decoding threads, up to 16
+    *                    Note: the pool must be alive until all the drivers using it are disconnected
+    */
+    Result<ILidarDecodePool*> createLidarDecodePool(int threadCount);
+
+    /**
+    * Create a shared decode pool with the given config of its threads
+    * \param threads The name, affinity and scheduling of all the decoding threads, the name is copied
+    */
+    Result<ILidarDecodePool*> createLidarDecodePool(int threadCount, const LidarThreadConfig& threads);
+
+    /**
+    * Receiver of the trace events of the sdk internals, e.g. to forward them into Perfetto or LTTng
+    * It is called on the thread producing the event, so it must be thread safe and should not block.
+    * The category and name strings are literals, they stay valid forever.
+    */
+    class ILidarTraceBackend
+    {
+    public:
+        virtual ~ILidarTraceBackend() {}
+
+    public:
+        virtual void onTraceInstant(const char* category, const char* name, sl_u64 timestamp_uS, sl_s64 value) = 0;
+        virtual void onTraceSliceBegin(const char* category, const char* name, sl_u64 timestamp_uS) = 0;
+        virtual void onTraceSliceEnd(const char* category, const char* name, sl_u64 timestamp_uS) = 0;
+    };
+
+    /**
+    * How the received bytes are gathered before being decoded, see ILidarDriver::setRxCoalescing
+    * The default, all zero, passes each chunk on as soon as it arrives for the lowest latency.
+    */
+    struct LidarRxCoalescing
+    {
+        // the bytes to gather before reading, 0 or 1 to read whatever has arrived
+        sl_u32  min_batch_bytes;
+        // the longest wait for min_batch_bytes once some data has arrived, in milliseconds
+        sl_u32  max_wait_ms;
+    };
 
-    private:
+    /**
+    * Set the receiver of the trace events of all the drivers, NULL to stop tracing
+    * \param backend The receiver, it must stay alive until the drivers are disposed
+    *                Note: the events are only compiled in with SL_LIDAR_TRACING defined,
+    *                      SL_RESULT_OPERATION_NOT_SUPPORT will be returned otherwise
+    */
+    sl_result setLidarTraceBackend(ILidarTraceBackend* backend);
 
+    /**
+    * The clock all the sdk timestamps are taken on, see getLidarClockInfo
+    */
+    struct LidarClockInfo
+    {
+        // the clock source, e.g. "CLOCK_MONOTONIC" on Linux
+        const char* clock_name;
+        // the resolution of the clock, in nanoseconds
+        sl_u32  resolution_nS;
+        // the time of the clock when the info was taken, in microseconds
+        sl_u64  now_uS;
+        // added to a sdk timestamp, gives the wall clock time since 1970 in microseconds
+        // (CLOCK_REALTIME, which follows NTP or PTP when the system is synced)
+        sl_s64  realtime_offset_uS;
     };
 
     /**
-    * Abstract interface of serial port channel
+    * Describe the clock of the sample and trace timestamps, to correlate them with ROS or PTP time
+    * The realtime offset is sampled on each call, so it follows the adjustments of the wall clock.
     */
-    class ISerialPortChannel : public IChannel
+    sl_result getLidarClockInfo(LidarClockInfo& info);
+
+    /**
+    * The time base of the sample timestamps of a driver, see ILidarDriver::setClock
+    * It is called on the rx threads for each chunk received, so it must be thread safe and cheap.
+    */
+    class ILidarClock
     {
     public:
-        virtual ~ISerialPortChannel() {}
+        virtual ~ILidarClock() {}
 
     public:
-        virtual void setDTR(bool dtr) = 0;
+        // the current time in microseconds, it must not go backward
+        virtual sl_u64 now_uS() = 0;
+
+        // the capture time the channel reported for a chunk, on the clock of getLidarClockInfo, converted into this
+        // clock; 0 to stamp the chunk with now_uS() instead, like the chunks without a capture time
+        virtual sl_u64 fromHostTime_uS(sl_u64 hostTs_uS) { return 0; }
     };
 
     /**
-    * Create a serial channel
-    * \param device Serial port device
-    *                   e.g. on Windows, it may be com3 or \\.\com10
-    *                   on Unix-Like OS, it may be /dev/ttyS1, /dev/ttyUSB2, etc
-    * \param baudrate Baudrate
-    *                   Please refer to the datasheet for the baudrate (maybe 115200 or 256000)
+    * Get the clock of a replay channel: the recorded capture time of the data last read from it
+    * With it, a replay at any speed gives the samples the timestamps they were recorded with.
+    * \param replayChannel A channel made by createReplayChannel, the clock lives as long as the channel
     */
-    Result<IChannel*> createSerialPortChannel(const std::string& device, int baudrate);
+    Result<ILidarClock*> getReplayChannelClock(IChannel* replayChannel);
 
     /**
-    * Create a TCP channel
-    * \param ip IP address of the device
-    * \param port TCP port
+    * Create a clock in the PTP time domain, so the samples are stamped on the time of the other sensors of a PTP network
+    * The capture times of the channel, such as the kernel receive times of the TCP and UDP channels, are converted with
+    * the offset between the host clock and the PTP clock, which is measured again every 100 ms.
+    * \param device The PTP hardware clock, by its device (e.g. "/dev/ptp0") or by the network interface it belongs to
+    *               (e.g. "eth0"); or "CLOCK_TAI" when phc2sys keeps the system clock on the PTP time
+    *               Note: Linux only, the clock is released with delete once no driver uses it
     */
-    Result<IChannel*> createTcpChannel(const std::string& ip, int port);
+    Result<ILidarClock*> createPtpClock(const std::string& device);
 
     /**
-    * Create a UDP channel
-    * \param ip IP address of the device
-    * \param port UDP port
+    * The memory of the sdk internal buffers: the message buffers, the rx ring, the scan buffers and their leases
+    * It is called from any sdk thread, so it must be thread safe.
     */
-    Result<IChannel*> createUdpChannel(const std::string& ip, int port);
-
-    enum MotorCtrlSupport
+    class ILidarAllocator
     {
-        MotorCtrlSupportNone = 0,
-        MotorCtrlSupportPwm = 1,
-        MotorCtrlSupportRpm = 2,
-    };
+    public:
+        virtual ~ILidarAllocator() {}
 
-    enum ChannelType{
-        CHANNEL_TYPE_SERIALPORT = 0x0,
-        CHANNEL_TYPE_TCP = 0x1,
-        CHANNEL_TYPE_UDP = 0x2,
-    };
+    public:
+        /**
+        * Allocate a block aligned on 16 bytes, NULL when out of memory: the sdk then falls back to the heap
+        */
+        virtual void* allocate(size_t size) = 0;
 
         /**
-    * Lidar motor info
+        * Release a block, size is the one it was allocated with
+        */
+        virtual void deallocate(void* ptr, size_t size) = 0;
+    };
+
+    /**
+    * Create an allocator serving the blocks from a single arena allocated at once
+    * \param capacity The size of the arena in bytes
     */
-    struct LidarMotorInfo
-    {
-        MotorCtrlSupport motorCtrlSupport;
+    Result<ILidarAllocator*> createLidarArenaAllocator(size_t capacity);
 
-        // Desire speed
-        sl_u16 desired_speed;
+    /**
+    * Create an allocator serving the blocks from a memory area of the caller
+    * \param memory The arena, aligned on 16 bytes; it must stay alive until the allocator is disposed
+    * \param size   The size of the arena in bytes
+    */
+    Result<ILidarAllocator*> createLidarArenaAllocator(void* memory, size_t size);
 
-        // Max speed 
-        sl_u16 max_speed;
+    /**
+    * Set the allocator of the internal buffers of all the drivers, NULL for the heap
+    * \param allocator The allocator, it only serves the blocks allocated after the call, and must stay alive
+    *                  until all of them are released: after the drivers, the channels and the scan leases are disposed
+    *                  Note: it is meant to be set once at startup, before any driver is created
+    */
+    sl_result setLidarAllocator(ILidarAllocator* allocator);
 
-        // Min speed
-        sl_u16 min_speed;
+    /**
+    * Counters of the internal allocations, see getLidarAllocationStats
+    */
+    struct LidarAllocationStats
+    {
+        // all the blocks ever allocated
+        sl_u64  allocation_count;
+        // the bytes of the blocks not released yet
+        sl_u64  bytes_in_use;
+        // the blocks allocated while a driver was streaming steady state scans
+        sl_u64  steady_state_allocation_count;
+        // the blocks the user allocator could not serve, allocated from the heap instead
+        sl_u64  fallback_count;
     };
 
+    sl_result getLidarAllocationStats(LidarAllocationStats& stats);
+
+    /**
+    * Abort the process on any internal allocation made while a driver streams steady state scans, to debug
+    * the allocations on systems that must not allocate after startup
+    * A driver reaches the steady state once the first scans after startScan have filled all its scan buffers,
+    * and leaves it on stop() or disconnect().
+    * \param enable Abort with a message on stderr if true, only count them in the stats otherwise
+    */
+    sl_result setLidarAllocationGuard(bool enable);
+
     class ILidarDriver
     {
     public:
@@ -326,10 +1570,35 @@ namespace sl {
         */
         virtual bool isConnected() = 0;
 
+        /**
+        * Use a shared I/O reactor for data reception instead of the private threads of the driver
+        * \param reactor The reactor to use, NULL for the private threads
+        *                Note: it takes effect on the next connect(), the private threads will still be used
+        *                      if the channel has no native handle
+        */
+        virtual sl_result setIOReactor(ILidarIOReactor* reactor) = 0;
+
+        /**
+        * Decode the data received by the shared reactor on a shared decode pool instead of the reactor threads
+        * \param pool The pool to use, NULL to decode on the reactor threads
+        *             Note: it takes effect on the next connect(), and only when the channel is served by a reactor
+        */
+        virtual sl_result setDecodePool(ILidarDecodePool* pool) = 0;
+
+        /**
+        * Trade the latency of the received data for fewer and larger reads and decoder wakeups
+        * \param policy The batching of the private rx thread, it takes effect at once
+        *                Note: the reactor reads what is there, and the channels whose waitForData() does not
+        *                      wait for a byte count, such as TCP and UDP, are read as they report data
+        */
+        virtual sl_result setRxCoalescing(const LidarRxCoalescing& policy) = 0;
+
     public:
         enum
         {
-            DEFAULT_TIMEOUT = 2000
+            DEFAULT_TIMEOUT = 2000,
+            DEFAULT_FIRST_SCAN_TIMEOUT = 5000,
+            DEFAULT_LINKAGE_CALIBRATION_ROUNDS = 16,
         };
 
     public:
@@ -361,6 +1630,45 @@ namespace sl {
         /// \param outUsedScanMode  The scan mode selected by lidar
         virtual sl_result startScanExpress(bool force, sl_u16 scanMode, sl_u32 options = 0, LidarScanMode* outUsedScanMode = nullptr, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
 
+        /// Query the parameters of a scan mode ahead of switchScanMode, the LIDAR does not answer the queries while scanning
+        /// The modes reported by getAllSupportedScanModes and the ones started so far are prepared already.
+        ///
+        /// \param scanMode         The scan mode id
+        virtual sl_result prepareScanMode(sl_u16 scanMode, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Switch the running scan to another scan mode with a minimal data gap
+        ///
+        /// Instead of stop() and startScanExpress(), only the stop and the new scan commands are sent: the motor keeps
+        /// spinning, the timing of the new mode is taken from the prepared parameters, and the scan in progress carries on
+        /// with the samples of the new mode instead of being dropped. The interface returns once the first sample of the
+        /// new mode has arrived, or the timeout has passed.
+        /// Without a running scan or a prepared mode, it stops and starts the scan the usual way.
+        ///
+        /// \param scanMode         The scan mode id (use getAllSupportedScanModes to get supported modes)
+        /// \param options          Scan options (please use 0)
+        /// \param outUsedScanMode  The scan mode switched to
+        /// \param stats            The measured data gap of the switch, NULL if not needed
+        virtual sl_result switchScanMode(sl_u16 scanMode, sl_u32 options = 0, LidarScanMode* outUsedScanMode = nullptr, LidarScanModeSwitchStats* stats = nullptr, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Start the motor and the typical scan mode with as few round trips as possible, for a short boot or recovery
+        ///
+        /// It replaces getDeviceInfo(), getHealth(), startMotor() and startScan(false, true): the device info and the health
+        /// are queried together, the motor probe is answered by the model or the capability cache, the typical scan mode
+        /// and the desired motor speed are queried together unless cached, and the motor spins up while the parameters of
+        /// the scan mode are queried. A stream left running is stopped without the delay of stop().
+        /// The interface returns once the first scan has completed, getStartupTimings() tells the time of each phase.
+        ///
+        /// \param outInfo          The scan mode, the device info and the health, NULL if not needed
+        /// \param firstScanTimeout The time to wait for the first complete scan, 0 to return after the scan command.
+        ///                         The scan keeps running after a timeout.
+        /// \param timeout          The timeout of each query
+        ///
+        /// Note: a health status of SL_LIDAR_STATUS_ERROR fails it with SL_RESULT_OPERATION_FAIL before the motor starts.
+        virtual sl_result startScanFast(LidarStartupInfo* outInfo = nullptr, sl_u32 firstScanTimeout = DEFAULT_FIRST_SCAN_TIMEOUT, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Get the time of each phase of the last startScanFast, the phases not done yet are 0
+        virtual sl_result getStartupTimings(LidarStartupTimings& timings) = 0;
+
         /// Retrieve the health status of the RPLIDAR
         /// The host system can use this operation to check whether RPLIDAR is in the self-protection mode.
         ///
@@ -375,6 +1683,17 @@ namespace sl {
         /// \param timeout       The operation timeout value (in millisecond) for the serial port communication  
         virtual sl_result getDeviceInfo(sl_lidar_response_device_info_t& info, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
 
+        /// Reuse the answers of getHealth, getDeviceInfo and getMotorInfo for a while
+        /// The concurrent calls of one of these queries always share a single command and its answer, whatever the
+        /// options. A caller joining the command of another one waits for it up to its own timeout.
+        /// The cache is cleared on connect and on the reconnections of setAutoRecovery.
+        ///
+        /// \param options      The max age of the answers of each query, all 0 by default
+        virtual sl_result setQueryCache(const LidarQueryCacheOptions& options) = 0;
+
+        /// Get the counters of the commands, the coalesced calls and the cached answers of the device queries
+        virtual sl_result getQueryStats(LidarQueryStats& stats) = 0;
+
         /// Check whether the device support motor control
         /// Note: this API will disable grab.
         /// 
@@ -384,7 +1703,8 @@ namespace sl {
 
         /// Calculate LIDAR's current scanning frequency from the given scan data
         /// Please refer to the application note doc for details
-        /// Remark: the calcuation will be incorrect if the specified scan data doesn't contains enough data
+        /// Remark: the calcuation will be incorrect if the specified scan data doesn't contains enough data,
+        ///         or if some samples are lost; getScanRateStats measures the revolutions instead
         ///
         /// \param scanMode      Lidar's current scan mode
         /// \param nodes         Current scan's measurements
@@ -466,6 +1786,306 @@ namespace sl {
         /// \The caller application can set the timeout value to Zero(0) to make this interface always returns immediately to achieve non-block operation.
         virtual sl_result grabScanDataHqWithTimeStamp(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u64 & timestamp_uS, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
 
+        /// Wait and grab a complete 0-360 degree scan data previously received along with the timestamp of each node.
+        ///
+        /// The timestamps are represented the same way as the one of grabScanDataHqWithTimeStamp, which is the one of the first node.
+        /// They are required to de-skew the scan taken on a moving platform.
+        ///
+        /// \param nodebuffer     Buffer provided by the caller application to store the scan data
+        ///
+        /// \param timestamps_uS  Buffer provided by the caller application to store the sample time of each node, it must hold count entries
+        ///
+        /// \param count          The caller must initialize this parameter to set the max data count of the provided buffers.
+        ///                       Once the interface returns, this parameter will store the actual received data count.
+        /// \param timeout        Max duration allowed to wait for a complete scan data.
+        ///
+        /// The interface will return SL_RESULT_OPERATION_TIMEOUT to indicate that no complete 360-degrees' scan can be retrieved withing the given timeout duration. 
+        virtual sl_result grabScanDataHqWithSampleTimeStamps(sl_lidar_response_measurement_node_hq_t* nodebuffer, sl_u64* timestamps_uS, size_t& count, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Wait and grab a complete 0-360 degree scan data previously received without copying it.
+        ///
+        /// The scan is lent to the caller through a reference counted read-only handle instead of being copied
+        /// into a caller provided buffer. The handle can be shared by several consumers, the scan has the same
+        /// charactistics as the one returned by grabScanDataHqWithTimeStamp.
+        ///
+        /// \param lease          The reference used to store the handle of the scan, it is reset if no scan is grabbed.
+        /// \param timeout        Max duration allowed to wait for a complete scan data.
+        ///
+        /// The interface will return SL_RESULT_OPERATION_TIMEOUT to indicate that no complete 360-degrees' scan can be retrieved withing the given timeout duration. 
+        virtual sl_result grabScanDataHqLease(LidarScanLease& lease, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Grab the newest complete scan if it is newer than the last one the caller got, without waiting
+        ///
+        /// Each completed scan carries a LidarScanData::sequence increasing by one. The poller passes the sequence of the
+        /// last scan it got, and gets the newest scan only if its sequence is above it: a poller calling more often than the
+        /// scans are completed copies each scan once, and gets nothing copied in between. The scan is not consumed, several
+        /// pollers keeping their own sequence each get it, but it is taken from grabScanDataHq like any other grab.
+        ///
+        /// \param sequence       The sequence of the last scan the caller got, 0 for any scan. It is updated to the sequence
+        ///                       of the grabbed scan, a step above one tells the scans missed in between.
+        /// \param nodebuffer     Buffer provided by the caller application to store the scan data
+        /// \param count          The caller must initialize this parameter to set the max data count of the provided buffers.
+        ///                       Once the interface returns, this parameter will store the actual grabbed data count.
+        /// \param timestamps_uS  Buffer to store the sample time of each node, it must hold count entries; NULL if not needed
+        ///
+        /// The interface will return SL_RESULT_OPERATION_TIMEOUT at once if no scan newer than the sequence is there,
+        /// nothing is copied then.
+        virtual sl_result tryGrabScanSince(sl_u64& sequence, sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u64* timestamps_uS = NULL) = 0;
+
+        /// Get a handle that becomes ready whenever a complete scan can be grabbed, for an application event loop
+        ///
+        /// The handle is level triggered: it stays readable (signalled on Windows) while the newest scan has not been grabbed,
+        /// and is cleared by the grab taking it. Wait on it along with the other handles of the loop in poll(), epoll, kqueue
+        /// or WaitForMultipleObjects, then grab the scan with grabScanDataHq, grabScanDataHqWithTimeStamp or grabScanDataHqLease
+        /// and a timeout of 0, which return SL_RESULT_OPERATION_TIMEOUT at once instead of blocking when there is nothing to grab.
+        /// The sectors are still delivered through setSectorListener, an executor of the application can bring them into the loop.
+        ///
+        /// \param handle         The handle, owned by the driver and valid until the driver is disposed. Only wait on it, never read, write or close it.
+        virtual sl_result getScanReadyHandle(LidarWaitHandle& handle) = 0;
+
+        /// Keep the newest scans completed by the driver, to look them up later by sequence or by time
+        ///
+        /// The scans are kept in the buffers they were received in, so each of them holds a scan buffer
+        /// until it is replaced by a newer scan. The history is emptied and resized by startScan and startScanExpress.
+        ///
+        /// \param depth          The scans kept, up to 256; 0 to keep none (the default)
+        virtual sl_result setScanHistoryDepth(size_t depth) = 0;
+
+        /// Lend the scan of the given LidarScanData::sequence from the history without copying it, see setScanHistoryDepth
+        ///
+        /// \param sequence       The sequence of the scan
+        /// \param lease          The reference used to store the handle of the scan, it is reset if the scan is not found.
+        ///
+        /// The interface will return SL_RESULT_OPERATION_NOT_SUPPORT if the history is disabled,
+        /// SL_RESULT_OPERATION_FAIL if the scan is no longer or not yet in the history.
+        virtual sl_result getScanHistoryLeaseBySequence(sl_u64 sequence, LidarScanLease& lease) = 0;
+
+        /// Lend the scan of the history being received at the given time without copying it, see setScanHistoryDepth
+        ///
+        /// It is the newest scan begun at or before the given time, in the time base of LidarScanData::timestamp_uS.
+        ///
+        /// \param timestamp_uS   The time to look up
+        /// \param lease          The reference used to store the handle of the scan, it is reset if the scan is not found.
+        ///
+        /// The interface will return SL_RESULT_OPERATION_NOT_SUPPORT if the history is disabled,
+        /// SL_RESULT_OPERATION_FAIL if the time is before the oldest scan kept or after the end of the newest one.
+        virtual sl_result getScanHistoryLeaseByTimestamp(sl_u64 timestamp_uS, LidarScanLease& lease) = 0;
+
+        /// Lend the newest scans of the history without copying them, the oldest of them first, see setScanHistoryDepth
+        ///
+        /// \param leases         The buffer to store the handles of the scans
+        /// \param count          The size of the buffer, it is updated to the scans lent
+        ///
+        /// The interface will return SL_RESULT_OPERATION_NOT_SUPPORT if the history is disabled.
+        virtual sl_result getRecentScanLeases(LidarScanLease* leases, size_t& count) = 0;
+
+        /// Register a listener to be notified of each complete 0-360 degree scan as soon as it is formed.
+        ///
+        /// It saves the wait-and-wake latency of polling grabScanDataHq, the grab APIs keep working meanwhile.
+        ///
+        /// \param listener       The listener, NULL to unregister the current one.
+        /// \param executor       The executor to deliver the callbacks on, NULL to call the listener directly on the decoder thread.
+        ///
+        /// Note: on the decoder thread, the listener must return quickly and must not call the driver APIs that wait for
+        ///       a response from the LIDAR, otherwise they will time out.
+        ///       The listener will not be called once this interface returns, except by the tasks already passed to the executor.
+        virtual sl_result setScanListener(IScanListener* listener, ILidarExecutor* executor = NULL) = 0;
+
+        /// Register a listener to receive the scan in fixed angular sectors as soon as each sector is complete.
+        ///
+        /// A sector is complete once the first node of the next sector arrives, so the data is delivered
+        /// long before the revolution is closed. Full scan consumers keep working meanwhile.
+        ///
+        /// \param listener       The listener, NULL to unregister the current one.
+        /// \param sectorDegrees  The angular width of each sector, within (0, 360].
+        /// \param executor       The executor to deliver the callbacks on, NULL to call the listener directly on the decoder thread.
+        ///                       The sector data is copied in that case.
+        ///
+        /// The same notes as setScanListener apply.
+        virtual sl_result setSectorListener(ISectorListener* listener, float sectorDegrees = 30.f, ILidarExecutor* executor = NULL) = 0;
+
+        /// Deliver the scans to the scan listener at a constant period rather than as they complete
+        ///
+        /// The completed scans go through a jitter buffer, and a thread of the driver hands the oldest one to the listener
+        /// (or its executor) once per rotation period, measured from the scan timestamps. The delivery starts once the buffer
+        /// is filled, and starts over that way if it runs empty. The phase of the delivery follows the arrival of the scans:
+        /// it drifts towards buffer_depth periods after each scan is completed, or max_added_latency_ms if lower. The time
+        /// the scans are held is measured on the host clock, whatever clock the samples are stamped on.
+        /// The grabs are not affected. The scans buffered are dropped when the delivery is disabled.
+        ///
+        /// \param options        The LidarPacedDeliveryOptions, a buffer_depth of 0 disables the paced delivery
+        virtual sl_result setPacedDelivery(const LidarPacedDeliveryOptions& options) = 0;
+
+        /// Get the counters and the latency distribution of the paced delivery since it was enabled
+        virtual sl_result getPacedDeliveryStats(LidarPacedDeliveryStats& stats) = 0;
+
+        /// Resample each scan into fixed angle bins as the nodes are received
+        ///
+        /// The bins of a scan are available through LidarScanData::bins of the scan leases and listeners.
+        /// An empty bin holds a node without distance at the center angle of the bin.
+        /// The settings take effect from the next scan.
+        ///
+        /// \param binDegrees     The width of each bin, rounded so that the bins divide 360 degrees evenly. 0 to turn binning off.
+        /// \param policy         How the node of each bin is picked.
+        /// \param binsOnly       Keep the bins instead of the raw nodes, the grab APIs and the scan nodes then return the bins.
+        virtual sl_result setScanBinning(float binDegrees, LidarScanBinPolicy policy = LIDAR_SCAN_BIN_NEAREST_ANGLE, bool binsOnly = false) = 0;
+
+        /// Select the layouts the raw nodes of each scan are kept in, LIDAR_SCAN_LAYOUT_AOS by default
+        ///
+        /// The SoA layout is converted on the fly as the nodes are received and published through LidarScanData::soa.
+        /// With LIDAR_SCAN_LAYOUT_SOA only, the node array is never formed, and the grab APIs returning nodes fail
+        /// with SL_RESULT_OPERATION_NOT_SUPPORT unless the bins only mode of setScanBinning is on.
+        /// The setting takes effect from the next scan.
+        virtual sl_result setScanLayout(LidarScanLayout layout) = 0;
+
+        /// Correct the motion of the LIDAR during each scan before the scan is published
+        ///
+        /// The nodes of each completed scan are converted to x / y and moved into the frame of the LIDAR at the start
+        /// of the scan, by the poses the provider gives at LIDAR_DESKEW_POSE_COUNT times evenly spread over the scan,
+        /// interpolated at the sample time of each node. The points are published in LidarScanData::deskewed_x_m and
+        /// deskewed_y_m, so the consumers share them. It replaces the twist set by setScanDeskewTwist.
+        ///
+        /// \param provider      The provider, NULL to turn the de-skew off. The previous one is no longer called once it returns.
+        virtual sl_result setScanDeskewPoseProvider(ILidarPoseProvider* provider) = 0;
+
+        /// Same as setScanDeskewPoseProvider, with the LIDAR moving at a constant velocity during each scan
+        /// The twist can be updated at any time, each scan is corrected by the one set last when it is completed.
+        ///
+        /// \param twist         The velocity of the LIDAR, NULL to turn the de-skew off
+        virtual sl_result setScanDeskewTwist(const LidarTwist2D* twist) = 0;
+
+        /// Run a chain of filters on each completed scan before it is published, so all the consumers get the filtered scan
+        ///
+        /// The filters run in order on the raw nodes and the SoA arrays, the bins of setScanBinning are not filtered.
+        /// The samples dropped are removed from the scan and counted in LidarScanData::filtered_count. The scan is taken
+        /// as a circle, the first and the last samples are neighbours. The median and the outlier filters see the samples
+        /// as they are, so put LIDAR_SCAN_FILTER_DROP_INVALID first to keep the samples without distance out of them.
+        /// The chain takes effect from the next scan.
+        ///
+        /// \param filters       The filters, copied by the driver
+        /// \param count         The count of the filters, up to LIDAR_SCAN_FILTER_MAX_COUNT, 0 to turn the filtering off
+        virtual sl_result setScanFilters(const LidarScanFilter* filters, size_t count) = 0;
+
+        /// Ascend each completed scan before it is published, so the consumers no longer call ascendScanData
+        ///
+        /// The nodes without distance get their angles and the nodes are sorted by angle as ascendScanData does, once for all
+        /// the consumers, on the thread completing the scan (the decoder thread or the decode pool) while the next revolution
+        /// is received. It runs after the filters of setScanFilters and before the de-skew. The timestamps and the SoA arrays
+        /// keep following the nodes, and LidarScanData::ascended is set on the scans ascended. A scan without any distance
+        /// is published as is. The scans of setDeferredDecoding are not ascended, nor are the sectors.
+        /// The setting takes effect from the next scan.
+        ///
+        /// \param enabled       true to ascend the scans, false to keep them in the order they were sampled (the default)
+        virtual sl_result setScanAscending(bool enabled) = 0;
+
+        /// Only decode the samples of a sector of the circle, to save the CPU of the small hosts
+        ///
+        /// The sample packets entirely out of the sector are neither decoded nor published, the others are kept whole, so
+        /// a few samples out of the sector remain near its edges. The packet that crosses 0 degree is always kept, since it
+        /// starts the scans. It applies to the capsule scan modes and the HQ mode, the other modes decode the full circle.
+        /// The samples skipped are left out of LidarScanData::sample_count, and the packets of them counted in LidarSampleDecodeStats::region_skips.
+        /// The region takes effect from the next startScan or startScanExpress.
+        ///
+        /// \param region        The sector, NULL for the full circle
+        virtual sl_result setScanRegion(const LidarScanRegion* region) = 0;
+
+        /// Defer the decoding of the samples to the grab, to keep the decoder thread light on the small hosts
+        ///
+        /// The decoder thread only checks the sample packets and keeps the ones of the newest revolution undecoded.
+        /// grabScanDataHq and its variants decode that revolution in the calling thread, the revolutions not grabbed are
+        /// never decoded. The scans grabbed carry the raw nodes from one sync node to the next, the processing of the
+        /// completed scans (the filters, the bins, the de-skew, the SoA layout) does not apply to them, and the listeners,
+        /// the leases, the scan history and getScanDataWithIntervalHq get no data meanwhile.
+        /// It applies to the capsule scan modes and the HQ mode, the other modes are decoded as usual.
+        /// The setting takes effect from the next startScan or startScanExpress.
+        ///
+        /// \param enabled       true to decode on the grab, false to decode on the decoder thread (the default)
+        virtual sl_result setDeferredDecoding(bool enabled) = 0;
+
+        /// Decode the sample packets of an answer type with a handler of the application, for the devices streaming a format the SDK does not know
+        ///
+        /// The handler is created by the factory for this driver, and gets each packet in place in the rx buffer on the
+        /// decoder thread. The nodes it publishes go into the scans like the ones of the built in formats, and the other
+        /// payloads it publishes are handed as is to the listener of setCustomSampleListener, neither is copied on the way.
+        /// A built in format can be replaced as well. The scan modes streaming a custom answer type are never deferred,
+        /// see setDeferredDecoding. Its packets are counted in getDecodeStats.
+        /// The handlers are registered before the scan is started, not while it runs.
+        ///
+        /// \param ansType       The answer type of the sample packets, as in LidarScanMode::ans_type
+        /// \param factory       Creates the handler, NULL to restore the decoding of the SDK. Kept until it is replaced or the driver is disposed.
+        virtual sl_result registerSampleHandler(sl_u8 ansType, ILidarSampleHandlerFactory* factory) = 0;
+
+        /// Set the listener of the payloads published by the custom sample handlers, see registerSampleHandler
+        ///
+        /// \param listener      Called on the decoder thread, NULL for none
+        virtual sl_result setCustomSampleListener(ICustomSampleListener* listener) = 0;
+
+        /// Set the raw nodes kept in each scan, and in the ring of getScanDataWithIntervalHq
+        ///
+        /// By default the capacity is derived from the scan mode started: the samples of a revolution at 5Hz plus a margin,
+        /// so the slow modes take less memory while the dense ones do not overflow. The samples beyond the capacity
+        /// replace the last node of the scan, they are counted by LidarScanData::overflow_count and getScanOverflowCount.
+        /// The setting takes effect from the next startScan or startScanExpress.
+        ///
+        /// \param maxNodes       The nodes of each scan, up to 65536; 0 to derive it from the scan mode
+        virtual sl_result setScanCapacity(size_t maxNodes) = 0;
+
+        /// Select the consumer paths the decoded samples are pushed into, all of them by default
+        ///
+        /// Each path copies every sample on the decoder thread, and the ring of getScanDataWithIntervalHq is allocated
+        /// for the scan capacity. An application only grabbing scans, or only reading the raw sample stream, disables
+        /// the others: they get no sample and allocate nothing. The scan rings and the sharing server are fed by the scan
+        /// listener, they need LIDAR_SAMPLE_PATH_SCANS. The grabs of a disabled path return SL_RESULT_OPERATION_NOT_SUPPORT.
+        /// The setting takes effect from the next startScan or startScanExpress.
+        ///
+        /// \param paths          The LidarSamplePath flags of the paths to feed
+        virtual sl_result setSamplePaths(sl_u32 paths) = 0;
+
+        /// Set what the sample paths do when their consumer falls behind
+        ///
+        /// By default the newest scan replaces the one not grabbed yet, and the newest samples of getScanDataWithIntervalHq
+        /// overwrite the oldest ones. LIDAR_BACKPRESSURE_BLOCK makes the decoder wait for the consumer instead, up to maxBlockMs
+        /// for each scan or batch of samples, so a recording or a replay is read in full. While a path blocks, the rx thread
+        /// also waits for room in the rx queue instead of dropping the received data; the rx threads of a shared
+        /// ILidarIOReactor never wait. The sectors are handed to their listener as they are formed, they have no policy.
+        ///
+        /// \param paths          LIDAR_SAMPLE_PATH_SCANS and LIDAR_SAMPLE_PATH_INTERVAL flags of the paths to set
+        /// \param policy         The LidarBackpressurePolicy of the paths
+        /// \param maxBlockMs     The longest wait of LIDAR_BACKPRESSURE_BLOCK, the data is dropped past it
+        virtual sl_result setBackpressurePolicy(sl_u32 paths, LidarBackpressurePolicy policy, sl_u32 maxBlockMs = 1000) = 0;
+
+        /// Get the counters of the data dropped or held back for the slow consumers
+        virtual sl_result getBackpressureStats(LidarBackpressureStats& stats) = 0;
+
+        /// Prepare the driver to run without page faults once the scan is streaming
+        ///
+        /// With prefault_buffers, connect allocates and touches the rx queue and the buffers of the transceiver, and
+        /// startScan and startScanExpress size the scan buffers, the spare buffers, the work arrays of the scan filters and
+        /// the sectors for the capacity, the layout and the binning of the mode, with all their pages touched. Set it before
+        /// connect. lock_memory takes effect at once: all the pages of the process are locked in RAM and the allocator stops
+        /// returning memory to the system, it needs the privilege to lock memory and returns
+        /// SL_RESULT_OPERATION_NOT_SUPPORT on the systems without it. thread_stack_prefault takes effect from the next connect.
+        ///
+        /// \param options        The LidarRealtimeOptions to apply
+        virtual sl_result setRealtimeOptions(const LidarRealtimeOptions& options) = 0;
+
+        /// Get the count of the samples received beyond the capacity of their scan since the driver was created
+        virtual sl_u64 getScanOverflowCount() = 0;
+
+        /// Wait and grab a complete 0-360 degree scan data previously received in the SoA layout.
+        ///
+        /// \param angle_rad      Buffer provided by the caller to store the angle of each node in radian.
+        /// \param range_m        Buffer provided by the caller to store the distance of each node in meter.
+        /// \param quality        Buffer provided by the caller to store the quality of each node, can be NULL.
+        /// \param timestamps_uS  Buffer provided by the caller to store the sample time of each node, can be NULL.
+        /// \param count          The caller must initialize this parameter to set the max data count of the provided buffers.
+        ///                       Once the interface returns, this parameter will store the actual received data count.
+        /// \param timeout        Max duration allowed to wait for a complete scan data.
+        ///
+        /// It requires the SoA layout to be selected by setScanLayout, otherwise SL_RESULT_OPERATION_NOT_SUPPORT is returned.
+        /// SL_RESULT_INVALID_DATA is returned if angle_rad or range_m is NULL.
+        virtual sl_result grabScanDataSoA(float* angle_rad, float* range_m, sl_u8* quality, sl_u64* timestamps_uS, size_t& count, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
 
         /// Ascending the scan data according to the angle value in the scan.
         ///
@@ -484,6 +2104,203 @@ namespace sl {
         ///
         /// The interface will return SL_RESULT_OPERATION_TIMEOUT to indicate that not even a single node can be retrieved since last call. 
         virtual sl_result getScanDataWithIntervalHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count) = 0;
+
+        /// Return received scan points even if it's not complete scan, along with the sample time of each node
+        ///
+        /// \param nodebuffer     Buffer provided by the caller application to store the scan data
+        ///
+        /// \param timestamps_uS  Buffer provided by the caller application to store the sample time of each node, it must hold count entries
+        ///
+        /// \param count          Once the interface returns, this parameter will store the actual received data count.
+        virtual sl_result getScanDataWithIntervalHqAndTimeStamps(sl_lidar_response_measurement_node_hq_t* nodebuffer, sl_u64* timestamps_uS, size_t& count) = 0;
+
+        /// Get the count of the received scan points that have been overwritten before being fetched
+        /// by getScanDataWithIntervalHq or getScanDataWithIntervalHqAndTimeStamps, as the driver only keeps the newest points
+        /// of about a revolution, see setScanCapacity
+        virtual sl_u64 getScanDataWithIntervalDroppedCount() = 0;
+
+        /// Open a reader of the raw sample stream with its own position, starting from the next sample pushed
+        ///
+        /// getScanDataWithIntervalHq takes the samples it returns out of the ring, so two consumers polling it split the stream.
+        /// The cursors instead only move their own position: any count of readers, each on its thread, get every sample
+        /// in place with readSamples. They never hold the decoder back, whatever the backpressure policy: a reader falling
+        /// more than the ring behind skips the samples overwritten and has them counted in its LidarSampleCursor::missed_count.
+        ///
+        /// \param cursor        The cursor of the reader, owned by the caller
+        ///
+        /// The interface will return SL_RESULT_OPERATION_NOT_SUPPORT if the LIDAR_SAMPLE_PATH_INTERVAL path is disabled.
+        virtual sl_result openSampleCursor(LidarSampleCursor& cursor) = 0;
+
+        /// Read in place all the samples pushed since the previous read of the cursor, and move the cursor past them
+        ///
+        /// The span points into the ring, without copy. The decoder keeps writing it: the oldest samples of the span are
+        /// overwritten once a ring of newer samples is pushed, check isSampleSpanValid after using them. The span does not
+        /// outlive the ring, which is allocated again by startScan and startScanExpress.
+        ///
+        /// \param cursor        The cursor of the reader, see openSampleCursor
+        /// \param span          The samples read, empty if there is none
+        ///
+        /// The interface will return SL_RESULT_OPERATION_TIMEOUT at once if no sample was pushed since the previous read,
+        /// SL_RESULT_OPERATION_NOT_SUPPORT if the LIDAR_SAMPLE_PATH_INTERVAL path is disabled.
+        virtual sl_result readSamples(LidarSampleCursor& cursor, LidarSampleSpan& span) = 0;
+
+        /// Whether none of the samples of the span was overwritten since readSamples returned it
+        virtual bool isSampleSpanValid(const LidarSampleSpan& span) = 0;
+
+        /// Get a snapshot of the counters of the protocol decoder and the sample data unpackers
+        /// The counters are updated without locking, each of them is consistent but they may be sampled a few packets apart
+        ///
+        /// \param stats   The counters since the driver was created
+        virtual sl_result getDecodeStats(LidarDecodeStats& stats) = 0;
+
+        /// Get the occupancy of the ring of the received data waiting for the decoder
+        /// A high water mark close to the capacity means the decoder barely keeps up with the channel on this host.
+        ///
+        /// \param stats   The current occupancy and its high water mark
+        virtual sl_result getRxQueueStats(LidarRxQueueStats& stats) = 0;
+
+        /// Use the device timestamps of the sample packets for the sample times, when the scan mode carries them (the HQ capsules)
+        ///
+        /// The device clock is mapped into the sdk clock by a linear fit over the newest packets, so the sample times
+        /// follow the device clock instead of the scheduling jitter of the host. The host times are used until
+        /// the fit locks, and whenever the device timestamps stop advancing like a microsecond clock.
+        /// It is enabled by default and takes effect from the next startScan or startScanExpress.
+        virtual sl_result setNativeTimestampsEnabled(bool enable) = 0;
+
+        /// Get the mapping of the device clock of the current scan, see setNativeTimestampsEnabled
+        ///
+        /// The interface will return SL_RESULT_OPERATION_NOT_SUPPORT if no device timestamp has been received since the scan started.
+        virtual sl_result getDeviceClockStats(LidarDeviceClockStats& stats) = 0;
+
+        /// Measure the delay of the link between the LIDAR and the host, such as a USB-serial adapter or an Ethernet switch
+        ///
+        /// The health query is repeated and the fastest round trip is taken, the time the bytes spend on the wire at the
+        /// native baudrate of the LIDAR is already in the sample times and is subtracted, half of the rest is taken as the one-way delay.
+        /// The delay is applied like setLinkageDelay, it includes the time the LIDAR takes to answer, so it is an upper bound.
+        /// The LIDAR must not be scanning, otherwise SL_RESULT_OPERATION_NOT_SUPPORT is returned.
+        ///
+        /// \param delay_uS  The measured one-way delay
+        /// \param rounds    The count of the round trips to measure
+        /// \param timeout   The timeout of each round trip (in millisecond)
+        virtual sl_result calibrateLinkageDelay(sl_u32& delay_uS, int rounds = DEFAULT_LINKAGE_CALIBRATION_ROUNDS, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Set the time base of the sample timestamps, NULL for the monotonic clock of getLidarClockInfo
+        ///
+        /// Each chunk received is stamped with the time of the clock as it is read, in place of the capture time reported by
+        /// the channel, unless the clock converts that capture time (see ILidarClock::fromHostTime_uS, e.g. createPtpClock);
+        /// the recording made by startRecording keeps these stamps. The clock of getReplayChannelClock replays
+        /// a recording with the timestamps of the original run, even as fast as the driver reads; a simulation can supply its
+        /// own. The timeouts and the waits of the driver stay on the host clock. It takes effect at once.
+        ///
+        /// \param clock          The clock, it must stay alive until it is replaced or the driver is disposed
+        virtual sl_result setClock(ILidarClock* clock) = 0;
+
+        /// Set the delay of the link between the LIDAR and the host, that is subtracted from the sample times
+        /// It is 0 by default and takes effect from the next startScan or startScanExpress. The value measured by calibrateLinkageDelay
+        /// belongs to the device and the channel it was measured on, the application can save it along the serial number and set it back here.
+        virtual sl_result setLinkageDelay(sl_u32 delay_uS) = 0;
+
+        /// Get the delay of the link set by setLinkageDelay or measured by calibrateLinkageDelay
+        virtual sl_result getLinkageDelay(sl_u32& delay_uS) = 0;
+
+        /// Get the rotation rate measured from the time between the sync samples of consecutive scans
+        /// It does not depend on the samples received in each scan, and costs no more than copying the statistics.
+        ///
+        /// \param stats   The statistics since the last startScan or startScanExpress
+        virtual sl_result getScanRateStats(LidarScanRateStats& stats) = 0;
+
+        /// Get the latency distribution of a stage of the receive pipeline since the driver was created or last reset
+        /// The timing is only compiled in with SL_LIDAR_LATENCY_PROFILING defined, otherwise SL_RESULT_OPERATION_NOT_SUPPORT is returned.
+        ///
+        /// \param stage   The stage to query
+        /// \param stats   The distribution of the stage
+        virtual sl_result getLatencyStats(LidarLatencyStage stage, LidarLatencyStats& stats) = 0;
+
+        /// Clear the latency distributions of all the stages
+        virtual sl_result resetLatencyStats() = 0;
+
+        /// Start recording the raw traffic of the channel, each received chunk and sent command with its capture time
+        /// The file is written by a background thread, the chunks are dropped rather than delaying the reception if it falls behind.
+        /// Any recording in progress is stopped first.
+        ///
+        /// \param path    The capture file to create, see sl_channel_recorder.h for the format
+        virtual sl_result startRecording(const char* path) = 0;
+
+        /// Stop the recording and close the capture file
+        ///
+        /// \param droppedBytes  The bytes not recorded as the writer fell behind, NULL if not needed
+        virtual sl_result stopRecording(sl_u64* droppedBytes = NULL) = 0;
+
+        /// Let the queries sent while scanning be answered in the sample stream
+        /// When enabled, getHealth, getDeviceInfo, getMotorInfo and the other queries without side effects no longer stop
+        /// the scan: their answers are split out of the stream while the scan data keeps being decoded.
+        /// It needs a firmware answering the queries while streaming, the queries time out otherwise.
+        /// The standard scan mode, whose packets are shorter than an answer header, is always stopped.
+        ///
+        /// \param enable    true to keep scanning during the queries, disabled by default
+        virtual sl_result setInStreamQueries(bool enable) = 0;
+
+        /// Keep the capabilities of the devices in a directory, to answer the later queries without the device
+        /// The scan modes, the typical scan mode and the motor control support are cached by serial number, and only used
+        /// once getDeviceInfo confirms the same model, firmware and hardware versions. Set it before connect.
+        ///
+        /// \param directory    An existing directory to keep one file per device in, NULL to disable the cache
+        virtual sl_result setCapabilityCache(const char* directory) = 0;
+
+        /// Reconnect by itself when the channel fails, instead of staying disconnected until the next connect
+        /// The channel is reopened with an exponential backoff, and the scan running at the failure is restarted with
+        /// the same mode, options and motor speed. The commands in flight fail with the channel error meanwhile.
+        ///
+        /// \param enable         true to supervise the connection, disabled by default
+        /// \param listener       Told the downtime of each recovery, NULL for none. Called on the recovery thread.
+        /// \param maxBackoffMs   The longest delay between two reconnect attempts, in milliseconds
+        ///
+        /// Note: the listener will not be called once this interface returns with enable being false.
+        virtual sl_result setAutoRecovery(bool enable, IRecoveryListener* listener = NULL, sl_u32 maxBackoffMs = 2000) = 0;
+
+        /// Watch the sample stream while scanning, to notice a device that stopped streaming within a few packets
+        /// A stall is a silence longer than a few sample packets at the cadence of the scan mode, plus the wait of the
+        /// rx coalescing, and never shorter than minSilenceMs. The watch begins with the first sample after a scan start,
+        /// so the motor spin up is not a stall, and pauses while the stream is stopped by a command.
+        ///
+        /// \param enable         true to watch the stream, disabled by default
+        /// \param listener       Told the stalls and the resumes, NULL for none. Called on the watchdog thread.
+        /// \param minSilenceMs   The shortest silence taken for a stall, above the delivery latency of the channel,
+        ///                       such as the latency timer of a USB serial adapter
+        /// \param recover        true to reconnect through setAutoRecovery on a stall, once enabled
+        ///
+        /// Note: the listener will not be called once this interface returns with enable being false.
+        virtual sl_result setStallWatchdog(bool enable, IStallListener* listener = NULL, sl_u32 minSilenceMs = 10, bool recover = false) = 0;
+
+        /// Get the counters of the recoveries and of the stalls, counted only while they are enabled
+        virtual sl_result getRecoveryStats(LidarRecoveryStats& stats) = 0;
+
+        /// Send a command without waiting for its answer
+        /// Up to 8 commands can be in flight, each answer goes to the oldest command waiting for its type, and for the
+        /// configuration queries, for its configuration entry. The future is always completed: with the answer, with
+        /// SL_RESULT_OPERATION_TIMEOUT once timeout has passed, or with the failure to send.
+        ///
+        /// \param cmd          The command, SL_LIDAR_CMD_xxx
+        /// \param ansType      The answer type expected, SL_LIDAR_ANS_TYPE_xxx
+        /// \param payload      The payload of the command, NULL if none
+        /// \param timeout      The time to wait for the answer in ms
+        virtual std::future<LidarCommandAnswer> sendCommandAsync(sl_u8 cmd, sl_u8 ansType, const void* payload = NULL, size_t payloadSize = 0, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Query a configuration entry without waiting for its answer, see sendCommandAsync
+        /// The payload of the answer is the value of the entry, checked against the requested type.
+        ///
+        /// \param type         The configuration entry, SL_LIDAR_CONF_xxx
+        /// \param payload      The parameter of the query, such as the scan mode id, NULL if none
+        virtual std::future<LidarCommandAnswer> getLidarConfAsync(sl_u32 type, const void* payload = NULL, size_t payloadSize = 0, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Send a command without waiting for its answer, the answer is handed to the handler instead of a future
+        /// The handler is called exactly once: on the thread receiving the answers, or on the calling thread before the
+        /// interface returns when the command cannot be sent. It must return quickly and must not wait for the driver.
+        virtual void sendCommandAsync(sl_u8 cmd, sl_u8 ansType, const void* payload, size_t payloadSize, sl_u32 timeout, const LidarCommandAnswerHandler& handler) = 0;
+
+        /// Query a configuration entry without waiting for its answer, the handler counterpart of getLidarConfAsync
+        virtual void getLidarConfAsync(sl_u32 type, const void* payload, size_t payloadSize, sl_u32 timeout, const LidarCommandAnswerHandler& handler) = 0;
+
         /// Set lidar motor speed
         /// The host system can use this operation to set lidar motor speed.
         ///
@@ -507,6 +2324,30 @@ namespace sl {
         /// \param baudRateDetected   The actual baudrate detected by the LIDAR system
         virtual sl_result negotiateSerialBaudRate(sl_u32 requiredBaudRate, sl_u32* baudRateDetected = NULL) = 0;
 
+        /// Find the baudrate the LIDAR on a serial port answers at
+        /// Each candidate is tried with a device info query of a short timeout, the baudrate found last time and
+        /// the native baudrate of the last known model are tried first. The driver must not be connected and is left disconnected.
+        /// Returns SL_RESULT_OPERATION_FAIL if the port cannot be opened, SL_RESULT_OPERATION_TIMEOUT if the LIDAR answers at none of the candidates.
+        ///
+        /// \param device            The serial port device, e.g. /dev/ttyUSB0 or com3
+        /// \param candidates        The baudrates to try, NULL to try 115200, 256000, 460800 and 1000000
+        /// \param candidateCount    The count of the candidates
+        /// \param baudRateDetected  The baudrate the LIDAR answered at
+        /// \param timeoutPerStep    The timeout of the query at each candidate, in milliseconds
+        virtual sl_result autodetectSerialBaudRate(const std::string& device, const sl_u32* candidates, size_t candidateCount, sl_u32& baudRateDetected, sl_u32 timeoutPerStep = 100) = 0;
+
+        /// Keep the highest baudrate the connected LIDAR was found stable at in the capability cache, see setCapabilityCache
+        /// The driver does not measure it, the value is kept for the application like the custom_baudrate search finds it.
+        ///
+        /// \param baudRate    The highest stable baudrate, 0 to forget it
+        virtual sl_result setCachedMaxSerialBaudRate(sl_u32 baudRate) = 0;
+
+        /// Get the highest stable baudrate kept for the connected LIDAR by setCachedMaxSerialBaudRate
+        /// Fails with SL_RESULT_OPERATION_FAIL when none is kept, or was kept for another firmware version.
+        ///
+        /// \param baudRate    The highest stable baudrate
+        virtual sl_result getCachedMaxSerialBaudRate(sl_u32& baudRate) = 0;
+
 
 
         /// Get the technology of the LIDAR's measurement system
@@ -566,4 +2407,11 @@ namespace sl {
     * delete *channel;
     */
     Result<ILidarDriver*> createLidarDriver();
+
+    /**
+    * Create a LIDAR driver instance whose rx and decoder threads are named, pinned and scheduled as given
+    * The options are copied, they apply to all the following connections. The threads of a shared reactor
+    * are configured by createLidarIOReactor instead.
+    */
+    Result<ILidarDriver*> createLidarDriver(const LidarThreadingOptions& threading);
 }
@@ -0,0 +1,77 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+// Integer only variants of the scan processing, for the hosts without an FPU.
+// They work on the protocol fields as they are: angle_z_q14 with 65536 steps per circle (about 0.0055 degree a step)
+// and dist_mm_q2 in quarters of a millimeter.
+
+namespace sl {
+
+    /**
+    * One filter of the chain of filterScanFixed, LidarScanFilter with the ranges in quarters of a millimeter
+    */
+    struct LidarScanFilterFixed
+    {
+        sl_u32  type;               // LidarScanFilterType
+        sl_u32  min_range_q2;       // LIDAR_SCAN_FILTER_RANGE_LIMIT
+        sl_u32  max_range_q2;
+        sl_u32  window;             // LIDAR_SCAN_FILTER_MEDIAN, an odd sample count from 3 to LIDAR_SCAN_FILTER_MAX_WINDOW
+        sl_u32  max_deviation_q2;   // LIDAR_SCAN_FILTER_OUTLIER
+    };
+
+    // ILidarDriver::ascendScanData on the q14 angles.
+    // The angles given to the nodes without distance are rounded to the nearest step of the even spacing from their valid
+    // neighbour, within half a step of it. The float path truncates at every node filled before the first and after
+    // the last valid ones, so it drifts from this one by up to a step per node of those runs.
+    sl_result ascendScanDataFixed(sl_lidar_response_measurement_node_hq_t* nodes, size_t count);
+
+    // Picks the node of each of binCount bins evenly dividing the circle from the nodes of a scan, the way of ILidarDriver::setScanBinning.
+    // The bins without any node are left invalid nodes at their center. Up to 65536 bins, one per q14 step.
+    // Returns the count of the bins holding a node with distance
+    size_t resampleScanToBinsFixed(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count,
+        size_t binCount, LidarScanBinPolicy policy, sl_lidar_response_measurement_node_hq_t* bins);
+
+    // filterScan on the q2 ranges, with the same results as the float ranges of the same samples.
+    // scratch holds getScanFilterScratchSize(count) integers
+    size_t filterScanFixed(const LidarScanFilterFixed* filters, size_t filterCount, sl_u32* range_q2, sl_u8* quality, sl_u32* index,
+        size_t count, sl_u32* scratch);
+
+    // convertScanToCartesian in quarters of a millimeter, x = distance * cos(angle), y = distance * sin(angle).
+    // The angles are looked up from a quarter wave table of q15 sines, 32KB built on the first call.
+    // The coordinates are within 0.5 + dist_mm_q2 / 65536 of the exact ones, about 0.75 mm at 40 m
+    void convertScanToCartesianFixed(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_s32* x_q2, sl_s32* y_q2);
+}
@@ -0,0 +1,160 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    enum {
+        LIDAR_GROUP_MAX_LIDARS = 16,
+        LIDAR_GROUP_DEFAULT_MAX_LATENCY_MS = 100,
+    };
+
+    /**
+    * The reception and the timing of a group, see createLidarGroup; all zero keeps the defaults
+    */
+    struct LidarGroupOptions
+    {
+        // the working threads of the reactor shared by the drivers of the group, 0 for the private threads of each driver
+        int     io_thread_count;
+        // the backend of the shared reactor
+        LidarIOReactorBackend io_backend;
+        // the threads of the pool decoding the data received by the shared reactor, 0 to decode on the reactor threads
+        int     decode_thread_count;
+        // how long a merged scan waits for the late LIDARs once its window is over, in milliseconds,
+        // 0 for LIDAR_GROUP_DEFAULT_MAX_LATENCY_MS. The samples of a LIDAR come with its completed scans,
+        // so a LIDAR is only complete in every window with a latency longer than its scan period
+        sl_u32  max_latency_ms;
+    };
+
+    /**
+    * The thinning of the merged points before they are handed to the listener, see ILidarGroup::setDownsampling;
+    * all zero keeps every point
+    */
+    struct LidarGroupDownsampling
+    {
+        // the points of each LIDAR are binned by their angle in its own frame and only the nearest one of each bin
+        // is kept, at the position of the first point of the bin; 0 keeps all the angles
+        float   angular_step_deg;
+        // then only the first point in each square cell of this size of the x / y frame of the group is kept;
+        // 0 keeps all the points
+        float   voxel_size_m;
+    };
+
+    /**
+    * The points of all the LIDARs of a group sampled within one window, see ILidarGroupListener
+    * The window follows the scans of the first LIDAR of the group: it ends at the last sample of each of them
+    * and starts where the previous one ended. The points are in meter in the x / y frame of the group,
+    * the nodes without distance are left out.
+    */
+    struct LidarMergedScan
+    {
+        const float*  x_m;
+        const float*  y_m;
+        const sl_u64* timestamps_uS;
+        const sl_u8*  quality;
+        const sl_u8*  lidar_index;      // the LIDAR of each point, by its index in the group
+        size_t  count;
+        size_t  downsampled_count;      // the points left out by the downsampling
+
+        sl_u64  start_uS;
+        sl_u64  end_uS;
+
+        // increases by one for each merged scan
+        sl_u64  sequence;
+
+        // bit i is set if LIDAR i has covered the whole window, the others were late beyond the max latency
+        sl_u32  complete_mask;
+    };
+
+    /**
+    * Listener of the merged scans, see ILidarGroup::setMergedScanListener
+    */
+    class ILidarGroupListener
+    {
+    public:
+        virtual ~ILidarGroupListener() {}
+
+    public:
+        /**
+        * Called on the merging thread of the group for each window
+        * \param scan  The merged points, only valid during the call
+        */
+        virtual void onMergedScan(const LidarMergedScan& scan) = 0;
+    };
+
+    /**
+    * Several LIDARs mounted on one robot, their scans merged into the frame of the robot
+    *
+    * The group owns a driver for each LIDAR, received by a shared reactor, and takes the completed scans of them
+    * by their leases, so the nodes are only copied once, into the merged scan. The samples are picked by their own
+    * timestamps, the LIDARs should run their scans at similar rates.
+    */
+    class ILidarGroup
+    {
+    public:
+        virtual ~ILidarGroup() {}
+
+    public:
+        /// Create a driver for a LIDAR and connect it to the channel
+        /// The scan listener of the driver is taken by the group, start the scan of it by getDriver.
+        ///
+        /// \param channel      The channel of the LIDAR, it must stay alive until the group is disposed
+        /// \param extrinsic    The pose of the LIDAR in the frame of the group, in the x / y frame of convertScanToCartesian
+        /// \param index        Receives the index of the LIDAR in the group, optional
+        virtual sl_result addLidar(IChannel* channel, const LidarPose2D& extrinsic, size_t* index = NULL) = 0;
+
+        virtual size_t getLidarCount() = 0;
+
+        /// The driver of a LIDAR, owned by the group
+        virtual ILidarDriver* getDriver(size_t index) = 0;
+
+        /// Move a LIDAR in the frame of the group, it takes effect from the next merged scan
+        virtual sl_result setExtrinsic(size_t index, const LidarPose2D& extrinsic) = 0;
+
+        /// Set the receiver of the merged scans, NULL to stop merging
+        virtual sl_result setMergedScanListener(ILidarGroupListener* listener) = 0;
+
+        /// Thin the merged points on the merging thread, before they are handed to the listener
+        /// It takes effect from the next merged scan.
+        virtual sl_result setDownsampling(const LidarGroupDownsampling& downsampling) = 0;
+    };
+
+    /**
+    * Create an empty group of LIDARs
+    */
+    Result<ILidarGroup*> createLidarGroup(const LidarGroupOptions& options);
+}
@@ -0,0 +1,112 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+#include <string>
+
+namespace sl {
+
+    /**
+    * Export of the health counters of the drivers in the OpenMetrics text format, for Prometheus and the like.
+    *
+    * Nothing is sampled between two scrapes: a scrape reads the counters the drivers keep anyway, through
+    * getDecodeStats, getRxQueueStats, getScanRateStats, getBackpressureStats, getLatencyStats,
+    * getPacedDeliveryStats and getRecoveryStats, and renders them with a device label. The exposition is served
+    * on an HTTP endpoint, GET /metrics, and/or written to a Unix socket at a fixed period for a collecting agent.
+    *
+    * The metrics are named slamtec_lidar_*, the durations are in seconds and the latencies are summaries with a
+    * stage label. The per stage latencies are only exported by a SDK built with SL_LIDAR_LATENCY_PROFILING.
+    */
+    enum {
+        LIDAR_METRICS_DEFAULT_HTTP_PORT = 21581,
+        LIDAR_METRICS_DEFAULT_PUSH_PERIOD_MS = 10000,
+        LIDAR_METRICS_MAX_DEVICES = 256,
+    };
+
+    /**
+    * \param http_address       The local address of the HTTP endpoint, e.g. "127.0.0.1", NULL for no endpoint
+    * \param http_port          The TCP port of the endpoint, 0 for LIDAR_METRICS_DEFAULT_HTTP_PORT
+    * \param push_socket_path   The Unix stream socket the exposition is written to, NULL for no push.
+    *                           It is connected once per push and closed after the exposition, not on Windows.
+    * \param push_period_ms     The period of the push, 0 for LIDAR_METRICS_DEFAULT_PUSH_PERIOD_MS
+    */
+    struct LidarMetricsExporterOptions
+    {
+        const char* http_address;
+        int         http_port;
+        const char* push_socket_path;
+        sl_u32      push_period_ms;
+    };
+
+    struct LidarMetricsExporterStats
+    {
+        sl_u64  scrapes;        // the expositions rendered, for the endpoint, the push and render
+        sl_u64  http_requests;
+        sl_u64  http_errors;    // the requests not answered by an exposition, and the failures to send it
+        sl_u64  pushes;
+        sl_u64  push_errors;    // the pushes not delivered, e.g. without any agent listening on the socket
+    };
+
+    /**
+    * The exporter of the drivers of one process
+    * The endpoint and the push run on threads of the exporter from its creation on.
+    */
+    class ILidarMetricsExporter
+    {
+    public:
+        virtual ~ILidarMetricsExporter() {}
+
+    public:
+        /// Export the counters of a driver, up to LIDAR_METRICS_MAX_DEVICES of them
+        /// \param driver   The driver, it must be removed before it is deleted
+        /// \param device   The value of the device label, unique to the exporter, e.g. the serial port or the serial number
+        virtual sl_result addDevice(ILidarDriver* driver, const char* device) = 0;
+
+        /// Stop exporting a driver, it returns once no scrape reads it any longer
+        virtual sl_result removeDevice(ILidarDriver* driver) = 0;
+
+        /// Render the exposition of all the devices on the calling thread, as served by the endpoint
+        virtual sl_result render(std::string& exposition) = 0;
+
+        virtual void getStats(LidarMetricsExporterStats& stats) = 0;
+    };
+
+    /**
+    * Create an exporter, with the HTTP endpoint and the push of its options
+    * \return SL_RESULT_INVALID_DATA if an address or the port is wrong, SL_RESULT_OPERATION_FAIL if the endpoint
+    *         cannot listen on its address, SL_RESULT_OPERATION_NOT_SUPPORT for a push on Windows
+    */
+    Result<ILidarMetricsExporter*> createLidarMetricsExporter(const LidarMetricsExporterOptions& options);
+}
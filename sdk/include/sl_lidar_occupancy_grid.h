@@ -0,0 +1,108 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    /**
+    * A 2D occupancy grid around the LIDAR, in the x / y frame of convertScanToCartesian.
+    *
+    * Each cell holds a log odds in [-LIDAR_GRID_CELL_LIMIT, LIDAR_GRID_CELL_LIMIT]: 0 is unknown, the cells a ray ends in
+    * grow by hit_weight and the ones it passes through fall by miss_weight, saturating. The rays are walked from tables
+    * built once for the scan mode: the circle is cut into angle bins, and each bin lists the cells of its Bresenham ray
+    * from the LIDAR cell to the edge of the grid or to the max distance, so a node costs a table lookup per cell.
+    */
+    enum {
+        LIDAR_GRID_CELL_LIMIT = 127,
+    };
+
+    struct LidarOccupancyGridSpec
+    {
+        LidarOccupancyGridSpec()
+            : width(200)
+            , height(200)
+            , resolution_m(0.05f)
+            , lidar_x_m(5.f)
+            , lidar_y_m(5.f)
+            , max_range_m(0)
+            , hit_weight(24)
+            , miss_weight(6)
+        {
+        }
+
+        // the cells, row major from the lowest y
+        size_t  width;
+        size_t  height;
+        float   resolution_m;   // the edge of a cell
+        // the position of the LIDAR from the corner of the first cell
+        float   lidar_x_m;
+        float   lidar_y_m;
+        // the longer rays are only free up to it, 0 for the max distance of the scan mode
+        float   max_range_m;
+        sl_u8   hit_weight;
+        sl_u8   miss_weight;
+    };
+
+    /**
+    * Not thread safe: a grid is updated and read by one thread at a time, e.g. the one of the sector listener
+    */
+    class ILidarOccupancyGrid
+    {
+    public:
+        virtual ~ILidarOccupancyGrid() {}
+
+    public:
+        virtual const LidarOccupancyGridSpec& getSpec() const = 0;
+
+        /// The width * height cells, row major from the lowest y
+        virtual const sl_s8* getCells() const = 0;
+
+        /// Reset all the cells to unknown, e.g. before each scan to get the grid of that scan only
+        virtual void clear() = 0;
+
+        /// Raycast the nodes into the grid, the nodes without distance are skipped.
+        /// The nodes are independent, so a scan can be integrated as a whole or sector by sector as it arrives.
+        virtual void integrate(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count) = 0;
+        virtual void integrate(const LidarScanSoA& scan) = 0;
+        virtual void integrate(const LidarScanSector& sector) = 0;
+    };
+
+    /**
+    * Create an occupancy grid for the scans of a scan mode, see ILidarDriver::getAllSupportedScanModes
+    * SL_RESULT_INVALID_DATA is returned if the spec has no cell or puts the LIDAR out of the grid.
+    */
+    Result<ILidarOccupancyGrid*> createLidarOccupancyGrid(const LidarOccupancyGridSpec& spec, const LidarScanMode& mode);
+}
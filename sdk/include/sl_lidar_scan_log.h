@@ -0,0 +1,109 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    /**
+    * A scan log stores the scans with their start timestamp for offline processing.
+    *
+    * The file is made of fixed layout blocks, all the fields are little endian:
+    *   file header       magic "SLSG", version, node size
+    *   scan blocks       timestamp_uS, node count, payload size, encoding, then the nodes:
+    *                     either the sl_lidar_response_measurement_node_hq_t as is, or delta and varint coded
+    *   timestamp index   timestamp_uS and file offset of each block, in the order of the blocks
+    *   footer            offset of the index, scan count, magic
+    *
+    * The reader maps the file, so the raw nodes are returned without copy and a time is located by a
+    * binary search of the index. A log not closed by its writer is readable, the index is rebuilt
+    * by walking the blocks when the file is opened.
+    */
+    enum LidarScanLogEncoding
+    {
+        LIDAR_SCAN_LOG_ENCODING_RAW = 0,
+        // about a third of the size of the raw nodes for a typical scan, at the cost of decoding them on read
+        LIDAR_SCAN_LOG_ENCODING_DELTA = 1,
+    };
+
+    struct LidarScanLogEntry
+    {
+        const sl_lidar_response_measurement_node_hq_t* nodes;
+        size_t  count;
+        sl_u64  timestamp_uS;
+    };
+
+    class ILidarScanLogWriter
+    {
+    public:
+        virtual ~ILidarScanLogWriter() {}
+
+    public:
+        /// Append a scan to the log, e.g. the output of ILidarDriver::grabScanDataHqWithTimeStamp
+        /// The timestamps must not decrease, SL_RESULT_INVALID_DATA is returned otherwise.
+        virtual sl_result appendScan(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS) = 0;
+
+        /// Write the index and close the file, also done when the writer is deleted
+        virtual sl_result close() = 0;
+    };
+
+    class ILidarScanLogReader
+    {
+    public:
+        virtual ~ILidarScanLogReader() {}
+
+    public:
+        virtual size_t getScanCount() const = 0;
+
+        /// Get a scan by its position in the log
+        /// The raw nodes point into the mapped file and stay valid until the reader is deleted.
+        /// The delta encoded ones are decoded into a buffer of the reader, valid until the next call.
+        virtual sl_result getScan(size_t index, LidarScanLogEntry& scan) const = 0;
+
+        /// Find the scan covering the given time: the last one started at or before it, 0 if all of them start later
+        virtual size_t findScan(sl_u64 timestamp_uS) const = 0;
+    };
+
+    /**
+    * Create a scan log, an existing file is overwritten
+    * \param encoding How the nodes of the scans are stored
+    */
+    Result<ILidarScanLogWriter*> createScanLogWriter(const std::string& path, LidarScanLogEncoding encoding = LIDAR_SCAN_LOG_ENCODING_RAW);
+
+    /**
+    * Open a scan log for reading
+    */
+    Result<ILidarScanLogReader*> createScanLogReader(const std::string& path);
+}
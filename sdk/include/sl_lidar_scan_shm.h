@@ -0,0 +1,136 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    /**
+    * A scan ring publishes the completed scans of one driver to the other processes of the host through a named
+    * shared memory segment, e.g. for SLAM, obstacle avoidance and logging processes sharing one LIDAR.
+    *
+    * The segment holds a fixed count of slots, each one a scan of up to slot_capacity nodes. The single writer
+    * fills the slots in turn and each slot carries a sequence counter, odd while the slot is being written, so
+    * neither side ever locks. The readers get the nodes in place, without copy: a view stays valid until the
+    * writer comes back to its slot, slot_count - 1 scans later, and isScanValid() tells whether it was overwritten.
+    */
+    enum {
+        LIDAR_SCAN_SHM_DEFAULT_SLOT_COUNT = 8,
+        LIDAR_SCAN_SHM_DEFAULT_SLOT_CAPACITY = 8192,
+    };
+
+    struct LidarSharedScanView
+    {
+        // the nodes in the shared segment, read only
+        const sl_lidar_response_measurement_node_hq_t* nodes;
+        size_t  count;
+
+        // timestamp of the first node and the latest sample time of the scan
+        sl_u64  timestamp_uS;
+        sl_u64  end_timestamp_uS;
+
+        // increases by one for each scan published from 1 on, gaps indicate the scans overwritten before being read
+        sl_u64  sequence;
+
+        // the samples beyond the capacity of the slot, dropped by the writer
+        size_t  truncated_count;
+
+        // the slot and the version of its counter, see ILidarScanShmReader::isScanValid
+        size_t  slot;
+        sl_u64  version;
+    };
+
+    /**
+    * The writer of a scan ring, it is also a scan listener: ILidarDriver::setScanListener(writer) publishes
+    * every completed scan. It must be the only writer, and publishScan must not be called from several threads
+    */
+    class ILidarScanShmWriter : public IScanListener
+    {
+    public:
+        virtual ~ILidarScanShmWriter() {}
+
+    public:
+        /// Publish a scan, the nodes beyond the capacity of a slot are dropped
+        virtual sl_result publishScan(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS, sl_u64 end_timestamp_uS) = 0;
+
+        /// The sequence of the latest published scan, 0 before the first one
+        virtual sl_u64 getPublishedSequence() const = 0;
+    };
+
+    class ILidarScanShmReader
+    {
+    public:
+        virtual ~ILidarScanShmReader() {}
+
+    public:
+        virtual size_t getSlotCount() const = 0;
+        virtual size_t getSlotCapacity() const = 0;
+
+        /// The sequence of the latest published scan, 0 before the first one
+        virtual sl_u64 getPublishedSequence() const = 0;
+
+        /// Get the latest published scan
+        /// \return SL_RESULT_OPERATION_TIMEOUT if no scan was published yet
+        virtual sl_result getLatestScan(LidarSharedScanView& view) const = 0;
+
+        /// Get the scan following the given sequence, or the oldest one still in the ring if it was overwritten
+        /// Pass 0 the first time, then the sequence of the last view to read every scan in order.
+        /// \return SL_RESULT_OPERATION_TIMEOUT if no newer scan was published yet
+        virtual sl_result getNextScan(sl_u64 afterSequence, LidarSharedScanView& view) const = 0;
+
+        /// The same as getNextScan, waiting until a newer scan is published or the timeout expires
+        /// On Linux the reader sleeps on a futex in the segment and the writer wakes it up as it publishes;
+        /// elsewhere the ring is polled every millisecond.
+        virtual sl_result waitNextScan(sl_u64 afterSequence, LidarSharedScanView& view, sl_u32 timeoutMs) const = 0;
+
+        /// Check, once done with the nodes of a view, that the writer did not overwrite them meanwhile
+        /// The data read from a view no longer valid must be dropped.
+        virtual bool isScanValid(const LidarSharedScanView& view) const = 0;
+    };
+
+    /**
+    * Create a scan ring, an older segment of the same name is replaced
+    * \param name         The name of the segment, shared with the readers
+    * \param slotCount    The count of slots, at least 2
+    * \param slotCapacity The maximum node count of a scan
+    * The segment is removed when the writer is deleted, the readers opened by then keep their mapping.
+    */
+    Result<ILidarScanShmWriter*> createScanShmWriter(const std::string& name, size_t slotCount = LIDAR_SCAN_SHM_DEFAULT_SLOT_COUNT, size_t slotCapacity = LIDAR_SCAN_SHM_DEFAULT_SLOT_CAPACITY);
+
+    /**
+    * Open the scan ring created by another process
+    * \return SL_RESULT_OPERATION_FAIL if there is no such segment, SL_RESULT_FORMAT_NOT_SUPPORT if it is not a scan ring
+    */
+    Result<ILidarScanShmReader*> createScanShmReader(const std::string& name);
+}
@@ -0,0 +1,187 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    /**
+    * Sharing of the scans of one LIDAR with many clients of the LAN over UDP multicast.
+    *
+    * The server, on the host owning the LIDAR, sends each completed scan once to a multicast group, so the cost
+    * does not depend on the count of clients. A scan is delta and varint coded like the delta blocks of the scan
+    * log, then cut into datagrams, each one with a header carrying the scan sequence, its timestamps and the
+    * place of the fragment. The clients join the group, put the fragments of a scan together and keep the newest
+    * complete one for the same grab calls as ILidarDriver. A scan missing any fragment is dropped.
+    *
+    * In the delta mode, meant for the fixed angle bins of a mostly static scene, the server sends a keyframe with
+    * all the bins from time to time and otherwise only the bins which changed from the keyframe. The clients apply
+    * them to the keyframe they hold, a delta arriving without its keyframe is dropped.
+    *
+    * The datagrams are little endian, see sl_lidar_share.cpp for their layout.
+    */
+    enum {
+        LIDAR_SHARE_DEFAULT_PORT = 21580,
+        // fits the 1500 bytes Ethernet MTU with the IPv4 and UDP headers
+        LIDAR_SHARE_DEFAULT_DATAGRAM_SIZE = 1400,
+        LIDAR_SHARE_MIN_DATAGRAM_SIZE = 256,
+        LIDAR_SHARE_MAX_DATAGRAM_SIZE = 65000,
+        LIDAR_SHARE_MAX_SCAN_NODES = 8192,
+    };
+
+    /**
+    * \param group_address       The IPv4 multicast group, e.g. "239.255.0.1"
+    * \param port                The UDP port of the group, 0 for LIDAR_SHARE_DEFAULT_PORT
+    * \param interface_address   The address of the local interface to use, NULL for the default one
+    */
+    struct LidarShareServerOptions
+    {
+        const char* group_address;
+        int         port;
+        const char* interface_address;
+        // the routers crossed by the datagrams, 1 keeps them within the LAN
+        int         ttl;
+        // the size of the datagrams, 0 for LIDAR_SHARE_DEFAULT_DATAGRAM_SIZE
+        size_t      datagram_size;
+        // whether the clients of the server host receive the scans too
+        bool        loopback;
+        // the delta mode: a keyframe every keyframe_interval scans, 0 sends every scan in full
+        // a keyframe is also sent when the node count changes or half of the bins changed, so the scans should
+        // be fixed angle bins, which the server takes from LidarScanData::bins when the driver provides them
+        // the clients of the SDK releases without the delta mode ignore its scans
+        size_t      keyframe_interval;
+        // a bin is sent when its distance moved by more than this from the keyframe
+        sl_u32      delta_distance_mm;
+        // or its quality moved by more than this, or its flag changed
+        sl_u8       delta_quality;
+    };
+
+    struct LidarShareServerStats
+    {
+        sl_u64  scans_sent;
+        sl_u64  datagrams_sent;
+        sl_u64  bytes_sent;
+        // the datagrams the socket refused, the clients drop their scans
+        sl_u64  send_errors;
+        // the scans sent in full in the delta mode, and the bins sent by the other ones
+        sl_u64  keyframes_sent;
+        sl_u64  delta_bins_sent;
+    };
+
+    /**
+    * The server of a shared LIDAR, it is also a scan listener: ILidarDriver::setScanListener(server) sends every
+    * completed scan. The datagrams are sent on the calling thread, pass an executor to setScanListener to keep
+    * them off the decoder thread
+    */
+    class ILidarShareServer : public IScanListener
+    {
+    public:
+        virtual ~ILidarShareServer() {}
+
+    public:
+        /// Send a scan to the group, up to LIDAR_SHARE_MAX_SCAN_NODES nodes
+        virtual sl_result publishScan(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS, sl_u64 end_timestamp_uS) = 0;
+
+        virtual void getStats(LidarShareServerStats& stats) = 0;
+    };
+
+    /**
+    * \param group_address       The IPv4 multicast group of the server
+    * \param port                The UDP port of the group, 0 for LIDAR_SHARE_DEFAULT_PORT
+    * \param interface_address   The address of the local interface joining the group, NULL for the default one
+    */
+    struct LidarShareClientOptions
+    {
+        const char* group_address;
+        int         port;
+        const char* interface_address;
+    };
+
+    struct LidarShareClientStats
+    {
+        sl_u64  scans_received;
+        // the scans of which no datagram arrived, from the gaps of the scan sequences
+        sl_u64  scans_lost;
+        // the scans missing some of their fragments, or not decoded
+        sl_u64  scans_dropped;
+        sl_u64  datagrams_received;
+        // the datagrams not from a scan server, or of a newer protocol version
+        sl_u64  bad_datagrams;
+        // the newest scan received
+        sl_u64  last_sequence;
+        // the keyframes of the delta mode received
+        sl_u64  keyframes_received;
+        // the delta scans dropped because their keyframe was not received, also counted in scans_dropped
+        sl_u64  deltas_without_keyframe;
+    };
+
+    /**
+    * A client of a shared LIDAR, with the grab calls of ILidarDriver
+    * The scans are received on a thread of the client from its creation on.
+    */
+    class ILidarShareClient
+    {
+    public:
+        enum {
+            DEFAULT_TIMEOUT = 2000,
+        };
+
+        virtual ~ILidarShareClient() {}
+
+    public:
+        /// Wait for a scan not grabbed yet and copy its nodes, see ILidarDriver::grabScanDataHq
+        /// \param count   The capacity of the node buffer, then the count of the nodes copied
+        virtual sl_result grabScanDataHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// The same as grabScanDataHq, with the timestamp of the first node given by the server
+        virtual sl_result grabScanDataHqWithTimeStamp(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u64& timestamp_uS, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// The same as grabScanDataHqWithTimeStamp, also giving the latest sample time and the sequence of the scan
+        virtual sl_result grabScanDataHqWithSequence(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u64& timestamp_uS, sl_u64& end_timestamp_uS, sl_u64& sequence, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        virtual void getStats(LidarShareClientStats& stats) = 0;
+    };
+
+    /**
+    * Create the server of a shared LIDAR
+    * \return SL_RESULT_INVALID_DATA if an address or the datagram size is wrong
+    */
+    Result<ILidarShareServer*> createLidarShareServer(const LidarShareServerOptions& options);
+
+    /**
+    * Join the group of a shared LIDAR
+    * \return SL_RESULT_INVALID_DATA if an address is wrong, SL_RESULT_OPERATION_FAIL if the group cannot be joined
+    */
+    Result<ILidarShareClient*> createLidarShareClient(const LidarShareClientOptions& options);
+}
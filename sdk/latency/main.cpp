@@ -0,0 +1,384 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+// Closed loop latency harness of the driver.
+// The simulated device stamps its samples with the time they were due (LidarSimulatorConfig::generation_timestamps),
+// so the age of the latest sample of a scan, taken when the scan reaches the application, is the whole latency of
+// the rx thread, the codec, the unpacker and the scan assembly and delivery. Each consumer API runs in turn:
+//   grab      grabScanDataHqLease() in a loop
+//   callback  a scan listener, called on the decoder thread
+//   sector    a listener of 30 degree sectors, aged by the latest sample of each sector
+//   shm       a scan ring reader of the same process, polling the ring
+// With a device given by --channel, the sample timestamps are based on the time the channel received the data,
+// so the ages leave out the transmission from the device.
+// The process exits with 1 when a consumer received nothing.
+
+#include "sdkcommon.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "sl_lidar.h"
+#include "sl_lidar_scan_shm.h"
+#include "sl_latency_histogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace sl;
+using namespace sl::internal;
+
+static const float SECTOR_DEGREES = 30.f;
+
+enum LatencyConsumer {
+    CONSUMER_GRAB = 0,
+    CONSUMER_CALLBACK,
+    CONSUMER_SECTOR,
+    CONSUMER_SHM,
+    CONSUMER_COUNT,
+};
+
+static const char* const g_consumerNames[CONSUMER_COUNT] = { "grab", "callback", "sector", "shm" };
+
+static const char* const g_stageNames[LIDAR_LATENCY_STAGE_COUNT] = {
+    "stage/rx_read", "stage/rx_queue", "stage/codec_decode", "stage/unpacker_decode", "stage/scan_publish", "stage/consumer_grab",
+};
+
+struct LatencyOptions {
+    _u64        duration_uS;
+    sl_u8       ansType;
+    sl_u32      sampleRate;
+    float       scanFrequency;
+    bool        jsonOutput;
+    const char* filter;
+    // a device instead of the simulated one, see --channel
+    const char* channelType;
+    const char* channelAddress;
+    int         channelParam;
+};
+
+struct LatencyReport {
+    std::string         name;
+    LidarLatencyStats   stats;
+};
+
+static std::vector<LatencyReport> g_reports;
+
+static void print_usage(int argc, const char* argv[])
+{
+    printf("Sample to application latency harness for SLAMTEC LIDAR SDK %s\n"
+        "Usage:\n"
+        " %s [-t <seconds per consumer>] [-a hq|dense|ultra_dense] [-r <samples per second>] [-s <scan frequency>]\n"
+        "    [-f <consumer filter>] [--json] [--channel --serial <com port> <baudrate> | --tcp|--udp <ipaddr> <port>]\n"
+        "  -t  how long each consumer runs, default 5\n"
+        "  -a  the sample answer of the simulated device, default hq\n"
+        "  -r  the sample rate of the simulated device, default 32000\n"
+        "  -s  the scan frequency of the simulated device in Hz, default 10\n"
+        "  -f  only run the consumers whose name contains the filter: grab, callback, sector, shm\n"
+        "  --channel  measure a device instead, from the receive time of its data\n"
+        , SL_LIDAR_SDK_VERSION, argv[0]);
+}
+
+static bool _isSelected(const LatencyOptions& opt, const char* name)
+{
+    return !opt.filter || strstr(name, opt.filter) != NULL;
+}
+
+static _u64 _ageOf(sl_u64 sampleTs_uS)
+{
+    _u64 now = getus();
+    return now > sampleTs_uS ? now - sampleTs_uS : 0;
+}
+
+static void _report(const LatencyOptions& opt, const std::string& name, const LidarLatencyStats& stats)
+{
+    LatencyReport report = { name, stats };
+    g_reports.push_back(report);
+    if (opt.jsonOutput) return;
+
+    printf("%-24s %8llu samples  mean %8.1f  p50 %7llu  p90 %7llu  p99 %7llu  p999 %7llu  max %7llu us\n"
+        , name.c_str()
+        , (unsigned long long)stats.count
+        , stats.count ? (double)stats.sum_uS / stats.count : 0.0
+        , (unsigned long long)stats.p50_uS
+        , (unsigned long long)stats.p90_uS
+        , (unsigned long long)stats.p99_uS
+        , (unsigned long long)stats.p999_uS
+        , (unsigned long long)stats.max_uS);
+}
+
+static void _printJsonReport()
+{
+    printf("{\"sdk_version\":\"%s\",\"results\":[", SL_LIDAR_SDK_VERSION);
+    for (size_t pos = 0; pos < g_reports.size(); ++pos) {
+        const LatencyReport& r = g_reports[pos];
+        printf("%s\n{\"name\":\"%s\",\"count\":%llu,\"sum_us\":%llu,\"p50_us\":%llu,\"p90_us\":%llu,\"p99_us\":%llu,\"p999_us\":%llu,\"max_us\":%llu}"
+            , pos ? "," : ""
+            , r.name.c_str()
+            , (unsigned long long)r.stats.count
+            , (unsigned long long)r.stats.sum_uS
+            , (unsigned long long)r.stats.p50_uS
+            , (unsigned long long)r.stats.p90_uS
+            , (unsigned long long)r.stats.p99_uS
+            , (unsigned long long)r.stats.p999_uS
+            , (unsigned long long)r.stats.max_uS);
+    }
+    printf("\n]}\n");
+}
+
+class ScanAgeListener : public IScanListener
+{
+public:
+    ScanAgeListener(LatencyHistogram& histogram)
+        : _histogram(histogram)
+    {
+    }
+
+    virtual void onScanComplete(const LidarScanLease& scan, sl_u64 timestamp_uS)
+    {
+        if (scan->count) _histogram.record(_ageOf(scan->end_timestamp_uS));
+    }
+
+private:
+    LatencyHistogram& _histogram;
+};
+
+class SectorAgeListener : public ISectorListener
+{
+public:
+    SectorAgeListener(LatencyHistogram& histogram)
+        : _histogram(histogram)
+    {
+    }
+
+    virtual void onSectorComplete(const LidarScanSector& sector)
+    {
+        if (sector.count) _histogram.record(_ageOf(sector.timestamps_uS[sector.count - 1]));
+    }
+
+private:
+    LatencyHistogram& _histogram;
+};
+
+static void _runGrab(const LatencyOptions& opt, ILidarDriver* driver, LatencyHistogram& histogram)
+{
+    _u64 deadline = getus() + opt.duration_uS;
+    while (getus() < deadline) {
+        LidarScanLease lease;
+        if (IS_OK(driver->grabScanDataHqLease(lease, 1000)) && lease->count) {
+            histogram.record(_ageOf(lease->end_timestamp_uS));
+        }
+    }
+}
+
+static void _runCallback(const LatencyOptions& opt, ILidarDriver* driver, LatencyHistogram& histogram)
+{
+    ScanAgeListener listener(histogram);
+    if (IS_FAIL(driver->setScanListener(&listener))) return;
+    delay((_u32)(opt.duration_uS / 1000));
+    driver->setScanListener(NULL);
+}
+
+static void _runSector(const LatencyOptions& opt, ILidarDriver* driver, LatencyHistogram& histogram)
+{
+    SectorAgeListener listener(histogram);
+    if (IS_FAIL(driver->setSectorListener(&listener, SECTOR_DEGREES))) return;
+    delay((_u32)(opt.duration_uS / 1000));
+    driver->setSectorListener(NULL);
+}
+
+static void _runShm(const LatencyOptions& opt, ILidarDriver* driver, LatencyHistogram& histogram)
+{
+    char ringName[64];
+    sprintf(ringName, "sl_lidar_latency_%u", (unsigned)(getus() & 0xFFFFFF));
+    Result<ILidarScanShmWriter*> writer = createScanShmWriter(ringName);
+    if (!writer) return;
+    Result<ILidarScanShmReader*> reader = createScanShmReader(ringName);
+    if (!reader || IS_FAIL(driver->setScanListener(*writer))) {
+        if (reader) delete *reader;
+        delete *writer;
+        return;
+    }
+
+    _u64 deadline = getus() + opt.duration_uS;
+    sl_u64 sequence = 0;
+    while (getus() < deadline) {
+        LidarSharedScanView view;
+        if (IS_FAIL((*reader)->waitNextScan(sequence, view, 1000))) continue;
+        _u64 age = _ageOf(view.end_timestamp_uS);
+        if ((*reader)->isScanValid(view) && view.count) histogram.record(age);
+        sequence = view.sequence;
+    }
+
+    driver->setScanListener(NULL);
+    delete *reader;
+    delete *writer;
+}
+
+static Result<IChannel*> _createChannel(const LatencyOptions& opt)
+{
+    if (!opt.channelType) {
+        LidarSimulatorConfig config = { opt.ansType, opt.sampleRate, opt.scanFrequency, true };
+        return createSimulatorChannel(config);
+    }
+    if (strcmp(opt.channelType, "--serial") == 0) return createSerialPortChannel(opt.channelAddress, opt.channelParam);
+    if (strcmp(opt.channelType, "--tcp") == 0) return createTcpChannel(opt.channelAddress, opt.channelParam);
+    return createUdpChannel(opt.channelAddress, opt.channelParam);
+}
+
+static bool _parseAnsType(const char* name, sl_u8& ansType)
+{
+    if (strcmp(name, "hq") == 0) ansType = SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ;
+    else if (strcmp(name, "dense") == 0) ansType = SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED;
+    else if (strcmp(name, "ultra_dense") == 0) ansType = SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED;
+    else return false;
+    return true;
+}
+
+int main(int argc, const char* argv[])
+{
+    LatencyOptions opt;
+    opt.duration_uS = 5 * 1000 * 1000;
+    opt.ansType = SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ;
+    opt.sampleRate = 32000;
+    opt.scanFrequency = 10;
+    opt.jsonOutput = false;
+    opt.filter = NULL;
+    opt.channelType = NULL;
+    opt.channelAddress = NULL;
+    opt.channelParam = 0;
+
+    for (int pos = 1; pos < argc; ++pos) {
+        if (strcmp(argv[pos], "--json") == 0) {
+            opt.jsonOutput = true;
+        }
+        else if (strcmp(argv[pos], "-t") == 0 && pos + 1 < argc) {
+            opt.duration_uS = (_u64)(atof(argv[++pos]) * 1000000);
+        }
+        else if (strcmp(argv[pos], "-a") == 0 && pos + 1 < argc) {
+            if (!_parseAnsType(argv[++pos], opt.ansType)) {
+                print_usage(argc, argv);
+                return -1;
+            }
+        }
+        else if (strcmp(argv[pos], "-r") == 0 && pos + 1 < argc) {
+            opt.sampleRate = strtoul(argv[++pos], NULL, 10);
+        }
+        else if (strcmp(argv[pos], "-s") == 0 && pos + 1 < argc) {
+            opt.scanFrequency = (float)atof(argv[++pos]);
+        }
+        else if (strcmp(argv[pos], "-f") == 0 && pos + 1 < argc) {
+            opt.filter = argv[++pos];
+        }
+        else if (strcmp(argv[pos], "--channel") == 0 && pos + 3 < argc
+            && (strcmp(argv[pos + 1], "--serial") == 0 || strcmp(argv[pos + 1], "--tcp") == 0 || strcmp(argv[pos + 1], "--udp") == 0)) {
+            opt.channelType = argv[pos + 1];
+            opt.channelAddress = argv[pos + 2];
+            opt.channelParam = atoi(argv[pos + 3]);
+            pos += 3;
+        }
+        else {
+            print_usage(argc, argv);
+            return -1;
+        }
+    }
+
+    if (!opt.duration_uS || !opt.sampleRate || opt.scanFrequency <= 0) {
+        print_usage(argc, argv);
+        return -1;
+    }
+
+    Result<IChannel*> channel = _createChannel(opt);
+    if (!channel) {
+        fprintf(stderr, "Failed to create the channel\n");
+        return -1;
+    }
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) {
+        delete *channel;
+        return -1;
+    }
+
+    int exitCode = 0;
+    if (IS_FAIL((*driver)->connect(*channel)) || IS_FAIL((*driver)->startScan(false, true))) {
+        fprintf(stderr, "Failed to start scanning\n");
+        exitCode = -1;
+    }
+    else {
+        // the first scans take the start of the motor and of the stream
+        LidarScanLease lease;
+        (*driver)->grabScanDataHqLease(lease, 5000);
+        (*driver)->resetLatencyStats();
+
+        for (int consumer = 0; consumer < CONSUMER_COUNT; ++consumer) {
+            if (!_isSelected(opt, g_consumerNames[consumer])) continue;
+
+            LatencyHistogram histogram;
+            switch (consumer) {
+            case CONSUMER_GRAB:
+                _runGrab(opt, *driver, histogram);
+                break;
+            case CONSUMER_CALLBACK:
+                _runCallback(opt, *driver, histogram);
+                break;
+            case CONSUMER_SECTOR:
+                _runSector(opt, *driver, histogram);
+                break;
+            case CONSUMER_SHM:
+                _runShm(opt, *driver, histogram);
+                break;
+            }
+
+            LidarLatencyStats stats;
+            histogram.getStats(stats);
+            if (!stats.count) exitCode = 1;
+            _report(opt, g_consumerNames[consumer], stats);
+        }
+
+        // the stages of the pipeline over all the consumers, with SL_LIDAR_LATENCY_PROFILING only
+        for (int stage = 0; stage < LIDAR_LATENCY_STAGE_COUNT; ++stage) {
+            LidarLatencyStats stats;
+            if (IS_OK((*driver)->getLatencyStats((LidarLatencyStage)stage, stats))) {
+                _report(opt, g_stageNames[stage], stats);
+            }
+        }
+        (*driver)->stop();
+    }
+
+    if (opt.jsonOutput) _printJsonReport();
+
+    delete *driver;
+    delete *channel;
+    return exitCode;
+}
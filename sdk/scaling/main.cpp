@@ -0,0 +1,688 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+// Scaling harness of several drivers in one process.
+// N drivers, each on its own simulated device (or a replay of the same capture), run for a while in each threading
+// mode, and the harness reports what they cost together:
+//   threaded  the private rx and decoder threads of each driver
+//   inline    the private rx thread of each driver decodes the data itself, see LidarThreadingOptions::inline_decode
+//   reactor   the channels are served by one shared reactor, see ILidarDriver::setIOReactor
+//   pool      the shared reactor receives, a shared decode pool decodes, see ILidarDriver::setDecodePool
+// The reactor serves native handles only, so in the last two modes each device is reached over a loopback TCP
+// connection to a bridge thread pumping the simulated device; --bridge does the same in every mode to compare them
+// on equal terms. One grab thread per driver takes the scans as an application would.
+// The samples are the ones of the grabbed scans; the CPU time, the threads and the context switches are the ones of
+// the threads of the sdk, read from /proc on Linux only, without the main, grab and bridge threads of the harness.
+// The grab latency is the age of the latest sample of a scan when it is grabbed, from the time the simulated device
+// produced it, or from the time the data reached the channel over the bridge and for replays.
+// The process exits with 1 when a run grabbed nothing.
+
+#include "sdkcommon.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "hal/socket.h"
+#include "sl_lidar.h"
+#include "sl_latency_histogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <atomic>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+using namespace sl;
+using namespace sl::internal;
+
+static const int MAX_DRIVER_COUNTS = 8;
+
+enum ScalingMode {
+    MODE_THREADED = 0,
+    MODE_INLINE,
+    MODE_REACTOR,
+    MODE_POOL,
+    MODE_COUNT,
+};
+
+static const char* const g_modeNames[MODE_COUNT] = { "threaded", "inline", "reactor", "pool" };
+
+struct ScalingOptions {
+    _u64        duration_uS;
+    sl_u8       ansType;
+    sl_u32      sampleRate;
+    float       scanFrequency;
+    int         driverCounts[MAX_DRIVER_COUNTS];
+    int         driverCountCount;
+    int         sharedThreads;
+    bool        bridgeAll;
+    bool        jsonOutput;
+    const char* filter;
+    const char* replayPath;
+};
+
+struct ScalingReport {
+    std::string         mode;
+    int                 drivers;
+    double              elapsed_s;
+    _u64                samples;
+    _u64                scans;
+    // of the threads of the sdk, all zero when they cannot be read
+    int                 threads;
+    double              cpu_s;
+    _u64                voluntarySwitches;
+    _u64                involuntarySwitches;
+    double              bridgeCpu_s;
+    LidarLatencyStats   grabLatency;
+};
+
+static std::vector<ScalingReport> g_reports;
+
+static void print_usage(int argc, const char* argv[])
+{
+    printf("Multi driver scaling harness for SLAMTEC LIDAR SDK %s\n"
+        "Usage:\n"
+        " %s [-t <seconds per run>] [-n <driver counts>] [-a hq|dense|ultra_dense] [-r <samples per second>]\n"
+        "    [-s <scan frequency>] [-w <shared threads>] [-f <mode filter>] [--replay <capture>] [--bridge] [--json]\n"
+        "  -t  how long each run is measured, default 5\n"
+        "  -n  the comma separated driver counts to run, default 1,4,8,16\n"
+        "  -a  the sample answer of the simulated devices, default hq\n"
+        "  -r  the sample rate of each simulated device, default 32000\n"
+        "  -s  the scan frequency of the simulated devices in Hz, default 10\n"
+        "  -w  the threads of the shared reactor and of the shared decode pool, default 2\n"
+        "  -f  only run the modes whose name contains the filter: threaded, inline, reactor, pool\n"
+        "  --replay  each device replays the capture of ILidarDriver::startRecording instead\n"
+        "  --bridge  reach the devices over loopback TCP in every mode, not only with the shared reactor\n"
+        , SL_LIDAR_SDK_VERSION, argv[0]);
+}
+
+static bool _isSelected(const ScalingOptions& opt, const char* name)
+{
+    return !opt.filter || strstr(name, opt.filter) != NULL;
+}
+
+static bool _isHarnessThread(const std::string& name)
+{
+    return name.compare(0, 9, "sl_scale_") == 0;
+}
+
+static _u64 _ageOf(sl_u64 sampleTs_uS)
+{
+    _u64 now = getus();
+    return now > sampleTs_uS ? now - sampleTs_uS : 0;
+}
+
+struct ThreadUsage {
+    long        tid;
+    std::string name;
+    _u64        cpuTicks;
+    _u64        voluntarySwitches;
+    _u64        involuntarySwitches;
+};
+
+// the user and system time and the context switches of each thread of the process, only available on Linux
+static bool _sampleThreads(std::vector<ThreadUsage>& threads)
+{
+    threads.clear();
+#if defined(__linux__)
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) return false;
+
+    while (struct dirent* ent = readdir(dir)) {
+        if (ent->d_name[0] == '.') continue;
+
+        char path[300];
+        char buffer[2048];
+        snprintf(path, sizeof(path), "/proc/self/task/%s/stat", ent->d_name);
+        FILE* fp = fopen(path, "r");
+        if (!fp) continue;
+        size_t len = fread(buffer, 1, sizeof(buffer) - 1, fp);
+        fclose(fp);
+        buffer[len] = 0;
+
+        // the name is within parentheses and may hold spaces, utime and stime are the 14th and 15th fields
+        char* nameBegin = strchr(buffer, '(');
+        char* nameEnd = strrchr(buffer, ')');
+        unsigned long utime, stime;
+        if (!nameBegin || !nameEnd || nameEnd < nameBegin) continue;
+        if (sscanf(nameEnd + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) continue;
+
+        ThreadUsage thread;
+        thread.tid = atol(ent->d_name);
+        thread.name.assign(nameBegin + 1, nameEnd - nameBegin - 1);
+        thread.cpuTicks = utime + stime;
+        thread.voluntarySwitches = 0;
+        thread.involuntarySwitches = 0;
+
+        snprintf(path, sizeof(path), "/proc/self/task/%s/status", ent->d_name);
+        fp = fopen(path, "r");
+        if (fp) {
+            char line[256];
+            unsigned long long value;
+            while (fgets(line, sizeof(line), fp)) {
+                if (sscanf(line, "voluntary_ctxt_switches: %llu", &value) == 1) thread.voluntarySwitches = value;
+                else if (sscanf(line, "nonvoluntary_ctxt_switches: %llu", &value) == 1) thread.involuntarySwitches = value;
+            }
+            fclose(fp);
+        }
+        threads.push_back(thread);
+    }
+    closedir(dir);
+    return true;
+#else
+    return false;
+#endif
+}
+
+// what the threads of the sdk used between the two samples, the threads started in between count from zero
+static void _accountThreads(const std::vector<ThreadUsage>& before, const std::vector<ThreadUsage>& after, ScalingReport& report)
+{
+#if defined(__linux__)
+    const double ticksPerSecond = (double)sysconf(_SC_CLK_TCK);
+    const long mainTid = (long)getpid();
+
+    for (size_t pos = 0; pos < after.size(); ++pos) {
+        const ThreadUsage& thread = after[pos];
+        if (thread.tid == mainTid) continue;
+
+        ThreadUsage base = { thread.tid, thread.name, 0, 0, 0 };
+        for (size_t prev = 0; prev < before.size(); ++prev) {
+            if (before[prev].tid == thread.tid) {
+                base = before[prev];
+                break;
+            }
+        }
+
+        double cpu_s = (thread.cpuTicks - base.cpuTicks) / ticksPerSecond;
+        if (_isHarnessThread(thread.name)) {
+            if (thread.name == "sl_scale_bridge") report.bridgeCpu_s += cpu_s;
+            continue;
+        }
+        ++report.threads;
+        report.cpu_s += cpu_s;
+        report.voluntarySwitches += thread.voluntarySwitches - base.voluntarySwitches;
+        report.involuntarySwitches += thread.involuntarySwitches - base.involuntarySwitches;
+    }
+#endif
+}
+
+static void _report(const ScalingOptions& opt, const ScalingReport& report)
+{
+    g_reports.push_back(report);
+    if (opt.jsonOutput) return;
+
+    double elapsed_s = report.elapsed_s > 0 ? report.elapsed_s : 1;
+    double expected = (double)opt.sampleRate * report.drivers;
+    printf("%-8s x%-3d %9.0f samples/s (%5.1f%%)  cpu/device %5.2f%%  sdk threads %3d  switches/s %8.0f vol %7.0f invol"
+        "  grab p50 %6llu p99 %6llu max %6llu us\n"
+        , report.mode.c_str()
+        , report.drivers
+        , report.samples / elapsed_s
+        , (!opt.replayPath && expected > 0) ? report.samples / elapsed_s * 100 / expected : 0.0
+        , report.cpu_s * 100 / elapsed_s / report.drivers
+        , report.threads
+        , report.voluntarySwitches / elapsed_s
+        , report.involuntarySwitches / elapsed_s
+        , (unsigned long long)report.grabLatency.p50_uS
+        , (unsigned long long)report.grabLatency.p99_uS
+        , (unsigned long long)report.grabLatency.max_uS);
+}
+
+static void _printJsonReport()
+{
+    printf("{\"sdk_version\":\"%s\",\"results\":[", SL_LIDAR_SDK_VERSION);
+    for (size_t pos = 0; pos < g_reports.size(); ++pos) {
+        const ScalingReport& r = g_reports[pos];
+        printf("%s\n{\"mode\":\"%s\",\"drivers\":%d,\"elapsed_s\":%.3f,\"samples\":%llu,\"scans\":%llu,\"sdk_threads\":%d,"
+            "\"sdk_cpu_s\":%.3f,\"voluntary_switches\":%llu,\"involuntary_switches\":%llu,\"bridge_cpu_s\":%.3f,"
+            "\"grab_p50_us\":%llu,\"grab_p99_us\":%llu,\"grab_max_us\":%llu}"
+            , pos ? "," : ""
+            , r.mode.c_str()
+            , r.drivers
+            , r.elapsed_s
+            , (unsigned long long)r.samples
+            , (unsigned long long)r.scans
+            , r.threads
+            , r.cpu_s
+            , (unsigned long long)r.voluntarySwitches
+            , (unsigned long long)r.involuntarySwitches
+            , r.bridgeCpu_s
+            , (unsigned long long)r.grabLatency.p50_uS
+            , (unsigned long long)r.grabLatency.p99_uS
+            , (unsigned long long)r.grabLatency.max_uS);
+    }
+    printf("\n]}\n");
+}
+
+// serves a device channel to a TCP channel of the driver over loopback, so a shared reactor can wait on it
+class DeviceBridge
+{
+public:
+    enum {
+        BRIDGE_BUFFER_SIZE = 16 * 1024,
+        BRIDGE_WAIT_MS = 2,
+    };
+
+    DeviceBridge(IChannel* device)
+        : _device(device)
+        , _listener(NULL)
+        , _port(0)
+        , _isWorking(false)
+    {
+    }
+
+    ~DeviceBridge()
+    {
+        stop();
+        if (_listener) _listener->dispose();
+    }
+
+    // listens on a free loopback port
+    bool start()
+    {
+        rp::net::SocketAddress address("127.0.0.1", 0);
+        _listener = rp::net::StreamSocket::CreateSocket();
+        if (!_listener) return false;
+        if (IS_FAIL(_listener->bind(address)) || IS_FAIL(_listener->listen(1))) return false;
+        if (IS_FAIL(_listener->getLocalAddress(address))) return false;
+        _port = address.getPort();
+
+        _isWorking = true;
+        _thread = CLASS_THREAD(DeviceBridge, _proc_bridge);
+        return true;
+    }
+
+    void stop()
+    {
+        if (!_isWorking) return;
+        _isWorking = false;
+        _device->cancelWaits();
+        _thread.join();
+    }
+
+    int getPort() const
+    {
+        return _port;
+    }
+
+private:
+    u_result _proc_bridge()
+    {
+        rp::hal::Thread::config_t config;
+        memset(&config, 0, sizeof(config));
+        rp::hal::Thread::SetSelfConfig(config, "sl_scale_bridge", rp::hal::Thread::PRIORITY_HIGH);
+
+        rp::net::StreamSocket* peer = NULL;
+        while (_isWorking && !peer) {
+            if (IS_OK(_listener->waitforIncomingConnection(100))) peer = _listener->accept();
+        }
+        if (!peer) return RESULT_OK;
+        peer->enableNoDelay(true);
+
+        if (_device->open()) {
+            std::vector<_u8> buffer(BRIDGE_BUFFER_SIZE);
+            while (_isWorking) {
+                // the commands of the driver
+                if (peer->waitforData(0) == RESULT_OK) {
+                    size_t recvLen = 0;
+                    if (IS_FAIL(peer->recv(&buffer[0], buffer.size(), recvLen)) || !recvLen) break;
+                    _device->write(&buffer[0], recvLen);
+                }
+
+                // the answers and the samples of the device, as soon as they are due
+                size_t sizeHint;
+                if (IS_FAIL(_device->waitForDataExt(sizeHint, BRIDGE_WAIT_MS))) continue;
+                int readLen = _device->read(&buffer[0], buffer.size());
+                if (readLen > 0 && IS_FAIL(peer->send(&buffer[0], readLen))) break;
+            }
+            _device->close();
+        }
+        peer->dispose();
+        return RESULT_OK;
+    }
+
+    IChannel*                   _device;
+    rp::net::StreamSocket*      _listener;
+    int                         _port;
+    std::atomic<bool>           _isWorking;
+    rp::hal::Thread             _thread;
+};
+
+// takes the scans of one driver as an application would
+class GrabWorker
+{
+public:
+    enum {
+        GRAB_TIMEOUT_MS = 200,
+    };
+
+    GrabWorker(ILidarDriver* driver, LatencyHistogram& histogram, const std::atomic<bool>& measuring)
+        : _driver(driver)
+        , _histogram(histogram)
+        , _measuring(measuring)
+        , _isWorking(false)
+        , _samples(0)
+        , _scans(0)
+    {
+    }
+
+    void start()
+    {
+        _isWorking = true;
+        _thread = CLASS_THREAD(GrabWorker, _proc_grab);
+    }
+
+    void stop()
+    {
+        if (!_isWorking) return;
+        _isWorking = false;
+        _thread.join();
+    }
+
+    _u64 getSamples() const { return _samples; }
+    _u64 getScans() const { return _scans; }
+
+private:
+    u_result _proc_grab()
+    {
+        rp::hal::Thread::config_t config;
+        memset(&config, 0, sizeof(config));
+        rp::hal::Thread::SetSelfConfig(config, "sl_scale_grab", rp::hal::Thread::PRIORITY_NORMAL);
+
+        while (_isWorking) {
+            LidarScanLease lease;
+            if (IS_FAIL(_driver->grabScanDataHqLease(lease, GRAB_TIMEOUT_MS)) || !lease->count) continue;
+            if (!_measuring) continue;
+
+            _histogram.record(_ageOf(lease->end_timestamp_uS));
+            _samples += lease->count;
+            ++_scans;
+        }
+        return RESULT_OK;
+    }
+
+    ILidarDriver*               _driver;
+    LatencyHistogram&           _histogram;
+    const std::atomic<bool>&    _measuring;
+    std::atomic<bool>           _isWorking;
+    std::atomic<_u64>           _samples;
+    std::atomic<_u64>           _scans;
+    rp::hal::Thread             _thread;
+};
+
+// the devices, drivers and consumers of one run
+struct ScalingRun {
+    ILidarIOReactor*            reactor;
+    ILidarDecodePool*           pool;
+    std::vector<IChannel*>      devices;
+    std::vector<DeviceBridge*>  bridges;
+    std::vector<IChannel*>      channels;
+    std::vector<ILidarDriver*>  drivers;
+    std::vector<GrabWorker*>    workers;
+};
+
+static Result<IChannel*> _createDevice(const ScalingOptions& opt)
+{
+    if (opt.replayPath) return createReplayChannel(opt.replayPath);
+    LidarSimulatorConfig config = { opt.ansType, opt.sampleRate, opt.scanFrequency, true };
+    return createSimulatorChannel(config);
+}
+
+// stops the consumers before the drivers, and the drivers before the reactor and the pool they use
+static void _teardown(ScalingRun& run)
+{
+    for (size_t pos = 0; pos < run.workers.size(); ++pos) run.workers[pos]->stop();
+    for (size_t pos = 0; pos < run.drivers.size(); ++pos) run.drivers[pos]->stop();
+    for (size_t pos = 0; pos < run.workers.size(); ++pos) delete run.workers[pos];
+    for (size_t pos = 0; pos < run.drivers.size(); ++pos) delete run.drivers[pos];
+    for (size_t pos = 0; pos < run.bridges.size(); ++pos) delete run.bridges[pos];
+    for (size_t pos = 0; pos < run.channels.size(); ++pos) {
+        if (run.channels[pos] != run.devices[pos]) delete run.channels[pos];
+    }
+    for (size_t pos = 0; pos < run.devices.size(); ++pos) delete run.devices[pos];
+    delete run.pool;
+    delete run.reactor;
+}
+
+static bool _setup(const ScalingOptions& opt, ScalingMode mode, int driverCount, ScalingRun& run)
+{
+    run.reactor = NULL;
+    run.pool = NULL;
+
+    if (mode == MODE_REACTOR || mode == MODE_POOL) {
+        Result<ILidarIOReactor*> reactor = createLidarIOReactor(opt.sharedThreads);
+        if (!reactor) return false;
+        run.reactor = *reactor;
+    }
+    if (mode == MODE_POOL) {
+        Result<ILidarDecodePool*> pool = createLidarDecodePool(opt.sharedThreads);
+        if (!pool) return false;
+        run.pool = *pool;
+    }
+
+    bool bridged = opt.bridgeAll || run.reactor;
+    LidarThreadingOptions threading;
+    memset(&threading, 0, sizeof(threading));
+    threading.inline_decode = (mode == MODE_INLINE);
+
+    for (int index = 0; index < driverCount; ++index) {
+        Result<IChannel*> device = _createDevice(opt);
+        if (!device) return false;
+        run.devices.push_back(*device);
+
+        IChannel* channel = *device;
+        if (bridged) {
+            DeviceBridge* bridge = new DeviceBridge(*device);
+            run.bridges.push_back(bridge);
+            if (!bridge->start()) return false;
+
+            Result<IChannel*> tcpChannel = createTcpChannel("127.0.0.1", bridge->getPort());
+            if (!tcpChannel) return false;
+            channel = *tcpChannel;
+        }
+        run.channels.push_back(channel);
+
+        Result<ILidarDriver*> driver = createLidarDriver(threading);
+        if (!driver) return false;
+        run.drivers.push_back(*driver);
+        if (run.reactor) (*driver)->setIOReactor(run.reactor);
+        if (run.pool) (*driver)->setDecodePool(run.pool);
+
+        if (IS_FAIL((*driver)->connect(channel)) || IS_FAIL((*driver)->startScan(false, true))) {
+            fprintf(stderr, "Failed to start scanning on device %d of %s x%d\n", index, g_modeNames[mode], driverCount);
+            return false;
+        }
+    }
+
+    // the first scans take the start of the motors and of the streams
+    for (size_t pos = 0; pos < run.drivers.size(); ++pos) {
+        LidarScanLease lease;
+        run.drivers[pos]->grabScanDataHqLease(lease, 5000);
+    }
+    return true;
+}
+
+static bool _runScaling(const ScalingOptions& opt, ScalingMode mode, int driverCount)
+{
+    ScalingRun run;
+    bool ok = _setup(opt, mode, driverCount, run);
+
+    ScalingReport report;
+    report.mode = g_modeNames[mode];
+    report.drivers = driverCount;
+    report.elapsed_s = 0;
+    report.samples = 0;
+    report.scans = 0;
+    report.threads = 0;
+    report.cpu_s = 0;
+    report.voluntarySwitches = 0;
+    report.involuntarySwitches = 0;
+    report.bridgeCpu_s = 0;
+    memset(&report.grabLatency, 0, sizeof(report.grabLatency));
+
+    if (ok) {
+        LatencyHistogram histogram;
+        std::atomic<bool> measuring(false);
+        for (size_t pos = 0; pos < run.drivers.size(); ++pos) {
+            GrabWorker* worker = new GrabWorker(run.drivers[pos], histogram, measuring);
+            run.workers.push_back(worker);
+            worker->start();
+        }
+        // the scans held since the start are taken before the measurement
+        delay((_u32)(2000 / opt.scanFrequency));
+
+        std::vector<ThreadUsage> before, after;
+        _sampleThreads(before);
+        _u64 startTs = getus();
+        measuring = true;
+        delay((_u32)(opt.duration_uS / 1000));
+        measuring = false;
+        report.elapsed_s = (getus() - startTs) / 1000000.0;
+        _sampleThreads(after);
+        _accountThreads(before, after, report);
+
+        for (size_t pos = 0; pos < run.workers.size(); ++pos) {
+            run.workers[pos]->stop();
+            report.samples += run.workers[pos]->getSamples();
+            report.scans += run.workers[pos]->getScans();
+        }
+        histogram.getStats(report.grabLatency);
+    }
+    _teardown(run);
+
+    if (!ok) return false;
+    _report(opt, report);
+    return report.samples != 0;
+}
+
+static bool _parseAnsType(const char* name, sl_u8& ansType)
+{
+    if (strcmp(name, "hq") == 0) ansType = SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ;
+    else if (strcmp(name, "dense") == 0) ansType = SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED;
+    else if (strcmp(name, "ultra_dense") == 0) ansType = SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED;
+    else return false;
+    return true;
+}
+
+static bool _parseDriverCounts(const char* list, ScalingOptions& opt)
+{
+    opt.driverCountCount = 0;
+    while (*list) {
+        char* end;
+        long count = strtol(list, &end, 10);
+        if (end == list || count <= 0 || opt.driverCountCount == MAX_DRIVER_COUNTS) return false;
+        opt.driverCounts[opt.driverCountCount++] = (int)count;
+        if (*end == ',') ++end;
+        else if (*end) return false;
+        list = end;
+    }
+    return opt.driverCountCount != 0;
+}
+
+int main(int argc, const char* argv[])
+{
+    ScalingOptions opt;
+    opt.duration_uS = 5 * 1000 * 1000;
+    opt.ansType = SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ;
+    opt.sampleRate = 32000;
+    opt.scanFrequency = 10;
+    _parseDriverCounts("1,4,8,16", opt);
+    opt.sharedThreads = 2;
+    opt.bridgeAll = false;
+    opt.jsonOutput = false;
+    opt.filter = NULL;
+    opt.replayPath = NULL;
+
+    for (int pos = 1; pos < argc; ++pos) {
+        bool valid = true;
+        if (strcmp(argv[pos], "--json") == 0) {
+            opt.jsonOutput = true;
+        }
+        else if (strcmp(argv[pos], "--bridge") == 0) {
+            opt.bridgeAll = true;
+        }
+        else if (strcmp(argv[pos], "--replay") == 0 && pos + 1 < argc) {
+            opt.replayPath = argv[++pos];
+        }
+        else if (strcmp(argv[pos], "-t") == 0 && pos + 1 < argc) {
+            opt.duration_uS = (_u64)(atof(argv[++pos]) * 1000000);
+        }
+        else if (strcmp(argv[pos], "-n") == 0 && pos + 1 < argc) {
+            valid = _parseDriverCounts(argv[++pos], opt);
+        }
+        else if (strcmp(argv[pos], "-a") == 0 && pos + 1 < argc) {
+            valid = _parseAnsType(argv[++pos], opt.ansType);
+        }
+        else if (strcmp(argv[pos], "-r") == 0 && pos + 1 < argc) {
+            opt.sampleRate = strtoul(argv[++pos], NULL, 10);
+        }
+        else if (strcmp(argv[pos], "-s") == 0 && pos + 1 < argc) {
+            opt.scanFrequency = (float)atof(argv[++pos]);
+        }
+        else if (strcmp(argv[pos], "-w") == 0 && pos + 1 < argc) {
+            opt.sharedThreads = atoi(argv[++pos]);
+        }
+        else if (strcmp(argv[pos], "-f") == 0 && pos + 1 < argc) {
+            opt.filter = argv[++pos];
+        }
+        else {
+            valid = false;
+        }
+
+        if (!valid) {
+            print_usage(argc, argv);
+            return -1;
+        }
+    }
+
+    if (!opt.duration_uS || !opt.sampleRate || opt.scanFrequency <= 0 || opt.sharedThreads <= 0) {
+        print_usage(argc, argv);
+        return -1;
+    }
+
+    int exitCode = 0;
+    for (int mode = 0; mode < MODE_COUNT; ++mode) {
+        if (!_isSelected(opt, g_modeNames[mode])) continue;
+
+        for (int pos = 0; pos < opt.driverCountCount; ++pos) {
+            if (!_runScaling(opt, (ScalingMode)mode, opt.driverCounts[pos])) exitCode = 1;
+        }
+    }
+
+    if (opt.jsonOutput) _printJsonReport();
+    return exitCode;
+}
@@ -0,0 +1,332 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "arch/linux/arch_linux.h"
+#include "hal/thread.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <map>
+#include <vector>
+
+namespace rp{ namespace arch{
+
+// the thread config given to CreateReactor, with its own copy of the name
+struct ReactorThreadConfig
+{
+    ReactorThreadConfig()
+    {
+        memset(&config, 0, sizeof(config));
+    }
+
+    void assign(const rp::hal::Thread::config_t * src)
+    {
+        if (!src) return;
+        config = *src;
+        if (src->name) {
+            name = src->name;
+            config.name = name.c_str();
+        }
+    }
+
+    rp::hal::Thread::config_t config;
+    std::string name;
+};
+
+class EpollReactor : public rp::hal::IOReactor
+{
+public:
+    enum {
+        MAX_EVENTS_PER_WAIT = 16,
+    };
+
+    EpollReactor()
+        : _epollfd(-1)
+        , _wakeupfd(-1)
+        , _isWorking(false)
+        , _generation(0)
+    {
+    }
+
+    virtual ~EpollReactor()
+    {
+        stop();
+
+        for (std::map<int, HandleEntry*>::iterator itr = _entries.begin(); itr != _entries.end(); ++itr)
+        {
+            delete itr->second;
+        }
+        _entries.clear();
+    }
+
+    bool start(int threadCount, const rp::hal::Thread::config_t * threadConfig)
+    {
+        _threadConfig.assign(threadConfig);
+
+        _epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (_epollfd < 0) return false;
+
+        _wakeupfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_wakeupfd < 0) {
+            ::close(_epollfd);
+            _epollfd = -1;
+            return false;
+        }
+
+        epoll_event evt;
+        memset(&evt, 0, sizeof(evt));
+        evt.events = EPOLLIN;
+        evt.data.u64 = 0; // reserved for wakeup, handle keys never take the value 0
+        if (epoll_ctl(_epollfd, EPOLL_CTL_ADD, _wakeupfd, &evt)) {
+            _closeHandles();
+            return false;
+        }
+
+        _isWorking = true;
+        for (int pos = 0; pos < threadCount; ++pos)
+        {
+            _threads.push_back(CLASS_THREAD(EpollReactor, _proc_reactorThread));
+        }
+        return true;
+    }
+
+    void stop()
+    {
+        if (_isWorking) {
+            _isWorking = false;
+
+            // the eventfd is never read, so it stays readable and wakes up all the threads
+            _u64 val = 1;
+            if (::write(_wakeupfd, &val, sizeof(val)) != sizeof(val)) {
+                assert(!"failed to wake up the reactor threads");
+            }
+
+            for (size_t pos = 0; pos < _threads.size(); ++pos)
+            {
+                _threads[pos].join();
+            }
+            _threads.clear();
+        }
+        _closeHandles();
+    }
+
+    virtual size_t getThreadCount() const
+    {
+        return _threads.size();
+    }
+
+    virtual reactor_backend_t getBackend() const
+    {
+        return BACKEND_EPOLL;
+    }
+
+    virtual u_result addHandle(int handle, rp::hal::IOReactorHandler * handler)
+    {
+        if (handle < 0 || !handler) return RESULT_INVALID_DATA;
+
+        rp::hal::AutoLocker l(_lock);
+        if (_entries.find(handle) != _entries.end()) return RESULT_ALREADY_DONE;
+
+        HandleEntry * entry = new HandleEntry();
+        entry->handler = handler;
+        entry->generation = ++_generation;
+        if (!entry->generation) entry->generation = ++_generation;
+        entry->busy = false;
+        entry->removed = false;
+
+        if (_arm(EPOLL_CTL_ADD, handle, entry)) {
+            delete entry;
+            return RESULT_OPERATION_FAIL;
+        }
+
+        _entries[handle] = entry;
+        return RESULT_OK;
+    }
+
+    virtual void removeHandle(int handle)
+    {
+        rp::hal::AutoLocker l(_lock);
+
+        std::map<int, HandleEntry*>::iterator itr = _entries.find(handle);
+        if (itr == _entries.end()) return;
+
+        HandleEntry * entry = itr->second;
+        entry->removed = true;
+        epoll_ctl(_epollfd, EPOLL_CTL_DEL, handle, NULL);
+
+        while (entry->busy) {
+            // the handler is running in one of the reactor threads, wait for it to finish
+            _lock.unlock();
+            _idleEvt.wait(10);
+            _lock.lock();
+        }
+
+        _entries.erase(handle);
+        delete entry;
+    }
+
+protected:
+
+    struct HandleEntry {
+        rp::hal::IOReactorHandler * handler;
+        _u32 generation;
+        bool busy;
+        bool removed;
+    };
+
+    int _arm(int op, int handle, const HandleEntry * entry)
+    {
+        epoll_event evt;
+        memset(&evt, 0, sizeof(evt));
+        // one shot, so that a handle is served by a single thread at a time and data is decoded in order
+        evt.events = EPOLLIN | EPOLLONESHOT;
+        evt.data.u64 = ((_u64)entry->generation << 32) | (_u32)handle;
+        return epoll_ctl(_epollfd, op, handle, &evt);
+    }
+
+    void _dispatch(_u64 key)
+    {
+        int handle = (int)(key & 0xFFFFFFFF);
+        _u32 generation = (_u32)(key >> 32);
+
+        HandleEntry * entry;
+        {
+            rp::hal::AutoLocker l(_lock);
+            std::map<int, HandleEntry*>::iterator itr = _entries.find(handle);
+            if (itr == _entries.end()) return;
+            entry = itr->second;
+
+            // stale event of a removed or re-registered handle
+            if (entry->generation != generation || entry->removed) return;
+            entry->busy = true;
+        }
+
+        bool keepWatching = entry->handler->onIOReadable();
+
+        rp::hal::AutoLocker l(_lock);
+        entry->busy = false;
+        if (entry->removed) {
+            _idleEvt.set();
+        } else if (keepWatching) {
+            _arm(EPOLL_CTL_MOD, handle, entry);
+        }
+    }
+
+    u_result _proc_reactorThread()
+    {
+        rp::hal::Thread::SetSelfConfig(_threadConfig.config, "sl_reactor", rp::hal::Thread::PRIORITY_HIGH);
+
+        epoll_event evts[MAX_EVENTS_PER_WAIT];
+        while (_isWorking)
+        {
+            int count = epoll_wait(_epollfd, evts, MAX_EVENTS_PER_WAIT, -1);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+
+            for (int pos = 0; pos < count; ++pos)
+            {
+                if (!evts[pos].data.u64) continue; // wakeup
+                _dispatch(evts[pos].data.u64);
+            }
+        }
+        return RESULT_OK;
+    }
+
+    void _closeHandles()
+    {
+        if (_wakeupfd >= 0) {
+            ::close(_wakeupfd);
+            _wakeupfd = -1;
+        }
+        if (_epollfd >= 0) {
+            ::close(_epollfd);
+            _epollfd = -1;
+        }
+    }
+
+    int _epollfd;
+    int _wakeupfd;
+    volatile bool _isWorking;
+    _u32 _generation;
+
+    rp::hal::Locker _lock;
+    rp::hal::Event  _idleEvt;
+    std::map<int, HandleEntry*> _entries;
+    std::vector<rp::hal::Thread> _threads;
+    ReactorThreadConfig _threadConfig;
+};
+
+}}
+
+#include "arch/linux/io_uring_reactor.hpp"
+
+namespace rp{ namespace hal{
+
+IOReactor * IOReactor::CreateReactor(int threadCount, reactor_backend_t backend, const Thread::config_t * threadConfig)
+{
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > MAX_THREAD_COUNT) threadCount = MAX_THREAD_COUNT;
+
+    if (backend == BACKEND_IO_URING) {
+#ifdef RP_HAS_IO_URING_REACTOR
+        rp::arch::UringReactor * reactor = new rp::arch::UringReactor();
+        if (!reactor->start(threadCount, threadConfig)) {
+            delete reactor;
+            return NULL;
+        }
+        return reactor;
+#else
+        return NULL;
+#endif
+    }
+
+    if (backend != BACKEND_EPOLL) return NULL;
+
+    rp::arch::EpollReactor * reactor = new rp::arch::EpollReactor();
+    if (!reactor->start(threadCount, threadConfig)) {
+        delete reactor;
+        return NULL;
+    }
+    return reactor;
+}
+
+void IOReactor::ReleaseReactor(IOReactor * reactor)
+{
+    delete reactor;
+}
+
+}}
@@ -0,0 +1,594 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+// the multishot receives and the provided buffer rings need the io_uring interface of Linux 6.0
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#if defined(IORING_RECV_MULTISHOT)
+#define RP_HAS_IO_URING_REACTOR
+
+#include "arch/linux/net_rx_timestamp.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <poll.h>
+
+namespace rp{ namespace arch{
+
+class UringReactor;
+
+// An io_uring served by a thread of its own, along with the pool of buffers its receive operations pick from
+class UringRing
+{
+public:
+    enum {
+        RING_ENTRIES = 256,
+        BUFFER_COUNT = 64,  // must be power of 2
+        BUFFER_GROUP_ID = 0,
+        // each buffer holds the recvmsg header, the timestamp control message and the payload
+        RX_PAYLOAD_SIZE = 4096,
+        RX_HEADER_SIZE = sizeof(io_uring_recvmsg_out) + net::RX_TIMESTAMP_CMSG_SIZE,
+        BUFFER_SIZE = RX_HEADER_SIZE + RX_PAYLOAD_SIZE,
+    };
+
+    UringRing(UringReactor * owner)
+        : _owner(owner)
+        , _ringfd(-1)
+        , _sqRing(MAP_FAILED)
+        , _cqRing(MAP_FAILED)
+        , _sqes(MAP_FAILED)
+        , _bufRing(MAP_FAILED)
+        , _sqRingSize(0)
+        , _cqRingSize(0)
+        , _sqesSize(0)
+        , _bufRingSize(0)
+        , _bufTail(0)
+    {
+    }
+
+    ~UringRing()
+    {
+        close();
+    }
+
+    bool open()
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        _ringfd = (int)syscall(__NR_io_uring_setup, (unsigned)RING_ENTRIES, &params);
+        if (_ringfd < 0) return false;
+
+        _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(__u32);
+        _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap) {
+            _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+        }
+
+        _sqRing = mmap(NULL, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringfd, IORING_OFF_SQ_RING);
+        if (_sqRing == MAP_FAILED) return false;
+        if (singleMap) {
+            _cqRing = _sqRing;
+        } else {
+            _cqRing = mmap(NULL, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringfd, IORING_OFF_CQ_RING);
+            if (_cqRing == MAP_FAILED) return false;
+        }
+        _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        _sqes = mmap(NULL, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringfd, IORING_OFF_SQES);
+        if (_sqes == MAP_FAILED) return false;
+
+        _u8 * sq = reinterpret_cast<_u8 *>(_sqRing);
+        _sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        _sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        _sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        _sqEntries = params.sq_entries;
+        _sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+        _u8 * cq = reinterpret_cast<_u8 *>(_cqRing);
+        _cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        _cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        _cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        _cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+        // the buffer ring must be page aligned
+        _bufRingSize = BUFFER_COUNT * sizeof(io_uring_buf);
+        _bufRing = mmap(NULL, _bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (_bufRing == MAP_FAILED) return false;
+        _buffers.resize(BUFFER_COUNT * BUFFER_SIZE);
+
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = (__u64)(uintptr_t)_bufRing;
+        reg.ring_entries = BUFFER_COUNT;
+        reg.bgid = BUFFER_GROUP_ID;
+        if (syscall(__NR_io_uring_register, _ringfd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) return false;
+
+        for (int pos = 0; pos < BUFFER_COUNT; ++pos) {
+            recycleBuffer(pos);
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (_bufRing != MAP_FAILED) munmap(_bufRing, _bufRingSize);
+        if (_sqes != MAP_FAILED) munmap(_sqes, _sqesSize);
+        if (_cqRing != MAP_FAILED && _cqRing != _sqRing) munmap(_cqRing, _cqRingSize);
+        if (_sqRing != MAP_FAILED) munmap(_sqRing, _sqRingSize);
+        _bufRing = _sqes = _cqRing = _sqRing = MAP_FAILED;
+
+        if (_ringfd >= 0) {
+            ::close(_ringfd);
+            _ringfd = -1;
+        }
+    }
+
+    // queues a submission, the thread of the ring submits it with its next wait unless flushed by submit()
+    void queue(const io_uring_sqe & sqe)
+    {
+        rp::hal::AutoLocker l(_sqLock);
+        unsigned tail = *_sqTail;
+        while (tail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _sqEntries) {
+            // the submission queue is full, hand the queued ones over to the kernel
+            if (_enter(tail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE), 0, 0) < 0 && errno != EINTR && errno != EBUSY) return;
+        }
+
+        unsigned index = tail & _sqMask;
+        reinterpret_cast<io_uring_sqe *>(_sqes)[index] = sqe;
+        _sqArray[index] = index;
+        __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    // submits the queued submissions from the calling thread
+    void submit()
+    {
+        rp::hal::AutoLocker l(_sqLock);
+        _enter(_pendingSubmissions(), 0, 0);
+    }
+
+    _u8 * getBuffer(int bufferId)
+    {
+        return &_buffers[(size_t)bufferId * BUFFER_SIZE];
+    }
+
+    // only called by the thread of the ring, or before it starts
+    void recycleBuffer(int bufferId)
+    {
+        // not through io_uring_buf_ring::bufs, its empty placeholder struct takes room in C++ and shifts the array
+        io_uring_buf_ring * ring = reinterpret_cast<io_uring_buf_ring *>(_bufRing);
+        io_uring_buf & buf = reinterpret_cast<io_uring_buf *>(_bufRing)[_bufTail & (BUFFER_COUNT - 1)];
+        buf.addr = (__u64)(uintptr_t)getBuffer(bufferId);
+        buf.len = BUFFER_SIZE;
+        buf.bid = (__u16)bufferId;
+        ++_bufTail;
+        __atomic_store_n(&ring->tail, _bufTail, __ATOMIC_RELEASE);
+    }
+
+    u_result _proc_ringThread();
+
+protected:
+    unsigned _pendingSubmissions()
+    {
+        return *_sqTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+    }
+
+    int _enter(unsigned toSubmit, unsigned minComplete, unsigned flags)
+    {
+        return (int)syscall(__NR_io_uring_enter, _ringfd, toSubmit, minComplete, flags, NULL, 0);
+    }
+
+    UringReactor * _owner;
+    int _ringfd;
+
+    void * _sqRing;
+    void * _cqRing;
+    void * _sqes;
+    void * _bufRing;
+    size_t _sqRingSize;
+    size_t _cqRingSize;
+    size_t _sqesSize;
+    size_t _bufRingSize;
+
+    unsigned * _sqHead;
+    unsigned * _sqTail;
+    unsigned * _sqArray;
+    unsigned   _sqMask;
+    unsigned   _sqEntries;
+
+    unsigned * _cqHead;
+    unsigned * _cqTail;
+    unsigned   _cqMask;
+    io_uring_cqe * _cqes;
+
+    __u16 _bufTail;
+    std::vector<_u8> _buffers;
+
+    rp::hal::Locker _sqLock;
+};
+
+
+// One ring per thread, each handle stays on the ring it was added to: its completions are
+// dispatched by a single thread, so the callbacks are serialized and the data is decoded in order.
+// The sockets keep a multishot recvmsg armed and are received straight into the buffer pool of the ring,
+// the other handles (e.g. the serial ports) are polled one shot at a time and read by their handlers.
+class UringReactor : public rp::hal::IOReactor
+{
+public:
+    enum : _u64 {
+        // the user data of the operations not bound to a handle, handle keys never take these values
+        WAKEUP_KEY = 0,
+        CANCEL_KEY = 1,
+    };
+
+    UringReactor()
+        : _isWorking(false)
+        , _generation(0)
+        , _nextRing(0)
+    {
+    }
+
+    virtual ~UringReactor()
+    {
+        stop();
+
+        for (std::map<int, HandleEntry*>::iterator itr = _entries.begin(); itr != _entries.end(); ++itr)
+        {
+            delete itr->second;
+        }
+        _entries.clear();
+
+        for (size_t pos = 0; pos < _rings.size(); ++pos)
+        {
+            delete _rings[pos];
+        }
+        _rings.clear();
+    }
+
+    bool start(int threadCount, const rp::hal::Thread::config_t * threadConfig)
+    {
+        _threadConfig.assign(threadConfig);
+
+        for (int pos = 0; pos < threadCount; ++pos)
+        {
+            UringRing * ring = new UringRing(this);
+            _rings.push_back(ring);
+            if (!ring->open()) return false;
+        }
+
+        _isWorking = true;
+        for (size_t pos = 0; pos < _rings.size(); ++pos)
+        {
+            UringRing * ring = _rings[pos];
+            _threads.push_back(rp::hal::Thread::create_member<UringRing, &UringRing::_proc_ringThread>(ring));
+        }
+        return true;
+    }
+
+    void stop()
+    {
+        if (_isWorking) {
+            _isWorking = false;
+
+            for (size_t pos = 0; pos < _rings.size(); ++pos)
+            {
+                io_uring_sqe sqe;
+                memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_NOP;
+                sqe.user_data = WAKEUP_KEY;
+                _rings[pos]->queue(sqe);
+                _rings[pos]->submit();
+            }
+
+            for (size_t pos = 0; pos < _threads.size(); ++pos)
+            {
+                _threads[pos].join();
+            }
+            _threads.clear();
+        }
+
+        for (size_t pos = 0; pos < _rings.size(); ++pos)
+        {
+            _rings[pos]->close();
+        }
+    }
+
+    const rp::hal::Thread::config_t & getThreadConfig() const
+    {
+        return _threadConfig.config;
+    }
+
+    bool isWorking() const
+    {
+        return _isWorking;
+    }
+
+    virtual size_t getThreadCount() const
+    {
+        return _threads.size();
+    }
+
+    virtual reactor_backend_t getBackend() const
+    {
+        return BACKEND_IO_URING;
+    }
+
+    virtual u_result addHandle(int handle, rp::hal::IOReactorHandler * handler)
+    {
+        if (handle < 0 || !handler) return RESULT_INVALID_DATA;
+
+        rp::hal::AutoLocker l(_lock);
+        if (!_isWorking) return RESULT_OPERATION_FAIL;
+        if (_entries.find(handle) != _entries.end()) return RESULT_ALREADY_DONE;
+
+        HandleEntry * entry = new HandleEntry();
+        entry->handler = handler;
+        entry->generation = ++_generation;
+        // the keys 0 and 1 are reserved
+        if (!entry->generation) entry->generation = ++_generation;
+        entry->ring = _rings[_nextRing++ % _rings.size()];
+        entry->busy = false;
+        entry->removed = false;
+        entry->stopped = false;
+        entry->armed = false;
+
+        struct stat info;
+        int socketType = 0;
+        socklen_t optLen = sizeof(socketType);
+        entry->isSocket = (fstat(handle, &info) == 0 && S_ISSOCK(info.st_mode)
+            && getsockopt(handle, SOL_SOCKET, SO_TYPE, &socketType, &optLen) == 0);
+        entry->isStream = (socketType == SOCK_STREAM);
+
+        memset(&entry->msg, 0, sizeof(entry->msg));
+        entry->msg.msg_controllen = net::RX_TIMESTAMP_CMSG_SIZE;
+
+        _entries[handle] = entry;
+        _arm(handle, entry);
+        entry->ring->submit();
+        return RESULT_OK;
+    }
+
+    virtual void removeHandle(int handle)
+    {
+        rp::hal::AutoLocker l(_lock);
+
+        std::map<int, HandleEntry*>::iterator itr = _entries.find(handle);
+        if (itr == _entries.end()) return;
+
+        HandleEntry * entry = itr->second;
+        entry->removed = true;
+        if (entry->armed) {
+            _cancel(handle, entry);
+            entry->ring->submit();
+        }
+
+        // the armed operation holds a reference of the handle, wait for it to end before the handle gets closed
+        while (entry->busy || (entry->armed && _isWorking)) {
+            _lock.unlock();
+            _idleEvt.wait(10);
+            _lock.lock();
+        }
+
+        _entries.erase(handle);
+        delete entry;
+    }
+
+    // invoked by the thread of the ring for each completion
+    void onCompletion(UringRing & ring, const io_uring_cqe & cqe)
+    {
+        if (cqe.user_data == WAKEUP_KEY || cqe.user_data == CANCEL_KEY) return;
+
+        int bufferId = (cqe.flags & IORING_CQE_F_BUFFER) ? (int)(cqe.flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+        int handle = (int)(cqe.user_data & 0xFFFFFFFF);
+        _u32 generation = (_u32)(cqe.user_data >> 32);
+
+        HandleEntry * entry = NULL;
+        {
+            rp::hal::AutoLocker l(_lock);
+            std::map<int, HandleEntry*>::iterator itr = _entries.find(handle);
+            if (itr != _entries.end() && itr->second->generation == generation) {
+                entry = itr->second;
+                if (!(cqe.flags & IORING_CQE_F_MORE)) entry->armed = false;
+
+                if (entry->removed) {
+                    _idleEvt.set();
+                    entry = NULL;
+                } else if (entry->stopped) {
+                    entry = NULL;
+                } else {
+                    entry->busy = true;
+                }
+            }
+        }
+
+        if (!entry) {
+            // stale completion of a removed or stopped handle
+            if (bufferId >= 0) ring.recycleBuffer(bufferId);
+            return;
+        }
+
+        bool keepWatching = true;
+        if (entry->isSocket) {
+            if (cqe.res > 0 && bufferId >= 0) {
+                keepWatching = _deliver(ring, entry, ring.getBuffer(bufferId), (size_t)cqe.res);
+            } else if (cqe.res == -ENOBUFS) {
+                // the pool ran dry, rearmed below as the buffers come back
+            } else if (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP) {
+                // no multishot receive for this socket, poll it instead
+                entry->isSocket = false;
+            } else {
+                // end of stream or error, let the channel tell it
+                keepWatching = entry->handler->onIOReadable();
+            }
+        } else {
+            keepWatching = entry->handler->onIOReadable();
+        }
+
+        if (bufferId >= 0) ring.recycleBuffer(bufferId);
+
+        rp::hal::AutoLocker l(_lock);
+        entry->busy = false;
+        if (entry->removed) {
+            _idleEvt.set();
+        } else if (!keepWatching) {
+            entry->stopped = true;
+            if (entry->armed) _cancel(handle, entry);
+        } else if (!entry->armed) {
+            _arm(handle, entry);
+        }
+    }
+
+protected:
+
+    struct HandleEntry {
+        rp::hal::IOReactorHandler * handler;
+        UringRing * ring;
+        _u32 generation;
+        bool isSocket;
+        bool isStream;
+        bool busy;
+        bool removed;
+        bool stopped;   // the handler asked to stop watching
+        bool armed;     // an operation of the handle is pending in the ring
+        struct msghdr msg;
+    };
+
+    static _u64 _keyOf(int handle, const HandleEntry * entry)
+    {
+        return ((_u64)entry->generation << 32) | (_u32)handle;
+    }
+
+    // the caller holds _lock
+    void _arm(int handle, HandleEntry * entry)
+    {
+        io_uring_sqe sqe;
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.fd = handle;
+        sqe.user_data = _keyOf(handle, entry);
+
+        if (entry->isSocket) {
+            sqe.opcode = IORING_OP_RECVMSG;
+            sqe.addr = (__u64)(uintptr_t)&entry->msg;
+            sqe.len = 1;
+            sqe.ioprio = IORING_RECV_MULTISHOT;
+            sqe.flags = IOSQE_BUFFER_SELECT;
+            sqe.buf_group = UringRing::BUFFER_GROUP_ID;
+        } else {
+            // one shot, the readiness is checked again when rearmed, so the data left by the handler is not missed
+            sqe.opcode = IORING_OP_POLL_ADD;
+            sqe.poll32_events = POLLIN;
+        }
+
+        entry->armed = true;
+        entry->ring->queue(sqe);
+    }
+
+    // the caller holds _lock
+    void _cancel(int handle, HandleEntry * entry)
+    {
+        io_uring_sqe sqe;
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_ASYNC_CANCEL;
+        sqe.addr = _keyOf(handle, entry);
+        sqe.user_data = CANCEL_KEY;
+        entry->ring->queue(sqe);
+    }
+
+    bool _deliver(UringRing & ring, HandleEntry * entry, const _u8 * buffer, size_t usedSize)
+    {
+        if (usedSize < UringRing::RX_HEADER_SIZE) return true;
+
+        const io_uring_recvmsg_out * out = reinterpret_cast<const io_uring_recvmsg_out *>(buffer);
+        size_t payloadSize = std::min<size_t>(out->payloadlen, usedSize - UringRing::RX_HEADER_SIZE);
+        if (!payloadSize) {
+            // the stream was closed, an empty datagram is just skipped
+            return entry->isStream ? entry->handler->onIOReadable() : true;
+        }
+
+        _u64 rxTimestamp_uS = 0;
+        if (out->controllen) {
+            struct msghdr control;
+            memset(&control, 0, sizeof(control));
+            control.msg_control = const_cast<_u8 *>(buffer + sizeof(io_uring_recvmsg_out));
+            control.msg_controllen = out->controllen;
+            rxTimestamp_uS = net::_parse_rx_timestamp(control);
+        }
+        return entry->handler->onIOData(buffer + UringRing::RX_HEADER_SIZE, payloadSize, rxTimestamp_uS);
+    }
+
+    volatile bool _isWorking;
+    _u32 _generation;
+    size_t _nextRing;
+
+    rp::hal::Locker _lock;
+    rp::hal::Event  _idleEvt;
+    std::map<int, HandleEntry*> _entries;
+    std::vector<UringRing*> _rings;
+    std::vector<rp::hal::Thread> _threads;
+    ReactorThreadConfig _threadConfig;
+};
+
+inline u_result UringRing::_proc_ringThread()
+{
+    rp::hal::Thread::SetSelfConfig(_owner->getThreadConfig(), "sl_uring", rp::hal::Thread::PRIORITY_HIGH);
+
+    while (_owner->isWorking())
+    {
+        unsigned toSubmit;
+        {
+            rp::hal::AutoLocker l(_sqLock);
+            toSubmit = _pendingSubmissions();
+        }
+        // submits the rearms queued by the last round and waits for the next completion in a single call
+        if (_enter(toSubmit, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+            break;
+        }
+
+        unsigned head = *_cqHead;
+        while (head != __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe cqe = _cqes[head & _cqMask];
+            __atomic_store_n(_cqHead, ++head, __ATOMIC_RELEASE);
+            _owner->onCompletion(*this, cqe);
+        }
+    }
+    return RESULT_OK;
+}
+
+}}
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include <sys/socket.h>
+#include <linux/net_tstamp.h>
+
+namespace rp{ namespace arch{ namespace net{
+
+// the software receive timestamps of SO_TIMESTAMPING
+// the hardware ones run on the clock of the NIC, which getus() knows nothing about
+static inline int _enable_rx_timestamp(int socket_fd, bool enable)
+{
+    int flags = enable ? (SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE) : 0;
+    return ::setsockopt(socket_fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags));
+}
+
+// the timestamp carried by the control message of a received message, converted from CLOCK_REALTIME to the getus() time base
+static inline _u64 _parse_rx_timestamp(struct msghdr& msg)
+{
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SO_TIMESTAMPING) continue;
+
+        struct timespec captured;
+        memcpy(&captured, CMSG_DATA(cmsg), sizeof(captured)); // ts[0] of scm_timestamping is the software one
+        if (!captured.tv_sec && !captured.tv_nsec) return 0;
+
+        struct timespec realtimeNow;
+        clock_gettime(CLOCK_REALTIME, &realtimeNow);
+        _u64 nowUs = getus();
+        _s64 ageUs = (_s64)(realtimeNow.tv_sec - captured.tv_sec) * 1000000LL + (realtimeNow.tv_nsec - captured.tv_nsec) / 1000;
+        if (ageUs < 0) ageUs = 0; // the wall clock stepped back meanwhile
+        return ((_u64)ageUs < nowUs) ? nowUs - ageUs : 0;
+    }
+    return 0;
+}
+
+enum {
+    RX_TIMESTAMP_CMSG_SIZE = CMSG_SPACE(sizeof(struct timespec) * 3),
+};
+
+}}}
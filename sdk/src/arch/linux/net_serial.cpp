@@ -35,6 +35,7 @@
 #include "arch/linux/arch_linux.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
@@ -47,6 +48,7 @@
 #include "hal/types.h"
 #include "arch/linux/net_serial.h"
 #include <sys/select.h>
+#include <poll.h>
 
 #include <algorithm>
 //__GNUC__
@@ -55,6 +57,7 @@
 #include <asm/ioctls.h>
 #include <asm/termbits.h>
 #include <sys/ioctl.h>
+#include <linux/serial.h>
 extern "C" int tcflush(int fildes, int queue_selector);
 #else
 // for other standard UNIX
@@ -188,6 +191,8 @@ bool raw_serial::open(const char * portname, uint32_t baudrate, uint32_t flags)
 
     tcflush(serial_fd, TCIFLUSH);
 
+    if (flags & SERIAL_FLAG_LOW_LATENCY) _setLowLatency();
+
     if (fcntl(serial_fd, F_SETFL, FNDELAY))
     {
         close();
@@ -221,6 +226,14 @@ bool raw_serial::open(const char * portname, uint32_t baudrate, uint32_t flags)
             break;
 
     } while (0);
+
+    // polled as is by each wait
+    _pollfds[0].fd = serial_fd;
+    _pollfds[0].events = POLLIN;
+    _pollfds[1].fd = _selfpipe[0];
+    _pollfds[1].events = POLLIN;
+    _pollfdCount = (_selfpipe[0] != -1 && _selfpipe[1] != -1) ? 2 : 1;
+    _rxCacheHead = _rxCacheTail = 0;
     
     return true;
 }
@@ -241,6 +254,8 @@ void raw_serial::close()
 
     _operation_aborted = false;
     _is_serial_opened = false;
+    _pollfdCount = 0;
+    _rxCacheHead = _rxCacheTail = 0;
 }
 
 int raw_serial::senddata(const unsigned char * data, size_t size)
@@ -269,8 +284,16 @@ int raw_serial::senddata(const unsigned char * data, size_t size)
 int raw_serial::recvdata(unsigned char * data, size_t size)
 {
     if (!isOpened()) return 0;
-    
-    int ans = ::read(serial_fd, data, size);
+
+    int ans;
+    if (_rxCacheTail != _rxCacheHead) {
+        // what waitfordata() has read already
+        ans = (int)std::min<size_t>(size, _rxCacheTail - _rxCacheHead);
+        memcpy(data, _rxCache + _rxCacheHead, ans);
+        _rxCacheHead += ans;
+    } else {
+        ans = ::read(serial_fd, data, size);
+    }
     
     if (ans == -1) ans=0;
     required_rx_cnt = ans;
@@ -281,6 +304,7 @@ int raw_serial::recvdata(unsigned char * data, size_t size)
 void raw_serial::flush( _u32 flags)
 {
     tcflush(serial_fd,TCIFLUSH); 
+    _rxCacheHead = _rxCacheTail = 0;
 }
 
 int raw_serial::waitforsent(_u32 timeout, size_t * returned_size)
@@ -297,92 +321,91 @@ int raw_serial::waitforrecv(_u32 timeout, size_t * returned_size)
     return 0;
 }
 
+bool raw_serial::_fillRxCache()
+{
+    if (_rxCacheHead == _rxCacheTail) {
+        _rxCacheHead = _rxCacheTail = 0;
+    } else if (_rxCacheTail == SERIAL_RX_CACHE_SIZE && _rxCacheHead) {
+        memmove(_rxCache, _rxCache + _rxCacheHead, _rxCacheTail - _rxCacheHead);
+        _rxCacheTail -= _rxCacheHead;
+        _rxCacheHead = 0;
+    }
+
+    size_t room = SERIAL_RX_CACHE_SIZE - _rxCacheTail;
+    if (!room) return true;
+
+    // non blocking, 0 when nothing is pending as VMIN and VTIME are 0
+    int ans = ::read(serial_fd, _rxCache + _rxCacheTail, room);
+    if (ans > 0) {
+        _rxCacheTail += ans;
+        return true;
+    }
+    return ans == 0 || errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
 int raw_serial::waitfordata(size_t data_count, _u32 timeout, size_t * returned_size)
 {
     size_t length = 0;
     if (returned_size==NULL) returned_size=(size_t *)&length;
     *returned_size = 0;
 
-    int max_fd;
-    fd_set input_set;
-    struct timeval timeout_val;
-
-    /* Initialize the input set */
-    FD_ZERO(&input_set);
-    FD_SET(serial_fd, &input_set);
+    if ( !isOpened() ) return ANS_DEV_ERR;
 
-    if (_selfpipe[0] != -1)
-        FD_SET(_selfpipe[0], &input_set);
+    // the bytes trickling in below data_count do not restart the wait, each round polls for the time left
+    const bool isInfinite = (timeout == (_u32)-1);
+    _u64 deadline = getms() + timeout;
 
-    max_fd =  std::max<int>(serial_fd, _selfpipe[0]) + 1;
-
-    /* Initialize the timeout structure */
-    timeout_val.tv_sec = timeout / 1000;
-    timeout_val.tv_usec = (timeout % 1000) * 1000;
-
-    if ( isOpened() )
-    {
-        int nread;
-
-        if ( ioctl(serial_fd, FIONREAD, &nread) == -1) return ANS_DEV_ERR;
-
-        *returned_size = nread;
+    // the data is read as soon as it is known to be there, the wait is only entered when nothing is pending
+    for (;;) {
+        if (_rxCacheTail - _rxCacheHead < data_count && _rxCacheTail - _rxCacheHead < SERIAL_RX_CACHE_SIZE) {
+            if (!_fillRxCache()) return ANS_DEV_ERR;
+        }
 
-        if (*returned_size >= data_count)
-        {
+        *returned_size = _rxCacheTail - _rxCacheHead;
+        if (*returned_size >= data_count || *returned_size == SERIAL_RX_CACHE_SIZE) {
             return 0;
         }
-    }
 
-    while ( isOpened() )
-    {
-        /* Do the select */
-        int n = ::select(max_fd, &input_set, NULL, NULL, &timeout_val);
+        int waitMs = -1;
+        if (!isInfinite) {
+            _u64 now = getms();
+            waitMs = deadline > now ? (int)std::min<_u64>(deadline - now, INT_MAX) : 0;
+        }
+        int n = ::poll(_pollfds, _pollfdCount, waitMs);
+
+        if (n < 0 && errno == EINTR) continue;
+        *returned_size = 0;
 
         if (n < 0)
         {
-            // select error
-            *returned_size =  0;
+            // poll error
             return ANS_DEV_ERR;
         }
         else if (n == 0)
         {
             // time out
-            *returned_size =0;
             return ANS_TIMEOUT;
         }
-        else
-        {
-            if (FD_ISSET(_selfpipe[0], &input_set)) {   
-                // require aborting the current operation
-                int ch;
-                for (;;) {                    
-                    if (::read(_selfpipe[0], &ch, 1) == -1) {
-                        break;
-                    }
-                    
-                }
 
-                // treat as  timeout
-                *returned_size = 0;
-                return ANS_TIMEOUT;
+        if (_pollfdCount > 1 && _pollfds[1].revents) {
+            // require aborting the current operation
+            int ch;
+            for (;;) {
+                if (::read(_selfpipe[0], &ch, 1) == -1) {
+                    break;
+                }
             }
 
-            // data avaliable
-            assert (FD_ISSET(serial_fd, &input_set));
-
+            // treat as  timeout
+            return ANS_TIMEOUT;
+        }
 
-            if ( ioctl(serial_fd, FIONREAD, returned_size) == -1) return ANS_DEV_ERR;
-            if (*returned_size >= data_count)
-            {
-                return 0;
-            }
+        if (_pollfds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            // the device is gone
+            return ANS_DEV_ERR;
         }
-        
+        // data avaliable, read on the next round
     }
-
-    *returned_size=0;
-    return ANS_DEV_ERR;
 }
 
 size_t raw_serial::rxqueue_count()
@@ -391,7 +414,7 @@ size_t raw_serial::rxqueue_count()
     size_t remaining;
     
     if (::ioctl(serial_fd, FIONREAD, &remaining) == -1) return 0;
-    return remaining;
+    return remaining + (_rxCacheTail - _rxCacheHead);
 }
 
 void raw_serial::setDTR()
@@ -417,6 +440,52 @@ void raw_serial::_init()
     required_tx_cnt = required_rx_cnt = 0;
     _operation_aborted = false;
     _selfpipe[0] = _selfpipe[1] = -1;
+    _pollfdCount = 0;
+    _rxCacheHead = _rxCacheTail = 0;
+}
+
+void raw_serial::_setLowLatency()
+{
+#if defined(__GNUC__)
+    // not fatal, the ptys and the ACM devices do not support it
+    struct serial_struct serinfo;
+    if (ioctl(serial_fd, TIOCGSERIAL, &serinfo) == -1) return;
+
+    // the FTDI adapters also drop their latency timer to 1 ms
+    serinfo.flags |= ASYNC_LOW_LATENCY;
+    ioctl(serial_fd, TIOCSSERIAL, &serinfo);
+#endif
+}
+
+bool raw_serial::getLatencySettings(bool& lowLatency, int& latencyTimerMs)
+{
+    if (!isOpened()) return false;
+
+#if defined(__GNUC__)
+    struct serial_struct serinfo;
+    if (ioctl(serial_fd, TIOCGSERIAL, &serinfo) == -1) return false;
+    lowLatency = (serinfo.flags & ASYNC_LOW_LATENCY) != 0;
+#else
+    lowLatency = false;
+#endif
+
+    // the usb-serial adapters with a latency timer expose it in the sysfs, after the name of the tty
+    latencyTimerMs = -1;
+    char ttyPath[PATH_MAX];
+    if (!realpath(_portName, ttyPath)) return true;
+
+    const char* ttyName = strrchr(ttyPath, '/');
+    ttyName = ttyName ? ttyName + 1 : ttyPath;
+
+    char sysfsPath[PATH_MAX + 64];
+    snprintf(sysfsPath, sizeof(sysfsPath), "/sys/class/tty/%s/device/latency_timer", ttyName);
+    FILE* file = fopen(sysfsPath, "r");
+    if (!file) return true;
+
+    int latency;
+    if (fscanf(file, "%d", &latency) == 1) latencyTimerMs = latency;
+    fclose(file);
+    return true;
 }
 
 void raw_serial::cancelOperation()
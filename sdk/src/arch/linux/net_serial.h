@@ -35,6 +35,7 @@
 #pragma once
 
 #include "hal/abs_rxtx.h"
+#include <poll.h>
 
 namespace rp{ namespace arch{ namespace net{
 
@@ -44,6 +45,8 @@ public:
     enum{
         SERIAL_RX_BUFFER_SIZE = 512,
         SERIAL_TX_BUFFER_SIZE = 128,
+        // what one read may take from the port
+        SERIAL_RX_CACHE_SIZE  = 16384,
     };
 
     raw_serial();
@@ -70,9 +73,15 @@ public:
 
     virtual void cancelOperation();
 
+    virtual bool getLatencySettings(bool& lowLatency, int& latencyTimerMs);
+
+    virtual int getNativeHandle() { return isOpened() ? serial_fd : -1; }
+
 protected:
     bool open(const char * portname, uint32_t baudrate, uint32_t flags = 0);
     void _init();
+    void _setLowLatency();
+    bool _fillRxCache();
 
     char _portName[200];
     uint32_t _baudrate;
@@ -85,6 +94,14 @@ protected:
 
     int    _selfpipe[2];
     bool   _operation_aborted;
+
+    struct pollfd _pollfds[2];      // the port and the read end of _selfpipe
+    int    _pollfdCount;
+
+    // filled by waitfordata() and drained by recvdata(), on the rx thread
+    _u8    _rxCache[SERIAL_RX_CACHE_SIZE];
+    size_t _rxCacheHead;
+    size_t _rxCacheTail;
 };
 
 }}}
@@ -9,6 +9,7 @@
 
 #include "sdkcommon.h"
 #include "../../hal/socket.h"
+#include "net_rx_timestamp.h"
 
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -320,12 +321,67 @@ namespace rp { namespace arch { namespace net{
 
 using namespace rp::net;
 
+// wakes up the waits on a socket, it stays signalled until the socket is disposed
+class _wait_canceller
+{
+public:
+    _wait_canceller()
+    {
+        _pipe[0] = _pipe[1] = -1;
+        if (::pipe(_pipe) == -1) return;
+        for (int pos = 0; pos < 2; ++pos) {
+            int flags = fcntl(_pipe[pos], F_GETFL);
+            if (flags != -1) fcntl(_pipe[pos], F_SETFL, flags | O_NONBLOCK);
+        }
+    }
+
+    ~_wait_canceller()
+    {
+        if (_pipe[0] != -1) ::close(_pipe[0]);
+        if (_pipe[1] != -1) ::close(_pipe[1]);
+    }
+
+    void cancel()
+    {
+        if (_pipe[1] == -1) return;
+        ssize_t ans = ::write(_pipe[1], "x", 1);
+        (void)ans;
+    }
+
+    u_result waitforReadable(int socket_fd, _u32 timeout)
+    {
+        fd_set rdset;
+        FD_ZERO(&rdset);
+        FD_SET(socket_fd, &rdset);
+        if (_pipe[0] != -1) FD_SET(_pipe[0], &rdset);
+
+        timeval tv;
+        tv.tv_sec = timeout / 1000;
+        tv.tv_usec = (timeout % 1000) * 1000;
+        int ans = ::select(std::max<int>(socket_fd, _pipe[0]) + 1, &rdset, NULL, NULL, &tv);
+
+        if (ans < 0) {
+            delay(0); //relax cpu
+            return RESULT_OPERATION_FAIL;
+        }
+        if (ans == 0 || (_pipe[0] != -1 && FD_ISSET(_pipe[0], &rdset))) {
+            // timeout or canceled
+            return RESULT_OPERATION_TIMEOUT;
+        }
+        return RESULT_OK;
+    }
+
+private:
+    int _pipe[2];
+};
+
 class _single_thread StreamSocketImpl : public StreamSocket
 {
 public:
 
     StreamSocketImpl(int fd)
         : _socket_fd(fd)
+        , _isRxTimestampEnabled(false)
     {
         assert(fd>=0);
         int bool_true = 1;
@@ -483,6 +539,52 @@ public:
         }
     }
 
+    virtual u_result recvTimestamped(void *buf, size_t len, size_t & recv_len, _u64 & rxTimestamp_uS)
+    {
+        rxTimestamp_uS = 0;
+        if (!_isRxTimestampEnabled) {
+            return recv(buf, len, recv_len);
+        }
+
+        struct iovec iov;
+        iov.iov_base = buf;
+        iov.iov_len = len;
+        _u8 control[RX_TIMESTAMP_CMSG_SIZE];
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t ans = ::recvmsg(_socket_fd, &msg, 0);
+        if (ans == -1) {
+            recv_len = 0;
+
+            switch (errno) {
+                case EAGAIN:
+#if EWOULDBLOCK!=EAGAIN
+                case EWOULDBLOCK:
+#endif
+                    return RESULT_OPERATION_TIMEOUT;
+                default:
+                    return RESULT_OPERATION_FAIL;
+            }
+        }
+
+        recv_len = (size_t)ans;
+        if (ans) rxTimestamp_uS = _parse_rx_timestamp(msg);
+        return RESULT_OK;
+    }
+
+    virtual u_result enableRxTimestamp(bool enable)
+    {
+        if (_enable_rx_timestamp(_socket_fd, enable)) return RESULT_OPERATION_FAIL;
+        _isRxTimestampEnabled = enable;
+        return RESULT_OK;
+    }
+
 #if 0
     virtual u_result recvNoWait(void *buf, size_t len, size_t & recv_len)
     {
@@ -550,6 +652,20 @@ public:
         return ::setsockopt( _socket_fd, IPPROTO_TCP, TCP_NODELAY,&bool_true, sizeof(bool_true) )?RESULT_OPERATION_FAIL:RESULT_OK;
     }
 
+    virtual u_result setRxBufferSize(size_t size)
+    {
+        int bufSize = (int)size;
+        return ::setsockopt(_socket_fd, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize)) ? RESULT_OPERATION_FAIL : RESULT_OK;
+    }
+
+    virtual u_result getRxQueueSize(size_t & size)
+    {
+        int pending = 0;
+        if (::ioctl(_socket_fd, FIONREAD, &pending) == -1) return RESULT_OPERATION_FAIL;
+        size = (size_t)pending;
+        return RESULT_OK;
+    }
+
     virtual u_result waitforSent(_u32 timeout ) 
     {
         fd_set wrset;
@@ -576,30 +692,23 @@ public:
 
     virtual u_result waitforData(_u32 timeout )
     {
-        fd_set rdset;
-        FD_ZERO(&rdset);
-        FD_SET(_socket_fd, &rdset);
+        return _canceller.waitforReadable(_socket_fd, timeout);
+    }
 
-        timeval tv;
-        tv.tv_sec = timeout / 1000;
-        tv.tv_usec = (timeout % 1000) * 1000;
-        int ans = ::select(_socket_fd+1, &rdset, NULL, NULL, &tv);
+    virtual void cancelWaits()
+    {
+        _canceller.cancel();
+    }
 
-        switch (ans) {
-            case 1:
-                // fired
-                return RESULT_OK;
-            case 0:
-                // timeout
-                return RESULT_OPERATION_TIMEOUT;
-            default:
-                delay(0); //relax cpu
-                return RESULT_OPERATION_FAIL;
-        }
+    virtual int getNativeHandle()
+    {
+        return _socket_fd;
     }
 
 protected:
     int  _socket_fd;
+    _wait_canceller _canceller;
+    bool _isRxTimestampEnabled;
 
 
 };
@@ -611,6 +720,7 @@ public:
 
     DGramSocketImpl(int fd)
         : _socket_fd(fd)
+        , _isRxTimestampEnabled(false)
     {
         assert(fd>=0);
         int bool_true = 1;
@@ -702,26 +812,12 @@ public:
 
     virtual u_result waitforData(_u32 timeout )
     {
-        fd_set rdset;
-        FD_ZERO(&rdset);
-        FD_SET(_socket_fd, &rdset);
-
-        timeval tv;
-        tv.tv_sec = timeout / 1000;
-        tv.tv_usec = (timeout % 1000) * 1000;
-        int ans = ::select(_socket_fd+1, &rdset, NULL, NULL, &tv);
+        return _canceller.waitforReadable(_socket_fd, timeout);
+    }
 
-        switch (ans) {
-            case 1:
-                // fired
-                return RESULT_OK;
-            case 0:
-                // timeout
-                return RESULT_OPERATION_TIMEOUT;
-            default:
-                delay(0); //relax cpu
-                return RESULT_OPERATION_FAIL;
-        }
+    virtual void cancelWaits()
+    {
+        _canceller.cancel();
     }
 
     virtual u_result sendTo(const SocketAddress * target, const void * buffer, size_t len)
@@ -806,6 +902,112 @@ public:
 
     }
 
+    virtual u_result recvBatch(_u8 * slab, size_t slotSize, size_t * sizes, _u64 * timestamps_uS, size_t count, size_t & received, SocketAddress * sourceAddrs)
+    {
+        enum {
+            MAX_BATCH_PER_CALL = 64,
+        };
+        struct mmsghdr msgs[MAX_BATCH_PER_CALL];
+        struct iovec iovs[MAX_BATCH_PER_CALL];
+        _u8 controls[MAX_BATCH_PER_CALL][RX_TIMESTAMP_CMSG_SIZE];
+
+        received = 0;
+        while (received < count) {
+            size_t batch = count - received;
+            if (batch > MAX_BATCH_PER_CALL) batch = MAX_BATCH_PER_CALL;
+
+            memset(msgs, 0, sizeof(msgs[0]) * batch);
+            for (size_t pos = 0; pos < batch; ++pos) {
+                iovs[pos].iov_base = slab + (received + pos) * slotSize;
+                iovs[pos].iov_len = slotSize;
+                msgs[pos].msg_hdr.msg_iov = &iovs[pos];
+                msgs[pos].msg_hdr.msg_iovlen = 1;
+                if (sourceAddrs) {
+                    msgs[pos].msg_hdr.msg_name = const_cast<void *>(sourceAddrs[received + pos].getPlatformData());
+                    msgs[pos].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+                }
+                if (_isRxTimestampEnabled) {
+                    msgs[pos].msg_hdr.msg_control = controls[pos];
+                    msgs[pos].msg_hdr.msg_controllen = sizeof(controls[pos]);
+                }
+            }
+
+            int ans = ::recvmmsg(_socket_fd, msgs, (unsigned int)batch, MSG_DONTWAIT, NULL);
+            if (ans <= 0) {
+                if (ans < 0 && errno != EAGAIN && errno != EWOULDBLOCK && !received) {
+                    return RESULT_OPERATION_FAIL;
+                }
+                break;
+            }
+
+            for (int pos = 0; pos < ans; ++pos) {
+                sizes[received + pos] = msgs[pos].msg_len;
+                if (timestamps_uS) {
+                    timestamps_uS[received + pos] = _isRxTimestampEnabled ? _parse_rx_timestamp(msgs[pos].msg_hdr) : 0;
+                }
+            }
+            received += ans;
+            if ((size_t)ans < batch) break;
+        }
+        return received ? RESULT_OK : RESULT_OPERATION_TIMEOUT;
+    }
+
+    virtual u_result setRxBufferSize(size_t size)
+    {
+        int bufSize = (int)size;
+        return ::setsockopt(_socket_fd, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize)) ? RESULT_OPERATION_FAIL : RESULT_OK;
+    }
+
+    virtual u_result enableBroadcast(bool enable)
+    {
+        int flag = enable ? 1 : 0;
+        return ::setsockopt(_socket_fd, SOL_SOCKET, SO_BROADCAST, &flag, sizeof(flag)) ? RESULT_OPERATION_FAIL : RESULT_OK;
+    }
+
+    virtual u_result enableAddressReuse(bool enable)
+    {
+        int flag = enable ? 1 : 0;
+        if (::setsockopt(_socket_fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag))) return RESULT_OPERATION_FAIL;
+        return RESULT_OK;
+    }
+
+    virtual u_result joinMulticastGroup(const SocketAddress & group, const SocketAddress * localInterface)
+    {
+        if (group.getAddressType() != SocketAddress::ADDRESS_TYPE_INET) return RESULT_OPERATION_NOT_SUPPORT;
+        if (localInterface && localInterface->getAddressType() != SocketAddress::ADDRESS_TYPE_INET) return RESULT_OPERATION_NOT_SUPPORT;
+
+        struct ip_mreq request;
+        request.imr_multiaddr = reinterpret_cast<const sockaddr_in *>(group.getPlatformData())->sin_addr;
+        if (localInterface) {
+            request.imr_interface = reinterpret_cast<const sockaddr_in *>(localInterface->getPlatformData())->sin_addr;
+        } else {
+            request.imr_interface.s_addr = htonl(INADDR_ANY);
+        }
+        return ::setsockopt(_socket_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) ? RESULT_OPERATION_FAIL : RESULT_OK;
+    }
+
+    virtual u_result setMulticastOptions(int ttl, bool loopback, const SocketAddress * localInterface)
+    {
+        unsigned char hops = (unsigned char)ttl;
+        unsigned char loop = loopback ? 1 : 0;
+        if (::setsockopt(_socket_fd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops))) return RESULT_OPERATION_FAIL;
+        if (::setsockopt(_socket_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop))) return RESULT_OPERATION_FAIL;
+
+        if (localInterface) {
+            if (localInterface->getAddressType() != SocketAddress::ADDRESS_TYPE_INET) return RESULT_OPERATION_NOT_SUPPORT;
+            struct in_addr iface = reinterpret_cast<const sockaddr_in *>(localInterface->getPlatformData())->sin_addr;
+            if (::setsockopt(_socket_fd, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface))) return RESULT_OPERATION_FAIL;
+        }
+        return RESULT_OK;
+    }
+
+    virtual u_result enableRxTimestamp(bool enable)
+    {
+        if (_enable_rx_timestamp(_socket_fd, enable)) return RESULT_OPERATION_FAIL;
+        _isRxTimestampEnabled = enable;
+        return RESULT_OK;
+    }
+
 #if 0
     virtual u_result recvFromNoWait(void *buf, size_t len, size_t & recv_len, SocketAddress * sourceAddr)
     {
@@ -832,8 +1034,15 @@ public:
     }
 #endif
     
+    virtual int getNativeHandle()
+    {
+        return _socket_fd;
+    }
+
 protected:
     int  _socket_fd;
+    _wait_canceller _canceller;
+    bool _isRxTimestampEnabled;
 
 };
 
@@ -147,6 +147,59 @@ u_result Thread::SetSelfPriority( priority_val_t p)
 	return  RESULT_OK;
 }
 
+u_result Thread::SetSelfConfig(const config_t& config, const char* defaultName, priority_val_t defaultPriority)
+{
+    u_result ans = RESULT_OK;
+    pid_t selfTid = syscall(SYS_gettid);
+
+    const char* name = config.name ? config.name : defaultName;
+    if (name) {
+        // the kernel keeps 15 characters
+        char shortName[16];
+        strncpy(shortName, name, sizeof(shortName) - 1);
+        shortName[sizeof(shortName) - 1] = 0;
+        if (pthread_setname_np(pthread_self(), shortName)) ans = RESULT_OPERATION_FAIL;
+    }
+
+    if (config.cpuMask) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; ++cpu) {
+            if (config.cpuMask & (1ULL << cpu)) CPU_SET(cpu, &cpus);
+        }
+        if (sched_setaffinity(selfTid, sizeof(cpus), &cpus)) ans = RESULT_OPERATION_FAIL;
+    }
+
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+
+    switch (config.policy) {
+    case SCHED_POLICY_DEFAULT:
+        if (IS_FAIL(SetSelfPriority(defaultPriority))) ans = RESULT_OPERATION_FAIL;
+        break;
+    case SCHED_POLICY_OTHER:
+        if (sched_setscheduler(selfTid, SCHED_OTHER | SCHED_RESET_ON_FORK, &param)
+            || setpriority(PRIO_PROCESS, selfTid, config.priority)) {
+            ans = RESULT_OPERATION_FAIL;
+        }
+        break;
+    case SCHED_POLICY_FIFO:
+    case SCHED_POLICY_RR:
+        {
+            int policy = (config.policy == SCHED_POLICY_FIFO) ? SCHED_FIFO : SCHED_RR;
+            int minPriority = sched_get_priority_min(policy);
+            int maxPriority = sched_get_priority_max(policy);
+            param.sched_priority = config.priority < minPriority ? minPriority
+                : (config.priority > maxPriority ? maxPriority : config.priority);
+            // needs CAP_SYS_NICE or an RLIMIT_RTPRIO allowing the priority
+            if (sched_setscheduler(selfTid, policy | SCHED_RESET_ON_FORK, &param)) ans = RESULT_OPERATION_FAIL;
+        }
+        break;
+    }
+
+    return ans;
+}
+
 Thread::priority_val_t Thread::getPriority()
 {
 	if (!this->_handle) return PRIORITY_NORMAL;
@@ -35,18 +35,66 @@
 #include "arch/linux/arch_linux.h"
 
 namespace rp{ namespace arch{
+
+static inline _u64 _timespec_to_us(const struct timespec& t)
+{
+    return (_u64)t.tv_sec*1000000ULL + t.tv_nsec/1000;
+}
+
 _u64 rp_getus()
 {
     struct timespec t;
     t.tv_sec = t.tv_nsec = 0;
     clock_gettime(CLOCK_MONOTONIC, &t);
-    return t.tv_sec*1000000LL + t.tv_nsec/1000;
+    return _timespec_to_us(t);
 }
+
 _u64 rp_getms()
 {
-    struct timespec t;
-    t.tv_sec = t.tv_nsec = 0;
-    clock_gettime(CLOCK_MONOTONIC, &t);
-    return t.tv_sec*1000L + t.tv_nsec/1000000L;
+    return rp_getus() / 1000;
+}
+
+void rp_delay_us(_u64 us)
+{
+    if (!us) return;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += us / 1000000;
+    deadline.tv_nsec += (us % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_nsec -= 1000000000L;
+        ++deadline.tv_sec;
+    }
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR);
+}
+
+void rp_getclockinfo(const char*& name, _u32& resolution_ns, _s64& realtime_offset_us)
+{
+    name = "CLOCK_MONOTONIC";
+
+    struct timespec res;
+    res.tv_sec = res.tv_nsec = 0;
+    clock_getres(CLOCK_MONOTONIC, &res);
+    resolution_ns = (_u32)(res.tv_sec*1000000000LL + res.tv_nsec);
+
+    // take the realtime sample bracketed the most tightly by the monotonic ones
+    _u64 bestGap = (_u64)-1;
+    realtime_offset_us = 0;
+    for (int i = 0; i < 5; ++i) {
+        struct timespec mono0, real, mono1;
+        clock_gettime(CLOCK_MONOTONIC, &mono0);
+        clock_gettime(CLOCK_REALTIME, &real);
+        clock_gettime(CLOCK_MONOTONIC, &mono1);
+
+        _u64 before = _timespec_to_us(mono0);
+        _u64 after = _timespec_to_us(mono1);
+        if (after - before < bestGap) {
+            bestGap = after - before;
+            realtime_offset_us = (_s64)_timespec_to_us(real) - (_s64)(before + (after - before) / 2);
+        }
+    }
 }
+
 }}
@@ -0,0 +1,309 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+
+#include "arch/macOS/arch_macOS.h"
+#include "hal/thread.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+
+#include <sys/event.h>
+#include <map>
+#include <vector>
+
+namespace rp{ namespace arch{
+
+// the thread config given to CreateReactor, with its own copy of the name
+struct ReactorThreadConfig
+{
+    ReactorThreadConfig()
+    {
+        memset(&config, 0, sizeof(config));
+    }
+
+    void assign(const rp::hal::Thread::config_t * src)
+    {
+        if (!src) return;
+        config = *src;
+        if (src->name) {
+            name = src->name;
+            config.name = name.c_str();
+        }
+    }
+
+    rp::hal::Thread::config_t config;
+    std::string name;
+};
+
+// The kqueue counterpart of the Linux EpollReactor, the handles are watched with EV_DISPATCH
+// so that each one is served by a single thread at a time and its data is decoded in order
+class KqueueReactor : public rp::hal::IOReactor
+{
+public:
+    enum {
+        MAX_EVENTS_PER_WAIT = 16,
+        WAKEUP_IDENT = 0,   // of the EVFILT_USER event triggered on stop
+    };
+
+    KqueueReactor()
+        : _kqfd(-1)
+        , _isWorking(false)
+        , _generation(0)
+    {
+    }
+
+    virtual ~KqueueReactor()
+    {
+        stop();
+
+        for (std::map<int, HandleEntry*>::iterator itr = _entries.begin(); itr != _entries.end(); ++itr)
+        {
+            delete itr->second;
+        }
+        _entries.clear();
+    }
+
+    bool start(int threadCount, const rp::hal::Thread::config_t * threadConfig)
+    {
+        _threadConfig.assign(threadConfig);
+
+        _kqfd = kqueue();
+        if (_kqfd < 0) return false;
+        fcntl(_kqfd, F_SETFD, FD_CLOEXEC);
+
+        // the user event stays triggered once fired (EV_CLEAR unset), so it wakes up all the threads
+        struct kevent evt;
+        EV_SET(&evt, WAKEUP_IDENT, EVFILT_USER, EV_ADD, 0, 0, NULL);
+        if (kevent(_kqfd, &evt, 1, NULL, 0, NULL)) {
+            _closeHandles();
+            return false;
+        }
+
+        _isWorking = true;
+        for (int pos = 0; pos < threadCount; ++pos)
+        {
+            _threads.push_back(CLASS_THREAD(KqueueReactor, _proc_reactorThread));
+        }
+        return true;
+    }
+
+    void stop()
+    {
+        if (_isWorking) {
+            _isWorking = false;
+
+            struct kevent evt;
+            EV_SET(&evt, WAKEUP_IDENT, EVFILT_USER, 0, NOTE_TRIGGER, 0, NULL);
+            if (kevent(_kqfd, &evt, 1, NULL, 0, NULL)) {
+                assert(!"failed to wake up the reactor threads");
+            }
+
+            for (size_t pos = 0; pos < _threads.size(); ++pos)
+            {
+                _threads[pos].join();
+            }
+            _threads.clear();
+        }
+        _closeHandles();
+    }
+
+    virtual size_t getThreadCount() const
+    {
+        return _threads.size();
+    }
+
+    virtual reactor_backend_t getBackend() const
+    {
+        return BACKEND_KQUEUE;
+    }
+
+    virtual u_result addHandle(int handle, rp::hal::IOReactorHandler * handler)
+    {
+        if (handle < 0 || !handler) return RESULT_INVALID_DATA;
+
+        rp::hal::AutoLocker l(_lock);
+        if (_entries.find(handle) != _entries.end()) return RESULT_ALREADY_DONE;
+
+        HandleEntry * entry = new HandleEntry();
+        entry->handler = handler;
+        entry->generation = ++_generation;
+        if (!entry->generation) entry->generation = ++_generation;
+        entry->busy = false;
+        entry->removed = false;
+
+        if (_arm(handle, entry)) {
+            delete entry;
+            return RESULT_OPERATION_FAIL;
+        }
+
+        _entries[handle] = entry;
+        return RESULT_OK;
+    }
+
+    virtual void removeHandle(int handle)
+    {
+        rp::hal::AutoLocker l(_lock);
+
+        std::map<int, HandleEntry*>::iterator itr = _entries.find(handle);
+        if (itr == _entries.end()) return;
+
+        HandleEntry * entry = itr->second;
+        entry->removed = true;
+
+        struct kevent evt;
+        EV_SET(&evt, handle, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+        kevent(_kqfd, &evt, 1, NULL, 0, NULL);
+
+        while (entry->busy) {
+            // the handler is running in one of the reactor threads, wait for it to finish
+            _lock.unlock();
+            _idleEvt.wait(10);
+            _lock.lock();
+        }
+
+        _entries.erase(handle);
+        delete entry;
+    }
+
+protected:
+
+    struct HandleEntry {
+        rp::hal::IOReactorHandler * handler;
+        _u32 generation;
+        bool busy;
+        bool removed;
+    };
+
+    int _arm(int handle, const HandleEntry * entry)
+    {
+        // EV_ADD on a watched handle updates it, EV_DISPATCH disables it again after the next event
+        struct kevent evt;
+        _u64 key = ((_u64)entry->generation << 32) | (_u32)handle;
+        EV_SET(&evt, handle, EVFILT_READ, EV_ADD | EV_ENABLE | EV_DISPATCH, 0, 0, (void *)(uintptr_t)key);
+        return kevent(_kqfd, &evt, 1, NULL, 0, NULL);
+    }
+
+    void _dispatch(_u64 key)
+    {
+        int handle = (int)(key & 0xFFFFFFFF);
+        _u32 generation = (_u32)(key >> 32);
+
+        HandleEntry * entry;
+        {
+            rp::hal::AutoLocker l(_lock);
+            std::map<int, HandleEntry*>::iterator itr = _entries.find(handle);
+            if (itr == _entries.end()) return;
+            entry = itr->second;
+
+            // stale event of a removed or re-registered handle
+            if (entry->generation != generation || entry->removed) return;
+            entry->busy = true;
+        }
+
+        bool keepWatching = entry->handler->onIOReadable();
+
+        rp::hal::AutoLocker l(_lock);
+        entry->busy = false;
+        if (entry->removed) {
+            _idleEvt.set();
+        } else if (keepWatching) {
+            _arm(handle, entry);
+        }
+    }
+
+    u_result _proc_reactorThread()
+    {
+        rp::hal::Thread::SetSelfConfig(_threadConfig.config, "sl_reactor", rp::hal::Thread::PRIORITY_HIGH);
+
+        struct kevent evts[MAX_EVENTS_PER_WAIT];
+        while (_isWorking)
+        {
+            int count = kevent(_kqfd, NULL, 0, evts, MAX_EVENTS_PER_WAIT, NULL);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+
+            for (int pos = 0; pos < count; ++pos)
+            {
+                if (evts[pos].filter != EVFILT_READ) continue; // wakeup
+                _dispatch((_u64)(uintptr_t)evts[pos].udata);
+            }
+        }
+        return RESULT_OK;
+    }
+
+    void _closeHandles()
+    {
+        if (_kqfd >= 0) {
+            ::close(_kqfd);
+            _kqfd = -1;
+        }
+    }
+
+    int _kqfd;
+    volatile bool _isWorking;
+    _u32 _generation;
+
+    rp::hal::Locker _lock;
+    rp::hal::Event  _idleEvt;
+    std::map<int, HandleEntry*> _entries;
+    std::vector<rp::hal::Thread> _threads;
+    ReactorThreadConfig _threadConfig;
+};
+
+}}
+
+namespace rp{ namespace hal{
+
+IOReactor * IOReactor::CreateReactor(int threadCount, reactor_backend_t backend, const Thread::config_t * threadConfig)
+{
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > MAX_THREAD_COUNT) threadCount = MAX_THREAD_COUNT;
+
+    if (backend != BACKEND_KQUEUE) return NULL;
+
+    rp::arch::KqueueReactor * reactor = new rp::arch::KqueueReactor();
+    if (!reactor->start(threadCount, threadConfig)) {
+        delete reactor;
+        return NULL;
+    }
+    return reactor;
+}
+
+void IOReactor::ReleaseReactor(IOReactor * reactor)
+{
+    delete reactor;
+}
+
+}}
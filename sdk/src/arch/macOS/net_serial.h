@@ -67,6 +67,8 @@ public:
     virtual void clearDTR();
 
     _u32 getTermBaudBitmap(_u32 baud);
+
+    virtual int getNativeHandle() { return isOpened() ? serial_fd : -1; }
 protected:
     bool open(const char * portname, uint32_t baudrate, uint32_t flags = 0);
     void _init();
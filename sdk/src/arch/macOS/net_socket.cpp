@@ -313,6 +313,60 @@ namespace rp { namespace arch { namespace net{
 
 using namespace rp::net;
 
+// wakes up the waits on a socket, it stays signalled until the socket is disposed
+class _wait_canceller
+{
+public:
+    _wait_canceller()
+    {
+        _pipe[0] = _pipe[1] = -1;
+        if (::pipe(_pipe) == -1) return;
+        for (int pos = 0; pos < 2; ++pos) {
+            int flags = fcntl(_pipe[pos], F_GETFL);
+            if (flags != -1) fcntl(_pipe[pos], F_SETFL, flags | O_NONBLOCK);
+        }
+    }
+
+    ~_wait_canceller()
+    {
+        if (_pipe[0] != -1) ::close(_pipe[0]);
+        if (_pipe[1] != -1) ::close(_pipe[1]);
+    }
+
+    void cancel()
+    {
+        if (_pipe[1] == -1) return;
+        ssize_t ans = ::write(_pipe[1], "x", 1);
+        (void)ans;
+    }
+
+    u_result waitforReadable(int socket_fd, _u32 timeout)
+    {
+        fd_set rdset;
+        FD_ZERO(&rdset);
+        FD_SET(socket_fd, &rdset);
+        if (_pipe[0] != -1) FD_SET(_pipe[0], &rdset);
+
+        timeval tv;
+        tv.tv_sec = timeout / 1000;
+        tv.tv_usec = (timeout % 1000) * 1000;
+        int ans = ::select(std::max<int>(socket_fd, _pipe[0]) + 1, &rdset, NULL, NULL, &tv);
+
+        if (ans < 0) {
+            delay(0); //relax cpu
+            return RESULT_OPERATION_FAIL;
+        }
+        if (ans == 0 || (_pipe[0] != -1 && FD_ISSET(_pipe[0], &rdset))) {
+            // timeout or canceled
+            return RESULT_OPERATION_TIMEOUT;
+        }
+        return RESULT_OK;
+    }
+
+private:
+    int _pipe[2];
+};
+
 class _single_thread StreamSocketImpl : public StreamSocket
 {
 public:
@@ -551,6 +605,20 @@ public:
         return ::setsockopt( _socket_fd, IPPROTO_TCP, TCP_NODELAY,&bool_true, sizeof(bool_true) )?RESULT_OPERATION_FAIL:RESULT_OK;
     }
 
+    virtual u_result setRxBufferSize(size_t size)
+    {
+        int bufSize = (int)size;
+        return ::setsockopt(_socket_fd, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize)) ? RESULT_OPERATION_FAIL : RESULT_OK;
+    }
+
+    virtual u_result getRxQueueSize(size_t & size)
+    {
+        int pending = 0;
+        if (::ioctl(_socket_fd, FIONREAD, &pending) == -1) return RESULT_OPERATION_FAIL;
+        size = (size_t)pending;
+        return RESULT_OK;
+    }
+
     virtual u_result waitforSent(_u32 timeout ) 
     {
         fd_set wrset;
@@ -577,30 +645,22 @@ public:
 
     virtual u_result waitforData(_u32 timeout )
     {
-        fd_set rdset;
-        FD_ZERO(&rdset);
-        FD_SET(_socket_fd, &rdset);
+        return _canceller.waitforReadable(_socket_fd, timeout);
+    }
 
-        timeval tv;
-        tv.tv_sec = timeout / 1000;
-        tv.tv_usec = (timeout % 1000) * 1000;
-        int ans = ::select(_socket_fd+1, &rdset, NULL, NULL, &tv);
+    virtual void cancelWaits()
+    {
+        _canceller.cancel();
+    }
 
-        switch (ans) {
-            case 1:
-                // fired
-                return RESULT_OK;
-            case 0:
-                // timeout
-                return RESULT_OPERATION_TIMEOUT;
-            default:
-                delay(0); //relax cpu
-                return RESULT_OPERATION_FAIL;
-        }
+    virtual int getNativeHandle()
+    {
+        return _socket_fd;
     }
 
 protected:
     int  _socket_fd;
+    _wait_canceller _canceller;
 
 
 };
@@ -703,26 +763,12 @@ public:
 
     virtual u_result waitforData(_u32 timeout )
     {
-        fd_set rdset;
-        FD_ZERO(&rdset);
-        FD_SET(_socket_fd, &rdset);
-
-        timeval tv;
-        tv.tv_sec = timeout / 1000;
-        tv.tv_usec = (timeout % 1000) * 1000;
-        int ans = ::select(_socket_fd+1, &rdset, NULL, NULL, &tv);
+        return _canceller.waitforReadable(_socket_fd, timeout);
+    }
 
-        switch (ans) {
-            case 1:
-                // fired
-                return RESULT_OK;
-            case 0:
-                // timeout
-                return RESULT_OPERATION_TIMEOUT;
-            default:
-                delay(0); //relax cpu
-                return RESULT_OPERATION_FAIL;
-        }
+    virtual void cancelWaits()
+    {
+        _canceller.cancel();
     }
 
     virtual u_result sendTo(const SocketAddress * target, const void * buffer, size_t len)
@@ -811,6 +857,77 @@ public:
 
     }
 
+    virtual u_result recvBatch(_u8 * slab, size_t slotSize, size_t * sizes, _u64 * timestamps_uS, size_t count, size_t & received, SocketAddress * sourceAddrs)
+    {
+        // no recvmmsg here, drain the queue one datagram at a time
+        received = 0;
+        while (received < count) {
+            struct sockaddr * addr = (sourceAddrs ? reinterpret_cast<struct sockaddr *>(const_cast<void *>(sourceAddrs[received].getPlatformData())) : NULL);
+            socklen_t addrSize = (sourceAddrs ? sizeof(sockaddr_storage) : 0);
+            ssize_t ans = ::recvfrom(_socket_fd, slab + received * slotSize, slotSize, MSG_DONTWAIT, addr, sourceAddrs ? &addrSize : NULL);
+            if (ans < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && !received) {
+                    return RESULT_OPERATION_FAIL;
+                }
+                break;
+            }
+            if (timestamps_uS) timestamps_uS[received] = 0;
+            sizes[received++] = (size_t)ans;
+        }
+        return received ? RESULT_OK : RESULT_OPERATION_TIMEOUT;
+    }
+
+    virtual u_result setRxBufferSize(size_t size)
+    {
+        int bufSize = (int)size;
+        return ::setsockopt(_socket_fd, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize)) ? RESULT_OPERATION_FAIL : RESULT_OK;
+    }
+
+    virtual u_result enableBroadcast(bool enable)
+    {
+        int flag = enable ? 1 : 0;
+        return ::setsockopt(_socket_fd, SOL_SOCKET, SO_BROADCAST, &flag, sizeof(flag)) ? RESULT_OPERATION_FAIL : RESULT_OK;
+    }
+
+    virtual u_result enableAddressReuse(bool enable)
+    {
+        int flag = enable ? 1 : 0;
+        if (::setsockopt(_socket_fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag))) return RESULT_OPERATION_FAIL;
+        // the BSD sockets only share a unicast or multicast port with SO_REUSEPORT
+        if (::setsockopt(_socket_fd, SOL_SOCKET, SO_REUSEPORT, &flag, sizeof(flag))) return RESULT_OPERATION_FAIL;
+        return RESULT_OK;
+    }
+
+    virtual u_result joinMulticastGroup(const SocketAddress & group, const SocketAddress * localInterface)
+    {
+        if (group.getAddressType() != SocketAddress::ADDRESS_TYPE_INET) return RESULT_OPERATION_NOT_SUPPORT;
+        if (localInterface && localInterface->getAddressType() != SocketAddress::ADDRESS_TYPE_INET) return RESULT_OPERATION_NOT_SUPPORT;
+
+        struct ip_mreq request;
+        request.imr_multiaddr = reinterpret_cast<const sockaddr_in *>(group.getPlatformData())->sin_addr;
+        if (localInterface) {
+            request.imr_interface = reinterpret_cast<const sockaddr_in *>(localInterface->getPlatformData())->sin_addr;
+        } else {
+            request.imr_interface.s_addr = htonl(INADDR_ANY);
+        }
+        return ::setsockopt(_socket_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) ? RESULT_OPERATION_FAIL : RESULT_OK;
+    }
+
+    virtual u_result setMulticastOptions(int ttl, bool loopback, const SocketAddress * localInterface)
+    {
+        unsigned char hops = (unsigned char)ttl;
+        unsigned char loop = loopback ? 1 : 0;
+        if (::setsockopt(_socket_fd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops))) return RESULT_OPERATION_FAIL;
+        if (::setsockopt(_socket_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop))) return RESULT_OPERATION_FAIL;
+
+        if (localInterface) {
+            if (localInterface->getAddressType() != SocketAddress::ADDRESS_TYPE_INET) return RESULT_OPERATION_NOT_SUPPORT;
+            struct in_addr iface = reinterpret_cast<const sockaddr_in *>(localInterface->getPlatformData())->sin_addr;
+            if (::setsockopt(_socket_fd, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface))) return RESULT_OPERATION_FAIL;
+        }
+        return RESULT_OK;
+    }
+
 #if 0
     virtual u_result recvFromNoWait(void *buf, size_t len, size_t & recv_len, SocketAddress * sourceAddr)
     {
@@ -837,8 +954,14 @@ public:
     }
 #endif
     
+    virtual int getNativeHandle()
+    {
+        return _socket_fd;
+    }
+
 protected:
     int  _socket_fd;
+    _wait_canceller _canceller;
 
 };
 
@@ -62,6 +62,44 @@ u_result Thread::SetSelfPriority( priority_val_t p)
 	return  RESULT_OK;
 }
 
+u_result Thread::SetSelfConfig(const config_t& config, const char* defaultName, priority_val_t defaultPriority)
+{
+    u_result ans = RESULT_OK;
+
+    const char* name = config.name ? config.name : defaultName;
+    if (name) {
+        if (pthread_setname_np(name)) ans = RESULT_OPERATION_FAIL;
+    }
+
+    // there is no way to pin a thread to a cpu here
+    if (config.cpuMask) ans = RESULT_OPERATION_NOT_SUPPORT;
+
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+
+    switch (config.policy) {
+    case SCHED_POLICY_DEFAULT:
+        if (IS_FAIL(SetSelfPriority(defaultPriority))) ans = RESULT_OPERATION_FAIL;
+        break;
+    case SCHED_POLICY_OTHER:
+        if (pthread_setschedparam(pthread_self(), SCHED_OTHER, &param)) ans = RESULT_OPERATION_FAIL;
+        break;
+    case SCHED_POLICY_FIFO:
+    case SCHED_POLICY_RR:
+        {
+            int policy = (config.policy == SCHED_POLICY_FIFO) ? SCHED_FIFO : SCHED_RR;
+            int minPriority = sched_get_priority_min(policy);
+            int maxPriority = sched_get_priority_max(policy);
+            param.sched_priority = config.priority < minPriority ? minPriority
+                : (config.priority > maxPriority ? maxPriority : config.priority);
+            if (pthread_setschedparam(pthread_self(), policy, &param)) ans = RESULT_OPERATION_FAIL;
+        }
+        break;
+    }
+
+    return ans;
+}
+
 Thread::priority_val_t Thread::getPriority()
 {
 	return PRIORITY_NORMAL;
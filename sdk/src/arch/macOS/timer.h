@@ -36,23 +36,23 @@
 
 #include "rptypes.h"
 
-#include <unistd.h>
-static inline void delay(_word_size_t ms){
-    while (ms>=1000){
-        usleep(1000*1000);
-        ms-=1000;
-    };
-    if (ms!=0)
-        usleep(ms*1000);
-}
-
-// TODO: the highest timer interface should be clock_gettime
 namespace rp{ namespace arch{
 
+// all the timestamps of the sdk are on CLOCK_MONOTONIC
 _u64 rp_getus();
 _u64 rp_getms();
 
+// sleeps for the given time, resuming after the signals
+void rp_delay_us(_u64 us);
+
+// describes the clock behind getus(), the offset is the one to add to get CLOCK_REALTIME
+void rp_getclockinfo(const char*& name, _u32& resolution_ns, _s64& realtime_offset_us);
+
 }}
 
+static inline void delay(_word_size_t ms){
+    rp::arch::rp_delay_us((_u64)ms * 1000);
+}
+
 #define getms() rp::arch::rp_getms()
 #define getus() rp::arch::rp_getus()
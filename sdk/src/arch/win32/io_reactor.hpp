@@ -0,0 +1,467 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+
+#include "sdkcommon.h"
+#include "hal/thread.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+
+#include <windows.h>
+#include <winsock2.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#pragma comment (lib, "Ws2_32.lib")
+
+namespace rp{ namespace arch{
+
+// the thread config given to CreateReactor, with its own copy of the name
+struct ReactorThreadConfig
+{
+    ReactorThreadConfig()
+    {
+        memset(&config, 0, sizeof(config));
+    }
+
+    void assign(const rp::hal::Thread::config_t * src)
+    {
+        if (!src) return;
+        config = *src;
+        if (src->name) {
+            name = src->name;
+            config.name = name.c_str();
+        }
+    }
+
+    rp::hal::Thread::config_t config;
+    std::string name;
+};
+
+// Keeps several overlapped reads outstanding on each handle and serves their completions
+// from a single completion port, the data is handed to onIOData() in the order it was read
+class IocpReactor : public rp::hal::IOReactor
+{
+public:
+    enum {
+        READS_PER_HANDLE = 4,
+        READ_BUFFER_SIZE = 4096,
+        // a serial read completes as soon as some bytes are there, or empty after this time
+        SERIAL_READ_TIMEOUT_MS = 500,
+    };
+
+    IocpReactor()
+        : _port(NULL)
+        , _isWorking(false)
+        , _nextKey(0)
+        , _cancelIoEx(NULL)
+    {
+    }
+
+    virtual ~IocpReactor()
+    {
+        stop();
+
+        for (std::map<int, HandleEntry*>::iterator itr = _entries.begin(); itr != _entries.end(); ++itr)
+        {
+            delete itr->second;
+        }
+        _entries.clear();
+        _keys.clear();
+    }
+
+    bool start(int threadCount, const rp::hal::Thread::config_t * threadConfig)
+    {
+        _threadConfig.assign(threadConfig);
+
+        // CancelIoEx is needed to stop the reads issued by the reactor threads, it comes with Vista
+        _cancelIoEx = (cancel_io_ex_t)GetProcAddress(GetModuleHandleA("kernel32.dll"), "CancelIoEx");
+        if (!_cancelIoEx) return false;
+
+        _port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, (DWORD)threadCount);
+        if (!_port) return false;
+
+        _isWorking = true;
+        for (int pos = 0; pos < threadCount; ++pos)
+        {
+            _threads.push_back(CLASS_THREAD(IocpReactor, _proc_reactorThread));
+        }
+        return true;
+    }
+
+    void stop()
+    {
+        if (_isWorking) {
+            _isWorking = false;
+
+            // one empty packet per thread, the key 0 is never given to a handle
+            for (size_t pos = 0; pos < _threads.size(); ++pos)
+            {
+                PostQueuedCompletionStatus(_port, 0, 0, NULL);
+            }
+
+            for (size_t pos = 0; pos < _threads.size(); ++pos)
+            {
+                _threads[pos].join();
+            }
+            _threads.clear();
+        }
+
+        if (_port) {
+            CloseHandle(_port);
+            _port = NULL;
+        }
+    }
+
+    virtual size_t getThreadCount() const
+    {
+        return _threads.size();
+    }
+
+    virtual reactor_backend_t getBackend() const
+    {
+        return BACKEND_IOCP;
+    }
+
+    virtual u_result addHandle(int handle, rp::hal::IOReactorHandler * handler)
+    {
+        if (handle < 0 || !handler) return RESULT_INVALID_DATA;
+
+        u_result ans = _addHandle(handle, handler);
+        if (ans == RESULT_OPERATION_FAIL) {
+            // some of the reads may have been queued, drop them with the entry
+            removeHandle(handle);
+        }
+        return ans;
+    }
+
+    virtual void removeHandle(int handle)
+    {
+        rp::hal::AutoLocker l(_lock);
+
+        std::map<int, HandleEntry*>::iterator itr = _entries.find(handle);
+        if (itr == _entries.end()) return;
+
+        HandleEntry * entry = itr->second;
+        entry->removed = true;
+        if (entry->outstanding) _cancelIoEx(_toHandle(handle), NULL);
+
+        while (entry->outstanding || entry->delivering) {
+            // the reads complete as aborted, or the handler is running in one of the reactor threads
+            _lock.unlock();
+            _idleEvt.wait(10);
+            _lock.lock();
+        }
+
+        _restoreCommTimeouts(entry);
+        _keys.erase(entry->key);
+        _entries.erase(handle);
+        delete entry;
+    }
+
+protected:
+
+    u_result _addHandle(int handle, rp::hal::IOReactorHandler * handler)
+    {
+        rp::hal::AutoLocker l(_lock);
+        if (_entries.find(handle) != _entries.end()) return RESULT_ALREADY_DONE;
+
+        HandleEntry * entry = new HandleEntry();
+        entry->handle = handle;
+        entry->handler = handler;
+        entry->key = ++_nextKey;
+        if (!entry->key) entry->key = ++_nextKey;
+
+        int sockType = 0;
+        int sockTypeLen = sizeof(sockType);
+        entry->isSocket = (getsockopt((SOCKET)handle, SOL_SOCKET, SO_TYPE, (char *)&sockType, &sockTypeLen) == 0);
+        entry->isStream = entry->isSocket ? (sockType == SOCK_STREAM) : false;
+
+        if (!entry->isSocket) {
+            // the reads must not wait for their buffer to be full
+            entry->hasCommTimeouts = (GetCommTimeouts(_toHandle(handle), &entry->savedCommTimeouts) != 0);
+            if (entry->hasCommTimeouts) {
+                COMMTIMEOUTS timeouts;
+                memset(&timeouts, 0, sizeof(timeouts));
+                timeouts.ReadIntervalTimeout = MAXDWORD;
+                timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+                timeouts.ReadTotalTimeoutConstant = SERIAL_READ_TIMEOUT_MS;
+                timeouts.WriteTotalTimeoutMultiplier = entry->savedCommTimeouts.WriteTotalTimeoutMultiplier;
+                timeouts.WriteTotalTimeoutConstant = entry->savedCommTimeouts.WriteTotalTimeoutConstant;
+                SetCommTimeouts(_toHandle(handle), &timeouts);
+            }
+        }
+
+        // a handle stays bound to the port until it is closed, the overlapped operations of its
+        // owner queue packets too, they are told apart from the reads by their OVERLAPPED
+        if (CreateIoCompletionPort(_toHandle(handle), _port, entry->key, 0) != _port) {
+            _restoreCommTimeouts(entry);
+            delete entry;
+            return RESULT_OPERATION_FAIL;
+        }
+
+        _entries[handle] = entry;
+        _keys[entry->key] = entry;
+
+        for (int pos = 0; pos < READS_PER_HANDLE; ++pos)
+        {
+            ReadOp & op = entry->ops[pos];
+            op.seq = pos;
+            if (!_post(entry, op)) {
+                // nothing was queued for the failing read and the following ones
+                entry->removed = true;
+                return RESULT_OPERATION_FAIL;
+            }
+        }
+        return RESULT_OK;
+    }
+
+    struct ReadOp {
+        OVERLAPPED ov;
+        _u64  seq;      // the order of the read on its handle
+        bool  done;
+        DWORD bytes;
+        DWORD error;
+        _u8   buffer[READ_BUFFER_SIZE];
+    };
+
+    struct HandleEntry {
+        HandleEntry()
+            : handle(-1)
+            , handler(NULL)
+            , key(0)
+            , isSocket(false)
+            , isStream(false)
+            , hasCommTimeouts(false)
+            , removed(false)
+            , delivering(false)
+            , outstanding(0)
+            , nextSeq(0)
+        {
+            memset(ops, 0, sizeof(ops));
+            memset(&savedCommTimeouts, 0, sizeof(savedCommTimeouts));
+        }
+
+        int handle;
+        rp::hal::IOReactorHandler * handler;
+        ULONG_PTR key;
+        bool isSocket;
+        bool isStream;
+        bool hasCommTimeouts;
+        bool removed;
+        bool delivering;        // a thread is handing the completed reads to the handler
+        int  outstanding;       // the reads issued and not yet handed over
+        _u64 nextSeq;           // the next read to hand over, it sits in ops[nextSeq % READS_PER_HANDLE]
+        COMMTIMEOUTS savedCommTimeouts;
+        ReadOp ops[READS_PER_HANDLE];
+    };
+
+    typedef BOOL (WINAPI * cancel_io_ex_t)(HANDLE, LPOVERLAPPED);
+
+    static HANDLE _toHandle(int handle)
+    {
+        // the kernel handles and sockets only use the low 32 bits, even on 64bit Windows
+        return (HANDLE)(intptr_t)handle;
+    }
+
+    void _restoreCommTimeouts(HandleEntry * entry)
+    {
+        if (entry->hasCommTimeouts) {
+            SetCommTimeouts(_toHandle(entry->handle), &entry->savedCommTimeouts);
+            entry->hasCommTimeouts = false;
+        }
+    }
+
+    // called with _lock held
+    bool _post(HandleEntry * entry, ReadOp & op)
+    {
+        memset(&op.ov, 0, sizeof(op.ov));
+        op.done = false;
+        op.bytes = 0;
+        op.error = 0;
+
+        if (entry->isSocket) {
+            WSABUF buf;
+            buf.len = READ_BUFFER_SIZE;
+            buf.buf = (char *)op.buffer;
+            DWORD flags = 0;
+            if (WSARecv((SOCKET)entry->handle, &buf, 1, NULL, &flags, &op.ov, NULL) == SOCKET_ERROR
+                && WSAGetLastError() != WSA_IO_PENDING) {
+                return false;
+            }
+        } else {
+            if (!ReadFile(_toHandle(entry->handle), op.buffer, READ_BUFFER_SIZE, NULL, &op.ov)
+                && GetLastError() != ERROR_IO_PENDING) {
+                return false;
+            }
+        }
+
+        // the completion is queued even when the read finishes at once
+        ++entry->outstanding;
+        return true;
+    }
+
+    void _onCompletion(ULONG_PTR key, OVERLAPPED * ov, DWORD bytes, DWORD error)
+    {
+        _u64 rxTimestamp_uS = getus();
+
+        rp::hal::AutoLocker l(_lock);
+
+        std::map<ULONG_PTR, HandleEntry*>::iterator itr = _keys.find(key);
+        if (itr == _keys.end()) return;
+        HandleEntry * entry = itr->second;
+
+        ReadOp * completed = NULL;
+        for (int pos = 0; pos < READS_PER_HANDLE; ++pos)
+        {
+            if (ov == &entry->ops[pos].ov) {
+                completed = &entry->ops[pos];
+                break;
+            }
+        }
+        // an overlapped write or wait of the owner of the handle
+        if (!completed) return;
+
+        completed->done = true;
+        completed->bytes = bytes;
+        completed->error = error;
+
+        // the reads of a handle may complete on several threads, a single one hands them over in order
+        if (entry->delivering) return;
+        entry->delivering = true;
+
+        for (;;) {
+            ReadOp & op = entry->ops[entry->nextSeq % READS_PER_HANDLE];
+            if (!op.done || op.seq != entry->nextSeq) break;
+            op.done = false;
+
+            bool keepWatching = false;
+            if (!entry->removed && op.error != ERROR_OPERATION_ABORTED) {
+                l.forceUnlock();
+                if (op.error || (op.bytes == 0 && entry->isStream)) {
+                    // the handler reads the error or the end of the stream itself
+                    keepWatching = entry->handler->onIOReadable();
+                } else if (op.bytes == 0) {
+                    keepWatching = true; // serial read timeout
+                } else {
+                    keepWatching = entry->handler->onIOData(op.buffer, op.bytes, rxTimestamp_uS);
+                }
+                _lock.lock();
+            }
+
+            --entry->outstanding;
+            ++entry->nextSeq;
+
+            if (keepWatching && !entry->removed) {
+                op.seq = entry->nextSeq + READS_PER_HANDLE - 1;
+                if (!_post(entry, op)) {
+                    // reading again has failed, let the handler meet the error
+                    l.forceUnlock();
+                    entry->handler->onIOReadable();
+                    _lock.lock();
+                    keepWatching = false;
+                }
+            }
+
+            if (!keepWatching && !entry->removed) {
+                // stop watching, the other reads complete as aborted
+                entry->removed = true;
+                if (entry->outstanding) _cancelIoEx(_toHandle(entry->handle), NULL);
+            }
+        }
+
+        entry->delivering = false;
+        if (entry->removed) _idleEvt.set();
+    }
+
+    u_result _proc_reactorThread()
+    {
+        rp::hal::Thread::SetSelfConfig(_threadConfig.config, "sl_iocp", rp::hal::Thread::PRIORITY_HIGH);
+
+        while (_isWorking)
+        {
+            DWORD bytes = 0;
+            ULONG_PTR key = 0;
+            OVERLAPPED * ov = NULL;
+            DWORD error = 0;
+            if (!GetQueuedCompletionStatus(_port, &bytes, &key, &ov, INFINITE)) {
+                // a failed read still dequeues its packet, no packet means the port itself failed
+                if (!ov) break;
+                error = GetLastError();
+            }
+
+            if (!ov) continue; // wakeup
+            _onCompletion(key, ov, bytes, error);
+        }
+        return RESULT_OK;
+    }
+
+    HANDLE _port;
+    volatile bool _isWorking;
+    ULONG_PTR _nextKey;
+    cancel_io_ex_t _cancelIoEx;
+
+    rp::hal::Locker _lock;
+    rp::hal::Event  _idleEvt;
+    std::map<int, HandleEntry*> _entries;
+    std::map<ULONG_PTR, HandleEntry*> _keys;
+    std::vector<rp::hal::Thread> _threads;
+    ReactorThreadConfig _threadConfig;
+};
+
+}}
+
+namespace rp{ namespace hal{
+
+IOReactor * IOReactor::CreateReactor(int threadCount, reactor_backend_t backend, const Thread::config_t * threadConfig)
+{
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > MAX_THREAD_COUNT) threadCount = MAX_THREAD_COUNT;
+
+    if (backend != BACKEND_IOCP) return NULL;
+
+    rp::arch::IocpReactor * reactor = new rp::arch::IocpReactor();
+    if (!reactor->start(threadCount, threadConfig)) {
+        delete reactor;
+        return NULL;
+    }
+    return reactor;
+}
+
+void IOReactor::ReleaseReactor(IOReactor * reactor)
+{
+    delete reactor;
+}
+
+}}
@@ -68,6 +68,9 @@ public:
     virtual void setDTR();
     virtual void clearDTR();
 
+    // the port is opened for overlapped I/O, the kernel handles only use the low 32 bits
+    virtual int getNativeHandle() { return isOpened() ? (int)(intptr_t)_serial_handle : -1; }
+
 protected:
     bool open(const char * portname, _u32 baudrate, _u32 flags);
     void _init();
@@ -630,6 +630,20 @@ public:
         return ::setsockopt( _socket_fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&bool_true, (int)sizeof(bool_true) )?RESULT_OPERATION_FAIL:RESULT_OK;
     }
 
+    virtual u_result setRxBufferSize(size_t size)
+    {
+        int bufSize = (int)size;
+        return ::setsockopt(_socket_fd, SOL_SOCKET, SO_RCVBUF, (const char *)&bufSize, (int)sizeof(bufSize)) ? RESULT_OPERATION_FAIL : RESULT_OK;
+    }
+
+    virtual u_result getRxQueueSize(size_t & size)
+    {
+        u_long pending = 0;
+        if (SOCKET_ERROR == ioctlsocket(_socket_fd, (long)FIONREAD, &pending)) return RESULT_OPERATION_FAIL;
+        size = (size_t)pending;
+        return RESULT_OK;
+    }
+
     virtual u_result waitforSent(_u32 timeout ) 
     {
         fd_set wrset;
@@ -678,6 +692,12 @@ public:
         }
     }
 
+    virtual int getNativeHandle()
+    {
+        // the socket handles only use the low 32 bits, even on 64bit Windows
+        return (_socket_fd == INVALID_SOCKET) ? -1 : (int)_socket_fd;
+    }
+
 protected:
 
     SOCKET  _socket_fd;
@@ -838,6 +858,54 @@ public:
 
     }
 
+    virtual u_result setRxBufferSize(size_t size)
+    {
+        int bufSize = (int)size;
+        return ::setsockopt(_socket_fd, SOL_SOCKET, SO_RCVBUF, (const char *)&bufSize, (int)sizeof(bufSize)) ? RESULT_OPERATION_FAIL : RESULT_OK;
+    }
+
+    virtual u_result enableBroadcast(bool enable)
+    {
+        BOOL flag = enable ? TRUE : FALSE;
+        return ::setsockopt(_socket_fd, SOL_SOCKET, SO_BROADCAST, (const char *)&flag, (int)sizeof(flag)) ? RESULT_OPERATION_FAIL : RESULT_OK;
+    }
+
+    virtual u_result enableAddressReuse(bool enable)
+    {
+        BOOL flag = enable ? TRUE : FALSE;
+        return ::setsockopt(_socket_fd, SOL_SOCKET, SO_REUSEADDR, (const char *)&flag, (int)sizeof(flag)) ? RESULT_OPERATION_FAIL : RESULT_OK;
+    }
+
+    virtual u_result joinMulticastGroup(const SocketAddress & group, const SocketAddress * localInterface)
+    {
+        if (group.getAddressType() != SocketAddress::ADDRESS_TYPE_INET) return RESULT_OPERATION_NOT_SUPPORT;
+        if (localInterface && localInterface->getAddressType() != SocketAddress::ADDRESS_TYPE_INET) return RESULT_OPERATION_NOT_SUPPORT;
+
+        struct ip_mreq request;
+        request.imr_multiaddr = reinterpret_cast<const sockaddr_in *>(group.getPlatformData())->sin_addr;
+        if (localInterface) {
+            request.imr_interface = reinterpret_cast<const sockaddr_in *>(localInterface->getPlatformData())->sin_addr;
+        } else {
+            request.imr_interface.s_addr = htonl(INADDR_ANY);
+        }
+        return ::setsockopt(_socket_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char *)&request, (int)sizeof(request)) ? RESULT_OPERATION_FAIL : RESULT_OK;
+    }
+
+    virtual u_result setMulticastOptions(int ttl, bool loopback, const SocketAddress * localInterface)
+    {
+        DWORD hops = (DWORD)ttl;
+        DWORD loop = loopback ? 1 : 0;
+        if (::setsockopt(_socket_fd, IPPROTO_IP, IP_MULTICAST_TTL, (const char *)&hops, (int)sizeof(hops))) return RESULT_OPERATION_FAIL;
+        if (::setsockopt(_socket_fd, IPPROTO_IP, IP_MULTICAST_LOOP, (const char *)&loop, (int)sizeof(loop))) return RESULT_OPERATION_FAIL;
+
+        if (localInterface) {
+            if (localInterface->getAddressType() != SocketAddress::ADDRESS_TYPE_INET) return RESULT_OPERATION_NOT_SUPPORT;
+            struct in_addr iface = reinterpret_cast<const sockaddr_in *>(localInterface->getPlatformData())->sin_addr;
+            if (::setsockopt(_socket_fd, IPPROTO_IP, IP_MULTICAST_IF, (const char *)&iface, (int)sizeof(iface))) return RESULT_OPERATION_FAIL;
+        }
+        return RESULT_OK;
+    }
+
     virtual u_result clearRxCache()
     {
         timeval tv;
@@ -882,7 +950,11 @@ public:
     }
 
 
-    
+    virtual int getNativeHandle()
+    {
+        return (_socket_fd == INVALID_SOCKET) ? -1 : (int)_socket_fd;
+    }
+
 protected:
     SOCKET  _socket_fd;
 
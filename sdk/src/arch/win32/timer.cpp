@@ -64,6 +64,30 @@ _u64 getHDTimer()
     return (_u64)(current.QuadPart/_current_freq.QuadPart);
 }
 
+void rp_getclockinfo(const char*& name, _u32& resolution_ns, _s64& realtime_offset_us)
+{
+    name = "QueryPerformanceCounter";
+    resolution_ns = (_u32)(1000000ULL / _current_freq.QuadPart);
+    if (!resolution_ns) resolution_ns = 1;
+
+    // take the system time sample bracketed the most tightly by the counter ones
+    _u64 bestGap = (_u64)-1;
+    realtime_offset_us = 0;
+    for (int i = 0; i < 5; ++i) {
+        FILETIME ft;
+        _u64 before = getHDTimer_us();
+        GetSystemTimeAsFileTime(&ft);
+        _u64 after = getHDTimer_us();
+
+        if (after - before < bestGap) {
+            bestGap = after - before;
+            // FILETIME counts 100ns since 1601
+            _u64 real = ((((_u64)ft.dwHighDateTime) << 32) | ft.dwLowDateTime) / 10ULL - 11644473600000000ULL;
+            realtime_offset_us = (_s64)real - (_s64)(before + (after - before) / 2);
+        }
+    }
+}
+
 BEGIN_STATIC_CODE(timer_cailb)
 {
     HPtimer_reset();
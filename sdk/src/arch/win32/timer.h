@@ -43,6 +43,9 @@ namespace rp{ namespace arch{
     _u64 getHDTimer();
     _u64 getHDTimer_us();
 
+    // describes the clock behind getus(), the offset is the one to add to get the UTC time since 1970
+    void rp_getclockinfo(const char*& name, _u32& resolution_ns, _s64& realtime_offset_us);
+
 }}
 
 #define getms()   rp::arch::getHDTimer()
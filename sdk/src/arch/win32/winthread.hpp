@@ -92,6 +92,34 @@ u_result Thread::SetSelfPriority( priority_val_t p)
 	return RESULT_OPERATION_FAIL;
 }
 
+u_result Thread::SetSelfConfig(const config_t& config, const char* defaultName, priority_val_t defaultPriority)
+{
+    u_result ans = RESULT_OK;
+    HANDLE selfHandle = GetCurrentThread();
+
+    // the thread names need SetThreadDescription of Windows 10, the names are not applied
+
+    if (config.cpuMask) {
+        if (!SetThreadAffinityMask(selfHandle, (DWORD_PTR)config.cpuMask)) ans = RESULT_OPERATION_FAIL;
+    }
+
+    priority_val_t priority = defaultPriority;
+    switch (config.policy) {
+    case SCHED_POLICY_DEFAULT:
+        break;
+    case SCHED_POLICY_OTHER:
+        priority = (config.priority > 0) ? PRIORITY_LOW : PRIORITY_NORMAL;
+        break;
+    case SCHED_POLICY_FIFO:
+    case SCHED_POLICY_RR:
+        priority = PRIORITY_REALTIME;
+        break;
+    }
+    if (IS_FAIL(SetSelfPriority(priority))) ans = RESULT_OPERATION_FAIL;
+
+    return ans;
+}
+
 Thread::priority_val_t Thread::getPriority()
 {
 	if (!this->_handle) return PRIORITY_NORMAL;
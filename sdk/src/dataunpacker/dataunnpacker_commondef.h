@@ -50,11 +50,12 @@
 #include "hal/byteorder.h"
 #include "sl_lidar_driver.h"
 #include "sl_crc.h" 
+#include "sl_allocator.h"
 #include <algorithm>
 #include <memory>
-
-#define CONF_NO_BOOST_CRC_SUPPORT
+#include <atomic>
 
 #include "dataupacker_namespace.h"
+#include "dataunpacker_config.h"
 
 
@@ -38,6 +38,8 @@
 
 #pragma once
 
+#include "dataunpacker_clock.h"
+
 BEGIN_DATAUNPACKER_NS()
 
 
@@ -47,21 +49,111 @@ public:
 	LIDARSampleDataUnpackerInner(LIDARSampleDataListener& l): LIDARSampleDataUnpacker(l){}
 
 	virtual void publishHQNode(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node) = 0;
+	virtual void publishHQNodes(const rplidar_response_measurement_node_hq_t* nodes, const _u64* timestamps_uS, size_t count) = 0;
 	virtual void publishDecodingErrorMsg(int errorType, _u8 ansType, const void* payload, size_t size) = 0;
 	virtual void publishCustomData(_u8 ansType, _u32 customCode, const void* payload, size_t size) = 0;
 	virtual void publishNewScanReset() = 0;
+	// a validated sample packet kept undecoded, see UNPACKER_CONTEXT_TYPE_DEFERRED_DECODING
+	virtual void publishDeferredPacket(_u8 ansType, const void* packet, size_t size, bool revolutionStart) = 0;
 
 
 	virtual _u64 getCurrentTimestamp_uS() = 0;
 
 };
 
+// the decoding counters of a handler
+// only the decoder thread updates them, so a relaxed load and store is enough and any thread can read them
+class DataUnpackerHandlerCounters
+{
+public:
+	DataUnpackerHandlerCounters()
+		: packets(0), checksum_errors(0), encoder_resets(0)
+		, resyncs(0), skipped_bytes(0), capsule_discards(0), region_skips(0)
+	{
+	}
+
+	static void add(std::atomic<_u64>& counter, _u64 delta = 1)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+	}
+
+	void fill(_u8 ansType, LidarSampleDecodeStats& stats) const
+	{
+		stats.ans_type = ansType;
+		stats.packets = packets.load(std::memory_order_relaxed);
+		stats.checksum_errors = checksum_errors.load(std::memory_order_relaxed);
+		stats.encoder_resets = encoder_resets.load(std::memory_order_relaxed);
+		stats.resyncs = resyncs.load(std::memory_order_relaxed);
+		stats.skipped_bytes = skipped_bytes.load(std::memory_order_relaxed);
+		stats.capsule_discards = capsule_discards.load(std::memory_order_relaxed);
+		stats.region_skips = region_skips.load(std::memory_order_relaxed);
+	}
+
+	std::atomic<_u64> packets;
+	std::atomic<_u64> checksum_errors;
+	std::atomic<_u64> encoder_resets;
+	std::atomic<_u64> resyncs;
+	std::atomic<_u64> skipped_bytes;
+	std::atomic<_u64> capsule_discards;
+	std::atomic<_u64> region_skips;
+};
+
+// the sector the samples are decoded in, set by UNPACKER_CONTEXT_TYPE_SCAN_REGION
+// the angles are in q8 degree like the start angles of the capsules
+class ScanRegionMask
+{
+public:
+	enum {
+		FULL_CIRCLE_Q8 = 360 << 8,
+		// the samples are offset from the start angles of their capsule by up to about 8 degree
+		CAPSULE_MARGIN_Q8 = 10 << 8,
+	};
+
+	ScanRegionMask() : _start_q8(0), _span_q8(FULL_CIRCLE_Q8) {}
+
+	void set(const LidarScanRegion& region)
+	{
+		float start = fmodf(region.start_deg, 360.f);
+		if (start < 0) start += 360.f;
+		_start_q8 = (int)(start * 256.f) % FULL_CIRCLE_Q8;
+		_span_q8 = (region.span_deg >= 360.f) ? (int)FULL_CIRCLE_Q8 : (int)(std::max(region.span_deg, 0.f) * 256.f);
+	}
+
+	// the samples from startAngle_q8 to endAngle_q8, the ones crossing 0 degree always overlap as they carry the sync
+	bool overlaps(int startAngle_q8, int endAngle_q8) const
+	{
+		if (_span_q8 >= FULL_CIRCLE_Q8 || endAngle_q8 < startAngle_q8) return true;
+
+		// relative to the start of the region, so it spans from 0 to _span_q8
+		int from_q8 = startAngle_q8 - CAPSULE_MARGIN_Q8 - _start_q8;
+		from_q8 = ((from_q8 % FULL_CIRCLE_Q8) + FULL_CIRCLE_Q8) % FULL_CIRCLE_Q8;
+		int length_q8 = endAngle_q8 - startAngle_q8 + 2 * CAPSULE_MARGIN_Q8;
+		return from_q8 <= _span_q8 || from_q8 + length_q8 >= FULL_CIRCLE_Q8;
+	}
+
+protected:
+	int _start_q8;
+	int _span_q8;
+};
+
 class IDataUnpackerHandler
 {
 public:
-	IDataUnpackerHandler() {}
+	IDataUnpackerHandler() : _deferred(false), _deferred_last_angle_q8(0) {}
 	virtual ~IDataUnpackerHandler() {}
 
+	const DataUnpackerHandlerCounters& getCounters() const { return _counters; }
+
+	// the validated packets are published undecoded instead of the nodes
+	void setDeferred(bool deferred)
+	{
+		_deferred = deferred;
+		_deferred_last_angle_q8 = 0;
+	}
+
+	// the mapping of the device timestamps, false if the answer type carries none
+	virtual bool getDeviceClockStats(LidarDeviceClockStats& stats) const { return false; }
+
 
 	virtual void onUnpackerContextSet(LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size) = 0;
 
@@ -69,6 +161,18 @@ public:
 	virtual void onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t size) = 0;
 	virtual void reset() = 0;
 
+protected:
+	// the start angles of the capsules wrap by about a full circle once per revolution
+	bool _isDeferredRevolutionStart(int startAngle_q8)
+	{
+		bool wrapped = (_deferred_last_angle_q8 - startAngle_q8) > (180 << 8);
+		_deferred_last_angle_q8 = startAngle_q8;
+		return wrapped;
+	}
+
+	DataUnpackerHandlerCounters _counters;
+	bool _deferred;
+	int _deferred_last_angle_q8;
 };
 
 END_DATAUNPACKER_NS()
\ No newline at end of file
@@ -41,7 +41,8 @@
 #include "dataunnpacker_internal.h"
 
 
-#include <map>
+#include <vector>
+#include <algorithm>
 
 
 #define REGISTER_HANDLER(_c_) {     \
@@ -53,6 +54,7 @@
 // How to include new handlers?
 // 1. add extra include line below if a new handle is to be included
 // 2. update the code in function _registerDataUnpackerHandlers
+// 3. add the switch of its format in dataunpacker_config.h
 #include "unpacker/handler_capsules.h"
 #include "unpacker/handler_hqnode.h"
 #include "unpacker/handler_normalnode.h"
@@ -66,15 +68,45 @@ BEGIN_DATAUNPACKER_NS()
 
 static bool _registerDataUnpackerHandlers(std::vector<IDataUnpackerHandler *> & handlerList)
 {
+	// only the formats selected by dataunpacker_config.h
+#if SL_LIDAR_UNPACKER_WITH_NORMALNODE
 	REGISTER_HANDLER(UnpackerHandler_NormalNode);
+#endif
+#if SL_LIDAR_UNPACKER_WITH_HQNODE
 	REGISTER_HANDLER(UnpackerHandler_HQNode);
+#endif
+#if SL_LIDAR_UNPACKER_WITH_CAPSULE
 	REGISTER_HANDLER(UnpackerHandler_CapsuleNode);
+#endif
+#if SL_LIDAR_UNPACKER_WITH_ULTRA_CAPSULE
 	REGISTER_HANDLER(UnpackerHandler_UltraCapsuleNode);
+#endif
+#if SL_LIDAR_UNPACKER_WITH_DENSE_CAPSULE
 	REGISTER_HANDLER(UnpackerHandler_DenseCapsuleNode);
+#endif
+#if SL_LIDAR_UNPACKER_WITH_ULTRA_DENSE_CAPSULE
 	REGISTER_HANDLER(UnpackerHandler_UltraDenseCapsuleNode);
+#endif
 	return true;
 }
 
+// a new instance of the built in handler of ansType, NULL if there is none
+static IDataUnpackerHandler* _createBuiltinHandler(_u8 ansType)
+{
+	std::vector<IDataUnpackerHandler *> list;
+	IDataUnpackerHandler* found = nullptr;
+	_registerDataUnpackerHandlers(list);
+	for (auto itr = list.begin(); itr != list.end(); ++itr) {
+		if (!found && (*itr)->getSampleAnswerType() == ansType) {
+			found = *itr;
+		}
+		else {
+			delete* itr;
+		}
+	}
+	return found;
+}
+
 
 class LIDARSampleDataUnpackerImpl : public LIDARSampleDataUnpackerInner
 {
@@ -82,17 +114,32 @@ public:
 
 	void registerHandler(_u8 ansType, IDataUnpackerHandler* handler)
 	{
-		_handlerMap[ansType] = handler;
+		if (_handlerTable[ansType]) {
+			// replace the existing one
+			_handlerList.erase(std::find(_handlerList.begin(), _handlerList.end(), _handlerTable[ansType]));
+			delete _handlerTable[ansType];
+		}
+		_handlerTable[ansType] = handler;
+		_handlerList.push_back(handler);
 	}
 
 
+	void unregisterHandler(_u8 ansType)
+	{
+		if (!_handlerTable[ansType]) return;
+		_handlerList.erase(std::find(_handlerList.begin(), _handlerList.end(), _handlerTable[ansType]));
+		delete _handlerTable[ansType];
+		_handlerTable[ansType] = nullptr;
+	}
+
 	void unregisterAllHandlers()
 	{
-		for (auto itr = _handlerMap.begin(); itr != _handlerMap.end(); ++itr)
+		for (auto itr = _handlerList.begin(); itr != _handlerList.end(); ++itr)
 		{
-			delete itr->second;
+			delete *itr;
 		}
-		_handlerMap.clear();
+		_handlerList.clear();
+		memset(_handlerTable, 0, sizeof(_handlerTable));
 	}
 
 	LIDARSampleDataUnpackerImpl(LIDARSampleDataListener& l)
@@ -100,8 +147,9 @@ public:
 		, _enabled(false)
 		, _lastActiveAnsType(0)
 		, _lastActiveHandler(nullptr)
+		, _rxTimestamp_uS(0)
 	{
-
+		memset(_handlerTable, 0, sizeof(_handlerTable));
 	}
 
 	virtual ~LIDARSampleDataUnpackerImpl()
@@ -114,36 +162,33 @@ public:
 	{
 	
 		// notify the handlers ...
-		for (auto itr = _handlerMap.begin(); itr != _handlerMap.end(); ++itr)
+		for (auto itr = _handlerList.begin(); itr != _handlerList.end(); ++itr)
 		{
-			itr->second->onUnpackerContextSet(type, data, size);
+			if (type == UNPACKER_CONTEXT_TYPE_DEFERRED_DECODING) {
+				(*itr)->setDeferred(*reinterpret_cast<const bool*>(data));
+				continue;
+			}
+			(*itr)->onUnpackerContextSet(type, data, size);
 		}
 	}
 
-	virtual bool onSampleData(_u8 ansType, const void* buffer, size_t size) {
+	virtual bool onSampleData(_u8 ansType, const void* buffer, size_t size, _u64 rxTimestamp_uS = 0) {
 		if (!_enabled) return false;
+		_rxTimestamp_uS = rxTimestamp_uS;
 
 
-		if (_lastActiveAnsType != ansType) {
-			onDeselectHandler();
+		IDataUnpackerHandler* handler = _handlerTable[ansType];
 
-			auto itr = _handlerMap.find(ansType);
-			if (itr != _handlerMap.end()) {
-				onSelectHandler(ansType, itr->second);
-			}
-			else {
-				onSelectHandler(ansType, nullptr);
-			}
-			
-		}
+		// not a sample packet (e.g. a command response), keep the state of the active handler
+		if (!handler) return false;
 
-		if (_lastActiveHandler) {
-			_lastActiveHandler->onData(this, reinterpret_cast<const _u8 *>(buffer), size);
-			return true;
-		}
-		else {
-			return false;
+		if (handler != _lastActiveHandler) {
+			onDeselectHandler();
+			onSelectHandler(ansType, handler);
 		}
+
+		handler->onData(this, reinterpret_cast<const _u8 *>(buffer), size);
+		return true;
 	}
 
 	virtual void reset()
@@ -174,8 +219,44 @@ public:
 		}
 	}
 
+	virtual size_t getDecodeStats(LidarSampleDecodeStats* stats, size_t maxCount) const
+	{
+		size_t count = 0;
+		for (auto itr = _handlerList.begin(); itr != _handlerList.end() && count < maxCount; ++itr)
+		{
+			(*itr)->getCounters().fill((*itr)->getSampleAnswerType(), stats[count++]);
+		}
+		return count;
+	}
+
+	virtual bool getDeviceClockStats(LidarDeviceClockStats& stats) const
+	{
+		// only the handler of the answer type being streamed has fitted any packet
+		for (auto itr = _handlerList.begin(); itr != _handlerList.end(); ++itr)
+		{
+			if ((*itr)->getDeviceClockStats(stats) && stats.packets) return true;
+		}
+		return false;
+	}
+
+	virtual bool setHandler(_u8 ansType, IDataUnpackerHandler* handler)
+	{
+		// the active handler may be the one replaced
+		reset();
+
+		if (!handler) handler = _createBuiltinHandler(ansType);
+		if (handler) {
+			registerHandler(ansType, handler);
+		}
+		else {
+			unregisterHandler(ansType);
+		}
+		return true;
+	}
+
 	virtual _u64 getCurrentTimestamp_uS() {
-		return getus();
+		// the capture time reported by the channel spares the queueing and scheduling delays
+		return _rxTimestamp_uS ? _rxTimestamp_uS : getus();
 	}
 
 	virtual void publishHQNode(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node)
@@ -183,6 +264,13 @@ public:
 		_listener.onHQNodeDecoded(timestamp_uS, node);
 	}
 
+	virtual void publishHQNodes(const rplidar_response_measurement_node_hq_t* nodes, const _u64* timestamps_uS, size_t count)
+	{
+		if (count) {
+			_listener.onHQNodesDecoded(nodes, timestamps_uS, count);
+		}
+	}
+
 
 	virtual void publishDecodingErrorMsg(int errorType, _u8 ansType, const void* payload, size_t size)
 	{
@@ -192,7 +280,7 @@ public:
 
 	virtual void publishCustomData(_u8 ansType, _u32 customCode, const void* payload, size_t size)
 	{
-		_listener.onCustomSampleDataDecoded(ansType, customCode, payload, size);
+		_listener.onCustomSampleDataDecoded(ansType, customCode, getCurrentTimestamp_uS(), payload, size);
 	}
 
 
@@ -200,6 +288,11 @@ public:
 	{
 		_listener.onHQNodeScanResetReq();
 	}
+
+	virtual void publishDeferredPacket(_u8 ansType, const void* packet, size_t size, bool revolutionStart)
+	{
+		_listener.onSamplePacketDeferred(ansType, getCurrentTimestamp_uS(), packet, size, revolutionStart);
+	}
 protected:
 
 	void onSelectHandler(_u8 ansType, IDataUnpackerHandler* handler)
@@ -216,10 +309,12 @@ protected:
 
 protected:
 	bool _enabled;
-	std::map<_u8, IDataUnpackerHandler*> _handlerMap;
+	IDataUnpackerHandler* _handlerTable[256];
+	std::vector<IDataUnpackerHandler*> _handlerList;
 
 	_u8 _lastActiveAnsType;
 	IDataUnpackerHandler* _lastActiveHandler;
+	_u64 _rxTimestamp_uS; // of the sample packet being decoded
 };
 
 LIDARSampleDataUnpacker* LIDARSampleDataUnpacker::CreateInstance(LIDARSampleDataListener& listener)
@@ -232,7 +327,7 @@ LIDARSampleDataUnpacker* LIDARSampleDataUnpacker::CreateInstance(LIDARSampleData
 		for (auto itr = list.begin(); itr != list.end(); ++itr) {
 			delete* itr;
 		}
-		impl = nullptr;
+		return nullptr;
 	}
 
 	for (auto itr = list.begin(); itr != list.end(); ++itr) {
@@ -43,6 +43,7 @@
 
 BEGIN_DATAUNPACKER_NS()
 
+class IDataUnpackerHandler;
 
 class LIDARSampleDataListener
 {
@@ -51,9 +52,21 @@ class LIDARSampleDataListener
 public:
 	virtual void onHQNodeScanResetReq() = 0;
 	virtual void onHQNodeDecoded(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node) = 0;
-	virtual void onCustomSampleDataDecoded(_u8 ansType, _u32 customCode, const void* data, size_t size) {}
+
+	// all the nodes decoded from one sample packet, override it to handle the nodes in a batch
+	virtual void onHQNodesDecoded(const rplidar_response_measurement_node_hq_t* nodes, const _u64* timestamps_uS, size_t count)
+	{
+		for (size_t pos = 0; pos < count; ++pos) {
+			onHQNodeDecoded(timestamps_uS[pos], nodes + pos);
+		}
+	}
+	// the payload published by a custom handler, timestamp_uS is the capture time of its packet
+	virtual void onCustomSampleDataDecoded(_u8 ansType, _u32 customCode, _u64 timestamp_uS, const void* data, size_t size) {}
 
 	virtual void onDecodingError(int errMsg, _u8 ansType, const void* payload, size_t size) {}
+
+	// a validated sample packet in the wire order when the decoding is deferred, revolutionStart is set on the packet starting a revolution
+	virtual void onSamplePacketDeferred(_u8 ansType, _u64 timestamp_uS, const void* packet, size_t size, bool revolutionStart) {}
 };
 
 class LIDARSampleDataUnpacker
@@ -68,6 +81,8 @@ public:
 		UNPACKER_CONTEXT_TYPE_LIDAR_UNKNOWN = 0,
 		UNPACKER_CONTEXT_TYPE_LIDAR_TIMING = 1,
 		UNPACKER_CONTEXT_TYPE_TRIANGULATION_OPTICAL_FACTOR = 2,
+		UNPACKER_CONTEXT_TYPE_SCAN_REGION = 3,	// LidarScanRegion
+		UNPACKER_CONTEXT_TYPE_DEFERRED_DECODING = 4,	// bool, publishes the validated packets instead of the nodes
 
 	};
 
@@ -80,10 +95,23 @@ public:
 	virtual void enable() = 0;
 	virtual void disable() = 0;
 
-	virtual bool onSampleData(_u8 ansType, const void* buffer, size_t size) = 0;
+	// the buffer is only borrowed during the call, it will NOT be retained after the call returns
+	// returns false if the ansType is not a sample data type
+	// rxTimestamp_uS is the capture time of the data, the sample timestamps are based on the decoding time if it is 0
+	virtual bool onSampleData(_u8 ansType, const void* buffer, size_t size, _u64 rxTimestamp_uS = 0) = 0;
 	virtual void reset() = 0;
 	virtual void clearCache() = 0;
 
+	// fills the decoding counters of each handler, returns the count filled
+	virtual size_t getDecodeStats(LidarSampleDecodeStats* stats, size_t maxCount) const = 0;
+
+	// the device clock mapping of the handler that decoded the latest device timestamps, false if none has
+	virtual bool getDeviceClockStats(LidarDeviceClockStats& stats) const = 0;
+
+	// replaces the handler of ansType and takes the ownership of it, NULL to restore the built in one
+	// not to be called while the sample data is decoded, returns false if the handlers are bound at compile time
+	virtual bool setHandler(_u8 ansType, IDataUnpackerHandler* handler) = 0;
+
 protected:
 	LIDARSampleDataUnpacker(LIDARSampleDataListener&);
 	LIDARSampleDataListener& _listener;
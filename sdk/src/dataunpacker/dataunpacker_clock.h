@@ -0,0 +1,189 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+
+ /*
+  *  Sample Data Unpacker System
+  *  Device Clock Estimation
+  */
+
+  /*
+	* Redistribution and use in source and binary forms, with or without
+	* modification, are permitted provided that the following conditions are met:
+	*
+	* 1. Redistributions of source code must retain the above copyright notice,
+	*    this list of conditions and the following disclaimer.
+	*
+	* 2. Redistributions in binary form must reproduce the above copyright notice,
+	*    this list of conditions and the following disclaimer in the documentation
+	*    and/or other materials provided with the distribution.
+	*
+	* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+	* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	* PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+	* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+	* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+	* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+	* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+	* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+	* EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+	*
+	*/
+
+#pragma once
+
+#include <math.h>
+
+BEGIN_DATAUNPACKER_NS()
+
+
+// Maps the timestamps of the device clock carried by the sample packets into the host clock
+// host = host_mean + (device - device_mean) * slope, fitted by least squares over the newest packets.
+// The host time of each packet carries the scheduling jitter of the rx path, the fit averages it
+// out while following the drift of the device clock. Only the decoder thread feeds it, the
+// statistics can be read from any thread.
+class DeviceClockEstimator
+{
+public:
+	enum {
+		WINDOW_SIZE = 64,
+		MIN_LOCK_PACKETS = 8,
+		// a device clock drifting further from the host clock is not taken as a microsecond clock
+		MAX_DRIFT_PPM = 10000,
+		// a step of the device clock beyond it from the fit restarts the fit, e.g. after a device reset
+		MAX_STEP_uS = 1000000,
+	};
+
+	DeviceClockEstimator()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		_count = 0;
+		_next = 0;
+		_total = 0;
+		_slope = 1;
+		_device_mean = 0;
+		_host_mean = 0;
+		_locked = false;
+
+		rp::hal::AutoLocker l(_stats_locker);
+		memset(&_stats, 0, sizeof(_stats));
+	}
+
+	// returns whether the device time can be mapped from now on
+	bool addPacket(_u64 deviceTs, _u64 hostTs)
+	{
+		if (_count) {
+			const _u64 lastDeviceTs = _device[(_next + WINDOW_SIZE - 1) % WINDOW_SIZE];
+			if (deviceTs <= lastDeviceTs || deviceTs - lastDeviceTs > MAX_STEP_uS
+				|| (_locked && _absDiff(toHost(deviceTs), hostTs) > MAX_STEP_uS)) {
+				reset();
+			}
+		}
+
+		_device[_next] = deviceTs;
+		_host[_next] = hostTs;
+		_next = (_next + 1) % WINDOW_SIZE;
+		if (_count < WINDOW_SIZE) ++_count;
+		++_total;
+
+		_fit(deviceTs);
+		return _locked;
+	}
+
+	bool isLocked() const
+	{
+		return _locked;
+	}
+
+	_u64 toHost(_u64 deviceTs) const
+	{
+		double mapped = (double)_host_mean + ((double)deviceTs - (double)_device_mean) * _slope;
+		return mapped > 0 ? (_u64)(mapped + 0.5) : 0;
+	}
+
+	void getStats(LidarDeviceClockStats& stats) const
+	{
+		rp::hal::AutoLocker l(_stats_locker);
+		stats = _stats;
+	}
+
+protected:
+	static _u64 _absDiff(_u64 a, _u64 b)
+	{
+		return a > b ? a - b : b - a;
+	}
+
+	void _fit(_u64 deviceTs)
+	{
+		// relative to the oldest packet, so the sums keep their precision in doubles
+		const size_t oldest = (_next + WINDOW_SIZE - _count) % WINDOW_SIZE;
+		const _u64 deviceRef = _device[oldest];
+		const _u64 hostRef = _host[oldest];
+
+		double sumX = 0, sumY = 0;
+		for (size_t pos = 0; pos < _count; ++pos) {
+			size_t idx = (oldest + pos) % WINDOW_SIZE;
+			sumX += (double)(_device[idx] - deviceRef);
+			sumY += (double)(_s64)(_host[idx] - hostRef);
+		}
+		const double meanX = sumX / _count, meanY = sumY / _count;
+
+		double sxx = 0, sxy = 0;
+		for (size_t pos = 0; pos < _count; ++pos) {
+			size_t idx = (oldest + pos) % WINDOW_SIZE;
+			double dx = (double)(_device[idx] - deviceRef) - meanX;
+			double dy = (double)(_s64)(_host[idx] - hostRef) - meanY;
+			sxx += dx * dx;
+			sxy += dx * dy;
+		}
+
+		if (_count >= 2 && sxx > 0) {
+			_slope = sxy / sxx;
+			_device_mean = deviceRef + (_u64)(meanX + 0.5);
+			_host_mean = (_u64)((double)hostRef + meanY + ((double)(_device_mean - deviceRef) - meanX) * _slope + 0.5);
+		}
+
+		double driftPpm = (_slope - 1) * 1e6;
+		_locked = _count >= MIN_LOCK_PACKETS && driftPpm < MAX_DRIFT_PPM && driftPpm > -MAX_DRIFT_PPM;
+
+		double sumResidual2 = 0;
+		for (size_t pos = 0; pos < _count; ++pos) {
+			size_t idx = (oldest + pos) % WINDOW_SIZE;
+			double residual = (double)(_s64)(_host[idx] - toHost(_device[idx]));
+			sumResidual2 += residual * residual;
+		}
+
+		rp::hal::AutoLocker l(_stats_locker);
+		_stats.locked = _locked;
+		_stats.packets = _total;
+		_stats.offset_uS = (_s64)(toHost(deviceTs) - deviceTs);
+		_stats.drift_ppm = (float)driftPpm;
+		_stats.residual_uS = (float)sqrt(sumResidual2 / _count);
+	}
+
+	_u64    _device[WINDOW_SIZE];
+	_u64    _host[WINDOW_SIZE];
+	size_t  _count;
+	size_t  _next;
+	_u64    _total;
+
+	double  _slope;
+	_u64    _device_mean;
+	_u64    _host_mean;
+	bool    _locked;
+
+	mutable rp::hal::Locker _stats_locker;
+	LidarDeviceClockStats   _stats;
+};
+
+END_DATAUNPACKER_NS()
@@ -0,0 +1,73 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+
+ /*
+  *  Sample Data Unpacker System
+  *  Build Configuration of the Sample Handlers
+  */
+
+  /*
+	* Redistribution and use in source and binary forms, with or without
+	* modification, are permitted provided that the following conditions are met:
+	*
+	* 1. Redistributions of source code must retain the above copyright notice,
+	*    this list of conditions and the following disclaimer.
+	*
+	* 2. Redistributions in binary form must reproduce the above copyright notice,
+	*    this list of conditions and the following disclaimer in the documentation
+	*    and/or other materials provided with the distribution.
+	*
+	* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+	* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	* PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+	* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+	* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+	* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+	* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+	* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+	* EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+	*
+	*/
+
+#pragma once
+
+// The sample handlers compiled into the unpacker, all of them by default.
+// Define SL_LIDAR_UNPACKER_HANDLERS_SELECTED and the SL_LIDAR_UNPACKER_WITH_xxx of the formats to keep
+// to leave the others out, e.g. through make UNPACKER_HANDLERS="hqnode dense_capsule".
+// The sample packets of the formats left out are ignored as the ones of an unknown answer type.
+
+#if !defined(SL_LIDAR_UNPACKER_HANDLERS_SELECTED)
+#define SL_LIDAR_UNPACKER_WITH_NORMALNODE           1
+#define SL_LIDAR_UNPACKER_WITH_HQNODE               1
+#define SL_LIDAR_UNPACKER_WITH_CAPSULE              1
+#define SL_LIDAR_UNPACKER_WITH_ULTRA_CAPSULE        1
+#define SL_LIDAR_UNPACKER_WITH_DENSE_CAPSULE        1
+#define SL_LIDAR_UNPACKER_WITH_ULTRA_DENSE_CAPSULE  1
+#endif
+
+#ifndef SL_LIDAR_UNPACKER_WITH_NORMALNODE
+#define SL_LIDAR_UNPACKER_WITH_NORMALNODE           0
+#endif
+#ifndef SL_LIDAR_UNPACKER_WITH_HQNODE
+#define SL_LIDAR_UNPACKER_WITH_HQNODE               0
+#endif
+#ifndef SL_LIDAR_UNPACKER_WITH_CAPSULE
+#define SL_LIDAR_UNPACKER_WITH_CAPSULE              0
+#endif
+#ifndef SL_LIDAR_UNPACKER_WITH_ULTRA_CAPSULE
+#define SL_LIDAR_UNPACKER_WITH_ULTRA_CAPSULE        0
+#endif
+#ifndef SL_LIDAR_UNPACKER_WITH_DENSE_CAPSULE
+#define SL_LIDAR_UNPACKER_WITH_DENSE_CAPSULE        0
+#endif
+#ifndef SL_LIDAR_UNPACKER_WITH_ULTRA_DENSE_CAPSULE
+#define SL_LIDAR_UNPACKER_WITH_ULTRA_DENSE_CAPSULE  0
+#endif
+
@@ -0,0 +1,166 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+
+ /*
+  *  Sample Data Unpacker System
+  *  Compile-time Specialized Unpacker
+  */
+
+  /*
+	* Redistribution and use in source and binary forms, with or without
+	* modification, are permitted provided that the following conditions are met:
+	*
+	* 1. Redistributions of source code must retain the above copyright notice,
+	*    this list of conditions and the following disclaimer.
+	*
+	* 2. Redistributions in binary form must reproduce the above copyright notice,
+	*    this list of conditions and the following disclaimer in the documentation
+	*    and/or other materials provided with the distribution.
+	*
+	* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+	* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	* PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+	* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+	* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+	* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+	* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+	* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+	* EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+	*
+	*/
+
+#pragma once
+
+BEGIN_DATAUNPACKER_NS()
+
+
+// An unpacker bound to a single handler and listener type at compile time.
+// The handler decodes through decodeData() with this engine, the publishing
+// calls are qualified, so the hot path runs without any virtual dispatch.
+// The sample packets of other answer types are not consumed.
+template <class THandler, class TListener>
+class StaticSampleDataUnpacker final : public LIDARSampleDataUnpackerInner
+{
+public:
+	StaticSampleDataUnpacker(TListener& l)
+		: LIDARSampleDataUnpackerInner(l)
+		, _sink(l)
+		, _enabled(false)
+		, _rxTimestamp_uS(0)
+	{
+	}
+
+	virtual ~StaticSampleDataUnpacker()
+	{
+	}
+
+	virtual void updateUnpackerContext(UnpackerContextType type, const void* data, size_t size)
+	{
+		if (type == UNPACKER_CONTEXT_TYPE_DEFERRED_DECODING) {
+			_handler.setDeferred(*reinterpret_cast<const bool*>(data));
+			return;
+		}
+		_handler.THandler::onUnpackerContextSet(type, data, size);
+	}
+
+	virtual bool onSampleData(_u8 ansType, const void* buffer, size_t size, _u64 rxTimestamp_uS = 0)
+	{
+		if (!_enabled) return false;
+		if (ansType != _handler.THandler::getSampleAnswerType()) return false;
+
+		_rxTimestamp_uS = rxTimestamp_uS;
+		_handler.decodeData(this, reinterpret_cast<const _u8 *>(buffer), size);
+		return true;
+	}
+
+	virtual void reset()
+	{
+		clearCache();
+	}
+
+	virtual void enable()
+	{
+		_enabled = true;
+		reset();
+	}
+
+	virtual void disable()
+	{
+		_enabled = false;
+		reset();
+	}
+
+	virtual void clearCache()
+	{
+		_handler.THandler::reset();
+	}
+
+	virtual size_t getDecodeStats(LidarSampleDecodeStats* stats, size_t maxCount) const
+	{
+		if (!maxCount) return 0;
+		_handler.getCounters().fill(_handler.THandler::getSampleAnswerType(), stats[0]);
+		return 1;
+	}
+
+	virtual bool getDeviceClockStats(LidarDeviceClockStats& stats) const
+	{
+		return _handler.THandler::getDeviceClockStats(stats) && stats.packets;
+	}
+
+	virtual bool setHandler(_u8 ansType, IDataUnpackerHandler* handler)
+	{
+		return false;
+	}
+
+	virtual _u64 getCurrentTimestamp_uS()
+	{
+		return _rxTimestamp_uS ? _rxTimestamp_uS : getus();
+	}
+
+	virtual void publishHQNode(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node)
+	{
+		_sink.TListener::onHQNodeDecoded(timestamp_uS, node);
+	}
+
+	virtual void publishHQNodes(const rplidar_response_measurement_node_hq_t* nodes, const _u64* timestamps_uS, size_t count)
+	{
+		if (count) {
+			_sink.TListener::onHQNodesDecoded(nodes, timestamps_uS, count);
+		}
+	}
+
+	virtual void publishDecodingErrorMsg(int errorType, _u8 ansType, const void* payload, size_t size)
+	{
+		_sink.TListener::onDecodingError(errorType, ansType, payload, size);
+	}
+
+	virtual void publishCustomData(_u8 ansType, _u32 customCode, const void* payload, size_t size)
+	{
+		_sink.TListener::onCustomSampleDataDecoded(ansType, customCode, getCurrentTimestamp_uS(), payload, size);
+	}
+
+	virtual void publishNewScanReset()
+	{
+		_sink.TListener::onHQNodeScanResetReq();
+	}
+
+	virtual void publishDeferredPacket(_u8 ansType, const void* packet, size_t size, bool revolutionStart)
+	{
+		_sink.TListener::onSamplePacketDeferred(ansType, getCurrentTimestamp_uS(), packet, size, revolutionStart);
+	}
+
+protected:
+	TListener& _sink;
+	THandler _handler;
+	bool _enabled;
+	_u64 _rxTimestamp_uS; // of the sample packet being decoded
+};
+
+END_DATAUNPACKER_NS()
@@ -0,0 +1,233 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "../dataunnpacker_commondef.h"
+#include "../dataunpacker.h"
+#include "../dataunnpacker_internal.h"
+
+#include "capsule_angles.h"
+#include "hal/cpu_features.h"
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SL_CAPSULE_ANGLES_NEON
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SL_CAPSULE_ANGLES_X86
+#define SL_CAPSULE_ANGLES_SSE2_TARGET __attribute__((target("sse2")))
+#define SL_CAPSULE_ANGLES_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#define SL_CAPSULE_ANGLES_X86
+#define SL_CAPSULE_ANGLES_SSE2_TARGET
+#define SL_CAPSULE_ANGLES_AVX2_TARGET
+#endif
+
+BEGIN_DATAUNPACKER_NS()
+
+namespace unpacker {
+
+enum {
+    FULL_CIRCLE_Q16 = 360 << 16,
+    FULL_CIRCLE_Q6 = 360 << 6,
+};
+
+// the reference decoding, any input is accepted
+void decodeCapsuleSampleAnglesGeneric(int startAngle_q16, int angleInc_q16, int count, _u32* angle_z_q14, _u32* syncBits)
+{
+    int currentAngle_raw_q16 = startAngle_q16;
+    for (int pos = 0; pos < count; ++pos) {
+        int angle_q6 = (currentAngle_raw_q16 >> 10);
+        syncBits[pos] = (((currentAngle_raw_q16 + angleInc_q16) % FULL_CIRCLE_Q16) < (angleInc_q16 << 1)) ? 1 : 0;
+
+        currentAngle_raw_q16 += angleInc_q16;
+
+        if (angle_q6 < 0) angle_q6 += FULL_CIRCLE_Q6;
+        if (angle_q6 >= FULL_CIRCLE_Q6) angle_q6 -= FULL_CIRCLE_Q6;
+
+        angle_z_q14[pos] = (_u16)((angle_q6 << 8) / 90);
+    }
+}
+
+// The vectorized implementations rely on the angles of a sane capsule:
+// every current and next angle is within [0, 720) degree, so that the wrapping needs one subtraction at most.
+// The angle_q6 * 256 / 90 division is done in float, it is exact as the dividend is below 2^23
+// and the quotient is at least 1/90 away from the next integer whenever it is not an integer.
+static bool _isVectorizable(int startAngle_q16, int angleInc_q16, int count)
+{
+    return startAngle_q16 >= 0 && startAngle_q16 < FULL_CIRCLE_Q16
+        && angleInc_q16 >= 0 && (_s64)angleInc_q16 * count < FULL_CIRCLE_Q16;
+}
+
+#if defined(SL_CAPSULE_ANGLES_X86)
+
+SL_CAPSULE_ANGLES_SSE2_TARGET static void _decodeAnglesSse2(int startAngle_q16, int angleInc_q16, int count, _u32* angle_z_q14, _u32* syncBits)
+{
+    if (!_isVectorizable(startAngle_q16, angleInc_q16, count)) {
+        decodeCapsuleSampleAnglesGeneric(startAngle_q16, angleInc_q16, count, angle_z_q14, syncBits);
+        return;
+    }
+
+    const __m128i inc = _mm_set1_epi32(angleInc_q16);
+    const __m128i syncThreshold = _mm_set1_epi32(angleInc_q16 << 1);
+    const __m128i step = _mm_set1_epi32(angleInc_q16 * 4);
+    const __m128i fullCircleQ16 = _mm_set1_epi32(FULL_CIRCLE_Q16);
+    const __m128i fullCircleQ6 = _mm_set1_epi32(FULL_CIRCLE_Q6);
+    const __m128 divisor = _mm_set1_ps(90.f);
+
+    __m128i current = _mm_setr_epi32(startAngle_q16, startAngle_q16 + angleInc_q16, startAngle_q16 + angleInc_q16 * 2, startAngle_q16 + angleInc_q16 * 3);
+
+    int pos = 0;
+    for (; pos + 4 <= count; pos += 4) {
+        __m128i angle_q6 = _mm_srai_epi32(current, 10);
+        angle_q6 = _mm_sub_epi32(angle_q6, _mm_andnot_si128(_mm_cmplt_epi32(angle_q6, fullCircleQ6), fullCircleQ6));
+        __m128i angle_z = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(_mm_slli_epi32(angle_q6, 8)), divisor));
+
+        __m128i next = _mm_add_epi32(current, inc);
+        next = _mm_sub_epi32(next, _mm_andnot_si128(_mm_cmplt_epi32(next, fullCircleQ16), fullCircleQ16));
+        __m128i sync = _mm_srli_epi32(_mm_cmplt_epi32(next, syncThreshold), 31);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(angle_z_q14 + pos), angle_z);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(syncBits + pos), sync);
+        current = _mm_add_epi32(current, step);
+    }
+
+    decodeCapsuleSampleAnglesGeneric(startAngle_q16 + angleInc_q16 * pos, angleInc_q16, count - pos, angle_z_q14 + pos, syncBits + pos);
+}
+
+SL_CAPSULE_ANGLES_AVX2_TARGET static void _decodeAnglesAvx2(int startAngle_q16, int angleInc_q16, int count, _u32* angle_z_q14, _u32* syncBits)
+{
+    if (!_isVectorizable(startAngle_q16, angleInc_q16, count)) {
+        decodeCapsuleSampleAnglesGeneric(startAngle_q16, angleInc_q16, count, angle_z_q14, syncBits);
+        return;
+    }
+
+    const __m256i inc = _mm256_set1_epi32(angleInc_q16);
+    const __m256i syncThreshold = _mm256_set1_epi32(angleInc_q16 << 1);
+    const __m256i step = _mm256_set1_epi32(angleInc_q16 * 8);
+    const __m256i fullCircleQ16 = _mm256_set1_epi32(FULL_CIRCLE_Q16);
+    const __m256i fullCircleQ6 = _mm256_set1_epi32(FULL_CIRCLE_Q6);
+    const __m256 divisor = _mm256_set1_ps(90.f);
+
+    __m256i current = _mm256_add_epi32(_mm256_set1_epi32(startAngle_q16),
+        _mm256_mullo_epi32(inc, _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+
+    int pos = 0;
+    for (; pos + 8 <= count; pos += 8) {
+        __m256i angle_q6 = _mm256_srai_epi32(current, 10);
+        angle_q6 = _mm256_sub_epi32(angle_q6, _mm256_andnot_si256(_mm256_cmpgt_epi32(fullCircleQ6, angle_q6), fullCircleQ6));
+        __m256i angle_z = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(_mm256_slli_epi32(angle_q6, 8)), divisor));
+
+        __m256i next = _mm256_add_epi32(current, inc);
+        next = _mm256_sub_epi32(next, _mm256_andnot_si256(_mm256_cmpgt_epi32(fullCircleQ16, next), fullCircleQ16));
+        __m256i sync = _mm256_srli_epi32(_mm256_cmpgt_epi32(syncThreshold, next), 31);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(angle_z_q14 + pos), angle_z);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(syncBits + pos), sync);
+        current = _mm256_add_epi32(current, step);
+    }
+
+    decodeCapsuleSampleAnglesGeneric(startAngle_q16 + angleInc_q16 * pos, angleInc_q16, count - pos, angle_z_q14 + pos, syncBits + pos);
+}
+
+#elif defined(SL_CAPSULE_ANGLES_NEON)
+
+static void _decodeAnglesNeon(int startAngle_q16, int angleInc_q16, int count, _u32* angle_z_q14, _u32* syncBits)
+{
+    if (!_isVectorizable(startAngle_q16, angleInc_q16, count)) {
+        decodeCapsuleSampleAnglesGeneric(startAngle_q16, angleInc_q16, count, angle_z_q14, syncBits);
+        return;
+    }
+
+    const int32x4_t inc = vdupq_n_s32(angleInc_q16);
+    const int32x4_t syncThreshold = vdupq_n_s32(angleInc_q16 << 1);
+    const int32x4_t step = vdupq_n_s32(angleInc_q16 * 4);
+    const int32x4_t fullCircleQ16 = vdupq_n_s32(FULL_CIRCLE_Q16);
+    const int32x4_t fullCircleQ6 = vdupq_n_s32(FULL_CIRCLE_Q6);
+    const float32x4_t divisor = vdupq_n_f32(90.f);
+    const uint32x4_t one = vdupq_n_u32(1);
+
+    const int32_t lanes[4] = { 0, 1, 2, 3 };
+    int32x4_t current = vmlaq_s32(vdupq_n_s32(startAngle_q16), inc, vld1q_s32(lanes));
+
+    int pos = 0;
+    for (; pos + 4 <= count; pos += 4) {
+        int32x4_t angle_q6 = vshrq_n_s32(current, 10);
+        angle_q6 = vsubq_s32(angle_q6, vandq_s32(vreinterpretq_s32_u32(vcgeq_s32(angle_q6, fullCircleQ6)), fullCircleQ6));
+        uint32x4_t angle_z = vcvtq_u32_f32(vdivq_f32(vcvtq_f32_s32(vshlq_n_s32(angle_q6, 8)), divisor));
+
+        int32x4_t next = vaddq_s32(current, inc);
+        next = vsubq_s32(next, vandq_s32(vreinterpretq_s32_u32(vcgeq_s32(next, fullCircleQ16)), fullCircleQ16));
+        uint32x4_t sync = vandq_u32(vcltq_s32(next, syncThreshold), one);
+
+        vst1q_u32(angle_z_q14 + pos, angle_z);
+        vst1q_u32(syncBits + pos, sync);
+        current = vaddq_s32(current, step);
+    }
+
+    decodeCapsuleSampleAnglesGeneric(startAngle_q16 + angleInc_q16 * pos, angleInc_q16, count - pos, angle_z_q14 + pos, syncBits + pos);
+}
+
+#endif
+
+typedef void (*decode_angles_proc_t)(int startAngle_q16, int angleInc_q16, int count, _u32* angle_z_q14, _u32* syncBits);
+
+static decode_angles_proc_t _selectDecodeAnglesProc(_u32 features)
+{
+#if defined(SL_CAPSULE_ANGLES_NEON)
+    if (rp::hal::hasCpuFeatures(features, rp::hal::CPU_FEATURE_NEON)) return _decodeAnglesNeon;
+#elif defined(SL_CAPSULE_ANGLES_X86)
+    if (rp::hal::hasCpuFeatures(features, rp::hal::CPU_FEATURE_AVX2)) return _decodeAnglesAvx2;
+    if (rp::hal::hasCpuFeatures(features, rp::hal::CPU_FEATURE_SSE2)) return _decodeAnglesSse2;
+#endif
+    return decodeCapsuleSampleAnglesGeneric;
+}
+
+static std::atomic<decode_angles_proc_t> _decodeAnglesProc(decodeCapsuleSampleAnglesGeneric);
+
+static void _bindDecodeAnglesProc(_u32 features)
+{
+    _decodeAnglesProc.store(_selectDecodeAnglesProc(features), std::memory_order_relaxed);
+}
+
+static rp::hal::CpuKernelBinding _decodeAnglesBinding(_bindDecodeAnglesProc);
+
+void decodeCapsuleSampleAngles(int startAngle_q16, int angleInc_q16, int count, _u32* angle_z_q14, _u32* syncBits)
+{
+    _decodeAnglesProc.load(std::memory_order_relaxed)(startAngle_q16, angleInc_q16, count, angle_z_q14, syncBits);
+}
+
+}
+
+END_DATAUNPACKER_NS()
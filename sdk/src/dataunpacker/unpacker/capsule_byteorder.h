@@ -0,0 +1,110 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+BEGIN_DATAUNPACKER_NS()
+
+namespace unpacker {
+
+// Converts the sample packets from the little endian wire order to the host order in place, before they are decoded.
+// Each packet is converted in one pass over its fields, so the decoders read the host order only. Nothing is done on
+// the little endian hosts. The strides follow the packed layouts of the protocol, no alignment is needed.
+
+// swaps the bytes of count 16 bit fields spaced by stride bytes, the contiguous runs are left to the vectorizer
+static inline void swapLe16Fields(void* first, size_t stride, size_t count)
+{
+#ifdef _CPU_ENDIAN_BIG
+    _u8* field = static_cast<_u8*>(first);
+    for (size_t pos = 0; pos < count; ++pos, field += stride) {
+        _u8 low = field[0];
+        field[0] = field[1];
+        field[1] = low;
+    }
+#else
+    (void)first; (void)stride; (void)count;
+#endif
+}
+
+static inline void swapLe32Fields(void* first, size_t stride, size_t count)
+{
+#ifdef _CPU_ENDIAN_BIG
+    _u8* field = static_cast<_u8*>(first);
+    for (size_t pos = 0; pos < count; ++pos, field += stride) {
+        _u8 b0 = field[0], b1 = field[1];
+        field[0] = field[3];
+        field[1] = field[2];
+        field[2] = b1;
+        field[3] = b0;
+    }
+#else
+    (void)first; (void)stride; (void)count;
+#endif
+}
+
+static inline void convertSamplePacketToHost(rplidar_response_capsule_measurement_nodes_t& packet)
+{
+    swapLe16Fields(&packet.start_angle_sync_q6, sizeof(packet.start_angle_sync_q6), 1);
+    swapLe16Fields(&packet.cabins[0].distance_angle_1, sizeof(packet.cabins[0]), _countof(packet.cabins));
+    swapLe16Fields(&packet.cabins[0].distance_angle_2, sizeof(packet.cabins[0]), _countof(packet.cabins));
+}
+
+static inline void convertSamplePacketToHost(rplidar_response_ultra_capsule_measurement_nodes_t& packet)
+{
+    swapLe16Fields(&packet.start_angle_sync_q6, sizeof(packet.start_angle_sync_q6), 1);
+    swapLe32Fields(&packet.ultra_cabins[0], sizeof(packet.ultra_cabins[0]), _countof(packet.ultra_cabins));
+}
+
+// the start angle is followed by the distances, all of them in a single run
+static inline void convertSamplePacketToHost(rplidar_response_dense_capsule_measurement_nodes_t& packet)
+{
+    swapLe16Fields(&packet.start_angle_sync_q6, sizeof(_u16), 1 + _countof(packet.cabins));
+}
+
+static inline void convertSamplePacketToHost(rplidar_response_ultra_dense_capsule_measurement_nodes_t& packet)
+{
+    swapLe16Fields(&packet.start_angle_sync_q6, sizeof(packet.start_angle_sync_q6), 1);
+    swapLe16Fields(&packet.cabins[0].qualityl_distance_scale[0], sizeof(packet.cabins[0]), _countof(packet.cabins));
+    swapLe16Fields(&packet.cabins[0].qualityl_distance_scale[1], sizeof(packet.cabins[0]), _countof(packet.cabins));
+}
+
+// the nodes only, the timestamp and the crc are read once per packet
+static inline void convertSamplePacketToHost(rplidar_response_hq_capsule_measurement_nodes_t& packet)
+{
+    swapLe16Fields(&packet.node_hq[0].angle_z_q14, sizeof(packet.node_hq[0]), _countof(packet.node_hq));
+    swapLe32Fields(&packet.node_hq[0].dist_mm_q2, sizeof(packet.node_hq[0]), _countof(packet.node_hq));
+}
+
+}
+
+END_DATAUNPACKER_NS()
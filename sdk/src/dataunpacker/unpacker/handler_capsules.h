@@ -38,6 +38,10 @@
 
 #pragma once
 
+#include "capsule_angles.h"
+#include "capsule_byteorder.h"
+#include "hal/byte_search.h"
+
 BEGIN_DATAUNPACKER_NS()
 
 namespace unpacker {
@@ -51,11 +55,17 @@ public:
 	virtual void onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t size);
 	virtual void reset();
 	virtual void onUnpackerContextSet(LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size);
+
+	// the decoding with the engine bound statically, onData forwards to it with the runtime engine
+	template <class TEngine>
+	void decodeData(TEngine* engine, const _u8* data, size_t size);
 protected:
+	void _updateSampleDelayOffsets();
 
-	void _onScanNodeCapsuleData(rplidar_response_capsule_measurement_nodes_t &, LIDARSampleDataUnpackerInner* engine);
+	template <class TEngine>
+	void _onScanNodeCapsuleData(rplidar_response_capsule_measurement_nodes_t &, TEngine* engine);
 
-	std::vector<_u8> _cached_scan_node_buf;
+	sdk_vector<_u8> _cached_scan_node_buf;
 	int              _cached_scan_node_buf_pos;
 	bool             _is_previous_capsuledataRdy;
 
@@ -63,6 +73,8 @@ protected:
 	_u64             _cached_last_data_timestamp_us;
 
 	SlamtecLidarTimingDesc _cachedTimingDesc;
+	_u64             _sample_delay_offsets_us[16 * 2]; // of each sample in a capsule
+	ScanRegionMask   _scan_region;
 };
 
 class UnpackerHandler_UltraCapsuleNode : public IDataUnpackerHandler {
@@ -74,11 +86,17 @@ public:
 	virtual void onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t size);
 	virtual void reset();
 	virtual void onUnpackerContextSet(LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size);
+
+	// the decoding with the engine bound statically, onData forwards to it with the runtime engine
+	template <class TEngine>
+	void decodeData(TEngine* engine, const _u8* data, size_t size);
 protected:
-	void _onScanNodeUltraCapsuleData(rplidar_response_ultra_capsule_measurement_nodes_t&, LIDARSampleDataUnpackerInner* engine);
+	void _updateSampleDelayOffsets();
+	template <class TEngine>
+	void _onScanNodeUltraCapsuleData(rplidar_response_ultra_capsule_measurement_nodes_t&, TEngine* engine);
 
 
-	std::vector<_u8> _cached_scan_node_buf;
+	sdk_vector<_u8> _cached_scan_node_buf;
 	int              _cached_scan_node_buf_pos;
 	bool             _is_previous_capsuledataRdy;
 
@@ -86,6 +104,8 @@ protected:
 	_u64             _cached_last_data_timestamp_us;
 
 	SlamtecLidarTimingDesc _cachedTimingDesc;
+	_u64             _sample_delay_offsets_us[32 * 3]; // of each sample in a capsule
+	ScanRegionMask   _scan_region;
 
 };
 
@@ -100,11 +120,17 @@ public:
 	virtual void onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t size);
 	virtual void reset();
 	virtual void onUnpackerContextSet(LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size);
+
+	// the decoding with the engine bound statically, onData forwards to it with the runtime engine
+	template <class TEngine>
+	void decodeData(TEngine* engine, const _u8* data, size_t size);
 protected:
-	void _onScanNodeDenseCapsuleData(rplidar_response_dense_capsule_measurement_nodes_t&, LIDARSampleDataUnpackerInner* engine);
+	void _updateSampleDelayOffsets();
+	template <class TEngine>
+	void _onScanNodeDenseCapsuleData(rplidar_response_dense_capsule_measurement_nodes_t&, TEngine* engine);
 
 
-	std::vector<_u8> _cached_scan_node_buf;
+	sdk_vector<_u8> _cached_scan_node_buf;
 	int              _cached_scan_node_buf_pos;
 	bool             _is_previous_capsuledataRdy;
 
@@ -112,6 +138,8 @@ protected:
 	_u64             _cached_last_data_timestamp_us;
 
 	SlamtecLidarTimingDesc _cachedTimingDesc;
+	_u64             _sample_delay_offsets_us[40]; // of each sample in a capsule
+	ScanRegionMask   _scan_region;
 
 };
 
@@ -125,10 +153,16 @@ public:
 	virtual void onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t size);
 	virtual void reset();
 	virtual void onUnpackerContextSet(LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size);
+
+	// the decoding with the engine bound statically, onData forwards to it with the runtime engine
+	template <class TEngine>
+	void decodeData(TEngine* engine, const _u8* data, size_t size);
 protected:
-	void _onScanNodeUltraDenseCapsuleData(rplidar_response_ultra_dense_capsule_measurement_nodes_t&, LIDARSampleDataUnpackerInner* engine);
+	void _updateSampleDelayOffsets();
+	template <class TEngine>
+	void _onScanNodeUltraDenseCapsuleData(rplidar_response_ultra_dense_capsule_measurement_nodes_t&, TEngine* engine);
 
-	std::vector<_u8> _cached_scan_node_buf;
+	sdk_vector<_u8> _cached_scan_node_buf;
 	int              _cached_scan_node_buf_pos;
 	bool             _is_previous_capsuledataRdy;
 
@@ -141,9 +175,897 @@ protected:
 	int              _last_dist_q2;
 
 	SlamtecLidarTimingDesc _cachedTimingDesc;
+	_u64             _sample_delay_offsets_us[32 * 2]; // of each sample in a capsule
+	ScanRegionMask   _scan_region;
 };
 
 
+// Decoding
+///////////////////////////////////////////////////////////////////////////////////
+
+// skips the bytes from pos, which is not a sync byte 1, up to the next one at once,
+// counted as the per byte hunt of the handlers would
+static inline size_t _skipToCapsuleSync(const _u8* data, size_t pos, size_t cnt, DataUnpackerHandlerCounters& counters, bool& isPreviousCapsuleReady)
+{
+    const _u8* syncByte = rp::hal::findHighNibble(data + pos + 1, data + cnt, RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_1);
+    size_t syncPos = (size_t)(syncByte - data);
+
+    DataUnpackerHandlerCounters::add(counters.skipped_bytes, syncPos - pos);
+    if (isPreviousCapsuleReady) DataUnpackerHandlerCounters::add(counters.capsule_discards);
+    isPreviousCapsuleReady = false;
+    return syncPos;
+}
+
+static inline _u32 _varbitscale_decode(_u32 scaled, _u32& scaleLevel)
+{
+    static const _u32 VBS_SCALED_BASE[] = {
+        RPLIDAR_VARBITSCALE_X16_DEST_VAL,
+        RPLIDAR_VARBITSCALE_X8_DEST_VAL,
+        RPLIDAR_VARBITSCALE_X4_DEST_VAL,
+        RPLIDAR_VARBITSCALE_X2_DEST_VAL,
+        0,
+    };
+
+    static const _u32 VBS_SCALED_LVL[] = {
+        4,
+        3,
+        2,
+        1,
+        0,
+    };
+
+    static const _u32 VBS_TARGET_BASE[] = {
+        (0x1 << RPLIDAR_VARBITSCALE_X16_SRC_BIT),
+        (0x1 << RPLIDAR_VARBITSCALE_X8_SRC_BIT),
+        (0x1 << RPLIDAR_VARBITSCALE_X4_SRC_BIT),
+        (0x1 << RPLIDAR_VARBITSCALE_X2_SRC_BIT),
+        0,
+    };
+
+    for (size_t i = 0; i < _countof(VBS_SCALED_BASE); ++i)
+    {
+        int remain = ((int)scaled - (int)VBS_SCALED_BASE[i]);
+        if (remain >= 0) {
+            scaleLevel = VBS_SCALED_LVL[i];
+            return VBS_TARGET_BASE[i] + (remain << scaleLevel);
+        }
+    }
+
+    return 0;
+}
+
+template <class TEngine>
+void UnpackerHandler_CapsuleNode::decodeData(TEngine* engine, const _u8* data, size_t cnt)
+{
+    for (size_t pos = 0; pos < cnt; ++pos) {
+        if (!_cached_scan_node_buf_pos && (data[pos] >> 4) != RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_1) {
+            pos = _skipToCapsuleSync(data, pos, cnt, _counters, _is_previous_capsuledataRdy);
+            if (pos == cnt) break;
+        }
+
+        _u8 current_data = data[pos];
+        switch (_cached_scan_node_buf_pos) {
+        case 0: // expect the sync bit 1
+        {
+            _u8 tmp = (current_data >> 4);
+            if (tmp == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_1) {
+                // pass
+            }
+            else {
+                DataUnpackerHandlerCounters::add(_counters.skipped_bytes);
+                if (_is_previous_capsuledataRdy) DataUnpackerHandlerCounters::add(_counters.capsule_discards);
+                _is_previous_capsuledataRdy = false;
+                continue;
+            }
+
+        }
+        break;
+        case 1: // expect the sync bit 2
+        {
+            _u8 tmp = (current_data >> 4);
+            if (tmp == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_2) {
+                // pass
+            }
+            else {
+                _cached_scan_node_buf_pos = 0;
+                DataUnpackerHandlerCounters::add(_counters.resyncs);
+                DataUnpackerHandlerCounters::add(_counters.skipped_bytes, 2);
+                if (_is_previous_capsuledataRdy) DataUnpackerHandlerCounters::add(_counters.capsule_discards);
+                _is_previous_capsuledataRdy = false;
+                continue;
+            }
+        }
+        break;
+
+        case sizeof(rplidar_response_capsule_measurement_nodes_t) - 1: // new data ready
+        {
+            _cached_scan_node_buf[sizeof(rplidar_response_capsule_measurement_nodes_t) - 1] = current_data;
+            _cached_scan_node_buf_pos = 0;
+
+            rplidar_response_capsule_measurement_nodes_t* node = reinterpret_cast<rplidar_response_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
+
+            // calc the checksum ...
+            _u8 checksum = 0;
+            _u8 recvChecksum = ((node->s_checksum_1 & 0xF) | (node->s_checksum_2 << 4));
+            for (size_t cpos = offsetof(rplidar_response_capsule_measurement_nodes_t, start_angle_sync_q6);
+                cpos < sizeof(rplidar_response_capsule_measurement_nodes_t); ++cpos)
+            {
+                checksum ^= _cached_scan_node_buf[cpos];
+            }
+
+            if (recvChecksum == checksum)
+            {
+                // only consider vaild if the checksum matches...
+                if (_deferred) {
+                    // left in the wire order for the decoding on the grab
+                    DataUnpackerHandlerCounters::add(_counters.packets);
+                    engine->publishDeferredPacket(RPLIDAR_ANS_TYPE_MEASUREMENT_CAPSULED, node, sizeof(*node)
+                        , _isDeferredRevolutionStart((le16_to_cpu(node->start_angle_sync_q6) & 0x7FFF) << 2));
+                    continue;
+                }
+
+                // perform data endianess convertion if necessary
+                convertSamplePacketToHost(*node);
+                if (node->start_angle_sync_q6 & RPLIDAR_RESP_MEASUREMENT_EXP_SYNCBIT)
+                {
+                    if (_is_previous_capsuledataRdy) {
+                        DataUnpackerHandlerCounters::add(_counters.encoder_resets);
+                        engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_ENCODER_RESET
+                            , RPLIDAR_ANS_TYPE_MEASUREMENT_CAPSULED, node, sizeof(*node));
+                    }
+                    // this is the first capsule frame in logic, discard the previous cached data...
+                    _is_previous_capsuledataRdy = false;
+                    engine->publishNewScanReset();
+
+
+                }
+                DataUnpackerHandlerCounters::add(_counters.packets);
+                _onScanNodeCapsuleData(*node, engine);
+            }
+            else {
+                DataUnpackerHandlerCounters::add(_counters.checksum_errors);
+                if (_is_previous_capsuledataRdy) DataUnpackerHandlerCounters::add(_counters.capsule_discards);
+                _is_previous_capsuledataRdy = false;
+
+
+                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
+                    , RPLIDAR_ANS_TYPE_MEASUREMENT_CAPSULED, node, sizeof(*node));
+
+            }
+            continue;
+        }
+        break;
+
+        }
+        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
+    }
+
+}
+
+template <class TEngine>
+void UnpackerHandler_CapsuleNode::_onScanNodeCapsuleData(rplidar_response_capsule_measurement_nodes_t& capsule, TEngine* engine)
+{
+    _u64 currentTS = engine->getCurrentTimestamp_uS();
+    if (_is_previous_capsuledataRdy) {
+        int diffAngle_q8;
+        int currentStartAngle_q8 = ((capsule.start_angle_sync_q6 & 0x7FFF) << 2);
+        int prevStartAngle_q8 = ((_cached_previous_capsuledata.start_angle_sync_q6 & 0x7FFF) << 2);
+
+        diffAngle_q8 = (currentStartAngle_q8)-(prevStartAngle_q8);
+        if (prevStartAngle_q8 > currentStartAngle_q8) {
+            diffAngle_q8 += (360 << 8);
+        }
+
+        // the samples of the cached capsule span up to the start of this one
+        if (!_scan_region.overlaps(prevStartAngle_q8, currentStartAngle_q8)) {
+            DataUnpackerHandlerCounters::add(_counters.region_skips);
+            _cached_previous_capsuledata = capsule;
+            _cached_last_data_timestamp_us = currentTS;
+            return;
+        }
+
+        int angleInc_q16 = (diffAngle_q8 << 3);
+        int currentAngle_raw_q16 = (prevStartAngle_q8 << 8);
+
+        rplidar_response_measurement_node_hq_t hqNodes[_countof(_cached_previous_capsuledata.cabins) * 2];
+        _u64 timestamps[_countof(hqNodes)];
+
+        for (int pos = 0; pos < (int)_countof(_cached_previous_capsuledata.cabins); ++pos)
+        {
+            int dist_q2[2];
+            int angle_q6[2];
+            int syncBit[2];
+
+            dist_q2[0] = (_cached_previous_capsuledata.cabins[pos].distance_angle_1 & 0xFFFC);
+            dist_q2[1] = (_cached_previous_capsuledata.cabins[pos].distance_angle_2 & 0xFFFC);
+
+            int angle_offset1_q3 = ((_cached_previous_capsuledata.cabins[pos].offset_angles_q3 & 0xF) | ((_cached_previous_capsuledata.cabins[pos].distance_angle_1 & 0x3) << 4));
+            int angle_offset2_q3 = ((_cached_previous_capsuledata.cabins[pos].offset_angles_q3 >> 4) | ((_cached_previous_capsuledata.cabins[pos].distance_angle_2 & 0x3) << 4));
+
+            angle_q6[0] = ((currentAngle_raw_q16 - (angle_offset1_q3 << 13)) >> 10);
+            syncBit[0] = (((currentAngle_raw_q16 + angleInc_q16) % (360 << 16)) < angleInc_q16) ? 1 : 0;
+            currentAngle_raw_q16 += angleInc_q16;
+
+
+            angle_q6[1] = ((currentAngle_raw_q16 - (angle_offset2_q3 << 13)) >> 10);
+            syncBit[1] = (((currentAngle_raw_q16 + angleInc_q16) % (360 << 16)) < angleInc_q16) ? 1 : 0;
+            currentAngle_raw_q16 += angleInc_q16;
+
+            for (int cpos = 0; cpos < 2; ++cpos) {
+
+                if (angle_q6[cpos] < 0) angle_q6[cpos] += (360 << 6);
+                if (angle_q6[cpos] >= (360 << 6)) angle_q6[cpos] -= (360 << 6);
+
+                rplidar_response_measurement_node_hq_t& hqNode = hqNodes[pos * 2 + cpos];
+
+
+                hqNode.flag = (syncBit[cpos] | ((!syncBit[cpos]) << 1));
+                hqNode.quality = dist_q2[cpos] ? (0x2F << RPLIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
+
+                hqNode.angle_z_q14 = (angle_q6[cpos] << 8) / 90;
+                hqNode.dist_mm_q2 = dist_q2[cpos];
+
+                timestamps[pos * 2 + cpos] = _cached_last_data_timestamp_us - _sample_delay_offsets_us[pos * 2 + cpos];
+            }
+
+        }
+
+        engine->publishHQNodes(hqNodes, timestamps, _countof(hqNodes));
+    }
+
+    _cached_previous_capsuledata = capsule;
+    _is_previous_capsuledataRdy = true;
+    _cached_last_data_timestamp_us = currentTS;
+
+}
+
+template <class TEngine>
+void UnpackerHandler_UltraCapsuleNode::decodeData(TEngine* engine, const _u8* data, size_t cnt)
+{
+
+    for (size_t pos = 0; pos < cnt; ++pos) {
+        if (!_cached_scan_node_buf_pos && (data[pos] >> 4) != RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_1) {
+            pos = _skipToCapsuleSync(data, pos, cnt, _counters, _is_previous_capsuledataRdy);
+            if (pos == cnt) break;
+        }
+
+        _u8 current_data = data[pos];
+        switch (_cached_scan_node_buf_pos) {
+        case 0: // expect the sync bit 1
+        {
+            _u8 tmp = (current_data >> 4);
+            if (tmp == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_1) {
+                // pass
+            }
+            else {
+                DataUnpackerHandlerCounters::add(_counters.skipped_bytes);
+                if (_is_previous_capsuledataRdy) DataUnpackerHandlerCounters::add(_counters.capsule_discards);
+                _is_previous_capsuledataRdy = false;
+                continue;
+            }
+
+        }
+        break;
+        case 1: // expect the sync bit 2
+        {
+            _u8 tmp = (current_data >> 4);
+            if (tmp == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_2) {
+                // pass
+            }
+            else {
+                _cached_scan_node_buf_pos = 0;
+                DataUnpackerHandlerCounters::add(_counters.resyncs);
+                DataUnpackerHandlerCounters::add(_counters.skipped_bytes, 2);
+                if (_is_previous_capsuledataRdy) DataUnpackerHandlerCounters::add(_counters.capsule_discards);
+                _is_previous_capsuledataRdy = false;
+                continue;
+            }
+        }
+        break;
+
+        case sizeof(rplidar_response_ultra_capsule_measurement_nodes_t) - 1: // new data ready
+        {
+            _cached_scan_node_buf[sizeof(rplidar_response_ultra_capsule_measurement_nodes_t) - 1] = current_data;
+            _cached_scan_node_buf_pos = 0;
+
+            rplidar_response_ultra_capsule_measurement_nodes_t* node = reinterpret_cast<rplidar_response_ultra_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
+
+            // calc the checksum ...
+            _u8 checksum = 0;
+            _u8 recvChecksum = ((node->s_checksum_1 & 0xF) | (node->s_checksum_2 << 4));
+            for (size_t cpos = offsetof(rplidar_response_ultra_capsule_measurement_nodes_t, start_angle_sync_q6);
+                cpos < sizeof(rplidar_response_ultra_capsule_measurement_nodes_t); ++cpos)
+            {
+                checksum ^= _cached_scan_node_buf[cpos];
+            }
+
+            if (recvChecksum == checksum)
+            {
+                // only consider vaild if the checksum matches...
+                if (_deferred) {
+                    // left in the wire order for the decoding on the grab
+                    DataUnpackerHandlerCounters::add(_counters.packets);
+                    engine->publishDeferredPacket(RPLIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA, node, sizeof(*node)
+                        , _isDeferredRevolutionStart((le16_to_cpu(node->start_angle_sync_q6) & 0x7FFF) << 2));
+                    continue;
+                }
+
+                // perform data endianess convertion if necessary
+                convertSamplePacketToHost(*node);
+                if (node->start_angle_sync_q6 & RPLIDAR_RESP_MEASUREMENT_EXP_SYNCBIT)
+                {
+                    if (_is_previous_capsuledataRdy) {
+                        DataUnpackerHandlerCounters::add(_counters.encoder_resets);
+                        engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_ENCODER_RESET
+                            , RPLIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA, node, sizeof(*node));
+
+                    }
+                    // this is the first capsule frame in logic, discard the previous cached data...
+                    _is_previous_capsuledataRdy = false;
+
+                    engine->publishNewScanReset();
+
+                }
+                DataUnpackerHandlerCounters::add(_counters.packets);
+                _onScanNodeUltraCapsuleData(*node, engine);
+            }
+            else {
+                DataUnpackerHandlerCounters::add(_counters.checksum_errors);
+                if (_is_previous_capsuledataRdy) DataUnpackerHandlerCounters::add(_counters.capsule_discards);
+                _is_previous_capsuledataRdy = false;
+
+                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
+                    , RPLIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA, node, sizeof(*node));
+
+            }
+            continue;
+        }
+        break;
+
+        }
+        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
+    }
+
+}
+
+template <class TEngine>
+void UnpackerHandler_UltraCapsuleNode::_onScanNodeUltraCapsuleData(rplidar_response_ultra_capsule_measurement_nodes_t& capsule, TEngine* engine)
+{
+    _u64 currentTS = engine->getCurrentTimestamp_uS();
+    if (_is_previous_capsuledataRdy) {
+        int diffAngle_q8;
+        int currentStartAngle_q8 = ((capsule.start_angle_sync_q6 & 0x7FFF) << 2);
+        int prevStartAngle_q8 = ((_cached_previous_ultracapsuledata.start_angle_sync_q6 & 0x7FFF) << 2);
+
+        diffAngle_q8 = (currentStartAngle_q8)-(prevStartAngle_q8);
+        if (prevStartAngle_q8 > currentStartAngle_q8) {
+            diffAngle_q8 += (360 << 8);
+        }
+
+        // the samples of the cached capsule span up to the start of this one
+        if (!_scan_region.overlaps(prevStartAngle_q8, currentStartAngle_q8)) {
+            DataUnpackerHandlerCounters::add(_counters.region_skips);
+            _cached_previous_ultracapsuledata = capsule;
+            _cached_last_data_timestamp_us = currentTS;
+            return;
+        }
+
+        int angleInc_q16 = (diffAngle_q8 << 3) / 3;
+        int currentAngle_raw_q16 = (prevStartAngle_q8 << 8);
+
+        rplidar_response_measurement_node_hq_t hqNodes[_countof(_cached_previous_ultracapsuledata.ultra_cabins) * 3];
+        _u64 timestamps[_countof(hqNodes)];
+
+        for (int pos = 0; pos < (int)_countof(_cached_previous_ultracapsuledata.ultra_cabins); ++pos)
+        {
+            int dist_q2[3];
+            int angle_q6[3];
+            int syncBit[3];
+
+
+            _u32 combined_x3 = _cached_previous_ultracapsuledata.ultra_cabins[pos].combined_x3;
+
+            // unpack ...
+            int dist_major = (combined_x3 & 0xFFF);
+
+            // signed partical integer, using the magic shift here
+            // DO NOT TOUCH
+
+            int dist_predict1 = (((int)(combined_x3 << 10)) >> 22);
+            int dist_predict2 = (((int)combined_x3) >> 22);
+
+            int dist_major2;
+
+            _u32 scalelvl1=0, scalelvl2 = 0;
+
+            // prefetch next ...
+            if (pos == _countof(_cached_previous_ultracapsuledata.ultra_cabins) - 1)
+            {
+                dist_major2 = (capsule.ultra_cabins[0].combined_x3 & 0xFFF);
+            }
+            else {
+                dist_major2 = (_cached_previous_ultracapsuledata.ultra_cabins[pos + 1].combined_x3 & 0xFFF);
+            }
+
+            // decode with the var bit scale ...
+            dist_major = _varbitscale_decode(dist_major, scalelvl1);
+            dist_major2 = _varbitscale_decode(dist_major2, scalelvl2);
+
+
+            int dist_base1 = dist_major;
+            int dist_base2 = dist_major2;
+
+            if ((!dist_major) && dist_major2) {
+                dist_base1 = dist_major2;
+                scalelvl1 = scalelvl2;
+            }
+
+
+            dist_q2[0] = (dist_major << 2);
+            if (((_u32)dist_predict1 == 0xFFFFFE00) || ((_u32)dist_predict1 == 0x1FF)) {
+                dist_q2[1] = 0;
+            }
+            else {
+                dist_predict1 = (int)(dist_predict1 << scalelvl1);
+                dist_q2[1] = (dist_predict1 + dist_base1) << 2;
+
+            }
+
+            if (((_u32)dist_predict2 == 0xFFFFFE00) || ((_u32)dist_predict2 == 0x1FF)) {
+                dist_q2[2] = 0;
+            }
+            else {
+                dist_predict2 = (int)(dist_predict2 << scalelvl2);
+                dist_q2[2] = (dist_predict2 + dist_base2) << 2;
+            }
+
+            for (int cpos = 0; cpos < 3; ++cpos)
+            {
+
+                syncBit[cpos] = (((currentAngle_raw_q16 + angleInc_q16) % (360 << 16)) < angleInc_q16) ? 1 : 0;
+
+
+                rplidar_response_measurement_node_hq_t& hqNode = hqNodes[pos * 3 + cpos];
+
+
+                int offsetAngleMean_q16 = (int)(7.5 * 3.1415926535 * (1 << 16) / 180.0);
+
+                if (dist_q2[cpos] >= (50 * 4))
+                {
+                    const int k1 = 98361;
+                    const int k2 = int(k1 / dist_q2[cpos]);
+
+                    offsetAngleMean_q16 = (int)(8 * 3.1415926535 * (1 << 16) / 180) - (k2 << 6) - (k2 * k2 * k2) / 98304;
+                }
+
+                angle_q6[cpos] = ((currentAngle_raw_q16 - int(offsetAngleMean_q16 * 180 / 3.14159265)) >> 10);
+                currentAngle_raw_q16 += angleInc_q16;
+
+                if (angle_q6[cpos] < 0) angle_q6[cpos] += (360 << 6);
+                if (angle_q6[cpos] >= (360 << 6)) angle_q6[cpos] -= (360 << 6);
+
+
+                hqNode.flag = (syncBit[cpos] | ((!syncBit[cpos]) << 1));
+                hqNode.quality = dist_q2[cpos] ? (0x2F << RPLIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
+
+                hqNode.angle_z_q14 = (angle_q6[cpos] << 8) / 90;
+                hqNode.dist_mm_q2 = dist_q2[cpos];
+
+                timestamps[pos * 3 + cpos] = _cached_last_data_timestamp_us - _sample_delay_offsets_us[pos * 3 + cpos];
+            }
+
+        }
+
+        engine->publishHQNodes(hqNodes, timestamps, _countof(hqNodes));
+    }
+
+    _cached_previous_ultracapsuledata = capsule;
+    _is_previous_capsuledataRdy = true;
+    _cached_last_data_timestamp_us = currentTS;
+
+}
+
+template <class TEngine>
+void UnpackerHandler_DenseCapsuleNode::decodeData(TEngine* engine, const _u8* data, size_t cnt)
+{
+
+    for (size_t pos = 0; pos < cnt; ++pos) {
+        if (!_cached_scan_node_buf_pos && (data[pos] >> 4) != RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_1) {
+            pos = _skipToCapsuleSync(data, pos, cnt, _counters, _is_previous_capsuledataRdy);
+            if (pos == cnt) break;
+        }
+
+        _u8 current_data = data[pos];
+        switch (_cached_scan_node_buf_pos) {
+        case 0: // expect the sync bit 1
+        {
+            _u8 tmp = (current_data >> 4);
+            if (tmp == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_1) {
+                // pass
+            }
+            else {
+                DataUnpackerHandlerCounters::add(_counters.skipped_bytes);
+                if (_is_previous_capsuledataRdy) DataUnpackerHandlerCounters::add(_counters.capsule_discards);
+                _is_previous_capsuledataRdy = false;
+                continue;
+            }
+
+        }
+        break;
+        case 1: // expect the sync bit 2
+        {
+            _u8 tmp = (current_data >> 4);
+            if (tmp == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_2) {
+                // pass
+            }
+            else {
+                _cached_scan_node_buf_pos = 0;
+                DataUnpackerHandlerCounters::add(_counters.resyncs);
+                DataUnpackerHandlerCounters::add(_counters.skipped_bytes, 2);
+                if (_is_previous_capsuledataRdy) DataUnpackerHandlerCounters::add(_counters.capsule_discards);
+                _is_previous_capsuledataRdy = false;
+                continue;
+            }
+        }
+        break;
+
+        case sizeof(rplidar_response_dense_capsule_measurement_nodes_t) - 1: // new data ready
+        {
+            _cached_scan_node_buf[sizeof(rplidar_response_dense_capsule_measurement_nodes_t) - 1] = current_data;
+            _cached_scan_node_buf_pos = 0;
+
+            rplidar_response_dense_capsule_measurement_nodes_t* node = reinterpret_cast<rplidar_response_dense_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
+
+            // calc the checksum ...
+            _u8 checksum = 0;
+            _u8 recvChecksum = ((node->s_checksum_1 & 0xF) | (node->s_checksum_2 << 4));
+            for (size_t cpos = offsetof(rplidar_response_dense_capsule_measurement_nodes_t, start_angle_sync_q6);
+                cpos < sizeof(rplidar_response_dense_capsule_measurement_nodes_t); ++cpos)
+            {
+                checksum ^= _cached_scan_node_buf[cpos];
+            }
+
+            if (recvChecksum == checksum)
+            {
+                // only consider vaild if the checksum matches...
+                if (_deferred) {
+                    // left in the wire order for the decoding on the grab
+                    DataUnpackerHandlerCounters::add(_counters.packets);
+                    engine->publishDeferredPacket(RPLIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED, node, sizeof(*node)
+                        , _isDeferredRevolutionStart((le16_to_cpu(node->start_angle_sync_q6) & 0x7FFF) << 2));
+                    continue;
+                }
+
+                // perform data endianess convertion if necessary
+                convertSamplePacketToHost(*node);
+                if (node->start_angle_sync_q6 & RPLIDAR_RESP_MEASUREMENT_EXP_SYNCBIT)
+                {
+                    if (_is_previous_capsuledataRdy) {
+                        DataUnpackerHandlerCounters::add(_counters.encoder_resets);
+                        engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_ENCODER_RESET
+                            , RPLIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED, node, sizeof(*node));
+                    }
+                    // this is the first capsule frame in logic, discard the previous cached data...
+                    _is_previous_capsuledataRdy = false;
+                    engine->publishNewScanReset();
+
+
+                }
+                DataUnpackerHandlerCounters::add(_counters.packets);
+                _onScanNodeDenseCapsuleData(*node, engine);
+            }
+            else {
+                DataUnpackerHandlerCounters::add(_counters.checksum_errors);
+                if (_is_previous_capsuledataRdy) DataUnpackerHandlerCounters::add(_counters.capsule_discards);
+                _is_previous_capsuledataRdy = false;
+
+                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
+                    , RPLIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED, node, sizeof(*node));
+
+            }
+            continue;
+        }
+        break;
+
+        }
+        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
+    }
+}
+
+template <class TEngine>
+void UnpackerHandler_DenseCapsuleNode::_onScanNodeDenseCapsuleData(rplidar_response_dense_capsule_measurement_nodes_t& dense_capsule, TEngine* engine)
+{
+    static int lastNodeSyncBit = 0;
+    _u64 currentTs = engine->getCurrentTimestamp_uS();
+
+    if (_is_previous_capsuledataRdy) {
+        int diffAngle_q8;
+        int currentStartAngle_q8 = ((dense_capsule.start_angle_sync_q6 & 0x7FFF) << 2);
+        int prevStartAngle_q8 = ((_cached_previous_dense_capsuledata.start_angle_sync_q6 & 0x7FFF) << 2);
+
+        diffAngle_q8 = (currentStartAngle_q8)-(prevStartAngle_q8);
+        if (prevStartAngle_q8 > currentStartAngle_q8) {
+            diffAngle_q8 += (360 << 8);
+        }
+        int maxDiffAngleThreshold_q8 = (360/* 360 degree */ * 100 /*100Hz*/ * _countof(dense_capsule.cabins) /*40 points per capsule*/ / (1000000 / _cachedTimingDesc.sample_duration_uS)) << 8;
+        if (diffAngle_q8 > maxDiffAngleThreshold_q8) {//discard
+            DataUnpackerHandlerCounters::add(_counters.capsule_discards);
+            _cached_previous_dense_capsuledata = dense_capsule;
+            return;
+        }
+
+        // the samples of the cached capsule span up to the start of this one, none of them would carry the sync
+        if (!_scan_region.overlaps(prevStartAngle_q8, currentStartAngle_q8)) {
+            DataUnpackerHandlerCounters::add(_counters.region_skips);
+            lastNodeSyncBit = 0;
+            _cached_previous_dense_capsuledata = dense_capsule;
+            return;
+        }
+
+        int angleInc_q16 = (diffAngle_q8 << 8) / 40;
+        int currentAngle_raw_q16 = (prevStartAngle_q8 << 8);
+
+        rplidar_response_measurement_node_hq_t hqNodes[_countof(_cached_previous_dense_capsuledata.cabins)];
+        _u64 timestamps[_countof(hqNodes)];
+        const int sampleCount = (int)_countof(hqNodes);
+
+        // the angles do not depend on the previous samples, they are decoded in batch
+        _u32 angles_z_q14[_countof(hqNodes)];
+        _u32 rawSyncBits[_countof(hqNodes)];
+        decodeCapsuleSampleAngles(currentAngle_raw_q16, angleInc_q16, sampleCount, angles_z_q14, rawSyncBits);
+
+        for (int pos = 0; pos < sampleCount; ++pos)
+        {
+            int dist_q2;
+            int syncBit;
+            const int dist = static_cast<const int>(_cached_previous_dense_capsuledata.cabins[pos].distance);
+            dist_q2 = dist << 2;
+            syncBit = (int)rawSyncBits[pos];
+            syncBit = (syncBit ^ lastNodeSyncBit) & syncBit;//Ensure that syncBit is exactly detected
+
+            rplidar_response_measurement_node_hq_t& hqNode = hqNodes[pos];
+
+
+            hqNode.flag = (syncBit | ((!syncBit) << 1));
+            hqNode.quality = dist_q2 ? (0x2F << RPLIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
+            hqNode.angle_z_q14 = (_u16)angles_z_q14[pos];
+            hqNode.dist_mm_q2 = dist_q2;
+            timestamps[pos] = currentTs - _sample_delay_offsets_us[pos];
+            
+            lastNodeSyncBit = syncBit;
+
+        }
+
+        engine->publishHQNodes(hqNodes, timestamps, _countof(hqNodes));
+    }
+
+    _cached_previous_dense_capsuledata = dense_capsule;
+    _is_previous_capsuledataRdy = true;
+
+}
+
+template <class TEngine>
+void UnpackerHandler_UltraDenseCapsuleNode::decodeData(TEngine* engine, const _u8* data, size_t cnt)
+{
+    for (size_t pos = 0; pos < cnt; ++pos) {
+        if (!_cached_scan_node_buf_pos && (data[pos] >> 4) != RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_1) {
+            pos = _skipToCapsuleSync(data, pos, cnt, _counters, _is_previous_capsuledataRdy);
+            if (pos == cnt) break;
+        }
+
+        _u8 current_data = data[pos];
+        switch (_cached_scan_node_buf_pos) {
+        case 0: // expect the sync bit 1
+        {
+            _u8 tmp = (current_data >> 4);
+            if (tmp == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_1) {
+                // pass
+            }
+            else {
+                DataUnpackerHandlerCounters::add(_counters.skipped_bytes);
+                if (_is_previous_capsuledataRdy) DataUnpackerHandlerCounters::add(_counters.capsule_discards);
+                _is_previous_capsuledataRdy = false;
+                continue;
+            }
+
+        }
+        break;
+        case 1: // expect the sync bit 2
+        {
+            _u8 tmp = (current_data >> 4);
+            if (tmp == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_2) {
+                // pass
+            }
+            else {
+                _cached_scan_node_buf_pos = 0;
+                DataUnpackerHandlerCounters::add(_counters.resyncs);
+                DataUnpackerHandlerCounters::add(_counters.skipped_bytes, 2);
+                if (_is_previous_capsuledataRdy) DataUnpackerHandlerCounters::add(_counters.capsule_discards);
+                _is_previous_capsuledataRdy = false;
+                continue;
+            }
+        }
+        break;
+
+        case sizeof(rplidar_response_ultra_dense_capsule_measurement_nodes_t) - 1: // new data ready
+        {
+            _cached_scan_node_buf[sizeof(rplidar_response_ultra_dense_capsule_measurement_nodes_t) - 1] = current_data;
+            _cached_scan_node_buf_pos = 0;
+
+            rplidar_response_ultra_dense_capsule_measurement_nodes_t* node = reinterpret_cast<rplidar_response_ultra_dense_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
+
+            // calc the checksum ...
+            _u8 checksum = 0;
+            _u8 recvChecksum = ((node->s_checksum_1 & 0xF) | (node->s_checksum_2 << 4));
+            for (size_t cpos = offsetof(rplidar_response_ultra_dense_capsule_measurement_nodes_t, time_stamp);
+                cpos < sizeof(rplidar_response_ultra_dense_capsule_measurement_nodes_t); ++cpos)
+            {
+                checksum ^= _cached_scan_node_buf[cpos];
+            }
+
+            if (recvChecksum == checksum)
+            {
+                // only consider vaild if the checksum matches...
+                if (_deferred) {
+                    // left in the wire order for the decoding on the grab
+                    DataUnpackerHandlerCounters::add(_counters.packets);
+                    engine->publishDeferredPacket(RPLIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED, node, sizeof(*node)
+                        , _isDeferredRevolutionStart((le16_to_cpu(node->start_angle_sync_q6) & 0x7FFF) << 2));
+                    continue;
+                }
+
+                // perform data endianess convertion if necessary
+                convertSamplePacketToHost(*node);
+                if (node->start_angle_sync_q6 & RPLIDAR_RESP_MEASUREMENT_EXP_SYNCBIT)
+                {
+                    if (_is_previous_capsuledataRdy) {
+                        DataUnpackerHandlerCounters::add(_counters.encoder_resets);
+                        engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_ENCODER_RESET
+                            , RPLIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED, node, sizeof(*node));
+
+                    }
+                    // this is the first capsule frame in logic, discard the previous cached data...
+                    _is_previous_capsuledataRdy = false;
+                    engine->publishNewScanReset();
+
+                }
+                DataUnpackerHandlerCounters::add(_counters.packets);
+                _onScanNodeUltraDenseCapsuleData(*node, engine);
+            }
+            else {
+                DataUnpackerHandlerCounters::add(_counters.checksum_errors);
+                if (_is_previous_capsuledataRdy) DataUnpackerHandlerCounters::add(_counters.capsule_discards);
+                _is_previous_capsuledataRdy = false;
+
+                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
+                    , RPLIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED, node, sizeof(*node));
+
+            }
+            continue;
+        }
+        break;
+
+        }
+        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
+    }
+
+}
+
+template <class TEngine>
+void UnpackerHandler_UltraDenseCapsuleNode::_onScanNodeUltraDenseCapsuleData(rplidar_response_ultra_dense_capsule_measurement_nodes_t& capsule, TEngine* engine)
+{
+    _u64 currentTimestamp = engine->getCurrentTimestamp_uS();
+
+    const rplidar_response_ultra_dense_capsule_measurement_nodes_t* ultra_dense_capsule = reinterpret_cast<const rplidar_response_ultra_dense_capsule_measurement_nodes_t*>(&capsule);
+    if (_is_previous_capsuledataRdy) {
+        int diffAngle_q8;
+        int currentStartAngle_q8 = ((ultra_dense_capsule->start_angle_sync_q6 & 0x7FFF) << 2);
+        int prevStartAngle_q8 = ((_cached_previous_ultra_dense_capsuledata.start_angle_sync_q6 & 0x7FFF) << 2);
+
+
+
+        diffAngle_q8 = (currentStartAngle_q8)-(prevStartAngle_q8);
+        if (prevStartAngle_q8 > currentStartAngle_q8) {
+            diffAngle_q8 += (360 << 8);
+        }
+
+        int maxDiffAngleThreshold_q8 = (360/* 360 degree */ * 100 /*100Hz*/ * _countof(ultra_dense_capsule->cabins) /*64 points per capsule*/ / (1000000 / _cachedTimingDesc.sample_duration_uS)) << 8;
+        if (diffAngle_q8 > maxDiffAngleThreshold_q8) {//discard
+            DataUnpackerHandlerCounters::add(_counters.capsule_discards);
+            _cached_previous_ultra_dense_capsuledata = *ultra_dense_capsule;
+            return;
+        }
+
+        // the samples of the cached capsule span up to the start of this one, none of them would carry the sync;
+        // the distance smoothing restarts after the gap
+        if (!_scan_region.overlaps(prevStartAngle_q8, currentStartAngle_q8)) {
+            DataUnpackerHandlerCounters::add(_counters.region_skips);
+            _last_node_sync_bit = 0;
+            _last_dist_q2 = 0;
+            _cached_previous_ultra_dense_capsuledata = *ultra_dense_capsule;
+            return;
+        }
+#define DISTANCE_THRESHOLD_TO_SCALE_1 2046  // (2^10 - 1)*2 mm
+#define DISTANCE_THRESHOLD_TO_SCALE_2 8187  // (2^11 - 1)*3 + 2046 mm
+#define DISTANCE_THRESHOLD_TO_SCALE_3 24567 // (2^12 - 1)*4 + 8187 mm
+        int angleInc_q16 = (diffAngle_q8 << 8) / 64;
+        int currentAngle_raw_q16 = (prevStartAngle_q8 << 8);
+
+        rplidar_response_measurement_node_hq_t hqNodes[_countof(_cached_previous_ultra_dense_capsuledata.cabins) * 2];
+        _u64 timestamps[_countof(hqNodes)];
+        const int sampleCount = (int)_countof(hqNodes);
+
+        // the angles do not depend on the previous samples, they are decoded in batch
+        _u32 angles_z_q14[_countof(hqNodes)];
+        _u32 rawSyncBits[_countof(hqNodes)];
+        decodeCapsuleSampleAngles(currentAngle_raw_q16, angleInc_q16, sampleCount, angles_z_q14, rawSyncBits);
+
+        for (int pos = 0; pos < sampleCount; ++pos)
+        {
+            int syncBit;
+            size_t cabin_idx = pos >> 1;
+            _u32  quality_dist_scale;
+            if (!(pos & 0x1)) {
+                quality_dist_scale = _cached_previous_ultra_dense_capsuledata.cabins[cabin_idx].qualityl_distance_scale[0] | ((_cached_previous_ultra_dense_capsuledata.cabins[cabin_idx].qualityh_array & 0x0F) << 16);
+            }
+            else {
+                quality_dist_scale = _cached_previous_ultra_dense_capsuledata.cabins[cabin_idx].qualityl_distance_scale[1] | ((_cached_previous_ultra_dense_capsuledata.cabins[cabin_idx].qualityh_array >> 4) << 16);
+            }
+
+            _u8 scale = quality_dist_scale & 0x3;
+            _u8 quality = 0;
+            int dist_q2 = 0;
+
+            switch (scale) {
+            case 0:
+                quality = quality_dist_scale >> 12;
+                dist_q2 = (quality_dist_scale & 0xFFC) * 2;
+                if (_last_dist_q2) {
+                    if (abs(dist_q2 - _last_dist_q2) <= 8/*2mm *2*/) {
+                        dist_q2 = (dist_q2 + _last_dist_q2) >> 1;
+                    }
+                }
+                break;
+            case 1:
+                quality = (quality_dist_scale >> 13) << 1;
+                dist_q2 = (quality_dist_scale & 0x1FFC) * 3 + (DISTANCE_THRESHOLD_TO_SCALE_1 << 2);
+                break;
+            case 2:
+                quality = (quality_dist_scale >> 14) << 2;
+                dist_q2 = (quality_dist_scale & 0x3FFC) * 4 + (DISTANCE_THRESHOLD_TO_SCALE_2 << 2);
+                break;
+            case 3:
+                quality = (quality_dist_scale >> 15) << 3;
+                dist_q2 = (quality_dist_scale & 0x7FFC) * 5 + (DISTANCE_THRESHOLD_TO_SCALE_3 << 2);
+                break;
+            }
+            _last_dist_q2 = dist_q2;
+            syncBit = (int)rawSyncBits[pos];
+            syncBit = (syncBit ^ _last_node_sync_bit) & syncBit;//Ensure that syncBit is exactly detected
+
+
+            rplidar_response_measurement_node_hq_t& hqNode = hqNodes[pos];
+
+
+
+            hqNode.flag = (syncBit | ((!syncBit) << 1));
+            hqNode.quality = quality;
+            hqNode.angle_z_q14 = (_u16)angles_z_q14[pos];
+            hqNode.dist_mm_q2 = dist_q2;
+            timestamps[pos] = currentTimestamp - _sample_delay_offsets_us[pos];
+            
+            _last_node_sync_bit = syncBit;
+
+        }
+
+        engine->publishHQNodes(hqNodes, timestamps, _countof(hqNodes));
+    }
+
+    _cached_previous_ultra_dense_capsuledata = *ultra_dense_capsule;
+    _is_previous_capsuledataRdy = true;
+
+}
+
 }
 
 END_DATAUNPACKER_NS()
\ No newline at end of file
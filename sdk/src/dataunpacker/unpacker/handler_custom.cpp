@@ -0,0 +1,132 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+
+ /*
+  *  Sample Data Unpacker System
+  *  Custom Sample Handler Adapter
+  */
+
+  /*
+	* Redistribution and use in source and binary forms, with or without
+	* modification, are permitted provided that the following conditions are met:
+	*
+	* 1. Redistributions of source code must retain the above copyright notice,
+	*    this list of conditions and the following disclaimer.
+	*
+	* 2. Redistributions in binary form must reproduce the above copyright notice,
+	*    this list of conditions and the following disclaimer in the documentation
+	*    and/or other materials provided with the distribution.
+	*
+	* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+	* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	* PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+	* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+	* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+	* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+	* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+	* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+	* EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+	*
+	*/
+
+#include "../dataunnpacker_commondef.h"
+#include "../dataunpacker.h"
+#include "../dataunnpacker_internal.h"
+
+
+#include "handler_custom.h"
+
+BEGIN_DATAUNPACKER_NS()
+	
+namespace unpacker{
+
+
+UnpackerHandler_Custom::UnpackerHandler_Custom(_u8 ansType, ILidarSampleHandlerFactory* factory, ILidarSampleHandler* handler)
+    : _ansType(ansType)
+    , _factory(factory)
+    , _handler(handler)
+    , _engine(nullptr)
+    , _isPacketFailed(false)
+{
+
+}
+
+UnpackerHandler_Custom::~UnpackerHandler_Custom()
+{
+    _factory->releaseHandler(_handler);
+}
+
+_u8 UnpackerHandler_Custom::getSampleAnswerType() const
+{
+    return _ansType;
+}
+
+void UnpackerHandler_Custom::onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t size)
+{
+    // the packets of the custom types are always decoded, they are never deferred
+    _engine = engine;
+    _isPacketFailed = false;
+    _handler->onSampleData(*this, data, size);
+    _engine = nullptr;
+
+    if (!_isPacketFailed) {
+        DataUnpackerHandlerCounters::add(_counters.packets);
+    }
+}
+
+void UnpackerHandler_Custom::reset()
+{
+    _handler->reset();
+}
+
+void UnpackerHandler_Custom::onUnpackerContextSet(LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size)
+{
+    if (type == LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_LIDAR_TIMING) {
+        assert(size == sizeof(SlamtecLidarTimingDesc));
+        _handler->onSampleDurationChanged(reinterpret_cast<const SlamtecLidarTimingDesc*>(data)->sample_duration_uS);
+    }
+}
+
+sl_u64 UnpackerHandler_Custom::getPacketTimestamp_uS()
+{
+    return _engine ? _engine->getCurrentTimestamp_uS() : 0;
+}
+
+void UnpackerHandler_Custom::publishNodes(const sl_lidar_response_measurement_node_hq_t* nodes, const sl_u64* timestamps_uS, size_t count)
+{
+    if (!_engine) return;
+    _engine->publishHQNodes(nodes, timestamps_uS, count);
+}
+
+void UnpackerHandler_Custom::publishScanReset()
+{
+    if (!_engine) return;
+    _engine->publishNewScanReset();
+}
+
+void UnpackerHandler_Custom::publishCustomData(sl_u32 customCode, const void* payload, size_t size)
+{
+    if (!_engine) return;
+    _engine->publishCustomData(_ansType, customCode, payload, size);
+}
+
+void UnpackerHandler_Custom::publishDecodingError(const void* packet, size_t size)
+{
+    if (!_engine) return;
+    if (!_isPacketFailed) {
+        _isPacketFailed = true;
+        DataUnpackerHandlerCounters::add(_counters.checksum_errors);
+    }
+    _engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR, _ansType, packet, size);
+}
+
+}
+
+END_DATAUNPACKER_NS()
@@ -0,0 +1,77 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+
+ /*
+  *  Sample Data Unpacker System
+  *  Custom Sample Handler Adapter
+  */
+
+  /*
+	* Redistribution and use in source and binary forms, with or without
+	* modification, are permitted provided that the following conditions are met:
+	*
+	* 1. Redistributions of source code must retain the above copyright notice,
+	*    this list of conditions and the following disclaimer.
+	*
+	* 2. Redistributions in binary form must reproduce the above copyright notice,
+	*    this list of conditions and the following disclaimer in the documentation
+	*    and/or other materials provided with the distribution.
+	*
+	* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+	* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	* PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+	* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+	* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+	* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+	* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+	* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+	* EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+	*
+	*/
+
+#pragma once
+
+BEGIN_DATAUNPACKER_NS()
+	
+namespace unpacker{
+
+// hosts a handler of the application, see ILidarDriver::registerSampleHandler
+// the packets are handed over in place, and the handler publishes through this adapter while it decodes one
+class UnpackerHandler_Custom : public IDataUnpackerHandler, public ILidarSampleSink {
+public:
+	// the handler is released to the factory on the destruction
+	UnpackerHandler_Custom(_u8 ansType, ILidarSampleHandlerFactory* factory, ILidarSampleHandler* handler);
+	virtual ~UnpackerHandler_Custom();
+
+	virtual _u8 getSampleAnswerType() const;
+	virtual void onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t size);
+	virtual void reset();
+	virtual void onUnpackerContextSet(LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size);
+
+	// ILidarSampleSink
+	virtual sl_u64 getPacketTimestamp_uS();
+	virtual void publishNodes(const sl_lidar_response_measurement_node_hq_t* nodes, const sl_u64* timestamps_uS, size_t count);
+	virtual void publishScanReset();
+	virtual void publishCustomData(sl_u32 customCode, const void* payload, size_t size);
+	virtual void publishDecodingError(const void* packet, size_t size);
+
+protected:
+	_u8 _ansType;
+	ILidarSampleHandlerFactory* _factory;
+	ILidarSampleHandler* _handler;
+
+	// set during onData only
+	LIDARSampleDataUnpackerInner* _engine;
+	bool _isPacketFailed;
+};
+
+}
+
+END_DATAUNPACKER_NS()
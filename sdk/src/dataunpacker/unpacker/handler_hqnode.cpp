@@ -40,9 +40,7 @@
 #include "../dataunpacker.h"
 #include "../dataunnpacker_internal.h"
 
-#ifdef CONF_NO_BOOST_CRC_SUPPORT
 #include "sl_crc.h" 
-#endif
 
 #include "handler_hqnode.h"
 
@@ -50,6 +48,8 @@ BEGIN_DATAUNPACKER_NS()
 	
 namespace unpacker{
 
+#if SL_LIDAR_UNPACKER_WITH_HQNODE
+
 
 static _u64 _getSampleDelayOffsetInHQMode(const SlamtecLidarTimingDesc& timing)
 {
@@ -77,6 +77,7 @@ UnpackerHandler_HQNode::UnpackerHandler_HQNode()
 {
     _cached_scan_node_buf.resize(sizeof(rplidar_response_hq_capsule_measurement_nodes_t));
     memset(&_cachedTimingDesc, 0, sizeof(_cachedTimingDesc));
+    _sample_delay_offset_us = _getSampleDelayOffsetInHQMode(_cachedTimingDesc);
 }
 
 UnpackerHandler_HQNode::~UnpackerHandler_HQNode()
@@ -91,86 +92,7 @@ _u8 UnpackerHandler_HQNode::getSampleAnswerType() const
 
 void UnpackerHandler_HQNode::onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t cnt)
 {
-
-    for (size_t pos = 0; pos < cnt; ++pos)
-    {
-        _u8 current_data = data[pos];
-
-        switch (_cached_scan_node_buf_pos)
-        {
-        case 0: // expect the sync byte
-        {
-            if (current_data == RPLIDAR_RESP_MEASUREMENT_HQ_SYNC) {
-                // pass
-            }
-            else {
-                continue;
-            }
-        }
-        break;
-
-        case sizeof(rplidar_response_hq_capsule_measurement_nodes_t) - 1 - 4:    // get bytes to calculate crc ready
-        {
-           
-        }
-        break;
-
-        case sizeof(rplidar_response_hq_capsule_measurement_nodes_t) - 1: // new data ready
-        {
-            _cached_scan_node_buf[sizeof(rplidar_response_hq_capsule_measurement_nodes_t) - 1] = current_data;
-            _cached_scan_node_buf_pos = 0;
-            rplidar_response_hq_capsule_measurement_nodes_t* nodesData = reinterpret_cast<rplidar_response_hq_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
-
-#ifdef CONF_NO_BOOST_CRC_SUPPORT
-            _u32 crcCalc = crc32::getResult(&_cached_scan_node_buf[0], sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t) - 4);
-
-
-#else
-            // calculate crc with boost crc method
-            boost::crc_optimal<32, 0x04C11DB7, 0xFFFFFFFF, 0xFFFFFFFF, true, true> mycrc;
-            std::vector<_u8> crcInputData;
-            crcInputData.resize(sizeof(rplidar_response_hq_capsule_measurement_nodes_t) - 4);
-            memcpy(&crcInputData[0], nodesData, sizeof(rplidar_response_hq_capsule_measurement_nodes_t) - 4);
-            //supplement crcInputData to mutiples of 4
-            int leftBytes = 4 - (crcInputData.size() & 3);
-            for (int i = 0; i < leftBytes; i++)
-                crcInputData.push_back(0);
-            mycrc.process_bytes(&crcInputData[0], crcInputData.size());
-            _u32 crcCalc = mycrc.checksum();
-            
-#endif
-
-            _u32 recvCRC = nodesData->crc32;
-#ifdef _CPU_ENDIAN_BIG
-            recvCRC = le32_to_cpu(recvCRC);
-            nodesData->time_stamp = le64_to_cpu(nodesData->time_stamp);
-#endif
-            if (recvCRC == crcCalc)
-            {
-                for (size_t pos = 0; pos < _countof(nodesData->node_hq); ++pos)
-                {
-                    rplidar_response_measurement_node_hq_t hqNode = nodesData->node_hq[pos];
-#ifdef _CPU_ENDIAN_BIG
-                    hqNode.angle_z_q14 = le16_to_cpu(hqNode.angle_z_q14);
-                    hqNode.dist_mm_q2 = le32_to_cpu(hqNode.dist_mm_q2);
-#endif
-                    engine->publishHQNode(engine->getCurrentTimestamp_uS() - _getSampleDelayOffsetInHQMode(_cachedTimingDesc), &hqNode);
-                }
-            }
-            else  //crc check not passed 
-            {
-                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
-                    , RPLIDAR_ANS_TYPE_MEASUREMENT_HQ, nodesData, sizeof(*nodesData));
-            }
-            continue;
-        }
-        break;
-
-
-        }
-        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
-    }
-
+    decodeData(engine, data, cnt);
 }
 
 
@@ -179,13 +101,45 @@ void UnpackerHandler_HQNode::onUnpackerContextSet(LIDARSampleDataUnpacker::Unpac
     if (type == LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_LIDAR_TIMING) {
         assert(size == sizeof(_cachedTimingDesc));
         _cachedTimingDesc = *reinterpret_cast<const SlamtecLidarTimingDesc*>(data);
+        _sample_delay_offset_us = _getSampleDelayOffsetInHQMode(_cachedTimingDesc);
+    }
+    else if (type == LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_SCAN_REGION) {
+        assert(size == sizeof(LidarScanRegion));
+        _scan_region.set(*reinterpret_cast<const LidarScanRegion*>(data));
+    }
+}
+
+bool UnpackerHandler_HQNode::_hasSyncNode(const rplidar_response_measurement_node_hq_t* nodes, size_t count)
+{
+    for (size_t pos = 0; pos < count; ++pos) {
+        if (nodes[pos].flag & RPLIDAR_RESP_HQ_FLAG_SYNCBIT) return true;
     }
+    return false;
+}
+
+bool UnpackerHandler_HQNode::_isInScanRegion(const rplidar_response_measurement_node_hq_t* nodes, size_t count) const
+{
+    if (_hasSyncNode(nodes, count)) return true;
+
+    // q14 to q8 degree
+    int startAngle_q8 = (int)nodes[0].angle_z_q14 * 45 / 32;
+    int endAngle_q8 = (int)nodes[count - 1].angle_z_q14 * 45 / 32;
+    return _scan_region.overlaps(startAngle_q8, endAngle_q8);
+}
+
+bool UnpackerHandler_HQNode::getDeviceClockStats(LidarDeviceClockStats& stats) const
+{
+    _device_clock.getStats(stats);
+    return true;
 }
 
 void UnpackerHandler_HQNode::reset()
 {
     _cached_scan_node_buf_pos = 0;
+    _device_clock.reset();
 }
+
+#endif
 }
 
 
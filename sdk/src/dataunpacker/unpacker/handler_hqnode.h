@@ -38,6 +38,8 @@
 
 #pragma once
 
+#include "capsule_byteorder.h"
+
 BEGIN_DATAUNPACKER_NS()
 
 namespace unpacker {
@@ -51,13 +53,122 @@ namespace unpacker {
 		virtual void onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t size);
 		virtual void reset();
 		virtual void onUnpackerContextSet(LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size);
+		virtual bool getDeviceClockStats(LidarDeviceClockStats& stats) const;
+
+		// the decoding with the engine bound statically, onData forwards to it with the runtime engine
+		template <class TEngine>
+		void decodeData(TEngine* engine, const _u8* data, size_t size);
 
 	protected:
-		std::vector<_u8> _cached_scan_node_buf;
+		static bool _hasSyncNode(const rplidar_response_measurement_node_hq_t* nodes, size_t count);
+		// the packet spans from its first node to its last one
+		bool _isInScanRegion(const rplidar_response_measurement_node_hq_t* nodes, size_t count) const;
+
+		sdk_vector<_u8> _cached_scan_node_buf;
 		int              _cached_scan_node_buf_pos;
 		SlamtecLidarTimingDesc _cachedTimingDesc;
+		_u64             _sample_delay_offset_us;
+		DeviceClockEstimator _device_clock;
+		ScanRegionMask   _scan_region;
 	};
 
+
+// Decoding
+///////////////////////////////////////////////////////////////////////////////////
+
+template <class TEngine>
+void UnpackerHandler_HQNode::decodeData(TEngine* engine, const _u8* data, size_t cnt)
+{
+
+    for (size_t pos = 0; pos < cnt; ++pos)
+    {
+        _u8 current_data = data[pos];
+
+        switch (_cached_scan_node_buf_pos)
+        {
+        case 0: // expect the sync byte
+        {
+            if (current_data == RPLIDAR_RESP_MEASUREMENT_HQ_SYNC) {
+                // pass
+            }
+            else {
+                DataUnpackerHandlerCounters::add(_counters.skipped_bytes);
+                continue;
+            }
+        }
+        break;
+
+        case sizeof(rplidar_response_hq_capsule_measurement_nodes_t) - 1 - 4:    // get bytes to calculate crc ready
+        {
+           
+        }
+        break;
+
+        case sizeof(rplidar_response_hq_capsule_measurement_nodes_t) - 1: // new data ready
+        {
+            _cached_scan_node_buf[sizeof(rplidar_response_hq_capsule_measurement_nodes_t) - 1] = current_data;
+            _cached_scan_node_buf_pos = 0;
+            rplidar_response_hq_capsule_measurement_nodes_t* nodesData = reinterpret_cast<rplidar_response_hq_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
+
+            // the zero padding is applied inside the crc module, no extra copy is needed
+            _u32 crcCalc = crc32::getResult(&_cached_scan_node_buf[0], sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t) - 4);
+
+            // the packet is left in the wire order, it may be retained for the deferred decoding
+            _u32 recvCRC = le32_to_cpu(nodesData->crc32);
+            if (recvCRC == crcCalc)
+            {
+                DataUnpackerHandlerCounters::add(_counters.packets);
+                if (_deferred) {
+                    engine->publishDeferredPacket(RPLIDAR_ANS_TYPE_MEASUREMENT_HQ, nodesData, sizeof(*nodesData)
+                        , _hasSyncNode(nodesData->node_hq, _countof(nodesData->node_hq)));
+                    continue;
+                }
+
+                _u64 deviceTs = le64_to_cpu(nodesData->time_stamp);
+                rplidar_response_measurement_node_hq_t hqNodes[_countof(nodesData->node_hq)];
+                _u64 timestamps[_countof(hqNodes)];
+                _u64 sampleTs = engine->getCurrentTimestamp_uS() - _sample_delay_offset_us;
+
+                // the device timestamp is taken as the time of the last node, like the host estimation,
+                // the nodes before it are spaced by the sample duration
+                bool useDeviceClock = _cachedTimingDesc.native_timestamp_support && deviceTs
+                    && _device_clock.addPacket(deviceTs, sampleTs);
+                if (useDeviceClock) {
+                    sampleTs = _device_clock.toHost(deviceTs);
+                }
+
+                convertSamplePacketToHost(*nodesData);
+                if (!_isInScanRegion(nodesData->node_hq, _countof(nodesData->node_hq))) {
+                    DataUnpackerHandlerCounters::add(_counters.region_skips);
+                    continue;
+                }
+
+                memcpy(hqNodes, nodesData->node_hq, sizeof(hqNodes));
+                for (size_t pos = 0; pos < _countof(hqNodes); ++pos)
+                {
+                    timestamps[pos] = useDeviceClock
+                        ? sampleTs - (_countof(hqNodes) - 1 - pos) * _cachedTimingDesc.sample_duration_uS
+                        : sampleTs;
+                }
+                engine->publishHQNodes(hqNodes, timestamps, _countof(hqNodes));
+            }
+            else  //crc check not passed 
+            {
+                DataUnpackerHandlerCounters::add(_counters.checksum_errors);
+                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
+                    , RPLIDAR_ANS_TYPE_MEASUREMENT_HQ, nodesData, sizeof(*nodesData));
+            }
+            continue;
+        }
+        break;
+
+
+        }
+        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
+    }
+
+}
+
 }
 
 END_DATAUNPACKER_NS()
\ No newline at end of file
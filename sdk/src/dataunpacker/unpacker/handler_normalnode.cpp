@@ -47,6 +47,8 @@ BEGIN_DATAUNPACKER_NS()
 	
 namespace unpacker{
 
+#if SL_LIDAR_UNPACKER_WITH_NORMALNODE
+
 
 static _u64 _getSampleDelayOffsetInLegacyMode(const SlamtecLidarTimingDesc& timing)
 {
@@ -72,6 +74,7 @@ UnpackerHandler_NormalNode::UnpackerHandler_NormalNode()
 {
     _cached_scan_node_buf.resize(sizeof(rplidar_response_measurement_node_t));
     memset(&_cachedTimingDesc, 0, sizeof(_cachedTimingDesc));
+    _sample_delay_offset_us = _getSampleDelayOffsetInLegacyMode(_cachedTimingDesc);
 ;}
 
 UnpackerHandler_NormalNode::~UnpackerHandler_NormalNode()
@@ -86,58 +89,7 @@ _u8 UnpackerHandler_NormalNode::getSampleAnswerType() const
 
 void UnpackerHandler_NormalNode::onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t cnt)
 {
-    for (size_t pos = 0; pos < cnt; ++pos) {
-        _u8 current_data = data[pos];
-        switch (_cached_scan_node_buf_pos) {
-        case 0: // expect the sync bit and its reverse in this byte
-        {
-            _u8 tmp = (current_data >> 1);
-            if ((tmp ^ current_data) & 0x1) {
-                // pass
-            }
-            else {
-                continue;
-            }
-
-        }
-        break;
-        case 1: // expect the highest bit to be 1
-        {
-            if (current_data & RPLIDAR_RESP_MEASUREMENT_CHECKBIT) {
-                // pass
-            }
-            else {
-                _cached_scan_node_buf_pos = 0;
-                continue;
-            }
-        }
-        break;
-        case sizeof(rplidar_response_measurement_node_t) - 1: // new data ready
-        {
-            _cached_scan_node_buf[sizeof(rplidar_response_measurement_node_t) - 1] = current_data;
-            _cached_scan_node_buf_pos = 0;
-
-            rplidar_response_measurement_node_t* node = reinterpret_cast<rplidar_response_measurement_node_t*>(&_cached_scan_node_buf[0]);
-#ifdef _CPU_ENDIAN_BIG
-            node->angle_q6_checkbit = le16_to_cpu(node->angle_q6_checkbit);
-            node->distance_q2 = le16_to_cpu(node->distance_q2);
-#endif
-            //cast node to rplidar_response_measurement_node_hq_t
-            rplidar_response_measurement_node_hq_t hqNode;
-            hqNode.angle_z_q14 = (((node->angle_q6_checkbit) >> RPLIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) << 8) / 90;  //transfer to q14 Z-angle
-            hqNode.dist_mm_q2 = node->distance_q2;
-            hqNode.flag = (node->sync_quality & RPLIDAR_RESP_MEASUREMENT_SYNCBIT);  // trasfer syncbit to HQ flag field
-            hqNode.quality = (node->sync_quality >> RPLIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) << RPLIDAR_RESP_MEASUREMENT_QUALITY_SHIFT;  //remove the last two bits and then make quality from 0-63 to 0-255
-            
-            
-            engine->publishHQNode(engine->getCurrentTimestamp_uS() - _getSampleDelayOffsetInLegacyMode(_cachedTimingDesc), &hqNode);
-            continue;
-
-        }
-        break;
-        }
-        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
-    }
+    decodeData(engine, data, cnt);
 }
 
 
@@ -146,6 +98,7 @@ void UnpackerHandler_NormalNode::onUnpackerContextSet(LIDARSampleDataUnpacker::U
     if (type == LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_LIDAR_TIMING) {
         assert(size == sizeof(_cachedTimingDesc));
         _cachedTimingDesc = *reinterpret_cast<const SlamtecLidarTimingDesc*>(data);
+        _sample_delay_offset_us = _getSampleDelayOffsetInLegacyMode(_cachedTimingDesc);
     }
 }
 
@@ -153,6 +106,8 @@ void UnpackerHandler_NormalNode::reset()
 {
     _cached_scan_node_buf_pos = 0;
 }
+
+#endif
 }
 
 
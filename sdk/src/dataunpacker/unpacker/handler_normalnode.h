@@ -51,13 +51,83 @@ public:
 	virtual void onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t size);
 	virtual void reset();
 	virtual void onUnpackerContextSet(LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size);
+
+	// the decoding with the engine bound statically, onData forwards to it with the runtime engine
+	template <class TEngine>
+	void decodeData(TEngine* engine, const _u8* data, size_t size);
 protected:
-	std::vector<_u8> _cached_scan_node_buf;
+	sdk_vector<_u8> _cached_scan_node_buf;
 	int              _cached_scan_node_buf_pos;
 
 	SlamtecLidarTimingDesc _cachedTimingDesc;
+	_u64             _sample_delay_offset_us;
 };
 
+
+// Decoding
+///////////////////////////////////////////////////////////////////////////////////
+
+template <class TEngine>
+void UnpackerHandler_NormalNode::decodeData(TEngine* engine, const _u8* data, size_t cnt)
+{
+    for (size_t pos = 0; pos < cnt; ++pos) {
+        _u8 current_data = data[pos];
+        switch (_cached_scan_node_buf_pos) {
+        case 0: // expect the sync bit and its reverse in this byte
+        {
+            _u8 tmp = (current_data >> 1);
+            if ((tmp ^ current_data) & 0x1) {
+                // pass
+            }
+            else {
+                DataUnpackerHandlerCounters::add(_counters.skipped_bytes);
+                continue;
+            }
+
+        }
+        break;
+        case 1: // expect the highest bit to be 1
+        {
+            if (current_data & RPLIDAR_RESP_MEASUREMENT_CHECKBIT) {
+                // pass
+            }
+            else {
+                _cached_scan_node_buf_pos = 0;
+                DataUnpackerHandlerCounters::add(_counters.resyncs);
+                DataUnpackerHandlerCounters::add(_counters.skipped_bytes, 2);
+                continue;
+            }
+        }
+        break;
+        case sizeof(rplidar_response_measurement_node_t) - 1: // new data ready
+        {
+            _cached_scan_node_buf[sizeof(rplidar_response_measurement_node_t) - 1] = current_data;
+            _cached_scan_node_buf_pos = 0;
+
+            rplidar_response_measurement_node_t* node = reinterpret_cast<rplidar_response_measurement_node_t*>(&_cached_scan_node_buf[0]);
+            DataUnpackerHandlerCounters::add(_counters.packets);
+#ifdef _CPU_ENDIAN_BIG
+            node->angle_q6_checkbit = le16_to_cpu(node->angle_q6_checkbit);
+            node->distance_q2 = le16_to_cpu(node->distance_q2);
+#endif
+            //cast node to rplidar_response_measurement_node_hq_t
+            rplidar_response_measurement_node_hq_t hqNode;
+            hqNode.angle_z_q14 = (((node->angle_q6_checkbit) >> RPLIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) << 8) / 90;  //transfer to q14 Z-angle
+            hqNode.dist_mm_q2 = node->distance_q2;
+            hqNode.flag = (node->sync_quality & RPLIDAR_RESP_MEASUREMENT_SYNCBIT);  // trasfer syncbit to HQ flag field
+            hqNode.quality = (node->sync_quality >> RPLIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) << RPLIDAR_RESP_MEASUREMENT_QUALITY_SHIFT;  //remove the last two bits and then make quality from 0-63 to 0-255
+            
+            
+            engine->publishHQNode(engine->getCurrentTimestamp_uS() - _sample_delay_offset_us, &hqNode);
+            continue;
+
+        }
+        break;
+        }
+        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
+    }
+}
+
 }
 
 END_DATAUNPACKER_NS()
\ No newline at end of file
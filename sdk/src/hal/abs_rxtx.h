@@ -73,6 +73,18 @@ public:
     virtual void clearDTR() = 0;
     virtual void cancelOperation() {}
 
+    enum {
+        // bind() flag: ask the serial driver to deliver the received bytes without batching them
+        SERIAL_FLAG_LOW_LATENCY = 0x1,
+    };
+
+    // the low latency flag in effect, and the latency timer of the USB adapter in ms (-1 if it has none)
+    // false if they cannot be queried
+    virtual bool getLatencySettings(bool& lowLatency, int& latencyTimerMs) { return false; }
+
+    // the native file descriptor of the opened port, -1 if not available
+    virtual int getNativeHandle() { return -1; }
+
     virtual bool isOpened()
     {
         return _is_serial_opened;
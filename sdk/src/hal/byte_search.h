@@ -0,0 +1,105 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include "hal/types.h"
+
+#include <string.h>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RP_HAL_BYTE_SEARCH_NEON
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RP_HAL_BYTE_SEARCH_SSE2
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// The searches of the decoders resynchronizing on a corrupted stream, which skip the noise
+// up to the next sync pattern 16 bytes at a time.
+
+namespace rp{ namespace hal{
+
+// the first byte equal to value, end when there is none; the C library memchr is vectorized already
+static inline const _u8* findByte(const _u8* data, const _u8* end, _u8 value)
+{
+    if (data == end) return end;
+    const void* found = memchr(data, value, (size_t)(end - data));
+    return found ? reinterpret_cast<const _u8*>(found) : end;
+}
+
+#if defined(RP_HAL_BYTE_SEARCH_SSE2)
+static inline unsigned int _findFirstBit(unsigned int mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+// the first byte whose high nibble equals nibble, end when there is none
+static inline const _u8* findHighNibble(const _u8* data, const _u8* end, _u8 nibble)
+{
+#if defined(RP_HAL_BYTE_SEARCH_SSE2)
+    const __m128i mask = _mm_set1_epi8((char)0xF0);
+    const __m128i target = _mm_set1_epi8((char)(nibble << 4));
+    for (; end - data >= 16; data += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        int matched = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(bytes, mask), target));
+        if (matched) return data + _findFirstBit((unsigned int)matched);
+    }
+#elif defined(RP_HAL_BYTE_SEARCH_NEON)
+    const uint8x16_t mask = vdupq_n_u8(0xF0);
+    const uint8x16_t target = vdupq_n_u8((_u8)(nibble << 4));
+    for (; end - data >= 16; data += 16) {
+        uint8x16_t matched = vceqq_u8(vandq_u8(vld1q_u8(data), mask), target);
+        // 4 bits per byte, in the order of the bytes
+        uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matched), 4)), 0);
+        if (bits) return data + (__builtin_ctzll(bits) >> 2);
+    }
+#endif
+
+    for (; data != end; ++data) {
+        if ((*data >> 4) == nibble) return data;
+    }
+    return end;
+}
+
+}}
@@ -0,0 +1,75 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include <stddef.h>
+#include <new>
+
+// The hot fields written by the decoder thread and the ones written by the consumer threads
+// are kept on separate cache lines, so a grab does not invalidate what the producer reads
+// for each sample. Build with SL_CACHE_LINE_SIZE=0 to get the natural layout back.
+#ifndef SL_CACHE_LINE_SIZE
+#if defined(__APPLE__) && defined(__aarch64__)
+#define SL_CACHE_LINE_SIZE 128
+#else
+#define SL_CACHE_LINE_SIZE 64
+#endif
+#endif
+
+#if SL_CACHE_LINE_SIZE
+#define SL_CACHE_ALIGNED alignas(SL_CACHE_LINE_SIZE)
+#else
+#define SL_CACHE_ALIGNED
+#endif
+
+namespace rp { namespace hal {
+
+// For the operator new of the classes holding cache aligned fields:
+// before C++17 the global one only honours the alignment of max_align_t.
+// The block of the heap is kept in front of the aligned one.
+static inline void* allocCacheAligned(size_t size)
+{
+    const size_t alignment = SL_CACHE_LINE_SIZE ? SL_CACHE_LINE_SIZE : sizeof(void*);
+    void* block = ::operator new(size + alignment - 1 + sizeof(void*));
+    size_t aligned = ((size_t)block + sizeof(void*) + alignment - 1) & ~(alignment - 1);
+    ((void**)aligned)[-1] = block;
+    return (void*)aligned;
+}
+
+static inline void freeCacheAligned(void* ptr)
+{
+    if (ptr) ::operator delete(((void**)ptr)[-1]);
+}
+
+}}
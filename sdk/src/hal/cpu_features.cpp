@@ -0,0 +1,120 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "hal/cpu_features.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define RP_HAL_CPU_X86_BUILTIN
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define RP_HAL_CPU_X86_CPUID
+#elif defined(__aarch64__) && defined(__linux__) && !defined(__ARM_FEATURE_CRC32)
+#include <sys/auxv.h>
+#define RP_HAL_CPU_ARM_HWCAP
+// as in asm/hwcap.h
+#define RP_HAL_HWCAP_CRC32 (1 << 7)
+#endif
+
+namespace rp{ namespace hal{
+
+static _u32 _detectCpuFeatures()
+{
+    _u32 features = 0;
+#if defined(RP_HAL_CPU_X86_BUILTIN)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) features |= CPU_FEATURE_SSE2;
+    if (__builtin_cpu_supports("ssse3")) features |= CPU_FEATURE_SSSE3;
+    if (__builtin_cpu_supports("sse4.1")) features |= CPU_FEATURE_SSE4_1;
+    if (__builtin_cpu_supports("sse4.2")) features |= CPU_FEATURE_SSE4_2;
+    if (__builtin_cpu_supports("pclmul")) features |= CPU_FEATURE_PCLMUL;
+    if (__builtin_cpu_supports("avx2")) features |= CPU_FEATURE_AVX2;
+#elif defined(RP_HAL_CPU_X86_CPUID)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    if (info[3] & (1 << 26)) features |= CPU_FEATURE_SSE2;
+    if (info[2] & (1 << 9)) features |= CPU_FEATURE_SSSE3;
+    if (info[2] & (1 << 19)) features |= CPU_FEATURE_SSE4_1;
+    if (info[2] & (1 << 20)) features |= CPU_FEATURE_SSE4_2;
+    if (info[2] & (1 << 1)) features |= CPU_FEATURE_PCLMUL;
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) features |= CPU_FEATURE_AVX2;
+    }
+#elif defined(__aarch64__)
+    // NEON is part of the base of armv8-a, the CRC32 instructions are optional before armv8.1-a
+    features |= CPU_FEATURE_NEON;
+#if defined(__ARM_FEATURE_CRC32)
+    features |= CPU_FEATURE_ARM_CRC32;
+#elif defined(RP_HAL_CPU_ARM_HWCAP)
+    if (getauxval(AT_HWCAP) & RP_HAL_HWCAP_CRC32) features |= CPU_FEATURE_ARM_CRC32;
+#endif
+#endif
+    return features;
+}
+
+// constant initialized, the bindings may be constructed before the statics of this file
+static std::atomic<_u32> _cpuFeatureMask(~(_u32)0);
+static std::atomic<CpuKernelBinding*> _bindings(nullptr);
+
+_u32 getDetectedCpuFeatures()
+{
+    static const _u32 features = _detectCpuFeatures();
+    return features;
+}
+
+_u32 getCpuFeatures()
+{
+    return getDetectedCpuFeatures() & _cpuFeatureMask.load(std::memory_order_relaxed);
+}
+
+void setCpuFeatureMask(_u32 mask)
+{
+    _cpuFeatureMask.store(mask, std::memory_order_relaxed);
+
+    _u32 features = getCpuFeatures();
+    for (CpuKernelBinding* binding = _bindings.load(std::memory_order_acquire); binding; binding = binding->_next) {
+        binding->_bind(features);
+    }
+}
+
+CpuKernelBinding::CpuKernelBinding(bind_proc_t bind)
+    : _bind(bind)
+    , _next(_bindings.load(std::memory_order_relaxed))
+{
+    _bind(getCpuFeatures());
+    while (!_bindings.compare_exchange_weak(_next, this, std::memory_order_release, std::memory_order_relaxed)) {}
+}
+
+}}
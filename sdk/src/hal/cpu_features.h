@@ -0,0 +1,92 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include "hal/types.h"
+
+#include <atomic>
+
+namespace rp{ namespace hal{
+
+// the instruction set extensions the SIMD kernels of the SDK are built for
+enum CpuFeature {
+    CPU_FEATURE_SSE2      = 0x1,
+    CPU_FEATURE_SSSE3     = 0x2,
+    CPU_FEATURE_SSE4_1    = 0x4,
+    CPU_FEATURE_SSE4_2    = 0x8,
+    CPU_FEATURE_PCLMUL    = 0x10,
+    CPU_FEATURE_AVX2      = 0x20,
+
+    CPU_FEATURE_NEON      = 0x100,
+    CPU_FEATURE_ARM_CRC32 = 0x200,
+};
+
+// the features of the running cpu, detected on the first call
+_u32 getDetectedCpuFeatures();
+
+// the features the kernels are bound for: the detected ones within the mask of setCpuFeatureMask
+_u32 getCpuFeatures();
+
+static inline bool hasCpuFeatures(_u32 features, _u32 required)
+{
+    return (features & required) == required;
+}
+
+// limits the features the kernels are bound for and binds every kernel again, ~0 for all of them (the default)
+// and 0 for the scalar kernels; it is meant for the tests matching the kernels, not to be called while they run
+void setCpuFeatureMask(_u32 mask);
+
+// Binds a kernel family to the implementation fitting the cpu, bind is called with the features once the
+// binding is constructed and again on each setCpuFeatureMask. The binding is a static of the translation unit
+// of the family; the function pointer it sets is to be constant initialized with the scalar fallback, so that
+// the calls made during the static initialization of the others work as well:
+//
+//     static std::atomic<proc_t> _proc(_procScalar);
+//     static void _bindProc(_u32 features) { _proc.store(hasCpuFeatures(features, CPU_FEATURE_AVX2) ? _procAvx2 : _procScalar); }
+//     static CpuKernelBinding _procBinding(_bindProc);
+class CpuKernelBinding
+{
+public:
+    typedef void (*bind_proc_t)(_u32 features);
+
+    explicit CpuKernelBinding(bind_proc_t bind);
+
+private:
+    friend void setCpuFeatureMask(_u32 mask);
+
+    bind_proc_t       _bind;
+    CpuKernelBinding* _next;
+};
+
+}}
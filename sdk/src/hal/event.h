@@ -33,6 +33,25 @@
  */
 
 #pragma once
+
+// the event is a word in user space on Linux and on Windows 8 or later (_WIN32_WINNT >= 0x0602):
+// set() and wait() only enter the kernel when a waiter has to be parked or woken up
+#if defined(_WIN32)
+#if defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0602)
+#define RP_HAL_EVENT_WAIT_ON_ADDRESS
+#pragma comment(lib, "Synchronization.lib")
+#endif
+#elif defined(__linux__)
+#define RP_HAL_EVENT_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <limits.h>
+#endif
+
+#if defined(RP_HAL_EVENT_WAIT_ON_ADDRESS) || defined(RP_HAL_EVENT_FUTEX)
+#define RP_HAL_EVENT_USER_SPACE
+#endif
+
 namespace rp{ namespace hal{
 
 class Event
@@ -47,14 +66,19 @@ public:
     };
     
     Event(bool isAutoReset = true, bool isSignal = false)
-#ifdef _WIN32
+#if defined(RP_HAL_EVENT_USER_SPACE)
+        : _signalled(isSignal ? 1 : 0)
+        , _waiters(0)
+        , _isAutoReset(isAutoReset)
+#elif defined(_WIN32)
         : _event(NULL)
 #else
         : _is_signalled(isSignal)
         , _isAutoReset(isAutoReset)
 #endif
     {
-#ifdef _WIN32
+#if defined(RP_HAL_EVENT_USER_SPACE)
+#elif defined(_WIN32)
         _event = CreateEvent(NULL, isAutoReset?FALSE:TRUE, isSignal?TRUE:FALSE, NULL); 
 #else
         pthread_mutex_init(&_cond_locker, NULL);
@@ -78,7 +102,13 @@ public:
     void set( bool isSignal = true )
     {
         if (isSignal){
-#ifdef _WIN32
+#if defined(RP_HAL_EVENT_USER_SPACE)
+            // the waiter count is read after the flag is raised, a waiter going to sleep
+            // in between sees the flag in the kernel and returns at once
+            if (_exchange(&_signalled, 1) == 0 && _load(&_waiters) != 0) {
+                _wake(!_isAutoReset);
+            }
+#elif defined(_WIN32)
             SetEvent(_event);
 #else
             pthread_mutex_lock(&_cond_locker);
@@ -86,14 +116,18 @@ public:
             if ( _is_signalled == false )
             {
                 _is_signalled = true;
-                pthread_cond_signal(&_cond_var);
+                // a manual reset event releases all its waiters
+                if (_isAutoReset) pthread_cond_signal(&_cond_var);
+                else pthread_cond_broadcast(&_cond_var);
             }
             pthread_mutex_unlock(&_cond_locker);
 #endif
         }
         else
         {
-#ifdef _WIN32
+#if defined(RP_HAL_EVENT_USER_SPACE)
+            _exchange(&_signalled, 0);
+#elif defined(_WIN32)
             ResetEvent(_event);
 #else
             pthread_mutex_lock(&_cond_locker);
@@ -105,8 +139,25 @@ public:
     
     unsigned long wait( unsigned long timeout = 0xFFFFFFFF )
     {
-#ifdef _WIN32
-        switch (WaitForSingleObject(_event, timeout==0xFFFFFFF?INFINITE:(DWORD)timeout))
+#if defined(RP_HAL_EVENT_USER_SPACE)
+        if (_tryConsume()) return EVENT_OK;
+        if (timeout == 0) return EVENT_TIMEOUT;
+
+        _deadline_t deadline;
+        _setDeadline(deadline, timeout);
+
+        for (;;) {
+            _increment(&_waiters);
+            int parked = _park(deadline, timeout == 0xFFFFFFFF);
+            _decrement(&_waiters);
+
+            if (_tryConsume()) return EVENT_OK;
+            if (parked == PARK_TIMEOUT) return EVENT_TIMEOUT;
+            if (parked == PARK_FAILED) return EVENT_FAILED;
+            // woken up but another waiter took the signal, or a spurious wakeup
+        }
+#elif defined(_WIN32)
+        switch (WaitForSingleObject(_event, timeout==0xFFFFFFFF?INFINITE:(DWORD)timeout))
         {
         case WAIT_FAILED:
             return EVENT_FAILED;
@@ -185,7 +236,8 @@ protected:
 
     void release()
     {
-#ifdef _WIN32
+#if defined(RP_HAL_EVENT_USER_SPACE)
+#elif defined(_WIN32)
         CloseHandle(_event);
 #else
         pthread_mutex_destroy(&_cond_locker);
@@ -193,7 +245,112 @@ protected:
 #endif
     }
 
-#ifdef _WIN32
+#if defined(RP_HAL_EVENT_USER_SPACE)
+    enum
+    {
+        PARK_WOKEN = 0,
+        PARK_TIMEOUT = 1,
+        PARK_FAILED = 2,
+    };
+
+    bool _tryConsume()
+    {
+        if (_isAutoReset) {
+            return _compareExchange(&_signalled, 1, 0);
+        }
+        return _load(&_signalled) != 0;
+    }
+
+#if defined(RP_HAL_EVENT_FUTEX)
+    typedef int  _futex_word_t;
+    typedef timespec _deadline_t;
+
+    static _futex_word_t _load(volatile _futex_word_t* word) { return __atomic_load_n(word, __ATOMIC_SEQ_CST); }
+    static _futex_word_t _exchange(volatile _futex_word_t* word, _futex_word_t value) { return __atomic_exchange_n(word, value, __ATOMIC_SEQ_CST); }
+    static bool _compareExchange(volatile _futex_word_t* word, _futex_word_t expected, _futex_word_t value)
+    {
+        return __atomic_compare_exchange_n(word, &expected, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+    static void _increment(volatile _futex_word_t* word) { __atomic_add_fetch(word, 1, __ATOMIC_SEQ_CST); }
+    static void _decrement(volatile _futex_word_t* word) { __atomic_sub_fetch(word, 1, __ATOMIC_SEQ_CST); }
+
+    static void _setDeadline(_deadline_t& deadline, unsigned long timeout)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout / 1000;
+        deadline.tv_nsec += (timeout % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            ++deadline.tv_sec;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    int _park(const _deadline_t& deadline, bool infinite)
+    {
+        // WAIT_BITSET takes an absolute CLOCK_MONOTONIC deadline, the retries don't recompute it
+        long ans = syscall(SYS_futex, &_signalled, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG, 0,
+            infinite ? NULL : &deadline, NULL, FUTEX_BITSET_MATCH_ANY);
+        if (ans == 0) return PARK_WOKEN;
+        switch (errno) {
+        case EAGAIN:    // already signalled
+        case EINTR:
+            return PARK_WOKEN;
+        case ETIMEDOUT:
+            return PARK_TIMEOUT;
+        }
+        return PARK_FAILED;
+    }
+
+    void _wake(bool all)
+    {
+        syscall(SYS_futex, &_signalled, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, all ? INT_MAX : 1, NULL, NULL, 0);
+    }
+#else
+    typedef LONG _futex_word_t;
+    typedef ULONGLONG _deadline_t;
+
+    static _futex_word_t _load(volatile _futex_word_t* word) { return InterlockedCompareExchange(word, 0, 0); }
+    static _futex_word_t _exchange(volatile _futex_word_t* word, _futex_word_t value) { return InterlockedExchange(word, value); }
+    static bool _compareExchange(volatile _futex_word_t* word, _futex_word_t expected, _futex_word_t value)
+    {
+        return InterlockedCompareExchange(word, value, expected) == expected;
+    }
+    static void _increment(volatile _futex_word_t* word) { InterlockedIncrement(word); }
+    static void _decrement(volatile _futex_word_t* word) { InterlockedDecrement(word); }
+
+    static void _setDeadline(_deadline_t& deadline, unsigned long timeout)
+    {
+        deadline = GetTickCount64() + timeout;
+    }
+
+    int _park(const _deadline_t& deadline, bool infinite)
+    {
+        DWORD waitTime = INFINITE;
+        if (!infinite) {
+            ULONGLONG now = GetTickCount64();
+            if (now >= deadline) return PARK_TIMEOUT;
+            waitTime = (DWORD)(deadline - now);
+        }
+
+        _futex_word_t unsignalled = 0;
+        if (WaitOnAddress(&_signalled, &unsignalled, sizeof(unsignalled), waitTime)) return PARK_WOKEN;
+        return (GetLastError() == ERROR_TIMEOUT) ? PARK_TIMEOUT : PARK_FAILED;
+    }
+
+    void _wake(bool all)
+    {
+        if (all) {
+            WakeByAddressAll((PVOID)&_signalled);
+        } else {
+            WakeByAddressSingle((PVOID)&_signalled);
+        }
+    }
+#endif
+
+        volatile _futex_word_t _signalled;
+        volatile _futex_word_t _waiters;
+        bool                   _isAutoReset;
+#elif defined(_WIN32)
         HANDLE _event;
 #else
         pthread_cond_t         _cond_var;
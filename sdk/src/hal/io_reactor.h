@@ -0,0 +1,97 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include "hal/types.h"
+#include "hal/thread.h"
+
+namespace rp{ namespace hal{
+
+class IOReactorHandler
+{
+public:
+    virtual ~IOReactorHandler() {}
+
+    // invoked from one of the reactor threads when the handle becomes readable
+    // the callbacks of the same handle are serialized, return false to stop watching the handle
+    virtual bool onIOReadable() = 0;
+
+    // invoked instead of onIOReadable() when the reactor has received the data of the handle itself
+    // the data is only borrowed during the call, rxTimestamp_uS is its capture time (0 if unknown)
+    virtual bool onIOData(const void * data, size_t size, _u64 rxTimestamp_uS) = 0;
+};
+
+// A small pool of threads waiting on many handles at once, used to serve
+// the data reception of several channels without dedicated threads
+class IOReactor
+{
+public:
+    enum {
+        MAX_THREAD_COUNT = 16,
+    };
+
+    enum reactor_backend_t {
+        // the threads wait for the handles to become readable, the handlers read them
+        BACKEND_EPOLL = 0,
+        // the threads keep receive operations armed on an io_uring each, the data of the sockets
+        // is received into a shared buffer pool and handed to onIOData(), the other handles are polled
+        BACKEND_IO_URING = 1,
+        // the threads serve a completion port, several overlapped reads are kept outstanding on each handle
+        // and their data is handed to onIOData() (Windows)
+        BACKEND_IOCP = 2,
+        // the epoll counterpart on macOS, the threads wait for the handles to become readable
+        BACKEND_KQUEUE = 3,
+    };
+
+    // returns NULL if the backend is not available on the current platform or kernel
+    // threadConfig names, pins and schedules the working threads, NULL for the defaults
+    static IOReactor * CreateReactor(int threadCount = 1, reactor_backend_t backend = BACKEND_EPOLL, const Thread::config_t * threadConfig = NULL);
+    static void ReleaseReactor(IOReactor *);
+
+    virtual ~IOReactor() {}
+
+    virtual size_t getThreadCount() const = 0;
+    virtual reactor_backend_t getBackend() const = 0;
+
+    virtual u_result addHandle(int handle, IOReactorHandler * handler) = 0;
+
+    // once returned, the handler of the given handle will never be invoked again
+    // must NOT be called inside the callback of the same handler
+    virtual void removeHandle(int handle) = 0;
+
+protected:
+    IOReactor() {}
+};
+
+}}
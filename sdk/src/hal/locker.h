@@ -45,7 +45,18 @@ public:
         LOCK_FAILED = 0
     };
 
-    Locker(bool recusive = false){
+    enum
+    {
+        // the trylock rounds of an adaptive locker before parking, the pause between them doubles up to the cap
+        ADAPTIVE_SPIN_ROUNDS = 10,
+        ADAPTIVE_MAX_PAUSES = 32,
+    };
+
+    // an adaptive locker spins a few microseconds on a contended lock before parking in the kernel,
+    // meant for the tiny critical sections of the data path (e.g. a node push), ignored on win32
+    Locker(bool recusive = false, bool adaptive = false)
+        : _adaptive(adaptive)
+    {
 #ifdef _WIN32
         _lock = NULL;
 #endif
@@ -59,8 +70,19 @@ public:
 
     Locker::LOCK_STATUS lock(unsigned long timeout = 0xFFFFFFFF)
     {
+#ifndef _WIN32
+        if (_adaptive && timeout != 0) {
+            int pauses = 1;
+            for (int round = 0; round < ADAPTIVE_SPIN_ROUNDS; ++round) {
+                if (pthread_mutex_trylock(&_lock) == 0) return LOCK_OK;
+                for (int pos = 0; pos < pauses; ++pos) _cpuRelax();
+                if (pauses < ADAPTIVE_MAX_PAUSES) pauses <<= 1;
+            }
+        }
+#endif
+
 #ifdef _WIN32
-        switch (WaitForSingleObject(_lock, timeout==0xFFFFFFF?INFINITE:(DWORD)timeout))
+        switch (WaitForSingleObject(_lock, timeout==0xFFFFFFFF?INFINITE:(DWORD)timeout))
         {
         case WAIT_ABANDONED:
             return LOCK_FAILED;
@@ -142,6 +164,19 @@ public:
 
 
 protected:
+    static inline void _cpuRelax()
+    {
+#if defined(_WIN32)
+        YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_ARCH) && (__ARM_ARCH >= 7))
+        __asm__ __volatile__("yield" ::: "memory");
+#else
+        __asm__ __volatile__("" ::: "memory");
+#endif
+    }
+
     void    init(bool recusive)
     {
         
@@ -182,6 +217,7 @@ protected:
 #else
     pthread_mutex_t _lock;
 #endif
+    bool _adaptive;
     
 };
 
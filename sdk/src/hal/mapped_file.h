@@ -0,0 +1,132 @@
+/*
+ *  RPLIDAR SDK
+ *
+ *  Copyright (c) 2009 - 2014 RoboPeak Team
+ *  http://www.robopeak.com
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+/*
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, 
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+namespace rp{ namespace hal{
+
+// Read-only mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile()
+        : _data(NULL)
+        , _size(0)
+#ifdef _WIN32
+        , _fileHandle(INVALID_HANDLE_VALUE)
+        , _mappingHandle(NULL)
+#endif
+    {
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    // an empty file cannot be mapped and fails to open
+    bool open(const char* path, bool sequential = false)
+    {
+        close();
+#ifdef _WIN32
+        _fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | (sequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0), NULL);
+        if (_fileHandle == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(_fileHandle, &fileSize) && fileSize.QuadPart > 0) {
+            _mappingHandle = CreateFileMapping(_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (_mappingHandle) {
+                _data = reinterpret_cast<const _u8*>(MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+                _size = (size_t)fileSize.QuadPart;
+            }
+        }
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+            void* mapped = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                if (sequential) madvise(mapped, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+                _data = reinterpret_cast<const _u8*>(mapped);
+                _size = (size_t)fileStat.st_size;
+            }
+        }
+        ::close(fd);
+#endif
+        if (!_data) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (_data) UnmapViewOfFile(_data);
+        if (_mappingHandle) CloseHandle(_mappingHandle);
+        if (_fileHandle != INVALID_HANDLE_VALUE) CloseHandle(_fileHandle);
+        _mappingHandle = NULL;
+        _fileHandle = INVALID_HANDLE_VALUE;
+#else
+        if (_data) munmap(const_cast<_u8*>(_data), _size);
+#endif
+        _data = NULL;
+        _size = 0;
+    }
+
+    bool isOpened() const { return _data != NULL; }
+    const _u8* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const _u8* _data;
+    size_t _size;
+#ifdef _WIN32
+    HANDLE _fileHandle;
+    HANDLE _mappingHandle;
+#endif
+};
+
+}}
@@ -0,0 +1,159 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include "hal/locker.h"
+
+// the handle is an eventfd on Linux, the read end of a pipe on macOS and a manual reset event on Windows
+#if defined(_WIN32)
+#elif defined(__linux__)
+#define RP_HAL_NOTIFIER_EVENTFD
+#include <sys/eventfd.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace rp{ namespace hal{
+
+// A level triggered flag other threads can wait on through the handle of the OS,
+// along with their other handles in poll(), epoll, kqueue or WaitForMultipleObjects.
+// The handle is readable while the flag is set; it is owned by the notifier and must
+// only be waited on, never read, written or closed.
+class Notifier
+{
+public:
+#if defined(_WIN32)
+    typedef HANDLE handle_t;
+#else
+    typedef int handle_t;
+#endif
+
+    Notifier()
+        : _signalled(false)
+    {
+#if defined(_WIN32)
+        _event = CreateEvent(NULL, TRUE, FALSE, NULL);
+#elif defined(RP_HAL_NOTIFIER_EVENTFD)
+        _fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+        _pipe[0] = _pipe[1] = -1;
+        if (pipe(_pipe) == 0) {
+            for (int pos = 0; pos < 2; ++pos) {
+                fcntl(_pipe[pos], F_SETFL, fcntl(_pipe[pos], F_GETFL) | O_NONBLOCK);
+                fcntl(_pipe[pos], F_SETFD, FD_CLOEXEC);
+            }
+        }
+#endif
+    }
+
+    ~Notifier()
+    {
+#if defined(_WIN32)
+        if (_event) CloseHandle(_event);
+#elif defined(RP_HAL_NOTIFIER_EVENTFD)
+        if (_fd >= 0) close(_fd);
+#else
+        if (_pipe[0] >= 0) close(_pipe[0]);
+        if (_pipe[1] >= 0) close(_pipe[1]);
+#endif
+    }
+
+    bool isValid() const
+    {
+#if defined(_WIN32)
+        return _event != NULL;
+#elif defined(RP_HAL_NOTIFIER_EVENTFD)
+        return _fd >= 0;
+#else
+        return _pipe[0] >= 0;
+#endif
+    }
+
+    handle_t getHandle() const
+    {
+#if defined(_WIN32)
+        return _event;
+#elif defined(RP_HAL_NOTIFIER_EVENTFD)
+        return _fd;
+#else
+        return _pipe[0];
+#endif
+    }
+
+    // only enters the kernel when the flag changes
+    void set(bool isSignal = true)
+    {
+        AutoLocker l(_locker);
+        if (_signalled == isSignal) return;
+        _signalled = isSignal;
+
+#if defined(_WIN32)
+        if (isSignal) SetEvent(_event); else ResetEvent(_event);
+#elif defined(RP_HAL_NOTIFIER_EVENTFD)
+        _u64 value = 1;
+        if (isSignal) {
+            if (write(_fd, &value, sizeof(value))) {}
+        } else {
+            if (read(_fd, &value, sizeof(value))) {}
+        }
+#else
+        _u8 value = 1;
+        if (isSignal) {
+            if (write(_pipe[1], &value, sizeof(value))) {}
+        } else {
+            if (read(_pipe[0], &value, sizeof(value))) {}
+        }
+#endif
+    }
+
+    void clear()
+    {
+        set(false);
+    }
+
+protected:
+    Locker _locker;
+    bool   _signalled;
+#if defined(_WIN32)
+    HANDLE _event;
+#elif defined(RP_HAL_NOTIFIER_EVENTFD)
+    int    _fd;
+#else
+    int    _pipe[2];
+#endif
+};
+
+}}
@@ -0,0 +1,90 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "hal/realtime.h"
+
+#include <string.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#endif
+
+namespace rp{ namespace hal{
+
+enum {
+    PREFAULT_PAGE_SIZE = 4096,      // the smallest page of the supported platforms
+    PREFAULT_STACK_CHUNK = 4096,
+};
+
+void prefaultMemory(void* ptr, size_t size)
+{
+    volatile _u8* bytes = (volatile _u8*)ptr;
+    for (size_t pos = 0; pos < size; pos += PREFAULT_PAGE_SIZE) {
+        bytes[pos] = bytes[pos];
+    }
+    if (size) bytes[size - 1] = bytes[size - 1];
+}
+
+// a frame of its own for each chunk, the chunk is read back after the recursion so it is not a tail call
+static _u8 _touchStackChunks(size_t remaining)
+{
+    volatile _u8 chunk[PREFAULT_STACK_CHUNK];
+    memset((void*)chunk, 0, sizeof(chunk));
+    if (remaining > sizeof(chunk)) chunk[0] = _touchStackChunks(remaining - sizeof(chunk));
+    return chunk[0];
+}
+
+void prefaultStack(size_t size)
+{
+    if (size) _touchStackChunks(size);
+}
+
+u_result lockProcessMemory()
+{
+#if defined(__linux__)
+#if defined(__GLIBC__)
+    // the trimmed or unmapped heap pages would fault again once reused
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+#endif
+    if (mlockall(MCL_CURRENT | MCL_FUTURE)) return RESULT_OPERATION_FAIL;
+    return RESULT_OK;
+#else
+    return RESULT_OPERATION_NOT_SUPPORT;
+#endif
+}
+
+}}
@@ -0,0 +1,171 @@
+/*
+ *  RPLIDAR SDK
+ *
+ *  Copyright (c) 2009 - 2014 RoboPeak Team
+ *  http://www.robopeak.com
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+/*
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, 
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <string>
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+namespace rp{ namespace hal{
+
+// Read-write mapping of a named shared memory segment, visible to the other processes of the host
+class SharedMemory
+{
+public:
+    SharedMemory()
+        : _data(NULL)
+        , _size(0)
+        , _isOwner(false)
+#ifdef _WIN32
+        , _mappingHandle(NULL)
+#endif
+    {
+    }
+
+    ~SharedMemory()
+    {
+        close();
+    }
+
+    // creates the segment, or replaces an older one of the same name; it is removed when closed
+    bool create(const char* name, size_t size)
+    {
+        close();
+        std::string segmentName = _toSegmentName(name);
+#ifdef _WIN32
+        _mappingHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+            (DWORD)((unsigned long long)size >> 32), (DWORD)size, segmentName.c_str());
+        if (!_mappingHandle) return false;
+        _data = reinterpret_cast<_u8*>(MapViewOfFile(_mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, size));
+#else
+        shm_unlink(segmentName.c_str());
+        int fd = shm_open(segmentName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) return false;
+
+        if (ftruncate(fd, (off_t)size) == 0) {
+            void* mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (mapped != MAP_FAILED) _data = reinterpret_cast<_u8*>(mapped);
+        }
+        ::close(fd);
+        if (!_data) shm_unlink(segmentName.c_str());
+#endif
+        if (!_data) {
+            close();
+            return false;
+        }
+        _size = size;
+        _isOwner = true;
+        _name = segmentName;
+        return true;
+    }
+
+    // maps an existing segment as a whole, read only
+    bool open(const char* name)
+    {
+        close();
+        std::string segmentName = _toSegmentName(name);
+#ifdef _WIN32
+        _mappingHandle = OpenFileMappingA(FILE_MAP_READ, FALSE, segmentName.c_str());
+        if (!_mappingHandle) return false;
+        _data = reinterpret_cast<_u8*>(MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        MEMORY_BASIC_INFORMATION info;
+        if (_data && VirtualQuery(_data, &info, sizeof(info))) _size = info.RegionSize;
+#else
+        int fd = shm_open(segmentName.c_str(), O_RDONLY, 0);
+        if (fd < 0) return false;
+
+        struct stat segmentStat;
+        if (fstat(fd, &segmentStat) == 0 && segmentStat.st_size > 0) {
+            void* mapped = mmap(NULL, (size_t)segmentStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapped != MAP_FAILED) {
+                _data = reinterpret_cast<_u8*>(mapped);
+                _size = (size_t)segmentStat.st_size;
+            }
+        }
+        ::close(fd);
+#endif
+        if (!_data || !_size) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // the mappings of the other processes stay valid after the owner has closed the segment
+    void close()
+    {
+#ifdef _WIN32
+        if (_data) UnmapViewOfFile(_data);
+        if (_mappingHandle) CloseHandle(_mappingHandle);
+        _mappingHandle = NULL;
+#else
+        if (_data) munmap(_data, _size);
+        if (_isOwner) shm_unlink(_name.c_str());
+#endif
+        _data = NULL;
+        _size = 0;
+        _isOwner = false;
+        _name.clear();
+    }
+
+    bool isOpened() const { return _data != NULL; }
+    _u8* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    SharedMemory(const SharedMemory&);
+    SharedMemory& operator=(const SharedMemory&);
+
+    static std::string _toSegmentName(const char* name)
+    {
+#ifdef _WIN32
+        return std::string("Local\\") + name;
+#else
+        // POSIX names start with a single slash
+        return (name[0] == '/') ? std::string(name) : std::string("/") + name;
+#endif
+    }
+
+    _u8* _data;
+    size_t _size;
+    bool _isOwner;
+    std::string _name;
+#ifdef _WIN32
+    HANDLE _mappingHandle;
+#endif
+};
+
+}}
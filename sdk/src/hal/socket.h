@@ -90,6 +90,20 @@ public:
 
     virtual u_result waitforSent(_u32 timeout  = DEFAULT_SOCKET_TIMEOUT) = 0;
     virtual u_result waitforData(_u32 timeout  = DEFAULT_SOCKET_TIMEOUT)  = 0;
+
+    // wakes up the waitforData() calls, which return RESULT_OPERATION_TIMEOUT from then on until the socket is disposed
+    // (not supported on Windows, where the waits last until their timeout)
+    virtual void cancelWaits() {}
+
+    // sets the kernel receive buffer (SO_RCVBUF) in bytes, the system may round or cap the value
+    virtual u_result setRxBufferSize(size_t size) { return RESULT_OPERATION_NOT_SUPPORT; }
+
+    // stamps the received data with the time the kernel captured it (SO_TIMESTAMPING on Linux),
+    // which recvTimestamped() and recvBatch() hand over in the getus() time base
+    virtual u_result enableRxTimestamp(bool enable = true) { return RESULT_OPERATION_NOT_SUPPORT; }
+
+    // the native file descriptor of the socket, -1 if not available
+    virtual int getNativeHandle() { return -1; }
 protected:
     SocketBase() {} 
 };
@@ -114,6 +128,13 @@ public:
     virtual u_result send(const void * buffer, size_t len) = 0;
     
     virtual u_result recv(void *buf, size_t len, size_t & recv_len) = 0;
+
+    // as recv(), rxTimestamp_uS receives the capture time of the latest segment read, 0 if unknown
+    virtual u_result recvTimestamped(void *buf, size_t len, size_t & recv_len, _u64 & rxTimestamp_uS)
+    {
+        rxTimestamp_uS = 0;
+        return recv(buf, len, recv_len);
+    }
     
     virtual u_result getPeerAddress(SocketAddress & ) = 0;
 
@@ -123,6 +144,9 @@ public:
     
     virtual u_result enableNoDelay(bool enable = true) = 0;
 
+    // the count of the received bytes waiting to be read (FIONREAD)
+    virtual u_result getRxQueueSize(size_t & size) { return RESULT_OPERATION_NOT_SUPPORT; }
+
 protected:
     virtual ~StreamSocket() {} // use dispose();
     StreamSocket() {}
@@ -139,6 +163,25 @@ public:
     virtual u_result sendTo(const SocketAddress * target, const void * buffer, size_t len) = 0;
     virtual u_result recvFrom(void *buf, size_t len, size_t & recv_len, SocketAddress * sourceAddr = NULL) = 0;
     virtual u_result clearRxCache() = 0;
+
+    // receives the pending datagrams without blocking, at most count of them: datagram i lands at slab + i*slotSize
+    // and its length in sizes[i], longer datagrams are truncated to slotSize
+    // timestamps_uS (optional) receives the capture time of each datagram, 0 if unknown
+    // sourceAddrs (optional) receives the sender of each datagram
+    // returns RESULT_OPERATION_TIMEOUT if none is pending
+    virtual u_result recvBatch(_u8 * slab, size_t slotSize, size_t * sizes, _u64 * timestamps_uS, size_t count, size_t & received, SocketAddress * sourceAddrs = NULL) { return RESULT_OPERATION_NOT_SUPPORT; }
+
+    // allows sending to the broadcast addresses
+    virtual u_result enableBroadcast(bool enable = true) { return RESULT_OPERATION_NOT_SUPPORT; }
+
+    // lets the other sockets of the host bind the same port, e.g. several receivers of a multicast group; call it before bind()
+    virtual u_result enableAddressReuse(bool enable = true) { return RESULT_OPERATION_NOT_SUPPORT; }
+
+    // joins an IPv4 multicast group on the local interface of the given address, or the default one if NULL
+    virtual u_result joinMulticastGroup(const SocketAddress & group, const SocketAddress * localInterface = NULL) { return RESULT_OPERATION_NOT_SUPPORT; }
+
+    // the TTL and the outgoing interface of the multicast datagrams sent, and whether the local host receives them too
+    virtual u_result setMulticastOptions(int ttl, bool loopback, const SocketAddress * localInterface = NULL) { return RESULT_OPERATION_NOT_SUPPORT; }
     
 protected:
     virtual ~DGramSocket() {} // use dispose();
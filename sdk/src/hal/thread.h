@@ -52,6 +52,22 @@ public:
 		PRIORITY_IDLE     = 4,
 	};
 
+    enum sched_policy_t
+    {
+        SCHED_POLICY_DEFAULT = 0,   // the priority class given to SetSelfConfig
+        SCHED_POLICY_OTHER   = 1,   // time sharing, the priority is the nice value
+        SCHED_POLICY_FIFO    = 2,
+        SCHED_POLICY_RR      = 3,
+    };
+
+    struct config_t
+    {
+        const char*    name;        // NULL for the default name
+        _u64           cpuMask;     // bit n allows cpu n, 0 keeps the inherited affinity
+        sched_policy_t policy;
+        int            priority;    // the real time priority for FIFO and RR, the nice value for OTHER
+    };
+
     template <class T, u_result (T::*PROC)(void)>
     static Thread create_member(T * pthis)
     {
@@ -81,6 +97,9 @@ public:
 
     static u_result SetSelfPriority(priority_val_t p);
 
+    // names, pins and schedules the calling thread, all the settings are tried even if one of them fails
+    static u_result SetSelfConfig(const config_t& config, const char* defaultName, priority_val_t defaultPriority);
+
 
     bool operator== ( const Thread & right) { return this->_handle == right._handle; }
 protected:
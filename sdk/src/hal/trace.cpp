@@ -0,0 +1,68 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/trace.h"
+
+namespace rp{ namespace hal{
+
+std::atomic<ITraceBackend*> Trace::_backend(NULL);
+std::atomic<_u32>           Trace::_categoryMask((_u32)TRACE_CATEGORY_ALL);
+
+void Trace::SetBackend(ITraceBackend* backend)
+{
+    _backend.store(backend, std::memory_order_release);
+}
+
+void Trace::SetCategoryMask(_u32 mask)
+{
+    _categoryMask.store(mask, std::memory_order_relaxed);
+}
+
+const char* Trace::GetCategoryName(TraceCategory category)
+{
+    switch (category) {
+    case TRACE_CATEGORY_RX:
+        return "sl.rx";
+    case TRACE_CATEGORY_DECODE:
+        return "sl.decode";
+    case TRACE_CATEGORY_SCAN:
+        return "sl.scan";
+    case TRACE_CATEGORY_CMD:
+        return "sl.cmd";
+    default:
+        return "sl";
+    }
+}
+
+}}
@@ -0,0 +1,147 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include "hal/types.h"
+#include <atomic>
+
+// Event tracing of the sdk internals, to be shown next to the spans of the application in a timeline.
+// The events are only compiled in with SL_LIDAR_TRACING defined, otherwise the macros expand to nothing
+// and their arguments are not evaluated. At runtime, nothing is emitted until a backend is set.
+//
+//   SL_TRACE_INSTANT(rp::hal::TRACE_CATEGORY_RX, "rx_read", size);
+//   SL_TRACE_SCOPE(rp::hal::TRACE_CATEGORY_CMD, "disable_data_grabbing");
+
+namespace rp{ namespace hal{
+
+enum TraceCategory
+{
+    TRACE_CATEGORY_RX     = 0x1L << 0, // channel reads
+    TRACE_CATEGORY_DECODE = 0x1L << 1, // decoder wakeups
+    TRACE_CATEGORY_SCAN   = 0x1L << 2, // scan boundaries
+    TRACE_CATEGORY_CMD    = 0x1L << 3, // commands and responses
+    TRACE_CATEGORY_ALL    = 0xFFFFFFFF,
+};
+
+// Receives the trace events, e.g. to forward them into Perfetto or LTTng.
+// It is called on the thread producing the event, so it must be thread safe and should not block.
+// The category and name strings are literals, they stay valid forever.
+class ITraceBackend
+{
+public:
+    virtual ~ITraceBackend() {}
+
+    virtual void onTraceInstant(const char* category, const char* name, _u64 timestamp_uS, _s64 value) = 0;
+    virtual void onTraceSliceBegin(const char* category, const char* name, _u64 timestamp_uS) = 0;
+    virtual void onTraceSliceEnd(const char* category, const char* name, _u64 timestamp_uS) = 0;
+};
+
+class Trace
+{
+public:
+    // NULL to stop tracing, the previous backend may still be called by the events in flight
+    static void SetBackend(ITraceBackend* backend);
+
+    // the categories to be emitted, all by default
+    static void SetCategoryMask(_u32 mask);
+
+    static const char* GetCategoryName(TraceCategory category);
+
+    // returns the backend if the category is to be emitted, NULL otherwise
+    static ITraceBackend* GetActiveBackend(TraceCategory category)
+    {
+        if (!(_categoryMask.load(std::memory_order_relaxed) & (_u32)category)) return NULL;
+        return _backend.load(std::memory_order_acquire);
+    }
+
+protected:
+    static std::atomic<ITraceBackend*> _backend;
+    static std::atomic<_u32>           _categoryMask;
+};
+
+// emits a slice covering the lifetime of the object
+class TraceScope
+{
+public:
+    TraceScope(TraceCategory category, const char* name)
+        : _backend(Trace::GetActiveBackend(category))
+        , _category(category)
+        , _name(name)
+    {
+        if (_backend) {
+            _backend->onTraceSliceBegin(Trace::GetCategoryName(_category), _name, getus());
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (_backend) {
+            _backend->onTraceSliceEnd(Trace::GetCategoryName(_category), _name, getus());
+        }
+    }
+
+protected:
+    ITraceBackend* _backend;
+    TraceCategory  _category;
+    const char*    _name;
+
+private:
+    TraceScope(const TraceScope&);
+    TraceScope& operator=(const TraceScope&);
+};
+
+}}
+
+#define _SL_TRACE_CONCAT_(_a_, _b_) _a_##_b_
+#define _SL_TRACE_CONCAT(_a_, _b_)  _SL_TRACE_CONCAT_(_a_, _b_)
+
+#ifdef SL_LIDAR_TRACING
+
+#define SL_TRACE_INSTANT(_category_, _name_, _value_) \
+    do { \
+        rp::hal::ITraceBackend* _trace_backend_ = rp::hal::Trace::GetActiveBackend(_category_); \
+        if (_trace_backend_) { \
+            _trace_backend_->onTraceInstant(rp::hal::Trace::GetCategoryName(_category_), _name_, getus(), (_s64)(_value_)); \
+        } \
+    } while (0)
+
+#define SL_TRACE_SCOPE(_category_, _name_) \
+    rp::hal::TraceScope _SL_TRACE_CONCAT(_trace_scope_, __LINE__)(_category_, _name_)
+
+#else
+
+#define SL_TRACE_INSTANT(_category_, _name_, _value_) do {} while (0)
+#define SL_TRACE_SCOPE(_category_, _name_)
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/work_pool.h"
+
+namespace rp{ namespace hal{
+
+WorkStealingPool * WorkStealingPool::CreatePool(int threadCount, const Thread::config_t * threadConfig)
+{
+    if (threadCount < 1 || threadCount > MAX_THREAD_COUNT) return NULL;
+
+    WorkStealingPool * pool = new WorkStealingPool();
+    if (!pool->start(threadCount, threadConfig)) {
+        delete pool;
+        return NULL;
+    }
+    return pool;
+}
+
+void WorkStealingPool::ReleasePool(WorkStealingPool * pool)
+{
+    delete pool;
+}
+
+WorkStealingPool::WorkStealingPool()
+    : _workerCount(0)
+    , _nextHomeWorker(0)
+    , _isWorking(false)
+{
+    memset(&_threadConfig, 0, sizeof(_threadConfig));
+    for (size_t pos = 0; pos < MAX_THREAD_COUNT; ++pos) {
+        _workers[pos].pool = this;
+        _workers[pos].index = pos;
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    _isWorking = false;
+    for (size_t pos = 0; pos < _workerCount; ++pos) {
+        _workers[pos].wakeup.set();
+    }
+    for (size_t pos = 0; pos < _workerCount; ++pos) {
+        _workers[pos].thread.join();
+    }
+}
+
+bool WorkStealingPool::start(int threadCount, const Thread::config_t * threadConfig)
+{
+    if (threadConfig) {
+        _threadConfig = *threadConfig;
+        if (threadConfig->name) {
+            _threadName = threadConfig->name;
+            _threadConfig.name = _threadName.c_str();
+        }
+    }
+
+    _isWorking = true;
+    for (int pos = 0; pos < threadCount; ++pos) {
+        Worker& worker = _workers[pos];
+        worker.thread = Thread::create_member<Worker, &Worker::_proc_workerThread>(&worker);
+        if (!worker.thread.getHandle()) return false;
+        ++_workerCount;
+    }
+    return true;
+}
+
+void WorkStealingPool::bindItem(WorkItem * item)
+{
+    item->_homeWorker = _nextHomeWorker.fetch_add(1) % _workerCount;
+}
+
+void WorkStealingPool::submit(WorkItem * item)
+{
+    Worker& home = _workers[item->_homeWorker];
+    {
+        AutoLocker l(home.locker);
+        item->_next = NULL;
+        if (home.tail) {
+            home.tail->_next = item;
+        } else {
+            home.head = item;
+        }
+        home.tail = item;
+    }
+
+    // the home worker picks it up if it is idle, another idle one steals it otherwise
+    if (home.idle.load()) {
+        home.wakeup.set();
+        return;
+    }
+    for (size_t pos = 1; pos < _workerCount; ++pos) {
+        Worker& other = _workers[(home.index + pos) % _workerCount];
+        if (other.idle.load()) {
+            other.wakeup.set();
+            return;
+        }
+    }
+}
+
+WorkItem * WorkStealingPool::_popItem(Worker& worker)
+{
+    AutoLocker l(worker.locker);
+    WorkItem * item = worker.head;
+    if (item) {
+        worker.head = item->_next;
+        if (!worker.head) worker.tail = NULL;
+        item->_next = NULL;
+    }
+    return item;
+}
+
+// the own queue first, then the others starting from the next worker
+WorkItem * WorkStealingPool::_takeItem(Worker& worker)
+{
+    for (size_t pos = 0; pos < _workerCount; ++pos) {
+        WorkItem * item = _popItem(_workers[(worker.index + pos) % _workerCount]);
+        if (item) return item;
+    }
+    return NULL;
+}
+
+u_result WorkStealingPool::_runWorker(Worker& worker)
+{
+    Thread::SetSelfConfig(_threadConfig, "sl_decode", Thread::PRIORITY_HIGH);
+
+    while (_isWorking) {
+        WorkItem * item = _takeItem(worker);
+        if (item) {
+            item->run();
+            continue;
+        }
+
+        // marked idle before looking again, so that an item submitted meanwhile either is found or wakes it up,
+        // which lets an idle worker sleep until then without a timeout
+        worker.idle.store(true);
+        item = _takeItem(worker);
+        if (!item) {
+            worker.wakeup.wait();
+        }
+        worker.idle.store(false);
+        if (item) item->run();
+    }
+    return RESULT_OK;
+}
+
+}}
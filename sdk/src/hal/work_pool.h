@@ -0,0 +1,123 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include "hal/types.h"
+#include "hal/thread.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+
+#include <atomic>
+#include <string>
+
+namespace rp{ namespace hal{
+
+class WorkStealingPool;
+
+// A unit of work run by a WorkStealingPool, queued intrusively so that submitting it never allocates
+class WorkItem
+{
+public:
+    WorkItem() : _next(NULL), _homeWorker(0) {}
+    virtual ~WorkItem() {}
+
+    virtual void run() = 0;
+
+private:
+    friend class WorkStealingPool;
+    WorkItem* _next;
+    size_t    _homeWorker;  // the worker it is queued on first, see WorkStealingPool::bindItem
+};
+
+// A few threads running the work items submitted from other threads
+// Each worker runs the items of its own queue first; once it is empty, it steals from the queues of the others,
+// so the busy workers are relieved by the idle ones. An item must not be submitted again before it has started
+// running, so that the same item never runs on two workers at once.
+class WorkStealingPool
+{
+public:
+    enum {
+        MAX_THREAD_COUNT = 16,
+    };
+
+    // returns NULL if the threads cannot be created
+    // threadConfig names, pins and schedules the working threads, NULL for the defaults
+    static WorkStealingPool * CreatePool(int threadCount, const Thread::config_t * threadConfig = NULL);
+    static void ReleasePool(WorkStealingPool *);
+
+    ~WorkStealingPool();
+
+    size_t getThreadCount() const { return _workerCount; }
+
+    // spreads the items over the workers, each one is queued on its home worker as long as that one is idle
+    void bindItem(WorkItem * item);
+
+    void submit(WorkItem * item);
+
+protected:
+    struct Worker
+    {
+        Worker() : pool(NULL), index(0), head(NULL), tail(NULL), idle(false) {}
+
+        u_result _proc_workerThread()
+        {
+            return pool->_runWorker(*this);
+        }
+
+        WorkStealingPool* pool;
+        size_t            index;
+        Locker            locker;   // guards the queue
+        WorkItem*         head;
+        WorkItem*         tail;
+        std::atomic<bool> idle;
+        Event             wakeup;
+        Thread            thread;
+    };
+
+    WorkStealingPool();
+    bool start(int threadCount, const Thread::config_t * threadConfig);
+
+    u_result _runWorker(Worker& worker);
+    WorkItem* _popItem(Worker& worker);
+    WorkItem* _takeItem(Worker& worker);
+
+    Worker              _workers[MAX_THREAD_COUNT];
+    size_t              _workerCount;
+    std::atomic<size_t> _nextHomeWorker;
+    std::atomic<bool>   _isWorking;
+    Thread::config_t    _threadConfig;
+    std::string         _threadName;    // the storage of the config name
+};
+
+}}
@@ -40,18 +40,43 @@
 #include "hal/event.h"
 #include "rplidar_driver.h"
 #include "sl_crc.h" 
+#include "sl_lidar_node_convert.h"
 #include <algorithm>
 
 namespace rp { namespace standalone{ namespace rplidar {
 
-    RPlidarDriver::RPlidarDriver(){}
+    enum {
+        LEGACY_CONVERT_CHUNK_NODES = 256,
+    };
+
+    RPlidarDriver::RPlidarDriver()
+        : _channelType(CHANNEL_TYPE_SERIALPORT)
+        , _channel(NULL)
+        , _ownsChannel(false)
+        , _lidarDrv(NULL)
+    {
+    }
 
     RPlidarDriver::RPlidarDriver(sl_u32 channelType) 
-        :_channelType(channelType)
+        : _channelType(channelType)
+        , _channel(NULL)
+        , _ownsChannel(false)
+        , _lidarDrv(NULL)
     {
     }
 
-    RPlidarDriver::~RPlidarDriver() {}
+    RPlidarDriver::~RPlidarDriver()
+    {
+        delete _lidarDrv;
+        _releaseChannel();
+    }
+
+    void RPlidarDriver::_releaseChannel()
+    {
+        if (_ownsChannel) delete _channel;
+        _channel = NULL;
+        _ownsChannel = false;
+    }
 
     RPlidarDriver * RPlidarDriver::CreateDriver(_u32 drivertype)
     {
@@ -66,36 +91,54 @@ namespace rp { namespace standalone{ namespace rplidar {
 
     u_result RPlidarDriver::connect(const char *path, _u32 portOrBaud, _u32 flag)
     {
+        IChannel* channel = NULL;
         switch (_channelType)
         {
         case CHANNEL_TYPE_SERIALPORT:
-            _channel = (*createSerialPortChannel(path, portOrBaud));
+            channel = (*createSerialPortChannel(path, portOrBaud));
             break;
         case CHANNEL_TYPE_TCP:
-            _channel = *createTcpChannel(path, portOrBaud);
+            channel = *createTcpChannel(path, portOrBaud);
             break;
         case CHANNEL_TYPE_UDP:
-            _channel = *createUdpChannel(path, portOrBaud);
+            channel = *createUdpChannel(path, portOrBaud);
             break;
         }
-        if (!(bool)_channel) return SL_RESULT_OPERATION_FAIL;
-        
-        _lidarDrv = *createLidarDriver();
-
-        if (!(bool)_lidarDrv) return SL_RESULT_OPERATION_FAIL;
+        if (!channel) return SL_RESULT_OPERATION_FAIL;
 
-        sl_result ans =(_lidarDrv)->connect(_channel);
+        u_result ans = connect(channel);
+        _ownsChannel = true;
         return ans;
     }
 
+    u_result RPlidarDriver::connect(IChannel* channel)
+    {
+        if (!channel) return SL_RESULT_INVALID_DATA;
+
+        if (!_lidarDrv) {
+            _lidarDrv = *createLidarDriver();
+            if (!_lidarDrv) return SL_RESULT_OPERATION_FAIL;
+        }
+
+        // the driver lets go of the previous channel on connect
+        if (_channel != channel) {
+            _lidarDrv->disconnect();
+            _releaseChannel();
+        }
+        _channel = channel;
+        _ownsChannel = false;
+
+        return (_lidarDrv)->connect(_channel);
+    }
+
     void RPlidarDriver::disconnect()
     {
-        (_lidarDrv)->disconnect();
+        if (_lidarDrv) (_lidarDrv)->disconnect();
     }
 
     bool RPlidarDriver::isConnected() 
     { 
-        return (_lidarDrv)->isConnected();
+        return _lidarDrv && (_lidarDrv)->isConnected();
     }
      
     u_result RPlidarDriver::reset(_u32 timeout)
@@ -142,8 +185,7 @@ namespace rp { namespace standalone{ namespace rplidar {
     {
         MotorCtrlSupport motorSupport;
         u_result ans = (_lidarDrv)->checkMotorCtrlSupport(motorSupport, timeout);
-        if (motorSupport == MotorCtrlSupportNone)
-            support = false;
+        support = (motorSupport != MotorCtrlSupportNone);
         return ans;
     }
 
@@ -167,24 +209,25 @@ namespace rp { namespace standalone{ namespace rplidar {
         return (_lidarDrv)->stop(timeout);
     }
 
-    u_result RPlidarDriver::grabScanDataHq(rplidar_response_measurement_node_hq_t * nodebuffer, size_t & count, _u32 timeout)
-    {
-        return (_lidarDrv)->grabScanDataHq(nodebuffer, count, timeout);
-    }
-
-    u_result RPlidarDriver::ascendScanData(rplidar_response_measurement_node_hq_t * nodebuffer, size_t count)
-    {
-        return (_lidarDrv)->ascendScanData(nodebuffer, count);
-    }
-    
     u_result RPlidarDriver::getScanDataWithInterval(rplidar_response_measurement_node_t * nodebuffer, size_t & count)
     {
-        return RESULT_OPERATION_NOT_SUPPORT;
-    }
+        // fetched a chunk at a time on the stack, the legacy nodes are too small to take the HQ nodes in place
+        rplidar_response_measurement_node_hq_t chunk[LEGACY_CONVERT_CHUNK_NODES];
+        size_t fetched = 0;
 
-    u_result RPlidarDriver::getScanDataWithIntervalHq(rplidar_response_measurement_node_hq_t * nodebuffer, size_t & count)
-    {
-        return (_lidarDrv)->getScanDataWithIntervalHq(nodebuffer, count);
+        while (fetched < count) {
+            size_t required = std::min(count - fetched, (size_t)LEGACY_CONVERT_CHUNK_NODES);
+            size_t chunkCount = required;
+            u_result ans = (_lidarDrv)->getScanDataWithIntervalHq(chunk, chunkCount);
+            if (IS_FAIL(ans)) return ans;
+
+            convertNodesToLegacy(chunk, chunkCount, nodebuffer + fetched);
+            fetched += chunkCount;
+            if (chunkCount < required) break;
+        }
+
+        count = fetched;
+        return RESULT_OK;
     }
 
     u_result RPlidarDriver::startMotor()
@@ -0,0 +1,277 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/locker.h"
+
+#include "sl_lidar_driver.h"
+#include "sl_allocator.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace sl {
+
+    // First fit allocator on a single memory area
+    // The free blocks are kept in address order, so a released block is merged with its free neighbours.
+    // Each block starts with its size, the free ones also link to the next free block.
+    class LidarArenaAllocator : public ILidarAllocator
+    {
+    public:
+        enum {
+            BLOCK_ALIGNMENT = 16,
+            BLOCK_HEADER_SIZE = 16,
+            MIN_BLOCK_SIZE = BLOCK_HEADER_SIZE + BLOCK_ALIGNMENT,
+        };
+
+        LidarArenaAllocator(void* memory, size_t size, bool ownsMemory)
+            : _memory(memory)
+            , _ownsMemory(ownsMemory)
+            , _freeList(nullptr)
+        {
+            // the whole arena is a single free block to start with
+            _freeList = (FreeBlock*)(((size_t)memory + BLOCK_ALIGNMENT - 1) & ~(size_t)(BLOCK_ALIGNMENT - 1));
+            _freeList->size = GetUsableSize(memory, size);
+            _freeList->next = nullptr;
+        }
+
+        virtual ~LidarArenaAllocator()
+        {
+            if (_ownsMemory) free(_memory);
+        }
+
+        // the usable size of a memory area, the arena cannot be made on it if less than MIN_BLOCK_SIZE
+        static size_t GetUsableSize(void* memory, size_t size)
+        {
+            size_t padding = (BLOCK_ALIGNMENT - ((size_t)memory & (BLOCK_ALIGNMENT - 1))) & (BLOCK_ALIGNMENT - 1);
+            if (size < padding) return 0;
+            return (size - padding) & ~(size_t)(BLOCK_ALIGNMENT - 1);
+        }
+
+        virtual void* allocate(size_t size)
+        {
+            if (size > ((size_t)-1) - BLOCK_HEADER_SIZE - BLOCK_ALIGNMENT) return nullptr;
+            size_t required = (size + BLOCK_HEADER_SIZE + BLOCK_ALIGNMENT - 1) & ~(size_t)(BLOCK_ALIGNMENT - 1);
+
+            rp::hal::AutoLocker l(_locker);
+            for (FreeBlock** link = &_freeList; *link; link = &(*link)->next) {
+                FreeBlock* block = *link;
+                if (block->size < required) continue;
+
+                if (block->size - required >= MIN_BLOCK_SIZE) {
+                    // split, the rest stays free at the same place of the list
+                    FreeBlock* rest = (FreeBlock*)((_u8*)block + required);
+                    rest->size = block->size - required;
+                    rest->next = block->next;
+                    *link = rest;
+                    block->size = required;
+                }
+                else {
+                    *link = block->next;
+                }
+                return (_u8*)block + BLOCK_HEADER_SIZE;
+            }
+            return nullptr;
+        }
+
+        virtual void deallocate(void* ptr, size_t)
+        {
+            if (!ptr) return;
+            FreeBlock* block = (FreeBlock*)((_u8*)ptr - BLOCK_HEADER_SIZE);
+
+            rp::hal::AutoLocker l(_locker);
+            FreeBlock* prev = nullptr;
+            FreeBlock* next = _freeList;
+            while (next && next < block) {
+                prev = next;
+                next = next->next;
+            }
+
+            block->next = next;
+            if (next && (_u8*)block + block->size == (_u8*)next) {
+                block->size += next->size;
+                block->next = next->next;
+            }
+
+            if (!prev) {
+                _freeList = block;
+            }
+            else if ((_u8*)prev + prev->size == (_u8*)block) {
+                prev->size += block->size;
+                prev->next = block->next;
+            }
+            else {
+                prev->next = block;
+            }
+        }
+
+    protected:
+        struct FreeBlock
+        {
+            size_t     size; // including the header
+            FreeBlock* next;
+        };
+
+        void*           _memory;
+        bool            _ownsMemory;
+        rp::hal::Locker _locker;
+        FreeBlock*      _freeList;
+    };
+
+    namespace internal {
+
+        struct AllocationHeader
+        {
+            ILidarAllocator* owner; // NULL for the heap
+            size_t           size;
+        };
+
+        static_assert(sizeof(AllocationHeader) <= SDK_ALLOCATION_HEADER_SIZE, "the allocation header does not fit");
+
+        static std::atomic<ILidarAllocator*> _sdkAllocator(nullptr);
+        static std::atomic<bool>  _allocationGuard(false);
+        static std::atomic<int>   _steadyStateCount(0);
+
+        static std::atomic<_u64>  _allocationCount(0);
+        static std::atomic<_u64>  _bytesInUse(0);
+        static std::atomic<_u64>  _steadyStateAllocationCount(0);
+        static std::atomic<_u64>  _fallbackCount(0);
+
+        void* sdkTryAllocate(size_t size)
+        {
+            if (_steadyStateCount.load(std::memory_order_relaxed) > 0) {
+                _steadyStateAllocationCount.fetch_add(1, std::memory_order_relaxed);
+                if (_allocationGuard.load(std::memory_order_relaxed)) {
+                    fprintf(stderr, "sl_lidar: %lu bytes allocated while streaming steady state scans\n", (unsigned long)size);
+                    abort();
+                }
+            }
+
+            if (size > ((size_t)-1) - SDK_ALLOCATION_HEADER_SIZE) return nullptr;
+            size_t blockSize = size + SDK_ALLOCATION_HEADER_SIZE;
+
+            ILidarAllocator* owner = _sdkAllocator.load(std::memory_order_acquire);
+            void* block = owner ? owner->allocate(blockSize) : nullptr;
+            if (!block) {
+                if (owner) {
+                    _fallbackCount.fetch_add(1, std::memory_order_relaxed);
+                    owner = nullptr;
+                }
+                block = malloc(blockSize);
+                if (!block) return nullptr;
+            }
+
+            AllocationHeader* header = (AllocationHeader*)block;
+            header->owner = owner;
+            header->size = blockSize;
+
+            _allocationCount.fetch_add(1, std::memory_order_relaxed);
+            _bytesInUse.fetch_add(size, std::memory_order_relaxed);
+            return (_u8*)block + SDK_ALLOCATION_HEADER_SIZE;
+        }
+
+        void* sdkAllocate(size_t size)
+        {
+            void* ptr = sdkTryAllocate(size);
+            if (!ptr) throw std::bad_alloc();
+            return ptr;
+        }
+
+        void sdkDeallocate(void* ptr)
+        {
+            if (!ptr) return;
+
+            AllocationHeader* header = (AllocationHeader*)((_u8*)ptr - SDK_ALLOCATION_HEADER_SIZE);
+            size_t blockSize = header->size;
+            _bytesInUse.fetch_sub(blockSize - SDK_ALLOCATION_HEADER_SIZE, std::memory_order_relaxed);
+
+            if (header->owner) {
+                header->owner->deallocate(header, blockSize);
+            }
+            else {
+                free(header);
+            }
+        }
+
+        void sdkBeginSteadyState()
+        {
+            _steadyStateCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void sdkEndSteadyState()
+        {
+            _steadyStateCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    Result<ILidarAllocator*> createLidarArenaAllocator(size_t capacity)
+    {
+        if (capacity < LidarArenaAllocator::MIN_BLOCK_SIZE) return SL_RESULT_INVALID_DATA;
+
+        void* memory = malloc(capacity);
+        if (!memory) return SL_RESULT_INSUFFICIENT_MEMORY;
+        return new LidarArenaAllocator(memory, capacity, true);
+    }
+
+    Result<ILidarAllocator*> createLidarArenaAllocator(void* memory, size_t size)
+    {
+        if (!memory) return SL_RESULT_INVALID_DATA;
+        if (LidarArenaAllocator::GetUsableSize(memory, size) < LidarArenaAllocator::MIN_BLOCK_SIZE) return SL_RESULT_INVALID_DATA;
+
+        return new LidarArenaAllocator(memory, size, false);
+    }
+
+    sl_result setLidarAllocator(ILidarAllocator* allocator)
+    {
+        internal::_sdkAllocator.store(allocator, std::memory_order_release);
+        return SL_RESULT_OK;
+    }
+
+    sl_result getLidarAllocationStats(LidarAllocationStats& stats)
+    {
+        stats.allocation_count = internal::_allocationCount.load(std::memory_order_relaxed);
+        stats.bytes_in_use = internal::_bytesInUse.load(std::memory_order_relaxed);
+        stats.steady_state_allocation_count = internal::_steadyStateAllocationCount.load(std::memory_order_relaxed);
+        stats.fallback_count = internal::_fallbackCount.load(std::memory_order_relaxed);
+        return SL_RESULT_OK;
+    }
+
+    sl_result setLidarAllocationGuard(bool enable)
+    {
+        internal::_allocationGuard.store(enable, std::memory_order_relaxed);
+        return SL_RESULT_OK;
+    }
+}
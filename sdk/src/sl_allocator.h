@@ -0,0 +1,111 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include <vector>
+#include <new>
+#include <stddef.h>
+
+// The allocations of the sdk buffers, routed to the allocator set with setLidarAllocator().
+// Each block keeps its owner in front of it, so a block is always released to the allocator it came from.
+// The allocations made while a driver streams steady state scans are counted, see setLidarAllocationGuard().
+
+namespace sl { namespace internal {
+
+enum {
+    SDK_ALLOCATION_HEADER_SIZE = 16, // also the alignment of the blocks
+};
+
+// NULL when neither the user allocator nor the heap can serve it
+void* sdkTryAllocate(size_t size);
+
+// throws std::bad_alloc as operator new does
+void* sdkAllocate(size_t size);
+
+void  sdkDeallocate(void* ptr);
+
+// nested for each driver streaming steady state scans
+void  sdkBeginSteadyState();
+void  sdkEndSteadyState();
+
+// std allocator on top of the sdk allocations, stateless so all the instances are interchangeable
+template <class T>
+class SdkAllocator
+{
+public:
+    typedef T           value_type;
+    typedef T*          pointer;
+    typedef const T*    const_pointer;
+    typedef T&          reference;
+    typedef const T&    const_reference;
+    typedef size_t      size_type;
+    typedef ptrdiff_t   difference_type;
+
+    template <class U>
+    struct rebind {
+        typedef SdkAllocator<U> other;
+    };
+
+    SdkAllocator() {}
+
+    template <class U>
+    SdkAllocator(const SdkAllocator<U>&) {}
+
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(sdkAllocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t)
+    {
+        sdkDeallocate(ptr);
+    }
+};
+
+template <class T, class U>
+inline bool operator==(const SdkAllocator<T>&, const SdkAllocator<U>&)
+{
+    return true;
+}
+
+template <class T, class U>
+inline bool operator!=(const SdkAllocator<T>&, const SdkAllocator<U>&)
+{
+    return false;
+}
+
+template <class T>
+using sdk_vector = std::vector<T, SdkAllocator<T> >;
+
+}}
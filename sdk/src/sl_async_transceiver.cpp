@@ -40,8 +40,12 @@
 #include "hal/locker.h"
 #include "hal/socket.h"
 #include "hal/event.h"
+#include "hal/trace.h"
+#include "hal/realtime.h"
 
 #include "sl_async_transceiver.h"
+#include "sl_channel_recorder.h"
+#include <algorithm>
 
 
 
@@ -53,6 +57,7 @@ namespace sl { namespace internal {
 ProtocolMessage::ProtocolMessage()
         : len(0)
         , cmd(0)
+        , rxTimestamp_uS(0)
         , data(NULL)
         , _databufsize(0)
 		, _usingOutterData(false)
@@ -63,6 +68,7 @@ ProtocolMessage::ProtocolMessage()
 ProtocolMessage::ProtocolMessage(_u8 cmd, const void* buffer, size_t size)
 	: len(size)
 	, cmd(cmd)
+	, rxTimestamp_uS(0)
 	, data(NULL)
     , _databufsize(0)
 	, _usingOutterData(false)
@@ -77,6 +83,7 @@ ProtocolMessage::ProtocolMessage(_u8 cmd, const void* buffer, size_t size)
 ProtocolMessage::ProtocolMessage(const ProtocolMessage& srcMsg)
 	: len(srcMsg.len)
 	, cmd(srcMsg.cmd)
+	, rxTimestamp_uS(srcMsg.rxTimestamp_uS)
 	, data(NULL)
     , _databufsize(0)
 	, _usingOutterData(false)
@@ -88,6 +95,17 @@ ProtocolMessage::ProtocolMessage(const ProtocolMessage& srcMsg)
 	}
 }
 
+ProtocolMessage::ProtocolMessage(ProtocolMessage&& srcMsg)
+	: len(0)
+	, cmd(srcMsg.cmd)
+	, rxTimestamp_uS(srcMsg.rxTimestamp_uS)
+	, data(NULL)
+	, _databufsize(0)
+	, _usingOutterData(false)
+{
+	_takeData(srcMsg);
+}
+
 ProtocolMessage::~ProtocolMessage()
 {
 	this->cleanData();
@@ -95,13 +113,14 @@ ProtocolMessage::~ProtocolMessage()
 
 ProtocolMessage& ProtocolMessage::operator =(const ProtocolMessage& srcMessage)
 {
-	this->cleanData();
-
+	if (this == &srcMessage) return *this;
 
 	this->len = srcMessage.len;
 	this->cmd = srcMessage.cmd;
+	this->rxTimestamp_uS = srcMessage.rxTimestamp_uS;
 
-    _changeBufSize( true );
+    // the current buffer is reused, so refilling a pooled message does not allocate
+    _changeBufSize();
 	if (srcMessage.data && len)
 	{
 		memcpy(data, srcMessage.data, len);
@@ -110,6 +129,38 @@ ProtocolMessage& ProtocolMessage::operator =(const ProtocolMessage& srcMessage)
 	return *this;
 }
 
+ProtocolMessage& ProtocolMessage::operator =(ProtocolMessage&& srcMessage)
+{
+	if (this == &srcMessage) return *this;
+
+	this->cleanData();
+	this->cmd = srcMessage.cmd;
+	this->rxTimestamp_uS = srcMessage.rxTimestamp_uS;
+	_takeData(srcMessage);
+	return *this;
+}
+
+void ProtocolMessage::_takeData(ProtocolMessage& srcMsg)
+{
+	len = srcMsg.len;
+	if (srcMsg.data == srcMsg._inlineData) {
+		// the inline payload cannot be taken, only copied
+		_changeBufSize();
+		memcpy(data, srcMsg.data, len);
+	}
+	else {
+		data = srcMsg.data;
+		_databufsize = srcMsg._databufsize;
+		_usingOutterData = srcMsg._usingOutterData;
+		srcMsg.data = NULL;
+	}
+
+	srcMsg._databufsize = 0;
+	srcMsg._usingOutterData = false;
+	srcMsg.len = 0;
+	srcMsg._changeBufSize();
+}
+
 void ProtocolMessage::setDataBuf(_u8 *buffer, size_t size)
 {
 	this->cleanData();
@@ -132,13 +183,14 @@ void ProtocolMessage::cleanData()
 {
 	if (data) 
 	{
-		if (!_usingOutterData)
+		if (!_usingOutterData && data != _inlineData)
 		{
-			delete [] data;
+			sdkDeallocate(data);
 		}
 		data = NULL;
 		len = 1;
         _databufsize = 0;
+		_usingOutterData = false;
 	}
 }
 
@@ -149,14 +201,17 @@ void ProtocolMessage::_changeBufSize( bool force_compact)
     size_t new_buf_size = actual_size;
 
 
-    if (!_usingOutterData)
+    if (!_usingOutterData && data)
     {
         // nothing to do
         if ( new_buf_size == _databufsize ) return;
 
         if ( new_buf_size < _databufsize){
 
-            if ( (_databufsize >> 1) < new_buf_size)
+            // the inline storage is never released
+            if (data == _inlineData) return;
+
+            if ( new_buf_size > INLINE_PAYLOAD_SIZE && (_databufsize >> 1) < new_buf_size)
             {
                 // reuse the current buffer
                 if (!force_compact) return;
@@ -171,8 +226,176 @@ void ProtocolMessage::_changeBufSize( bool force_compact)
     cleanData();
     // the cleanData() will reset the length info, so we need to restore it
     len = actual_size;
-    data = new _u8[new_buf_size];
-    _databufsize = new_buf_size;
+    if (new_buf_size <= INLINE_PAYLOAD_SIZE) {
+        data = _inlineData;
+        _databufsize = INLINE_PAYLOAD_SIZE;
+    }
+    else {
+        data = (_u8*)sdkAllocate(new_buf_size);
+        _databufsize = new_buf_size;
+    }
+}
+
+
+std::shared_ptr<ProtocolMessagePool> ProtocolMessagePool::create(size_t capacity)
+{
+    return std::shared_ptr<ProtocolMessagePool>(new ProtocolMessagePool(capacity));
+}
+
+ProtocolMessagePool::ProtocolMessagePool(size_t capacity)
+    : _slots(NULL)
+    , _freeList(NULL)
+    , _freeCount(capacity)
+{
+    _slots = new Slot[capacity];
+    for (size_t pos = 0; pos < capacity; ++pos) {
+        _slots[pos].next = _freeList;
+        _freeList = &_slots[pos];
+    }
+}
+
+ProtocolMessagePool::~ProtocolMessagePool()
+{
+    // each message in use holds the pool, they are all back here
+    delete[] _slots;
+}
+
+message_autoptr_t ProtocolMessagePool::acquire(const ProtocolMessage& srcMsg)
+{
+    Slot* slot = NULL;
+    {
+        rp::hal::AutoLocker l(_locker);
+        if (_freeList) {
+            slot = _freeList;
+            _freeList = slot->next;
+            --_freeCount;
+        }
+    }
+
+    if (!slot) {
+        return std::make_shared<ProtocolMessage>(srcMsg);
+    }
+
+    slot->message = srcMsg;
+    return message_autoptr_t(&slot->message, NullDeleter(), SlotAllocator<ProtocolMessage>(shared_from_this(), slot));
+}
+
+size_t ProtocolMessagePool::getFreeCount()
+{
+    rp::hal::AutoLocker l(_locker);
+    return _freeCount;
+}
+
+void ProtocolMessagePool::_release(Slot* slot)
+{
+    rp::hal::AutoLocker l(_locker);
+    slot->next = _freeList;
+    _freeList = slot;
+    ++_freeCount;
+}
+
+
+RxRingBuffer::RxRingBuffer(size_t capacity)
+    : _buffer(NULL)
+    , _capacity(capacity)
+    , _mask(capacity - 1)
+    , _writePos(0)
+    , _readPos(0)
+    , _markWritePos(0)
+    , _markReadPos(0)
+    , _overflowCount(0)
+    , _overflowBytes(0)
+    , _highWater(0)
+{
+    assert((capacity & (capacity - 1)) == 0);
+    assert(capacity >= MAX_CONTIGUOUS_WRITE);
+    _buffer = (_u8*)sdkAllocate(_capacity + MAX_CONTIGUOUS_WRITE);
+}
+
+RxRingBuffer::~RxRingBuffer()
+{
+    sdkDeallocate(_buffer);
+}
+
+void RxRingBuffer::reset()
+{
+    _writePos = 0;
+    _readPos = 0;
+    _markWritePos = 0;
+    _markReadPos = 0;
+    _highWater = 0;
+}
+
+void RxRingBuffer::prefault()
+{
+    rp::hal::prefaultMemory(_buffer, _capacity + MAX_CONTIGUOUS_WRITE);
+}
+
+_u8* RxRingBuffer::beginWrite(size_t& maxsize)
+{
+    size_t writePos = _writePos.load(std::memory_order_relaxed);
+    size_t readPos = _readPos.load(std::memory_order_acquire);
+
+    size_t freeSize = _capacity - (writePos - readPos);
+    maxsize = std::min<size_t>(freeSize, MAX_CONTIGUOUS_WRITE);
+    return _buffer + (writePos & _mask);
+}
+
+void RxRingBuffer::commitWrite(size_t size, _u64 rxTimestamp_uS)
+{
+    assert(size <= MAX_CONTIGUOUS_WRITE);
+    size_t writePos = _writePos.load(std::memory_order_relaxed);
+    size_t offset = (writePos & _mask);
+
+    if (offset + size > _capacity) {
+        // the data was written beyond the end of the ring, move the exceeded part to the head
+        memcpy(_buffer, _buffer + _capacity, offset + size - _capacity);
+    }
+
+    if (rxTimestamp_uS) {
+        // the mark is published before the data, the consumer never sees the data without it
+        size_t markWritePos = _markWritePos.load(std::memory_order_relaxed);
+        if (markWritePos - _markReadPos.load(std::memory_order_acquire) < MAX_TIMESTAMP_MARKS) {
+            TimestampMark& mark = _marks[markWritePos & (MAX_TIMESTAMP_MARKS - 1)];
+            mark.endPos = writePos + size;
+            mark.timestamp_uS = rxTimestamp_uS;
+            _markWritePos.store(markWritePos + 1, std::memory_order_release);
+        }
+    }
+    _writePos.store(writePos + size, std::memory_order_release);
+
+    size_t pending = writePos + size - _readPos.load(std::memory_order_relaxed);
+    if (pending > _highWater.load(std::memory_order_relaxed)) {
+        _highWater.store(pending, std::memory_order_relaxed);
+    }
+}
+
+const _u8* RxRingBuffer::beginRead(size_t& size, _u64& rxTimestamp_uS)
+{
+    size_t readPos = _readPos.load(std::memory_order_relaxed);
+    size_t writePos = _writePos.load(std::memory_order_acquire);
+    size_t offset = (readPos & _mask);
+
+    size = std::min<size_t>(writePos - readPos, _capacity - offset);
+    rxTimestamp_uS = 0;
+
+    size_t markReadPos = _markReadPos.load(std::memory_order_relaxed);
+    size_t markWritePos = _markWritePos.load(std::memory_order_acquire);
+    for (; markReadPos != markWritePos; ++markReadPos) {
+        const TimestampMark& mark = _marks[markReadPos & (MAX_TIMESTAMP_MARKS - 1)];
+        if (mark.endPos <= readPos) continue; // decoded already
+        rxTimestamp_uS = mark.timestamp_uS;
+        size = std::min<size_t>(size, mark.endPos - readPos);
+        break;
+    }
+    _markReadPos.store(markReadPos, std::memory_order_release);
+    return _buffer + offset;
+}
+
+void RxRingBuffer::commitRead(size_t size)
+{
+    size_t readPos = _readPos.load(std::memory_order_relaxed);
+    _readPos.store(readPos + size, std::memory_order_release);
 }
 
 
@@ -181,16 +404,70 @@ AsyncTransceiver::AsyncTransceiver(IAsyncProtocolCodec& codec)
 	, _codec(codec)
 	, _isWorking(false)
     , _workingFlag(0)
+    , _decodeMode(DECODE_MODE_THREADED)
+    , _isRxBound(false)
+    , _isDecoderBound(false)
+    , _isRetiringThreads(false)
+    , _threadConfigVersion(0)
+    , _spawnedConfigVersion(0)
+    , _spawnedStackPrefault(0)
+    , _threadStackPrefault(0)
+    , _ioReactor(NULL)
+    , _activeReactor(NULL)
+    , _reactorHandle(-1)
+    , _decodePool(NULL)
+    , _activeDecodePool(NULL)
+    , _decodeScheduled(false)
+    , _recorder(NULL)
+    , _clock(NULL)
+    , _rxMinBatch(0)
+    , _rxMaxWaitMs(0)
+    , _rxMaxBlockMs(0)
+    , _rxBlocked_uS(0)
+    , _rxBlockTimeouts(0)
 {
-
+    _rxScratchBuffer.resize(RxRingBuffer::MAX_CONTIGUOUS_WRITE);
+    _txBuffer.resize(DEFAULT_TX_BUFFER_SIZE);
+    memset(&_rxThreadConfig, 0, sizeof(_rxThreadConfig));
+    memset(&_decoderThreadConfig, 0, sizeof(_decoderThreadConfig));
+#ifdef SL_LIDAR_LATENCY_PROFILING
+    _latencyProfile = NULL;
+    _rxPendingSince_uS.store(0, std::memory_order_relaxed);
+#endif
 }
 
 AsyncTransceiver::~AsyncTransceiver()
 {
     unbindAndClose();
+    rp::hal::AutoLocker l(_opLocker);
+    _retireThreads();
 }
 
-u_result AsyncTransceiver::openChannelAndBind(IChannel* channel)
+void AsyncTransceiver::setThreadConfig(const rp::hal::Thread::config_t& rx, const rp::hal::Thread::config_t& decoder)
+{
+    rp::hal::AutoLocker l(_opLocker);
+
+    _rxThreadName = rx.name ? rx.name : "";
+    _decoderThreadName = decoder.name ? decoder.name : "";
+
+    _rxThreadConfig = rx;
+    _rxThreadConfig.name = rx.name ? _rxThreadName.c_str() : NULL;
+    _decoderThreadConfig = decoder;
+    _decoderThreadConfig.name = decoder.name ? _decoderThreadName.c_str() : NULL;
+    ++_threadConfigVersion;
+}
+
+void AsyncTransceiver::prefaultBuffers()
+{
+    rp::hal::AutoLocker l(_opLocker);
+    if (_isWorking) return;
+
+    _rxRing.prefault();
+    rp::hal::prefaultMemory(&_rxScratchBuffer[0], _rxScratchBuffer.size());
+    rp::hal::prefaultMemory(&_txBuffer[0], _txBuffer.size());
+}
+
+u_result AsyncTransceiver::openChannelAndBind(IChannel* channel, decode_mode_t decodeMode)
 {
     if (!channel) return RESULT_INVALID_DATA;
 
@@ -201,8 +478,6 @@ u_result AsyncTransceiver::openChannelAndBind(IChannel* channel)
 		rp::hal::AutoLocker l(_opLocker);
 
         // try to open the channel ...
-        Result<nullptr_t> ans = SL_RESULT_OK;
-
         if (!channel->open()) {
             ans= RESULT_OPERATION_FAIL;
             break;
@@ -213,18 +488,49 @@ u_result AsyncTransceiver::openChannelAndBind(IChannel* channel)
         channel->flush();
 
 		_dataEvt.set(false);
+        _rxRing.reset();
+#ifdef SL_LIDAR_LATENCY_PROFILING
+        _rxPendingSince_uS.store(0, std::memory_order_relaxed);
+#endif
 
 		_isWorking = true;
         _workingFlag = 0;
         _bindedChannel = channel;
+        _decodeMode = decodeMode;
 
+        if (_ioReactor && channel->getNativeHandle() >= 0) {
+            _codec.onDecodeReset();
 
-		_decoderThread = CLASS_THREAD(AsyncTransceiver, _proc_decoderThread);
-		_rxThread = CLASS_THREAD(AsyncTransceiver, _proc_rxThread);
+            // set before the handle is added, the data may arrive right away
+            _activeDecodePool = _decodePool;
+            if (_activeDecodePool) _activeDecodePool->bindItem(this);
 
-        
+            _reactorHandle = channel->getNativeHandle();
+            if (IS_OK(_ioReactor->addHandle(_reactorHandle, this))) {
+                _activeReactor = _ioReactor;
+                _decodeMode = _activeDecodePool ? DECODE_MODE_REACTOR_POOL : DECODE_MODE_REACTOR;
+                break;
+            }
+            // fallback to the private threads
+            _activeDecodePool = NULL;
+            _reactorHandle = -1;
+        }
 
+        // the parked threads are reused unless they started with another config
+        if (_spawnedConfigVersion != _threadConfigVersion || _spawnedStackPrefault != _threadStackPrefault) {
+            _retireThreads();
+            _spawnedConfigVersion = _threadConfigVersion;
+            _spawnedStackPrefault = _threadStackPrefault;
+        }
 
+        if (_decodeMode != DECODE_MODE_INLINE) {
+            if (!_decoderThread.getHandle()) _decoderThread = CLASS_THREAD(AsyncTransceiver, _proc_decoderThread);
+            _isDecoderBound = true;
+            _decoderBindEvt.set();
+        }
+        if (!_rxThread.getHandle()) _rxThread = CLASS_THREAD(AsyncTransceiver, _proc_rxThread);
+        _isRxBound = true;
+        _rxBindEvt.set();
 	} while (0);
 
 	return ans;
@@ -240,28 +546,45 @@ void AsyncTransceiver::unbindAndClose()
     
 	_isWorking = false;
 	_dataEvt.set(); // set signal to wake up threads
+    _rxSpaceEvt.set();
+    _bindedChannel->cancelWaits(); // and the rx thread out of its wait for data
 
-	_decoderThread.join();
-	_rxThread.join();
+    if (_activeReactor) {
+        _activeReactor->removeHandle(_reactorHandle);
+        _activeReactor = NULL;
+        _reactorHandle = -1;
+    }
+    if (_activeDecodePool) {
+        _waitDecodeIdle();
+        _activeDecodePool = NULL;
+    }
+
+    // the threads park for the next binding instead of exiting
+    if (_isDecoderBound) {
+        _decoderParkedEvt.wait();
+        _isDecoderBound = false;
+    }
+    if (_isRxBound) {
+        _rxParkedEvt.wait();
+        _isRxBound = false;
+    }
 
 
     _bindedChannel->close();
 
     _bindedChannel = NULL;
 
-
-    for (std::list< Buffer* >::iterator itr = _rxQueue.begin(); itr != _rxQueue.end(); ++itr)
-    {
-        delete [] *itr;
-    }
-    _rxQueue.clear();
-
+    _rxRing.reset();
 }
 
 u_result AsyncTransceiver::sendMessage(message_autoptr_t& msg)
 {
     assert(msg);
+    return sendMessage(*msg);
+}
 
+u_result AsyncTransceiver::sendMessage(const ProtocolMessage& msg)
+{
     if (!_isWorking) return RESULT_OPERATION_NOT_SUPPORT;
 
     rp::hal::AutoLocker l(_opLocker);
@@ -273,40 +596,116 @@ u_result AsyncTransceiver::sendMessage(message_autoptr_t& msg)
         return RESULT_OK;
     }
 
-    u_result ans = RESULT_OK;
-
-    _u8* txBuffer = new _u8[requiredBufferSize];
+    if (requiredBufferSize > _txBuffer.size()) {
+        // only happens for the oversized messages, the buffer is kept for later use
+        _txBuffer.resize(requiredBufferSize);
+    }
 
-    do {
-  
-        if (!txBuffer) {
-            return RESULT_INSUFFICIENT_MEMORY;
-        }
+    _codec.onEncodeData(msg, &_txBuffer[0], &requiredBufferSize);
 
-        _codec.onEncodeData(msg, txBuffer, &requiredBufferSize);
+    // recorded before the write: a device answering at once would otherwise have its answer captured ahead of the command
+    _recordChunk(CHANNEL_RECORD_DIR_TX, 0, &_txBuffer[0], requiredBufferSize);
+    int txSize = _bindedChannel->write(&_txBuffer[0], requiredBufferSize);
 
-        int txSize = _bindedChannel->write(txBuffer, requiredBufferSize);
+    if (txSize < 0) return RESULT_OPERATION_FAIL;
+    return RESULT_OK;
+}
 
-        if (txSize < 0) ans = RESULT_OPERATION_FAIL;
+// the clock time, or the read time while recording so the samples get the very stamps the recording keeps
+_u64 AsyncTransceiver::_stampRx(_u64 rxTimestamp_uS)
+{
+    ILidarClock* clock = _clock.load(std::memory_order_acquire);
+    if (clock) {
+        // a converted capture time keeps the precision of the kernel timestamps
+        _u64 converted = rxTimestamp_uS ? clock->fromHostTime_uS(rxTimestamp_uS) : 0;
+        return converted ? converted : clock->now_uS();
+    }
+    if (!rxTimestamp_uS) {
+        ChannelRecorder* recorder = _recorder;
+        if (recorder && recorder->isRecording()) return getus();
+    }
+    return rxTimestamp_uS;
+}
 
-    } while (0);
+// a chunk without a stamp is recorded at the current time of the clock
+void AsyncTransceiver::_recordChunk(_u8 direction, _u64 timestamp_uS, const void* data, size_t size)
+{
+    ChannelRecorder* recorder = _recorder;
+    if (recorder && recorder->isRecording()) {
+        if (!timestamp_uS) {
+            ILidarClock* clock = _clock.load(std::memory_order_acquire);
+            timestamp_uS = clock ? clock->now_uS() : getus();
+        }
+        recorder->record(direction, timestamp_uS, data, size);
+    }
+}
 
+void AsyncTransceiver::_coalesceRx(size_t& hintedSize)
+{
+    size_t minBatch = std::min<size_t>(_rxMinBatch, RxRingBuffer::MAX_CONTIGUOUS_WRITE);
+    _u32 maxWaitMs = _rxMaxWaitMs;
+    if (hintedSize >= minBatch || !maxWaitMs) return;
+
+    _u64 deadline = getms() + maxWaitMs;
+    while (_isWorking) {
+        _u64 now = getms();
+        if (now >= deadline) break;
+
+        size_t readySize = 0;
+        bool ready = _bindedChannel->waitForData(minBatch, (sl_u32)(deadline - now), &readySize);
+        if (!ready) {
+            // timed out, pick up what has arrived meanwhile
+            if (IS_FAIL(_bindedChannel->waitForDataExt(readySize, 0))) readySize = 0;
+        }
+        if (readySize > hintedSize) hintedSize = readySize;
+        // a channel reporting less than asked does not wait for the count, read what is there
+        if (!ready || hintedSize >= minBatch || readySize < minBatch) break;
+    }
+}
 
-    delete[] txBuffer;
-    return ans;
+void AsyncTransceiver::_retireThreads()
+{
+    // only while not bound, the parked threads see the flag as they wake up
+    _isRetiringThreads = true;
+    if (_rxThread.getHandle()) {
+        _rxBindEvt.set();
+        _rxThread.join();
+    }
+    if (_decoderThread.getHandle()) {
+        _decoderBindEvt.set();
+        _decoderThread.join();
+    }
+    _isRetiringThreads = false;
 }
 
 sl_result AsyncTransceiver::_proc_rxThread()
 {
-    assert(_bindedChannel);
+    rp::hal::Thread::SetSelfConfig(_rxThreadConfig, "sl_rx", rp::hal::Thread::PRIORITY_HIGH);
+    rp::hal::prefaultStack(_threadStackPrefault);
+
+    // parked without any wakeup until the next binding
+    while (_rxBindEvt.wait() == rp::hal::Event::EVENT_OK && !_isRetiringThreads) {
+        if (_decodeMode == DECODE_MODE_INLINE) {
+            _rxInlineDecodeSession();
+        } else {
+            _rxSession();
+        }
+        _rxParkedEvt.set();
+    }
+    return RESULT_OK;
+}
 
-    rp::hal::Thread::SetSelfPriority(rp::hal::Thread::PRIORITY_HIGH);
+void AsyncTransceiver::_rxSession()
+{
+    assert(_bindedChannel);
 
+    // unbindAndClose() cancels the waits, so an idle channel needs no periodic wakeup
+    const sl_u32 waitMs = _bindedChannel->isWaitCancellable() ? (sl_u32)-1 : (sl_u32)RX_POLL_MS;
     u_result result;
     size_t hintedSize = 0;
     while (_isWorking)
     {
-        result = _bindedChannel->waitForDataExt(hintedSize, 1000);
+        result = _bindedChannel->waitForDataExt(hintedSize, waitMs);
 
         if (IS_FAIL(result))
         {
@@ -326,86 +725,378 @@ sl_result AsyncTransceiver::_proc_rxThread()
         {
             continue;
         }
+        _coalesceRx(hintedSize);
 
 
-        Buffer* decodeBuffer = new Buffer();
-        
-        decodeBuffer->data = new _u8[hintedSize];
+        size_t writableSize;
+        _u8* rxBuffer = _rxRing.beginWrite(writableSize);
+        size_t requiredSize = std::min<size_t>(hintedSize, RxRingBuffer::MAX_CONTIGUOUS_WRITE);
+        if (writableSize < requiredSize && _rxMaxBlockMs.load(std::memory_order_relaxed)) {
+            rxBuffer = _waitRxRoom(requiredSize, writableSize);
+        }
+        bool overflowed = (writableSize < requiredSize);
+
+        if (overflowed) {
+            // the decoder cannot catch up, drop the data
+            rxBuffer = &_rxScratchBuffer[0];
+        }
 
-        decodeBuffer->size = _bindedChannel->read(decodeBuffer->data, hintedSize);
+#ifdef SL_LIDAR_LATENCY_PROFILING
+        _u64 rxStartTs = getus();
+#endif
+        _u64 rxTimestamp_uS = 0;
+        int rxSize = _bindedChannel->readTimestamped(rxBuffer, requiredSize, rxTimestamp_uS);
+        rxTimestamp_uS = _stampRx(rxTimestamp_uS);
 #ifdef _DEBUG_DUMP_PACKET
-        printf("Revc: %d\n", decodeBuffer->size);
+        printf("Revc: %d\n", rxSize);
+#endif
+        SL_TRACE_INSTANT(rp::hal::TRACE_CATEGORY_RX, "rx_read", rxSize);
+#ifdef SL_LIDAR_LATENCY_PROFILING
+        _u64 rxLandTs = getus();
+        if (_latencyProfile) {
+            _latencyProfile->record(LIDAR_LATENCY_STAGE_RX_READ, rxLandTs - rxStartTs);
+        }
 #endif
          
-        if  (!decodeBuffer->size) {
-            delete decodeBuffer;
-
-            
-            _workingFlag |= WORKING_FLAG_ERROR;
-            _codec.onChannelError(RESULT_OPERATION_ABORTED);
+        if  (rxSize <= 0) {
+            // a canceled wait of unbindAndClose() is no channel error
+            if (_isWorking) {
+                _workingFlag |= WORKING_FLAG_ERROR;
+                _codec.onChannelError(RESULT_OPERATION_ABORTED);
+            }
             break;
         }
 
-        assert(hintedSize >= decodeBuffer->size);
+        assert(requiredSize >= (size_t)rxSize);
+        _recordChunk(CHANNEL_RECORD_DIR_RX, rxTimestamp_uS, rxBuffer, rxSize);
 
 
 #ifdef _DEBUG_DUMP_PACKET
-        printf("=== Dump RX Packet, size = %d ===\n", decodeBuffer->size);
-        for (int pos = 0; pos < decodeBuffer->size; pos++)
+        printf("=== Dump RX Packet, size = %d ===\n", rxSize);
+        for (int pos = 0; pos < rxSize; pos++)
         {
-            printf("%02x ", decodeBuffer->data[pos]);
+            printf("%02x ", rxBuffer[pos]);
         }
         printf("\n=== END ===\n");
 #endif
 
-        _rxLocker.lock();
-        _rxQueue.push_back(decodeBuffer);
+        if (overflowed) {
+            _rxRing.addOverflow(rxSize);
+            continue;
+        }
+
+#ifdef SL_LIDAR_LATENCY_PROFILING
+        // only the oldest pending data is timed, the decoder clears it when picking the data up
+        _u64 idleTs = 0;
+        _rxPendingSince_uS.compare_exchange_strong(idleTs, rxLandTs, std::memory_order_relaxed);
+#endif
+        _rxRing.commitWrite(rxSize, rxTimestamp_uS);
         _dataEvt.set();
-        _rxLocker.unlock();
+    }
+    _workingFlag |= WORKING_FLAG_RX_DISABLED;
+}
+
+void AsyncTransceiver::_rxInlineDecodeSession()
+{
+    assert(_bindedChannel);
+
+    _codec.onDecodeReset();
+
+    // no periodic wakeup while idle either, see _rxSession()
+    const sl_u32 waitMs = _bindedChannel->isWaitCancellable() ? (sl_u32)-1 : (sl_u32)RX_POLL_MS;
+    u_result result;
+    size_t hintedSize = 0;
+    while (_isWorking)
+    {
+        result = _bindedChannel->waitForDataExt(hintedSize, waitMs);
+
+        if (IS_FAIL(result))
+        {
+            // timeout is allowed
+            if (result == RESULT_OPERATION_TIMEOUT) {
+                continue;
+            }
+            if (_isWorking) {
+                _workingFlag |= WORKING_FLAG_ERROR;
+                _codec.onChannelError(result);
+                break;
+            }
+        }
 
+        if (!hintedSize)
+        {
+            continue;
+        }
+        _coalesceRx(hintedSize);
 
+        size_t requiredSize = std::min<size_t>(hintedSize, _rxScratchBuffer.size());
+#ifdef SL_LIDAR_LATENCY_PROFILING
+        _u64 rxStartTs = getus();
+#endif
+        _u64 rxTimestamp_uS = 0;
+        int rxSize = _bindedChannel->readTimestamped(&_rxScratchBuffer[0], requiredSize, rxTimestamp_uS);
+        rxTimestamp_uS = _stampRx(rxTimestamp_uS);
+        SL_TRACE_INSTANT(rp::hal::TRACE_CATEGORY_RX, "rx_read", rxSize);
+#ifdef SL_LIDAR_LATENCY_PROFILING
+        _u64 decodeStartTs = getus();
+        if (_latencyProfile) {
+            _latencyProfile->record(LIDAR_LATENCY_STAGE_RX_READ, decodeStartTs - rxStartTs);
+        }
+#endif
+
+        if (rxSize <= 0) {
+            if (_isWorking) {
+                _workingFlag |= WORKING_FLAG_ERROR;
+                _codec.onChannelError(RESULT_OPERATION_ABORTED);
+            }
+            break;
+        }
+        _recordChunk(CHANNEL_RECORD_DIR_RX, rxTimestamp_uS, &_rxScratchBuffer[0], rxSize);
+
+#ifdef _DEBUG_DUMP_PACKET
+        printf("=== Dump RX Packet, size = %d ===\n", rxSize);
+        for (int pos = 0; pos < rxSize; pos++)
+        {
+            printf("%02x ", _rxScratchBuffer[pos]);
+        }
+        printf("\n=== END ===\n");
+#endif
+
+        _codec.onDecodeData(&_rxScratchBuffer[0], rxSize, rxTimestamp_uS);
+#ifdef SL_LIDAR_LATENCY_PROFILING
+        if (_latencyProfile) {
+            _latencyProfile->recordSince(LIDAR_LATENCY_STAGE_CODEC_DECODE, decodeStartTs);
+        }
+#endif
     }
     _workingFlag |= WORKING_FLAG_RX_DISABLED;
-    return RESULT_OK;
+}
+
+bool AsyncTransceiver::onIOReadable()
+{
+    if (!_isWorking) return false;
+
+#ifdef SL_LIDAR_LATENCY_PROFILING
+    _u64 rxStartTs = getus();
+#endif
+    // the pool mode receives straight into the ring, the pool decodes it from there
+    size_t writableSize = 0;
+    _u8* rxBuffer = _activeDecodePool ? _rxRing.beginWrite(writableSize) : NULL;
+    bool intoRing = (writableSize != 0);
+    if (!intoRing) {
+        rxBuffer = &_rxScratchBuffer[0];
+        writableSize = _rxScratchBuffer.size();
+    }
+
+    _u64 rxTimestamp_uS = 0;
+    int rxSize = _bindedChannel->readTimestamped(rxBuffer, writableSize, rxTimestamp_uS);
+    SL_TRACE_INSTANT(rp::hal::TRACE_CATEGORY_RX, "rx_read", rxSize);
+#ifdef SL_LIDAR_LATENCY_PROFILING
+    if (_latencyProfile) {
+        _latencyProfile->recordSince(LIDAR_LATENCY_STAGE_RX_READ, rxStartTs);
+    }
+#endif
+
+    if (rxSize <= 0) {
+        _workingFlag |= WORKING_FLAG_ERROR | WORKING_FLAG_RX_DISABLED;
+        _codec.onChannelError(RESULT_OPERATION_ABORTED);
+        return false;
+    }
+    if (!_activeDecodePool) return onIOData(rxBuffer, rxSize, rxTimestamp_uS);
+
+    rxTimestamp_uS = _stampRx(rxTimestamp_uS);
+    _recordChunk(CHANNEL_RECORD_DIR_RX, rxTimestamp_uS, rxBuffer, rxSize);
+    if (!intoRing) {
+        // the pool cannot catch up, drop the data
+        _rxRing.addOverflow(rxSize);
+        return true;
+    }
+#ifdef SL_LIDAR_LATENCY_PROFILING
+    _u64 idleTs = 0;
+    _rxPendingSince_uS.compare_exchange_strong(idleTs, getus(), std::memory_order_relaxed);
+#endif
+    _rxRing.commitWrite(rxSize, rxTimestamp_uS);
+    _scheduleDecode();
+    return true;
+}
+
+bool AsyncTransceiver::onIOData(const void* data, size_t size, _u64 rxTimestamp_uS)
+{
+    if (!_isWorking) return false;
+    rxTimestamp_uS = _stampRx(rxTimestamp_uS);
+    if (_activeDecodePool) return _queueRxData(data, size, rxTimestamp_uS);
+
+#ifdef SL_LIDAR_LATENCY_PROFILING
+    _u64 decodeStartTs = getus();
+#endif
+    _recordChunk(CHANNEL_RECORD_DIR_RX, rxTimestamp_uS, data, size);
+
+#ifdef _DEBUG_DUMP_PACKET
+    printf("=== Dump RX Packet, size = %d ===\n", (int)size);
+    for (size_t pos = 0; pos < size; pos++)
+    {
+        printf("%02x ", reinterpret_cast<const _u8*>(data)[pos]);
+    }
+    printf("\n=== END ===\n");
+#endif
+
+    _codec.onDecodeData(data, size, rxTimestamp_uS);
+#ifdef SL_LIDAR_LATENCY_PROFILING
+    if (_latencyProfile) {
+        _latencyProfile->recordSince(LIDAR_LATENCY_STAGE_CODEC_DECODE, decodeStartTs);
+    }
+#endif
+    return true;
 }
 
 sl_result AsyncTransceiver::_proc_decoderThread()
 {
+    rp::hal::Thread::SetSelfConfig(_decoderThreadConfig, "sl_decoder", rp::hal::Thread::PRIORITY_HIGH);
+    rp::hal::prefaultStack(_threadStackPrefault);
 
+    // parked without any wakeup until the next binding, see _proc_rxThread()
+    while (_decoderBindEvt.wait() == rp::hal::Event::EVENT_OK && !_isRetiringThreads) {
+        _decoderSession();
+        _decoderParkedEvt.set();
+    }
+    return RESULT_OK;
+}
+
+void AsyncTransceiver::_decoderSession()
+{
     assert(_bindedChannel);
-    rp::hal::Thread::SetSelfPriority(rp::hal::Thread::PRIORITY_HIGH);
     _codec.onDecodeReset();
-    
+
 
     while (_isWorking)
     {
-        _rxLocker.lock();
+        size_t pendingSize;
+        _u64 rxTimestamp_uS;
+        const _u8* bufferToDecode = _rxRing.beginRead(pendingSize, rxTimestamp_uS);
 
-        if (_rxQueue.empty())
+        if (!pendingSize)
         {
-            _rxLocker.unlock();
+            // set by the rx thread for the data, and by unbindAndClose()
+            _dataEvt.wait();
+            continue;
+        }
+        SL_TRACE_INSTANT(rp::hal::TRACE_CATEGORY_DECODE, "decoder_wakeup", pendingSize);
 
-            if (_dataEvt.wait(1000))
-                continue;
+        _decodeRingData(bufferToDecode, pendingSize, rxTimestamp_uS);
+    }
+}
 
-            _rxLocker.lock();
-        }
-        assert(!_rxQueue.empty());
+void AsyncTransceiver::_decodeRingData(const _u8* buffer, size_t size, _u64 rxTimestamp_uS)
+{
+#ifdef SL_LIDAR_LATENCY_PROFILING
+    _u64 decodeStartTs = getus();
+    _u64 pendingSinceTs = _rxPendingSince_uS.exchange(0, std::memory_order_relaxed);
+    if (_latencyProfile && pendingSinceTs) {
+        _latencyProfile->record(LIDAR_LATENCY_STAGE_RX_QUEUE, decodeStartTs > pendingSinceTs ? decodeStartTs - pendingSinceTs : 0);
+    }
+#endif
+    _codec.onDecodeData(buffer, size, rxTimestamp_uS);
+#ifdef SL_LIDAR_LATENCY_PROFILING
+    if (_latencyProfile) {
+        _latencyProfile->recordSince(LIDAR_LATENCY_STAGE_CODEC_DECODE, decodeStartTs);
+    }
+#endif
 
-        Buffer * bufferToDecode = _rxQueue.front();
-        _rxQueue.pop_front();
+    _rxRing.commitRead(size);
+    if (_rxMaxBlockMs.load(std::memory_order_relaxed)) {
+        _rxSpaceEvt.set();
+    }
+}
+
+// the data stays in the channel meanwhile, the ones with a flow control hold the device back
+_u8* AsyncTransceiver::_waitRxRoom(size_t requiredSize, size_t& writableSize)
+{
+    _u64 startTs = getus();
+    _u64 deadline = getms() + _rxMaxBlockMs.load(std::memory_order_relaxed);
+    _u8* rxBuffer = _rxRing.beginWrite(writableSize);
+    while (writableSize < requiredSize && _isWorking && _rxMaxBlockMs.load(std::memory_order_relaxed)) {
+        _u64 now = getms();
+        if (now >= deadline) {
+            _rxBlockTimeouts.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        _rxSpaceEvt.wait((_u32)(deadline - now));
+        rxBuffer = _rxRing.beginWrite(writableSize);
+    }
+    _rxBlocked_uS.fetch_add(getus() - startTs, std::memory_order_relaxed);
+    return rxBuffer;
+}
 
-        _rxLocker.unlock();
+bool AsyncTransceiver::_queueRxData(const void* data, size_t size, _u64 rxTimestamp_uS)
+{
+    _recordChunk(CHANNEL_RECORD_DIR_RX, rxTimestamp_uS, data, size);
+
+    const _u8* src = reinterpret_cast<const _u8*>(data);
+    while (size) {
+        size_t writableSize;
+        _u8* dst = _rxRing.beginWrite(writableSize);
+        if (!writableSize) {
+            // the pool cannot catch up, drop the rest
+            _rxRing.addOverflow(size);
+            break;
+        }
 
-        //cout<<"decoding "<< bufferToDecode->size <<" bytes of data"<<endl;
-        _codec.onDecodeData(bufferToDecode->data, bufferToDecode->size);
+        size_t chunkSize = std::min(size, writableSize);
+        memcpy(dst, src, chunkSize);
+#ifdef SL_LIDAR_LATENCY_PROFILING
+        _u64 idleTs = 0;
+        _rxPendingSince_uS.compare_exchange_strong(idleTs, getus(), std::memory_order_relaxed);
+#endif
+        _rxRing.commitWrite(chunkSize, rxTimestamp_uS);
+        src += chunkSize;
+        size -= chunkSize;
+    }
+    _scheduleDecode();
+    return true;
+}
 
+void AsyncTransceiver::_scheduleDecode()
+{
+    if (!_decodeScheduled.exchange(true)) {
+        _activeDecodePool->submit(this);
+    }
+}
 
-        delete bufferToDecode;
+// runs on the pool, never on two threads at once as it is only submitted again once it has started
+void AsyncTransceiver::run()
+{
+    rp::hal::AutoLocker l(_decodeLocker);
+
+    size_t pendingSize = 0;
+    _u64 rxTimestamp_uS;
+    for (size_t chunk = 0; _isWorking && chunk < POOL_DECODE_BATCH_CHUNKS; ++chunk) {
+        const _u8* bufferToDecode = _rxRing.beginRead(pendingSize, rxTimestamp_uS);
+        if (!pendingSize) break;
+        _decodeRingData(bufferToDecode, pendingSize, rxTimestamp_uS);
     }
 
-    return RESULT_OK;
+    _decodeScheduled.store(false);
+    if (!_isWorking) {
+        // the unbinding waits for it, see _waitDecodeIdle()
+        _decodeIdleEvt.set();
+        return;
+    }
+    // the data left or queued meanwhile goes behind the other devices queued on the pool
+    _rxRing.beginRead(pendingSize, rxTimestamp_uS);
+    if (pendingSize) _scheduleDecode();
+}
 
+void AsyncTransceiver::_waitDecodeIdle()
+{
+    // nothing is queued once the handle is removed, the decoding still scheduled sees _isWorking cleared
+    // and sets the event as it ends; a signal left by an earlier unbinding only costs another check
+    for (;;) {
+        {
+            rp::hal::AutoLocker l(_decodeLocker);
+            if (!_decodeScheduled) return;
+        }
+        _decodeIdleEvt.wait();
+    }
 }
 
 
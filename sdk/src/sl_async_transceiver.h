@@ -32,17 +32,34 @@
 
 #pragma once
 
-#include <list>
+#include <vector>
+#include <string>
 #include <memory>
+#include <atomic>
+
+#include "hal/io_reactor.h"
+#include "hal/work_pool.h"
+#include "sl_allocator.h"
+#ifdef SL_LIDAR_LATENCY_PROFILING
+#include "sl_latency_histogram.h"
+#endif
 
 namespace sl { namespace internal {
 
+class ChannelRecorder;
 
+// the payloads up to INLINE_PAYLOAD_SIZE bytes, which covers the command answers and the capsules,
+// are kept in the message itself; the bigger ones go to a buffer reused for the next payloads
 class _single_thread ProtocolMessage {
 
 public:
+	enum {
+		INLINE_PAYLOAD_SIZE = 96,
+	};
+
 	size_t len;			
 	_u8 cmd;
+	_u64 rxTimestamp_uS; // capture time of the chunk completing a decoded message, 0 if unknown
 protected:
 	_u8* data;
 	size_t _databufsize;
@@ -51,14 +68,18 @@ public:
 	ProtocolMessage();
 	ProtocolMessage(_u8 cmd, const void* buffer, size_t size);
 	ProtocolMessage(const ProtocolMessage& srcMsg);
+	// takes the buffer of the source, which is left empty
+	ProtocolMessage(ProtocolMessage&& srcMsg);
 	virtual ~ProtocolMessage();
 
 	ProtocolMessage& operator=(const ProtocolMessage& srcMessage);
+	ProtocolMessage& operator=(ProtocolMessage&& srcMessage);
 
 	// avoid use this method, pls. use fillData instead
 	void setDataBuf(_u8* buffer, size_t size);
 
 	_u8* getDataBuf() { return data; }
+	const _u8* getDataBuf() const { return data; }
 
 	void fillData(const void* buffer, size_t size);
 	void cleanData();
@@ -74,7 +95,9 @@ protected:
 	// the existing buffer will be reused if possible.
 	// all the existing payload data will lose
 	void _changeBufSize(bool force_compact = false);
+	void _takeData(ProtocolMessage& srcMsg);
 	bool _usingOutterData;
+	_u8  _inlineData[INLINE_PAYLOAD_SIZE];
 };
 
 
@@ -82,6 +105,85 @@ protected:
 typedef std::shared_ptr<ProtocolMessage> message_autoptr_t;
 
 
+// the copies of the answers handed to the command callers, drawn from a free list of messages
+// whose shared_ptr control blocks live next to them, so a steady request/response traffic does not allocate;
+// a message stays valid after the pool is released, it keeps the pool until it is freed
+class ProtocolMessagePool : public std::enable_shared_from_this<ProtocolMessagePool> {
+public:
+	enum {
+		DEFAULT_CAPACITY = 8,
+	};
+
+	static std::shared_ptr<ProtocolMessagePool> create(size_t capacity = DEFAULT_CAPACITY);
+	~ProtocolMessagePool();
+
+	// from the heap once all the pooled messages are in use
+	message_autoptr_t acquire(const ProtocolMessage& srcMsg);
+
+	size_t getFreeCount();
+
+private:
+	enum {
+		CONTROL_BLOCK_SIZE = 64,
+	};
+
+	struct Slot {
+		ProtocolMessage message;
+		Slot*           next;
+		union {
+			_u8         data[CONTROL_BLOCK_SIZE];
+			_u64        align;
+			void*       alignPtr;
+		} controlBlock;
+	};
+
+	// places the control block of a pooled message in its slot, which is back on the free list once the block is released
+	template <class T>
+	class SlotAllocator
+	{
+	public:
+		typedef T value_type;
+
+		SlotAllocator(const std::shared_ptr<ProtocolMessagePool>& pool, Slot* slot) : _pool(pool), _slot(slot) {}
+
+		template <class U>
+		SlotAllocator(const SlotAllocator<U>& other) : _pool(other._pool), _slot(other._slot) {}
+
+		T* allocate(size_t count)
+		{
+			static_assert(sizeof(T) <= CONTROL_BLOCK_SIZE, "the control block does not fit in the slot");
+			assert(count == 1);
+			return reinterpret_cast<T*>(_slot->controlBlock.data);
+		}
+
+		void deallocate(T*, size_t)
+		{
+			_pool->_release(_slot);
+		}
+
+		template <class U>
+		bool operator==(const SlotAllocator<U>& other) const { return _slot == other._slot; }
+		template <class U>
+		bool operator!=(const SlotAllocator<U>& other) const { return _slot != other._slot; }
+
+		std::shared_ptr<ProtocolMessagePool> _pool;
+		Slot*                                _slot;
+	};
+
+	struct NullDeleter {
+		void operator()(ProtocolMessage*) const {}
+	};
+
+	explicit ProtocolMessagePool(size_t capacity);
+	void _release(Slot* slot);
+
+	rp::hal::Locker _locker;
+	Slot*           _slots;
+	Slot*           _freeList;
+	size_t          _freeCount;
+};
+
+
 class IAsyncProtocolCodec {
 public:
 	IAsyncProtocolCodec() {}
@@ -90,16 +192,107 @@ public:
 	virtual void   onChannelError(u_result errCode) {}
 
 	virtual void   onDecodeReset() {}
-	virtual void   onDecodeData(const void* buffer, size_t size) = 0;
+	// rxTimestamp_uS is the capture time of the data reported by the channel, 0 if unknown
+	virtual void   onDecodeData(const void* buffer, size_t size, _u64 rxTimestamp_uS = 0) = 0;
 
 
-	virtual size_t estimateLength(message_autoptr_t& message) = 0;
-	virtual void   onEncodeData(message_autoptr_t& message, _u8* txbuffer, size_t* size) = 0;
+	virtual size_t estimateLength(const ProtocolMessage& message) = 0;
+	virtual void   onEncodeData(const ProtocolMessage& message, _u8* txbuffer, size_t* size) = 0;
 
 };
 
-class AsyncTransceiver {
+// Fixed capacity single-producer/single-consumer byte ring
+// The producer (rx thread) receives data directly into the ring, the consumer (decoder thread)
+// decodes the data in place. No lock is required as long as there is only one thread on each side.
+// The chunks carrying a capture time are marked, the reads stop at their ends so that each comes with its own time.
+class _multi_thread RxRingBuffer {
 public:
+	enum {
+		DEFAULT_CAPACITY = 64 * 1024, // must be power of 2
+		MAX_CONTIGUOUS_WRITE = 4096,
+		MAX_TIMESTAMP_MARKS = 256,    // must be power of 2, the chunks beyond share the time of the next mark
+	};
+
+	RxRingBuffer(size_t capacity = DEFAULT_CAPACITY);
+	~RxRingBuffer();
+
+	// discard all the pending data, must NOT be called when any of the producer or the consumer is working
+	void reset();
+
+	// touches every page of the ring, same restriction as reset()
+	void prefault();
+
+	size_t getCapacity() const {
+		return _capacity;
+	}
+
+	// producer side:
+	// returns a contiguous region that can hold at most maxsize bytes (maxsize is 0 if the ring is full)
+	_u8* beginWrite(size_t& maxsize);
+	// rxTimestamp_uS is the capture time of the committed chunk, 0 if unknown
+	void commitWrite(size_t size, _u64 rxTimestamp_uS = 0);
+
+	// consumer side:
+	// returns the oldest contiguous region of the pending data (size is 0 if the ring is empty)
+	// and the capture time of the chunk it ends with, 0 if unknown
+	const _u8* beginRead(size_t& size, _u64& rxTimestamp_uS);
+	void commitRead(size_t size);
+
+	void addOverflow(size_t droppedBytes) {
+		_overflowBytes += droppedBytes;
+		++_overflowCount;
+	}
+
+	_u64 getOverflowCount() const {
+		return _overflowCount;
+	}
+
+	_u64 getOverflowBytes() const {
+		return _overflowBytes;
+	}
+
+	// the bytes waiting for the consumer
+	size_t getPendingSize() const {
+		return _writePos.load(std::memory_order_acquire) - _readPos.load(std::memory_order_acquire);
+	}
+
+	// the most bytes found waiting for the consumer after a write since the last reset
+	size_t getHighWaterMark() const {
+		return _highWater.load(std::memory_order_relaxed);
+	}
+
+protected:
+	_u8*   _buffer; // _capacity + MAX_CONTIGUOUS_WRITE bytes, the tail part is used for wrapping writes
+	size_t _capacity;
+	size_t _mask;
+
+	std::atomic<size_t> _writePos;
+	std::atomic<size_t> _readPos;
+
+	struct TimestampMark {
+		size_t endPos;
+		_u64   timestamp_uS;
+	};
+	TimestampMark       _marks[MAX_TIMESTAMP_MARKS];
+	std::atomic<size_t> _markWritePos;
+	std::atomic<size_t> _markReadPos;
+
+	std::atomic<_u64>   _overflowCount;
+	std::atomic<_u64>   _overflowBytes;
+	std::atomic<size_t> _highWater;         // only written by the producer
+
+private:
+	RxRingBuffer(const RxRingBuffer&);
+	RxRingBuffer& operator=(const RxRingBuffer&);
+};
+
+class AsyncTransceiver : public rp::hal::IOReactorHandler, protected rp::hal::WorkItem {
+public:
+
+	enum {
+		// sync + cmd + size + 255 bytes payload + checksum
+		DEFAULT_TX_BUFFER_SIZE = 1 + 1 + 1 + 255 + 1,
+	};
 
 	enum working_flag_t
 	{
@@ -109,31 +302,160 @@ public:
 		WORKING_FLAG_ERROR = 0x1L << 31,
 	};
 
+	enum decode_mode_t
+	{
+		// the rx thread queues the received data, a dedicated decoder thread decodes it
+		DECODE_MODE_THREADED = 0,
+		// the rx thread decodes the received data directly, no decoder thread is created.
+		// the codec callbacks will block the rx thread, keep them light.
+		DECODE_MODE_INLINE = 1,
+		// the data is received and decoded by the threads of a shared IOReactor, see setIOReactor()
+		DECODE_MODE_REACTOR = 2,
+		// the data is received by a shared IOReactor and decoded by a shared WorkStealingPool, see setDecodePool()
+		DECODE_MODE_REACTOR_POOL = 3,
+	};
+
+	enum {
+		// the chunks decoded in a row on the pool, the other devices queued on the same thread go before the rest
+		POOL_DECODE_BATCH_CHUNKS = 16,
+		// the rx thread looks for the end of the binding this often on a channel whose waits cannot be canceled
+		RX_POLL_MS = 1000,
+	};
+
 
 	AsyncTransceiver(IAsyncProtocolCodec& codec);
-	~AsyncTransceiver();
+	virtual ~AsyncTransceiver();
+
+	// use a shared reactor instead of the private threads, takes effect on the next openChannelAndBind()
+	// the private threads will still be used if the channel has no native handle
+	void setIOReactor(rp::hal::IOReactor* reactor) {
+		_ioReactor = reactor;
+	}
+
+	// decode the data received by the reactor on the pool, takes effect on the next openChannelAndBind()
+	void setDecodePool(rp::hal::WorkStealingPool* pool) {
+		_decodePool = pool;
+	}
 
 
 
-	u_result openChannelAndBind(IChannel* channel);
+	u_result openChannelAndBind(IChannel* channel, decode_mode_t decodeMode = DECODE_MODE_THREADED);
 	void     unbindAndClose();
 
+	// the rx threads gather at least minBatch bytes, or wait at most maxWaitMs for them, before reading
+	void setRxCoalescing(size_t minBatch, _u32 maxWaitMs) {
+		_rxMinBatch = minBatch;
+		_rxMaxWaitMs = maxWaitMs;
+	}
+
+	// how the private rx and decoder threads are named, pinned and scheduled, takes effect on the next openChannelAndBind()
+	// the rx thread config also applies to the rx thread decoding inline.
+	// the private threads are parked between the bindings and bound again to the next channel, a changed config
+	// or stack prefault size makes the next openChannelAndBind() start new ones
+	void setThreadConfig(const rp::hal::Thread::config_t& rx, const rp::hal::Thread::config_t& decoder);
+
+	// the bytes of stack the private threads touch when they start, takes effect on the next openChannelAndBind()
+	void setThreadStackPrefault(size_t size) {
+		_threadStackPrefault = size;
+	}
+
+	// touches the pages of the rx and tx buffers, only while not bound
+	void prefaultBuffers();
+
 	IChannel* getBindedChannel() const {
 		return _bindedChannel;
 	}
+
+	decode_mode_t getDecodeMode() const {
+		return _decodeMode;
+	}
 	
 	u_result sendMessage(message_autoptr_t& msg);
+	// the message is encoded into an internal tx buffer, the caller may place it on stack
+	u_result sendMessage(const ProtocolMessage& msg);
+
+	// times and bytes of the received data being dropped as the decoder cannot catch up
+	_u64 getRxOverflowCount() const {
+		return _rxRing.getOverflowCount();
+	}
+
+	_u64 getRxOverflowBytes() const {
+		return _rxRing.getOverflowBytes();
+	}
+
+	size_t getRxQueueCapacity() const {
+		return _rxRing.getCapacity();
+	}
+
+	size_t getRxQueuePendingSize() const {
+		return _rxRing.getPendingSize();
+	}
+
+	size_t getRxQueueHighWaterMark() const {
+		return _rxRing.getHighWaterMark();
+	}
+
+	// the private rx thread waits up to maxBlockMs for the decoder to make room in the rx ring instead of
+	// dropping the data, 0 to drop it at once; the rx threads of a reactor never wait
+	void setRxBlocking(_u32 maxBlockMs) {
+		_rxMaxBlockMs = maxBlockMs;
+		_rxSpaceEvt.set();
+	}
+
+	_u64 getRxBlockedTime_uS() const {
+		return _rxBlocked_uS.load(std::memory_order_relaxed);
+	}
+
+	_u64 getRxBlockTimeouts() const {
+		return _rxBlockTimeouts.load(std::memory_order_relaxed);
+	}
+
+	// the rx chunks and tx messages are also written into the recorder while it is recording, NULL to stop
+	void setRecorder(ChannelRecorder* recorder) {
+		_recorder = recorder;
+	}
+
+	// the rx chunks are stamped with its time as they are read instead of the capture time of the channel, NULL to stop
+	void setClock(ILidarClock* clock) {
+		_clock.store(clock, std::memory_order_release);
+	}
+
+#ifdef SL_LIDAR_LATENCY_PROFILING
+	// the rx read, rx queue and codec decode stages are recorded into the profile, NULL to stop
+	void setLatencyProfile(LatencyProfile* profile) {
+		_latencyProfile = profile;
+	}
+#endif
 
 protected:
 
+	// the private threads: each waits parked for a binding, serves it and parks again until it is retired
 	sl_result _proc_rxThread();
 	sl_result _proc_decoderThread();
+	void _rxSession();
+	void _rxInlineDecodeSession();
+	void _decoderSession();
+	void _retireThreads();
+
+	_u64 _stampRx(_u64 rxTimestamp_uS);
+	void _recordChunk(_u8 direction, _u64 timestamp_uS, const void* data, size_t size);
+	void _coalesceRx(size_t& hintedSize);
+	_u8* _waitRxRoom(size_t requiredSize, size_t& writableSize);
+
+	virtual bool onIOReadable();
+	virtual bool onIOData(const void* data, size_t size, _u64 rxTimestamp_uS);
+
+	// the pool mode: the reactor threads queue the data into the rx ring, the pool decodes it
+	bool _queueRxData(const void* data, size_t size, _u64 rxTimestamp_uS);
+	void _decodeRingData(const _u8* buffer, size_t size, _u64 rxTimestamp_uS);
+	void _scheduleDecode();
+	virtual void run();
+	void _waitDecodeIdle();
 
 protected:
 
 
 	rp::hal::Locker _opLocker;
-	rp::hal::Locker _rxLocker;
 	rp::hal::Event  _dataEvt;
 
 	IChannel* _bindedChannel;
@@ -142,25 +464,54 @@ protected:
 
 	bool _isWorking;
 	_u32 _workingFlag;
+	decode_mode_t _decodeMode;
 
 	rp::hal::Thread _rxThread;
 	rp::hal::Thread _decoderThread;
-
-	struct Buffer {
-		size_t size;
-		_u8* data;
-
-
-		Buffer() : size(0), data(NULL){}
-
-		~Buffer() {
-			if (data) {
-				delete[] data;
-				data = NULL;
-			}
-		}
-	};
-	std::list< Buffer * > _rxQueue;
+	rp::hal::Event  _rxBindEvt;         // wakes up the parked thread for a new binding, or to retire it
+	rp::hal::Event  _decoderBindEvt;
+	rp::hal::Event  _rxParkedEvt;       // set by the thread once it leaves the binding
+	rp::hal::Event  _decoderParkedEvt;
+	bool            _isRxBound;         // the threads serve the current binding
+	bool            _isDecoderBound;
+	bool            _isRetiringThreads;
+	_u32            _threadConfigVersion;   // bumped by setThreadConfig
+	_u32            _spawnedConfigVersion;  // the config and the prefault size the parked threads started with
+	size_t          _spawnedStackPrefault;
+	rp::hal::Thread::config_t _rxThreadConfig;
+	rp::hal::Thread::config_t _decoderThreadConfig;
+	std::string               _rxThreadName;      // the storage of the config names
+	std::string               _decoderThreadName;
+	size_t                    _threadStackPrefault;
+
+	rp::hal::IOReactor* _ioReactor;
+	rp::hal::IOReactor* _activeReactor;
+	int                 _reactorHandle;
+
+	rp::hal::WorkStealingPool* _decodePool;
+	rp::hal::WorkStealingPool* _activeDecodePool;
+	rp::hal::Locker     _decodeLocker;      // held by the pool while decoding, so the unbinding waits for it
+	std::atomic<bool>   _decodeScheduled;   // submitted to the pool and not finished yet, at most once at a time
+	rp::hal::Event      _decodeIdleEvt;     // set by the decoding ending after the unbinding
+
+	RxRingBuffer      _rxRing;
+	sdk_vector<_u8>   _rxScratchBuffer; // drop area on overflow, or the rx buffer in inline decode mode
+	sdk_vector<_u8>   _txBuffer;        // protected by _opLocker
+	ChannelRecorder*  _recorder;
+	std::atomic<ILidarClock*> _clock;   // see setClock
+
+	std::atomic<size_t> _rxMinBatch;    // the coalescing policy, read by the rx threads at each round
+	std::atomic<_u32>   _rxMaxWaitMs;
+
+	std::atomic<_u32>   _rxMaxBlockMs;  // see setRxBlocking
+	rp::hal::Event      _rxSpaceEvt;    // set by the decoder after each read while the rx thread may wait
+	std::atomic<_u64>   _rxBlocked_uS;
+	std::atomic<_u64>   _rxBlockTimeouts;
+
+#ifdef SL_LIDAR_LATENCY_PROFILING
+	LatencyProfile*   _latencyProfile;
+	std::atomic<_u64> _rxPendingSince_uS; // landing time of the oldest data not picked by the decoder, 0 if none
+#endif
 };
 
 
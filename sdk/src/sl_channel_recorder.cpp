@@ -0,0 +1,158 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "hal/thread.h"
+#include "hal/byteorder.h"
+
+#include "sl_lidar_driver.h"
+#include "sl_channel_recorder.h"
+
+namespace sl { namespace internal {
+
+ChannelRecorder::ChannelRecorder()
+    : _bufferLocker(false)
+    , _fp(NULL)
+    , _isWorking(false)
+    , _droppedBytes(0)
+{
+}
+
+ChannelRecorder::~ChannelRecorder()
+{
+    stop();
+}
+
+u_result ChannelRecorder::start(const char* path)
+{
+    if (!path) return RESULT_INVALID_DATA;
+
+    stop();
+
+    _fp = fopen(path, "wb");
+    if (!_fp) return RESULT_OPERATION_FAIL;
+
+    ChannelRecordFileHeader header;
+    header.magic = cpu_to_le32(CHANNEL_RECORD_MAGIC);
+    header.version = cpu_to_le16(CHANNEL_RECORD_VERSION);
+    header.reserved = 0;
+    header.start_uS = cpu_to_le64(getus());
+    if (fwrite(&header, sizeof(header), 1, _fp) != 1) {
+        fclose(_fp);
+        _fp = NULL;
+        return RESULT_OPERATION_FAIL;
+    }
+
+    _pendingBuffer.reserve(BUFFER_SIZE);
+    _writingBuffer.reserve(BUFFER_SIZE);
+    _droppedBytes.store(0, std::memory_order_relaxed);
+    _dataEvt.set(false);
+
+    _isWorking.store(true, std::memory_order_release);
+    _writerThread = CLASS_THREAD(ChannelRecorder, _proc_writerThread);
+    return RESULT_OK;
+}
+
+void ChannelRecorder::stop()
+{
+    {
+        rp::hal::AutoLocker l(_bufferLocker);
+        if (!_isWorking.load(std::memory_order_relaxed)) return;
+        _isWorking.store(false, std::memory_order_release);
+    }
+
+    _dataEvt.set();
+    _writerThread.join();
+
+    // the chunks queued after the last round of the writer
+    _flushPending();
+    fclose(_fp);
+    _fp = NULL;
+}
+
+void ChannelRecorder::record(_u8 direction, _u64 timestamp_uS, const void* data, size_t size)
+{
+    ChannelRecordHeader header;
+    header.timestamp_uS = cpu_to_le64(timestamp_uS);
+    header.size = cpu_to_le32((_u32)size);
+    header.direction = direction;
+
+    size_t pendingSize;
+    {
+        rp::hal::AutoLocker l(_bufferLocker);
+        if (!_isWorking.load(std::memory_order_relaxed)) return;
+
+        if (_pendingBuffer.size() + sizeof(header) + size > BUFFER_SIZE) {
+            // the writer cannot catch up, never grow the buffer or wait here
+            _droppedBytes.store(_droppedBytes.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+            return;
+        }
+
+        const _u8* headerBytes = reinterpret_cast<const _u8*>(&header);
+        _pendingBuffer.insert(_pendingBuffer.end(), headerBytes, headerBytes + sizeof(header));
+        _pendingBuffer.insert(_pendingBuffer.end(), reinterpret_cast<const _u8*>(data), reinterpret_cast<const _u8*>(data) + size);
+        pendingSize = _pendingBuffer.size();
+    }
+
+    if (pendingSize >= WAKEUP_THRESHOLD) {
+        _dataEvt.set();
+    }
+}
+
+void ChannelRecorder::_flushPending()
+{
+    {
+        rp::hal::AutoLocker l(_bufferLocker);
+        _pendingBuffer.swap(_writingBuffer);
+    }
+
+    if (!_writingBuffer.empty()) {
+        fwrite(&_writingBuffer[0], 1, _writingBuffer.size(), _fp);
+        _writingBuffer.clear();
+    }
+}
+
+u_result ChannelRecorder::_proc_writerThread()
+{
+    while (_isWorking.load(std::memory_order_acquire)) {
+        _dataEvt.wait(WRITER_PERIOD_MS);
+        _flushPending();
+    }
+    fflush(_fp);
+    return RESULT_OK;
+}
+
+}}
@@ -0,0 +1,124 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+#include <atomic>
+
+// Append-only binary capture of the raw traffic of a channel.
+// Users must include sdkcommon.h, hal/locker.h, hal/event.h and hal/thread.h first.
+//
+// File layout, all the fields are little endian:
+//   ChannelRecordFileHeader
+//   ChannelRecordHeader + payload, for each rx chunk or tx command in the order they were seen
+
+namespace sl { namespace internal {
+
+enum {
+    CHANNEL_RECORD_MAGIC = 0x43524C53, // "SLRC"
+    CHANNEL_RECORD_VERSION = 1,
+
+    CHANNEL_RECORD_DIR_RX = 0,
+    CHANNEL_RECORD_DIR_TX = 1,
+};
+
+#if defined(_WIN32)
+#pragma pack(1)
+#endif
+
+typedef struct _channel_record_file_header_t {
+    _u32 magic;
+    _u16 version;
+    _u16 reserved;
+    _u64 start_uS;      // getus() when the recording started
+} __attribute__((packed)) ChannelRecordFileHeader;
+
+typedef struct _channel_record_header_t {
+    _u64 timestamp_uS;  // rx: the capture time the samples of the chunk are stamped with, tx: the driver clock when it was written
+    _u32 size;          // the bytes of payload following the header
+    _u8  direction;     // CHANNEL_RECORD_DIR_xxx
+} __attribute__((packed)) ChannelRecordHeader;
+
+#if defined(_WIN32)
+#pragma pack()
+#endif
+
+// The chunks are queued into a memory buffer and written by a background thread,
+// so the rx thread never waits for the file io. The chunks arriving while the buffer
+// is full are dropped and counted.
+class ChannelRecorder
+{
+public:
+    enum {
+        BUFFER_SIZE = 1024 * 1024,      // the pending chunks kept in memory
+        WAKEUP_THRESHOLD = 64 * 1024,   // the pending size to wake the writer up before its period
+        WRITER_PERIOD_MS = 100,
+    };
+
+    ChannelRecorder();
+    ~ChannelRecorder();
+
+    u_result start(const char* path);
+    void stop();
+
+    bool isRecording() const {
+        return _isWorking.load(std::memory_order_relaxed);
+    }
+
+    void record(_u8 direction, _u64 timestamp_uS, const void* data, size_t size);
+
+    _u64 getDroppedBytes() const {
+        return _droppedBytes.load(std::memory_order_relaxed);
+    }
+
+protected:
+    u_result _proc_writerThread();
+    void _flushPending();
+
+    rp::hal::Locker   _bufferLocker;    // guards _pendingBuffer
+    rp::hal::Event    _dataEvt;
+    std::vector<_u8>  _pendingBuffer;
+    std::vector<_u8>  _writingBuffer;   // only used by the writer thread, or by stop() once it is joined
+    FILE*             _fp;
+
+    std::atomic<bool> _isWorking;
+    std::atomic<_u64> _droppedBytes;
+    rp::hal::Thread   _writerThread;
+
+private:
+    ChannelRecorder(const ChannelRecorder&);
+    ChannelRecorder& operator=(const ChannelRecorder&);
+};
+
+}}
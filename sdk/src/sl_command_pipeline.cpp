@@ -0,0 +1,205 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "hal/thread.h"
+#include "hal/byteorder.h"
+
+#include "sl_lidar_driver.h"
+#include "sl_async_transceiver.h"
+#include "sl_command_pipeline.h"
+
+namespace sl { namespace internal {
+
+CommandPipeline::CommandPipeline()
+    : _locker(false)
+    , _nextTicket(0)
+    , _isTimerWorking(false)
+{
+}
+
+CommandPipeline::~CommandPipeline()
+{
+    abortAll(RESULT_OPERATION_STOP);
+
+    bool wasWorking;
+    {
+        rp::hal::AutoLocker l(_locker);
+        wasWorking = _isTimerWorking;
+        _isTimerWorking = false;
+    }
+
+    if (wasWorking) {
+        _timerEvt.set();
+        _timerThread.join();
+    }
+}
+
+bool CommandPipeline::_isConfAnswer(_u8 ansType)
+{
+    return ansType == SL_LIDAR_ANS_TYPE_GET_LIDAR_CONF || ansType == SL_LIDAR_ANS_TYPE_SET_LIDAR_CONF;
+}
+
+u_result CommandPipeline::expect(_u8 ansType, _u32 confType, _u32 timeout, const AnswerHandler& handler, _u32& ticket)
+{
+    rp::hal::AutoLocker l(_locker);
+    if (_pending.size() >= MAX_INFLIGHT_COMMANDS) return RESULT_INSUFFICIENT_MEMORY;
+
+    PendingCommand command;
+    command.ticket = ticket = ++_nextTicket;
+    command.ansType = ansType;
+    command.confType = confType;
+    command.deadline_ms = getms() + timeout;
+    command.handler = handler;
+    _pending.push_back(command);
+
+    if (!_isTimerWorking) {
+        _isTimerWorking = true;
+        _timerThread = CLASS_THREAD(CommandPipeline, _proc_timerThread);
+    }
+    else {
+        _timerEvt.set();
+    }
+    return RESULT_OK;
+}
+
+void CommandPipeline::cancel(_u32 ticket, u_result reason)
+{
+    AnswerHandler handler;
+    {
+        rp::hal::AutoLocker l(_locker);
+        for (std::vector<PendingCommand>::iterator itr = _pending.begin(); itr != _pending.end(); ++itr) {
+            if (itr->ticket == ticket) {
+                handler.swap(itr->handler);
+                _pending.erase(itr);
+                break;
+            }
+        }
+    }
+
+    if (handler) handler(reason, NULL);
+}
+
+void CommandPipeline::abortAll(u_result reason)
+{
+    std::vector<PendingCommand> aborted;
+    {
+        rp::hal::AutoLocker l(_locker);
+        aborted.swap(_pending);
+    }
+
+    for (size_t pos = 0; pos < aborted.size(); ++pos) {
+        aborted[pos].handler(reason, NULL);
+    }
+}
+
+bool CommandPipeline::onAnswer(const ProtocolMessage& message)
+{
+    AnswerHandler handler;
+    {
+        rp::hal::AutoLocker l(_locker);
+
+        _u32 confType = ANY_CONF_TYPE;
+        if (_isConfAnswer(message.cmd) && message.getPayloadSize() >= sizeof(_u32)) {
+            memcpy(&confType, message.getDataBuf(), sizeof(confType));
+            confType = le32_to_cpu(confType);
+        }
+
+        std::vector<PendingCommand>::iterator matched = _pending.end();
+        for (std::vector<PendingCommand>::iterator itr = _pending.begin(); itr != _pending.end(); ++itr) {
+            if (itr->ansType != message.cmd) continue;
+            if (itr->confType == ANY_CONF_TYPE || itr->confType == confType) {
+                matched = itr;
+                break;
+            }
+            // the legacy devices do not echo the entry in every answer, keep the oldest one as the fallback
+            if (matched == _pending.end()) matched = itr;
+        }
+        if (matched == _pending.end()) return false;
+
+        handler.swap(matched->handler);
+        _pending.erase(matched);
+    }
+
+    handler(RESULT_OK, &message);
+    return true;
+}
+
+size_t CommandPipeline::getPendingCount()
+{
+    rp::hal::AutoLocker l(_locker);
+    return _pending.size();
+}
+
+u_result CommandPipeline::_proc_timerThread()
+{
+    rp::hal::Thread::config_t config;
+    memset(&config, 0, sizeof(config));
+    rp::hal::Thread::SetSelfConfig(config, "sl_cmd_timer", rp::hal::Thread::PRIORITY_NORMAL);
+
+    while (true) {
+        std::vector<AnswerHandler> expired;
+        _u64 nextDeadline = 0;
+        {
+            rp::hal::AutoLocker l(_locker);
+            if (!_isTimerWorking) break;
+
+            _u64 now = getms();
+            for (size_t pos = 0; pos < _pending.size();) {
+                if (_pending[pos].deadline_ms <= now) {
+                    expired.push_back(_pending[pos].handler);
+                    _pending.erase(_pending.begin() + pos);
+                    continue;
+                }
+                if (!nextDeadline || _pending[pos].deadline_ms < nextDeadline) {
+                    nextDeadline = _pending[pos].deadline_ms;
+                }
+                ++pos;
+            }
+            if (nextDeadline) nextDeadline -= now;
+        }
+
+        for (size_t pos = 0; pos < expired.size(); ++pos) {
+            expired[pos](RESULT_OPERATION_TIMEOUT, NULL);
+        }
+
+        // woken up early by each new command, which may expire sooner, and sleeps for good with none pending
+        _timerEvt.wait(nextDeadline ? (unsigned long)nextDeadline : 0xFFFFFFFF);
+    }
+    return RESULT_OK;
+}
+
+}}
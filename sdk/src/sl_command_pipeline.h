@@ -0,0 +1,100 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include <vector>
+#include <functional>
+
+// The commands sent and still waiting for their answers.
+// Users must include sdkcommon.h, hal/locker.h, hal/event.h, hal/thread.h and sl_async_transceiver.h first.
+//
+// The device answers the commands in the order they were received, so an answer is given to the
+// oldest command waiting for its type. The configuration answers also carry the configuration
+// entry, which keeps the queries of different entries apart.
+
+namespace sl { namespace internal {
+
+class CommandPipeline
+{
+public:
+    enum {
+        MAX_INFLIGHT_COMMANDS = 8,
+        ANY_CONF_TYPE = 0xFFFFFFFF,  // the command is not a configuration query
+    };
+
+    // called once per command, with the answer, or without it on a timeout or an abort
+    typedef std::function<void(u_result, const ProtocolMessage*)> AnswerHandler;
+
+    CommandPipeline();
+    ~CommandPipeline();
+
+    // registers the answer expected by a command about to be sent
+    // fails with RESULT_INSUFFICIENT_MEMORY when MAX_INFLIGHT_COMMANDS are already waiting
+    u_result expect(_u8 ansType, _u32 confType, _u32 timeout, const AnswerHandler& handler, _u32& ticket);
+
+    // gives up the command, typically when it could not be sent
+    void cancel(_u32 ticket, u_result reason);
+
+    // fails all the waiting commands, for example once disconnected
+    void abortAll(u_result reason);
+
+    // returns true when the message answers a waiting command
+    bool onAnswer(const ProtocolMessage& message);
+
+    size_t getPendingCount();
+
+protected:
+    struct PendingCommand {
+        _u32          ticket;
+        _u8           ansType;
+        _u32          confType;
+        _u64          deadline_ms;
+        AnswerHandler handler;
+    };
+
+    static bool _isConfAnswer(_u8 ansType);
+    u_result _proc_timerThread();
+
+    rp::hal::Locker              _locker;        // guards all the fields below
+    rp::hal::Event               _timerEvt;
+    std::vector<PendingCommand>  _pending;       // in the order the commands were sent
+    _u32                         _nextTicket;
+    bool                         _isTimerWorking;
+    rp::hal::Thread              _timerThread;   // completes the commands timed out, started by the first command
+
+private:
+    CommandPipeline(const CommandPipeline&);
+    CommandPipeline& operator=(const CommandPipeline&);
+};
+
+}}
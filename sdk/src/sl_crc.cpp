@@ -31,10 +31,72 @@
   */
 
 #include "sl_crc.h"  
+#include "hal/cpu_features.h"
+#include <string.h>
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+// the CRC32 instructions are always available if the compiler targets them
+#include <arm_acle.h>
+#define SL_CRC32_ARMV8_CRC
+#define SL_CRC32_ARMV8_TARGET
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+// otherwise they are used once the cpu is found to support them
+#include <arm_acle.h>
+#define SL_CRC32_ARMV8_CRC
+#if defined(__clang__)
+#define SL_CRC32_ARMV8_TARGET __attribute__((target("crc")))
+#else
+#define SL_CRC32_ARMV8_TARGET __attribute__((target("+crc")))
+#endif
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SL_CRC32_X86_PCLMUL
+#define SL_CRC32_PCLMUL_TARGET __attribute__((target("pclmul,sse4.1")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#define SL_CRC32_X86_PCLMUL
+#define SL_CRC32_PCLMUL_TARGET
+#endif
 
 namespace sl {namespace crc32 {
-    
-    static sl_u32 table[256];//crc32_table
+
+    // compile time generated lookup tables for the reflected poly 0x04C11DB7
+    // _tables.t[0] is the classic byte-wise table, t[1..7] are used by slice-by-8
+    namespace {
+        struct SliceTables {
+            sl_u32 t[8][256];
+        };
+
+        template <size_t... I> struct _IndexSeq {};
+        template <size_t N, size_t... I> struct _MakeIndexSeq : _MakeIndexSeq<N - 1, N - 1, I...> {};
+        template <size_t... I> struct _MakeIndexSeq<0, I...> { typedef _IndexSeq<I...> type; };
+
+        constexpr sl_u32 REFLECTED_POLY = 0xEDB88320;
+
+        constexpr sl_u32 _crcBits(sl_u32 c, int bits)
+        {
+            return bits ? _crcBits((c & 1) ? (REFLECTED_POLY ^ (c >> 1)) : (c >> 1), bits - 1) : c;
+        }
+
+        constexpr sl_u32 _sliceEntry(int slice, sl_u32 c)
+        {
+            return slice ? ((_sliceEntry(slice - 1, c) >> 8) ^ _crcBits(_sliceEntry(slice - 1, c) & 0xFF, 8)) : _crcBits(c, 8);
+        }
+
+        template <size_t... I>
+        constexpr SliceTables _makeTables(_IndexSeq<I...>)
+        {
+            return SliceTables{ {
+                { _sliceEntry(0, I)... }, { _sliceEntry(1, I)... }, { _sliceEntry(2, I)... }, { _sliceEntry(3, I)... },
+                { _sliceEntry(4, I)... }, { _sliceEntry(5, I)... }, { _sliceEntry(6, I)... }, { _sliceEntry(7, I)... },
+            } };
+        }
+
+        constexpr SliceTables _tables = _makeTables(_MakeIndexSeq<256>::type());
+    }
+
+    static sl_u32 table[256];//crc32_table, runtime generated by init()
+
     sl_u32 bitrev(sl_u32 input, sl_u16 bw)
     {
         sl_u16 i;
@@ -89,14 +151,186 @@ namespace sl {namespace crc32 {
         return crc ^ 0xffffffff;
     }
 
-    sl_result getResult(sl_u8 *ptr, sl_u32 len) 
+
+    static inline sl_u32 _updateBytewise(sl_u32 crc, const sl_u8* data, size_t len)
+    {
+        while (len--) {
+            crc = (crc >> 8) ^ _tables.t[0][(crc ^ *data++) & 0xFF];
+        }
+        return crc;
+    }
+
+    static inline sl_u32 _loadLE32(const sl_u8* data)
+    {
+        return (sl_u32)data[0] | ((sl_u32)data[1] << 8) | ((sl_u32)data[2] << 16) | ((sl_u32)data[3] << 24);
+    }
+
+    static sl_u32 _updateSliceBy8(sl_u32 crc, const sl_u8* data, size_t len)
+    {
+        const sl_u32 (*t)[256] = _tables.t;
+
+        while (len >= 8) {
+            sl_u32 lo = crc ^ _loadLE32(data);
+            sl_u32 hi = _loadLE32(data + 4);
+
+            crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+                ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+
+            data += 8;
+            len -= 8;
+        }
+        return _updateBytewise(crc, data, len);
+    }
+
+#if defined(SL_CRC32_ARMV8_CRC)
+
+    SL_CRC32_ARMV8_TARGET static sl_u32 _updateArmv8(sl_u32 crc, const sl_u8* data, size_t len)
+    {
+        while (len >= 8) {
+            sl_u64 val;
+            memcpy(&val, data, sizeof(val));
+            crc = __crc32d(crc, val);
+            data += 8;
+            len -= 8;
+        }
+        while (len--) {
+            crc = __crc32b(crc, *data++);
+        }
+        return crc;
+    }
+
+#elif defined(SL_CRC32_X86_PCLMUL)
+
+    enum {
+        PCLMUL_MIN_LENGTH = 64,
+    };
+
+    // fold 64 bytes per round with the carry-less multiplication, then perform the Barrett reduction
+    // see "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction", Intel, 2009
+    SL_CRC32_PCLMUL_TARGET static sl_u32 _updatePclmul(sl_u32 crc, const sl_u8* data, size_t len)
+    {
+        if (len < PCLMUL_MIN_LENGTH) return _updateSliceBy8(crc, data, len);
+
+        const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+        const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+        const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+        const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+        const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+        __m128i x1, x2, x3, x4, x5, x6, x7, x8;
+
+        x1 = _mm_loadu_si128((const __m128i*)(data + 0x00));
+        x2 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+        x3 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+        x4 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+        x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+
+        data += 64;
+        len -= 64;
+
+        while (len >= 64) {
+            x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+            x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+            x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+            x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+            x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+            x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+            x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+            x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(data + 0x00)));
+            x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(data + 0x10)));
+            x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(data + 0x20)));
+            x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(data + 0x30)));
+
+            data += 64;
+            len -= 64;
+        }
+
+        // fold the 4 lanes into 128 bits
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+        // the remaining 16 bytes blocks
+        while (len >= 16) {
+            x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)data)), x5);
+
+            data += 16;
+            len -= 16;
+        }
+
+        // fold 128 bits to 64 bits
+        x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+        x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+        x2 = _mm_srli_si128(x1, 4);
+        x1 = _mm_and_si128(x1, mask32);
+        x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+        x1 = _mm_xor_si128(x1, x2);
+
+        // Barrett reduction to 32 bits
+        x2 = _mm_and_si128(x1, mask32);
+        x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+        x2 = _mm_and_si128(x2, mask32);
+        x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+        x1 = _mm_xor_si128(x1, x2);
+
+        crc = (sl_u32)_mm_extract_epi32(x1, 1);
+        return _updateSliceBy8(crc, data, len);
+    }
+
+#endif
+
+    typedef sl_u32 (*crc_update_proc_t)(sl_u32 crc, const sl_u8* data, size_t len);
+
+    static crc_update_proc_t _selectUpdateProc(sl_u32 features)
+    {
+#if defined(SL_CRC32_ARMV8_CRC)
+        if (rp::hal::hasCpuFeatures(features, rp::hal::CPU_FEATURE_ARM_CRC32)) return _updateArmv8;
+#elif defined(SL_CRC32_X86_PCLMUL)
+        if (rp::hal::hasCpuFeatures(features, rp::hal::CPU_FEATURE_PCLMUL | rp::hal::CPU_FEATURE_SSE4_1)) return _updatePclmul;
+#endif
+        return _updateSliceBy8;
+    }
+
+    static std::atomic<crc_update_proc_t> _updateProc(_updateSliceBy8);
+
+    static void _bindUpdateProc(sl_u32 features)
+    {
+        _updateProc.store(_selectUpdateProc(features), std::memory_order_relaxed);
+    }
+
+    static rp::hal::CpuKernelBinding _updateBinding(_bindUpdateProc);
+
+    sl_u32 update(sl_u32 crc, const void* input, size_t len)
     {
-        static sl_u8 tmp;
-        if (tmp != 1) {
-            init(0x4C11DB7);
-            tmp = 1;
+        return _updateProc.load(std::memory_order_relaxed)(crc, reinterpret_cast<const sl_u8*>(input), len);
+    }
+
+    sl_u32 updateZeros(sl_u32 crc, size_t count)
+    {
+        while (count--) {
+            crc = (crc >> 8) ^ _tables.t[0][crc & 0xFF];
         }
+        return crc;
+    }
 
-        return cal(0xFFFFFFFF, ptr, len);
+    sl_result getResult(const sl_u8 *ptr, sl_u32 len) 
+    {
+        sl_u32 crc = update(0xFFFFFFFF, ptr, len);
+        crc = updateZeros(crc, 4 - (len & 0x3)); //zero padding
+        return crc ^ 0xFFFFFFFF;
     }
-}}
\ No newline at end of file
+}}
@@ -0,0 +1,171 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include <atomic>
+#include <string.h>
+
+#include "sl_lidar_driver.h"
+
+// Latency histograms of the receive pipeline, fed only when built with SL_LIDAR_LATENCY_PROFILING,
+// and of the paced scan delivery.
+// Users must include sdkcommon.h first.
+
+namespace sl { namespace internal {
+
+    // Log-linear histogram of microsecond values, each power of 2 is split into 8 buckets,
+    // so a bucket is at most 1/8 of its value wide. Lock free, any thread may record or read.
+    class LatencyHistogram
+    {
+    public:
+        enum {
+            SUB_BUCKET_BITS = 3,
+            SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS,
+            BUCKET_COUNT = (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT, // values up to 2^32 uS
+        };
+
+        LatencyHistogram()
+        {
+            reset();
+        }
+
+        void reset()
+        {
+            for (size_t pos = 0; pos < BUCKET_COUNT; ++pos) {
+                _buckets[pos].store(0, std::memory_order_relaxed);
+            }
+            _sum.store(0, std::memory_order_relaxed);
+            _max.store(0, std::memory_order_relaxed);
+        }
+
+        void record(_u64 value_uS)
+        {
+            _buckets[_bucketOf(value_uS)].fetch_add(1, std::memory_order_relaxed);
+            _sum.fetch_add(value_uS, std::memory_order_relaxed);
+
+            _u64 currentMax = _max.load(std::memory_order_relaxed);
+            while (value_uS > currentMax
+                && !_max.compare_exchange_weak(currentMax, value_uS, std::memory_order_relaxed)) {
+            }
+        }
+
+        void getStats(LidarLatencyStats& stats) const
+        {
+            _u64 counts[BUCKET_COUNT];
+            memset(&stats, 0, sizeof(stats));
+            for (size_t pos = 0; pos < BUCKET_COUNT; ++pos) {
+                counts[pos] = _buckets[pos].load(std::memory_order_relaxed);
+                stats.count += counts[pos];
+            }
+            stats.sum_uS = _sum.load(std::memory_order_relaxed);
+            stats.max_uS = _max.load(std::memory_order_relaxed);
+            if (!stats.count) return;
+
+            stats.p50_uS = _percentile(counts, stats.count, 500);
+            stats.p90_uS = _percentile(counts, stats.count, 900);
+            stats.p99_uS = _percentile(counts, stats.count, 990);
+            stats.p999_uS = _percentile(counts, stats.count, 999);
+        }
+
+    protected:
+        static size_t _bucketOf(_u64 value)
+        {
+            if (value < SUB_BUCKET_COUNT) return (size_t)value;
+            if (value > 0xFFFFFFFFULL) value = 0xFFFFFFFFULL;
+
+            int msb = SUB_BUCKET_BITS;
+            while (value >> (msb + 1)) ++msb;
+            return (size_t)(msb - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT
+                + (size_t)((value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1));
+        }
+
+        // the largest value falls into the bucket
+        static _u64 _bucketUpperBound(size_t bucket)
+        {
+            if (bucket < SUB_BUCKET_COUNT) return bucket;
+
+            int shift = (int)(bucket / SUB_BUCKET_COUNT) - 1;
+            _u64 lower = (_u64)(SUB_BUCKET_COUNT + bucket % SUB_BUCKET_COUNT) << shift;
+            return lower + ((_u64)1 << shift) - 1;
+        }
+
+        // permille: 500 for the median
+        static _u64 _percentile(const _u64* counts, _u64 total, _u64 permille)
+        {
+            _u64 rank = (total * permille + 999) / 1000;
+            _u64 seen = 0;
+            for (size_t pos = 0; pos < BUCKET_COUNT; ++pos) {
+                seen += counts[pos];
+                if (seen >= rank) return _bucketUpperBound(pos);
+            }
+            return _bucketUpperBound(BUCKET_COUNT - 1);
+        }
+
+        std::atomic<_u64> _buckets[BUCKET_COUNT];
+        std::atomic<_u64> _sum;
+        std::atomic<_u64> _max;
+    };
+
+    // the histograms of all the stages of one driver instance
+    class LatencyProfile
+    {
+    public:
+        void record(LidarLatencyStage stage, _u64 value_uS)
+        {
+            _stages[stage].record(value_uS);
+        }
+
+        // records the time passed since startTs_uS
+        void recordSince(LidarLatencyStage stage, _u64 startTs_uS)
+        {
+            _u64 now = getus();
+            _stages[stage].record(now > startTs_uS ? now - startTs_uS : 0);
+        }
+
+        void getStats(LidarLatencyStage stage, LidarLatencyStats& stats) const
+        {
+            _stages[stage].getStats(stats);
+        }
+
+        void reset()
+        {
+            for (size_t pos = 0; pos < LIDAR_LATENCY_STAGE_COUNT; ++pos) {
+                _stages[pos].reset();
+            }
+        }
+
+    protected:
+        LatencyHistogram _stages[LIDAR_LATENCY_STAGE_COUNT];
+    };
+
+}}
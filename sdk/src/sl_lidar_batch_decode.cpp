@@ -0,0 +1,512 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "hal/thread.h"
+#include "hal/byteorder.h"
+#include "hal/mapped_file.h"
+#include "hal/work_pool.h"
+
+#include "sl_lidar_driver.h"
+#include "sl_lidar_batch_decode.h"
+#include "dataunpacker/dataunpacker.h"
+#include "dataunpacker/dataunnpacker_commondef.h"
+#include "dataunpacker/dataunnpacker_internal.h"
+#if defined(SL_LIDAR_STATIC_UNPACKER_HANDLER)
+#include "dataunpacker/unpacker/handler_capsules.h"
+#include "dataunpacker/unpacker/handler_hqnode.h"
+#include "dataunpacker/unpacker/handler_normalnode.h"
+#include "dataunpacker/dataunpacker_static.h"
+#endif
+#include "sl_async_transceiver.h"
+#include "sl_lidarprotocol_codec.h"
+#include "sl_channel_recorder.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <thread>
+
+namespace sl {
+
+    namespace internal {
+
+        enum {
+            BATCH_LEAD_PACKETS = DeviceClockEstimator::WINDOW_SIZE, // decoded ahead of each shard, the longest look back
+            BATCH_SHARDS_PER_THREAD = 2,                            // in flight, bounds the memory of the decoded nodes
+        };
+
+        // a run of the rx data of a capture, with the capture time it was stamped with
+        struct CaptureChunk
+        {
+            const _u8* data;
+            size_t     size;
+            _u64       timestamp_uS;
+        };
+
+        // Decodes a shard of a sample stream on a worker of the pool, with a codec and an unpacker of its own.
+        // The codec is put into the loop mode of the stream by its answer header, then the lead packets warm up the
+        // unpacker: the nodes published meanwhile belong to the shard before and are dropped.
+        class BatchDecodeShard : public rp::hal::WorkItem
+            , public LIDARSampleDataListener
+            , public IProtocolMessageListener
+        {
+        public:
+            BatchDecodeShard(const SlamtecLidarTimingDesc& timing)
+                : endsStream(false)
+                , _leadPackets(0)
+                , _packetIdx(0)
+                , _isKept(false)
+            {
+                memset(&_header, 0, sizeof(_header));
+#if defined(SL_LIDAR_STATIC_UNPACKER_HANDLER)
+                _unpacker.reset(new StaticSampleDataUnpacker<unpacker::SL_LIDAR_STATIC_UNPACKER_HANDLER, BatchDecodeShard>(*this));
+#else
+                _unpacker.reset(LIDARSampleDataUnpacker::CreateInstance(*this));
+#endif
+                _unpacker->updateUnpackerContext(LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_LIDAR_TIMING, &timing, sizeof(timing));
+                _codec.setMessageListener(this);
+            }
+
+            // on the thread of decodeLidarCapture, while the shard is not queued
+            void prepare(const sl_lidar_ans_header_t& header, size_t leadPackets, bool isLast)
+            {
+                _header = header;
+                _leadPackets = leadPackets;
+                endsStream = isLast;
+                chunks.clear();
+                nodes.clear();
+                timestamps.clear();
+                resets.clear();
+            }
+
+            void wait()
+            {
+                _done.wait();
+            }
+
+            virtual void run()
+            {
+                _codec.onDecodeReset();
+                _unpacker->reset();
+                _unpacker->enable();
+                _packetIdx = 0;
+                _isKept = !_leadPackets;
+
+                _codec.onDecodeData(&_header, sizeof(_header));
+                for (size_t pos = 0; pos < chunks.size(); ++pos) {
+                    _codec.onDecodeData(chunks[pos].data, chunks[pos].size, chunks[pos].timestamp_uS);
+                }
+                _unpacker->disable();
+                _done.set();
+            }
+
+            virtual void onProtocolMessageDecoded(const ProtocolMessage& msg)
+            {
+                _isKept = (_packetIdx++ >= _leadPackets);
+                _unpacker->onSampleData(msg.cmd, msg.getDataBuf(), msg.getPayloadSize(), msg.rxTimestamp_uS);
+            }
+
+            virtual void onHQNodeScanResetReq()
+            {
+                if (_isKept) resets.push_back(nodes.size());
+            }
+
+            virtual void onHQNodeDecoded(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node)
+            {
+                if (!_isKept) return;
+                nodes.push_back(*node);
+                timestamps.push_back(timestamp_uS);
+            }
+
+            virtual void onHQNodesDecoded(const rplidar_response_measurement_node_hq_t* decoded, const _u64* timestamps_uS, size_t count)
+            {
+                if (!_isKept) return;
+                nodes.insert(nodes.end(), decoded, decoded + count);
+                timestamps.insert(timestamps.end(), timestamps_uS, timestamps_uS + count);
+            }
+
+            std::vector<CaptureChunk> chunks;   // from the first lead packet to the end of the shard
+            bool endsStream;
+
+            // the output, in the order of the stream
+            std::vector<sl_lidar_response_measurement_node_hq_t> nodes;
+            std::vector<_u64> timestamps;
+            std::vector<size_t> resets;         // the node positions the unpacker asked to restart the scan at
+
+        private:
+            sl_lidar_ans_header_t _header;
+            size_t _leadPackets;
+            size_t _packetIdx;
+            bool   _isKept;
+
+            RPLidarProtocolCodec _codec;
+            std::unique_ptr<LIDARSampleDataUnpacker> _unpacker;
+            rp::hal::Event _done;
+        };
+
+        // Assembles the nodes of the shards into revolutions, as the scan holder of the driver does:
+        // the nodes from a sync node to the next one form a scan, the partial ones are dropped
+        class BatchScanAssembler
+        {
+        public:
+            BatchScanAssembler(ILidarBatchScanSink& sink)
+                : _sink(sink)
+                , _isCollecting(false)
+                , _scans(0)
+                , _nodeCount(0)
+            {
+            }
+
+            sl_result push(const BatchDecodeShard& shard)
+            {
+                size_t resetIdx = 0;
+                for (size_t pos = 0; pos < shard.nodes.size(); ++pos) {
+                    while (resetIdx < shard.resets.size() && shard.resets[resetIdx] <= pos) {
+                        ++resetIdx;
+                        _restart();
+                    }
+
+                    const sl_lidar_response_measurement_node_hq_t& node = shard.nodes[pos];
+                    if (node.flag & SL_LIDAR_RESP_HQ_FLAG_SYNCBIT) {
+                        if (_isCollecting && !_nodes.empty()) {
+                            sl_result ans = _sink.onScan(&_nodes[0], &_timestamps[0], _nodes.size(), _timestamps[0]);
+                            if (SL_IS_FAIL(ans)) return ans;
+                            ++_scans;
+                            _nodeCount += _nodes.size();
+                        }
+                        _restart();
+                        _isCollecting = true;
+                    }
+                    else if (!_isCollecting) {
+                        continue;
+                    }
+                    _nodes.push_back(node);
+                    _timestamps.push_back(shard.timestamps[pos]);
+                }
+
+                // the revolution in progress at the end of a stream is never completed
+                if (shard.endsStream) _restart();
+                return SL_RESULT_OK;
+            }
+
+            sl_u64 getScanCount() const { return _scans; }
+            sl_u64 getNodeCount() const { return _nodeCount; }
+
+        private:
+            void _restart()
+            {
+                _isCollecting = false;
+                _nodes.clear();
+                _timestamps.clear();
+            }
+
+            ILidarBatchScanSink& _sink;
+            bool _isCollecting;
+            std::vector<sl_lidar_response_measurement_node_hq_t> _nodes;
+            std::vector<sl_u64> _timestamps;
+            sl_u64 _scans;
+            sl_u64 _nodeCount;
+        };
+
+        // Walks the rx data of a capture on the thread of decodeLidarCapture and cuts its sample streams into shards.
+        // Out of the streams, the answers are framed as the codec does; the commands the driver exits the loop mode
+        // for end the stream in progress, as they reset the codec of the driver.
+        class CaptureSplitter
+        {
+        public:
+            CaptureSplitter(const LidarBatchDecodeOptions& options, rp::hal::WorkStealingPool& pool,
+                std::vector<std::unique_ptr<BatchDecodeShard> >& shards, BatchScanAssembler& assembler)
+                : _pool(pool)
+                , _shards(shards)
+                , _assembler(assembler)
+                , _shardBytes(options.shard_bytes)
+                , _headerPos(0)
+                , _payloadLeft(0)
+                , _isStreaming(false)
+                , _packetSize(0)
+                , _streamPos(0)
+                , _shardStart(0)
+                , _dispatched(0)
+                , _merged(0)
+                , _result(SL_RESULT_OK)
+            {
+                memset(&_header, 0, sizeof(_header));
+                memset(&stats, 0, sizeof(stats));
+            }
+
+            void onRxChunk(const _u8* data, size_t size, _u64 timestamp_uS)
+            {
+                while (size && SL_IS_OK(_result)) {
+                    if (_isStreaming) {
+                        CaptureChunk chunk = { data, size, timestamp_uS };
+                        _appendStreamData(chunk);
+                        return;
+                    }
+
+                    size_t consumed = _frameAnswer(data, size);
+                    data += consumed;
+                    size -= consumed;
+                }
+            }
+
+            void onTxCommand(const _u8* data, size_t size)
+            {
+                if (size < 2 || data[0] != SL_LIDAR_CMD_SYNC_BYTE) return;
+                switch (data[1]) {
+                case SL_LIDAR_CMD_STOP:
+                case SL_LIDAR_CMD_RESET:
+                case SL_LIDAR_CMD_SCAN:
+                case SL_LIDAR_CMD_FORCE_SCAN:
+                case SL_LIDAR_CMD_EXPRESS_SCAN:
+                    endStream();
+                    _headerPos = 0;
+                    _payloadLeft = 0;
+                    break;
+                }
+            }
+
+            // dispatches the rest of the stream in progress
+            void endStream()
+            {
+                if (!_isStreaming) return;
+                _isStreaming = false;
+                _dispatchShard(_streamPos, true);
+                _pending.clear();
+            }
+
+            // waits for all the shards dispatched, returns the first failure of the sink
+            sl_result finish()
+            {
+                endStream();
+                while (_merged < _dispatched) _mergeOne();
+                stats.scans = _assembler.getScanCount();
+                stats.nodes = _assembler.getNodeCount();
+                return _result;
+            }
+
+            LidarBatchDecodeStats stats;
+
+        private:
+            struct PendingChunk
+            {
+                CaptureChunk chunk;
+                size_t       streamPos;  // of its first byte
+            };
+
+            // the bytes of the answers out of the sample streams, returns the bytes consumed
+            size_t _frameAnswer(const _u8* data, size_t size)
+            {
+                if (_payloadLeft) {
+                    size_t skipped = std::min(_payloadLeft, size);
+                    _payloadLeft -= skipped;
+                    return skipped;
+                }
+
+                _u8* header = reinterpret_cast<_u8*>(&_header);
+                size_t pos = 0;
+                while (pos < size) {
+                    _u8 current = data[pos++];
+                    if (_headerPos == 0 && current != SL_LIDAR_ANS_SYNC_BYTE1) continue;
+                    if (_headerPos == 1 && current != SL_LIDAR_ANS_SYNC_BYTE2) {
+                        _headerPos = 0;
+                        continue;
+                    }
+                    header[_headerPos++] = current;
+                    if (_headerPos < sizeof(_header)) continue;
+
+                    _headerPos = 0;
+                    _u32 sizeFlag = le32_to_cpu(_header.size_q30_subtype);
+                    size_t payloadSize = sizeFlag & SL_LIDAR_ANS_HEADER_SIZE_MASK;
+                    if (!payloadSize) continue;
+                    if ((sizeFlag >> SL_LIDAR_ANS_HEADER_SUBTYPE_SHIFT) & SL_LIDAR_ANS_PKTFLAG_LOOP) {
+                        _beginStream(payloadSize);
+                    }
+                    else {
+                        _payloadLeft = payloadSize;
+                    }
+                    break;
+                }
+                return pos;
+            }
+
+            void _beginStream(size_t packetSize)
+            {
+                _isStreaming = true;
+                _packetSize = packetSize;
+                _streamPos = 0;
+                _shardStart = 0;
+                _pending.clear();
+                ++stats.streams;
+
+                // whole packets in each shard, a single one at least
+                _shardLength = std::max<size_t>(_shardBytes / packetSize, 1) * packetSize;
+            }
+
+            void _appendStreamData(const CaptureChunk& chunk)
+            {
+                PendingChunk entry = { chunk, _streamPos };
+                _pending.push_back(entry);
+                _streamPos += chunk.size;
+                stats.sample_bytes += chunk.size;
+
+                while (_streamPos - _shardStart >= _shardLength && SL_IS_OK(_result)) {
+                    _dispatchShard(_shardStart + _shardLength, false);
+                }
+            }
+
+            // the shard from _shardStart to end, with the lead packets before it
+            void _dispatchShard(size_t end, bool isLast)
+            {
+                if (end <= _shardStart && !isLast) return;
+
+                if (_dispatched - _merged == _shards.size()) _mergeOne();
+                BatchDecodeShard& shard = *_shards[_dispatched % _shards.size()];
+
+                size_t leadStart = (_shardStart > BATCH_LEAD_PACKETS * _packetSize) ? _shardStart - BATCH_LEAD_PACKETS * _packetSize : 0;
+                shard.prepare(_header, (_shardStart - leadStart) / _packetSize, isLast);
+                for (size_t pos = 0; pos < _pending.size(); ++pos) {
+                    const PendingChunk& entry = _pending[pos];
+                    size_t chunkEnd = entry.streamPos + entry.chunk.size;
+                    if (chunkEnd <= leadStart) continue;
+                    if (entry.streamPos >= end) break;
+
+                    size_t from = std::max(entry.streamPos, leadStart);
+                    size_t to = std::min(chunkEnd, end);
+                    CaptureChunk slice = { entry.chunk.data + (from - entry.streamPos), to - from, entry.chunk.timestamp_uS };
+                    shard.chunks.push_back(slice);
+                }
+                _pool.submit(&shard);
+                ++_dispatched;
+                ++stats.shards;
+                _shardStart = end;
+
+                // keep the chunks still needed by the lead packets of the next shard
+                size_t nextLeadStart = (_shardStart > BATCH_LEAD_PACKETS * _packetSize) ? _shardStart - BATCH_LEAD_PACKETS * _packetSize : 0;
+                size_t dropped = 0;
+                while (dropped < _pending.size() && _pending[dropped].streamPos + _pending[dropped].chunk.size <= nextLeadStart) ++dropped;
+                _pending.erase(_pending.begin(), _pending.begin() + dropped);
+            }
+
+            void _mergeOne()
+            {
+                BatchDecodeShard& shard = *_shards[_merged % _shards.size()];
+                shard.wait();
+                ++_merged;
+                if (SL_IS_OK(_result)) _result = _assembler.push(shard);
+            }
+
+            rp::hal::WorkStealingPool& _pool;
+            std::vector<std::unique_ptr<BatchDecodeShard> >& _shards;
+            BatchScanAssembler& _assembler;
+            size_t _shardBytes;
+
+            // out of the streams
+            sl_lidar_ans_header_t _header;  // of the stream in progress once it has begun
+            size_t _headerPos;
+            size_t _payloadLeft;            // of the answer being skipped
+
+            // in a stream, the positions count its bytes
+            bool   _isStreaming;
+            size_t _packetSize;
+            size_t _shardLength;
+            size_t _streamPos;
+            size_t _shardStart;
+            std::vector<PendingChunk> _pending;
+
+            size_t _dispatched;
+            size_t _merged;
+            sl_result _result;
+        };
+    }
+
+    using namespace internal;
+
+    sl_result decodeLidarCapture(const std::string& path, ILidarBatchScanSink& sink, const LidarBatchDecodeOptions& options, LidarBatchDecodeStats* stats)
+    {
+        if (!options.timing.sample_duration_uS || !options.shard_bytes) return SL_RESULT_INVALID_DATA;
+
+        rp::hal::MappedFile file;
+        if (!file.open(path.c_str(), true)) return SL_RESULT_OPERATION_FAIL;
+        const _u8* data = file.data();
+        size_t size = file.size();
+
+        const ChannelRecordFileHeader* fileHeader = reinterpret_cast<const ChannelRecordFileHeader*>(data);
+        bool isRecording = (size >= sizeof(*fileHeader) && le32_to_cpu(fileHeader->magic) == CHANNEL_RECORD_MAGIC);
+        if (isRecording && le16_to_cpu(fileHeader->version) != CHANNEL_RECORD_VERSION) return SL_RESULT_INVALID_DATA;
+
+        int threadCount = options.thread_count > 0 ? options.thread_count : (int)std::thread::hardware_concurrency();
+        threadCount = std::min<int>(std::max(threadCount, 1), rp::hal::WorkStealingPool::MAX_THREAD_COUNT);
+        rp::hal::WorkStealingPool* pool = rp::hal::WorkStealingPool::CreatePool(threadCount);
+        if (!pool) return SL_RESULT_OPERATION_FAIL;
+
+        std::vector<std::unique_ptr<BatchDecodeShard> > shards;
+        for (int pos = 0; pos < threadCount * BATCH_SHARDS_PER_THREAD; ++pos) {
+            shards.push_back(std::unique_ptr<BatchDecodeShard>(new BatchDecodeShard(options.timing)));
+        }
+
+        sl_result ans;
+        {
+            BatchScanAssembler assembler(sink);
+            CaptureSplitter splitter(options, *pool, shards, assembler);
+            if (!isRecording) {
+                splitter.onRxChunk(data, size, 0);
+            }
+            else {
+                size_t pos = sizeof(*fileHeader);
+                while (pos + sizeof(ChannelRecordHeader) <= size) {
+                    const ChannelRecordHeader* header = reinterpret_cast<const ChannelRecordHeader*>(data + pos);
+                    size_t recordSize = le32_to_cpu(header->size);
+                    pos += sizeof(ChannelRecordHeader);
+                    if (recordSize > size - pos) break; // truncated
+
+                    if (header->direction == CHANNEL_RECORD_DIR_RX) {
+                        splitter.onRxChunk(data + pos, recordSize, le64_to_cpu(header->timestamp_uS));
+                    }
+                    else {
+                        splitter.onTxCommand(data + pos, recordSize);
+                    }
+                    pos += recordSize;
+                }
+            }
+            ans = splitter.finish();
+            if (stats) *stats = splitter.stats;
+        }
+
+        rp::hal::WorkStealingPool::ReleasePool(pool);
+        return ans;
+    }
+}
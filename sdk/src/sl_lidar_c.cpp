@@ -0,0 +1,215 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sl_lidar_c.h"
+#include "sl_lidar_driver.h"
+#include <atomic>
+#include <new>
+
+using namespace sl;
+
+struct sl_lidar_driver
+{
+    ILidarDriver*   driver;
+    IChannel*       channel;    // owned, replaced by each connect
+};
+
+// one slot of the process wide pool, so that lending a scan does not allocate;
+// the pool is not tied to a driver as a lease outlives it
+struct sl_lidar_scan_lease
+{
+    std::atomic<bool>   used;
+    LidarScanLease      scan;
+};
+
+static sl_lidar_scan_lease g_scanLeases[SL_LIDAR_C_MAX_SCAN_LEASES];
+
+static sl_lidar_scan_lease* _claimLeaseSlot()
+{
+    for (size_t pos = 0; pos < SL_LIDAR_C_MAX_SCAN_LEASES; ++pos) {
+        bool expected = false;
+        if (!g_scanLeases[pos].used.load(std::memory_order_relaxed)
+            && g_scanLeases[pos].used.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return &g_scanLeases[pos];
+        }
+    }
+    return NULL;
+}
+
+static void _freeLeaseSlot(sl_lidar_scan_lease* slot)
+{
+    slot->scan.reset();
+    slot->used.store(false, std::memory_order_release);
+}
+
+static sl_result _connect(sl_lidar_driver_t* driver, Result<IChannel*> channel)
+{
+    if (!driver) return SL_RESULT_INVALID_DATA;
+    if (!channel) return channel.err;
+
+    driver->driver->disconnect();
+    delete driver->channel;
+    driver->channel = *channel;
+    return driver->driver->connect(driver->channel);
+}
+
+extern "C" {
+
+sl_u32 sl_lidar_c_abi_version(void)
+{
+    return SL_LIDAR_C_ABI_VERSION;
+}
+
+sl_result sl_lidar_create(sl_lidar_driver_t** driver)
+{
+    if (!driver) return SL_RESULT_INVALID_DATA;
+    *driver = NULL;
+
+    Result<ILidarDriver*> lidar = createLidarDriver();
+    if (!lidar) return lidar.err;
+
+    sl_lidar_driver_t* handle = new (std::nothrow) sl_lidar_driver_t;
+    if (!handle) {
+        delete *lidar;
+        return SL_RESULT_INSUFFICIENT_MEMORY;
+    }
+    handle->driver = *lidar;
+    handle->channel = NULL;
+    *driver = handle;
+    return SL_RESULT_OK;
+}
+
+void sl_lidar_destroy(sl_lidar_driver_t* driver)
+{
+    if (!driver) return;
+    driver->driver->disconnect();
+    delete driver->driver;
+    delete driver->channel;
+    delete driver;
+}
+
+sl_result sl_lidar_connect_serial(sl_lidar_driver_t* driver, const char* device, sl_u32 baudrate)
+{
+    if (!device) return SL_RESULT_INVALID_DATA;
+    return _connect(driver, createSerialPortChannel(device, (int)baudrate));
+}
+
+sl_result sl_lidar_connect_tcp(sl_lidar_driver_t* driver, const char* ip, sl_u16 port)
+{
+    if (!ip) return SL_RESULT_INVALID_DATA;
+    return _connect(driver, createTcpChannel(ip, port));
+}
+
+sl_result sl_lidar_connect_udp(sl_lidar_driver_t* driver, const char* ip, sl_u16 port)
+{
+    if (!ip) return SL_RESULT_INVALID_DATA;
+    return _connect(driver, createUdpChannel(ip, port));
+}
+
+sl_result sl_lidar_connect_simulator(sl_lidar_driver_t* driver, sl_u8 ans_type, sl_u32 sample_rate, float scan_frequency)
+{
+    LidarSimulatorConfig config = { ans_type, sample_rate, scan_frequency };
+    return _connect(driver, createSimulatorChannel(config));
+}
+
+void sl_lidar_disconnect(sl_lidar_driver_t* driver)
+{
+    if (driver) driver->driver->disconnect();
+}
+
+int sl_lidar_is_connected(sl_lidar_driver_t* driver)
+{
+    return driver && driver->driver->isConnected() ? 1 : 0;
+}
+
+sl_result sl_lidar_get_device_info(sl_lidar_driver_t* driver, sl_lidar_response_device_info_t* info, sl_u32 timeout_ms)
+{
+    if (!driver || !info) return SL_RESULT_INVALID_DATA;
+    return driver->driver->getDeviceInfo(*info, timeout_ms);
+}
+
+sl_result sl_lidar_get_health(sl_lidar_driver_t* driver, sl_lidar_response_device_health_t* health, sl_u32 timeout_ms)
+{
+    if (!driver || !health) return SL_RESULT_INVALID_DATA;
+    return driver->driver->getHealth(*health, timeout_ms);
+}
+
+sl_result sl_lidar_start_scan(sl_lidar_driver_t* driver, int force)
+{
+    if (!driver) return SL_RESULT_INVALID_DATA;
+    driver->driver->setMotorSpeed();
+    return driver->driver->startScan(force != 0, true);
+}
+
+sl_result sl_lidar_stop(sl_lidar_driver_t* driver)
+{
+    if (!driver) return SL_RESULT_INVALID_DATA;
+    return driver->driver->stop();
+}
+
+sl_result sl_lidar_lease_scan(sl_lidar_driver_t* driver, sl_u32 timeout_ms, sl_lidar_scan_lease_t** lease, sl_lidar_scan_view_t* view)
+{
+    if (!driver || !lease || !view) return SL_RESULT_INVALID_DATA;
+    *lease = NULL;
+
+    // claimed before the scan is taken, a scan is never grabbed to be dropped
+    sl_lidar_scan_lease* slot = _claimLeaseSlot();
+    if (!slot) return SL_RESULT_INSUFFICIENT_MEMORY;
+
+    sl_result ans = driver->driver->grabScanDataHqLease(slot->scan, timeout_ms);
+    if (SL_IS_FAIL(ans)) {
+        _freeLeaseSlot(slot);
+        return ans;
+    }
+
+    const LidarScanData& scan = *slot->scan;
+    view->nodes = scan.nodes;
+    view->node_stride = sizeof(sl_lidar_response_measurement_node_hq_t);
+    view->timestamps_uS = scan.timestamps_uS;
+    view->timestamp_stride = sizeof(sl_u64);
+    view->count = scan.count;
+    view->timestamp_uS = scan.timestamp_uS;
+    view->end_timestamp_uS = scan.end_timestamp_uS;
+    view->sequence = scan.sequence;
+
+    *lease = slot;
+    return SL_RESULT_OK;
+}
+
+void sl_lidar_release_scan(sl_lidar_scan_lease_t* lease)
+{
+    if (lease < g_scanLeases || lease >= g_scanLeases + SL_LIDAR_C_MAX_SCAN_LEASES) return;
+    _freeLeaseSlot(lease);
+}
+
+}
@@ -0,0 +1,169 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/byteorder.h"
+
+#include "sl_lidar_driver.h"
+#include "sl_lidar_capability_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace sl { namespace internal {
+
+void CapabilityCache::setDirectory(const char* directory)
+{
+    _directory = directory ? directory : "";
+    if (!_directory.empty() && _directory[_directory.size() - 1] != '/' && _directory[_directory.size() - 1] != '\\') {
+        _directory += '/';
+    }
+}
+
+std::string CapabilityCache::_getEntryPath(const sl_lidar_response_device_info_t& devInfo) const
+{
+    char name[sizeof(devInfo.serialnum) * 2 + 1];
+    for (size_t pos = 0; pos < sizeof(devInfo.serialnum); ++pos) {
+        sprintf(name + pos * 2, "%02X", devInfo.serialnum[pos]);
+    }
+    return _directory + name + ".slcap";
+}
+
+bool CapabilityCache::load(const sl_lidar_response_device_info_t& devInfo, DeviceCapabilities& caps) const
+{
+    if (!isEnabled()) return false;
+
+    FILE* fp = fopen(_getEntryPath(devInfo).c_str(), "rb");
+    if (!fp) return false;
+
+    bool ans = false;
+    CapabilityCacheFileHeader header;
+    do {
+        if (fread(&header, sizeof(header), 1, fp) != 1) break;
+        if (le32_to_cpu(header.magic) != CAPABILITY_CACHE_MAGIC) break;
+        if (le16_to_cpu(header.version) != CAPABILITY_CACHE_VERSION) break;
+
+        // a firmware update may change the scan modes
+        if (header.model != devInfo.model || header.hardware_version != devInfo.hardware_version
+            || le16_to_cpu(header.firmware_version) != devInfo.firmware_version
+            || memcmp(header.serialnum, devInfo.serialnum, sizeof(header.serialnum))) {
+            break;
+        }
+
+        DeviceCapabilities loaded;
+        loaded.flags = header.flags;
+        loaded.typicalMode = le16_to_cpu(header.typical_mode);
+        loaded.motorCtrlSupport = (MotorCtrlSupport)header.motor_ctrl_support;
+        loaded.maxSerialBaudRate = le32_to_cpu(header.max_serial_baudrate);
+
+        size_t modeCount = le16_to_cpu(header.scan_mode_count);
+        loaded.scanModes.resize(modeCount);
+        size_t pos = 0;
+        for (; pos < modeCount; ++pos) {
+            CapabilityCacheScanMode mode;
+            if (fread(&mode, sizeof(mode), 1, fp) != 1) break;
+
+            LidarScanMode& target = loaded.scanModes[pos];
+            target.id = le16_to_cpu(mode.id);
+            target.us_per_sample = (float)(le32_to_cpu(mode.us_per_sample_q8) / 256.0);
+            target.max_distance = (float)(le32_to_cpu(mode.max_distance_q8) >> 8);
+            target.ans_type = mode.ans_type;
+            memcpy(target.scan_mode, mode.name, sizeof(target.scan_mode));
+            target.scan_mode[sizeof(target.scan_mode) - 1] = 0;
+        }
+        if (pos != modeCount) break;
+
+        caps = loaded;
+        ans = true;
+    } while (0);
+
+    fclose(fp);
+    return ans;
+}
+
+u_result CapabilityCache::store(const sl_lidar_response_device_info_t& devInfo, const DeviceCapabilities& caps) const
+{
+    if (!isEnabled()) return RESULT_OPERATION_NOT_SUPPORT;
+
+    CapabilityCacheFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = cpu_to_le32(CAPABILITY_CACHE_MAGIC);
+    header.version = cpu_to_le16(CAPABILITY_CACHE_VERSION);
+    header.model = devInfo.model;
+    header.hardware_version = devInfo.hardware_version;
+    header.firmware_version = cpu_to_le16(devInfo.firmware_version);
+    memcpy(header.serialnum, devInfo.serialnum, sizeof(header.serialnum));
+    header.flags = (_u8)caps.flags;
+    header.motor_ctrl_support = (_u8)caps.motorCtrlSupport;
+    header.typical_mode = cpu_to_le16(caps.typicalMode);
+    header.scan_mode_count = cpu_to_le16((_u16)caps.scanModes.size());
+    header.max_serial_baudrate = cpu_to_le32(caps.maxSerialBaudRate);
+
+    // written aside then renamed, a reader never sees a partial entry
+    std::string path = _getEntryPath(devInfo);
+    std::string tempPath = path + ".tmp";
+    FILE* fp = fopen(tempPath.c_str(), "wb");
+    if (!fp) return RESULT_OPERATION_FAIL;
+
+    bool written = (fwrite(&header, sizeof(header), 1, fp) == 1);
+    for (size_t pos = 0; written && pos < caps.scanModes.size(); ++pos) {
+        const LidarScanMode& source = caps.scanModes[pos];
+        CapabilityCacheScanMode mode;
+        memset(&mode, 0, sizeof(mode));
+        mode.id = cpu_to_le16(source.id);
+        mode.us_per_sample_q8 = cpu_to_le32((_u32)(source.us_per_sample * 256 + 0.5f));
+        mode.max_distance_q8 = cpu_to_le32((_u32)source.max_distance << 8);
+        mode.ans_type = source.ans_type;
+        memcpy(mode.name, source.scan_mode, sizeof(mode.name));
+        written = (fwrite(&mode, sizeof(mode), 1, fp) == 1);
+    }
+    if (fclose(fp) != 0) written = false;
+
+    if (!written) {
+        remove(tempPath.c_str());
+        return RESULT_OPERATION_FAIL;
+    }
+
+#ifdef _WIN32
+    // rename does not replace an existing file there
+    remove(path.c_str());
+#endif
+    if (rename(tempPath.c_str(), path.c_str()) != 0) {
+        remove(tempPath.c_str());
+        return RESULT_OPERATION_FAIL;
+    }
+    return RESULT_OK;
+}
+
+}}
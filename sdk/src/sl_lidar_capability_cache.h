@@ -0,0 +1,120 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// On disk cache of the capabilities queried from a device, one file per serial number.
+// An entry is only used while the model, firmware and hardware versions still match the device.
+//
+// File layout, all the fields are little endian:
+//   CapabilityCacheFileHeader
+//   CapabilityCacheScanMode, scan_mode_count times
+
+namespace sl { namespace internal {
+
+enum {
+    CAPABILITY_CACHE_MAGIC = 0x43444C53, // "SLDC"
+    CAPABILITY_CACHE_VERSION = 2,
+
+    CAPABILITY_CACHE_FLAG_SCAN_MODES = 0x1,
+    CAPABILITY_CACHE_FLAG_TYPICAL_MODE = 0x2,
+    CAPABILITY_CACHE_FLAG_MOTOR_CTRL = 0x4,
+    CAPABILITY_CACHE_FLAG_MAX_BAUDRATE = 0x8,
+};
+
+#if defined(_WIN32)
+#pragma pack(1)
+#endif
+
+typedef struct _capability_cache_file_header_t {
+    _u32 magic;
+    _u16 version;
+    _u8  model;
+    _u8  hardware_version;
+    _u16 firmware_version;
+    _u8  serialnum[16];
+    _u8  flags;                 // CAPABILITY_CACHE_FLAG_xxx, the fields cached
+    _u8  motor_ctrl_support;    // MotorCtrlSupport
+    _u16 typical_mode;
+    _u16 scan_mode_count;
+    _u32 max_serial_baudrate;   // the highest baudrate found stable by the application
+} __attribute__((packed)) CapabilityCacheFileHeader;
+
+typedef struct _capability_cache_scan_mode_t {
+    _u16 id;
+    _u32 us_per_sample_q8;      // as answered by the device
+    _u32 max_distance_q8;
+    _u8  ans_type;
+    char name[64];
+} __attribute__((packed)) CapabilityCacheScanMode;
+
+#if defined(_WIN32)
+#pragma pack()
+#endif
+
+struct DeviceCapabilities
+{
+    DeviceCapabilities() : flags(0), typicalMode(0), motorCtrlSupport(MotorCtrlSupportNone), maxSerialBaudRate(0) {}
+
+    _u32                        flags;  // CAPABILITY_CACHE_FLAG_xxx, the fields known
+    std::vector<LidarScanMode>  scanModes;
+    _u16                        typicalMode;
+    MotorCtrlSupport            motorCtrlSupport;
+    _u32                        maxSerialBaudRate;
+};
+
+class CapabilityCache
+{
+public:
+    // an empty directory disables the cache
+    void setDirectory(const char* directory);
+
+    bool isEnabled() const {
+        return !_directory.empty();
+    }
+
+    // false when the device is not cached, or was cached with other versions
+    bool load(const sl_lidar_response_device_info_t& devInfo, DeviceCapabilities& caps) const;
+
+    // replaces the entry of the device
+    u_result store(const sl_lidar_response_device_info_t& devInfo, const DeviceCapabilities& caps) const;
+
+protected:
+    std::string _getEntryPath(const sl_lidar_response_device_info_t& devInfo) const;
+
+    std::string _directory;
+};
+
+}}
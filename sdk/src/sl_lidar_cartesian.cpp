@@ -0,0 +1,266 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sl_lidar_cartesian.h"
+#include "hal/cpu_features.h"
+#include <math.h>
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SL_CARTESIAN_X86_AVX2
+#define SL_CARTESIAN_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#define SL_CARTESIAN_X86_AVX2
+#define SL_CARTESIAN_AVX2_TARGET
+#endif
+
+namespace sl {
+
+    enum {
+        ANGLE_STEPS = 65536,          // q14 angle steps of the full circle
+        ANGLE_STEP_MASK = ANGLE_STEPS - 1,
+        QUARTER_ANGLE_STEPS = ANGLE_STEPS / 4,
+    };
+
+    static const double FULL_CIRCLE_RAD = 2 * 3.14159265358979323846;
+
+    // sin of each q14 angle step, cos(a) is sin(a + 90 degree)
+    struct SinTable
+    {
+        SinTable()
+        {
+            for (int pos = 0; pos < ANGLE_STEPS; ++pos) {
+                t[pos] = (float)sin(pos * FULL_CIRCLE_RAD / ANGLE_STEPS);
+            }
+        }
+
+        float t[ANGLE_STEPS];
+    };
+
+    static const float* _getSinTable()
+    {
+        static const SinTable table;
+        return table.t;
+    }
+
+    static const float RANGE_Q2_TO_M = 1.f / 4000.f;
+    static const float RAD_TO_ANGLE_STEP = (float)(ANGLE_STEPS / FULL_CIRCLE_RAD);
+
+    static inline void _convertNode(const float* sinTable, sl_u32 angleStep, float range, float& x, float& y)
+    {
+        x = range * sinTable[(angleStep + QUARTER_ANGLE_STEPS) & ANGLE_STEP_MASK];
+        y = range * sinTable[angleStep & ANGLE_STEP_MASK];
+    }
+
+    static void _convertNodesGeneric(const float* sinTable, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, float* x, float* y)
+    {
+        for (size_t pos = 0; pos < count; ++pos) {
+            _convertNode(sinTable, nodes[pos].angle_z_q14, nodes[pos].dist_mm_q2 * RANGE_Q2_TO_M, x[pos], y[pos]);
+        }
+    }
+
+    static void _convertSoAGeneric(const float* sinTable, const float* angle_rad, const float* range_m, size_t count, float* x, float* y)
+    {
+        for (size_t pos = 0; pos < count; ++pos) {
+            sl_u32 angleStep = (sl_u32)(int)floorf(angle_rad[pos] * RAD_TO_ANGLE_STEP + 0.5f);
+            _convertNode(sinTable, angleStep, range_m[pos], x[pos], y[pos]);
+        }
+    }
+
+#if defined(SL_CARTESIAN_X86_AVX2)
+
+    // 8 nodes per round, the packed node fields and the table entries are fetched by gathers
+    SL_CARTESIAN_AVX2_TARGET static void _convertNodesAvx2(const float* sinTable, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, float* x, float* y)
+    {
+        const __m256i nodeOffsets = _mm256_setr_epi32(0, 8, 16, 24, 32, 40, 48, 56);
+        const __m256i angleMask = _mm256_set1_epi32(0xFFFF);
+        const __m256i stepMask = _mm256_set1_epi32(ANGLE_STEP_MASK);
+        const __m256i quarter = _mm256_set1_epi32(QUARTER_ANGLE_STEPS);
+        const __m256 rangeScale = _mm256_set1_ps(RANGE_Q2_TO_M);
+
+        size_t pos = 0;
+        for (; pos + 8 <= count; pos += 8) {
+            const char* base = reinterpret_cast<const char*>(nodes + pos);
+            __m256i angle = _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(base), nodeOffsets, 1), angleMask);
+            __m256i dist = _mm256_i32gather_epi32(reinterpret_cast<const int*>(base + 2), nodeOffsets, 1);
+
+            __m256 range = _mm256_mul_ps(_mm256_cvtepi32_ps(dist), rangeScale);
+            __m256 sinv = _mm256_i32gather_ps(sinTable, angle, 4);
+            __m256 cosv = _mm256_i32gather_ps(sinTable, _mm256_and_si256(_mm256_add_epi32(angle, quarter), stepMask), 4);
+
+            _mm256_storeu_ps(x + pos, _mm256_mul_ps(range, cosv));
+            _mm256_storeu_ps(y + pos, _mm256_mul_ps(range, sinv));
+        }
+        _convertNodesGeneric(sinTable, nodes + pos, count - pos, x + pos, y + pos);
+    }
+
+    SL_CARTESIAN_AVX2_TARGET static void _convertSoAAvx2(const float* sinTable, const float* angle_rad, const float* range_m, size_t count, float* x, float* y)
+    {
+        const __m256 stepScale = _mm256_set1_ps(RAD_TO_ANGLE_STEP);
+        const __m256i stepMask = _mm256_set1_epi32(ANGLE_STEP_MASK);
+        const __m256i quarter = _mm256_set1_epi32(QUARTER_ANGLE_STEPS);
+
+        size_t pos = 0;
+        for (; pos + 8 <= count; pos += 8) {
+            // rounded to the nearest step
+            __m256i angle = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(angle_rad + pos), stepScale));
+            __m256 range = _mm256_loadu_ps(range_m + pos);
+            __m256 sinv = _mm256_i32gather_ps(sinTable, _mm256_and_si256(angle, stepMask), 4);
+            __m256 cosv = _mm256_i32gather_ps(sinTable, _mm256_and_si256(_mm256_add_epi32(angle, quarter), stepMask), 4);
+
+            _mm256_storeu_ps(x + pos, _mm256_mul_ps(range, cosv));
+            _mm256_storeu_ps(y + pos, _mm256_mul_ps(range, sinv));
+        }
+        _convertSoAGeneric(sinTable, angle_rad + pos, range_m + pos, count - pos, x + pos, y + pos);
+    }
+
+#endif
+
+    typedef void (*convert_nodes_proc_t)(const float* sinTable, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, float* x, float* y);
+    typedef void (*convert_soa_proc_t)(const float* sinTable, const float* angle_rad, const float* range_m, size_t count, float* x, float* y);
+
+    static std::atomic<convert_nodes_proc_t> _convertNodesProc(_convertNodesGeneric);
+    static std::atomic<convert_soa_proc_t> _convertSoAProc(_convertSoAGeneric);
+
+    static void _bindConvertProcs(sl_u32 features)
+    {
+        convert_nodes_proc_t convertNodes = _convertNodesGeneric;
+        convert_soa_proc_t convertSoA = _convertSoAGeneric;
+#if defined(SL_CARTESIAN_X86_AVX2)
+        if (rp::hal::hasCpuFeatures(features, rp::hal::CPU_FEATURE_AVX2)) {
+            convertNodes = _convertNodesAvx2;
+            convertSoA = _convertSoAAvx2;
+        }
+#endif
+        _convertNodesProc.store(convertNodes, std::memory_order_relaxed);
+        _convertSoAProc.store(convertSoA, std::memory_order_relaxed);
+    }
+
+    static rp::hal::CpuKernelBinding _convertBinding(_bindConvertProcs);
+
+    void convertScanToCartesian(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, float* x, float* y)
+    {
+        _convertNodesProc.load(std::memory_order_relaxed)(_getSinTable(), nodes, count, x, y);
+    }
+
+    void convertScanToCartesian(const LidarScanSoA& scan, float* x, float* y)
+    {
+        _convertSoAProc.load(std::memory_order_relaxed)(_getSinTable(), scan.angle_rad, scan.range_m, scan.count, x, y);
+    }
+
+    // the rotation of each pose as a matrix, interpolated linearly with the translation
+    struct DeskewKnot
+    {
+        float c, s, tx, ty;
+    };
+
+    // branch free over the points, the knot of each point is picked by its time
+    static void _deskewPoints(const sl_u64* timestamps_uS, size_t count, sl_u64 start_uS, sl_u64 end_uS,
+        const LidarPose2D* poses, size_t poseCount, float* x, float* y)
+    {
+        DeskewKnot knots[LIDAR_DESKEW_MAX_POSE_COUNT + 1];
+        for (size_t pos = 0; pos < poseCount; ++pos) {
+            knots[pos].c = cosf(poses[pos].yaw_rad);
+            knots[pos].s = sinf(poses[pos].yaw_rad);
+            knots[pos].tx = poses[pos].x_m;
+            knots[pos].ty = poses[pos].y_m;
+        }
+        // the last segment is flat so a point at end_uS needs no special case
+        knots[poseCount] = knots[poseCount - 1];
+
+        const float lastKnot = (float)(poseCount - 1);
+        const float knotScale = (end_uS > start_uS) ? lastKnot / (float)(end_uS - start_uS) : 0.f;
+        for (size_t pos = 0; pos < count; ++pos) {
+            // the sample times may step back a little before the start of the scan
+            float t = (float)(sl_s64)(timestamps_uS[pos] - start_uS) * knotScale;
+            t = std::min(std::max(t, 0.f), lastKnot);
+            int idx = (int)t;
+            float f = t - (float)idx;
+
+            const DeskewKnot& a = knots[idx];
+            const DeskewKnot& b = knots[idx + 1];
+            float c = a.c + (b.c - a.c) * f;
+            float s = a.s + (b.s - a.s) * f;
+            float tx = a.tx + (b.tx - a.tx) * f;
+            float ty = a.ty + (b.ty - a.ty) * f;
+
+            float px = x[pos], py = y[pos];
+            x[pos] = c * px - s * py + tx;
+            y[pos] = s * px + c * py + ty;
+        }
+    }
+
+    sl_result deskewScanToCartesian(const sl_lidar_response_measurement_node_hq_t* nodes, const sl_u64* timestamps_uS, size_t count,
+        sl_u64 start_uS, sl_u64 end_uS, const LidarPose2D* poses, size_t poseCount, float* x, float* y)
+    {
+        if (!poseCount || poseCount > LIDAR_DESKEW_MAX_POSE_COUNT) return SL_RESULT_INVALID_DATA;
+
+        convertScanToCartesian(nodes, count, x, y);
+        _deskewPoints(timestamps_uS, count, start_uS, end_uS, poses, poseCount, x, y);
+        return SL_RESULT_OK;
+    }
+
+    sl_result deskewScanToCartesian(const LidarScanSoA& scan, sl_u64 start_uS, sl_u64 end_uS,
+        const LidarPose2D* poses, size_t poseCount, float* x, float* y)
+    {
+        if (!poseCount || poseCount > LIDAR_DESKEW_MAX_POSE_COUNT) return SL_RESULT_INVALID_DATA;
+
+        convertScanToCartesian(scan, x, y);
+        _deskewPoints(scan.timestamps_uS, scan.count, start_uS, end_uS, poses, poseCount, x, y);
+        return SL_RESULT_OK;
+    }
+
+    void integrateLidarTwist(const LidarTwist2D& twist, sl_u64 duration_uS, LidarPose2D* poses, size_t poseCount)
+    {
+        for (size_t pos = 0; pos < poseCount; ++pos) {
+            float dt = poseCount > 1 ? (float)(duration_uS * 1e-6 * pos / (poseCount - 1)) : 0.f;
+            float yaw = twist.yaw_rate_radps * dt;
+            poses[pos].yaw_rad = yaw;
+
+            if (fabsf(yaw) < 1e-6f) {
+                poses[pos].x_m = twist.vx_mps * dt;
+                poses[pos].y_m = twist.vy_mps * dt;
+            }
+            else {
+                // the arc followed at a constant velocity in the moving frame
+                float sinYaw = sinf(yaw), cosYaw = cosf(yaw);
+                float w = twist.yaw_rate_radps;
+                poses[pos].x_m = (twist.vx_mps * sinYaw - twist.vy_mps * (1 - cosYaw)) / w;
+                poses[pos].y_m = (twist.vx_mps * (1 - cosYaw) + twist.vy_mps * sinYaw) / w;
+            }
+        }
+    }
+}
@@ -0,0 +1,544 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/byteorder.h"
+#include "hal/thread.h"
+#include "hal/locker.h"
+#include "hal/socket.h"
+
+#include "sl_lidar_discovery.h"
+
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+
+namespace sl {
+
+    namespace internal {
+
+        enum {
+            MDNS_PORT = 5353,
+            MDNS_TTL = 255,
+            DNS_HEADER_SIZE = 12,
+            DNS_MAX_MESSAGE_SIZE = 9000,
+            DNS_MAX_NAME_JUMPS = 16,
+            DNS_TYPE_A = 1,
+            DNS_TYPE_PTR = 12,
+            DNS_TYPE_TXT = 16,
+            DNS_TYPE_SRV = 33,
+            DNS_CLASS_IN = 1,
+            // the answers are asked to the querier directly, see RFC 6762 5.4
+            DNS_CLASS_UNICAST_RESPONSE = 0x8000,
+            // the probes are sent again twice within the deadline, the datagrams may be lost
+            DISCOVERY_PROBE_ROUNDS = 3,
+        };
+
+        static const char MDNS_GROUP_ADDRESS[] = "224.0.0.251";
+        static const char DISCOVERY_DEFAULT_SERVICE_TYPE[] = "_lidar._udp";
+        static const char DISCOVERY_DEFAULT_BROADCAST_ADDRESS[] = "255.255.255.255";
+
+        static _u16 _readBe16(const _u8* data)
+        {
+            return (_u16)((data[0] << 8) | data[1]);
+        }
+
+        static void _appendDnsName(const std::string& name, std::vector<_u8>& output)
+        {
+            size_t labelStart = 0;
+            while (labelStart <= name.size()) {
+                size_t labelEnd = name.find('.', labelStart);
+                if (labelEnd == std::string::npos) labelEnd = name.size();
+                size_t labelSize = std::min<size_t>(labelEnd - labelStart, 63);
+                if (labelSize) {
+                    output.push_back((_u8)labelSize);
+                    output.insert(output.end(), name.begin() + labelStart, name.begin() + labelStart + labelSize);
+                }
+                labelStart = labelEnd + 1;
+            }
+            output.push_back(0);
+        }
+
+        // a PTR question of the service, asking for unicast answers
+        static void _buildMdnsQuery(const std::string& serviceName, std::vector<_u8>& query)
+        {
+            query.assign(DNS_HEADER_SIZE, 0);
+            query[5] = 1; // one question
+            _appendDnsName(serviceName, query);
+            query.push_back(0);
+            query.push_back(DNS_TYPE_PTR);
+            query.push_back((_u8)((DNS_CLASS_UNICAST_RESPONSE | DNS_CLASS_IN) >> 8));
+            query.push_back((_u8)(DNS_CLASS_UNICAST_RESPONSE | DNS_CLASS_IN));
+        }
+
+        // reads the name at offset, following the compression pointers, and moves offset past it
+        static bool _readDnsName(const _u8* message, size_t size, size_t& offset, std::string& name)
+        {
+            name.clear();
+            size_t pos = offset;
+            size_t jumps = 0;
+            bool jumped = false;
+            for (;;) {
+                if (pos >= size) return false;
+                _u8 labelSize = message[pos];
+                if ((labelSize & 0xC0) == 0xC0) {
+                    if (pos + 1 >= size || ++jumps > DNS_MAX_NAME_JUMPS) return false;
+                    if (!jumped) offset = pos + 2;
+                    jumped = true;
+                    pos = ((labelSize & 0x3F) << 8) | message[pos + 1];
+                    continue;
+                }
+                if (labelSize & 0xC0) return false;
+                if (!labelSize) {
+                    if (!jumped) offset = pos + 1;
+                    return true;
+                }
+                if (pos + 1 + labelSize > size) return false;
+                if (!name.empty()) name.push_back('.');
+                name.append(reinterpret_cast<const char*>(message + pos + 1), labelSize);
+                pos += 1 + labelSize;
+            }
+        }
+
+        static bool _isSameDnsName(const std::string& a, const std::string& b)
+        {
+            if (a.size() != b.size()) return false;
+            for (size_t pos = 0; pos < a.size(); ++pos) {
+                if (tolower((unsigned char)a[pos]) != tolower((unsigned char)b[pos])) return false;
+            }
+            return true;
+        }
+
+        static int _hexDigit(char c)
+        {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        // the model and sn keys of a TXT record, the serial number in 32 hex digits as printed by the tools
+        static bool _parseDeviceTxt(const _u8* data, size_t size, sl_lidar_response_device_info_t& info)
+        {
+            bool hasSerial = false;
+            size_t pos = 0;
+            while (pos < size) {
+                size_t entrySize = data[pos++];
+                if (pos + entrySize > size) break;
+                std::string entry(reinterpret_cast<const char*>(data + pos), entrySize);
+                pos += entrySize;
+
+                size_t separator = entry.find('=');
+                if (separator == std::string::npos) continue;
+                std::string key = entry.substr(0, separator);
+                std::string value = entry.substr(separator + 1);
+                if (_isSameDnsName(key, "model")) {
+                    info.model = (sl_u8)strtoul(value.c_str(), NULL, 0);
+                }
+                else if ((_isSameDnsName(key, "sn") || _isSameDnsName(key, "serial")) && value.size() == sizeof(info.serialnum) * 2) {
+                    bool isHex = true;
+                    for (size_t digit = 0; digit < sizeof(info.serialnum) && isHex; ++digit) {
+                        int high = _hexDigit(value[digit * 2]);
+                        int low = _hexDigit(value[digit * 2 + 1]);
+                        isHex = high >= 0 && low >= 0;
+                        info.serialnum[digit] = (sl_u8)((high << 4) | low);
+                    }
+                    hasSerial = isHex;
+                }
+            }
+            return hasSerial;
+        }
+
+        // what the mDNS answers tell about one instance of the service
+        struct MdnsInstance {
+            std::string target;
+            int         port;
+            bool        hasSrv;
+            bool        hasDeviceInfo;
+            sl_lidar_response_device_info_t deviceInfo;
+
+            MdnsInstance() : port(0), hasSrv(false), hasDeviceInfo(false)
+            {
+                memset(&deviceInfo, 0, sizeof(deviceInfo));
+            }
+        };
+
+    }
+
+    using namespace internal;
+
+    class LidarDiscovery : public ILidarDiscovery
+    {
+    public:
+        LidarDiscovery(const LidarDiscoveryOptions& options)
+            : _sources((options.sources & LIDAR_DISCOVERY_SOURCE_ALL) ? (options.sources & LIDAR_DISCOVERY_SOURCE_ALL) : LIDAR_DISCOVERY_SOURCE_ALL)
+            , _port(options.port ? options.port : LIDAR_DISCOVERY_DEFAULT_PORT)
+            , _serviceName(options.service_type ? options.service_type : DISCOVERY_DEFAULT_SERVICE_TYPE)
+            , _mdnsSocket(NULL)
+            , _listener(NULL)
+            , _deadline(0)
+        {
+            _serviceName += ".local";
+            _broadcastAddress = options.broadcast_address ? options.broadcast_address : DISCOVERY_DEFAULT_BROADCAST_ADDRESS;
+        }
+
+        sl_result init()
+        {
+            if (_port <= 0 || _port > 0xFFFF) return SL_RESULT_INVALID_DATA;
+            if (IS_FAIL(_broadcastTarget.setAddressFromString(_broadcastAddress.c_str()))) return SL_RESULT_INVALID_DATA;
+            _broadcastTarget.setPort(_port);
+            _mdnsTarget.setAddressFromString(MDNS_GROUP_ADDRESS);
+            _mdnsTarget.setPort(MDNS_PORT);
+
+            _buildMdnsQuery(_serviceName, _mdnsQuery);
+
+            sl_lidar_cmd_packet_t request;
+            request.syncByte = SL_LIDAR_CMD_SYNC_BYTE;
+            request.cmd_flag = SL_LIDAR_CMD_GET_DEVICE_INFO;
+            _infoRequest.assign(reinterpret_cast<const _u8*>(&request), reinterpret_cast<const _u8*>(&request) + 2);
+            return SL_RESULT_OK;
+        }
+
+        sl_result discover(std::vector<LidarDiscoveredDevice>& devices, ILidarDiscoveryListener* listener, sl_u32 timeoutMs)
+        {
+            rp::hal::AutoLocker dl(_discover_locker);
+            devices.clear();
+
+            rp::net::DGramSocket* mdnsSocket = (_sources & LIDAR_DISCOVERY_SOURCE_MDNS) ? _openProbeSocket(false) : NULL;
+            rp::net::DGramSocket* broadcastSocket = (_sources & LIDAR_DISCOVERY_SOURCE_BROADCAST) ? _openProbeSocket(true) : NULL;
+            if (!mdnsSocket && !broadcastSocket) return SL_RESULT_OPERATION_FAIL;
+
+            {
+                rp::hal::AutoLocker l(_locker);
+                _found.clear();
+                _mdnsInstances.clear();
+                _mdnsHosts.clear();
+                _listener = listener;
+                _deadline = getms() + (timeoutMs ? timeoutMs : LIDAR_DISCOVERY_DEFAULT_TIMEOUT_MS);
+            }
+
+            // the mDNS probe runs on a thread of its own, the broadcast one on the calling thread
+            _mdnsSocket = mdnsSocket;
+            rp::hal::Thread mdnsThread;
+            if (mdnsSocket) mdnsThread = CLASS_THREAD(LidarDiscovery, _proc_mdnsProbe);
+            if (broadcastSocket) _runProbe(broadcastSocket, _broadcastTarget, _infoRequest, false);
+            if (mdnsSocket) mdnsThread.join();
+
+            if (mdnsSocket) mdnsSocket->dispose();
+            if (broadcastSocket) broadcastSocket->dispose();
+
+            rp::hal::AutoLocker l(_locker);
+            _listener = NULL;
+            devices = _found;
+            return SL_RESULT_OK;
+        }
+
+        void getCachedLidars(std::vector<LidarDiscoveredDevice>& devices, sl_u32 maxAgeMs)
+        {
+            rp::hal::AutoLocker l(_locker);
+            devices.clear();
+            _u64 now = getus();
+            for (size_t pos = 0; pos < _cache.size(); ++pos) {
+                if (maxAgeMs && now - _cache[pos].last_seen_uS > (_u64)maxAgeMs * 1000) continue;
+                devices.push_back(_cache[pos]);
+            }
+        }
+
+    private:
+        rp::net::DGramSocket* _openProbeSocket(bool broadcast)
+        {
+            rp::net::DGramSocket* socket = rp::net::DGramSocket::CreateSocket();
+            if (!socket) return NULL;
+
+            rp::net::SocketAddress local;
+            local.setAnyAddress();
+            local.setPort(0);
+            bool opened = IS_OK(socket->bind(local));
+            if (opened && broadcast) opened = IS_OK(socket->enableBroadcast(true));
+            if (opened && !broadcast) opened = IS_OK(socket->setMulticastOptions(MDNS_TTL, true));
+            if (!opened) {
+                socket->dispose();
+                return NULL;
+            }
+            return socket;
+        }
+
+        u_result _proc_mdnsProbe()
+        {
+            _runProbe(_mdnsSocket, _mdnsTarget, _mdnsQuery, true);
+            return RESULT_OK;
+        }
+
+        void _runProbe(rp::net::DGramSocket* socket, const rp::net::SocketAddress& target, const std::vector<_u8>& request, bool mdns)
+        {
+            std::vector<_u8> answer(DNS_MAX_MESSAGE_SIZE);
+            _u64 start = getms();
+            _u64 deadline = _deadline;
+            size_t round = 0;
+            _u64 nextProbe = start;
+
+            for (;;) {
+                _u64 now = getms();
+                if (now >= deadline) break;
+                if (now >= nextProbe && round < DISCOVERY_PROBE_ROUNDS) {
+                    socket->sendTo(&target, &request[0], request.size());
+                    ++round;
+                    nextProbe = start + (deadline - start) * round / DISCOVERY_PROBE_ROUNDS;
+                }
+
+                _u64 waitUntil = (round < DISCOVERY_PROBE_ROUNDS) ? std::min(nextProbe, deadline) : deadline;
+                if (waitUntil <= now || IS_FAIL(socket->waitforData((_u32)(waitUntil - now)))) continue;
+
+                size_t received = 0;
+                rp::net::SocketAddress source;
+                if (IS_FAIL(socket->recvFrom(&answer[0], answer.size(), received, &source))) continue;
+
+                char sourceAddress[48];
+                if (IS_FAIL(source.getAddressAsString(sourceAddress, sizeof(sourceAddress)))) continue;
+                if (mdns) {
+                    _onMdnsAnswer(&answer[0], received, sourceAddress);
+                }
+                else {
+                    _onInfoAnswer(&answer[0], received, sourceAddress);
+                }
+            }
+        }
+
+        void _onInfoAnswer(const _u8* data, size_t size, const char* sourceAddress)
+        {
+            sl_lidar_ans_header_t header;
+            if (size < sizeof(header) + sizeof(sl_lidar_response_device_info_t)) return;
+            memcpy(&header, data, sizeof(header));
+            if (header.syncByte1 != SL_LIDAR_ANS_SYNC_BYTE1 || header.syncByte2 != SL_LIDAR_ANS_SYNC_BYTE2
+                || header.type != SL_LIDAR_ANS_TYPE_DEVINFO
+                || (le32_to_cpu(header.size_q30_subtype) & SL_LIDAR_ANS_HEADER_SIZE_MASK) != sizeof(sl_lidar_response_device_info_t)) {
+                return;
+            }
+
+            LidarDiscoveredDevice device;
+            _initDevice(device, sourceAddress, _port, LIDAR_DISCOVERY_SOURCE_BROADCAST);
+            memcpy(&device.device_info, data + sizeof(header), sizeof(device.device_info));
+            device.device_info.firmware_version = le16_to_cpu(device.device_info.firmware_version);
+            device.has_device_info = true;
+            _mergeDevice(device);
+        }
+
+        void _onMdnsAnswer(const _u8* message, size_t size, const char* sourceAddress)
+        {
+            if (size < DNS_HEADER_SIZE) return;
+            size_t questionCount = _readBe16(message + 4);
+            size_t recordCount = (size_t)_readBe16(message + 6) + _readBe16(message + 8) + _readBe16(message + 10);
+
+            size_t offset = DNS_HEADER_SIZE;
+            std::string name;
+            for (size_t pos = 0; pos < questionCount; ++pos) {
+                if (!_readDnsName(message, size, offset, name) || offset + 4 > size) return;
+                offset += 4;
+            }
+
+            std::vector<std::string> instances;
+            for (size_t pos = 0; pos < recordCount; ++pos) {
+                if (!_readDnsName(message, size, offset, name) || offset + 10 > size) return;
+                _u16 type = _readBe16(message + offset);
+                size_t dataSize = _readBe16(message + offset + 8);
+                size_t dataOffset = offset + 10;
+                if (dataOffset + dataSize > size) return;
+                offset = dataOffset + dataSize;
+
+                std::string value;
+                size_t valueOffset = dataOffset;
+                switch (type) {
+                case DNS_TYPE_PTR:
+                    if (_isSameDnsName(name, _serviceName) && _readDnsName(message, size, valueOffset, value)) {
+                        instances.push_back(value);
+                        _mdnsInstances[value];
+                    }
+                    break;
+                case DNS_TYPE_SRV:
+                    if (dataSize > 6) {
+                        valueOffset += 6;
+                        MdnsInstance& instance = _mdnsInstances[name];
+                        instance.port = _readBe16(message + dataOffset + 4);
+                        instance.hasSrv = _readDnsName(message, size, valueOffset, instance.target);
+                        instances.push_back(name);
+                    }
+                    break;
+                case DNS_TYPE_TXT:
+                    {
+                        MdnsInstance& instance = _mdnsInstances[name];
+                        instance.hasDeviceInfo = _parseDeviceTxt(message + dataOffset, dataSize, instance.deviceInfo) || instance.hasDeviceInfo;
+                        instances.push_back(name);
+                    }
+                    break;
+                case DNS_TYPE_A:
+                    if (dataSize == 4) {
+                        char address[48];
+                        snprintf(address, sizeof(address), "%u.%u.%u.%u", message[dataOffset], message[dataOffset + 1], message[dataOffset + 2], message[dataOffset + 3]);
+                        _mdnsHosts[name] = address;
+                    }
+                    break;
+                }
+            }
+
+            // the instances of the service this answer told something about
+            for (size_t pos = 0; pos < instances.size(); ++pos) {
+                std::map<std::string, MdnsInstance>::const_iterator instance = _mdnsInstances.find(instances[pos]);
+                if (instance == _mdnsInstances.end() || !_isInstanceOfService(instance->first)) continue;
+
+                std::map<std::string, std::string>::const_iterator host = _mdnsHosts.find(instance->second.target);
+                LidarDiscoveredDevice device;
+                _initDevice(device, host != _mdnsHosts.end() ? host->second.c_str() : sourceAddress,
+                    instance->second.hasSrv ? instance->second.port : _port, LIDAR_DISCOVERY_SOURCE_MDNS);
+
+                // the instance label, without the service type
+                std::string label = instance->first.substr(0, instance->first.size() - _serviceName.size() - 1);
+                snprintf(device.name, sizeof(device.name), "%s", label.c_str());
+                if (instance->second.hasDeviceInfo) {
+                    device.device_info = instance->second.deviceInfo;
+                    device.has_device_info = true;
+                }
+                _mergeDevice(device);
+            }
+        }
+
+        bool _isInstanceOfService(const std::string& instance) const
+        {
+            return instance.size() > _serviceName.size() + 1
+                && instance[instance.size() - _serviceName.size() - 1] == '.'
+                && _isSameDnsName(instance.substr(instance.size() - _serviceName.size()), _serviceName);
+        }
+
+        static void _initDevice(LidarDiscoveredDevice& device, const char* address, int port, sl_u32 source)
+        {
+            memset(&device, 0, sizeof(device));
+            snprintf(device.address, sizeof(device.address), "%s", address);
+            device.port = port;
+            device.sources = source;
+            device.last_seen_uS = getus();
+        }
+
+        // merges into the devices found, true if anything new is known
+        static bool _mergeInto(std::vector<LidarDiscoveredDevice>& devices, const LidarDiscoveredDevice& update)
+        {
+            for (size_t pos = 0; pos < devices.size(); ++pos) {
+                LidarDiscoveredDevice& device = devices[pos];
+                if (strcmp(device.address, update.address)) continue;
+
+                // the answer of the device itself is preferred to its TXT record
+                bool takesInfo = update.has_device_info
+                    && ((update.sources & LIDAR_DISCOVERY_SOURCE_BROADCAST) || !(device.sources & LIDAR_DISCOVERY_SOURCE_BROADCAST));
+                bool changed = (device.sources | update.sources) != device.sources
+                    || (takesInfo && (!device.has_device_info || memcmp(&device.device_info, &update.device_info, sizeof(update.device_info))))
+                    || (update.name[0] && strcmp(device.name, update.name))
+                    || ((update.sources & LIDAR_DISCOVERY_SOURCE_MDNS) && device.port != update.port);
+
+                device.sources |= update.sources;
+                device.last_seen_uS = update.last_seen_uS;
+                if (update.name[0]) memcpy(device.name, update.name, sizeof(device.name));
+                // the port of the SRV record is preferred to the probed one
+                if (update.sources & LIDAR_DISCOVERY_SOURCE_MDNS) device.port = update.port;
+                if (takesInfo) {
+                    device.device_info = update.device_info;
+                    device.has_device_info = true;
+                }
+                return changed;
+            }
+
+            if (devices.size() >= LIDAR_DISCOVERY_MAX_DEVICES) {
+                // the device not seen for the longest time makes room
+                size_t oldest = 0;
+                for (size_t pos = 1; pos < devices.size(); ++pos) {
+                    if (devices[pos].last_seen_uS < devices[oldest].last_seen_uS) oldest = pos;
+                }
+                devices.erase(devices.begin() + oldest);
+            }
+            devices.push_back(update);
+            return true;
+        }
+
+        void _mergeDevice(const LidarDiscoveredDevice& update)
+        {
+            // the listener is called out of _locker, so that it may look at the cache
+            rp::hal::AutoLocker ll(_listener_locker);
+            LidarDiscoveredDevice merged;
+            ILidarDiscoveryListener* listener;
+            {
+                rp::hal::AutoLocker l(_locker);
+                _mergeInto(_cache, update);
+                if (!_mergeInto(_found, update) || !_listener) return;
+
+                listener = _listener;
+                for (size_t pos = 0; pos < _found.size(); ++pos) {
+                    if (!strcmp(_found[pos].address, update.address)) merged = _found[pos];
+                }
+            }
+            listener->onLidarDiscovered(merged);
+        }
+
+        sl_u32                  _sources;
+        int                     _port;
+        std::string             _serviceName;       // with the .local domain
+        std::string             _broadcastAddress;
+        rp::net::SocketAddress  _broadcastTarget;
+        rp::net::SocketAddress  _mdnsTarget;
+        std::vector<_u8>        _mdnsQuery;
+        std::vector<_u8>        _infoRequest;
+
+        rp::hal::Locker         _discover_locker;   // one discovery at a time
+        rp::net::DGramSocket*   _mdnsSocket;
+
+        // the state of the mDNS answers, only used by the mDNS probe thread
+        std::map<std::string, MdnsInstance> _mdnsInstances;
+        std::map<std::string, std::string>  _mdnsHosts;
+
+        rp::hal::Locker         _listener_locker;   // one call of the listener at a time
+        rp::hal::Locker         _locker;            // guards the devices and the listener
+        ILidarDiscoveryListener* _listener;
+        _u64                    _deadline;
+        std::vector<LidarDiscoveredDevice> _found;
+        std::vector<LidarDiscoveredDevice> _cache;
+    };
+
+    Result<ILidarDiscovery*> createLidarDiscovery(const LidarDiscoveryOptions& options)
+    {
+        LidarDiscovery* discovery = new LidarDiscovery(options);
+        sl_result ans = discovery->init();
+        if (IS_FAIL(ans)) {
+            delete discovery;
+            return ans;
+        }
+        return (ILidarDiscovery*)discovery;
+    }
+}
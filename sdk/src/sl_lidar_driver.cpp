@@ -38,18 +38,39 @@
 #include "hal/locker.h"
 #include "hal/socket.h"
 #include "hal/event.h"
+#include "hal/notifier.h"
 #include "hal/waiter.h"
 #include "hal/byteorder.h"
+#include "hal/trace.h"
+#include "hal/cache_line.h"
+#include "hal/realtime.h"
 #include "sl_lidar_driver.h"
 #include "sl_crc.h" 
 #include <algorithm>
 #include <memory>
 #include <atomic>
-#include <deque>
 
 #include "dataunpacker/dataunpacker.h"
+#include "dataunpacker/dataunnpacker_commondef.h"
+#include "dataunpacker/dataunnpacker_internal.h"
+#include "dataunpacker/unpacker/handler_custom.h"
+#if defined(SL_LIDAR_STATIC_UNPACKER_HANDLER)
+// a single sample format decoded without virtual dispatch, e.g.
+// -DSL_LIDAR_STATIC_UNPACKER_HANDLER=UnpackerHandler_DenseCapsuleNode
+#include "dataunpacker/unpacker/handler_capsules.h"
+#include "dataunpacker/unpacker/handler_hqnode.h"
+#include "dataunpacker/unpacker/handler_normalnode.h"
+#include "dataunpacker/dataunpacker_static.h"
+#endif
 #include "sl_async_transceiver.h"
 #include "sl_lidarprotocol_codec.h"
+#include "sl_lidar_scan_holder.h"
+#include "sl_channel_recorder.h"
+#include "sl_command_pipeline.h"
+#include "sl_lidar_capability_cache.h"
+#include "sl_allocator.h"
+#include "sl_latency_histogram.h"
+#include "sl_single_flight.h"
 
 
 
@@ -72,310 +93,538 @@ namespace sl {
         fprintf(stderr, "*WARN* YOU ARE USING DEPRECATED API: %s, PLEASE MOVE TO %s\n", fn, replacement);
     }
 
-    static void convert(const sl_lidar_response_measurement_node_t& from, sl_lidar_response_measurement_node_hq_t& to)
-    {
-        to.angle_z_q14 = (((from.angle_q6_checkbit) >> SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) << 8) / 90;  //transfer to q14 Z-angle
-        to.dist_mm_q2 = from.distance_q2;
-        to.flag = (from.sync_quality & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT);  // trasfer syncbit to HQ flag field
-        to.quality = (from.sync_quality >> SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT;  //remove the last two bits and then make quality from 0-63 to 0-255
-    }
 
-    static void convert(const sl_lidar_response_measurement_node_hq_t& from, sl_lidar_response_measurement_node_t& to)
+    // forwards the completed scans to the registered listener, directly or through its executor
+    class ScanListenerDispatcher : public IScanListener
     {
-        to.sync_quality = (from.flag & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT) | ((from.quality >> SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT);
-        to.angle_q6_checkbit = 1 | (((from.angle_z_q14 * 90) >> 8) << SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT);
-        to.distance_q2 = from.dist_mm_q2 > sl_u16(-1) ? sl_u16(0) : sl_u16(from.dist_mm_q2);
-    }
+    public:
+        ScanListenerDispatcher()
+            : _locker(false, true)
+            , _listener(nullptr)
+            , _executor(nullptr)
+        {
+        }
 
+        void setTarget(IScanListener* listener, ILidarExecutor* executor)
+        {
+            rp::hal::AutoLocker l(_locker);
+            _listener = listener;
+            _executor = executor;
+        }
 
-    static inline float getAngle(const sl_lidar_response_measurement_node_t& node)
-    {
-        return (node.angle_q6_checkbit >> SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) / 64.f;
-    }
+        virtual void onScanComplete(const LidarScanLease& scan, sl_u64 timestamp_uS)
+        {
+            // held during the callback, so that the target can be safely replaced
+            rp::hal::AutoLocker l(_locker);
+            if (!_listener) return;
 
-    static inline void setAngle(sl_lidar_response_measurement_node_t& node, float v)
-    {
-        sl_u16 checkbit = node.angle_q6_checkbit & SL_LIDAR_RESP_MEASUREMENT_CHECKBIT;
-        node.angle_q6_checkbit = (((sl_u16)(v * 64.0f)) << SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) | checkbit;
-    }
+            if (_executor) {
+                IScanListener* listener = _listener;
+                LidarScanLease lease = scan;
+                _executor->execute([listener, lease, timestamp_uS]() {
+                    listener->onScanComplete(lease, timestamp_uS);
+                });
+            }
+            else {
+                _listener->onScanComplete(scan, timestamp_uS);
+            }
+        }
 
-    static inline float getAngle(const sl_lidar_response_measurement_node_hq_t& node)
-    {
-        return node.angle_z_q14 * 90.f / 16384.f;
-    }
+    private:
+        rp::hal::Locker _locker;
+        IScanListener*  _listener;
+        ILidarExecutor* _executor;
+    };
 
-    static inline void setAngle(sl_lidar_response_measurement_node_hq_t& node, float v)
+    // Hands the completed scans to the listener dispatcher at a constant period, from a jitter buffer of their leases,
+    // see ILidarDriver::setPacedDelivery. The period follows the scan timestamps, and each delivery nudges the next
+    // tick towards the target latency after the last sample of the scan, so the phase locks to the capture.
+    class PacedScanDispatcher : public IScanListener
     {
-        node.angle_z_q14 = sl_u32(v * 16384.f / 90.f);
-    }
+    public:
+        enum {
+            IDLE_WAIT_MS = 1000,
+            // the correction of the phase at each delivery, as a share of the latency error and at most of the period
+            PHASE_GAIN_SHIFT = 3,
+            PHASE_LIMIT_SHIFT = 2,
+        };
 
-    static inline sl_u16 getDistanceQ2(const sl_lidar_response_measurement_node_t& node)
-    {
-        return node.distance_q2;
-    }
+        PacedScanDispatcher(IScanListener& target)
+            : _target(target)
+            , _locker(false, true)
+            , _depth(0)
+            , _maxLatency_uS(0)
+            , _head(0)
+            , _count(0)
+            , _isPriming(true)
+            , _period_uS(0)
+            , _lastScanTs_uS(0)
+            , _clock(NULL)
+            , _isWorking(false)
+        {
+            memset(&_stats, 0, sizeof(_stats));
+        }
 
-    static inline sl_u32 getDistanceQ2(const sl_lidar_response_measurement_node_hq_t& node)
-    {
-        return node.dist_mm_q2;
-    }
-   
-    template <class TNode>
-    static bool angleLessThan(const TNode& a, const TNode& b)
-    {
-        return getAngle(a) < getAngle(b);
-    }
+        ~PacedScanDispatcher()
+        {
+            stop();
+        }
 
-    template < class TNode >
-    static sl_result ascendScanData_(TNode * nodebuffer, size_t count)
-    {
-        float inc_origin_angle = 360.f / count;
-        size_t i = 0;
+        bool isEnabled() const
+        {
+            return _isWorking;
+        }
 
-        //Tune head
-        for (i = 0; i < count; i++) {
-            if (getDistanceQ2(nodebuffer[i]) == 0) {
-                continue;
-            }
-            else {
-                while (i != 0) {
-                    i--;
-                    float expect_angle = getAngle(nodebuffer[i + 1]) - inc_origin_angle;
-                    if (expect_angle < 0.0f) expect_angle = 0.0f;
-                    setAngle(nodebuffer[i], expect_angle);
-                }
-                break;
+        void start(size_t depth, sl_u64 maxLatency_uS)
+        {
+            stop();
+            {
+                rp::hal::AutoLocker l(_locker);
+                _depth = depth;
+                _maxLatency_uS = maxLatency_uS;
+                _isPriming = true;
+                _period_uS = 0;
+                _lastScanTs_uS = 0;
+                memset(&_stats, 0, sizeof(_stats));
+                _latency.reset();
             }
+            _isWorking = true;
+            _thread = CLASS_THREAD(PacedScanDispatcher, _proc_pacer);
         }
 
-        // all the data is invalid
-        if (i == count) return SL_RESULT_OPERATION_FAIL;
+        void stop()
+        {
+            if (!_isWorking) return;
+            _isWorking = false;
+            _event.set();
+            _thread.join();
 
-        //Tune tail
-        for (i = count - 1; i < count; i--) {
-            // To avoid array overruns, use the i < count condition
-            if (getDistanceQ2(nodebuffer[i]) == 0) {
-                continue;
-            }
-            else {
-                while (i != (count - 1)) {
-                    i++;
-                    float expect_angle = getAngle(nodebuffer[i - 1]) + inc_origin_angle;
-                    if (expect_angle > 360.0f) expect_angle -= 360.0f;
-                    setAngle(nodebuffer[i], expect_angle);
+            rp::hal::AutoLocker l(_locker);
+            _stats.dropped += _count;
+            while (_count) _pop();
+        }
+
+        // the sample clock of the scans, NULL for the host clock; the latency reported is measured on it
+        void setClock(ILidarClock* clock)
+        {
+            _clock.store(clock, std::memory_order_release);
+        }
+
+        void getStats(LidarPacedDeliveryStats& stats)
+        {
+            rp::hal::AutoLocker l(_locker);
+            stats = _stats;
+            stats.period_uS = (sl_u32)_period_uS;
+            _latency.getStats(stats.latency);
+        }
+
+        virtual void onScanComplete(const LidarScanLease& scan, sl_u64 timestamp_uS)
+        {
+            {
+                rp::hal::AutoLocker l(_locker);
+                // a gap of more than two periods is a restart of the scan, not a rotation
+                if (_lastScanTs_uS && timestamp_uS > _lastScanTs_uS) {
+                    sl_u64 period = timestamp_uS - _lastScanTs_uS;
+                    if (!_period_uS) {
+                        _period_uS = period;
+                    }
+                    else if (period < _period_uS * 2) {
+                        _period_uS = (_period_uS * 7 + period) / 8;
+                    }
                 }
-                break;
+                _lastScanTs_uS = timestamp_uS;
+
+                if (_count == _depth) {
+                    _pop();
+                    ++_stats.dropped;
+                }
+                size_t slot = (_head + _count) % LIDAR_PACED_DELIVERY_MAX_DEPTH;
+                _scans[slot] = scan;
+                _timestamps_uS[slot] = timestamp_uS;
+                _arrivals_uS[slot] = getus();
+                ++_count;
             }
+            _event.set();
         }
 
-        //Fill invalid angle in the scan
-        float frontAngle = getAngle(nodebuffer[0]);
-        for (i = 1; i < count; i++) {
-            if (getDistanceQ2(nodebuffer[i]) == 0) {
-                float expect_angle = frontAngle + i * inc_origin_angle;
-                if (expect_angle > 360.0f) expect_angle -= 360.0f;
-                setAngle(nodebuffer[i], expect_angle);
-            }
+    private:
+        void _pop()
+        {
+            _scans[_head].reset();
+            _head = (_head + 1) % LIDAR_PACED_DELIVERY_MAX_DEPTH;
+            --_count;
         }
 
-        // Reorder the scan according to the angle value
-        std::sort(nodebuffer, nodebuffer + count, &angleLessThan<TNode>);
+        u_result _proc_pacer()
+        {
+            sl_u64 nextTick_uS = 0;
+            while (_isWorking) {
+                LidarScanLease scan;
+                sl_u64 timestamp_uS = 0;
+                sl_u32 waitMs = IDLE_WAIT_MS;
+                {
+                    rp::hal::AutoLocker l(_locker);
+                    sl_u64 now = getus();
+                    if (_isPriming && _count >= _depth && _period_uS) {
+                        _isPriming = false;
+                        nextTick_uS = now;
+                    }
 
-        return SL_RESULT_OK;
-    }
+                    if (!_isPriming && now >= nextTick_uS) {
+                        // the time held in the buffer is on the host clock, whatever clock the samples are stamped on
+                        while (_maxLatency_uS && _count > 1 && now - _arrivals_uS[_head] > _maxLatency_uS) {
+                            _pop();
+                            ++_stats.dropped;
+                        }
+
+                        if (!_count) {
+                            ++_stats.underruns;
+                            _isPriming = true;
+                        }
+                        else {
+                            scan = std::move(_scans[_head]);
+                            timestamp_uS = _timestamps_uS[_head];
+                            sl_u64 held_uS = now - _arrivals_uS[_head];
+                            _pop();
+
+                            // the capture to delivery latency, both ends on the sample clock
+                            ILidarClock* clock = _clock.load(std::memory_order_acquire);
+                            sl_u64 sampleNow = clock ? clock->now_uS() : now;
+                            _latency.record(sampleNow > scan->end_timestamp_uS ? sampleNow - scan->end_timestamp_uS : 0);
+                            ++_stats.delivered;
+
+                            sl_s64 target = (sl_s64)(_depth * _period_uS);
+                            if (_maxLatency_uS) target = std::min(target, (sl_s64)_maxLatency_uS);
+                            sl_s64 limit = (sl_s64)(_period_uS >> PHASE_LIMIT_SHIFT);
+                            sl_s64 correction = std::max(std::min((target - (sl_s64)held_uS) / (1 << PHASE_GAIN_SHIFT), limit), -limit);
+                            nextTick_uS += _period_uS + correction;
+                            // fell behind by a period, e.g. the listener took too long: the cadence starts over from now
+                            if (nextTick_uS + _period_uS < now) nextTick_uS = now;
+                        }
+                    }
+                    if (!_isPriming) {
+                        sl_u64 now2 = getus();
+                        waitMs = nextTick_uS > now2 ? (sl_u32)((nextTick_uS - now2 + 999) / 1000) : 0;
+                    }
+                }
 
-    template<typename T>
-    class RawSampleNodeHolder
+                if (scan) {
+                    _target.onScanComplete(scan, timestamp_uS);
+                    continue;
+                }
+                if (waitMs) _event.wait(waitMs);
+            }
+            return RESULT_OK;
+        }
+
+        IScanListener&    _target;
+        rp::hal::Locker   _locker;
+        size_t            _depth;
+        sl_u64            _maxLatency_uS;
+
+        // the jitter buffer, the oldest scan at _head
+        LidarScanLease    _scans[LIDAR_PACED_DELIVERY_MAX_DEPTH];
+        sl_u64            _timestamps_uS[LIDAR_PACED_DELIVERY_MAX_DEPTH];
+        sl_u64            _arrivals_uS[LIDAR_PACED_DELIVERY_MAX_DEPTH];    // on the host clock
+        size_t            _head;
+        size_t            _count;
+        bool              _isPriming;
+
+        sl_u64            _period_uS;
+        sl_u64            _lastScanTs_uS;
+        LidarPacedDeliveryStats _stats;
+        internal::LatencyHistogram _latency;
+        std::atomic<ILidarClock*> _clock;
+
+        std::atomic<bool> _isWorking;
+        rp::hal::Thread   _thread;
+        rp::hal::Event    _event;
+    };
+
+    // the sector counterpart of ScanListenerDispatcher, the sector is copied for the executor
+    class SectorListenerDispatcher : public ISectorListener
     {
     public:
-        RawSampleNodeHolder(size_t maxcount = 8192)
-            : _max_count(maxcount)
+        SectorListenerDispatcher()
+            : _locker(false, true)
+            , _listener(nullptr)
+            , _executor(nullptr)
         {
-           
         }
-        void clear()
+
+        void setTarget(ISectorListener* listener, ILidarExecutor* executor)
         {
             rp::hal::AutoLocker l(_locker);
-            _data_waiter.set(false);
-            _data_queue.clear();
+            _listener = listener;
+            _executor = executor;
         }
 
-        void pushNode(_u64 timestamp_uS, const T* node)
+        virtual void onSectorComplete(const LidarScanSector& sector)
         {
             rp::hal::AutoLocker l(_locker);
-            _data_queue.push_back(*node);
-            if (_data_queue.size() > _max_count) {
-                _data_queue.pop_front();
+            if (!_listener) return;
+
+            if (_executor) {
+                ISectorListener* listener = _listener;
+                std::shared_ptr<SectorCopy> copy = std::allocate_shared<SectorCopy>(internal::SdkAllocator<SectorCopy>(), sector);
+                _executor->execute([listener, copy]() {
+                    listener->onSectorComplete(copy->view);
+                });
+            }
+            else {
+                _listener->onSectorComplete(sector);
             }
-            _data_waiter.set();
         }
 
-        size_t waitAndFetch(T* node, size_t maxcount, _u32 timeout)
+    private:
+        struct SectorCopy
         {
-            if (_data_waiter.wait(timeout) == rp::hal::Event::EVENT_OK)
+            SectorCopy(const LidarScanSector& sector)
+                : nodes(sector.nodes, sector.nodes + sector.count)
+                , timestamps_uS(sector.timestamps_uS, sector.timestamps_uS + sector.count)
+                , view(sector)
             {
-                rp::hal::AutoLocker l(_locker);
-
-                size_t copiedCount = 0;
+                view.nodes = &nodes[0];
+                view.timestamps_uS = &timestamps_uS[0];
+            }
 
-                while (maxcount--) {
-                    node[copiedCount++] = _data_queue.front();
-                    _data_queue.pop_front();
-                }
+            internal::sdk_vector<sl_lidar_response_measurement_node_hq_t> nodes;
+            internal::sdk_vector<sl_u64> timestamps_uS;
+            LidarScanSector view;
+        };
 
-                return copiedCount;
-            }
-            return 0;
-        }
-    protected:
-        size_t          _max_count;
-        rp::hal::Locker _locker;
-        rp::hal::Event  _data_waiter;
-        std::deque<T>   _data_queue;
-        
+        rp::hal::Locker  _locker;
+        ISectorListener* _listener;
+        ILidarExecutor*  _executor;
     };
 
-    template<typename T>
-    class ScanDataHolder
+    // decodes the revolutions kept by DeferredScanHolder in the grabbing thread, with an unpacker of its own
+    // The nodes from the first sync node to the next one form the scan, as the scan holder assembles them.
+    class DeferredScanDecoder : public internal::LIDARSampleDataListener
     {
     public:
-        ScanDataHolder(size_t maxcount = 8192) 
-            : _scan_node_buffer_size(maxcount)
-            , _scan_node_available_id(-1)
-            , _new_scan_ready(false)
+        DeferredScanDecoder()
+            : _locker(false, true)
+            , _nodes(nullptr)
+            , _timestamps_uS(nullptr)
+            , _capacity(0)
+            , _count(0)
+            , _scan_timestamp_uS(0)
+            , _state(STATE_IDLE)
         {
-            _scanbuffer[0].reserve(_scan_node_buffer_size);
-            _scanbuffer[1].reserve(_scan_node_buffer_size);
-
-            memset(_scan_begin_timestamp_uS, 0, sizeof(_scan_begin_timestamp_uS));
+#if defined(SL_LIDAR_STATIC_UNPACKER_HANDLER)
+            _unpacker.reset(new internal::StaticSampleDataUnpacker<internal::unpacker::SL_LIDAR_STATIC_UNPACKER_HANDLER, DeferredScanDecoder>(*this));
+#else
+            _unpacker.reset(internal::LIDARSampleDataUnpacker::CreateInstance(*this));
+#endif
         }
 
-        size_t getMaxCacheCount() const {
-            return _scan_node_buffer_size;
+        void updateUnpackerContext(internal::LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size)
+        {
+            rp::hal::AutoLocker l(_locker);
+            _unpacker->updateUnpackerContext(type, data, size);
         }
 
-
-        void reset() {
+        // count is the capacity of the buffers on entry, timestamps_uS is optional
+        // false if the revolution does not hold a complete scan
+        bool decode(const DeferredScanHolder::Revolution& revolution, sl_lidar_response_measurement_node_hq_t* nodes, sl_u64* timestamps_uS, size_t& count, sl_u64& timestamp_uS)
+        {
             rp::hal::AutoLocker l(_locker);
-            _scan_node_available_id = -1;
-            _new_scan_ready = false;
-            _scanbuffer[0].clear();
-            _scanbuffer[1].clear();
-            _data_waiter.set(false);
-            memset(_scan_begin_timestamp_uS, 0, sizeof(_scan_begin_timestamp_uS));
+            _nodes = nodes;
+            _timestamps_uS = timestamps_uS;
+            _capacity = count;
+            _count = 0;
+            _state = STATE_WAIT_SYNC;
+
+            // each revolution is decoded from a clean state
+            _unpacker->enable();
+            for (size_t pos = 0; pos < revolution.packets.size() && _state != STATE_DONE; ++pos) {
+                const DeferredScanHolder::Packet& packet = revolution.packets[pos];
+                _unpacker->onSampleData(revolution.ans_type, &revolution.bytes[packet.offset], packet.size, packet.timestamp_uS);
+            }
+            _unpacker->disable();
+
+            count = _count;
+            timestamp_uS = _scan_timestamp_uS;
+            bool completed = (_state == STATE_DONE);
+            _state = STATE_IDLE;
+            return completed;
         }
 
-        bool checkNewScanSignalAndReset()
+        virtual void onHQNodeScanResetReq()
         {
-            return _new_scan_ready.exchange(false);
+            if (_state == STATE_COLLECTING) _state = STATE_WAIT_SYNC;
         }
 
-        void pushScanNodeData(_u64 currentSampleTsUs, const T* hqNode)
+        virtual void onHQNodeDecoded(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node)
         {
-            rp::hal::AutoLocker l(_locker);
-
-            int  operationBufID = _getOperationBufferID_locked();
-            auto operationalBuf = &_scanbuffer[operationBufID];
-            
-            if (hqNode->flag & RPLIDAR_RESP_HQ_FLAG_SYNCBIT) {
-                if (operationalBuf->size()) {
-                    operationBufID = _finishCurrentScanAndSwap_locked();
-                    operationalBuf = &_scanbuffer[operationBufID];
+            _pushNode(timestamp_uS, *node);
+        }
 
-                    // publish the available scan
-                    _new_scan_ready = true;
-                    _data_waiter.set();
+        virtual void onHQNodesDecoded(const rplidar_response_measurement_node_hq_t* nodes, const _u64* timestamps_uS, size_t count)
+        {
+            for (size_t pos = 0; pos < count; ++pos) {
+                _pushNode(timestamps_uS[pos], nodes[pos]);
+            }
+        }
 
-                }
-                
-                assert(operationalBuf->size() == 0);
+    protected:
+        enum {
+            STATE_IDLE,
+            STATE_WAIT_SYNC,
+            STATE_COLLECTING,
+            STATE_DONE,
+        };
 
-                //store the timestamp info
-                _scan_begin_timestamp_uS[operationBufID] = currentSampleTsUs;
-            }
-            else {
-                if (operationalBuf->size() == 0) {
-                    //discard the data, do not form partial scan
+        void _pushNode(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t& node)
+        {
+            if (node.flag & SL_LIDAR_RESP_HQ_FLAG_SYNCBIT) {
+                if (_state == STATE_COLLECTING && _count) {
+                    _state = STATE_DONE;
                     return;
                 }
+                if (_state != STATE_WAIT_SYNC) return;
+                _state = STATE_COLLECTING;
+                _count = 0;
+                _scan_timestamp_uS = timestamp_uS;
             }
-
-            if (operationalBuf->size() >= _scan_node_buffer_size) {
-                //replace the last entry if buffer is full
-                operationalBuf->at(operationalBuf->size() - 1) = *hqNode;
-            }
-            else {
-                operationalBuf->push_back(*hqNode);
+            else if (_state != STATE_COLLECTING) {
+                return;
             }
 
+            if (!_capacity) return;
+            // replace the last entry if the buffer is full, as the scan holder does
+            size_t pos = std::min(_count, _capacity - 1);
+            _nodes[pos] = node;
+            if (_timestamps_uS) _timestamps_uS[pos] = timestamp_uS;
+            _count = pos + 1;
         }
 
-        void rewindCurrentScanData() {
-            rp::hal::AutoLocker l(_locker);
-            _getOperationalBuffer_locked().clear();
+        rp::hal::Locker _locker;    // the grab and the context updates of a startScan may race
+        std::shared_ptr<internal::LIDARSampleDataUnpacker> _unpacker;
+
+        // the scan being decoded
+        sl_lidar_response_measurement_node_hq_t* _nodes;
+        sl_u64* _timestamps_uS;
+        size_t  _capacity;
+        size_t  _count;
+        sl_u64  _scan_timestamp_uS;
+        int     _state;
+    };
+
+    class LidarDecodePoolImpl : public ILidarDecodePool
+    {
+    public:
+        LidarDecodePoolImpl(rp::hal::WorkStealingPool* pool)
+            : _pool(pool)
+        {
         }
 
-        std::vector<T>* waitAndLockAvailableScan(_u32 timeout, _u64 * out_timestamp_uS = nullptr)
+        virtual ~LidarDecodePoolImpl()
         {
-            if (_data_waiter.wait(timeout) == rp::hal::Event::EVENT_OK)
-            {
-                _locker.lock();
-                assert(_scan_node_available_id >= 0);
-                _new_scan_ready = false;
-                if (out_timestamp_uS) {
-                    *out_timestamp_uS = _scan_begin_timestamp_uS[_scan_node_available_id];
-                }
-                return &_scanbuffer[_scan_node_available_id];
-            }
-            else {
-                return nullptr;
-            }
+            rp::hal::WorkStealingPool::ReleasePool(_pool);
         }
 
-        void unlockScan(std::vector<T>* scan) {
-            if (scan) {
-                _locker.unlock();
-            }
+        size_t getThreadCount()
+        {
+            return _pool->getThreadCount();
         }
 
-    protected:
-        int _finishCurrentScanAndSwap_locked() {
-            _scan_node_available_id = _getOperationBufferID_locked();
-            int newOperationalID  =  1 - _scan_node_available_id;
+        rp::hal::WorkStealingPool* getPool()
+        {
+            return _pool;
+        }
+
+    private:
+        rp::hal::WorkStealingPool* _pool;
+    };
+
+    class LidarIOReactorImpl : public ILidarIOReactor
+    {
+    public:
+        LidarIOReactorImpl(rp::hal::IOReactor* reactor)
+            : _reactor(reactor)
+        {
+        }
 
-            _scanbuffer[newOperationalID].clear();
-            return newOperationalID;
+        virtual ~LidarIOReactorImpl()
+        {
+            rp::hal::IOReactor::ReleaseReactor(_reactor);
         }
 
-        int _getOperationBufferID_locked() {
-            if (_scan_node_available_id < 0) return 0;
-            return 1 - _scan_node_available_id;
+        size_t getThreadCount()
+        {
+            return _reactor->getThreadCount();
         }
 
-        std::vector<T>& _getOperationalBuffer_locked()
+        LidarIOReactorBackend getBackend()
         {
-            return _scanbuffer[_getOperationBufferID_locked()];
+            switch (_reactor->getBackend()) {
+            case rp::hal::IOReactor::BACKEND_IO_URING:
+                return LIDAR_IO_REACTOR_IO_URING;
+            case rp::hal::IOReactor::BACKEND_IOCP:
+                return LIDAR_IO_REACTOR_IOCP;
+            case rp::hal::IOReactor::BACKEND_KQUEUE:
+                return LIDAR_IO_REACTOR_KQUEUE;
+            default:
+                return LIDAR_IO_REACTOR_EPOLL;
+            }
         }
 
+        rp::hal::IOReactor* getReactor()
+        {
+            return _reactor;
+        }
 
-        rp::hal::Locker _locker;
-        rp::hal::Event  _data_waiter;
+    protected:
+        rp::hal::IOReactor* _reactor;
+    };
 
-        
+#ifdef SL_LIDAR_TRACING
+    // forwards the hal trace events to the user supplied backend
+    class LidarTraceBackendAdapter : public rp::hal::ITraceBackend
+    {
+    public:
+        LidarTraceBackendAdapter()
+            : _backend(nullptr)
+        {
+        }
+
+        void setBackend(ILidarTraceBackend* backend)
+        {
+            _backend.store(backend, std::memory_order_release);
+        }
+
+        void onTraceInstant(const char* category, const char* name, _u64 timestamp_uS, _s64 value)
+        {
+            ILidarTraceBackend* backend = _backend.load(std::memory_order_acquire);
+            if (backend) backend->onTraceInstant(category, name, timestamp_uS, value);
+        }
+
+        void onTraceSliceBegin(const char* category, const char* name, _u64 timestamp_uS)
+        {
+            ILidarTraceBackend* backend = _backend.load(std::memory_order_acquire);
+            if (backend) backend->onTraceSliceBegin(category, name, timestamp_uS);
+        }
 
-        _u64   _scan_begin_timestamp_uS[2];
-        size_t _scan_node_buffer_size;
-        int    _scan_node_available_id;
-        std::atomic<bool>   _new_scan_ready;
+        void onTraceSliceEnd(const char* category, const char* name, _u64 timestamp_uS)
+        {
+            ILidarTraceBackend* backend = _backend.load(std::memory_order_acquire);
+            if (backend) backend->onTraceSliceEnd(category, name, timestamp_uS);
+        }
 
-        std::vector<T> _scanbuffer[2];
+    protected:
+        std::atomic<ILidarTraceBackend*> _backend;
     };
+#endif
 
     class SlamtecLidarDriver : 
-        public ILidarDriver, internal::IProtocolMessageListener, internal::LIDARSampleDataListener
+        public ILidarDriver, internal::IProtocolMessageListener, public internal::LIDARSampleDataListener
     {
     public:
         enum {
             MAX_SCANNODE_CACHE_COUNT = 8192,
+            MAX_SCAN_BIN_COUNT = 65536,
         };
 
         enum {
@@ -394,27 +643,145 @@ namespace sl {
             NEWDESIGN_MINUM_MAJOR_ID = TOF_C_SERIAL_MINUM_MAJOR_ID,
         };
 
+        enum {
+            RECOVERY_MIN_BACKOFF_MS = 50,
+        };
+
+        enum {
+            // the silence of a stream taken for a stall, in sample packets of the scan mode
+            STALL_PACKET_TOLERANCE = 4,
+            // the wake up period of the watchdog while it waits for the first sample or the stream is stalled,
+            // it sleeps without a timeout while the stream is stopped
+            STALL_IDLE_POLL_MS = 100,
+        };
+
+        enum {
+            // the derived capacity holds a revolution of the slowest rotation plus a margin
+            MIN_SCAN_FREQUENCY_HZ = 5,
+            SCAN_CAPACITY_MARGIN_PERCENT = 25,
+            MIN_SCAN_CAPACITY = 360,
+            MAX_SCAN_CAPACITY = 65536,
+        };
+
+        enum {
+            MAX_SCAN_HISTORY_DEPTH = 256,
+        };
+
+        enum {
+            // the time for the LIDAR to leave the stream before the next command of switchScanMode and
+            // startScanFast, instead of the 100ms of stop()
+            STOP_SETTLE_MS = 10,
+        };
+
     public:
+        // the hot fields of the decoder and the consumer threads are cache aligned
+        static void* operator new(size_t size)
+        {
+            return rp::hal::allocCacheAligned(size);
+        }
+
+        static void operator delete(void* ptr)
+        {
+            rp::hal::freeCacheAligned(ptr);
+        }
+
         SlamtecLidarDriver()
             : _isConnected(false)
             , _isSupportingMotorCtrl(MotorCtrlSupportNone)
             , _op_locker(true)
+            , _pacedScanDispatcher(_scanListenerDispatcher)
+            , _hasScanListener(false)
             , _scanHolder(MAX_SCANNODE_CACHE_COUNT)
-            , _rawSampleNodeHolder(MAX_SCANNODE_CACHE_COUNT)
-            , _waiting_packet_type(0)
+            , _sectorAssembler(MAX_SCANNODE_CACHE_COUNT)
+            , _rawSampleNodeHolder(0)
+            , _isDataGrabbing(false)
+            , _inStreamQueries(false)
+            , _capabilitiesLoaded(false)
+            , _isInterfaceDetected(false)
+            , _isMotorCtrlProbed(false)
+            , _isDevInfoCached(false)
+            , _lastDetectedBaudRate(0)
+            , _requestedMotorSpeed(DEFAULT_MOTOR_SPEED)
+            , _userScanCapacity(0)
+            , _isNativeTimestampEnabled(true)
+            , _linkageDelay_uS(0)
+            , _isDeferredDecodingEnabled(false)
+            , _isDecodingDeferred(false)
+            , _samplePathsEnabled(LIDAR_SAMPLE_PATH_ALL)
+            , _samplePaths(LIDAR_SAMPLE_PATH_ALL)
+            , _rxMaxBlockMs(0)
+            , _customSampleListener(NULL)
+            , _isRecoveryWorking(false)
+            , _isRecoveryPending(false)
+            , _recoveryError(SL_RESULT_OK)
+            , _recoveryFailedSince_uS(0)
+            , _recoveryListener(NULL)
+            , _recoveryMaxBackoffMs(0)
+            , _recoveryCount(0)
+            , _recoveryFailureCount(0)
+            , _recoveryAttemptCount(0)
+            , _recoveryDowntime_uS(0)
+            , _isDesiredSpeedCached(false)
+            , _commandedRpm(0)
+            , _scanSampleDuration(0)
+            , _lastSample_uS(0)
+            , _lastPacketArrival_uS(0)
+            , _isFirstSampleWaiting(false)
+            , _keepScanOnReset(false)
+            , _firstSample_uS(0)
+            , _firstSampleArrival_uS(0)
+            , _connectStart_uS(0)
+            , _connect_uS(0)
+            , _startupOrigin_uS(0)
+            , _startupScanCommand_uS(0)
+            , _healthMaxAgeMs(0)
+            , _deviceInfoMaxAgeMs(0)
+            , _motorInfoMaxAgeMs(0)
+            , _queryCommands(0)
+            , _queryCoalesced(0)
+            , _queryCached(0)
+            , _isStallWatchWorking(false)
+            , _stalledSince_uS(0)
+            , _stallPacket_uS(0)
+            , _rxCoalescingWaitMs(0)
+            , _decodeMode(internal::AsyncTransceiver::DECODE_MODE_THREADED)
+            , _stallListener(NULL)
+            , _stallMinSilenceMs(0)
+            , _isStallRecovering(false)
+            , _stallCount(0)
         {
             _protocolHandler = std::make_shared< internal::RPLidarProtocolCodec>();
             _transeiver = std::make_shared< internal::AsyncTransceiver>(*_protocolHandler);
+            _answerPool = internal::ProtocolMessagePool::create();
+#if defined(SL_LIDAR_STATIC_UNPACKER_HANDLER)
+            _dataunpacker.reset(new internal::StaticSampleDataUnpacker<internal::unpacker::SL_LIDAR_STATIC_UNPACKER_HANDLER, SlamtecLidarDriver>(*this));
+#else
             _dataunpacker.reset(internal::LIDARSampleDataUnpacker::CreateInstance(*this));
+#endif
 
             _protocolHandler->setMessageListener(this);
+            _transeiver->setRecorder(&_recorder);
+#ifdef SL_LIDAR_LATENCY_PROFILING
+            _transeiver->setLatencyProfile(&_latencyProfile);
+            _scanHolder.setLatencyProfile(&_latencyProfile);
+#endif
 
             memset(&_cached_DevInfo, 0, sizeof(_cached_DevInfo));
+            memset(_isCustomSampleType, 0, sizeof(_isCustomSampleType));
+            memset(&_resumeScan, 0, sizeof(_resumeScan));
+            memset(&_desiredSpeed, 0, sizeof(_desiredSpeed));
+            memset(&_realtimeOptions, 0, sizeof(_realtimeOptions));
+            memset(&_startupTimings, 0, sizeof(_startupTimings));
+            _scanRegion.start_deg = 0;
+            _scanRegion.span_deg = 360;
         }
 
 
         virtual ~SlamtecLidarDriver()
         {
+            _pacedScanDispatcher.stop();
+            setStallWatchdog(false);
+            setAutoRecovery(false);
             disconnect();
             _protocolHandler->setMessageListener(nullptr);
         }
@@ -424,6 +791,7 @@ namespace sl {
         {
             rp::hal::AutoLocker l(_op_locker);
             if (!devInfo) {
+                _fetchCachedDevInfo();
                 devInfo = &_cached_DevInfo;
             }
 
@@ -434,6 +802,7 @@ namespace sl {
         {
             rp::hal::AutoLocker l(_op_locker);
             if (!devInfo) {
+                _fetchCachedDevInfo();
                 devInfo = &_cached_DevInfo;
             }
 
@@ -461,6 +830,7 @@ namespace sl {
 
 
             if (!devInfo) {
+                _fetchCachedDevInfo();
                 devInfo = &_cached_DevInfo;
             }
 
@@ -477,16 +847,31 @@ namespace sl {
             if (isConnected()) return SL_RESULT_ALREADY_DONE;
 
             _rawSampleNodeHolder.clear();
+            if (_realtimeOptions.prefault_buffers) _transeiver->prefaultBuffers();
 
             sl_result ans;
-            
+            _u64 connectStart_uS = getus();
        
-            ans = (sl_result)_transeiver->openChannelAndBind(channel);
+            ans = (sl_result)_transeiver->openChannelAndBind(channel, _decodeMode);
 
             if (IS_OK(ans)) {
                 _isConnected = true;
-                // the first dev info local cache will be taken here
-                checkMotorCtrlSupport(_isSupportingMotorCtrl, 500);
+                _isInterfaceDetected = false;
+                // the dev info and the motor control support are probed once they are needed
+                _isDevInfoCached = false;
+                _invalidateQueries();
+                _isMotorCtrlProbed = false;
+                _isSupportingMotorCtrl = MotorCtrlSupportNone;
+                _isRecoveryPending = false;
+                _resumeScan.isActive = false;
+                _preparedScanModes.clear();
+                _isDesiredSpeedCached = false;
+                _commandedRpm = 0;
+                // the first startScanFast accounts for the connection
+                _connectStart_uS = connectStart_uS;
+                _connect_uS = getus() - connectStart_uS;
+                _startupScanCommand_uS = 0;
+                memset(&_startupTimings, 0, sizeof(_startupTimings));
             }
             
             return ans;
@@ -500,6 +885,8 @@ namespace sl {
 
                 _transeiver->unbindAndClose();
                 _isConnected = false;
+                _isRecoveryPending = false;
+                _commandPipeline.abortAll(SL_RESULT_OPERATION_STOP);
             }
         }
 
@@ -508,6 +895,38 @@ namespace sl {
             return _isConnected;
         }
 
+        sl_result setIOReactor(ILidarIOReactor* reactor)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            _transeiver->setIOReactor(reactor ? static_cast<LidarIOReactorImpl*>(reactor)->getReactor() : NULL);
+            return SL_RESULT_OK;
+        }
+
+        sl_result setDecodePool(ILidarDecodePool* pool)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            _transeiver->setDecodePool(pool ? static_cast<LidarDecodePoolImpl*>(pool)->getPool() : NULL);
+            return SL_RESULT_OK;
+        }
+
+        // not part of ILidarDriver, the threading is fixed when the driver is created
+        void setThreadConfig(const rp::hal::Thread::config_t& rx, const rp::hal::Thread::config_t& decoder)
+        {
+            _transeiver->setThreadConfig(rx, decoder);
+        }
+
+        void setInlineDecode(bool enable)
+        {
+            _decodeMode = enable ? internal::AsyncTransceiver::DECODE_MODE_INLINE : internal::AsyncTransceiver::DECODE_MODE_THREADED;
+        }
+
+        sl_result setRxCoalescing(const LidarRxCoalescing& policy)
+        {
+            _transeiver->setRxCoalescing(policy.min_batch_bytes, policy.max_wait_ms);
+            _rxCoalescingWaitMs = policy.max_wait_ms;
+            return SL_RESULT_OK;
+        }
+
         sl_result reset(sl_u32 timeoutInMs = DEFAULT_TIMEOUT)
         {
             rp::hal::AutoLocker l(_op_locker);
@@ -527,26 +946,32 @@ namespace sl {
             if (!ans) return SL_RESULT_INVALID_DATA;
 
             if (confProtocolSupported) {
+                if (_syncCapabilities(_cached_DevInfo) && (_capabilities.flags & internal::CAPABILITY_CACHE_FLAG_SCAN_MODES)) {
+                    outModes.insert(outModes.end(), _capabilities.scanModes.begin(), _capabilities.scanModes.end());
+                    return SL_RESULT_OK;
+                }
+
                 // 1. get scan mode count
                 sl_u16 modeCount;
                 ans = getScanModeCount(modeCount, timeoutInMs);
                 if (!ans) return ans;
-                // 2. for loop to get all fields of each scan mode
+                // 2. for loop to get all fields of each scan mode, the queries of a mode are in flight together
+                std::vector<LidarScanMode> modes;
                 for (sl_u16 i = 0; i < modeCount; i++) {
                     LidarScanMode scanModeInfoTmp;
                     memset(&scanModeInfoTmp, 0, sizeof(scanModeInfoTmp));
-                    scanModeInfoTmp.id = i;
-                    ans = getLidarSampleDuration(scanModeInfoTmp.us_per_sample, i, timeoutInMs);
-                    if (!ans) return ans;
-                    ans = getMaxDistance(scanModeInfoTmp.max_distance, i, timeoutInMs);
-                    if (!ans) return ans;
-                    ans = getScanModeAnsType(scanModeInfoTmp.ans_type, i, timeoutInMs);
-                    if (!ans) return ans;
-                    ans = getScanModeName(scanModeInfoTmp.scan_mode, sizeof(scanModeInfoTmp.scan_mode), i, timeoutInMs);
+                    ans = _getScanModeInfo(scanModeInfoTmp, i, timeoutInMs);
                     if (!ans) return ans;
-                    outModes.push_back(scanModeInfoTmp);
+                    modes.push_back(scanModeInfoTmp);
 
                 }
+                outModes.insert(outModes.end(), modes.begin(), modes.end());
+
+                if (_syncCapabilities(_cached_DevInfo)) {
+                    _capabilities.scanModes.swap(modes);
+                    _capabilities.flags |= internal::CAPABILITY_CACHE_FLAG_SCAN_MODES;
+                    _storeCapabilities();
+                }
                 return ans;
             }
 
@@ -565,6 +990,11 @@ namespace sl {
             if (!ans) return ans;
 
             if (lidarSupportConfigCmds) {
+                if (_syncCapabilities(_cached_DevInfo) && (_capabilities.flags & internal::CAPABILITY_CACHE_FLAG_TYPICAL_MODE)) {
+                    outMode = _capabilities.typicalMode;
+                    return SL_RESULT_OK;
+                }
+
                 ans = getLidarConf(SL_LIDAR_CONF_SCAN_MODE_TYPICAL, answer, nullptr, 0, timeoutInMs);
                 if (!ans) return ans;
                 if (answer.size() < sizeof(sl_u16)) {
@@ -572,6 +1002,12 @@ namespace sl {
                 }
                 const sl_u16 *p_answer = reinterpret_cast<const sl_u16*>(&answer[0]);
                 outMode = *p_answer;
+
+                if (_syncCapabilities(_cached_DevInfo)) {
+                    _capabilities.typicalMode = outMode;
+                    _capabilities.flags |= internal::CAPABILITY_CACHE_FLAG_TYPICAL_MODE;
+                    _storeCapabilities();
+                }
                 return ans;
             }
             //old version of triangle lidar
@@ -624,14 +1060,7 @@ namespace sl {
 
             if (ifSupportLidarConf) {
 
-                outUsedScanMode.id = SL_LIDAR_CONF_SCAN_COMMAND_STD;
-                ans = getLidarSampleDuration(outUsedScanMode.us_per_sample, outUsedScanMode.id);
-                if (!ans) return ans;
-                ans = getMaxDistance(outUsedScanMode.max_distance, outUsedScanMode.id);
-                if (!ans) return ans;
-                ans = getScanModeAnsType(outUsedScanMode.ans_type, outUsedScanMode.id);
-                if (!ans) return ans;
-                ans = getScanModeName(outUsedScanMode.scan_mode, sizeof(outUsedScanMode.scan_mode), outUsedScanMode.id);
+                ans = _getScanModeInfo(outUsedScanMode, SL_LIDAR_CONF_SCAN_COMMAND_STD, timeout);
                 if (!ans) return ans;
 
             }
@@ -648,17 +1077,12 @@ namespace sl {
             }
 
 
-            _updateTimingDesc(_cached_DevInfo, outUsedScanMode.us_per_sample);
-
-            startMotor();
-
-            _scanHolder.reset();
-            _dataunpacker->enable();
-
-            ans = _sendCommandWithoutResponse(force ? SL_LIDAR_CMD_FORCE_SCAN : SL_LIDAR_CMD_SCAN, nullptr, 0, true);
-            if (ans) delay(10); // wait rplidar to handle it
-            return ans;
-        }
+            ans = _startScanStream(force, outUsedScanMode, 0, ifSupportLidarConf, false);
+            if (ans) {
+                delay(10); // wait rplidar to handle it
+            }
+            return ans;
+        }
 
 
         sl_result startScanNormal(bool force, sl_u32 timeout = DEFAULT_TIMEOUT)
@@ -699,65 +1123,289 @@ namespace sl {
 
 
             
-            outUsedScanMode->id = scanMode;
-            if (ifSupportLidarConf) {
-                ans = getLidarSampleDuration(outUsedScanMode->us_per_sample, outUsedScanMode->id);
-                if (!ans) return SL_RESULT_INVALID_DATA;
+            ans = _resolveScanMode(*outUsedScanMode, scanMode, ifSupportLidarConf, timeout);
+            if (!ans) return SL_RESULT_INVALID_DATA;
 
-                ans = getMaxDistance(outUsedScanMode->max_distance, outUsedScanMode->id);
-                if (!ans) return SL_RESULT_INVALID_DATA;
+            if (outUsedScanMode->ans_type == SL_LIDAR_ANS_TYPE_MEASUREMENT)
+            {
+                // redirect to the correct function...
+                return startScanNormal(force, timeout);
+            }
 
-                ans = getScanModeAnsType(outUsedScanMode->ans_type, outUsedScanMode->id);
-                if (!ans) return SL_RESULT_INVALID_DATA;
+            ans = _startScanStream(force, *outUsedScanMode, options, ifSupportLidarConf, false);
+            if (ans) {
+                delay(10); // wait rplidar to handle it
+            }
+            return ans;
 
-                ans = getScanModeName(outUsedScanMode->scan_mode, sizeof(outUsedScanMode->scan_mode), outUsedScanMode->id);
-                if (!ans) return SL_RESULT_INVALID_DATA;
+        }
+
+        sl_result startScanFast(LidarStartupInfo* outInfo = nullptr, sl_u32 firstScanTimeout = DEFAULT_FIRST_SCAN_TIMEOUT, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+            SL_TRACE_SCOPE(rp::hal::TRACE_CATEGORY_CMD, "start_scan_fast");
+
+            LidarStartupInfo localInfo;
+            if (!outInfo) outInfo = &localInfo;
+            memset(outInfo, 0, sizeof(*outInfo));
+
+            // the first start since connect() accounts for it
+            LidarStartupTimings& timings = _startupTimings;
+            memset(&timings, 0, sizeof(timings));
+            _u64 phaseStart_uS = getus();
+            _startupOrigin_uS = _connectStart_uS ? _connectStart_uS : phaseStart_uS;
+            timings.connect_uS = _connectStart_uS ? _connect_uS : 0;
+            _connectStart_uS = 0;
+            _startupScanCommand_uS = 0;
+
+            // 1. a stream left running, without the settle time and the motor stop of stop()
+            Result<nullptr_t> ans = _sendCommandWithoutResponse(SL_LIDAR_CMD_STOP);
+            if (!ans) return ans;
+            _resumeScan.isActive = false;
+            delay(STOP_SETTLE_MS);
+            _u64 now_uS = getus();
+            timings.stop_uS = now_uS - phaseStart_uS;
+
+            // 2. the device info and the health in flight together
+            phaseStart_uS = now_uS;
+            std::future<LidarCommandAnswer> devInfoAnswer = sendCommandAsync(SL_LIDAR_CMD_GET_DEVICE_INFO, SL_LIDAR_ANS_TYPE_DEVINFO, NULL, 0, timeout);
+            std::future<LidarCommandAnswer> healthAnswer = sendCommandAsync(SL_LIDAR_CMD_GET_DEVICE_HEALTH, SL_LIDAR_ANS_TYPE_DEVHEALTH, NULL, 0, timeout);
+            u_result ansDevInfo = _parseDeviceInfo(devInfoAnswer.get(), outInfo->device_info);
+            u_result ansHealth = _parseHealth(healthAnswer.get(), outInfo->health);
+            if (IS_FAIL(ansDevInfo)) return ansDevInfo;
+            if (IS_FAIL(ansHealth)) return ansHealth;
+            _cached_DevInfo = outInfo->device_info;
+            _isDevInfoCached = true;
+            if (outInfo->health.status == SL_LIDAR_STATUS_ERROR) return SL_RESULT_OPERATION_FAIL;
+            now_uS = getus();
+            timings.identify_uS = now_uS - phaseStart_uS;
+
+            // 3. the motor control from the model or the cache, then the typical scan mode and the desired speed together;
+            // the motor is started once its speed is known and spins up while the typical scan mode is waited for
+            phaseStart_uS = now_uS;
+            bool isMotorStarted = false;
+            if (!_isMotorCtrlProbed) {
+                MotorCtrlSupport support;
+                if (IS_OK(_checkMotorCtrlSupport(_cached_DevInfo, support, timeout))) {
+                    _isSupportingMotorCtrl = support;
+                    _isMotorCtrlProbed = true;
+                }
             }
-            else {
-                // legacy device support
-                if (scanMode != RPLIDAR_CONF_SCAN_COMMAND_STD) {
-                    rplidar_response_sample_rate_t sampleRateTmp;
-                    ans = _getLegacySampleDuration_uS(sampleRateTmp, timeout);
-                    if (!ans) return RESULT_INVALID_DATA;
-
-                    outUsedScanMode->us_per_sample = sampleRateTmp.express_sample_duration_us;
-                    outUsedScanMode->max_distance = 16;
-                    outUsedScanMode->ans_type = SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED;
-                    strcpy(outUsedScanMode->scan_mode, "Express");
+
+            bool ifSupportLidarConf = _isConfCommandSupported(_cached_DevInfo);
+            sl_u16 scanMode = SL_LIDAR_CONF_SCAN_COMMAND_EXPRESS;
+            timings.capabilities_cached = true;
+            if (ifSupportLidarConf) {
+                std::future<LidarCommandAnswer> typicalAnswer;
+                std::future<LidarCommandAnswer> desiredSpeedAnswer;
+                if (_syncCapabilities(_cached_DevInfo) && (_capabilities.flags & internal::CAPABILITY_CACHE_FLAG_TYPICAL_MODE)) {
+                    scanMode = _capabilities.typicalMode;
                 }
                 else {
-                    outUsedScanMode->ans_type = SL_LIDAR_ANS_TYPE_MEASUREMENT;
+                    typicalAnswer = _getLidarConfAsync(SL_LIDAR_CONF_SCAN_MODE_TYPICAL, nullptr, 0, timeout);
+                }
+                if (_isSupportingMotorCtrl != MotorCtrlSupportNone && !_isDesiredSpeedCached) {
+                    desiredSpeedAnswer = _getLidarConfAsync(SL_LIDAR_CONF_DESIRED_ROT_FREQ, nullptr, 0, timeout);
+                }
+
+                // all the futures are waited for, none of the answers may outlive this call
+                if (desiredSpeedAnswer.valid()) {
+                    LidarCommandAnswer answer = desiredSpeedAnswer.get();
+                    if (IS_OK(answer.result) && answer.payload.size() >= sizeof(_desiredSpeed)) {
+                        memcpy(&_desiredSpeed, &answer.payload[0], sizeof(_desiredSpeed));
+                        _isDesiredSpeedCached = true;
+                    }
+                }
+                _startMotorTimed(timings);
+                isMotorStarted = true;
+
+                u_result ansTypical = SL_RESULT_OK;
+                bool isTypicalQueried = typicalAnswer.valid();
+                if (isTypicalQueried) {
+                    timings.capabilities_cached = false;
+                    ansTypical = _parseTypicalScanMode(typicalAnswer.get(), scanMode);
+                }
+                if (IS_FAIL(ansTypical)) return ansTypical;
+                if (isTypicalQueried && _syncCapabilities(_cached_DevInfo)) {
+                    _capabilities.typicalMode = scanMode;
+                    _capabilities.flags |= internal::CAPABILITY_CACHE_FLAG_TYPICAL_MODE;
+                    _storeCapabilities();
+                }
+            }
+            if (!isMotorStarted) _startMotorTimed(timings);
+            now_uS = getus();
+            timings.config_uS = now_uS - phaseStart_uS - timings.motor_uS;
+
+            // 4. the parameters of the scan mode and the scan command
+            phaseStart_uS = now_uS;
+            LidarScanMode& mode = outInfo->scan_mode;
+            if (!ifSupportLidarConf || !_findPreparedScanMode(scanMode, mode)) {
+                timings.capabilities_cached = false;
+                if (ifSupportLidarConf && _capabilityCache.isEnabled()) {
+                    // the whole list once, for the cache to answer the next startups
+                    std::vector<LidarScanMode> modes;
+                    ans = getAllSupportedScanModes(modes, timeout);
+                    if (!ans) return ans;
+                }
+                if (!ifSupportLidarConf || !_findPreparedScanMode(scanMode, mode)) {
+                    ans = _resolveScanMode(mode, scanMode, ifSupportLidarConf, timeout);
+                    if (!ans) return ans;
                 }
             }
 
-            if (outUsedScanMode->ans_type == SL_LIDAR_ANS_TYPE_MEASUREMENT)
-            {
-                // redirect to the correct function...
-                return startScanNormal(force, timeout);
+            _firstSampleEvt.set(false);
+            _isFirstSampleWaiting = true;
+            ans = _startScanStream(false, mode, 0, ifSupportLidarConf, true);
+            if (!ans) {
+                _isFirstSampleWaiting = false;
+                return ans;
             }
-            
-            _updateTimingDesc(_cached_DevInfo, outUsedScanMode->us_per_sample);
-            startMotor();
+            _startupScanCommand_uS = getus();
+            timings.scan_command_uS = _startupScanCommand_uS - phaseStart_uS;
 
-            _scanHolder.reset();
-            _dataunpacker->enable();
+            // 5. the first sample and the first complete scan
+            if (!firstScanTimeout) return SL_RESULT_OK;
+            if (_firstSampleEvt.wait(firstScanTimeout) != rp::hal::Event::EVENT_OK) return SL_RESULT_OPERATION_TIMEOUT;
+            _noteFirstStartupSample();
+            if (_isDecodingDeferred.load() || !_isSamplePathActive(LIDAR_SAMPLE_PATH_SCANS)) {
+                timings.total_uS = _firstSampleArrival_uS - _startupOrigin_uS;
+                _startupScanCommand_uS = 0;
+                return SL_RESULT_OK;
+            }
+
+            _u64 elapsed_ms = (getus() - _startupScanCommand_uS) / 1000;
+            _u64 firstScan_uS = _scanHolder.waitForFirstScan(elapsed_ms < firstScanTimeout ? (_u32)(firstScanTimeout - elapsed_ms) : 0);
+            if (!firstScan_uS) return SL_RESULT_OPERATION_TIMEOUT;
+            _noteFirstStartupScan(firstScan_uS);
+            return SL_RESULT_OK;
+        }
+
+        sl_result getStartupTimings(LidarStartupTimings& timings)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            // the phases left to complete after startScanFast has returned
+            if (_startupScanCommand_uS) {
+                if (!_startupTimings.first_sample_uS && _firstSampleEvt.wait(0) == rp::hal::Event::EVENT_OK) {
+                    _noteFirstStartupSample();
+                }
+                if (_startupTimings.first_sample_uS && !_isDecodingDeferred.load() && _isSamplePathActive(LIDAR_SAMPLE_PATH_SCANS)) {
+                    _u64 firstScan_uS = _scanHolder.waitForFirstScan(0);
+                    if (firstScan_uS) _noteFirstStartupScan(firstScan_uS);
+                }
+            }
+            timings = _startupTimings;
+            return SL_RESULT_OK;
+        }
+
+        sl_result prepareScanMode(sl_u16 scanMode, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            LidarScanMode mode;
+            if (_findPreparedScanMode(scanMode, mode)) return SL_RESULT_OK;
+
+            bool ifSupportLidarConf = false;
+            Result<nullptr_t> ans = checkSupportConfigCommands(ifSupportLidarConf, timeout);
+            if (!ans) return ans;
+            if (!ifSupportLidarConf) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            return _getScanModeInfo(mode, scanMode, timeout);
+        }
+
+        sl_result switchScanMode(sl_u16 scanMode, sl_u32 options = 0, LidarScanMode* outUsedScanMode = nullptr, LidarScanModeSwitchStats* stats = nullptr, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
 
-            sl_lidar_payload_express_scan_t scanReq;
-            memset(&scanReq, 0, sizeof(scanReq));
+            LidarScanModeSwitchStats localStats;
+            LidarScanMode localMode;
+            if (!stats) stats = &localStats;
+            if (!outUsedScanMode) outUsedScanMode = &localMode;
+            memset(stats, 0, sizeof(*stats));
+
+            _u64 commandStart_uS = getus();
+            Result<nullptr_t> ans = SL_RESULT_OK;
 
-            if (!ifSupportLidarConf) {
-                if (scanMode != SL_LIDAR_CONF_SCAN_COMMAND_STD && scanMode != SL_LIDAR_CONF_SCAN_COMMAND_EXPRESS)
+            // the in place switch needs the parameters of the mode without asking the LIDAR
+            if (!_isDataGrabbing || !_resumeScan.isActive || _isDecodingDeferred.load()
+                || !_findPreparedScanMode(scanMode, *outUsedScanMode)) {
+                stats->last_sample_uS = _isDataGrabbing ? _lastSample_uS.load() : 0;
+                _firstSampleEvt.set(false);
+                _isFirstSampleWaiting = true;
+                ans = startScanExpress(false, scanMode, options, outUsedScanMode, timeout);
+            }
+            else {
+                SL_TRACE_SCOPE(rp::hal::TRACE_CATEGORY_CMD, "switch_scan_mode");
+                stats->hot_switched = true;
+
+                // the holders stay in their steady state, unlike _disableDataGrabbing;
+                // the gap of the switch is not a stall
+                _stallPacket_uS = 0;
+                ans = _sendCommandWithoutResponse(SL_LIDAR_CMD_STOP, nullptr, 0, true);
+                if (!ans) return ans;
+                _dataunpacker->disable();
+                _protocolHandler->exitLoopMode();
+                stats->last_sample_uS = _lastSample_uS.load();
+                delay(STOP_SETTLE_MS);
+
+                // the motor keeps its speed and the scan in progress is kept, unlike startScanExpress
+                _updateTimingDesc(_cached_DevInfo, outUsedScanMode->us_per_sample);
+                _updateScanCapacity(outUsedScanMode->us_per_sample);
+                _scanHolder.setSampleDuration(outUsedScanMode->us_per_sample);
+
+                _keepScanOnReset = true;
+                _firstSampleEvt.set(false);
+                _isFirstSampleWaiting = true;
+                _dataunpacker->enable();
+
+                if (outUsedScanMode->ans_type == SL_LIDAR_ANS_TYPE_MEASUREMENT) {
+                    ans = _sendCommandWithoutResponse(SL_LIDAR_CMD_SCAN, nullptr, 0, true);
+                }
+                else {
+                    sl_lidar_payload_express_scan_t scanReq;
+                    memset(&scanReq, 0, sizeof(scanReq));
                     scanReq.working_mode = sl_u8(scanMode);
+                    scanReq.working_flags = options;
+                    ans = _sendCommandWithoutResponse(SL_LIDAR_CMD_EXPRESS_SCAN, &scanReq, sizeof(scanReq), true);
+                }
+
+                if (ans) {
+                    _resumeScan.isExpress = outUsedScanMode->ans_type != SL_LIDAR_ANS_TYPE_MEASUREMENT;
+                    _resumeScan.force = false;
+                    _resumeScan.scanMode = scanMode;
+                    _resumeScan.options = options;
+                }
+                else {
+                    _disableDataGrabbing();
+                    _resumeScan.isActive = false;
+                }
             }
-            else
-                scanReq.working_mode = sl_u8(scanMode);
+            stats->command_uS = getus() - commandStart_uS;
 
-            scanReq.working_flags = options;
+            if (!ans) {
+                _isFirstSampleWaiting = false;
+                _keepScanOnReset = false;
+                return ans;
+            }
 
-            ans = _sendCommandWithoutResponse(SL_LIDAR_CMD_EXPRESS_SCAN, &scanReq, sizeof(scanReq), true);
-            if (ans) delay(10); // wait rplidar to handle it
-            return ans;
+            if (_firstSampleEvt.wait(timeout) != rp::hal::Event::EVENT_OK) {
+                _isFirstSampleWaiting = false;
+                _keepScanOnReset = false;
+                return SL_RESULT_OPERATION_TIMEOUT;
+            }
 
+            stats->first_sample_uS = _firstSample_uS;
+            if (stats->hot_switched) {
+                _lastPacketArrival_uS = 0;
+                _stallPacket_uS = _samplePacketDuration_uS(*outUsedScanMode);
+                _stallEvt.set();
+            }
+            if (stats->last_sample_uS && stats->first_sample_uS > stats->last_sample_uS) {
+                stats->gap_uS = stats->first_sample_uS - stats->last_sample_uS;
+            }
+            return SL_RESULT_OK;
         }
 
         sl_result stop(sl_u32 timeout = DEFAULT_TIMEOUT)
@@ -768,12 +1416,14 @@ namespace sl {
             u_result ans = SL_RESULT_OK;
             ans = _sendCommandWithoutResponse(SL_LIDAR_CMD_STOP);
             _disableDataGrabbing();
+            _resumeScan.isActive = false;
 
             if (IS_FAIL(ans)) return ans;
             
 
             delay(100);
 
+            _probeMotorCtrlSupport();
             if(_isSupportingMotorCtrl == MotorCtrlSupportPwm)
                 setMotorSpeed(0);
   
@@ -782,21 +1432,19 @@ namespace sl {
 
         sl_result grabScanDataHqWithTimeStamp(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u64& timestamp_uS, sl_u32 timeout = DEFAULT_TIMEOUT)
         {
-            rp::hal::AutoLocker l(_op_locker);
-
             if (!nodebuffer)
                 return SL_RESULT_INVALID_DATA;
 
-            auto availBuffer = _scanHolder.waitAndLockAvailableScan(timeout, &timestamp_uS);
-            if (!availBuffer) return SL_RESULT_OPERATION_TIMEOUT;
-
-            count = std::min<size_t>(count, availBuffer->size());
-
-            std::copy(availBuffer->begin(), availBuffer->begin() + count, nodebuffer);
+            return _grabScanDataHq(nodebuffer, nullptr, count, timestamp_uS, timeout);
+        }
 
-            _scanHolder.unlockScan(availBuffer);
+        sl_result grabScanDataHqWithSampleTimeStamps(sl_lidar_response_measurement_node_hq_t* nodebuffer, sl_u64* timestamps_uS, size_t& count, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            if (!nodebuffer || !timestamps_uS)
+                return SL_RESULT_INVALID_DATA;
 
-            return RESULT_OK;
+            _u64 localTS;
+            return _grabScanDataHq(nodebuffer, timestamps_uS, count, localTS, timeout);
         }
 
         sl_result grabScanDataHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u32 timeout = DEFAULT_TIMEOUT)
@@ -805,7 +1453,431 @@ namespace sl {
             return grabScanDataHqWithTimeStamp(nodebuffer, count, localTS, timeout);
         }
 
+        sl_result grabScanDataHqLease(LidarScanLease& lease, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            if (!_isSamplePathActive(LIDAR_SAMPLE_PATH_SCANS)) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            rp::hal::AutoLocker l(_grab_locker);
+
+            lease = _scanHolder.waitAndLeaseNewestScan(timeout);
+            if (!lease) return SL_RESULT_OPERATION_TIMEOUT;
+            return SL_RESULT_OK;
+        }
+
+        sl_result tryGrabScanSince(sl_u64& sequence, sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u64* timestamps_uS)
+        {
+            if (!nodebuffer) return SL_RESULT_INVALID_DATA;
+            if (!_isSamplePathActive(LIDAR_SAMPLE_PATH_SCANS)) return SL_RESULT_OPERATION_NOT_SUPPORT;
+            // the deferred revolutions are decoded by the grab that takes them, see setDeferredDecoding
+            if (_isDecodingDeferred || !_scanHolder.hasNodeOutput()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            rp::hal::AutoLocker l(_grab_locker);
+
+            auto availBuffer = _scanHolder.takeNewestScanSince(sequence);
+            if (!availBuffer) return SL_RESULT_OPERATION_TIMEOUT;
+
+            const LidarScanData& scan = availBuffer->view;
+            count = std::min<size_t>(count, scan.count);
+            sequence = scan.sequence;
+
+            std::copy(scan.nodes, scan.nodes + count, nodebuffer);
+            if (timestamps_uS) {
+                std::copy(scan.timestamps_uS, scan.timestamps_uS + count, timestamps_uS);
+            }
+            return SL_RESULT_OK;
+        }
+
+        sl_result getScanReadyHandle(LidarWaitHandle& handle)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+
+            if (!_scanReadyNotifier) {
+                std::unique_ptr<rp::hal::Notifier> notifier(new rp::hal::Notifier());
+                if (!notifier->isValid()) return SL_RESULT_OPERATION_FAIL;
+
+                _scanReadyNotifier = std::move(notifier);
+                _scanHolder.setReadyNotifier(_scanReadyNotifier.get());
+                _deferredScanHolder.setReadyNotifier(_scanReadyNotifier.get());
+            }
+
+            handle = (LidarWaitHandle)_scanReadyNotifier->getHandle();
+            return SL_RESULT_OK;
+        }
+
+        sl_result setScanHistoryDepth(size_t depth)
+        {
+            if (depth > MAX_SCAN_HISTORY_DEPTH) return SL_RESULT_INVALID_DATA;
+            _scanHolder.setHistoryDepth(depth);
+            return SL_RESULT_OK;
+        }
+
+        sl_result getScanHistoryLeaseBySequence(sl_u64 sequence, LidarScanLease& lease)
+        {
+            ScanHistory<sl_lidar_response_measurement_node_hq_t>& history = _scanHolder.getHistory();
+            lease.reset();
+            if (!history.getDepth()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            lease = history.leaseBySequence(sequence);
+            return lease ? SL_RESULT_OK : SL_RESULT_OPERATION_FAIL;
+        }
+
+        sl_result getScanHistoryLeaseByTimestamp(sl_u64 timestamp_uS, LidarScanLease& lease)
+        {
+            ScanHistory<sl_lidar_response_measurement_node_hq_t>& history = _scanHolder.getHistory();
+            lease.reset();
+            if (!history.getDepth()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            lease = history.leaseByTimestamp(timestamp_uS);
+            return lease ? SL_RESULT_OK : SL_RESULT_OPERATION_FAIL;
+        }
+
+        sl_result getRecentScanLeases(LidarScanLease* leases, size_t& count)
+        {
+            ScanHistory<sl_lidar_response_measurement_node_hq_t>& history = _scanHolder.getHistory();
+            if (!history.getDepth()) {
+                count = 0;
+                return SL_RESULT_OPERATION_NOT_SUPPORT;
+            }
+
+            history.leaseRecent(leases, count);
+            return SL_RESULT_OK;
+        }
+
+        sl_result setScanListener(IScanListener* listener, ILidarExecutor* executor = NULL)
+        {
+            // not guarded by the grab locker, it may be held by a waiting grab
+            _scanListenerDispatcher.setTarget(listener, executor);
+
+            rp::hal::AutoLocker l(_scanRouteLocker);
+            _hasScanListener = (listener != NULL);
+            _routeScanListener();
+            return SL_RESULT_OK;
+        }
+
+        sl_result setPacedDelivery(const LidarPacedDeliveryOptions& options)
+        {
+            if (options.buffer_depth > LIDAR_PACED_DELIVERY_MAX_DEPTH) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_scanRouteLocker);
+            if (options.buffer_depth) {
+                _pacedScanDispatcher.start(options.buffer_depth, (sl_u64)options.max_added_latency_ms * 1000);
+                _routeScanListener();
+            }
+            else if (_pacedScanDispatcher.isEnabled()) {
+                _routeScanListener(false);
+                _pacedScanDispatcher.stop();
+            }
+            return SL_RESULT_OK;
+        }
+
+        sl_result getPacedDeliveryStats(LidarPacedDeliveryStats& stats)
+        {
+            _pacedScanDispatcher.getStats(stats);
+            return SL_RESULT_OK;
+        }
+
+        // the scan holder calls the paced dispatcher if enabled, the listener dispatcher otherwise; under _scanRouteLocker
+        void _routeScanListener(bool paced = true)
+        {
+            IScanListener* route = NULL;
+            if (_hasScanListener) {
+                route = (paced && _pacedScanDispatcher.isEnabled()) ? (IScanListener*)&_pacedScanDispatcher : &_scanListenerDispatcher;
+            }
+            _scanHolder.setScanListener(route);
+        }
+
+        sl_result setSectorListener(ISectorListener* listener, float sectorDegrees = 30.f, ILidarExecutor* executor = NULL)
+        {
+            if (listener && !(sectorDegrees > 0 && sectorDegrees <= 360)) {
+                return SL_RESULT_INVALID_DATA;
+            }
+
+            _sectorListenerDispatcher.setTarget(listener, executor);
+            _sectorAssembler.setSectorListener(listener ? &_sectorListenerDispatcher : nullptr, sectorDegrees);
+            return SL_RESULT_OK;
+        }
+
+        sl_result setScanBinning(float binDegrees, LidarScanBinPolicy policy = LIDAR_SCAN_BIN_NEAREST_ANGLE, bool binsOnly = false)
+        {
+            if (binDegrees == 0) {
+                _scanHolder.setBinning(0, policy, false);
+                return SL_RESULT_OK;
+            }
+
+            if (!(binDegrees > 0 && binDegrees <= 360)
+                || policy < LIDAR_SCAN_BIN_NEAREST_ANGLE || policy > LIDAR_SCAN_BIN_MAX_RANGE) {
+                return SL_RESULT_INVALID_DATA;
+            }
+
+            // bins narrower than a q14 angle step would never be filled
+            size_t binCount = (size_t)(360.f / binDegrees + 0.5f);
+            if (binCount > MAX_SCAN_BIN_COUNT) return SL_RESULT_INVALID_DATA;
+
+            _scanHolder.setBinning(binCount ? binCount : 1, policy, binsOnly);
+            return SL_RESULT_OK;
+        }
+
+        sl_result setScanLayout(LidarScanLayout layout)
+        {
+            if (layout < LIDAR_SCAN_LAYOUT_AOS || layout > LIDAR_SCAN_LAYOUT_AOS_SOA) {
+                return SL_RESULT_INVALID_DATA;
+            }
+            _scanHolder.setLayout(layout);
+            return SL_RESULT_OK;
+        }
+
+        sl_result setScanAscending(bool enabled)
+        {
+            _scanHolder.setAscending(enabled);
+            return SL_RESULT_OK;
+        }
+
+        sl_result setScanDeskewPoseProvider(ILidarPoseProvider* provider)
+        {
+            _scanHolder.setDeskewPoseProvider(provider);
+            return SL_RESULT_OK;
+        }
+
+        sl_result setScanDeskewTwist(const LidarTwist2D* twist)
+        {
+            _scanHolder.setDeskewTwist(twist);
+            return SL_RESULT_OK;
+        }
+
+        sl_result setScanFilters(const LidarScanFilter* filters, size_t count)
+        {
+            if (count > LIDAR_SCAN_FILTER_MAX_COUNT || (count && !filters)) return SL_RESULT_INVALID_DATA;
+            for (size_t pos = 0; pos < count; ++pos) {
+                const LidarScanFilter& filter = filters[pos];
+                switch (filter.type) {
+                case LIDAR_SCAN_FILTER_DROP_INVALID:
+                    break;
+                case LIDAR_SCAN_FILTER_RANGE_LIMIT:
+                    if (!(filter.min_range_m <= filter.max_range_m)) return SL_RESULT_INVALID_DATA;
+                    break;
+                case LIDAR_SCAN_FILTER_MEDIAN:
+                    if (filter.window < 3 || filter.window > LIDAR_SCAN_FILTER_MAX_WINDOW || !(filter.window & 1)) return SL_RESULT_INVALID_DATA;
+                    break;
+                case LIDAR_SCAN_FILTER_OUTLIER:
+                    if (!(filter.max_deviation_m > 0)) return SL_RESULT_INVALID_DATA;
+                    break;
+                default:
+                    return SL_RESULT_INVALID_DATA;
+                }
+            }
+            _scanHolder.setFilters(filters, count);
+            return SL_RESULT_OK;
+        }
+
+        sl_result setScanRegion(const LidarScanRegion* region)
+        {
+            if (region && !(region->span_deg > 0)) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_op_locker);
+            _scanRegion.start_deg = region ? region->start_deg : 0;
+            _scanRegion.span_deg = region ? region->span_deg : 360;
+            return SL_RESULT_OK;
+        }
+
+        sl_result setDeferredDecoding(bool enabled)
+        {
+            _isDeferredDecodingEnabled = enabled;
+            return SL_RESULT_OK;
+        }
+
+        sl_result registerSampleHandler(sl_u8 ansType, ILidarSampleHandlerFactory* factory)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            if (_isDataGrabbing) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            internal::IDataUnpackerHandler* handler = NULL;
+            if (factory) {
+                ILidarSampleHandler* custom = factory->createHandler(ansType);
+                if (!custom) return SL_RESULT_OPERATION_FAIL;
+                handler = new internal::unpacker::UnpackerHandler_Custom(ansType, factory, custom);
+            }
+
+            // the handlers are bound at compile time with SL_LIDAR_STATIC_UNPACKER_HANDLER
+            if (!_dataunpacker->setHandler(ansType, handler)) {
+                delete handler;
+                return SL_RESULT_OPERATION_NOT_SUPPORT;
+            }
+            _isCustomSampleType[ansType] = (factory != NULL);
+
+            // the new handler starts with the context of the last scan mode
+            _dataunpacker->updateUnpackerContext(internal::LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_LIDAR_TIMING, &_timing_desc, sizeof(_timing_desc));
+            _dataunpacker->updateUnpackerContext(internal::LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_SCAN_REGION, &_scanRegion, sizeof(_scanRegion));
+            return SL_RESULT_OK;
+        }
+
+        sl_result setCustomSampleListener(ICustomSampleListener* listener)
+        {
+            _customSampleListener = listener;
+            return SL_RESULT_OK;
+        }
+
+        sl_result setScanCapacity(size_t maxNodes)
+        {
+            if (maxNodes > MAX_SCAN_CAPACITY) return SL_RESULT_INVALID_DATA;
+            _userScanCapacity = maxNodes;
+            return SL_RESULT_OK;
+        }
+
+        sl_result setSamplePaths(sl_u32 paths)
+        {
+            if (paths & ~(sl_u32)LIDAR_SAMPLE_PATH_ALL) return SL_RESULT_INVALID_DATA;
+            _samplePathsEnabled = paths;
+            return SL_RESULT_OK;
+        }
+
+        sl_result setBackpressurePolicy(sl_u32 paths, LidarBackpressurePolicy policy, sl_u32 maxBlockMs = 1000)
+        {
+            if (paths & ~(sl_u32)LIDAR_SAMPLE_PATH_ALL) return SL_RESULT_INVALID_DATA;
+            if (paths & LIDAR_SAMPLE_PATH_SECTORS) return SL_RESULT_OPERATION_NOT_SUPPORT;
+            if (policy != LIDAR_BACKPRESSURE_DROP_OLDEST && policy != LIDAR_BACKPRESSURE_DROP_NEWEST && policy != LIDAR_BACKPRESSURE_BLOCK) {
+                return SL_RESULT_INVALID_DATA;
+            }
+
+            rp::hal::AutoLocker l(_op_locker);
+            if (paths & LIDAR_SAMPLE_PATH_SCANS) _scanHolder.setBackpressurePolicy(policy, maxBlockMs);
+            if (paths & LIDAR_SAMPLE_PATH_INTERVAL) _rawSampleNodeHolder.setBackpressurePolicy(policy, maxBlockMs);
+
+            // the rx thread holds the data back as long as a path blocks the decoder
+            bool isBlocking = _scanHolder.getBackpressurePolicy() == LIDAR_BACKPRESSURE_BLOCK
+                || _rawSampleNodeHolder.getBackpressurePolicy() == LIDAR_BACKPRESSURE_BLOCK;
+            if (policy == LIDAR_BACKPRESSURE_BLOCK) _rxMaxBlockMs = maxBlockMs;
+            _transeiver->setRxBlocking(isBlocking ? std::max<sl_u32>(_rxMaxBlockMs, 1) : 0);
+            return SL_RESULT_OK;
+        }
+
+        sl_result getBackpressureStats(LidarBackpressureStats& stats)
+        {
+            _u64 scanBlocked_uS, scanTimeouts, sampleBlocked_uS, sampleTimeouts;
+            _scanHolder.getBackpressureStats(stats.scans_dropped, scanBlocked_uS, scanTimeouts);
+            _rawSampleNodeHolder.getBlockStats(sampleBlocked_uS, sampleTimeouts);
+            stats.samples_dropped = _rawSampleNodeHolder.getDroppedCount();
+            stats.rx_dropped_bytes = _transeiver->getRxOverflowBytes();
+            stats.blocked_uS = scanBlocked_uS + sampleBlocked_uS + _transeiver->getRxBlockedTime_uS();
+            stats.block_timeouts = scanTimeouts + sampleTimeouts + _transeiver->getRxBlockTimeouts();
+            return SL_RESULT_OK;
+        }
+
+        sl_result setRealtimeOptions(const LidarRealtimeOptions& options)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            if (options.lock_memory && !_realtimeOptions.lock_memory) {
+                u_result ans = rp::hal::lockProcessMemory();
+                if (IS_FAIL(ans)) return (sl_result)ans;
+            }
+            _realtimeOptions = options;
+            _transeiver->setThreadStackPrefault(options.thread_stack_prefault);
+            return SL_RESULT_OK;
+        }
+
+        sl_u64 getScanOverflowCount()
+        {
+            return _scanHolder.getOverflowCount();
+        }
+
+        sl_result grabScanDataSoA(float* angle_rad, float* range_m, sl_u8* quality, sl_u64* timestamps_uS, size_t& count, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            if (!angle_rad || !range_m)
+                return SL_RESULT_INVALID_DATA;
+
+            if (!_scanHolder.hasSoAOutput() || !_isSamplePathActive(LIDAR_SAMPLE_PATH_SCANS)) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            rp::hal::AutoLocker l(_grab_locker);
+
+            auto availBuffer = _scanHolder.waitAndTakeNewestScan(timeout);
+            if (!availBuffer) return SL_RESULT_OPERATION_TIMEOUT;
+
+            // the scans formed before the layout was changed have no SoA form
+            const LidarScanSoA& soa = availBuffer->view.soa;
+            count = std::min<size_t>(count, soa.count);
+
+            std::copy(soa.angle_rad, soa.angle_rad + count, angle_rad);
+            std::copy(soa.range_m, soa.range_m + count, range_m);
+            if (quality) {
+                std::copy(soa.quality, soa.quality + count, quality);
+            }
+            if (timestamps_uS) {
+                std::copy(soa.timestamps_uS, soa.timestamps_uS + count, timestamps_uS);
+            }
+            return SL_RESULT_OK;
+        }
+
         sl_result getDeviceInfo(sl_lidar_response_device_info_t& info, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            internal::SingleFlightOutcome outcome;
+            sl_result ans = _deviceInfoFlight.call(info, (_u64)_deviceInfoMaxAgeMs.load() * 1000, timeout, outcome,
+                [this, timeout](sl_lidar_response_device_info_t& answer) { return (u_result)_queryDeviceInfo(answer, timeout); });
+            _countQuery(outcome);
+            return ans;
+        }
+
+        sl_result getHealth(sl_lidar_response_device_health_t& health, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            internal::SingleFlightOutcome outcome;
+            sl_result ans = _healthFlight.call(health, (_u64)_healthMaxAgeMs.load() * 1000, timeout, outcome,
+                [this, timeout](sl_lidar_response_device_health_t& answer) { return (u_result)_queryHealth(answer, timeout); });
+            _countQuery(outcome);
+            return ans;
+        }
+
+        sl_result getMotorInfo(LidarMotorInfo& motorInfo, sl_u32 timeoutInMs)
+        {
+            if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            internal::SingleFlightOutcome outcome;
+            sl_result ans = _motorInfoFlight.call(motorInfo, (_u64)_motorInfoMaxAgeMs.load() * 1000, timeoutInMs, outcome,
+                [this, timeoutInMs](LidarMotorInfo& answer) { return (u_result)_queryMotorInfo(answer, timeoutInMs); });
+            _countQuery(outcome);
+            return ans;
+        }
+
+        sl_result setQueryCache(const LidarQueryCacheOptions& options)
+        {
+            _healthMaxAgeMs = options.health_max_age_ms;
+            _deviceInfoMaxAgeMs = options.device_info_max_age_ms;
+            _motorInfoMaxAgeMs = options.motor_info_max_age_ms;
+            return SL_RESULT_OK;
+        }
+
+        sl_result getQueryStats(LidarQueryStats& stats)
+        {
+            stats.commands = _queryCommands.load(std::memory_order_relaxed);
+            stats.coalesced = _queryCoalesced.load(std::memory_order_relaxed);
+            stats.cached = _queryCached.load(std::memory_order_relaxed);
+            return SL_RESULT_OK;
+        }
+
+        void _countQuery(internal::SingleFlightOutcome outcome)
+        {
+            switch (outcome) {
+            case internal::SINGLE_FLIGHT_COALESCED:
+                _queryCoalesced.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case internal::SINGLE_FLIGHT_CACHED:
+                _queryCached.fetch_add(1, std::memory_order_relaxed);
+                break;
+            default:
+                _queryCommands.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // the answers of another device are not reused
+        void _invalidateQueries()
+        {
+            _healthFlight.invalidate();
+            _deviceInfoFlight.invalidate();
+            _motorInfoFlight.invalidate();
+        }
+
+        sl_result _queryDeviceInfo(sl_lidar_response_device_info_t& info, sl_u32 timeout = DEFAULT_TIMEOUT)
         {
             rp::hal::AutoLocker l(_op_locker);
             if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
@@ -827,6 +1899,7 @@ namespace sl {
 #endif
 
             _cached_DevInfo = info;
+            _isDevInfoCached = true;
             return (sl_result)ans;
         }
 
@@ -839,42 +1912,56 @@ namespace sl {
             support = MotorCtrlSupportNone;
             _disableDataGrabbing();
 
-            {
-                sl_lidar_response_device_info_t devInfo;
-                ans = getDeviceInfo(devInfo, 500);
-                if (!ans) return ans;
-                sl_u8 majorId = devInfo.model >> 4;
-                if (majorId >= BUILTIN_MOTORCTL_MINUM_MAJOR_ID) {
-                        support = MotorCtrlSupportRpm;
-                        return ans;
-                }
-                else if(majorId >= A2A3_LIDAR_MINUM_MAJOR_ID){
+            sl_lidar_response_device_info_t devInfo;
+            ans = _queryDeviceInfo(devInfo, 500);
+            if (!ans) return ans;
+            return _checkMotorCtrlSupport(devInfo, support, timeout);
+        }
 
-                    rp::hal::AutoLocker l(_op_locker);
-                    sl_lidar_payload_acc_board_flag_t flag;
-                    flag.reserved = 0;
-                    internal::message_autoptr_t ans_frame;
+        // the motor control of the device just identified, from the cache, the model or the accessory board
+        sl_result _checkMotorCtrlSupport(const sl_lidar_response_device_info_t& devInfo, MotorCtrlSupport& support, sl_u32 timeout)
+        {
+            Result<nullptr_t> ans = SL_RESULT_OK;
+            support = MotorCtrlSupportNone;
 
-                    ans = _sendCommandWithResponse(SL_LIDAR_CMD_GET_ACC_BOARD_FLAG, SL_LIDAR_ANS_TYPE_ACC_BOARD_FLAG, ans_frame, timeout, &flag, sizeof(flag));
-                    if (!ans) return ans;
+            if (_syncCapabilities(devInfo) && (_capabilities.flags & internal::CAPABILITY_CACHE_FLAG_MOTOR_CTRL)) {
+                support = _capabilities.motorCtrlSupport;
+                return ans;
+            }
 
-                    if (ans_frame->getPayloadSize() < sizeof(rplidar_response_acc_board_flag_t))
-                    {
-                        return RESULT_INVALID_DATA;
-                    }
+            sl_u8 majorId = devInfo.model >> 4;
+            if (majorId >= BUILTIN_MOTORCTL_MINUM_MAJOR_ID) {
+                    support = MotorCtrlSupportRpm;
+                    _cacheMotorCtrlSupport(support);
+                    return ans;
+            }
+            else if(majorId >= A2A3_LIDAR_MINUM_MAJOR_ID){
 
-                    const sl_lidar_response_acc_board_flag_t* acc_board_flag
-                        = reinterpret_cast<const sl_lidar_response_acc_board_flag_t*>(ans_frame->getDataBuf());
+                rp::hal::AutoLocker l(_op_locker);
+                sl_lidar_payload_acc_board_flag_t flag;
+                flag.reserved = 0;
+                internal::message_autoptr_t ans_frame;
 
-                    if (acc_board_flag->support_flag & SL_LIDAR_RESP_ACC_BOARD_FLAG_MOTOR_CTRL_SUPPORT_MASK) {
-                        support = MotorCtrlSupportPwm;
-                    }
-                    return ans;
+                ans = _sendCommandWithResponse(SL_LIDAR_CMD_GET_ACC_BOARD_FLAG, SL_LIDAR_ANS_TYPE_ACC_BOARD_FLAG, ans_frame, timeout, &flag, sizeof(flag));
+                if (!ans) return ans;
+
+                if (ans_frame->getPayloadSize() < sizeof(rplidar_response_acc_board_flag_t))
+                {
+                    return RESULT_INVALID_DATA;
                 }
 
+                const sl_lidar_response_acc_board_flag_t* acc_board_flag
+                    = reinterpret_cast<const sl_lidar_response_acc_board_flag_t*>(ans_frame->getDataBuf());
+
+                if (acc_board_flag->support_flag & SL_LIDAR_RESP_ACC_BOARD_FLAG_MOTOR_CTRL_SUPPORT_MASK) {
+                    support = MotorCtrlSupportPwm;
+                }
+                _cacheMotorCtrlSupport(support);
+                return ans;
             }
-            return SL_RESULT_OK;
 
+            _cacheMotorCtrlSupport(support);
+            return SL_RESULT_OK;
         }
 
         sl_result getFrequency(const LidarScanMode& scanMode, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, float& frequency)
@@ -910,7 +1997,7 @@ namespace sl {
             return ans;
         }
        
-        sl_result getHealth(sl_lidar_response_device_health_t& health, sl_u32 timeout = DEFAULT_TIMEOUT)
+        sl_result _queryHealth(sl_lidar_response_device_health_t& health, sl_u32 timeout = DEFAULT_TIMEOUT)
         {
             rp::hal::AutoLocker l(_op_locker);
             if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
@@ -942,27 +2029,271 @@ namespace sl {
 
             u_result ans;
 
-            std::vector<_u8> answer(6, 0);
-            ans = getLidarConf(SL_LIDAR_CONF_LIDAR_MAC_ADDR, answer, NULL, 0, timeoutInMs);
-            if (IS_FAIL(ans))
-            {
-                return ans;
+            std::vector<_u8> answer(6, 0);
+            ans = getLidarConf(SL_LIDAR_CONF_LIDAR_MAC_ADDR, answer, NULL, 0, timeoutInMs);
+            if (IS_FAIL(ans))
+            {
+                return ans;
+            }
+            size_t len = answer.size();
+            if (0 == len) return SL_RESULT_INVALID_DATA;
+            memcpy(macAddrArray, &answer[0], len);
+            return ans;
+		}
+
+        sl_result ascendScanData(sl_lidar_response_measurement_node_hq_t * nodebuffer, size_t count)
+        {
+            return ascendScanData_<sl_lidar_response_measurement_node_hq_t>(nodebuffer, count);
+        }
+
+        sl_result getScanDataWithIntervalHq(sl_lidar_response_measurement_node_hq_t * nodebuffer, size_t & count)
+        {
+            if (!_isSamplePathActive(LIDAR_SAMPLE_PATH_INTERVAL)) {
+                count = 0;
+                return SL_RESULT_OPERATION_NOT_SUPPORT;
+            }
+            count = _rawSampleNodeHolder.waitAndFetch(nodebuffer, count, 0);
+            return SL_RESULT_OK;
+        }
+
+        sl_result getScanDataWithIntervalHqAndTimeStamps(sl_lidar_response_measurement_node_hq_t * nodebuffer, sl_u64* timestamps_uS, size_t & count)
+        {
+            if (!nodebuffer || !timestamps_uS)
+                return SL_RESULT_INVALID_DATA;
+            if (!_isSamplePathActive(LIDAR_SAMPLE_PATH_INTERVAL)) {
+                count = 0;
+                return SL_RESULT_OPERATION_NOT_SUPPORT;
+            }
+
+            count = _rawSampleNodeHolder.waitAndFetch(nodebuffer, timestamps_uS, count, 0);
+            return SL_RESULT_OK;
+        }
+
+        sl_u64 getScanDataWithIntervalDroppedCount()
+        {
+            return _rawSampleNodeHolder.getDroppedCount();
+        }
+
+        sl_result openSampleCursor(LidarSampleCursor& cursor)
+        {
+            if (!_isSamplePathActive(LIDAR_SAMPLE_PATH_INTERVAL)) return SL_RESULT_OPERATION_NOT_SUPPORT;
+            _rawSampleNodeHolder.openCursor(cursor);
+            return SL_RESULT_OK;
+        }
+
+        sl_result readSamples(LidarSampleCursor& cursor, LidarSampleSpan& span)
+        {
+            if (!_isSamplePathActive(LIDAR_SAMPLE_PATH_INTERVAL)) {
+                memset(&span, 0, sizeof(span));
+                return SL_RESULT_OPERATION_NOT_SUPPORT;
+            }
+            return _rawSampleNodeHolder.readCursor(cursor, span) ? SL_RESULT_OK : SL_RESULT_OPERATION_TIMEOUT;
+        }
+
+        bool isSampleSpanValid(const LidarSampleSpan& span)
+        {
+            return _rawSampleNodeHolder.isSpanIntact(span);
+        }
+
+        sl_result getDecodeStats(LidarDecodeStats& stats)
+        {
+            memset(&stats, 0, sizeof(stats));
+            _protocolHandler->getDecodeStats(stats);
+            stats.sample_type_count = _dataunpacker->getDecodeStats(stats.samples, _countof(stats.samples));
+            return SL_RESULT_OK;
+        }
+
+        sl_result getRxQueueStats(LidarRxQueueStats& stats)
+        {
+            memset(&stats, 0, sizeof(stats));
+            stats.capacity = _transeiver->getRxQueueCapacity();
+            stats.pending_bytes = _transeiver->getRxQueuePendingSize();
+            stats.high_water_bytes = _transeiver->getRxQueueHighWaterMark();
+            stats.overflow_count = _transeiver->getRxOverflowCount();
+            stats.overflow_bytes = _transeiver->getRxOverflowBytes();
+            return SL_RESULT_OK;
+        }
+
+        sl_result setNativeTimestampsEnabled(bool enable)
+        {
+            _isNativeTimestampEnabled = enable;
+            return SL_RESULT_OK;
+        }
+
+        sl_result getDeviceClockStats(LidarDeviceClockStats& stats)
+        {
+            memset(&stats, 0, sizeof(stats));
+            if (!_dataunpacker->getDeviceClockStats(stats)) return SL_RESULT_OPERATION_NOT_SUPPORT;
+            return SL_RESULT_OK;
+        }
+
+        sl_result calibrateLinkageDelay(sl_u32& delay_uS, int rounds = DEFAULT_LINKAGE_CALIBRATION_ROUNDS, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            if (rounds <= 0) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_op_locker);
+            if (!isConnected() || _isDataGrabbing) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            sl_lidar_response_device_info_t devInfo;
+            sl_result ans = _queryDeviceInfo(devInfo, timeout);
+            if (IS_FAIL(ans)) return ans;
+            _updateInterfaceDesc(devInfo);
+
+            // the fastest round trip is the one least delayed by the scheduling of the host
+            _u64 minRoundTrip_uS = (_u64)-1;
+            for (int round = 0; round < rounds; ++round) {
+                sl_lidar_response_device_health_t health;
+                _u64 sentTs = getus();
+                ans = _queryHealth(health, timeout);
+                if (IS_FAIL(ans)) return ans;
+                minRoundTrip_uS = std::min<_u64>(minRoundTrip_uS, getus() - sentTs);
+            }
+
+            // the sync byte and the command, then the answer header and the health
+            _u64 wireTime_uS = 0;
+            if (_timing_desc.native_interface_type != LIDARInterfaceType::LIDAR_INTERFACE_ETHERNET) {
+                const _u64 channelBaudRate = _timing_desc.native_baudrate ? _timing_desc.native_baudrate : 115200;
+                const _u64 wireBytes = 2 + sizeof(sl_lidar_ans_header_t) + sizeof(sl_lidar_response_device_health_t);
+                wireTime_uS = 1000000ULL * wireBytes * 10 / channelBaudRate;
+            }
+
+            delay_uS = (minRoundTrip_uS > wireTime_uS) ? (sl_u32)((minRoundTrip_uS - wireTime_uS) / 2) : 0;
+            _linkageDelay_uS = delay_uS;
+            return SL_RESULT_OK;
+        }
+
+        sl_result setClock(ILidarClock* clock)
+        {
+            _transeiver->setClock(clock);
+            _pacedScanDispatcher.setClock(clock);
+            return SL_RESULT_OK;
+        }
+
+        sl_result setLinkageDelay(sl_u32 delay_uS)
+        {
+            _linkageDelay_uS = delay_uS;
+            return SL_RESULT_OK;
+        }
+
+        sl_result getLinkageDelay(sl_u32& delay_uS)
+        {
+            delay_uS = _linkageDelay_uS;
+            return SL_RESULT_OK;
+        }
+
+        sl_result getScanRateStats(LidarScanRateStats& stats)
+        {
+            _scanHolder.getRateStats(stats);
+            return SL_RESULT_OK;
+        }
+
+        sl_result getLatencyStats(LidarLatencyStage stage, LidarLatencyStats& stats)
+        {
+#ifdef SL_LIDAR_LATENCY_PROFILING
+            if ((unsigned)stage >= LIDAR_LATENCY_STAGE_COUNT) return SL_RESULT_INVALID_DATA;
+            _latencyProfile.getStats(stage, stats);
+            return SL_RESULT_OK;
+#else
+            memset(&stats, 0, sizeof(stats));
+            return SL_RESULT_OPERATION_NOT_SUPPORT;
+#endif
+        }
+
+        sl_result resetLatencyStats()
+        {
+#ifdef SL_LIDAR_LATENCY_PROFILING
+            _latencyProfile.reset();
+            return SL_RESULT_OK;
+#else
+            return SL_RESULT_OPERATION_NOT_SUPPORT;
+#endif
+        }
+
+        sl_result startRecording(const char* path)
+        {
+            return _recorder.start(path);
+        }
+
+        sl_result stopRecording(sl_u64* droppedBytes = NULL)
+        {
+            if (!_recorder.isRecording()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+            _recorder.stop();
+            if (droppedBytes) *droppedBytes = _recorder.getDroppedBytes();
+            return SL_RESULT_OK;
+        }
+
+        sl_result setInStreamQueries(bool enable)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            _inStreamQueries = enable;
+            return SL_RESULT_OK;
+        }
+
+        sl_result setCapabilityCache(const char* directory)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            _capabilityCache.setDirectory(directory);
+            _capabilitiesLoaded = false;
+            return SL_RESULT_OK;
+        }
+
+        std::future<LidarCommandAnswer> sendCommandAsync(sl_u8 cmd, sl_u8 ansType, const void* payload = NULL, size_t payloadSize = 0, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            std::shared_ptr<std::promise<LidarCommandAnswer> > promise = std::make_shared<std::promise<LidarCommandAnswer> >();
+            std::future<LidarCommandAnswer> future = promise->get_future();
+            sendCommandAsync(cmd, ansType, payload, payloadSize, timeout, [promise](const LidarCommandAnswer& answer) {
+                promise->set_value(answer);
+            });
+            return future;
+        }
+
+        void sendCommandAsync(sl_u8 cmd, sl_u8 ansType, const void* payload, size_t payloadSize, sl_u32 timeout, const LidarCommandAnswerHandler& answerHandler)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+
+            internal::CommandPipeline::AnswerHandler handler = [answerHandler](u_result result, const internal::ProtocolMessage* msg) {
+                LidarCommandAnswer answer;
+                answer.result = result;
+                if (msg) {
+                    answer.payload.assign(msg->getDataBuf(), msg->getDataBuf() + msg->getPayloadSize());
+                }
+                answerHandler(answer);
+            };
+
+            if (!payload) payloadSize = 0;
+            if (!isConnected()) {
+                handler(SL_RESULT_OPERATION_NOT_SUPPORT, NULL);
+                return;
+            }
+
+            _u32 confType = internal::CommandPipeline::ANY_CONF_TYPE;
+            if ((cmd == SL_LIDAR_CMD_GET_LIDAR_CONF || cmd == SL_LIDAR_CMD_SET_LIDAR_CONF) && payloadSize >= sizeof(confType)) {
+                memcpy(&confType, payload, sizeof(confType));
+                confType = le32_to_cpu(confType);
             }
-            size_t len = answer.size();
-            if (0 == len) return SL_RESULT_INVALID_DATA;
-            memcpy(macAddrArray, &answer[0], len);
-            return ans;
-		}
+            _sendCommandAsync(cmd, ansType, confType, payload, payloadSize, timeout, handler);
+        }
 
-        sl_result ascendScanData(sl_lidar_response_measurement_node_hq_t * nodebuffer, size_t count)
+        std::future<LidarCommandAnswer> getLidarConfAsync(sl_u32 type, const void* payload = NULL, size_t payloadSize = 0, sl_u32 timeout = DEFAULT_TIMEOUT)
         {
-            return ascendScanData_<sl_lidar_response_measurement_node_hq_t>(nodebuffer, count);
+            std::shared_ptr<std::promise<LidarCommandAnswer> > promise = std::make_shared<std::promise<LidarCommandAnswer> >();
+            std::future<LidarCommandAnswer> future = promise->get_future();
+            getLidarConfAsync(type, payload, payloadSize, timeout, [promise](const LidarCommandAnswer& answer) {
+                promise->set_value(answer);
+            });
+            return future;
         }
 
-        sl_result getScanDataWithIntervalHq(sl_lidar_response_measurement_node_hq_t * nodebuffer, size_t & count)
+        void getLidarConfAsync(sl_u32 type, const void* payload, size_t payloadSize, sl_u32 timeout, const LidarCommandAnswerHandler& handler)
         {
-            count = _rawSampleNodeHolder.waitAndFetch(nodebuffer, count, 0);
-            return SL_RESULT_OK;
+            rp::hal::AutoLocker l(_op_locker);
+            if (!isConnected()) {
+                LidarCommandAnswer answer;
+                answer.result = SL_RESULT_OPERATION_NOT_SUPPORT;
+                handler(answer);
+                return;
+            }
+            _getLidarConfAsync(type, payload, payloadSize, timeout, handler);
         }
 
         sl_result setMotorSpeed(sl_u16 speed = DEFAULT_MOTOR_SPEED)
@@ -972,11 +2303,16 @@ namespace sl {
 
 
             Result<nullptr_t> ans = SL_RESULT_OK;
+            _probeMotorCtrlSupport();
+            _requestedMotorSpeed = speed;
             
             if(speed == DEFAULT_MOTOR_SPEED){
-                sl_lidar_response_desired_rot_speed_t desired_speed;
-                ans = getDesiredSpeed(desired_speed);
+                // queried once per connection, the query would stop the scan stream
+                sl_lidar_response_desired_rot_speed_t desired_speed = _desiredSpeed;
+                ans = _isDesiredSpeedCached ? SL_RESULT_OK : (sl_result)getDesiredSpeed(desired_speed);
                 if (ans) {
+                    _desiredSpeed = desired_speed;
+                    _isDesiredSpeedCached = true;
                     if (_isSupportingMotorCtrl == MotorCtrlSupportPwm)
                         speed = desired_speed.pwm_ref;
                     else
@@ -1006,6 +2342,7 @@ namespace sl {
 
                 ans = _sendCommandWithoutResponse(SL_LIDAR_CMD_SET_MOTOR_PWM, &motor_pwm, sizeof(motor_pwm), true);
                 if (!ans) return ans;
+                if (speed) _onRotationSpeedChanged(0);
                 delay(10);
                 break;
             case MotorCtrlSupportRpm:
@@ -1014,18 +2351,32 @@ namespace sl {
 
                 ans = _sendCommandWithoutResponse(SL_LIDAR_CMD_HQ_MOTOR_SPEED_CTRL, &motor_rpm, sizeof(motor_rpm), true);
                 if (!ans) return ans;
+                if (speed) _onRotationSpeedChanged(speed);
                 delay(10);
                 break;
             }
             return SL_RESULT_OK;
         }
 
-        sl_result getMotorInfo(LidarMotorInfo &motorInfo, sl_u32 timeoutInMs)
+        // the motor commands leave the scan stream running, the buffers and the rate estimate follow the new speed;
+        // rpm is 0 when only the pwm duty is known
+        void _onRotationSpeedChanged(sl_u16 rpm)
+        {
+            _commandedRpm = rpm;
+            _updateScanCapacity(_scanSampleDuration);
+            if (_isDataGrabbing) {
+                _scanHolder.setRotationPeriod(rpm ? 60000000.f / rpm : 0);
+            }
+        }
+
+        sl_result _queryMotorInfo(LidarMotorInfo &motorInfo, sl_u32 timeoutInMs)
         {
             Result<nullptr_t> ans = SL_RESULT_OK;
             rp::hal::AutoLocker l(_op_locker);
             if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
 
+            _probeMotorCtrlSupport();
+            motorInfo.motorCtrlSupport = _isSupportingMotorCtrl;
 
             {
                 std::vector<sl_u8> answer;
@@ -1132,7 +2483,7 @@ namespace sl {
 
                     cachedChannel->close();
                     // restart the transiever 
-                    ans = _transeiver->openChannelAndBind(cachedChannel);
+                    ans = _transeiver->openChannelAndBind(cachedChannel, _decodeMode);
                     if (IS_FAIL(ans)) return ans;
 
 
@@ -1149,11 +2500,156 @@ namespace sl {
                 }
             } while (0);
 
-            _transeiver->openChannelAndBind(cachedChannel);
+            _transeiver->openChannelAndBind(cachedChannel, _decodeMode);
 
             return ans;
         }
 
+        sl_result setCachedMaxSerialBaudRate(sl_u32 baudRate)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            if (!_capabilityCache.isEnabled()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            _fetchCachedDevInfo();
+            if (!_isDevInfoCached || !_syncCapabilities(_cached_DevInfo)) return SL_RESULT_OPERATION_FAIL;
+
+            _capabilities.maxSerialBaudRate = baudRate;
+            if (baudRate) {
+                _capabilities.flags |= internal::CAPABILITY_CACHE_FLAG_MAX_BAUDRATE;
+            } else {
+                _capabilities.flags &= ~internal::CAPABILITY_CACHE_FLAG_MAX_BAUDRATE;
+            }
+            return _capabilityCache.store(_capabilitiesDevInfo, _capabilities);
+        }
+
+        sl_result getCachedMaxSerialBaudRate(sl_u32& baudRate)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            if (!_capabilityCache.isEnabled()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            _fetchCachedDevInfo();
+            if (!_isDevInfoCached || !_syncCapabilities(_cached_DevInfo)
+                || !(_capabilities.flags & internal::CAPABILITY_CACHE_FLAG_MAX_BAUDRATE)) {
+                return SL_RESULT_OPERATION_FAIL;
+            }
+            baudRate = _capabilities.maxSerialBaudRate;
+            return SL_RESULT_OK;
+        }
+
+        sl_result autodetectSerialBaudRate(const std::string& device, const sl_u32* candidates, size_t candidateCount, sl_u32& baudRateDetected, sl_u32 timeoutPerStep)
+        {
+            static const sl_u32 DEFAULT_CANDIDATES[] = { 115200, 256000, 460800, 1000000 };
+
+            rp::hal::AutoLocker l(_op_locker);
+            if (isConnected()) return SL_RESULT_ALREADY_DONE;
+
+            if (!candidates || !candidateCount) {
+                candidates = DEFAULT_CANDIDATES;
+                candidateCount = _countof(DEFAULT_CANDIDATES);
+            }
+
+            // the baudrate found last time and the native one of the last known model go first
+            std::vector<sl_u32> order;
+            if (_lastDetectedBaudRate) order.push_back(_lastDetectedBaudRate);
+            if (_isDevInfoCached) {
+                sl_u32 nativeBaudRate = _getNativeBaudRate(_cached_DevInfo);
+                if (nativeBaudRate) order.push_back(nativeBaudRate);
+            }
+            for (size_t pos = 0; pos < order.size(); ) {
+                if (std::find(candidates, candidates + candidateCount, order[pos]) == candidates + candidateCount
+                    || std::find(order.begin(), order.begin() + pos, order[pos]) != order.begin() + pos) {
+                    order.erase(order.begin() + pos);
+                }
+                else {
+                    ++pos;
+                }
+            }
+            for (size_t pos = 0; pos < candidateCount; ++pos) {
+                if (std::find(order.begin(), order.end(), candidates[pos]) == order.end()) order.push_back(candidates[pos]);
+            }
+
+            for (size_t pos = 0; pos < order.size(); ++pos) {
+                Result<IChannel*> channel = createSerialPortChannel(device, (int)order[pos]);
+                if (!channel) return channel.err;
+
+                if (!(*channel)->open()) {
+                    // the port itself cannot be opened, no baudrate will do
+                    delete *channel;
+                    return SL_RESULT_OPERATION_FAIL;
+                }
+
+                // the channel is probed directly, binding the transceiver costs the wakeup and the parking of its threads at each step;
+                // a failed write or no answer at this baudrate moves on to the next one
+                sl_lidar_response_device_info_t devInfo;
+                sl_result ans = _probeSerialDeviceInfo(*channel, devInfo, timeoutPerStep);
+                (*channel)->close();
+                delete *channel;
+
+                if (SL_IS_OK(ans)) {
+                    _cached_DevInfo = devInfo;
+                    _isDevInfoCached = true;
+                    _lastDetectedBaudRate = order[pos];
+                    baudRateDetected = order[pos];
+                    return SL_RESULT_OK;
+                }
+            }
+            return SL_RESULT_OPERATION_TIMEOUT;
+        }
+
+        sl_result setAutoRecovery(bool enable, IRecoveryListener* listener = NULL, sl_u32 maxBackoffMs = 2000)
+        {
+            rp::hal::AutoLocker l(_recovery_locker);
+
+            // restarted to take the new settings, a pending failure is picked up again by the new thread
+            if (_isRecoveryWorking) {
+                _isRecoveryWorking = false;
+                _recoveryEvt.set();
+                _recoveryThread.join();
+            }
+
+            _recoveryListener = listener;
+            _recoveryMaxBackoffMs = std::max<sl_u32>(maxBackoffMs, RECOVERY_MIN_BACKOFF_MS);
+
+            if (enable) {
+                _isRecoveryWorking = true;
+                _recoveryThread = CLASS_THREAD(SlamtecLidarDriver, _proc_recoveryThread);
+            }
+            return SL_RESULT_OK;
+        }
+
+        sl_result getRecoveryStats(LidarRecoveryStats& stats)
+        {
+            stats.recoveries = _recoveryCount.load(std::memory_order_relaxed);
+            stats.failures = _recoveryFailureCount.load(std::memory_order_relaxed);
+            stats.attempts = _recoveryAttemptCount.load(std::memory_order_relaxed);
+            stats.downtime_uS = _recoveryDowntime_uS.load(std::memory_order_relaxed);
+            stats.stalls = _stallCount.load(std::memory_order_relaxed);
+            return SL_RESULT_OK;
+        }
+
+        sl_result setStallWatchdog(bool enable, IStallListener* listener = NULL, sl_u32 minSilenceMs = 10, bool recover = false)
+        {
+            rp::hal::AutoLocker l(_stall_locker);
+
+            // restarted to take the new settings
+            if (_isStallWatchWorking) {
+                _isStallWatchWorking = false;
+                _stallEvt.set();
+                _stallThread.join();
+            }
+
+            _stallListener = listener;
+            _stallMinSilenceMs = minSilenceMs;
+            _isStallRecovering = recover;
+            _stalledSince_uS = 0;
+
+            if (enable) {
+                _isStallWatchWorking = true;
+                _stallThread = CLASS_THREAD(SlamtecLidarDriver, _proc_stallWatchThread);
+            }
+            return SL_RESULT_OK;
+        }
+
     protected:
         sl_result startMotor()
         {
@@ -1177,22 +2673,23 @@ namespace sl {
         {
             u_result ans;
             rplidar_response_device_info_t devinfo;
-            ans = getDeviceInfo(devinfo, timeoutInMs);
+            ans = _queryDeviceInfo(devinfo, timeoutInMs);
             if (IS_FAIL(ans)) {
                 outSupport = false;
                 return ans;
             }
 
+            outSupport = _isConfCommandSupported(devinfo);
+            return RESULT_OK;
+        }
 
+        bool _isConfCommandSupported(const rplidar_response_device_info_t& devinfo)
+        {
             if (_checkNDMagicNumber(devinfo.model)) {
-
-                outSupport = true;
-            }
-            else {
-                // if lidar firmware >= 1.24
-                outSupport = (devinfo.firmware_version >= ((0x1 << 8) | 24));
+                return true;
             }
-            return RESULT_OK;
+            // if lidar firmware >= 1.24
+            return devinfo.firmware_version >= ((0x1 << 8) | 24);
         }
 
 
@@ -1232,150 +2729,588 @@ namespace sl {
             internal::message_autoptr_t ans_frame;
             ans = _sendCommandWithResponse(SL_LIDAR_CMD_SET_LIDAR_CONF, SL_LIDAR_ANS_TYPE_SET_LIDAR_CONF, ans_frame, timeout, &requestPkt[0], requestPkt.size());
 
-            if (IS_FAIL(ans)) {
-                return ans;
+            if (IS_FAIL(ans)) {
+                return ans;
+            }
+
+            //check if returned size is even less than sizeof(type) 
+            if (ans_frame->getPayloadSize() < sizeof(rplidar_response_set_lidar_conf_t)) {
+                return RESULT_INVALID_DATA;
+            }
+
+            const rplidar_response_set_lidar_conf_t* response =
+                reinterpret_cast<const rplidar_response_set_lidar_conf_t*>(ans_frame->getDataBuf());
+
+
+            if (ans_frame->getPayloadSize() == 4) {
+                // legacy device?
+                return *(const u_result*)(ans_frame->getDataBuf());
+            }
+            else {
+                if (response->type != type) {
+                    return RESULT_INVALID_DATA;
+                }
+
+                return (u_result)response->result;
+            }
+		}
+
+        u_result getLidarConf(_u32 type, std::vector<_u8>& outputBuf, const void* payload = NULL, size_t payloadSize = 0, _u32 timeout = DEFAULT_TIMEOUT)
+        {
+            LidarCommandAnswer answer = _getLidarConfAsync(type, payload, payloadSize, timeout).get();
+            if (IS_FAIL(answer.result)) {
+                return answer.result;
+            }
+            outputBuf.swap(answer.payload);
+            return RESULT_OK;
+        }
+
+        // loads the cached capabilities of the device just answered by getDeviceInfo, false without a cache
+        bool _syncCapabilities(const sl_lidar_response_device_info_t& devInfo)
+        {
+            if (!_capabilityCache.isEnabled()) return false;
+
+            if (!_capabilitiesLoaded || memcmp(&devInfo, &_capabilitiesDevInfo, sizeof(devInfo))) {
+                _capabilities = internal::DeviceCapabilities();
+                _capabilityCache.load(devInfo, _capabilities);
+                _capabilitiesDevInfo = devInfo;
+                _capabilitiesLoaded = true;
+            }
+            return true;
+        }
+
+        void _storeCapabilities()
+        {
+            _capabilityCache.store(_capabilitiesDevInfo, _capabilities);
+        }
+
+        u_result _proc_recoveryThread()
+        {
+            rp::hal::Thread::config_t config;
+            memset(&config, 0, sizeof(config));
+            rp::hal::Thread::SetSelfConfig(config, "sl_recovery", rp::hal::Thread::PRIORITY_NORMAL);
+
+            while (_isRecoveryWorking) {
+                if (_isRecoveryPending) {
+                    _recover();
+                    continue;
+                }
+                // woken up by _requestRecovery, or by setAutoRecovery to stop
+                _recoveryEvt.wait();
+            }
+            return RESULT_OK;
+        }
+
+        // sleeps until the next sample packet is overdue, the decoder only stores the arrival of the packets
+        u_result _proc_stallWatchThread()
+        {
+            while (_isStallWatchWorking) {
+                sl_u32 packet_uS = _stallPacket_uS.load(std::memory_order_acquire);
+                _u64 lastPacket_uS = _lastPacketArrival_uS.load(std::memory_order_acquire);
+                if (!packet_uS) {
+                    // stopped by a command, woken up when the stream is started
+                    _stalledSince_uS = 0;
+                    _stallEvt.wait();
+                    continue;
+                }
+                if (!lastPacket_uS) {
+                    // waiting for the first sample of the stream
+                    _stalledSince_uS = 0;
+                    _stallEvt.wait(STALL_IDLE_POLL_MS);
+                    continue;
+                }
+
+                _u64 stalledSince_uS = _stalledSince_uS.load();
+                if (stalledSince_uS) {
+                    // the decoder wakes the watchdog up on the first sample after the stall
+                    if (lastPacket_uS > stalledSince_uS) {
+                        _stalledSince_uS = 0;
+                        if (_stallListener) _stallListener->onStreamResumed(lastPacket_uS - stalledSince_uS);
+                        continue;
+                    }
+                    _stallEvt.wait(STALL_IDLE_POLL_MS);
+                    continue;
+                }
+
+                _u64 threshold_uS = std::max<_u64>((_u64)_stallMinSilenceMs * 1000,
+                    (_u64)packet_uS * STALL_PACKET_TOLERANCE + (_u64)_rxCoalescingWaitMs.load() * 1000);
+                _u64 now_uS = getus();
+                _u64 silence_uS = now_uS > lastPacket_uS ? now_uS - lastPacket_uS : 0;
+                if (silence_uS < threshold_uS) {
+                    _stallEvt.wait((sl_u32)((threshold_uS - silence_uS + 999) / 1000));
+                    continue;
+                }
+
+                SL_TRACE_INSTANT(rp::hal::TRACE_CATEGORY_CMD, "stream_stalled", (sl_u32)(silence_uS / 1000));
+                _stalledSince_uS = lastPacket_uS;
+                _stallCount.fetch_add(1, std::memory_order_relaxed);
+                LidarStallEvent event;
+                event.last_packet_uS = lastPacket_uS;
+                event.silence_uS = silence_uS;
+                event.threshold_uS = threshold_uS;
+                event.recovery_started = _isStallRecovering && _requestRecovery(SL_RESULT_OPERATION_TIMEOUT, lastPacket_uS);
+                if (_stallListener) _stallListener->onStreamStalled(event);
+            }
+            return RESULT_OK;
+        }
+
+        // the period of the sample packets of the mode, for the stall watchdog
+        static sl_u32 _samplePacketDuration_uS(const LidarScanMode& mode)
+        {
+            size_t samplesPerPacket = 1;
+            switch (mode.ans_type) {
+            case SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED:
+                samplesPerPacket = 32;
+                break;
+            case SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED:
+                samplesPerPacket = 40;
+                break;
+            case SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED:
+                samplesPerPacket = 64;
+                break;
+            case SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ:
+            case SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA:
+                samplesPerPacket = 96;
+                break;
+            }
+            float duration_uS = mode.us_per_sample * samplesPerPacket;
+            return duration_uS >= 1 ? (sl_u32)duration_uS : 1;
+        }
+
+        void _recover()
+        {
+            LidarRecoveryEvent event;
+            event.error = _recoveryError;
+            event.result = SL_RESULT_OPERATION_STOP;
+            event.attempts = 0;
+            event.scan_resumed = false;
+
+            IChannel* channel = NULL;
+            sl_u32 backoff = RECOVERY_MIN_BACKOFF_MS;
+            while (_isRecoveryWorking) {
+                {
+                    rp::hal::AutoLocker l(_op_locker);
+                    if (!_isConnected || !_isRecoveryPending) {
+                        // disconnected or reconnected by the application, which may be what failed the channel
+                        _isRecoveryPending = false;
+                        if (!event.attempts) return;
+                        event.result = SL_RESULT_OPERATION_STOP;
+                        break;
+                    }
+
+                    if (!channel) channel = _transeiver->getBindedChannel();
+                    ++event.attempts;
+                    _recoveryAttemptCount.fetch_add(1, std::memory_order_relaxed);
+                    event.result = _reopenAndResume(channel, event.scan_resumed);
+                    if (SL_IS_OK(event.result)) {
+                        _isRecoveryPending = false;
+                        break;
+                    }
+                }
+
+                _recoveryEvt.wait(backoff);
+                backoff = std::min(backoff * 2, _recoveryMaxBackoffMs);
+            }
+
+            if (!_isRecoveryWorking && SL_IS_FAIL(event.result)) event.result = SL_RESULT_OPERATION_STOP;
+            event.downtime_uS = getus() - _recoveryFailedSince_uS;
+            _recoveryDowntime_uS.fetch_add(event.downtime_uS, std::memory_order_relaxed);
+            (SL_IS_OK(event.result) ? _recoveryCount : _recoveryFailureCount).fetch_add(1, std::memory_order_relaxed);
+            if (_recoveryListener) _recoveryListener->onRecovery(event);
+        }
+
+        // called with _op_locker held, the scan is restarted the way it was last started
+        sl_result _reopenAndResume(IChannel* channel, bool& scanResumed)
+        {
+            if (!channel) return SL_RESULT_OPERATION_FAIL;
+
+            _disableDataGrabbing();
+            _transeiver->unbindAndClose();
+            sl_result ans = _transeiver->openChannelAndBind(channel, _decodeMode);
+            if (SL_IS_FAIL(ans)) return ans;
+            _invalidateQueries();
+
+            // the device may still be streaming the scan data
+            _sendCommandWithoutResponse(SL_LIDAR_CMD_STOP);
+            delay(20);
+
+            sl_lidar_response_device_info_t devInfo;
+            ans = _queryDeviceInfo(devInfo, 500);
+            if (SL_IS_FAIL(ans)) return ans;
+
+            if (!_resumeScan.isActive) return SL_RESULT_OK;
+
+            ResumeScanState resumeScan = _resumeScan;
+            sl_u16 motorSpeed = _requestedMotorSpeed;
+            if (resumeScan.isExpress) {
+                ans = startScanExpress(resumeScan.force, resumeScan.scanMode, resumeScan.options);
+            }
+            else {
+                ans = startScanNormal(resumeScan.force);
+            }
+            if (SL_IS_FAIL(ans)) {
+                _resumeScan = resumeScan;
+                return ans;
+            }
+
+            if (motorSpeed != DEFAULT_MOTOR_SPEED) {
+                setMotorSpeed(motorSpeed);
+            }
+            scanResumed = true;
+            return SL_RESULT_OK;
+        }
+
+        // stops a scan that may be running, then looks for the device info answer in what comes back
+        sl_result _probeSerialDeviceInfo(IChannel* channel, sl_lidar_response_device_info_t& devInfo, sl_u32 timeout)
+        {
+            static const sl_u8 ANS_HEADER[] = { SL_LIDAR_ANS_SYNC_BYTE1, SL_LIDAR_ANS_SYNC_BYTE2, sizeof(sl_lidar_response_device_info_t), 0, 0, 0, SL_LIDAR_ANS_TYPE_DEVINFO };
+            const sl_u8 stopCmd[] = { SL_LIDAR_CMD_SYNC_BYTE, SL_LIDAR_CMD_STOP };
+            const sl_u8 devInfoCmd[] = { SL_LIDAR_CMD_SYNC_BYTE, SL_LIDAR_CMD_GET_DEVICE_INFO };
+
+            if (channel->write(stopCmd, sizeof(stopCmd)) < 0) return SL_RESULT_OPERATION_FAIL;
+            delay(2);
+            channel->flush();
+            if (channel->write(devInfoCmd, sizeof(devInfoCmd)) < 0) return SL_RESULT_OPERATION_FAIL;
+
+            std::vector<sl_u8> received;
+            sl_u64 startTS = getms();
+            while (getms() - startTS < timeout) {
+                size_t dataCountGot = 0;
+                channel->waitForData(1, (sl_u32)(timeout - (getms() - startTS)), &dataCountGot);
+                if (!dataCountGot) continue;
+
+                size_t oldSize = received.size();
+                received.resize(oldSize + dataCountGot);
+                int got = channel->read(&received[oldSize], dataCountGot);
+                received.resize(oldSize + (got > 0 ? got : 0));
+
+                std::vector<sl_u8>::iterator header = std::search(received.begin(), received.end(), ANS_HEADER, ANS_HEADER + sizeof(ANS_HEADER));
+                if (header != received.end() && (size_t)(received.end() - header) >= sizeof(ANS_HEADER) + sizeof(devInfo)) {
+                    memcpy(&devInfo, &*(header + sizeof(ANS_HEADER)), sizeof(devInfo));
+#ifdef _CPU_ENDIAN_BIG
+                    devInfo.firmware_version = le16_to_cpu(devInfo.firmware_version);
+#endif
+                    return SL_RESULT_OK;
+                }
+            }
+            return SL_RESULT_OPERATION_TIMEOUT;
+        }
+
+        // probes the motor control of the device the first time it is needed after connect, a failed probe is retried later
+        void _probeMotorCtrlSupport()
+        {
+            if (_isMotorCtrlProbed) return;
+
+            MotorCtrlSupport support;
+            if (SL_IS_OK(checkMotorCtrlSupport(support, 500))) {
+                _isSupportingMotorCtrl = support;
+                _isMotorCtrlProbed = true;
+            }
+        }
+
+        void _fetchCachedDevInfo()
+        {
+            if (_isDevInfoCached || !isConnected()) return;
+
+            sl_lidar_response_device_info_t devInfo;
+            _queryDeviceInfo(devInfo, 500);
+        }
+
+        void _cacheMotorCtrlSupport(MotorCtrlSupport support)
+        {
+            if (!_capabilitiesLoaded || !_capabilityCache.isEnabled()) return;
+            _capabilities.motorCtrlSupport = support;
+            _capabilities.flags |= internal::CAPABILITY_CACHE_FLAG_MOTOR_CTRL;
+            _storeCapabilities();
+        }
+
+        // sends the configuration query, the future holds the value of the entry once answered and checked
+        std::future<LidarCommandAnswer> _getLidarConfAsync(_u32 type, const void* payload, size_t payloadSize, _u32 timeout)
+        {
+            std::shared_ptr<std::promise<LidarCommandAnswer> > promise = std::make_shared<std::promise<LidarCommandAnswer> >();
+            std::future<LidarCommandAnswer> future = promise->get_future();
+            _getLidarConfAsync(type, payload, payloadSize, timeout, [promise](const LidarCommandAnswer& answer) {
+                promise->set_value(answer);
+            });
+            return future;
+        }
+
+        void _getLidarConfAsync(_u32 type, const void* payload, size_t payloadSize, _u32 timeout, const LidarCommandAnswerHandler& answerHandler)
+        {
+            std::vector<_u8> requestPkt;
+
+            if (!payload) payloadSize = 0;
+            requestPkt.resize(sizeof(rplidar_payload_get_scan_conf_t) + payloadSize);
+            rplidar_payload_get_scan_conf_t* query = reinterpret_cast<rplidar_payload_get_scan_conf_t*>(&requestPkt[0]);
+
+            query->type = type;
+
+            if (payloadSize)
+                memcpy(&query[1], payload, payloadSize);
+
+            _sendCommandAsync(SL_LIDAR_CMD_GET_LIDAR_CONF, SL_LIDAR_ANS_TYPE_GET_LIDAR_CONF, type, &requestPkt[0], requestPkt.size(), timeout,
+                [answerHandler, type](u_result result, const internal::ProtocolMessage* msg) {
+                    LidarCommandAnswer answer;
+                    answer.result = result;
+                    if (msg) {
+                        const rplidar_response_get_lidar_conf_t* replied =
+                            reinterpret_cast<const rplidar_response_get_lidar_conf_t*>(msg->getDataBuf());
+
+                        //check if returned size is even less than sizeof(type), and if returned type is same as asked type
+                        if (msg->getPayloadSize() < offsetof(rplidar_response_get_lidar_conf_t, payload)
+                            || replied->type != type) {
+                            answer.result = SL_RESULT_INVALID_DATA;
+                        }
+                        else {
+                            answer.payload.assign(msg->getDataBuf() + offsetof(rplidar_response_get_lidar_conf_t, payload), msg->getDataBuf() + msg->getPayloadSize());
+                        }
+                    }
+                    answerHandler(answer);
+                });
+        }
+
+        // the fields of a scan mode, queried together
+        u_result _getScanModeInfo(LidarScanMode& scanMode, sl_u16 scanModeID, sl_u32 timeoutInMs)
+        {
+            scanMode.id = scanModeID;
+
+            if (_syncCapabilities(_cached_DevInfo) && (_capabilities.flags & internal::CAPABILITY_CACHE_FLAG_SCAN_MODES)) {
+                for (size_t pos = 0; pos < _capabilities.scanModes.size(); ++pos) {
+                    if (_capabilities.scanModes[pos].id == scanModeID) {
+                        scanMode = _capabilities.scanModes[pos];
+                        return RESULT_OK;
+                    }
+                }
+            }
+
+            std::future<LidarCommandAnswer> sampleDuration = _getLidarConfAsync(SL_LIDAR_CONF_SCAN_MODE_US_PER_SAMPLE, &scanModeID, sizeof(_u16), timeoutInMs);
+            std::future<LidarCommandAnswer> maxDistance = _getLidarConfAsync(SL_LIDAR_CONF_SCAN_MODE_MAX_DISTANCE, &scanModeID, sizeof(_u16), timeoutInMs);
+            std::future<LidarCommandAnswer> ansType = _getLidarConfAsync(SL_LIDAR_CONF_SCAN_MODE_ANS_TYPE, &scanModeID, sizeof(_u16), timeoutInMs);
+            std::future<LidarCommandAnswer> name = _getLidarConfAsync(SL_LIDAR_CONF_SCAN_MODE_NAME, &scanModeID, sizeof(_u16), timeoutInMs);
+
+            // all the futures are waited for, none of the answers may outlive this call
+            u_result ans = _parseSampleDuration(sampleDuration.get(), scanMode.us_per_sample);
+            u_result ansDist = _parseMaxDistance(maxDistance.get(), scanMode.max_distance);
+            u_result ansType_ = _parseScanModeAnsType(ansType.get(), scanMode.ans_type);
+            u_result ansName = _parseScanModeName(name.get(), scanMode.scan_mode, sizeof(scanMode.scan_mode));
+
+            if (IS_FAIL(ans)) return ans;
+            if (IS_FAIL(ansDist)) return ansDist;
+            if (IS_FAIL(ansType_)) return ansType_;
+            if (IS_OK(ansName)) _rememberScanMode(scanMode);
+            return ansName;
+        }
+
+        // the timing, the capacity and the holders follow the mode, then the scan command is sent;
+        // the motor is started first unless it is spinning already
+        sl_result _startScanStream(bool force, const LidarScanMode& mode, sl_u32 options, bool ifSupportLidarConf, bool isMotorStarted)
+        {
+            _updateTimingDesc(_cached_DevInfo, mode.us_per_sample);
+            _updateScanRegion();
+            _updateDeferredDecoding(mode.ans_type);
+            _samplePaths = _samplePathsEnabled.load();
+            _updateScanCapacity(mode.us_per_sample);
+            _scanHolder.setSampleDuration(mode.us_per_sample);
+            if (!isMotorStarted) startMotor();
+
+            _scanHolder.reset();
+            _sectorAssembler.reset();
+            if (_realtimeOptions.prefault_buffers) {
+                if (_samplePaths & LIDAR_SAMPLE_PATH_SCANS) _scanHolder.prefault();
+                if (_samplePaths & LIDAR_SAMPLE_PATH_SECTORS) _sectorAssembler.prefault();
+            }
+            // the stall watchdog waits for the first sample, past the spin up of the motor
+            _lastPacketArrival_uS = 0;
+            _stallPacket_uS = _samplePacketDuration_uS(mode);
+            _stallEvt.set();
+            _dataunpacker->enable();
+            _isDataGrabbing = true;
+
+            bool isExpress = (mode.ans_type != SL_LIDAR_ANS_TYPE_MEASUREMENT);
+            Result<nullptr_t> ans = SL_RESULT_OK;
+            if (!isExpress) {
+                ans = _sendCommandWithoutResponse(force ? SL_LIDAR_CMD_FORCE_SCAN : SL_LIDAR_CMD_SCAN, nullptr, 0, true);
+            }
+            else {
+                sl_lidar_payload_express_scan_t scanReq;
+                memset(&scanReq, 0, sizeof(scanReq));
+
+                if (!ifSupportLidarConf) {
+                    if (mode.id != SL_LIDAR_CONF_SCAN_COMMAND_STD && mode.id != SL_LIDAR_CONF_SCAN_COMMAND_EXPRESS)
+                        scanReq.working_mode = sl_u8(mode.id);
+                }
+                else
+                    scanReq.working_mode = sl_u8(mode.id);
+
+                scanReq.working_flags = options;
+
+                ans = _sendCommandWithoutResponse(SL_LIDAR_CMD_EXPRESS_SCAN, &scanReq, sizeof(scanReq), true);
             }
 
-            //check if returned size is even less than sizeof(type) 
-            if (ans_frame->getPayloadSize() < sizeof(rplidar_response_set_lidar_conf_t)) {
-                return RESULT_INVALID_DATA;
+            if (ans) {
+                _resumeScan.isActive = true;
+                _resumeScan.isExpress = isExpress;
+                _resumeScan.force = force;
+                if (isExpress) {
+                    _resumeScan.scanMode = mode.id;
+                    _resumeScan.options = options;
+                }
             }
+            return ans;
+        }
 
-            const rplidar_response_set_lidar_conf_t* response =
-                reinterpret_cast<const rplidar_response_set_lidar_conf_t*>(ans_frame->getDataBuf());
+        // the parameters of the mode, from the configuration queries or the legacy sample rate
+        sl_result _resolveScanMode(LidarScanMode& mode, sl_u16 scanMode, bool ifSupportLidarConf, sl_u32 timeout)
+        {
+            mode.id = scanMode;
+            if (ifSupportLidarConf) {
+                return _getScanModeInfo(mode, scanMode, timeout);
+            }
 
+            // legacy device support
+            if (scanMode != RPLIDAR_CONF_SCAN_COMMAND_STD) {
+                rplidar_response_sample_rate_t sampleRateTmp;
+                u_result ans = _getLegacySampleDuration_uS(sampleRateTmp, timeout);
+                if (IS_FAIL(ans)) return ans;
 
-            if (ans_frame->getPayloadSize() == 4) {
-                // legacy device?
-                return *(const u_result*)(ans_frame->getDataBuf());
+                mode.us_per_sample = sampleRateTmp.express_sample_duration_us;
+                mode.max_distance = 16;
+                mode.ans_type = SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED;
+                strcpy(mode.scan_mode, "Express");
             }
             else {
-                if (response->type != type) {
-                    return RESULT_INVALID_DATA;
-                }
-
-                return (u_result)response->result;
+                mode.ans_type = SL_LIDAR_ANS_TYPE_MEASUREMENT;
             }
-		}
+            return SL_RESULT_OK;
+        }
 
-        u_result getLidarConf(_u32 type, std::vector<_u8>& outputBuf, const void* payload = NULL, size_t payloadSize = 0, _u32 timeout = DEFAULT_TIMEOUT)
+        // once the first sample after the scan command of startScanFast has arrived
+        void _noteFirstStartupSample()
         {
-            std::vector<_u8> requestPkt;
+            _startupTimings.first_sample_uS = _firstSampleArrival_uS > _startupScanCommand_uS ? _firstSampleArrival_uS - _startupScanCommand_uS : 0;
+        }
 
-            if (!payload) payloadSize = 0;
-            requestPkt.resize(sizeof(rplidar_payload_get_scan_conf_t) + payloadSize);
-            rplidar_payload_get_scan_conf_t* query = reinterpret_cast<rplidar_payload_get_scan_conf_t*>(&requestPkt[0]);
+        void _noteFirstStartupScan(_u64 firstScan_uS)
+        {
+            _startupTimings.first_scan_uS = firstScan_uS > _firstSampleArrival_uS ? firstScan_uS - _firstSampleArrival_uS : 0;
+            _startupTimings.total_uS = firstScan_uS - _startupOrigin_uS;
+            _startupScanCommand_uS = 0;
+        }
 
-            query->type = type;
+        // the modes queried on this connection, for switchScanMode
+        void _rememberScanMode(const LidarScanMode& scanMode)
+        {
+            for (size_t pos = 0; pos < _preparedScanModes.size(); ++pos) {
+                if (_preparedScanModes[pos].id == scanMode.id) {
+                    _preparedScanModes[pos] = scanMode;
+                    return;
+                }
+            }
+            _preparedScanModes.push_back(scanMode);
+        }
 
-            if (payloadSize)
-                memcpy(&query[1], payload, payloadSize);
+        // the motor start of startScanFast, timed apart from the queries it overlaps
+        void _startMotorTimed(LidarStartupTimings& timings)
+        {
+            _u64 start_uS = getus();
+            startMotor();
+            timings.motor_uS = getus() - start_uS;
+        }
 
-            u_result ans;
-            internal::message_autoptr_t ans_frame;
-            ans = _sendCommandWithResponse(SL_LIDAR_CMD_GET_LIDAR_CONF, SL_LIDAR_ANS_TYPE_GET_LIDAR_CONF, ans_frame, timeout, &requestPkt[0], requestPkt.size());
-            if (IS_FAIL(ans)) {
-                return ans;
+        bool _findPreparedScanMode(sl_u16 scanModeID, LidarScanMode& scanMode)
+        {
+            if (!_isDevInfoCached) return false;
+
+            for (size_t pos = 0; pos < _preparedScanModes.size(); ++pos) {
+                if (_preparedScanModes[pos].id == scanModeID) {
+                    scanMode = _preparedScanModes[pos];
+                    return true;
+                }
             }
-            //check if returned size is even less than sizeof(type) 
-            if (ans_frame->getPayloadSize() < offsetof(rplidar_response_get_lidar_conf_t, payload)) {
-                return SL_RESULT_INVALID_DATA;
+
+            if (_syncCapabilities(_cached_DevInfo) && (_capabilities.flags & internal::CAPABILITY_CACHE_FLAG_SCAN_MODES)) {
+                for (size_t pos = 0; pos < _capabilities.scanModes.size(); ++pos) {
+                    if (_capabilities.scanModes[pos].id == scanModeID) {
+                        scanMode = _capabilities.scanModes[pos];
+                        return true;
+                    }
+                }
             }
+            return false;
+        }
 
-            //check if returned type is same as asked type
-            const rplidar_response_get_lidar_conf_t* replied =
-                reinterpret_cast<const rplidar_response_get_lidar_conf_t*>(ans_frame->getDataBuf());
+        static u_result _parseDeviceInfo(const LidarCommandAnswer& answer, sl_lidar_response_device_info_t& info)
+        {
+            if (IS_FAIL(answer.result)) return answer.result;
+            if (answer.payload.size() < sizeof(info)) return SL_RESULT_INVALID_DATA;
 
+            memcpy(&info, &answer.payload[0], sizeof(info));
+#ifdef _CPU_ENDIAN_BIG
+            info.firmware_version = le16_to_cpu(info.firmware_version);
+#endif
+            return SL_RESULT_OK;
+        }
 
-            if (replied->type != type) {
-                return SL_RESULT_INVALID_DATA;
-            }
-            //copy all the payload into &outputBuf
-            int payLoadLen = (int)ans_frame->getPayloadSize() - (int)offsetof(rplidar_response_get_lidar_conf_t, payload);
-            //do consistency check
-            if (payLoadLen < 0) {
-                return SL_RESULT_INVALID_DATA;
-            }
-            //copy all payLoadLen bytes to outputBuf
-            outputBuf.resize(payLoadLen);
-            if (payLoadLen)
-                memcpy(&outputBuf[0], replied->payload, payLoadLen);
-            return ans;
+        static u_result _parseHealth(const LidarCommandAnswer& answer, sl_lidar_response_device_health_t& health)
+        {
+            if (IS_FAIL(answer.result)) return answer.result;
+            if (answer.payload.size() < sizeof(health)) return SL_RESULT_INVALID_DATA;
+
+            memcpy(&health, &answer.payload[0], sizeof(health));
+#ifdef _CPU_ENDIAN_BIG
+            health.error_code = le16_to_cpu(health.error_code);
+#endif
+            return SL_RESULT_OK;
         }
 
-        u_result getLidarSampleDuration(float& sampleDurationRes, sl_u16 scanModeID, sl_u32 timeoutInMs = DEFAULT_TIMEOUT)
+        static u_result _parseTypicalScanMode(const LidarCommandAnswer& answer, sl_u16& scanMode)
         {
-            u_result ans;
+            if (IS_FAIL(answer.result)) return answer.result;
+            if (answer.payload.size() < sizeof(sl_u16)) return SL_RESULT_INVALID_DATA;
 
-            std::vector<_u8> answer;
-            ans = getLidarConf(SL_LIDAR_CONF_SCAN_MODE_US_PER_SAMPLE, answer, &scanModeID, sizeof(_u16), timeoutInMs);
-            if (IS_FAIL(ans))
-            {
-                return ans;
-            }
-            if (answer.size() < sizeof(_u32))
-            {
-                return SL_RESULT_INVALID_DATA;
-            }
-            const _u32* result = reinterpret_cast<const _u32*>(&answer[0]);
-            sampleDurationRes = (float)(*result / 256.0);
-            return ans;
+            const sl_u16* result = reinterpret_cast<const sl_u16*>(&answer.payload[0]);
+            scanMode = *result;
+            return SL_RESULT_OK;
         }
 
-        u_result getMaxDistance(float &maxDistance, sl_u16 scanModeID, sl_u32 timeoutInMs = DEFAULT_TIMEOUT)
+        static u_result _parseSampleDuration(const LidarCommandAnswer& answer, float& sampleDurationRes)
         {
-            u_result ans;
+            if (IS_FAIL(answer.result)) return answer.result;
+            if (answer.payload.size() < sizeof(_u32)) return SL_RESULT_INVALID_DATA;
 
+            const _u32* result = reinterpret_cast<const _u32*>(&answer.payload[0]);
+            sampleDurationRes = (float)(*result / 256.0);
+            return RESULT_OK;
+        }
 
-            std::vector<_u8> answer;
-            ans = getLidarConf(SL_LIDAR_CONF_SCAN_MODE_MAX_DISTANCE, answer, &scanModeID, sizeof(_u16), timeoutInMs);
-            if (IS_FAIL(ans))
-            {
-                return ans;
-            }
-            if (answer.size() < sizeof(_u32))
-            {
-                return SL_RESULT_INVALID_DATA;
-            }
-            const _u32* result = reinterpret_cast<const _u32*>(&answer[0]);
+        static u_result _parseMaxDistance(const LidarCommandAnswer& answer, float& maxDistance)
+        {
+            if (IS_FAIL(answer.result)) return answer.result;
+            if (answer.payload.size() < sizeof(_u32)) return SL_RESULT_INVALID_DATA;
+
+            const _u32* result = reinterpret_cast<const _u32*>(&answer.payload[0]);
             maxDistance = (float)(*result >> 8);
-            return ans;
+            return RESULT_OK;
         }
 
-        u_result getScanModeAnsType(sl_u8 &ansType, sl_u16 scanModeID, sl_u32 timeoutInMs = DEFAULT_TIMEOUT)
+        static u_result _parseScanModeAnsType(const LidarCommandAnswer& answer, sl_u8& ansType)
         {
-            u_result ans;
+            if (IS_FAIL(answer.result)) return answer.result;
+            if (answer.payload.size() < sizeof(_u8)) return SL_RESULT_INVALID_DATA;
 
-            std::vector<_u8> answer;
-            ans = getLidarConf(SL_LIDAR_CONF_SCAN_MODE_ANS_TYPE, answer, &scanModeID, sizeof(_u16), timeoutInMs);
-            if (IS_FAIL(ans))
-            {
-                return ans;
-            }
-            if (answer.size() < sizeof(_u8))
-            {
-                return SL_RESULT_INVALID_DATA;
-            }
-            const _u8* result = reinterpret_cast<const _u8*>(&answer[0]);
-            ansType = *result;
-            return ans;
+            ansType = answer.payload[0];
+            return RESULT_OK;
         }
 
-        u_result getScanModeName(char* modeName, size_t stringSize, _u16 scanModeID, _u32 timeoutInMs = DEFAULT_TIMEOUT)
+        static u_result _parseScanModeName(const LidarCommandAnswer& answer, char* modeName, size_t stringSize)
         {
-            u_result ans;
+            if (IS_FAIL(answer.result)) return answer.result;
 
-            std::vector<_u8> answer;
-            ans = getLidarConf(SL_LIDAR_CONF_SCAN_MODE_NAME, answer, &scanModeID, sizeof(_u16), timeoutInMs);
-            if (IS_FAIL(ans))
-            {
-                return ans;
-            }
-            size_t len = std::min<size_t>(answer.size(), stringSize);
+            size_t len = std::min<size_t>(answer.payload.size(), stringSize);
             if (0 == len) return SL_RESULT_INVALID_DATA;
 
-            memcpy(modeName, &answer[0], len);
-            return ans;
+            memcpy(modeName, &answer.payload[0], len);
+            return RESULT_OK;
         }
 
 
@@ -1456,10 +3391,52 @@ namespace sl {
 
     protected:
         
+        sl_result _grabScanDataHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, sl_u64* timestamps_uS, size_t& count, sl_u64& timestamp_uS, sl_u32 timeout)
+        {
+            if (!_isSamplePathActive(LIDAR_SAMPLE_PATH_SCANS)) return SL_RESULT_OPERATION_NOT_SUPPORT;
+            if (_isDecodingDeferred) return _grabDeferredScanDataHq(nodebuffer, timestamps_uS, count, timestamp_uS, timeout);
+            if (!_scanHolder.hasNodeOutput()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            rp::hal::AutoLocker l(_grab_locker);
+
+            // the taken scan is owned by this grab, the decoder keeps filling the other buffers meanwhile
+            auto availBuffer = _scanHolder.waitAndTakeNewestScan(timeout);
+            if (!availBuffer) return SL_RESULT_OPERATION_TIMEOUT;
+
+            // the view also covers the scans only kept as bins
+            const LidarScanData& scan = availBuffer->view;
+            count = std::min<size_t>(count, scan.count);
+            timestamp_uS = scan.timestamp_uS;
+
+            std::copy(scan.nodes, scan.nodes + count, nodebuffer);
+            if (timestamps_uS) {
+                std::copy(scan.timestamps_uS, scan.timestamps_uS + count, timestamps_uS);
+            }
+
+            return RESULT_OK;
+        }
+
+        // decodes the newest revolution in the calling thread, see setDeferredDecoding
+        sl_result _grabDeferredScanDataHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, sl_u64* timestamps_uS, size_t& count, sl_u64& timestamp_uS, sl_u32 timeout)
+        {
+            rp::hal::AutoLocker l(_grab_locker);
+
+            if (!_deferredScanHolder.waitAndTake(_deferredRevolution, timeout)) return SL_RESULT_OPERATION_TIMEOUT;
+            if (!_deferredScanDecoder.decode(_deferredRevolution, nodebuffer, timestamps_uS, count, timestamp_uS)) {
+                count = 0;
+                return SL_RESULT_OPERATION_FAIL;
+            }
+            return RESULT_OK;
+        }
+
         void _disableDataGrabbing()
         {
+            SL_TRACE_SCOPE(rp::hal::TRACE_CATEGORY_CMD, "disable_data_grabbing");
             _dataunpacker->disable();
             _protocolHandler->exitLoopMode(); // exit loop mode
+            _isDataGrabbing = false;
+            _stallPacket_uS = 0;
+            _scanHolder.leaveSteadyState();
         }
         
 
@@ -1535,24 +3512,82 @@ namespace sl {
             }
         }
 
+        void _updateInterfaceDesc(const rplidar_response_device_info_t& devInfo)
+        {
+            // probed once per connection, the mac address query of the S series costs its timeout on the UART units
+            if (!_isInterfaceDetected || memcmp(&devInfo, &_interfaceDevInfo, sizeof(devInfo))) {
+                _timing_desc.native_baudrate = _getNativeBaudRate(devInfo);
+                _detectLIDARNativeInterfaceType(_timing_desc.native_interface_type, devInfo, 500);
+                _interfaceDevInfo = devInfo;
+                _isInterfaceDetected = true;
+            }
+        }
+
         bool _updateTimingDesc(const rplidar_response_device_info_t& devInfo, float selectedSampleDuration)
         {
-            _timing_desc.native_baudrate = _getNativeBaudRate(devInfo);
-            _detectLIDARNativeInterfaceType(_timing_desc.native_interface_type, devInfo, 500);
+            _updateInterfaceDesc(devInfo);
             
             _timing_desc.sample_duration_uS = (_u64)(selectedSampleDuration + 0.5f);
 
-            //FIXME: will be changed in future releases
-            _timing_desc.native_timestamp_support = false; 
-            _timing_desc.linkage_delay_uS = 0;
+            // the handlers check the timestamps of the device before following them
+            _timing_desc.native_timestamp_support = _isNativeTimestampEnabled;
+            _timing_desc.linkage_delay_uS = _linkageDelay_uS;
 
 
             // notify the data unpacker
             _dataunpacker->updateUnpackerContext(internal::LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_LIDAR_TIMING ,&_timing_desc, sizeof(_timing_desc));
+            _deferredScanDecoder.updateUnpackerContext(internal::LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_LIDAR_TIMING, &_timing_desc, sizeof(_timing_desc));
             return true;
 
         }
 
+        void _updateScanRegion()
+        {
+            _dataunpacker->updateUnpackerContext(internal::LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_SCAN_REGION, &_scanRegion, sizeof(_scanRegion));
+            _deferredScanDecoder.updateUnpackerContext(internal::LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_SCAN_REGION, &_scanRegion, sizeof(_scanRegion));
+        }
+
+        // the standard scan mode and the custom sample types are always decoded on the decoder thread
+        void _updateDeferredDecoding(sl_u8 ansType)
+        {
+            bool deferred = _isDeferredDecodingEnabled && ansType != SL_LIDAR_ANS_TYPE_MEASUREMENT && !_isCustomSampleType[ansType];
+            _isDecodingDeferred = deferred;
+            _deferredScanHolder.reset();
+            _dataunpacker->updateUnpackerContext(internal::LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_DEFERRED_DECODING, &deferred, sizeof(deferred));
+        }
+
+        void _updateScanCapacity(float selectedSampleDuration)
+        {
+            _scanSampleDuration = selectedSampleDuration;
+
+            size_t capacity = _userScanCapacity;
+            if (!capacity) {
+                if (selectedSampleDuration > 0) {
+                    // a motor commanded below the usual slowest rotation takes longer revolutions
+                    float slowestFrequency = (float)MIN_SCAN_FREQUENCY_HZ;
+                    if (_commandedRpm && _commandedRpm / 60.f < slowestFrequency) slowestFrequency = _commandedRpm / 60.f;
+                    float samplesPerRound = 1000000.f / slowestFrequency / selectedSampleDuration;
+                    capacity = (size_t)(samplesPerRound * (100 + SCAN_CAPACITY_MARGIN_PERCENT) / 100) + 1;
+                }
+                else {
+                    capacity = MAX_SCANNODE_CACHE_COUNT;
+                }
+                if (capacity < MIN_SCAN_CAPACITY) capacity = MIN_SCAN_CAPACITY;
+                if (capacity > MAX_SCAN_CAPACITY) capacity = MAX_SCAN_CAPACITY;
+            }
+
+            // applied to the scans begun from now on, the ones being read keep their buffers
+            _scanHolder.setMaxCacheCount(capacity);
+            _sectorAssembler.setMaxCount(capacity);
+            // the ring of a disabled interval path is released
+            _rawSampleNodeHolder.setCapacity(_isSamplePathActive(LIDAR_SAMPLE_PATH_INTERVAL) ? capacity : 0);
+        }
+
+        bool _isSamplePathActive(LidarSamplePath path)
+        {
+            return (_samplePaths.load(std::memory_order_relaxed) & path) != 0;
+        }
+
         u_result _getLegacySampleDuration_uS(rplidar_response_sample_rate_t& rateInfo, _u32 timeout)
         {
             
@@ -1560,7 +3595,7 @@ namespace sl {
 
             rplidar_response_device_info_t devinfo;
             // 1. fetch the device version first...
-            u_result ans = getDeviceInfo(devinfo, timeout);
+            u_result ans = _queryDeviceInfo(devinfo, timeout);
 
             rateInfo.express_sample_duration_us = LEGACY_SAMPLE_DURATION;
             rateInfo.std_sample_duration_us = LEGACY_SAMPLE_DURATION;
@@ -1597,75 +3632,220 @@ namespace sl {
         }
 
 
+        // the payload is referenced rather than copied, the message must not outlive it
+        static void _buildCommandMessage(internal::ProtocolMessage& message, _u8 cmd, const void* payload, size_t payloadsize)
+        {
+            message.cmd = cmd;
+            if (payload && payloadsize) {
+                message.setDataBuf((_u8*)payload, payloadsize);
+            }
+        }
+
         u_result _sendCommandWithoutResponse(_u8 cmd, const void* payload = NULL, size_t payloadsize = 0, bool noForceStop = false)
         {
             if (!noForceStop) {
                 _disableDataGrabbing();
             }
-            _response_waiter.set(false);
 
-            internal::message_autoptr_t message(new internal::ProtocolMessage(cmd, (const _u8*)payload, payloadsize));
+            internal::ProtocolMessage message;
+            _buildCommandMessage(message, cmd, payload, payloadsize);
+            SL_TRACE_INSTANT(rp::hal::TRACE_CATEGORY_CMD, "cmd_send", cmd);
             return _transeiver->sendMessage(message);
 
         }
 
-        u_result _sendCommandWithResponse(_u8 cmd, _u8 responseType, internal::message_autoptr_t& ansPkt, _u32 timeout = DEFAULT_TIMEOUT, const void* payload = NULL, size_t payloadsize = 0)
+        // the queries without side effects, which the devices can answer while streaming
+        static bool _isQueryCommand(_u8 cmd)
         {
-            u_result ans;
+            switch (cmd) {
+            case SL_LIDAR_CMD_GET_DEVICE_INFO:
+            case SL_LIDAR_CMD_GET_DEVICE_HEALTH:
+            case SL_LIDAR_CMD_GET_SAMPLERATE:
+            case SL_LIDAR_CMD_GET_LIDAR_CONF:
+            case SL_LIDAR_CMD_GET_ACC_BOARD_FLAG:
+                return true;
+            default:
+                return false;
+            }
+        }
 
-            _data_locker.lock();
+        // sends the command once its answer is expected, the handler is called exactly once in any case
+        void _sendCommandAsync(_u8 cmd, _u8 responseType, _u32 confType, const void* payload, size_t payloadsize, _u32 timeout, const internal::CommandPipeline::AnswerHandler& handler)
+        {
+            internal::ProtocolMessage message;
+            _buildCommandMessage(message, cmd, payload, payloadsize);
 
-            internal::message_autoptr_t message(new internal::ProtocolMessage(cmd, (const _u8*)payload, payloadsize));
-            _disableDataGrabbing();
-            _waiting_packet_type = responseType;
-            _response_waiter.set(false);
-            _data_locker.unlock();
+            // a query sent while streaming is answered between the sample packets, the scan goes on
+            bool inStream = _inStreamQueries && _isQueryCommand(cmd) && _protocolHandler->addInStreamAnswerType(responseType);
+            if (!inStream && (_isDataGrabbing || !_commandPipeline.getPendingCount())) {
+                // the decoder is not reset under the answers still on their way
+                _disableDataGrabbing();
+            }
+
+            internal::CommandPipeline::AnswerHandler onAnswer = handler;
+            if (inStream) {
+                std::shared_ptr<internal::RPLidarProtocolCodec> codec = _protocolHandler;
+                onAnswer = [codec, responseType, handler](u_result result, const internal::ProtocolMessage* msg) {
+                    codec->removeInStreamAnswerType(responseType);
+                    handler(result, msg);
+                };
+            }
+
+            _u32 ticket;
+            u_result ans = _commandPipeline.expect(responseType, confType, timeout, onAnswer, ticket);
+            if (IS_FAIL(ans)) {
+                onAnswer(ans, NULL);
+                return;
+            }
 
+            SL_TRACE_INSTANT(rp::hal::TRACE_CATEGORY_CMD, inStream ? "cmd_send_in_stream" : "cmd_send", cmd);
             ans = _transeiver->sendMessage(message);
+            if (IS_FAIL(ans)) {
+                _commandPipeline.cancel(ticket, ans);
+            }
+        }
 
-            if (IS_FAIL(ans)) return ans;
+        // the answer of a command waited for on the stack of its caller; the handler only captures
+        // its address, which keeps the std::function in its inline storage
+        struct SyncAnswer {
+            SyncAnswer(internal::ProtocolMessagePool* pool, _u8 cmd)
+                : pool(pool), cmd(cmd), result(RESULT_OPERATION_FAIL), isHandled(false) {}
 
-            do {
-                switch (_response_waiter.wait(timeout)) {
-                case rp::hal::Event::EVENT_TIMEOUT:
-                    return RESULT_OPERATION_TIMEOUT;
-                case rp::hal::Event::EVENT_OK:
-                    _data_locker.lock();
-                    ansPkt = _lastAnsPkt;
-                    _data_locker.unlock();
-                    return RESULT_OK;
-                default:
-                    return RESULT_OPERATION_FAIL;
-                }
-            } while (1);
+            internal::ProtocolMessagePool* pool;
+            _u8                            cmd;
+            u_result                       result;
+            internal::message_autoptr_t    answer;
+            rp::hal::Event                 completed;
+            std::atomic<bool>              isHandled;   // the last access of the handler, the caller may leave once it is set
+        };
+
+        u_result _sendCommandWithResponse(_u8 cmd, _u8 responseType, internal::message_autoptr_t& ansPkt, _u32 timeout = DEFAULT_TIMEOUT, const void* payload = NULL, size_t payloadsize = 0)
+        {
+            SyncAnswer sync(_answerPool.get(), cmd);
+            SyncAnswer* syncPtr = &sync;
+
+            _sendCommandAsync(cmd, responseType, internal::CommandPipeline::ANY_CONF_TYPE, payload, payloadsize, timeout,
+                [syncPtr](u_result result, const internal::ProtocolMessage* msg) {
+                    if (result == RESULT_OPERATION_TIMEOUT) {
+                        SL_TRACE_INSTANT(rp::hal::TRACE_CATEGORY_CMD, "cmd_timeout", syncPtr->cmd);
+                    }
+                    syncPtr->result = result;
+                    if (msg) syncPtr->answer = syncPtr->pool->acquire(*msg);
+                    syncPtr->completed.set();
+                    syncPtr->isHandled.store(true, std::memory_order_release);
+                });
+
+            // the pipeline completes the command on its timeout
+            sync.completed.wait();
+            while (!sync.isHandled.load(std::memory_order_acquire)) {
+                delay(0);
+            }
+            if (IS_OK(sync.result)) {
+                ansPkt = sync.answer;
+            }
+            return sync.result;
         }
         
     public:
 
         virtual void onHQNodeDecoded(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node)
         {
-            _scanHolder.pushScanNodeData(timestamp_uS, node);
-            _rawSampleNodeHolder.pushNode(timestamp_uS, node);
+            onHQNodesDecoded(node, &timestamp_uS, 1);
+        }
+
+        virtual void onHQNodesDecoded(const rplidar_response_measurement_node_hq_t* nodes, const _u64* timestamps_uS, size_t count)
+        {
+            if (count) _noteSamples(timestamps_uS[0], timestamps_uS[count - 1]);
+
+            sl_u32 paths = _samplePaths.load(std::memory_order_relaxed);
+            if (paths & LIDAR_SAMPLE_PATH_SCANS) _scanHolder.pushScanNodesData(timestamps_uS, nodes, count);
+            if (paths & LIDAR_SAMPLE_PATH_SECTORS) _sectorAssembler.pushNodes(timestamps_uS, nodes, count);
+            if (paths & LIDAR_SAMPLE_PATH_INTERVAL) _rawSampleNodeHolder.pushNodes(timestamps_uS, nodes, count);
         }
 
         virtual void onHQNodeScanResetReq() {
-            _scanHolder.rewindCurrentScanData();
+            // the new stream of switchScanMode carries on the scan in progress
+            if (_keepScanOnReset) return;
+
+            sl_u32 paths = _samplePaths.load(std::memory_order_relaxed);
+            if (paths & LIDAR_SAMPLE_PATH_SCANS) _scanHolder.rewindCurrentScanData();
+            if (paths & LIDAR_SAMPLE_PATH_SECTORS) _sectorAssembler.rewindCurrentScanData();
         }
 
-        virtual void onProtocolMessageDecoded(const internal::ProtocolMessage& msg)
+        virtual void onSamplePacketDeferred(_u8 ansType, _u64 timestamp_uS, const void* packet, size_t size, bool revolutionStart)
+        {
+            _noteSamples(timestamp_uS, timestamp_uS);
+            if (!_isSamplePathActive(LIDAR_SAMPLE_PATH_SCANS)) return;
+            _deferredScanHolder.pushPacket(ansType, timestamp_uS, packet, size, revolutionStart);
+        }
+
+        // on the decoder thread, for the gap measured by switchScanMode, the startup of startScanFast and the stall watchdog
+        void _noteSamples(_u64 first_uS, _u64 last_uS)
+        {
+            if (_isFirstSampleWaiting.load(std::memory_order_relaxed) && _isFirstSampleWaiting.exchange(false)) {
+                _keepScanOnReset = false;
+                _firstSample_uS = first_uS;
+                _firstSampleArrival_uS = getus();
+                _firstSampleEvt.set();
+            }
+            _lastSample_uS.store(last_uS, std::memory_order_relaxed);
+            _lastPacketArrival_uS.store(getus(), std::memory_order_release);
+            if (_stalledSince_uS.load(std::memory_order_relaxed)) _stallEvt.set();
+        }
+
+        // the payload of a custom sample handler, handed over in place
+        virtual void onCustomSampleDataDecoded(_u8 ansType, _u32 customCode, _u64 timestamp_uS, const void* data, size_t size)
+        {
+            ICustomSampleListener* listener = _customSampleListener;
+            if (listener) {
+                listener->onCustomSampleData(ansType, customCode, data, size, timestamp_uS);
+            }
+        }
+
+        virtual void onDecodingError(int errMsg, _u8 ansType, const void* payload, size_t size)
+        {
+            if (errMsg == internal::LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR) {
+                _scanHolder.notifyPacketDiscarded();
+            }
+        }
+
+        // called on the rx thread of the transceiver, whose rx session ends right after: the thread parks on its bind
+        // event until the recovery, or the next connect, binds it to a channel again
+        virtual void onProtocolChannelError(u_result errCode)
+        {
+            _requestRecovery(errCode, getus());
+        }
+
+        // hands the reconnect over to the recovery thread, false if it is not supervised or recovering already
+        bool _requestRecovery(u_result errCode, sl_u64 failedSince_uS)
         {
-            internal::message_autoptr_t message = std::make_shared<internal::ProtocolMessage>(msg);
+            if (!_isRecoveryWorking || _isRecoveryPending) return false;
+
+            _recoveryError = errCode;
+            _recoveryFailedSince_uS = failedSince_uS;
+            bool isPending = false;
+            if (!_isRecoveryPending.compare_exchange_strong(isPending, true)) return false;
+            _commandPipeline.abortAll(errCode);
+            _recoveryEvt.set();
+            return true;
+        }
 
-            if (_dataunpacker->onSampleData(message->cmd, message->getDataBuf(), message->getPayloadSize()))
+        virtual void onProtocolMessageDecoded(const internal::ProtocolMessage& msg)
+        {
+            // the sample data is consumed in place, only the waited response is copied
+#ifdef SL_LIDAR_LATENCY_PROFILING
+            _u64 unpackStartTs = getus();
+#endif
+            if (_dataunpacker->onSampleData(msg.cmd, msg.getDataBuf(), msg.getPayloadSize(), msg.rxTimestamp_uS))
             {
+#ifdef SL_LIDAR_LATENCY_PROFILING
+                _latencyProfile.recordSince(LIDAR_LATENCY_STAGE_UNPACKER_DECODE, unpackStartTs);
+#endif
                 return;
             }
 
-            if (message->cmd == _waiting_packet_type) {
-                _data_locker.lock();
-                _lastAnsPkt = message;
-                _response_waiter.setResult(message->cmd);
-                _data_locker.unlock();
+            if (_commandPipeline.onAnswer(msg)) {
+                SL_TRACE_INSTANT(rp::hal::TRACE_CATEGORY_CMD, "cmd_response", msg.cmd);
             }
 
             
@@ -1675,28 +3855,238 @@ namespace sl {
         std::shared_ptr<internal::RPLidarProtocolCodec> _protocolHandler;
         std::shared_ptr<internal::AsyncTransceiver> _transeiver;
         std::shared_ptr<internal::LIDARSampleDataUnpacker> _dataunpacker;
+        std::shared_ptr<internal::ProtocolMessagePool> _answerPool;
 
         bool _isConnected;
 
         MotorCtrlSupport          _isSupportingMotorCtrl;
 
 
-        rp::hal::Locker           _op_locker;
-        rp::hal::Locker           _data_locker;
-        rp::hal::Waiter<_u32>     _response_waiter;
+        rp::hal::Locker           _op_locker;     // serializes the commands
+        internal::CommandPipeline _commandPipeline;
 
+        // the consumer side of the grabs, kept off the lines the decoder thread writes
+        SL_CACHE_ALIGNED rp::hal::Locker _grab_locker;   // serializes the scan grabs, the scan holder has a single consumer
+        DeferredScanHolder::Revolution _deferredRevolution;   // owned by the grab
+
+        ScanListenerDispatcher _scanListenerDispatcher;
+        PacedScanDispatcher    _pacedScanDispatcher;
+        rp::hal::Locker        _scanRouteLocker;    // guards the choice of the dispatcher the scan holder calls
+        bool                   _hasScanListener;
         ScanDataHolder<sl_lidar_response_measurement_node_hq_t> _scanHolder;
+        SL_CACHE_ALIGNED SectorListenerDispatcher _sectorListenerDispatcher;
+        ScanSectorAssembler<sl_lidar_response_measurement_node_hq_t> _sectorAssembler;
         RawSampleNodeHolder<sl_lidar_response_measurement_node_hq_t> _rawSampleNodeHolder;
-        _u32                          _waiting_packet_type;
-        internal::message_autoptr_t   _lastAnsPkt;
+        SL_CACHE_ALIGNED DeferredScanHolder _deferredScanHolder;
+        DeferredScanDecoder       _deferredScanDecoder;
+        std::unique_ptr<rp::hal::Notifier> _scanReadyNotifier; // made on the first getScanReadyHandle
+        internal::ChannelRecorder _recorder;
+#ifdef SL_LIDAR_LATENCY_PROFILING
+        internal::LatencyProfile  _latencyProfile;
+#endif
+        bool                          _isDataGrabbing;
+        bool                          _inStreamQueries;
+
+        internal::CapabilityCache       _capabilityCache;
+        internal::DeviceCapabilities    _capabilities;          // the entry of _capabilitiesDevInfo
+        sl_lidar_response_device_info_t _capabilitiesDevInfo;
+        bool                            _capabilitiesLoaded;
 
         sl_lidar_response_device_info_t _cached_DevInfo;
         SlamtecLidarTimingDesc         _timing_desc;
+        sl_lidar_response_device_info_t _interfaceDevInfo;   // the device the interface of _timing_desc was detected on
+        bool                           _isInterfaceDetected;
+        bool                           _isMotorCtrlProbed;
+        bool                           _isDevInfoCached;
+        sl_u32                         _lastDetectedBaudRate;
+
+        // the last scan started, restarted by the recovery after a channel failure
+        struct ResumeScanState {
+            bool   isActive;
+            bool   isExpress;
+            bool   force;
+            sl_u16 scanMode;
+            sl_u32 options;
+        };
+        ResumeScanState                _resumeScan;
+        sl_u16                         _requestedMotorSpeed;
+        std::atomic<size_t>            _userScanCapacity;   // 0 derives the capacity from the scan mode
+        std::atomic<bool>              _isNativeTimestampEnabled;
+        std::atomic<sl_u32>            _linkageDelay_uS;    // see calibrateLinkageDelay
+        LidarScanRegion                _scanRegion;         // guarded by _op_locker
+        std::atomic<bool>              _isDeferredDecodingEnabled;
+        std::atomic<bool>              _isDecodingDeferred; // sampled from _isDeferredDecodingEnabled at startScan
+        std::atomic<sl_u32>            _samplePathsEnabled;
+        std::atomic<sl_u32>            _samplePaths;        // sampled from _samplePathsEnabled at startScan
+        sl_u32                         _rxMaxBlockMs;       // of the last blocking policy, guarded by _op_locker
+        LidarRealtimeOptions           _realtimeOptions;    // guarded by _op_locker
+        bool                           _isCustomSampleType[256]; // the answer types decoded by a handler of registerSampleHandler
+        std::atomic<ICustomSampleListener*> _customSampleListener;
+
+        rp::hal::Locker                _recovery_locker;    // guards the settings and the thread of the recovery
+        rp::hal::Thread                _recoveryThread;
+        rp::hal::Event                 _recoveryEvt;
+        std::atomic<bool>              _isRecoveryWorking;
+        std::atomic<bool>              _isRecoveryPending;
+        std::atomic<sl_result>         _recoveryError;
+        std::atomic<sl_u64>            _recoveryFailedSince_uS;
+        IRecoveryListener*             _recoveryListener;
+        sl_u32                         _recoveryMaxBackoffMs;
+        std::atomic<sl_u64>            _recoveryCount;      // see getRecoveryStats
+        std::atomic<sl_u64>            _recoveryFailureCount;
+        std::atomic<sl_u64>            _recoveryAttemptCount;
+        std::atomic<sl_u64>            _recoveryDowntime_uS;
+
+        std::vector<LidarScanMode>     _preparedScanModes;  // guarded by _op_locker, see switchScanMode
+        bool                           _isDesiredSpeedCached;
+        sl_lidar_response_desired_rot_speed_t _desiredSpeed;
+        sl_u16                         _commandedRpm;       // the last speed set in rpm, 0 if unknown
+        float                          _scanSampleDuration; // of the scan mode started, for _updateScanCapacity
+        // written by the decoder thread for each sample packet
+        SL_CACHE_ALIGNED std::atomic<sl_u64> _lastSample_uS;      // the newest sample decoded
+        std::atomic<sl_u64>            _lastPacketArrival_uS; // 0 until the first sample of the stream, even unwatched
+        std::atomic<bool>              _isFirstSampleWaiting;
+
+        SL_CACHE_ALIGNED std::atomic<bool> _keepScanOnReset;
+        sl_u64                         _firstSample_uS;
+        sl_u64                         _firstSampleArrival_uS;  // the host time _firstSample_uS was received at
+        rp::hal::Event                 _firstSampleEvt;
+
+        // guarded by _op_locker, see startScanFast
+        sl_u64                         _connectStart_uS;        // 0 once a startScanFast has accounted for the connection
+        sl_u64                         _connect_uS;
+        sl_u64                         _startupOrigin_uS;
+        sl_u64                         _startupScanCommand_uS;  // 0 once the first scan has been timed
+        LidarStartupTimings            _startupTimings;
+
+        typedef internal::SingleFlight<sl_lidar_response_device_health_t> HealthFlight;
+        typedef internal::SingleFlight<sl_lidar_response_device_info_t> DeviceInfoFlight;
+        typedef internal::SingleFlight<LidarMotorInfo> MotorInfoFlight;
+        HealthFlight                   _healthFlight;       // see setQueryCache
+        DeviceInfoFlight               _deviceInfoFlight;
+        MotorInfoFlight                _motorInfoFlight;
+        std::atomic<sl_u32>            _healthMaxAgeMs;
+        std::atomic<sl_u32>            _deviceInfoMaxAgeMs;
+        std::atomic<sl_u32>            _motorInfoMaxAgeMs;
+        std::atomic<sl_u64>            _queryCommands;
+        std::atomic<sl_u64>            _queryCoalesced;
+        std::atomic<sl_u64>            _queryCached;
+
+        rp::hal::Locker                _stall_locker;       // guards the settings and the thread of the watchdog
+        rp::hal::Thread                _stallThread;
+        rp::hal::Event                 _stallEvt;
+        std::atomic<bool>              _isStallWatchWorking;
+        std::atomic<sl_u64>            _stalledSince_uS;      // the last packet before the stall reported, 0 if none
+        std::atomic<sl_u32>            _stallPacket_uS;       // the sample packet period, 0 while the stream is stopped
+        std::atomic<sl_u32>            _rxCoalescingWaitMs;
+        internal::AsyncTransceiver::decode_mode_t _decodeMode; // how the private threads decode, set before the connection
+        IStallListener*                _stallListener;
+        sl_u32                         _stallMinSilenceMs;
+        bool                           _isStallRecovering;
+        std::atomic<sl_u64>            _stallCount;
 
     };
 
+    static rp::hal::Thread::config_t _toHalThreadConfig(const LidarThreadConfig& src)
+    {
+        rp::hal::Thread::config_t config;
+        config.name = src.name;
+        config.cpuMask = src.cpu_affinity_mask;
+        config.priority = src.priority;
+        switch (src.policy) {
+        case LIDAR_THREAD_SCHED_OTHER:
+            config.policy = rp::hal::Thread::SCHED_POLICY_OTHER;
+            break;
+        case LIDAR_THREAD_SCHED_FIFO:
+            config.policy = rp::hal::Thread::SCHED_POLICY_FIFO;
+            break;
+        case LIDAR_THREAD_SCHED_RR:
+            config.policy = rp::hal::Thread::SCHED_POLICY_RR;
+            break;
+        default:
+            config.policy = rp::hal::Thread::SCHED_POLICY_DEFAULT;
+            break;
+        }
+        return config;
+    }
+
     Result<ILidarDriver*> createLidarDriver()
     {
         return new SlamtecLidarDriver();
     }
+
+    Result<ILidarDriver*> createLidarDriver(const LidarThreadingOptions& threading)
+    {
+        SlamtecLidarDriver* driver = new SlamtecLidarDriver();
+        driver->setThreadConfig(_toHalThreadConfig(threading.rx_thread), _toHalThreadConfig(threading.decoder_thread));
+        driver->setInlineDecode(threading.inline_decode);
+        return driver;
+    }
+
+    Result<ILidarIOReactor*> createLidarIOReactor(int threadCount, LidarIOReactorBackend backend)
+    {
+        LidarThreadConfig threads;
+        memset(&threads, 0, sizeof(threads));
+        return createLidarIOReactor(threadCount, backend, threads);
+    }
+
+    Result<ILidarIOReactor*> createLidarIOReactor(int threadCount, LidarIOReactorBackend backend, const LidarThreadConfig& threads)
+    {
+        rp::hal::Thread::config_t threadConfig = _toHalThreadConfig(threads);
+        rp::hal::IOReactor::reactor_backend_t halBackend;
+        switch (backend) {
+        case LIDAR_IO_REACTOR_IO_URING:
+            halBackend = rp::hal::IOReactor::BACKEND_IO_URING;
+            break;
+        case LIDAR_IO_REACTOR_IOCP:
+            halBackend = rp::hal::IOReactor::BACKEND_IOCP;
+            break;
+        case LIDAR_IO_REACTOR_KQUEUE:
+            halBackend = rp::hal::IOReactor::BACKEND_KQUEUE;
+            break;
+        default:
+            halBackend = rp::hal::IOReactor::BACKEND_EPOLL;
+            break;
+        }
+
+        rp::hal::IOReactor* reactor = rp::hal::IOReactor::CreateReactor(threadCount, halBackend, &threadConfig);
+        if (!reactor) return SL_RESULT_OPERATION_NOT_SUPPORT;
+        return new LidarIOReactorImpl(reactor);
+    }
+
+    Result<ILidarDecodePool*> createLidarDecodePool(int threadCount)
+    {
+        LidarThreadConfig threads;
+        memset(&threads, 0, sizeof(threads));
+        return createLidarDecodePool(threadCount, threads);
+    }
+
+    Result<ILidarDecodePool*> createLidarDecodePool(int threadCount, const LidarThreadConfig& threads)
+    {
+        if (threadCount <= 0 || threadCount > rp::hal::WorkStealingPool::MAX_THREAD_COUNT) return SL_RESULT_INVALID_DATA;
+
+        rp::hal::Thread::config_t threadConfig = _toHalThreadConfig(threads);
+        rp::hal::WorkStealingPool* pool = rp::hal::WorkStealingPool::CreatePool(threadCount, &threadConfig);
+        if (!pool) return SL_RESULT_OPERATION_NOT_SUPPORT;
+        return new LidarDecodePoolImpl(pool);
+    }
+
+    sl_result getLidarClockInfo(LidarClockInfo& info)
+    {
+        rp::arch::rp_getclockinfo(info.clock_name, info.resolution_nS, info.realtime_offset_uS);
+        info.now_uS = getus();
+        return SL_RESULT_OK;
+    }
+
+    sl_result setLidarTraceBackend(ILidarTraceBackend* backend)
+    {
+#ifdef SL_LIDAR_TRACING
+        static LidarTraceBackendAdapter adapter;
+        adapter.setBackend(backend);
+        rp::hal::Trace::SetBackend(backend ? &adapter : NULL);
+        return SL_RESULT_OK;
+#else
+        return SL_RESULT_OPERATION_NOT_SUPPORT;
+#endif
+    }
 }
\ No newline at end of file
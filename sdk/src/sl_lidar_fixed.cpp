@@ -0,0 +1,205 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/assert.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "hal/notifier.h"
+#include "sl_lidar_fixed.h"
+#include "sl_lidar_scan_holder.h"
+
+namespace sl {
+
+    enum {
+        ANGLE_STEPS = 65536,          // q14 angle steps of the full circle
+        ANGLE_STEP_MASK = ANGLE_STEPS - 1,
+        QUARTER_ANGLE_STEPS = ANGLE_STEPS / 4,
+        MAX_BIN_COUNT = ANGLE_STEPS,
+
+        SIN_SCALE_SHIFT = 15,
+
+        // marks the bins still empty while resampling, the flag of the nodes only carries the sync bit
+        BIN_EMPTY_FLAG = 0x80,
+    };
+
+    enum {
+        BIN_STATE_EMPTY = 0,
+        BIN_STATE_INVALID = 1,
+        BIN_STATE_VALID = 2,
+    };
+
+    static inline int _binState(const sl_lidar_response_measurement_node_hq_t& node)
+    {
+        if (node.flag & BIN_EMPTY_FLAG) return BIN_STATE_EMPTY;
+        return node.dist_mm_q2 ? BIN_STATE_VALID : BIN_STATE_INVALID;
+    }
+
+    // the angle steps of k nodes evenly spread over the circle by count nodes, rounded
+    static inline sl_s64 _spacingSteps(size_t k, size_t count)
+    {
+        return ((sl_s64)k * ANGLE_STEPS * 2 + (sl_s64)count) / (2 * (sl_s64)count);
+    }
+
+    sl_result ascendScanDataFixed(sl_lidar_response_measurement_node_hq_t* nodes, size_t count)
+    {
+        size_t first = 0;
+        while (first < count && nodes[first].dist_mm_q2 == 0) ++first;
+
+        // all the data is invalid
+        if (first == count) return SL_RESULT_OPERATION_FAIL;
+
+        size_t last = count - 1;
+        while (nodes[last].dist_mm_q2 == 0) --last;
+
+        // the head is spaced back from the first valid node, no further than 0
+        for (size_t pos = 0; pos < first; ++pos) {
+            sl_s64 angle = (sl_s64)nodes[first].angle_z_q14 - _spacingSteps(first - pos, count);
+            nodes[pos].angle_z_q14 = (sl_u16)(angle < 0 ? 0 : angle);
+        }
+
+        // the tail goes on from the last valid node
+        for (size_t pos = last + 1; pos < count; ++pos) {
+            sl_s64 angle = (sl_s64)nodes[last].angle_z_q14 + _spacingSteps(pos - last, count);
+            nodes[pos].angle_z_q14 = (sl_u16)(angle & ANGLE_STEP_MASK);
+        }
+
+        // the holes in between are spaced from the front node
+        const sl_s64 frontAngle = nodes[0].angle_z_q14;
+        for (size_t pos = first + 1; pos < last; ++pos) {
+            if (nodes[pos].dist_mm_q2 == 0) {
+                nodes[pos].angle_z_q14 = (sl_u16)((frontAngle + _spacingSteps(pos, count)) & ANGLE_STEP_MASK);
+            }
+        }
+
+        sortScanNodesByAngle_(nodes, count);
+        return SL_RESULT_OK;
+    }
+
+    size_t resampleScanToBinsFixed(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count,
+        size_t binCount, LidarScanBinPolicy policy, sl_lidar_response_measurement_node_hq_t* bins)
+    {
+        if (!binCount || binCount > MAX_BIN_COUNT) return 0;
+
+        // an empty bin is an invalid node at the bin center
+        for (size_t pos = 0; pos < binCount; ++pos) {
+            memset(&bins[pos], 0, sizeof(bins[pos]));
+            bins[pos].angle_z_q14 = (sl_u16)(((2 * pos + 1) << 16) / (2 * binCount));
+            bins[pos].flag = BIN_EMPTY_FLAG;
+        }
+
+        size_t filled = 0;
+        for (size_t pos = 0; pos < count; ++pos) {
+            const sl_lidar_response_measurement_node_hq_t& node = nodes[pos];
+            size_t binIdx = ((size_t)node.angle_z_q14 * binCount) >> 16;
+            sl_lidar_response_measurement_node_hq_t& bin = bins[binIdx];
+
+            // a sample with distance always wins over one without
+            int state = _binState(bin);
+            int newState = node.dist_mm_q2 ? BIN_STATE_VALID : BIN_STATE_INVALID;
+            bool replace = newState > state;
+            if (!replace && newState == state) {
+                switch (policy) {
+                case LIDAR_SCAN_BIN_MIN_RANGE:
+                    replace = node.dist_mm_q2 < bin.dist_mm_q2;
+                    break;
+                case LIDAR_SCAN_BIN_MAX_RANGE:
+                    replace = node.dist_mm_q2 > bin.dist_mm_q2;
+                    break;
+                default:
+                    {
+                        int center = (int)(((2 * binIdx + 1) << 16) / (2 * binCount));
+                        replace = abs((int)node.angle_z_q14 - center) < abs((int)bin.angle_z_q14 - center);
+                    }
+                    break;
+                }
+            }
+
+            if (replace) {
+                filled += (newState == BIN_STATE_VALID) && (state != BIN_STATE_VALID);
+                bin = node;
+                bin.flag &= ~BIN_EMPTY_FLAG;
+            }
+        }
+
+        for (size_t pos = 0; pos < binCount; ++pos) {
+            bins[pos].flag &= ~BIN_EMPTY_FLAG;
+        }
+        return filled;
+    }
+
+    // sin of the q14 angle steps of the first quadrant in q15, the other quadrants are mirrored from it
+    struct QuarterSinTable
+    {
+        QuarterSinTable()
+        {
+            for (int pos = 0; pos <= QUARTER_ANGLE_STEPS; ++pos) {
+                t[pos] = (sl_u16)floor(sin(pos * 3.14159265358979323846 / 2 / QUARTER_ANGLE_STEPS) * (1 << SIN_SCALE_SHIFT) + 0.5);
+            }
+        }
+
+        sl_u16 t[QUARTER_ANGLE_STEPS + 1];
+    };
+
+    static const sl_u16* _getQuarterSinTable()
+    {
+        static const QuarterSinTable table;
+        return table.t;
+    }
+
+    static inline sl_s32 _sinQ15(const sl_u16* table, sl_u32 angleStep)
+    {
+        sl_u32 quadrant = (angleStep >> 14) & 0x3;
+        sl_u32 offset = angleStep & (QUARTER_ANGLE_STEPS - 1);
+        sl_s32 v = (quadrant & 1) ? table[QUARTER_ANGLE_STEPS - offset] : table[offset];
+        return (quadrant & 2) ? -v : v;
+    }
+
+    // rounded half away from 0, as the float path rounds to the nearest
+    static inline sl_s32 _scaleRange(sl_u32 range, sl_s32 sinQ15)
+    {
+        sl_s64 v = (sl_s64)range * sinQ15;
+        const sl_s64 half = (sl_s64)1 << (SIN_SCALE_SHIFT - 1);
+        return (sl_s32)(v >= 0 ? (v + half) >> SIN_SCALE_SHIFT : -((-v + half) >> SIN_SCALE_SHIFT));
+    }
+
+    void convertScanToCartesianFixed(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_s32* x_q2, sl_s32* y_q2)
+    {
+        const sl_u16* table = _getQuarterSinTable();
+        for (size_t pos = 0; pos < count; ++pos) {
+            sl_u32 angleStep = nodes[pos].angle_z_q14;
+            x_q2[pos] = _scaleRange(nodes[pos].dist_mm_q2, _sinQ15(table, angleStep + QUARTER_ANGLE_STEPS));
+            y_q2[pos] = _scaleRange(nodes[pos].dist_mm_q2, _sinQ15(table, angleStep));
+        }
+    }
+}
@@ -0,0 +1,517 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/thread.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+
+#include "sl_lidar_group.h"
+#include "sl_lidar_cartesian.h"
+#include "sl_allocator.h"
+
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+
+namespace sl {
+
+    static const float FULL_CIRCLE_RAD = (float)(2 * 3.14159265358979323846);
+    static const float Q14_TO_RAD = FULL_CIRCLE_RAD / 65536;
+    static const float RANGE_Q2_TO_M = 1.f / 4000.f;
+
+    class LidarGroup : public ILidarGroup
+    {
+    public:
+        enum {
+            // the newest scans of each LIDAR looked into for the samples of a window
+            SCAN_DEPTH = 3,
+            // the windows of the first LIDAR waiting for the others, the oldest one is dropped beyond
+            PENDING_WINDOW_COUNT = 4,
+            IDLE_WAIT_MS = 1000,
+            MIN_VOXEL_SLOTS = 1024,
+        };
+
+        LidarGroup(const LidarGroupOptions& options)
+            : _reactor(NULL)
+            , _decodePool(NULL)
+            , _max_latency_uS((sl_u64)(options.max_latency_ms ? options.max_latency_ms : LIDAR_GROUP_DEFAULT_MAX_LATENCY_MS) * 1000)
+            , _lidar_count(0)
+            , _pending_count(0)
+            , _last_window_end_uS(0)
+            , _sequence(0)
+            , _downsampled_count(0)
+            , _bin_generation(0)
+            , _bin_scale(0)
+            , _voxel_generation(0)
+            , _listener(NULL)
+            , _isWorking(false)
+        {
+            memset(&_downsampling, 0, sizeof(_downsampling));
+            for (size_t pos = 0; pos < _countof(_lidars); ++pos) {
+                _lidars[pos].group = this;
+                _lidars[pos].index = pos;
+                _lidars[pos].driver = NULL;
+            }
+        }
+
+        virtual ~LidarGroup()
+        {
+            if (_isWorking) {
+                _isWorking = false;
+                _scan_event.set();
+                _mergeThread.join();
+            }
+
+            for (size_t pos = 0; pos < _lidar_count; ++pos) {
+                ILidarDriver* driver = _lidars[pos].driver;
+                driver->setScanListener(NULL);
+                driver->disconnect();
+                delete driver;
+            }
+            // the drivers are disconnected from the reactor and the pool by now
+            delete _decodePool;
+            delete _reactor;
+        }
+
+        sl_result init(const LidarGroupOptions& options)
+        {
+            if (options.io_thread_count > 0) {
+                Result<ILidarIOReactor*> reactor = createLidarIOReactor(options.io_thread_count, options.io_backend);
+                if (!reactor) return reactor;
+                _reactor = *reactor;
+
+                // the pool only decodes the data received by the reactor
+                if (options.decode_thread_count > 0) {
+                    Result<ILidarDecodePool*> pool = createLidarDecodePool(options.decode_thread_count);
+                    if (!pool) return pool;
+                    _decodePool = *pool;
+                }
+            }
+
+            _isWorking = true;
+            _mergeThread = CLASS_THREAD(LidarGroup, _proc_mergeThread);
+            return SL_RESULT_OK;
+        }
+
+        sl_result addLidar(IChannel* channel, const LidarPose2D& extrinsic, size_t* index)
+        {
+            if (!channel) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_add_locker);
+            if (_lidar_count >= LIDAR_GROUP_MAX_LIDARS) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            Result<ILidarDriver*> created = createLidarDriver();
+            if (!created) return created;
+            ILidarDriver* driver = *created;
+
+            if (_reactor) driver->setIOReactor(_reactor);
+            if (_decodePool) driver->setDecodePool(_decodePool);
+            sl_result ans = driver->connect(channel);
+            if (IS_FAIL(ans)) {
+                delete driver;
+                return ans;
+            }
+
+            Member& member = _lidars[_lidar_count];
+            {
+                rp::hal::AutoLocker ml(_locker);
+                member.driver = driver;
+                member.extrinsic = extrinsic;
+                for (size_t pos = 0; pos < SCAN_DEPTH; ++pos) member.scans[pos].reset();
+                ++_lidar_count;
+            }
+            driver->setScanListener(&member);
+
+            if (index) *index = member.index;
+            return SL_RESULT_OK;
+        }
+
+        size_t getLidarCount()
+        {
+            return _lidar_count;
+        }
+
+        ILidarDriver* getDriver(size_t index)
+        {
+            return index < _lidar_count ? _lidars[index].driver : NULL;
+        }
+
+        sl_result setExtrinsic(size_t index, const LidarPose2D& extrinsic)
+        {
+            if (index >= _lidar_count) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_locker);
+            _lidars[index].extrinsic = extrinsic;
+            return SL_RESULT_OK;
+        }
+
+        sl_result setMergedScanListener(ILidarGroupListener* listener)
+        {
+            // held during the callback, so that the listener can be safely replaced
+            rp::hal::AutoLocker l(_listener_locker);
+            _listener = listener;
+            return SL_RESULT_OK;
+        }
+
+        sl_result setDownsampling(const LidarGroupDownsampling& downsampling)
+        {
+            if (downsampling.angular_step_deg < 0 || downsampling.angular_step_deg > 360 || downsampling.voxel_size_m < 0) {
+                return SL_RESULT_INVALID_DATA;
+            }
+
+            rp::hal::AutoLocker l(_locker);
+            _downsampling = downsampling;
+            return SL_RESULT_OK;
+        }
+
+    protected:
+        struct Member : public IScanListener
+        {
+            virtual void onScanComplete(const LidarScanLease& scan, sl_u64 timestamp_uS)
+            {
+                group->_onScanComplete(index, scan);
+            }
+
+            LidarGroup*    group;
+            size_t         index;
+            ILidarDriver*  driver;
+            LidarPose2D    extrinsic;
+            // the newest first
+            LidarScanLease scans[SCAN_DEPTH];
+        };
+
+        // called on the decoder threads of the drivers
+        void _onScanComplete(size_t index, const LidarScanLease& scan)
+        {
+            {
+                rp::hal::AutoLocker l(_locker);
+                Member& member = _lidars[index];
+                for (size_t pos = SCAN_DEPTH - 1; pos > 0; --pos) {
+                    member.scans[pos] = std::move(member.scans[pos - 1]);
+                }
+                member.scans[0] = scan;
+
+                if (index == 0) {
+                    if (_pending_count == PENDING_WINDOW_COUNT) {
+                        std::move(_pending + 1, _pending + PENDING_WINDOW_COUNT, _pending);
+                        --_pending_count;
+                    }
+                    _pending[_pending_count++] = scan;
+                }
+            }
+            _scan_event.set();
+        }
+
+        u_result _proc_mergeThread()
+        {
+            while (_isWorking) {
+                _scan_event.wait(_mergeReadyWindows());
+            }
+            return RESULT_OK;
+        }
+
+        // merges the windows the LIDARs have all covered or waited for long enough, returns the time to wait for the next one
+        sl_u32 _mergeReadyWindows()
+        {
+            while (_isWorking) {
+                LidarScanLease window;
+                LidarScanLease scans[LIDAR_GROUP_MAX_LIDARS][SCAN_DEPTH];
+                LidarPose2D extrinsics[LIDAR_GROUP_MAX_LIDARS];
+                LidarGroupDownsampling downsampling;
+                size_t lidarCount;
+                sl_u32 completeMask = 1;
+                sl_u64 startUs;
+                {
+                    rp::hal::AutoLocker l(_locker);
+                    if (!_pending_count) return IDLE_WAIT_MS;
+
+                    window = _pending[0];
+                    lidarCount = _lidar_count;
+                    downsampling = _downsampling;
+                    for (size_t pos = 1; pos < lidarCount; ++pos) {
+                        const LidarScanLease& newest = _lidars[pos].scans[0];
+                        if (newest && newest->end_timestamp_uS >= window->end_timestamp_uS) completeMask |= (1u << pos);
+                    }
+
+                    sl_u64 deadline = window->end_timestamp_uS + _max_latency_uS;
+                    sl_u64 now = getus();
+                    if (completeMask != (1u << lidarCount) - 1 && now < deadline) {
+                        return (sl_u32)std::max<sl_u64>((deadline - now + 999) / 1000, 1);
+                    }
+
+                    std::move(_pending + 1, _pending + _pending_count, _pending);
+                    _pending[--_pending_count].reset();
+
+                    for (size_t pos = 0; pos < lidarCount; ++pos) {
+                        extrinsics[pos] = _lidars[pos].extrinsic;
+                        for (size_t depth = 0; depth < SCAN_DEPTH; ++depth) scans[pos][depth] = _lidars[pos].scans[depth];
+                    }
+
+                    // continues from the previous window unless some are missing in between
+                    startUs = window->timestamp_uS;
+                    sl_u64 duration = window->end_timestamp_uS - window->timestamp_uS;
+                    if (_last_window_end_uS && _last_window_end_uS <= startUs && startUs - _last_window_end_uS <= duration) {
+                        startUs = _last_window_end_uS;
+                    }
+                    _last_window_end_uS = window->end_timestamp_uS;
+                }
+
+                _x.clear();
+                _y.clear();
+                _timestamps.clear();
+                _quality.clear();
+                _lidar_index.clear();
+                _downsampled_count = 0;
+                _prepareAngularBins(downsampling.angular_step_deg);
+                _appendScan(*window, extrinsics[0], 0, 0, (sl_u64)-1);
+                for (size_t pos = 1; pos < lidarCount; ++pos) {
+                    _nextAngularBins();
+                    // the oldest first, so the points of each LIDAR stay in their sample order
+                    for (size_t depth = SCAN_DEPTH; depth-- > 0;) {
+                        if (scans[pos][depth]) _appendScan(*scans[pos][depth], extrinsics[pos], (sl_u8)pos, startUs, window->end_timestamp_uS);
+                    }
+                }
+                if (downsampling.voxel_size_m > 0) _filterVoxels(downsampling.voxel_size_m);
+                _publish(startUs, window->end_timestamp_uS, completeMask);
+            }
+            return IDLE_WAIT_MS;
+        }
+
+        // the points of the scan sampled within (startUs, endUs], moved into the frame of the group
+        void _appendScan(const LidarScanData& scan, const LidarPose2D& extrinsic, sl_u8 lidarIndex, sl_u64 startUs, sl_u64 endUs)
+        {
+            bool useNodes = scan.nodes && scan.timestamps_uS && scan.count;
+            size_t count = useNodes ? scan.count : scan.soa.count;
+            const sl_u64* timestamps = useNodes ? scan.timestamps_uS : scan.soa.timestamps_uS;
+            if (!count || !timestamps) return;
+            if (scan.end_timestamp_uS <= startUs || scan.timestamp_uS > endUs) return;
+
+            if (_local_x.size() < count) {
+                _local_x.resize(count);
+                _local_y.resize(count);
+            }
+            if (useNodes) {
+                convertScanToCartesian(scan.nodes, count, &_local_x[0], &_local_y[0]);
+            }
+            else {
+                convertScanToCartesian(scan.soa, &_local_x[0], &_local_y[0]);
+            }
+
+            float c = cosf(extrinsic.yaw_rad);
+            float s = sinf(extrinsic.yaw_rad);
+            for (size_t pos = 0; pos < count; ++pos) {
+                if (timestamps[pos] <= startUs || timestamps[pos] > endUs) continue;
+
+                bool hasRange = useNodes ? (scan.nodes[pos].dist_mm_q2 != 0) : (scan.soa.range_m[pos] > 0);
+                if (!hasRange) continue;
+
+                if (!_bin_range.empty()) {
+                    float range = useNodes ? scan.nodes[pos].dist_mm_q2 * RANGE_Q2_TO_M : scan.soa.range_m[pos];
+                    float angle = useNodes ? scan.nodes[pos].angle_z_q14 * Q14_TO_RAD : scan.soa.angle_rad[pos];
+                    size_t bin = std::min<size_t>((size_t)std::max((int)(angle * _bin_scale), 0), _bin_range.size() - 1);
+                    if (_bin_stamp[bin] == _bin_generation) {
+                        ++_downsampled_count;
+                        if (_bin_range[bin] <= range) continue;
+
+                        // the nearer point takes the place of the one kept so far
+                        size_t kept = _bin_point[bin];
+                        _bin_range[bin] = range;
+                        _x[kept] = extrinsic.x_m + c * _local_x[pos] - s * _local_y[pos];
+                        _y[kept] = extrinsic.y_m + s * _local_x[pos] + c * _local_y[pos];
+                        _timestamps[kept] = timestamps[pos];
+                        _quality[kept] = useNodes ? scan.nodes[pos].quality : scan.soa.quality[pos];
+                        continue;
+                    }
+                    _bin_stamp[bin] = _bin_generation;
+                    _bin_point[bin] = (sl_u32)_x.size();
+                    _bin_range[bin] = range;
+                }
+
+                _x.push_back(extrinsic.x_m + c * _local_x[pos] - s * _local_y[pos]);
+                _y.push_back(extrinsic.y_m + s * _local_x[pos] + c * _local_y[pos]);
+                _timestamps.push_back(timestamps[pos]);
+                _quality.push_back(useNodes ? scan.nodes[pos].quality : scan.soa.quality[pos]);
+                _lidar_index.push_back(lidarIndex);
+            }
+        }
+
+        // sizes the angle bins of the LIDARs for the window, none without the angular downsampling
+        void _prepareAngularBins(float stepDeg)
+        {
+            size_t binCount = stepDeg > 0 ? (size_t)ceilf(360.f / stepDeg) : 0;
+            if (binCount != _bin_range.size()) {
+                _bin_range.assign(binCount, 0);
+                _bin_point.assign(binCount, 0);
+                _bin_stamp.assign(binCount, 0);
+                _bin_generation = 0;
+            }
+            _bin_scale = binCount ? (float)(binCount / FULL_CIRCLE_RAD) : 0;
+            _nextAngularBins();
+        }
+
+        // empties the bins for the next LIDAR, the generation stamps spare clearing them
+        void _nextAngularBins()
+        {
+            if (++_bin_generation == 0) {
+                std::fill(_bin_stamp.begin(), _bin_stamp.end(), 0);
+                _bin_generation = 1;
+            }
+        }
+
+        // keeps the first point of each voxel, the hash grid of the voxels taken is reused across the windows
+        void _filterVoxels(float voxelSize)
+        {
+            size_t count = _x.size();
+            size_t capacity = MIN_VOXEL_SLOTS;
+            while (capacity < count * 2) capacity <<= 1;
+            if (_voxels.size() < capacity) {
+                VoxelSlot empty = { 0, 0 };
+                _voxels.assign(capacity, empty);
+                _voxel_generation = 0;
+            }
+            if (++_voxel_generation == 0) {
+                for (size_t pos = 0; pos < _voxels.size(); ++pos) _voxels[pos].generation = 0;
+                _voxel_generation = 1;
+            }
+
+            const size_t mask = _voxels.size() - 1;
+            const float scale = 1.f / voxelSize;
+            size_t kept = 0;
+            for (size_t pos = 0; pos < count; ++pos) {
+                sl_u32 cellX = (sl_u32)(sl_s32)floorf(_x[pos] * scale);
+                sl_u32 cellY = (sl_u32)(sl_s32)floorf(_y[pos] * scale);
+                sl_u64 key = ((sl_u64)cellX << 32) | cellY;
+
+                // linear probing from a Fibonacci hash of the cell
+                size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+                while (_voxels[slot].generation == _voxel_generation && _voxels[slot].key != key) slot = (slot + 1) & mask;
+                if (_voxels[slot].generation == _voxel_generation) continue;
+                _voxels[slot].key = key;
+                _voxels[slot].generation = _voxel_generation;
+
+                _x[kept] = _x[pos];
+                _y[kept] = _y[pos];
+                _timestamps[kept] = _timestamps[pos];
+                _quality[kept] = _quality[pos];
+                _lidar_index[kept] = _lidar_index[pos];
+                ++kept;
+            }
+
+            _downsampled_count += count - kept;
+            _x.resize(kept);
+            _y.resize(kept);
+            _timestamps.resize(kept);
+            _quality.resize(kept);
+            _lidar_index.resize(kept);
+        }
+
+        void _publish(sl_u64 startUs, sl_u64 endUs, sl_u32 completeMask)
+        {
+            size_t count = _x.size();
+            LidarMergedScan scan;
+            scan.x_m = count ? &_x[0] : NULL;
+            scan.y_m = count ? &_y[0] : NULL;
+            scan.timestamps_uS = count ? &_timestamps[0] : NULL;
+            scan.quality = count ? &_quality[0] : NULL;
+            scan.lidar_index = count ? &_lidar_index[0] : NULL;
+            scan.count = count;
+            scan.downsampled_count = _downsampled_count;
+            scan.start_uS = startUs;
+            scan.end_uS = endUs;
+            scan.sequence = _sequence++;
+            scan.complete_mask = completeMask;
+
+            rp::hal::AutoLocker l(_listener_locker);
+            if (_listener) _listener->onMergedScan(scan);
+        }
+
+        ILidarIOReactor*    _reactor;
+        ILidarDecodePool*   _decodePool;
+        sl_u64              _max_latency_uS;
+
+        rp::hal::Locker     _add_locker;    // serializes addLidar, which connects outside of _locker
+        rp::hal::Locker     _locker;        // guards the members, their scans and the pending windows
+        Member              _lidars[LIDAR_GROUP_MAX_LIDARS];
+        std::atomic<size_t> _lidar_count;
+        LidarScanLease      _pending[PENDING_WINDOW_COUNT];
+        size_t              _pending_count;
+        sl_u64              _last_window_end_uS;
+        LidarGroupDownsampling _downsampling;
+
+        // owned by the merging thread
+        sl_u64                         _sequence;
+        internal::sdk_vector<float>    _local_x;
+        internal::sdk_vector<float>    _local_y;
+        internal::sdk_vector<float>    _x;
+        internal::sdk_vector<float>    _y;
+        internal::sdk_vector<sl_u64>   _timestamps;
+        internal::sdk_vector<sl_u8>    _quality;
+        internal::sdk_vector<sl_u8>    _lidar_index;
+        size_t                         _downsampled_count;
+
+        struct VoxelSlot
+        {
+            sl_u64 key;         // the cell x in the high half, y in the low one
+            sl_u32 generation;  // the slot is taken in the window of this generation
+        };
+
+        // the angle bins of the LIDAR being appended: the point kept and its range
+        internal::sdk_vector<float>    _bin_range;
+        internal::sdk_vector<sl_u32>   _bin_point;
+        internal::sdk_vector<sl_u32>   _bin_stamp;
+        sl_u32                         _bin_generation;
+        float                          _bin_scale;
+        internal::sdk_vector<VoxelSlot> _voxels;
+        sl_u32                         _voxel_generation;
+
+        rp::hal::Locker      _listener_locker;
+        ILidarGroupListener* _listener;
+
+        rp::hal::Thread      _mergeThread;
+        rp::hal::Event       _scan_event;
+        std::atomic<bool>    _isWorking;
+    };
+
+    Result<ILidarGroup*> createLidarGroup(const LidarGroupOptions& options)
+    {
+        LidarGroup* group = new LidarGroup(options);
+        sl_result ans = group->init(options);
+        if (IS_FAIL(ans)) {
+            delete group;
+            return ans;
+        }
+        return (ILidarGroup*)group;
+    }
+}
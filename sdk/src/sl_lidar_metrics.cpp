@@ -0,0 +1,699 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/thread.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "hal/socket.h"
+
+#include "sl_lidar_metrics.h"
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace sl {
+
+    namespace internal {
+
+        enum {
+            METRICS_HTTP_WAIT_MS = 200,         // the poll of the endpoint for its shutdown, where the waits cannot be canceled
+            METRICS_IO_TIMEOUT_MS = 1000,       // to read a request and to send an exposition
+            METRICS_HTTP_MAX_REQUEST_SIZE = 4096,
+        };
+
+        enum MetricsCounter
+        {
+            METRICS_COUNTER_RX_BYTES = 0,
+            METRICS_COUNTER_MESSAGES,
+            METRICS_COUNTER_DECODER_SKIPPED_BYTES,
+            METRICS_COUNTER_DECODER_RESETS,
+            METRICS_COUNTER_RX_QUEUE_OVERFLOWS,
+            METRICS_COUNTER_RX_QUEUE_OVERFLOW_BYTES,
+            METRICS_COUNTER_REVOLUTIONS,
+            METRICS_COUNTER_SCANS_DROPPED,
+            METRICS_COUNTER_SAMPLES_DROPPED,
+            METRICS_COUNTER_SCAN_OVERFLOWS,
+            METRICS_COUNTER_BLOCKED,
+            METRICS_COUNTER_BLOCK_TIMEOUTS,
+            METRICS_COUNTER_PACED_DELIVERED,
+            METRICS_COUNTER_PACED_DROPPED,
+            METRICS_COUNTER_PACED_UNDERRUNS,
+            METRICS_COUNTER_RECOVERIES,
+            METRICS_COUNTER_RECOVERY_FAILURES,
+            METRICS_COUNTER_RECOVERY_ATTEMPTS,
+            METRICS_COUNTER_RECOVERY_DOWNTIME,
+            METRICS_COUNTER_STALLS,
+            METRICS_COUNTER_COUNT,
+        };
+
+        enum MetricsGauge
+        {
+            METRICS_GAUGE_CONNECTED = 0,
+            METRICS_GAUGE_RX_BYTES_PER_SECOND,
+            METRICS_GAUGE_RX_QUEUE_CAPACITY,
+            METRICS_GAUGE_RX_QUEUE_PENDING,
+            METRICS_GAUGE_RX_QUEUE_HIGH_WATER,
+            METRICS_GAUGE_SCAN_FREQUENCY,
+            METRICS_GAUGE_SCAN_PERIOD,
+            METRICS_GAUGE_SCAN_JITTER,
+            METRICS_GAUGE_PACED_PERIOD,
+            METRICS_GAUGE_COUNT,
+        };
+
+        enum MetricsSampleCounter
+        {
+            METRICS_SAMPLE_PACKETS = 0,
+            METRICS_SAMPLE_CHECKSUM_ERRORS,
+            METRICS_SAMPLE_ENCODER_RESETS,
+            METRICS_SAMPLE_RESYNCS,
+            METRICS_SAMPLE_SKIPPED_BYTES,
+            METRICS_SAMPLE_CAPSULE_DISCARDS,
+            METRICS_SAMPLE_REGION_SKIPS,
+            METRICS_SAMPLE_COUNTER_COUNT,
+        };
+
+        struct MetricsFamily
+        {
+            const char* name;
+            const char* help;
+            // the counters kept in microseconds are exported in seconds
+            bool        microseconds;
+        };
+
+        static const MetricsFamily COUNTER_FAMILIES[METRICS_COUNTER_COUNT] = {
+            { "slamtec_lidar_rx_bytes", "Bytes received from the device and fed into the protocol decoder", false },
+            { "slamtec_lidar_decoded_messages", "Answer messages decoded", false },
+            { "slamtec_lidar_decoder_skipped_bytes", "Bytes dropped while hunting for an answer header", false },
+            { "slamtec_lidar_decoder_resets", "Resets of the protocol decoder", false },
+            { "slamtec_lidar_rx_queue_overflows", "Times the received data was dropped with the rx queue full", false },
+            { "slamtec_lidar_rx_queue_overflow_bytes", "Received bytes dropped with the rx queue full", false },
+            { "slamtec_lidar_scan_revolutions", "Revolutions measured since the scan was started", false },
+            { "slamtec_lidar_scans_dropped", "Complete scans never grabbed, replaced or discarded by the backpressure policy", false },
+            { "slamtec_lidar_samples_dropped", "Samples of the interval stream never read", false },
+            { "slamtec_lidar_scan_overflows", "Nodes beyond the capacity of a scan", false },
+            { "slamtec_lidar_backpressure_blocked_seconds", "Time the decoder and the rx threads waited for the consumers", true },
+            { "slamtec_lidar_backpressure_block_timeouts", "Waits for the consumers cut by the block timeout", false },
+            { "slamtec_lidar_paced_scans_delivered", "Scans delivered by the paced delivery", false },
+            { "slamtec_lidar_paced_scans_dropped", "Scans dropped by the jitter buffer of the paced delivery", false },
+            { "slamtec_lidar_paced_underruns", "Times the jitter buffer of the paced delivery ran empty", false },
+            { "slamtec_lidar_recoveries", "Channel failures reconnected by the auto recovery", false },
+            { "slamtec_lidar_recovery_failures", "Recoveries given up or stopped before reconnecting", false },
+            { "slamtec_lidar_recovery_attempts", "Reconnect attempts of the auto recovery", false },
+            { "slamtec_lidar_recovery_downtime_seconds", "Time from the channel failures to the end of their recovery", true },
+            { "slamtec_lidar_stream_stalls", "Stalls of the sample stream detected by the watchdog", false },
+        };
+
+        static const MetricsFamily GAUGE_FAMILIES[METRICS_GAUGE_COUNT] = {
+            { "slamtec_lidar_connected", "1 while the driver is connected to the device", false },
+            { "slamtec_lidar_rx_bytes_per_second", "Bytes received per second since the previous scrape", false },
+            { "slamtec_lidar_rx_queue_capacity_bytes", "Capacity of the rx queue", false },
+            { "slamtec_lidar_rx_queue_pending_bytes", "Received bytes waiting for the decoder", false },
+            { "slamtec_lidar_rx_queue_high_water_bytes", "Most received bytes waiting for the decoder since the channel was opened", false },
+            { "slamtec_lidar_scan_frequency_hertz", "Smoothed scan frequency, 0 until the first revolution", false },
+            { "slamtec_lidar_scan_period_seconds", "Smoothed revolution period", true },
+            { "slamtec_lidar_scan_period_jitter_seconds", "Smoothed standard deviation of the revolution periods", true },
+            { "slamtec_lidar_paced_delivery_period_seconds", "Delivery period of the paced delivery", true },
+        };
+
+        static const MetricsFamily SAMPLE_COUNTER_FAMILIES[METRICS_SAMPLE_COUNTER_COUNT] = {
+            { "slamtec_lidar_sample_packets", "Sample packets passing the checksum", false },
+            { "slamtec_lidar_checksum_errors", "Sample packets dropped for a bad checksum", false },
+            { "slamtec_lidar_encoder_resets", "Unexpected starts of a new scan within a capsule stream", false },
+            { "slamtec_lidar_sample_resyncs", "Broken sample packet headers", false },
+            { "slamtec_lidar_sample_skipped_bytes", "Bytes dropped while hunting for a sample packet header", false },
+            { "slamtec_lidar_capsule_discards", "Cached capsules dropped before their nodes were decoded", false },
+            { "slamtec_lidar_region_skips", "Sample packets not decoded as they are out of the scan region", false },
+        };
+
+        static const char* const LATENCY_STAGE_NAMES[LIDAR_LATENCY_STAGE_COUNT] = {
+            "rx_read", "rx_queue", "codec_decode", "unpacker_decode", "scan_publish", "consumer_grab",
+        };
+
+        // the counters of one device read by a scrape
+        struct MetricsSnapshot
+        {
+            sl_u64  counters[METRICS_COUNTER_COUNT];
+            double  gauges[METRICS_GAUGE_COUNT];
+            size_t  sample_type_count;
+            sl_u8   sample_types[LIDAR_DECODE_STATS_MAX_SAMPLE_TYPES];
+            sl_u64  sample_counters[LIDAR_DECODE_STATS_MAX_SAMPLE_TYPES][METRICS_SAMPLE_COUNTER_COUNT];
+            bool    has_latency[LIDAR_LATENCY_STAGE_COUNT];
+            LidarLatencyStats latency[LIDAR_LATENCY_STAGE_COUNT];
+            LidarLatencyStats paced_latency;
+        };
+
+        struct MetricsDevice
+        {
+            ILidarDriver*   driver;
+            std::string     label;          // the device label, escaped
+            sl_u64          last_rx_bytes;  // at the previous scrape
+            sl_u64          last_scrape_uS;
+            MetricsSnapshot snapshot;
+        };
+
+        // backslash, double quote and line feed are escaped in the label values
+        static void _escapeLabelValue(const char* value, std::string& escaped)
+        {
+            escaped.clear();
+            for (; *value; ++value) {
+                switch (*value) {
+                case '\\':
+                    escaped += "\\\\";
+                    break;
+                case '"':
+                    escaped += "\\\"";
+                    break;
+                case '\n':
+                    escaped += "\\n";
+                    break;
+                default:
+                    escaped += *value;
+                }
+            }
+        }
+
+        static void _appendFamily(std::string& out, const char* name, const char* type, const char* help)
+        {
+            out += "# TYPE ";
+            out += name;
+            out += ' ';
+            out += type;
+            out += "\n# HELP ";
+            out += name;
+            out += ' ';
+            out += help;
+            out += '\n';
+        }
+
+        // the labels, if any, follow the device label and must begin with a comma
+        static void _appendSample(std::string& out, const char* name, const char* suffix, const MetricsDevice& device, const char* labels, const char* value)
+        {
+            out += name;
+            out += suffix;
+            out += "{device=\"";
+            out += device.label;
+            out += '"';
+            if (labels) out += labels;
+            out += "} ";
+            out += value;
+            out += '\n';
+        }
+
+        static const char* _formatCounter(char* buffer, size_t size, sl_u64 value, bool microseconds)
+        {
+            if (microseconds) {
+                snprintf(buffer, size, "%llu.%06u", (unsigned long long)(value / 1000000), (unsigned)(value % 1000000));
+            }
+            else {
+                snprintf(buffer, size, "%llu", (unsigned long long)value);
+            }
+            return buffer;
+        }
+
+        static const char* _formatGauge(char* buffer, size_t size, double value)
+        {
+            snprintf(buffer, size, "%.9g", value);
+            return buffer;
+        }
+
+        static void _appendSummary(std::string& out, const char* name, const MetricsDevice& device, const char* stage, const LidarLatencyStats& stats)
+        {
+            static const char* const QUANTILES[] = { "0.5", "0.9", "0.99", "0.999" };
+            const sl_u64 values_uS[] = { stats.p50_uS, stats.p90_uS, stats.p99_uS, stats.p999_uS };
+
+            char stageLabel[48] = "";
+            if (stage) snprintf(stageLabel, sizeof(stageLabel), ",stage=\"%s\"", stage);
+
+            char labels[80];
+            char value[32];
+            for (size_t pos = 0; pos < _countof(QUANTILES); ++pos) {
+                snprintf(labels, sizeof(labels), "%s,quantile=\"%s\"", stageLabel, QUANTILES[pos]);
+                _appendSample(out, name, "", device, labels, _formatCounter(value, sizeof(value), values_uS[pos], true));
+            }
+            _appendSample(out, name, "_sum", device, stageLabel, _formatCounter(value, sizeof(value), stats.sum_uS, true));
+            _appendSample(out, name, "_count", device, stageLabel, _formatCounter(value, sizeof(value), stats.count, false));
+        }
+
+    }
+
+    using namespace internal;
+
+    class LidarMetricsExporter : public ILidarMetricsExporter
+    {
+    public:
+        LidarMetricsExporter()
+            : _isWorking(false)
+            , _listener(NULL)
+            , _isHttpWorking(false)
+            , _isPushWorking(false)
+            , _pushPeriodMs(0)
+        {
+            memset(&_stats, 0, sizeof(_stats));
+        }
+
+        virtual ~LidarMetricsExporter()
+        {
+            _isWorking = false;
+            if (_isHttpWorking) {
+                _listener->cancelWaits();
+                _httpThread.join();
+            }
+            if (_isPushWorking) {
+                _pushEvt.set();
+                _pushThread.join();
+            }
+            if (_listener) _listener->dispose();
+        }
+
+        sl_result init(const LidarMetricsExporterOptions& options)
+        {
+            if (options.http_port < 0 || options.http_port > 0xFFFF) return SL_RESULT_INVALID_DATA;
+
+            if (options.push_socket_path) {
+#if defined(_WIN32)
+                return SL_RESULT_OPERATION_NOT_SUPPORT;
+#else
+                if (!*options.push_socket_path || strlen(options.push_socket_path) >= sizeof(((sockaddr_un*)0)->sun_path)) return SL_RESULT_INVALID_DATA;
+                _pushSocketPath = options.push_socket_path;
+                _pushPeriodMs = options.push_period_ms ? options.push_period_ms : LIDAR_METRICS_DEFAULT_PUSH_PERIOD_MS;
+#endif
+            }
+
+            if (options.http_address) {
+                bool isIPv6 = strchr(options.http_address, ':') != NULL;
+                rp::net::SocketAddress address;
+                if (IS_FAIL(address.setAddressFromString(options.http_address, isIPv6 ? rp::net::SocketAddress::ADDRESS_TYPE_INET6 : rp::net::SocketAddress::ADDRESS_TYPE_INET))) {
+                    return SL_RESULT_INVALID_DATA;
+                }
+                address.setPort(options.http_port ? options.http_port : LIDAR_METRICS_DEFAULT_HTTP_PORT);
+
+                _listener = rp::net::StreamSocket::CreateSocket(isIPv6 ? rp::net::SocketBase::SOCKET_FAMILY_INET6 : rp::net::SocketBase::SOCKET_FAMILY_INET);
+                if (!_listener) return SL_RESULT_OPERATION_FAIL;
+                if (IS_FAIL(_listener->bind(address)) || IS_FAIL(_listener->listen())) return SL_RESULT_OPERATION_FAIL;
+            }
+
+            _isWorking = true;
+            if (_listener) {
+                _isHttpWorking = true;
+                _httpThread = CLASS_THREAD(LidarMetricsExporter, _proc_httpThread);
+            }
+            if (_pushPeriodMs) {
+                _isPushWorking = true;
+                _pushThread = CLASS_THREAD(LidarMetricsExporter, _proc_pushThread);
+            }
+            return SL_RESULT_OK;
+        }
+
+        sl_result addDevice(ILidarDriver* driver, const char* device)
+        {
+            if (!driver || !device) return SL_RESULT_INVALID_DATA;
+
+            MetricsDevice entry;
+            entry.driver = driver;
+            _escapeLabelValue(device, entry.label);
+
+            rp::hal::AutoLocker l(_locker);
+            if (_devices.size() >= LIDAR_METRICS_MAX_DEVICES) return SL_RESULT_INSUFFICIENT_MEMORY;
+            for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                if (_devices[pos].driver == driver || _devices[pos].label == entry.label) return SL_RESULT_INVALID_DATA;
+            }
+
+            // the first rate is taken since the device was added
+            LidarDecodeStats decodeStats;
+            entry.last_rx_bytes = SL_IS_OK(driver->getDecodeStats(decodeStats)) ? decodeStats.rx_bytes : 0;
+            entry.last_scrape_uS = getus();
+            _devices.push_back(entry);
+            return SL_RESULT_OK;
+        }
+
+        sl_result removeDevice(ILidarDriver* driver)
+        {
+            rp::hal::AutoLocker l(_locker);
+            for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                if (_devices[pos].driver == driver) {
+                    _devices.erase(_devices.begin() + pos);
+                    return SL_RESULT_OK;
+                }
+            }
+            return SL_RESULT_INVALID_DATA;
+        }
+
+        sl_result render(std::string& exposition)
+        {
+            rp::hal::AutoLocker l(_locker);
+            _render(exposition);
+            return SL_RESULT_OK;
+        }
+
+        void getStats(LidarMetricsExporterStats& stats)
+        {
+            rp::hal::AutoLocker l(_locker);
+            stats = _stats;
+        }
+
+    private:
+        // called with _locker held, the snapshots of all the devices are read before the first family is rendered
+        void _render(std::string& out)
+        {
+            out.clear();
+            for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                _takeSnapshot(_devices[pos]);
+            }
+
+            char value[32];
+            for (size_t family = 0; family < METRICS_GAUGE_COUNT; ++family) {
+                _appendFamily(out, GAUGE_FAMILIES[family].name, "gauge", GAUGE_FAMILIES[family].help);
+                for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                    double gauge = _devices[pos].snapshot.gauges[family];
+                    if (GAUGE_FAMILIES[family].microseconds) gauge /= 1000000;
+                    _appendSample(out, GAUGE_FAMILIES[family].name, "", _devices[pos], NULL, _formatGauge(value, sizeof(value), gauge));
+                }
+            }
+
+            for (size_t family = 0; family < METRICS_COUNTER_COUNT; ++family) {
+                const MetricsFamily& desc = COUNTER_FAMILIES[family];
+                _appendFamily(out, desc.name, "counter", desc.help);
+                for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                    _appendSample(out, desc.name, "_total", _devices[pos], NULL, _formatCounter(value, sizeof(value), _devices[pos].snapshot.counters[family], desc.microseconds));
+                }
+            }
+
+            char labels[32];
+            for (size_t family = 0; family < METRICS_SAMPLE_COUNTER_COUNT; ++family) {
+                const MetricsFamily& desc = SAMPLE_COUNTER_FAMILIES[family];
+                _appendFamily(out, desc.name, "counter", desc.help);
+                for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                    const MetricsSnapshot& snapshot = _devices[pos].snapshot;
+                    for (size_t type = 0; type < snapshot.sample_type_count; ++type) {
+                        snprintf(labels, sizeof(labels), ",ans_type=\"0x%02X\"", snapshot.sample_types[type]);
+                        _appendSample(out, desc.name, "_total", _devices[pos], labels, _formatCounter(value, sizeof(value), snapshot.sample_counters[type][family], false));
+                    }
+                }
+            }
+
+            _appendFamily(out, "slamtec_lidar_latency_seconds", "summary", "Latency of the stages of the receive pipeline");
+            for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                for (size_t stage = 0; stage < LIDAR_LATENCY_STAGE_COUNT; ++stage) {
+                    if (_devices[pos].snapshot.has_latency[stage]) {
+                        _appendSummary(out, "slamtec_lidar_latency_seconds", _devices[pos], LATENCY_STAGE_NAMES[stage], _devices[pos].snapshot.latency[stage]);
+                    }
+                }
+            }
+
+            _appendFamily(out, "slamtec_lidar_paced_delivery_latency_seconds", "summary", "Latency added by the jitter buffer of the paced delivery");
+            for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                _appendSummary(out, "slamtec_lidar_paced_delivery_latency_seconds", _devices[pos], NULL, _devices[pos].snapshot.paced_latency);
+            }
+
+            out += "# EOF\n";
+            ++_stats.scrapes;
+        }
+
+        void _takeSnapshot(MetricsDevice& device)
+        {
+            MetricsSnapshot& snapshot = device.snapshot;
+            memset(&snapshot, 0, sizeof(snapshot));
+            ILidarDriver* driver = device.driver;
+
+            LidarDecodeStats decode;
+            if (SL_IS_OK(driver->getDecodeStats(decode))) {
+                snapshot.counters[METRICS_COUNTER_RX_BYTES] = decode.rx_bytes;
+                snapshot.counters[METRICS_COUNTER_MESSAGES] = decode.messages;
+                snapshot.counters[METRICS_COUNTER_DECODER_SKIPPED_BYTES] = decode.skipped_bytes;
+                snapshot.counters[METRICS_COUNTER_DECODER_RESETS] = decode.decoder_resets;
+
+                snapshot.sample_type_count = std::min<size_t>(decode.sample_type_count, LIDAR_DECODE_STATS_MAX_SAMPLE_TYPES);
+                for (size_t type = 0; type < snapshot.sample_type_count; ++type) {
+                    const LidarSampleDecodeStats& sample = decode.samples[type];
+                    sl_u64* counters = snapshot.sample_counters[type];
+                    snapshot.sample_types[type] = sample.ans_type;
+                    counters[METRICS_SAMPLE_PACKETS] = sample.packets;
+                    counters[METRICS_SAMPLE_CHECKSUM_ERRORS] = sample.checksum_errors;
+                    counters[METRICS_SAMPLE_ENCODER_RESETS] = sample.encoder_resets;
+                    counters[METRICS_SAMPLE_RESYNCS] = sample.resyncs;
+                    counters[METRICS_SAMPLE_SKIPPED_BYTES] = sample.skipped_bytes;
+                    counters[METRICS_SAMPLE_CAPSULE_DISCARDS] = sample.capsule_discards;
+                    counters[METRICS_SAMPLE_REGION_SKIPS] = sample.region_skips;
+                }
+
+                sl_u64 now_uS = getus();
+                if (now_uS > device.last_scrape_uS && decode.rx_bytes >= device.last_rx_bytes) {
+                    snapshot.gauges[METRICS_GAUGE_RX_BYTES_PER_SECOND] = (decode.rx_bytes - device.last_rx_bytes) * 1000000.0 / (now_uS - device.last_scrape_uS);
+                }
+                device.last_rx_bytes = decode.rx_bytes;
+                device.last_scrape_uS = now_uS;
+            }
+
+            LidarRxQueueStats rxQueue;
+            if (SL_IS_OK(driver->getRxQueueStats(rxQueue))) {
+                snapshot.counters[METRICS_COUNTER_RX_QUEUE_OVERFLOWS] = rxQueue.overflow_count;
+                snapshot.counters[METRICS_COUNTER_RX_QUEUE_OVERFLOW_BYTES] = rxQueue.overflow_bytes;
+                snapshot.gauges[METRICS_GAUGE_RX_QUEUE_CAPACITY] = (double)rxQueue.capacity;
+                snapshot.gauges[METRICS_GAUGE_RX_QUEUE_PENDING] = (double)rxQueue.pending_bytes;
+                snapshot.gauges[METRICS_GAUGE_RX_QUEUE_HIGH_WATER] = (double)rxQueue.high_water_bytes;
+            }
+
+            LidarScanRateStats scanRate;
+            if (SL_IS_OK(driver->getScanRateStats(scanRate))) {
+                snapshot.counters[METRICS_COUNTER_REVOLUTIONS] = scanRate.revolutions;
+                snapshot.gauges[METRICS_GAUGE_SCAN_FREQUENCY] = scanRate.frequency_hz;
+                snapshot.gauges[METRICS_GAUGE_SCAN_PERIOD] = scanRate.period_uS;
+                snapshot.gauges[METRICS_GAUGE_SCAN_JITTER] = scanRate.jitter_uS;
+            }
+
+            LidarBackpressureStats backpressure;
+            if (SL_IS_OK(driver->getBackpressureStats(backpressure))) {
+                snapshot.counters[METRICS_COUNTER_SCANS_DROPPED] = backpressure.scans_dropped;
+                snapshot.counters[METRICS_COUNTER_SAMPLES_DROPPED] = backpressure.samples_dropped;
+                snapshot.counters[METRICS_COUNTER_BLOCKED] = backpressure.blocked_uS;
+                snapshot.counters[METRICS_COUNTER_BLOCK_TIMEOUTS] = backpressure.block_timeouts;
+            }
+            snapshot.counters[METRICS_COUNTER_SCAN_OVERFLOWS] = driver->getScanOverflowCount();
+
+            LidarPacedDeliveryStats paced;
+            if (SL_IS_OK(driver->getPacedDeliveryStats(paced))) {
+                snapshot.counters[METRICS_COUNTER_PACED_DELIVERED] = paced.delivered;
+                snapshot.counters[METRICS_COUNTER_PACED_DROPPED] = paced.dropped;
+                snapshot.counters[METRICS_COUNTER_PACED_UNDERRUNS] = paced.underruns;
+                snapshot.gauges[METRICS_GAUGE_PACED_PERIOD] = paced.period_uS;
+                snapshot.paced_latency = paced.latency;
+            }
+
+            LidarRecoveryStats recovery;
+            if (SL_IS_OK(driver->getRecoveryStats(recovery))) {
+                snapshot.counters[METRICS_COUNTER_RECOVERIES] = recovery.recoveries;
+                snapshot.counters[METRICS_COUNTER_RECOVERY_FAILURES] = recovery.failures;
+                snapshot.counters[METRICS_COUNTER_RECOVERY_ATTEMPTS] = recovery.attempts;
+                snapshot.counters[METRICS_COUNTER_RECOVERY_DOWNTIME] = recovery.downtime_uS;
+                snapshot.counters[METRICS_COUNTER_STALLS] = recovery.stalls;
+            }
+
+            // not supported without SL_LIDAR_LATENCY_PROFILING
+            for (size_t stage = 0; stage < LIDAR_LATENCY_STAGE_COUNT; ++stage) {
+                snapshot.has_latency[stage] = SL_IS_OK(driver->getLatencyStats((LidarLatencyStage)stage, snapshot.latency[stage]));
+            }
+
+            snapshot.gauges[METRICS_GAUGE_CONNECTED] = driver->isConnected() ? 1 : 0;
+        }
+
+        u_result _proc_httpThread()
+        {
+            rp::hal::Thread::config_t config;
+            memset(&config, 0, sizeof(config));
+            rp::hal::Thread::SetSelfConfig(config, "sl_metrics_http", rp::hal::Thread::PRIORITY_NORMAL);
+
+            std::vector<char> request(METRICS_HTTP_MAX_REQUEST_SIZE + 1);
+            std::string exposition;
+            while (_isWorking) {
+                if (IS_FAIL(_listener->waitforIncomingConnection(METRICS_HTTP_WAIT_MS))) continue;
+                rp::net::StreamSocket* client = _listener->accept();
+                if (!client) continue;
+
+                bool served = _serveHttp(client, request, exposition);
+                client->dispose();
+
+                rp::hal::AutoLocker l(_locker);
+                ++_stats.http_requests;
+                if (!served) ++_stats.http_errors;
+            }
+            return RESULT_OK;
+        }
+
+        // answers a single request and closes the connection, true if the exposition was sent
+        bool _serveHttp(rp::net::StreamSocket* client, std::vector<char>& request, std::string& exposition)
+        {
+            client->setTimeout(METRICS_IO_TIMEOUT_MS);
+
+            // the request line and the headers, the request body of the other methods is not read
+            size_t size = 0;
+            request[0] = 0;
+            while (size < METRICS_HTTP_MAX_REQUEST_SIZE && !strstr(&request[0], "\r\n\r\n")) {
+                size_t received = 0;
+                if (IS_FAIL(client->recv(&request[size], METRICS_HTTP_MAX_REQUEST_SIZE - size, received)) || !received) return false;
+                size += received;
+                request[size] = 0;
+            }
+
+            const char* status = "200 OK";
+            bool isGet = strncmp(&request[0], "GET ", 4) == 0;
+            if (!isGet) {
+                status = "405 Method Not Allowed";
+            }
+            else {
+                const char* path = &request[4];
+                size_t pathSize = strcspn(path, " ?\r\n");
+                if (!((pathSize == 8 && strncmp(path, "/metrics", 8) == 0) || (pathSize == 1 && path[0] == '/'))) status = "404 Not Found";
+            }
+
+            bool isServed = strcmp(status, "200 OK") == 0;
+            if (isServed) {
+                rp::hal::AutoLocker l(_locker);
+                _render(exposition);
+            }
+            else {
+                exposition.clear();
+            }
+
+            char header[256];
+            int headerSize = snprintf(header, sizeof(header),
+                "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+                status, isServed ? "application/openmetrics-text; version=1.0.0; charset=utf-8" : "text/plain", (unsigned)exposition.size());
+            if (IS_FAIL(client->send(header, headerSize))) return false;
+            if (!exposition.empty() && IS_FAIL(client->send(exposition.data(), exposition.size()))) return false;
+            client->shutdown(rp::net::SocketBase::SOCKET_DIR_WR);
+            return isServed;
+        }
+
+        u_result _proc_pushThread()
+        {
+            rp::hal::Thread::config_t config;
+            memset(&config, 0, sizeof(config));
+            rp::hal::Thread::SetSelfConfig(config, "sl_metrics_push", rp::hal::Thread::PRIORITY_NORMAL);
+
+            std::string exposition;
+            while (_isWorking) {
+                _pushEvt.wait(_pushPeriodMs);
+                if (!_isWorking) break;
+
+                {
+                    rp::hal::AutoLocker l(_locker);
+                    _render(exposition);
+                }
+                bool pushed = _push(exposition);
+
+                rp::hal::AutoLocker l(_locker);
+                ++_stats.pushes;
+                if (!pushed) ++_stats.push_errors;
+            }
+            return RESULT_OK;
+        }
+
+        // a new connection per push, the agent reads the exposition up to the end of the stream
+        bool _push(const std::string& exposition)
+        {
+#if defined(_WIN32)
+            return false;
+#else
+            int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0) return false;
+
+            timeval tv;
+            tv.tv_sec = METRICS_IO_TIMEOUT_MS / 1000;
+            tv.tv_usec = (METRICS_IO_TIMEOUT_MS % 1000) * 1000;
+            ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+#if defined(SO_NOSIGPIPE)
+            int bool_true = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &bool_true, sizeof(bool_true));
+#endif
+
+            sockaddr_un address;
+            memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            strncpy(address.sun_path, _pushSocketPath.c_str(), sizeof(address.sun_path) - 1);
+
+            bool isPushed = ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+            for (size_t sent = 0; isPushed && sent < exposition.size(); ) {
+#if defined(MSG_NOSIGNAL)
+                ssize_t ans = ::send(fd, exposition.data() + sent, exposition.size() - sent, MSG_NOSIGNAL);
+#else
+                ssize_t ans = ::send(fd, exposition.data() + sent, exposition.size() - sent, 0);
+#endif
+                if (ans <= 0) isPushed = false;
+                else sent += (size_t)ans;
+            }
+            ::close(fd);
+            return isPushed;
+#endif
+        }
+
+        // guards the devices, their snapshots and the stats
+        rp::hal::Locker             _locker;
+        std::vector<MetricsDevice>  _devices;
+        LidarMetricsExporterStats   _stats;
+
+        volatile bool               _isWorking;
+        rp::net::StreamSocket*      _listener;
+        rp::hal::Thread             _httpThread;
+        bool                        _isHttpWorking;
+        rp::hal::Thread             _pushThread;
+        rp::hal::Event              _pushEvt;
+        bool                        _isPushWorking;
+        std::string                 _pushSocketPath;
+        sl_u32                      _pushPeriodMs;
+    };
+
+    Result<ILidarMetricsExporter*> createLidarMetricsExporter(const LidarMetricsExporterOptions& options)
+    {
+        LidarMetricsExporter* exporter = new LidarMetricsExporter();
+        sl_result ans = exporter->init(options);
+        if (IS_FAIL(ans)) {
+            delete exporter;
+            return ans;
+        }
+        return (ILidarMetricsExporter*)exporter;
+    }
+}
@@ -0,0 +1,224 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sl_lidar_node_convert.h"
+#include "hal/cpu_features.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SL_NODE_CONVERT_X86_SSSE3
+#define SL_NODE_CONVERT_SSSE3_TARGET __attribute__((target("ssse3")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#define SL_NODE_CONVERT_X86_SSSE3
+#define SL_NODE_CONVERT_SSSE3_TARGET
+#endif
+
+namespace sl {
+
+    static void _convertNodesToLegacyGeneric(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_lidar_response_measurement_node_t* legacyNodes)
+    {
+        for (size_t pos = 0; pos < count; ++pos) {
+            const sl_lidar_response_measurement_node_hq_t& from = nodes[pos];
+            sl_lidar_response_measurement_node_t& to = legacyNodes[pos];
+            to.sync_quality = (from.flag & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT) | ((from.quality >> SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT);
+            to.angle_q6_checkbit = 1 | (((from.angle_z_q14 * 90) >> 8) << SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT);
+            to.distance_q2 = from.dist_mm_q2 > sl_u16(-1) ? sl_u16(0) : sl_u16(from.dist_mm_q2);
+        }
+    }
+
+    static void _convertNodesFromLegacyGeneric(const sl_lidar_response_measurement_node_t* legacyNodes, size_t count, sl_lidar_response_measurement_node_hq_t* nodes)
+    {
+        for (size_t pos = 0; pos < count; ++pos) {
+            const sl_lidar_response_measurement_node_t& from = legacyNodes[pos];
+            sl_lidar_response_measurement_node_hq_t& to = nodes[pos];
+            to.angle_z_q14 = (((from.angle_q6_checkbit) >> SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) << 8) / 90;
+            to.dist_mm_q2 = from.distance_q2;
+            to.flag = (from.sync_quality & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT);
+            to.quality = (from.sync_quality >> SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT;
+        }
+    }
+
+#if defined(SL_NODE_CONVERT_X86_SSSE3)
+
+    // 8 nodes per round. An HQ node is four 16 bit words: the angle, the two halves of the distance,
+    // and the quality with the flag, so that a 4x8 transpose of the words splits the fields into their own vectors.
+    // The 5 bytes legacy nodes are packed from and split into the field vectors by byte shuffles.
+    SL_NODE_CONVERT_SSSE3_TARGET static void _convertNodesToLegacySsse3(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_lidar_response_measurement_node_t* legacyNodes)
+    {
+        // the output bytes taken from the quality, the angle and the distance vectors
+        const __m128i qualityShuffle0 = _mm_setr_epi8(0, -1, -1, -1, -1, 1, -1, -1, -1, -1, 2, -1, -1, -1, -1, 3);
+        const __m128i qualityShuffle1 = _mm_setr_epi8(-1, -1, -1, -1, 4, -1, -1, -1, -1, 5, -1, -1, -1, -1, 6, -1);
+        const __m128i qualityShuffle2 = _mm_setr_epi8(-1, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i angleShuffle0 = _mm_setr_epi8(-1, 0, 1, -1, -1, -1, 2, 3, -1, -1, -1, 4, 5, -1, -1, -1);
+        const __m128i angleShuffle1 = _mm_setr_epi8(6, 7, -1, -1, -1, 8, 9, -1, -1, -1, 10, 11, -1, -1, -1, 12);
+        const __m128i angleShuffle2 = _mm_setr_epi8(13, -1, -1, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i distShuffle0 = _mm_setr_epi8(-1, -1, -1, 0, 1, -1, -1, -1, 2, 3, -1, -1, -1, 4, 5, -1);
+        const __m128i distShuffle1 = _mm_setr_epi8(-1, -1, 6, 7, -1, -1, -1, 8, 9, -1, -1, -1, 10, 11, -1, -1);
+        const __m128i distShuffle2 = _mm_setr_epi8(-1, 12, 13, -1, -1, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i qualityMask = _mm_set1_epi16(0xFC);
+        const __m128i syncMask = _mm_set1_epi16(SL_LIDAR_RESP_MEASUREMENT_SYNCBIT);
+        const __m128i checkBit = _mm_set1_epi16(1);
+        // (angle_z_q14 * 90) >> 8 as the high half of angle_z_q14 * 90 * 256
+        const __m128i angleScale = _mm_set1_epi16(90 * 256);
+
+        size_t pos = 0;
+        for (; pos + 8 <= count; pos += 8) {
+            const __m128i* in = reinterpret_cast<const __m128i*>(nodes + pos);
+            __m128i v0 = _mm_loadu_si128(in);
+            __m128i v1 = _mm_loadu_si128(in + 1);
+            __m128i v2 = _mm_loadu_si128(in + 2);
+            __m128i v3 = _mm_loadu_si128(in + 3);
+
+            __m128i t0 = _mm_unpacklo_epi16(v0, v1);
+            __m128i t1 = _mm_unpackhi_epi16(v0, v1);
+            __m128i t2 = _mm_unpacklo_epi16(v2, v3);
+            __m128i t3 = _mm_unpackhi_epi16(v2, v3);
+            __m128i u0 = _mm_unpacklo_epi16(t0, t1);
+            __m128i u1 = _mm_unpackhi_epi16(t0, t1);
+            __m128i u2 = _mm_unpacklo_epi16(t2, t3);
+            __m128i u3 = _mm_unpackhi_epi16(t2, t3);
+            __m128i angle = _mm_unpacklo_epi64(u0, u2);
+            __m128i distLow = _mm_unpackhi_epi64(u0, u2);
+            __m128i distHigh = _mm_unpacklo_epi64(u1, u3);
+            __m128i qualityFlag = _mm_unpackhi_epi64(u1, u3);
+
+            __m128i syncQuality = _mm_or_si128(_mm_and_si128(qualityFlag, qualityMask), _mm_and_si128(_mm_srli_epi16(qualityFlag, 8), syncMask));
+            syncQuality = _mm_packus_epi16(syncQuality, zero);
+            __m128i angleQ6 = _mm_or_si128(_mm_slli_epi16(_mm_mulhi_epu16(angle, angleScale), SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT), checkBit);
+            __m128i dist = _mm_and_si128(distLow, _mm_cmpeq_epi16(distHigh, zero));
+
+            __m128i out0 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(syncQuality, qualityShuffle0), _mm_shuffle_epi8(angleQ6, angleShuffle0)), _mm_shuffle_epi8(dist, distShuffle0));
+            __m128i out1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(syncQuality, qualityShuffle1), _mm_shuffle_epi8(angleQ6, angleShuffle1)), _mm_shuffle_epi8(dist, distShuffle1));
+            __m128i out2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(syncQuality, qualityShuffle2), _mm_shuffle_epi8(angleQ6, angleShuffle2)), _mm_shuffle_epi8(dist, distShuffle2));
+
+            __m128i* out = reinterpret_cast<__m128i*>(legacyNodes + pos);
+            _mm_storeu_si128(out, out0);
+            _mm_storeu_si128(out + 1, out1);
+            _mm_storel_epi64(out + 2, out2);
+        }
+        _convertNodesToLegacyGeneric(nodes + pos, count - pos, legacyNodes + pos);
+    }
+
+    // The angle_q6 * 256 / 90 division is done in float, it is exact as the dividend is below 2^23
+    // and the quotient is at least 1/90 away from the next integer whenever it is not an integer.
+    SL_NODE_CONVERT_SSSE3_TARGET static void _convertNodesFromLegacySsse3(const sl_lidar_response_measurement_node_t* legacyNodes, size_t count, sl_lidar_response_measurement_node_hq_t* nodes)
+    {
+        // the bytes of each field taken from the three input vectors, into 16 bit lanes
+        const __m128i qualityShuffle0 = _mm_setr_epi8(0, -1, 5, -1, 10, -1, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i qualityShuffle1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 4, -1, 9, -1, 14, -1, -1, -1);
+        const __m128i qualityShuffle2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 3, -1);
+        const __m128i angleShuffle0 = _mm_setr_epi8(1, 2, 6, 7, 11, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i angleShuffle1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 0, 1, 5, 6, 10, 11, 15, -1, -1, -1);
+        const __m128i angleShuffle2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 4, 5);
+        const __m128i distShuffle0 = _mm_setr_epi8(3, 4, 8, 9, 13, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i distShuffle1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 3, 7, 8, 12, 13, -1, -1, -1, -1);
+        const __m128i distShuffle2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 2, 6, 7);
+
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i qualityMask = _mm_set1_epi16(0xFC);
+        const __m128i syncMask = _mm_set1_epi16(SL_LIDAR_RESP_MEASUREMENT_SYNCBIT);
+        const __m128 divisor = _mm_set1_ps(90.f);
+
+        size_t pos = 0;
+        for (; pos + 8 <= count; pos += 8) {
+            const __m128i* in = reinterpret_cast<const __m128i*>(legacyNodes + pos);
+            __m128i l0 = _mm_loadu_si128(in);
+            __m128i l1 = _mm_loadu_si128(in + 1);
+            __m128i l2 = _mm_loadl_epi64(in + 2);
+
+            __m128i syncQuality = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(l0, qualityShuffle0), _mm_shuffle_epi8(l1, qualityShuffle1)), _mm_shuffle_epi8(l2, qualityShuffle2));
+            __m128i angleQ6 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(l0, angleShuffle0), _mm_shuffle_epi8(l1, angleShuffle1)), _mm_shuffle_epi8(l2, angleShuffle2));
+            __m128i dist = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(l0, distShuffle0), _mm_shuffle_epi8(l1, distShuffle1)), _mm_shuffle_epi8(l2, distShuffle2));
+
+            __m128i qualityFlag = _mm_or_si128(_mm_and_si128(syncQuality, qualityMask), _mm_slli_epi16(_mm_and_si128(syncQuality, syncMask), 8));
+
+            angleQ6 = _mm_srli_epi16(angleQ6, SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT);
+            __m128i angleLow = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(_mm_slli_epi32(_mm_unpacklo_epi16(angleQ6, zero), 8)), divisor));
+            __m128i angleHigh = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(_mm_slli_epi32(_mm_unpackhi_epi16(angleQ6, zero), 8)), divisor));
+            // truncated to 16 bits like the assignment to angle_z_q14
+            angleLow = _mm_srai_epi32(_mm_slli_epi32(angleLow, 16), 16);
+            angleHigh = _mm_srai_epi32(_mm_slli_epi32(angleHigh, 16), 16);
+            __m128i angle = _mm_packs_epi32(angleLow, angleHigh);
+
+            __m128i a = _mm_unpacklo_epi16(angle, dist);
+            __m128i b = _mm_unpackhi_epi16(angle, dist);
+            __m128i c = _mm_unpacklo_epi16(zero, qualityFlag);
+            __m128i d = _mm_unpackhi_epi16(zero, qualityFlag);
+
+            __m128i* out = reinterpret_cast<__m128i*>(nodes + pos);
+            _mm_storeu_si128(out, _mm_unpacklo_epi32(a, c));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi32(a, c));
+            _mm_storeu_si128(out + 2, _mm_unpacklo_epi32(b, d));
+            _mm_storeu_si128(out + 3, _mm_unpackhi_epi32(b, d));
+        }
+        _convertNodesFromLegacyGeneric(legacyNodes + pos, count - pos, nodes + pos);
+    }
+
+#endif
+
+    typedef void (*convert_to_legacy_proc_t)(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_lidar_response_measurement_node_t* legacyNodes);
+    typedef void (*convert_from_legacy_proc_t)(const sl_lidar_response_measurement_node_t* legacyNodes, size_t count, sl_lidar_response_measurement_node_hq_t* nodes);
+
+    static std::atomic<convert_to_legacy_proc_t> _convertToLegacyProc(_convertNodesToLegacyGeneric);
+    static std::atomic<convert_from_legacy_proc_t> _convertFromLegacyProc(_convertNodesFromLegacyGeneric);
+
+    static void _bindConvertProcs(sl_u32 features)
+    {
+        convert_to_legacy_proc_t toLegacy = _convertNodesToLegacyGeneric;
+        convert_from_legacy_proc_t fromLegacy = _convertNodesFromLegacyGeneric;
+#if defined(SL_NODE_CONVERT_X86_SSSE3)
+        if (rp::hal::hasCpuFeatures(features, rp::hal::CPU_FEATURE_SSSE3)) {
+            toLegacy = _convertNodesToLegacySsse3;
+            fromLegacy = _convertNodesFromLegacySsse3;
+        }
+#endif
+        _convertToLegacyProc.store(toLegacy, std::memory_order_relaxed);
+        _convertFromLegacyProc.store(fromLegacy, std::memory_order_relaxed);
+    }
+
+    static rp::hal::CpuKernelBinding _convertBinding(_bindConvertProcs);
+
+    void convertNodesToLegacy(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_lidar_response_measurement_node_t* legacyNodes)
+    {
+        _convertToLegacyProc.load(std::memory_order_relaxed)(nodes, count, legacyNodes);
+    }
+
+    void convertNodesFromLegacy(const sl_lidar_response_measurement_node_t* legacyNodes, size_t count, sl_lidar_response_measurement_node_hq_t* nodes)
+    {
+        _convertFromLegacyProc.load(std::memory_order_relaxed)(legacyNodes, count, nodes);
+    }
+}
@@ -0,0 +1,193 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "sl_lidar_occupancy_grid.h"
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+namespace sl {
+
+    namespace internal {
+
+        enum {
+            GRID_ANGLE_STEP_BITS = 16,  // the q14 angle of the nodes covers the circle in 65536 steps
+            GRID_MIN_BIN_BITS = 8,
+        };
+
+        static const double GRID_FULL_CIRCLE_RAD = 2 * 3.14159265358979323846;
+        static const float GRID_RANGE_Q2_TO_M = 1.f / 4000.f;
+        static const float GRID_RAD_TO_ANGLE_STEP = (float)((1 << GRID_ANGLE_STEP_BITS) / GRID_FULL_CIRCLE_RAD);
+
+        class LidarOccupancyGrid : public ILidarOccupancyGrid
+        {
+        public:
+            LidarOccupancyGrid(const LidarOccupancyGridSpec& spec)
+                : _spec(spec)
+                , _cells(spec.width * spec.height, 0)
+                , _maxRange_m(0)
+                , _binShift(0)
+            {
+            }
+
+            // the ray tables, for rays up to maxRange_m
+            void buildRays(float maxRange_m)
+            {
+                _maxRange_m = maxRange_m;
+
+                // only the part of the rays within the grid is kept, up to its farthest corner
+                float farX = std::max(_spec.lidar_x_m, _spec.width * _spec.resolution_m - _spec.lidar_x_m);
+                float farY = std::max(_spec.lidar_y_m, _spec.height * _spec.resolution_m - _spec.lidar_y_m);
+                float rangeCells = std::min(maxRange_m, sqrtf(farX * farX + farY * farY)) / _spec.resolution_m;
+
+                // enough bins for the neighbour rays to be less than a cell apart at the end of the longest one
+                int binBits = GRID_MIN_BIN_BITS;
+                while (binBits < GRID_ANGLE_STEP_BITS && (float)(1 << binBits) < (float)GRID_FULL_CIRCLE_RAD * rangeCells) ++binBits;
+                size_t binCount = (size_t)1 << binBits;
+                _binShift = GRID_ANGLE_STEP_BITS - binBits;
+
+                const float originX = _spec.lidar_x_m / _spec.resolution_m;
+                const float originY = _spec.lidar_y_m / _spec.resolution_m;
+                _rayStart.assign(binCount + 1, 0);
+                _stepsPerMeter.assign(binCount, 0);
+                _rayCells.clear();
+                for (size_t bin = 0; bin < binCount; ++bin) {
+                    double angle = (bin + 0.5) * GRID_FULL_CIRCLE_RAD / binCount;
+                    float dirX = (float)cos(angle), dirY = (float)sin(angle);
+                    float major = std::max(fabsf(dirX), fabsf(dirY));
+
+                    // one cell per step along the major axis
+                    _rayStart[bin] = _rayCells.size();
+                    _stepsPerMeter[bin] = major / _spec.resolution_m;
+                    size_t lastStep = (size_t)(rangeCells * major);
+                    for (size_t step = 0; step <= lastStep; ++step) {
+                        float cellX = floorf(originX + dirX * step / major);
+                        float cellY = floorf(originY + dirY * step / major);
+                        if (cellX < 0 || cellY < 0 || cellX >= (float)_spec.width || cellY >= (float)_spec.height) break;
+                        _rayCells.push_back((sl_u32)cellY * (sl_u32)_spec.width + (sl_u32)cellX);
+                    }
+                }
+                _rayStart[binCount] = _rayCells.size();
+            }
+
+            virtual const LidarOccupancyGridSpec& getSpec() const
+            {
+                return _spec;
+            }
+
+            virtual const sl_s8* getCells() const
+            {
+                return &_cells[0];
+            }
+
+            virtual void clear()
+            {
+                std::fill(_cells.begin(), _cells.end(), 0);
+            }
+
+            virtual void integrate(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count)
+            {
+                for (size_t pos = 0; pos < count; ++pos) {
+                    if (!nodes[pos].dist_mm_q2) continue;
+                    _castRay(nodes[pos].angle_z_q14, nodes[pos].dist_mm_q2 * GRID_RANGE_Q2_TO_M);
+                }
+            }
+
+            virtual void integrate(const LidarScanSoA& scan)
+            {
+                for (size_t pos = 0; pos < scan.count; ++pos) {
+                    if (scan.range_m[pos] <= 0) continue;
+                    sl_u32 angleStep = (sl_u32)(int)floorf(scan.angle_rad[pos] * GRID_RAD_TO_ANGLE_STEP + 0.5f);
+                    _castRay(angleStep & ((1 << GRID_ANGLE_STEP_BITS) - 1), scan.range_m[pos]);
+                }
+            }
+
+            virtual void integrate(const LidarScanSector& sector)
+            {
+                integrate(sector.nodes, sector.count);
+            }
+
+        private:
+            void _castRay(sl_u32 angleStep, float range_m)
+            {
+                size_t bin = angleStep >> _binShift;
+                const sl_u32* ray = &_rayCells[0] + _rayStart[bin];
+                size_t rayLength = _rayStart[bin + 1] - _rayStart[bin];
+
+                // the hit is dropped when it is out of the grid or beyond the max range, the ray is then free all along
+                size_t hitStep = range_m > _maxRange_m ? rayLength : (size_t)(range_m * _stepsPerMeter[bin]);
+                size_t freeSteps = std::min(hitStep, rayLength);
+
+                const int missWeight = _spec.miss_weight;
+                for (size_t step = 0; step < freeSteps; ++step) {
+                    sl_s8& cell = _cells[ray[step]];
+                    cell = (sl_s8)std::max((int)cell - missWeight, -(int)LIDAR_GRID_CELL_LIMIT);
+                }
+                if (hitStep < rayLength) {
+                    sl_s8& cell = _cells[ray[hitStep]];
+                    cell = (sl_s8)std::min((int)cell + _spec.hit_weight, (int)LIDAR_GRID_CELL_LIMIT);
+                }
+            }
+
+            LidarOccupancyGridSpec _spec;
+            std::vector<sl_s8> _cells;
+
+            // the cells of the ray of each angle bin, from the LIDAR cell outwards
+            std::vector<sl_u32> _rayCells;
+            std::vector<size_t> _rayStart;
+            std::vector<float>  _stepsPerMeter;
+            float _maxRange_m;
+            int _binShift;
+        };
+    }
+
+    using namespace internal;
+
+    Result<ILidarOccupancyGrid*> createLidarOccupancyGrid(const LidarOccupancyGridSpec& spec, const LidarScanMode& mode)
+    {
+        if (!spec.width || !spec.height || spec.resolution_m <= 0) return SL_RESULT_INVALID_DATA;
+        if (spec.lidar_x_m < 0 || spec.lidar_y_m < 0
+            || spec.lidar_x_m >= spec.width * spec.resolution_m || spec.lidar_y_m >= spec.height * spec.resolution_m) {
+            return SL_RESULT_INVALID_DATA;
+        }
+
+        float maxRange_m = spec.max_range_m > 0 ? spec.max_range_m : mode.max_distance;
+        if (maxRange_m <= 0) return SL_RESULT_INVALID_DATA;
+
+        LidarOccupancyGrid* grid = new LidarOccupancyGrid(spec);
+        grid->buildRays(maxRange_m);
+        return grid;
+    }
+}
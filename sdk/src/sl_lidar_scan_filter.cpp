@@ -0,0 +1,223 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+
+#include "sl_lidar_scan_filter.h"
+#include "sl_lidar_fixed.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+namespace sl {
+
+    enum {
+        // the samples filtered side by side by the median, the loops over them are left to the vectorizer
+        MEDIAN_LANES = 8,
+    };
+
+    // the filters run on float ranges in meter or on the integer q2 ranges of the fixed-point path
+
+    static inline float _rangeDiff(float a, float b)
+    {
+        return fabsf(a - b);
+    }
+
+    static inline sl_u32 _rangeDiff(sl_u32 a, sl_u32 b)
+    {
+        return a > b ? a - b : b - a;
+    }
+
+    // each drop filter decides from the input ranges, then moves the sample down; the writes never pass the reads
+    template <class TRange>
+    static size_t _dropInvalid(TRange* range_m, sl_u8* quality, sl_u32* index, size_t count)
+    {
+        size_t kept = 0;
+        for (size_t pos = 0; pos < count; ++pos) {
+            size_t keep = (range_m[pos] > 0) & (quality[pos] != 0);
+            range_m[kept] = range_m[pos];
+            quality[kept] = quality[pos];
+            index[kept] = index[pos];
+            kept += keep;
+        }
+        return kept;
+    }
+
+    template <class TRange>
+    static size_t _dropOutOfRange(TRange minRange, TRange maxRange, TRange* range_m, sl_u8* quality, sl_u32* index, size_t count)
+    {
+        size_t kept = 0;
+        for (size_t pos = 0; pos < count; ++pos) {
+            size_t keep = (range_m[pos] >= minRange) & (range_m[pos] <= maxRange);
+            range_m[kept] = range_m[pos];
+            quality[kept] = quality[pos];
+            index[kept] = index[pos];
+            kept += keep;
+        }
+        return kept;
+    }
+
+    template <class TRange>
+    static size_t _dropOutliers(TRange maxDeviation, TRange* range_m, sl_u8* quality, sl_u32* index, size_t count)
+    {
+        if (count < 3) return count;
+
+        // both ends are read before they can be overwritten
+        const TRange first = range_m[0];
+        TRange prev = range_m[count - 1];
+        size_t kept = 0;
+        for (size_t pos = 0; pos < count; ++pos) {
+            TRange range = range_m[pos];
+            TRange next = (pos + 1 < count) ? range_m[pos + 1] : first;
+            size_t keep = (_rangeDiff(range, prev) <= maxDeviation) | (_rangeDiff(range, next) <= maxDeviation);
+            prev = range;
+            range_m[kept] = range;
+            quality[kept] = quality[pos];
+            index[kept] = index[pos];
+            kept += keep;
+        }
+        return kept;
+    }
+
+    // the window of each lane is sorted by an odd-even transposition network, the same compare and swap for all the lanes
+    template <class TRange>
+    static void _medianLanes(const TRange* src, size_t window, TRange* out)
+    {
+        TRange v[LIDAR_SCAN_FILTER_MAX_WINDOW][MEDIAN_LANES];
+        for (size_t row = 0; row < window; ++row) {
+            for (size_t lane = 0; lane < MEDIAN_LANES; ++lane) {
+                v[row][lane] = src[lane + row];
+            }
+        }
+
+        for (size_t round = 0; round < window; ++round) {
+            for (size_t row = round & 1; row + 1 < window; row += 2) {
+                for (size_t lane = 0; lane < MEDIAN_LANES; ++lane) {
+                    TRange lo = std::min(v[row][lane], v[row + 1][lane]);
+                    TRange hi = std::max(v[row][lane], v[row + 1][lane]);
+                    v[row][lane] = lo;
+                    v[row + 1][lane] = hi;
+                }
+            }
+        }
+
+        for (size_t lane = 0; lane < MEDIAN_LANES; ++lane) {
+            out[lane] = v[window / 2][lane];
+        }
+    }
+
+    template <class TRange>
+    static void _medianRanges(size_t window, TRange* range_m, size_t count, TRange* scratch)
+    {
+        if (count < window) return;
+
+        // the samples at both ends see the ones at the other end
+        const size_t half = window / 2;
+        memcpy(scratch, range_m + count - half, half * sizeof(TRange));
+        memcpy(scratch + half, range_m, count * sizeof(TRange));
+        memcpy(scratch + half + count, range_m, half * sizeof(TRange));
+
+        size_t pos = 0;
+        for (; pos + MEDIAN_LANES <= count; pos += MEDIAN_LANES) {
+            _medianLanes(scratch + pos, window, range_m + pos);
+        }
+
+        TRange tail[LIDAR_SCAN_FILTER_MAX_WINDOW];
+        for (; pos < count; ++pos) {
+            std::copy(scratch + pos, scratch + pos + window, tail);
+            std::nth_element(tail, tail + half, tail + window);
+            range_m[pos] = tail[half];
+        }
+    }
+
+    size_t filterScan(const LidarScanFilter* filters, size_t filterCount, float* range_m, sl_u8* quality, sl_u32* index,
+        size_t count, float* scratch)
+    {
+        for (size_t pos = 0; pos < count; ++pos) {
+            index[pos] = (sl_u32)pos;
+        }
+
+        for (size_t pos = 0; pos < filterCount && count; ++pos) {
+            const LidarScanFilter& filter = filters[pos];
+            switch (filter.type) {
+            case LIDAR_SCAN_FILTER_DROP_INVALID:
+                count = _dropInvalid(range_m, quality, index, count);
+                break;
+            case LIDAR_SCAN_FILTER_RANGE_LIMIT:
+                count = _dropOutOfRange(filter.min_range_m, filter.max_range_m, range_m, quality, index, count);
+                break;
+            case LIDAR_SCAN_FILTER_MEDIAN:
+                if (filter.window >= 3 && filter.window <= LIDAR_SCAN_FILTER_MAX_WINDOW && (filter.window & 1)) {
+                    _medianRanges(filter.window, range_m, count, scratch);
+                }
+                break;
+            case LIDAR_SCAN_FILTER_OUTLIER:
+                count = _dropOutliers(filter.max_deviation_m, range_m, quality, index, count);
+                break;
+            default:
+                break;
+            }
+        }
+        return count;
+    }
+
+    size_t filterScanFixed(const LidarScanFilterFixed* filters, size_t filterCount, sl_u32* range_q2, sl_u8* quality, sl_u32* index,
+        size_t count, sl_u32* scratch)
+    {
+        for (size_t pos = 0; pos < count; ++pos) {
+            index[pos] = (sl_u32)pos;
+        }
+
+        for (size_t pos = 0; pos < filterCount && count; ++pos) {
+            const LidarScanFilterFixed& filter = filters[pos];
+            switch (filter.type) {
+            case LIDAR_SCAN_FILTER_DROP_INVALID:
+                count = _dropInvalid(range_q2, quality, index, count);
+                break;
+            case LIDAR_SCAN_FILTER_RANGE_LIMIT:
+                count = _dropOutOfRange(filter.min_range_q2, filter.max_range_q2, range_q2, quality, index, count);
+                break;
+            case LIDAR_SCAN_FILTER_MEDIAN:
+                if (filter.window >= 3 && filter.window <= LIDAR_SCAN_FILTER_MAX_WINDOW && (filter.window & 1)) {
+                    _medianRanges(filter.window, range_q2, count, scratch);
+                }
+                break;
+            case LIDAR_SCAN_FILTER_OUTLIER:
+                count = _dropOutliers(filter.max_deviation_q2, range_q2, quality, index, count);
+                break;
+            default:
+                break;
+            }
+        }
+        return count;
+    }
+}
@@ -0,0 +1,2314 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "sl_lidar_driver.h"
+#include "sl_lidar_cartesian.h"
+#include "sl_lidar_scan_filter.h"
+#include "hal/trace.h"
+#include "hal/cache_line.h"
+#include "hal/realtime.h"
+#include "sl_allocator.h"
+#ifdef SL_LIDAR_LATENCY_PROFILING
+#include "sl_latency_histogram.h"
+#endif
+
+// Scan assembly helpers shared by the driver and the sdk benchmarks.
+// Users must include sdkcommon.h, hal/assert.h, hal/locker.h, hal/event.h and hal/notifier.h first.
+
+namespace sl {
+
+    static inline float getAngle(const sl_lidar_response_measurement_node_t& node)
+    {
+        return (node.angle_q6_checkbit >> SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) / 64.f;
+    }
+
+    static inline void setAngle(sl_lidar_response_measurement_node_t& node, float v)
+    {
+        sl_u16 checkbit = node.angle_q6_checkbit & SL_LIDAR_RESP_MEASUREMENT_CHECKBIT;
+        node.angle_q6_checkbit = (((sl_u16)(v * 64.0f)) << SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) | checkbit;
+    }
+
+    static inline float getAngle(const sl_lidar_response_measurement_node_hq_t& node)
+    {
+        return node.angle_z_q14 * 90.f / 16384.f;
+    }
+
+    static inline void setAngle(sl_lidar_response_measurement_node_hq_t& node, float v)
+    {
+        node.angle_z_q14 = sl_u32(v * 16384.f / 90.f);
+    }
+
+    static inline sl_u16 getDistanceQ2(const sl_lidar_response_measurement_node_t& node)
+    {
+        return node.distance_q2;
+    }
+
+    static inline sl_u32 getDistanceQ2(const sl_lidar_response_measurement_node_hq_t& node)
+    {
+        return node.dist_mm_q2;
+    }
+   
+    template <class TNode>
+    static bool angleLessThan(const TNode& a, const TNode& b)
+    {
+        return getAngle(a) < getAngle(b);
+    }
+
+    // the raw fixed-point angle, it orders the nodes as getAngle() does
+    static inline sl_u16 getAngleKey(const sl_lidar_response_measurement_node_t& node)
+    {
+        return node.angle_q6_checkbit >> SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT;
+    }
+
+    static inline sl_u16 getAngleKey(const sl_lidar_response_measurement_node_hq_t& node)
+    {
+        return node.angle_z_q14;
+    }
+
+    // Linear time sort on the integer angle.
+    // A revolution is in order except at the wrap point, which only needs a rotation,
+    // anything else falls back to a stable two pass radix sort.
+    template <class TNode>
+    static void sortScanNodesByAngle_(TNode * nodebuffer, size_t count)
+    {
+        size_t descents = 0;
+        size_t wrapPos = 0;
+        for (size_t i = 1; i < count; i++) {
+            if (getAngleKey(nodebuffer[i]) < getAngleKey(nodebuffer[i - 1])) {
+                ++descents;
+                wrapPos = i;
+            }
+        }
+
+        if (descents == 0) return;
+
+        if (descents == 1 && getAngleKey(nodebuffer[count - 1]) <= getAngleKey(nodebuffer[0])) {
+            std::rotate(nodebuffer, nodebuffer + wrapPos, nodebuffer + count);
+            return;
+        }
+
+        size_t histogram[2][256];
+        memset(histogram, 0, sizeof(histogram));
+        for (size_t i = 0; i < count; i++) {
+            sl_u16 key = getAngleKey(nodebuffer[i]);
+            ++histogram[0][key & 0xFF];
+            ++histogram[1][key >> 8];
+        }
+
+        for (int pass = 0; pass < 2; pass++) {
+            size_t offset = 0;
+            for (int bucket = 0; bucket < 256; bucket++) {
+                size_t bucketSize = histogram[pass][bucket];
+                histogram[pass][bucket] = offset;
+                offset += bucketSize;
+            }
+        }
+
+        internal::sdk_vector<TNode> scratch(count);
+        for (size_t i = 0; i < count; i++) {
+            scratch[histogram[0][getAngleKey(nodebuffer[i]) & 0xFF]++] = nodebuffer[i];
+        }
+        for (size_t i = 0; i < count; i++) {
+            nodebuffer[histogram[1][getAngleKey(scratch[i]) >> 8]++] = scratch[i];
+        }
+    }
+
+    // The order of the keys in ascending order, stable, by the same steps as sortScanNodesByAngle_
+    // false if they are in order already; scratch holds count entries as well.
+    static bool sortOrderByAngleKey_(const sl_u16* keys, size_t count, sl_u32* order, sl_u32* scratch)
+    {
+        size_t descents = 0;
+        size_t wrapPos = 0;
+        for (size_t i = 1; i < count; i++) {
+            if (keys[i] < keys[i - 1]) {
+                ++descents;
+                wrapPos = i;
+            }
+        }
+
+        if (descents == 0) return false;
+
+        if (descents == 1 && keys[count - 1] <= keys[0]) {
+            for (size_t i = 0; i < count; i++) {
+                order[i] = (sl_u32)((wrapPos + i) % count);
+            }
+            return true;
+        }
+
+        size_t histogram[2][256];
+        memset(histogram, 0, sizeof(histogram));
+        for (size_t i = 0; i < count; i++) {
+            ++histogram[0][keys[i] & 0xFF];
+            ++histogram[1][keys[i] >> 8];
+        }
+
+        for (int pass = 0; pass < 2; pass++) {
+            size_t offset = 0;
+            for (int bucket = 0; bucket < 256; bucket++) {
+                size_t bucketSize = histogram[pass][bucket];
+                histogram[pass][bucket] = offset;
+                offset += bucketSize;
+            }
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            scratch[histogram[0][keys[i] & 0xFF]++] = (sl_u32)i;
+        }
+        for (size_t i = 0; i < count; i++) {
+            order[histogram[1][keys[scratch[i]] >> 8]++] = scratch[i];
+        }
+        return true;
+    }
+
+    // The first half of ascendScanData: the nodes without distance get the angles their position in the scan gives them
+    // false if all the data is invalid
+    template < class TNode >
+    static bool fixScanAngles_(TNode * nodebuffer, size_t count)
+    {
+        float inc_origin_angle = 360.f / count;
+        size_t i = 0;
+
+        //Tune head
+        for (i = 0; i < count; i++) {
+            if (getDistanceQ2(nodebuffer[i]) == 0) {
+                continue;
+            }
+            else {
+                while (i != 0) {
+                    i--;
+                    float expect_angle = getAngle(nodebuffer[i + 1]) - inc_origin_angle;
+                    if (expect_angle < 0.0f) expect_angle = 0.0f;
+                    setAngle(nodebuffer[i], expect_angle);
+                }
+                break;
+            }
+        }
+
+        // all the data is invalid
+        if (i == count) return false;
+
+        //Tune tail
+        for (i = count - 1; i < count; i--) {
+            // To avoid array overruns, use the i < count condition
+            if (getDistanceQ2(nodebuffer[i]) == 0) {
+                continue;
+            }
+            else {
+                while (i != (count - 1)) {
+                    i++;
+                    float expect_angle = getAngle(nodebuffer[i - 1]) + inc_origin_angle;
+                    if (expect_angle > 360.0f) expect_angle -= 360.0f;
+                    setAngle(nodebuffer[i], expect_angle);
+                }
+                break;
+            }
+        }
+
+        //Fill invalid angle in the scan
+        float frontAngle = getAngle(nodebuffer[0]);
+        for (i = 1; i < count; i++) {
+            if (getDistanceQ2(nodebuffer[i]) == 0) {
+                float expect_angle = frontAngle + i * inc_origin_angle;
+                if (expect_angle > 360.0f) expect_angle -= 360.0f;
+                setAngle(nodebuffer[i], expect_angle);
+            }
+        }
+        return true;
+    }
+
+    template < class TNode >
+    static sl_result ascendScanData_(TNode * nodebuffer, size_t count)
+    {
+        if (!fixScanAngles_(nodebuffer, count)) return SL_RESULT_OPERATION_FAIL;
+
+        // Reorder the scan according to the angle value
+        sortScanNodesByAngle_(nodebuffer, count);
+
+        return SL_RESULT_OK;
+    }
+
+    // Fixed capacity ring of the raw sample nodes and their timestamps
+    // By default the oldest samples are overwritten when the consumer falls behind, they are counted as dropped.
+    // Besides the consumer fetching the samples out of the ring, the readers of a LidarSampleCursor each read every sample
+    // in place: the positions of the stream keep counting across the wraps, a reader compares its own with them.
+    template<typename T>
+    class RawSampleNodeHolder
+    {
+    public:
+        RawSampleNodeHolder(size_t maxcount = 8192)
+            : _capacity(0)
+            , _locker(false, true)
+            , _write_pos(0)
+            , _read_pos(0)
+            , _epoch_pos(0)
+            , _dropped_count(0)
+            , _policy(LIDAR_BACKPRESSURE_DROP_OLDEST)
+            , _max_block_ms(0)
+            , _blocked_uS(0)
+            , _block_timeouts(0)
+        {
+            setCapacity(maxcount);
+        }
+
+        // the samples not fetched yet are dropped if the capacity changes, 0 releases the ring and drops the samples pushed
+        void setCapacity(size_t maxcount)
+        {
+            // power of 2 to wrap the positions with a mask
+            size_t capacity = maxcount ? 1 : 0;
+            while (capacity < maxcount) capacity <<= 1;
+
+            rp::hal::AutoLocker l(_locker);
+            if (capacity == _capacity) return;
+
+            _data_waiter.set(false);
+            _capacity = capacity;
+            internal::sdk_vector<T>(_capacity).swap(_nodes);
+            internal::sdk_vector<_u64>(_capacity).swap(_timestamps);
+            _read_pos = _write_pos;
+            // the samples before are gone with the former ring
+            _epoch_pos = _write_pos;
+        }
+
+        void clear()
+        {
+            rp::hal::AutoLocker l(_locker);
+            _data_waiter.set(false);
+            _read_pos = _write_pos;
+            _space_waiter.set();
+        }
+
+        void pushNode(_u64 timestamp_uS, const T* node)
+        {
+            pushNodes(&timestamp_uS, node, 1);
+        }
+
+        void setBackpressurePolicy(LidarBackpressurePolicy policy, _u32 maxBlockMs)
+        {
+            _max_block_ms.store(maxBlockMs, std::memory_order_relaxed);
+            _policy.store(policy, std::memory_order_release);
+            _space_waiter.set();
+        }
+
+        LidarBackpressurePolicy getBackpressurePolicy() const {
+            return (LidarBackpressurePolicy)_policy.load(std::memory_order_acquire);
+        }
+
+        void pushNodes(const _u64* timestamps_uS, const T* nodes, size_t count)
+        {
+            int policy = _policy.load(std::memory_order_acquire);
+            if (policy == LIDAR_BACKPRESSURE_BLOCK) _waitForRoom(count);
+
+            rp::hal::AutoLocker l(_locker);
+            if (!_capacity) return;
+
+            if (policy == LIDAR_BACKPRESSURE_DROP_NEWEST) {
+                size_t room = _capacity - (size_t)(_write_pos - _read_pos);
+                if (count > room) {
+                    _dropped_count += count - room;
+                    count = room;
+                }
+                if (!count) return;
+            }
+
+            // only the newest ones are kept if the batch itself exceeds the capacity
+            if (count > _capacity) {
+                _dropped_count += count - _capacity;
+                nodes += count - _capacity;
+                timestamps_uS += count - _capacity;
+                count = _capacity;
+            }
+
+            _copyIn(_write_pos, nodes, timestamps_uS, count);
+            _write_pos += count;
+
+            if (_write_pos - _read_pos > _capacity) {
+                _dropped_count += (_write_pos - _read_pos) - _capacity;
+                _read_pos = _write_pos - _capacity;
+            }
+            _data_waiter.set();
+        }
+
+        size_t waitAndFetch(T* node, size_t maxcount, _u32 timeout)
+        {
+            return waitAndFetch(node, nullptr, maxcount, timeout);
+        }
+
+        // timestamps_uS is optional, it receives the sample time of each fetched node
+        size_t waitAndFetch(T* node, _u64* timestamps_uS, size_t maxcount, _u32 timeout)
+        {
+            if (_data_waiter.wait(timeout) == rp::hal::Event::EVENT_OK)
+            {
+                rp::hal::AutoLocker l(_locker);
+
+                size_t copiedCount = (size_t)std::min<_u64>(maxcount, _write_pos - _read_pos);
+                _copyOut(_read_pos, node, timestamps_uS, copiedCount);
+                _read_pos += copiedCount;
+
+                if (_read_pos != _write_pos) {
+                    // partially fetched, the rest is ready for the next call
+                    _data_waiter.set();
+                }
+                if (_policy.load(std::memory_order_relaxed) == LIDAR_BACKPRESSURE_BLOCK) {
+                    _space_waiter.set();
+                }
+                return copiedCount;
+            }
+            return 0;
+        }
+
+        void openCursor(LidarSampleCursor& cursor)
+        {
+            rp::hal::AutoLocker l(_locker);
+            cursor.sequence = _write_pos;
+            cursor.missed_count = 0;
+        }
+
+        // the samples since the previous read of the cursor in place, false if there is none
+        bool readCursor(LidarSampleCursor& cursor, LidarSampleSpan& span)
+        {
+            memset(&span, 0, sizeof(span));
+
+            rp::hal::AutoLocker l(_locker);
+            // a cursor of another driver or ahead of the stream starts over from the next sample
+            if (cursor.sequence > _write_pos) cursor.sequence = _write_pos;
+
+            _u64 oldest = _write_pos > _capacity ? std::max<_u64>(_epoch_pos, _write_pos - _capacity) : _epoch_pos;
+            if (cursor.sequence < oldest) {
+                span.missed_count = oldest - cursor.sequence;
+                cursor.missed_count += span.missed_count;
+                cursor.sequence = oldest;
+            }
+
+            span.sequence = cursor.sequence;
+            size_t count = (size_t)(_write_pos - cursor.sequence);
+            cursor.sequence = _write_pos;
+            if (!count) return false;
+
+            size_t offset = (size_t)(span.sequence & (_capacity - 1));
+            span.counts[0] = std::min(count, _capacity - offset);
+            span.nodes[0] = &_nodes[offset];
+            span.timestamps_uS[0] = &_timestamps[offset];
+            if (count > span.counts[0]) {
+                span.counts[1] = count - span.counts[0];
+                span.nodes[1] = &_nodes[0];
+                span.timestamps_uS[1] = &_timestamps[0];
+            }
+            return true;
+        }
+
+        // the producer copies in under the locker: a span read without it is intact if its oldest slot was not reached since
+        bool isSpanIntact(const LidarSampleSpan& span)
+        {
+            rp::hal::AutoLocker l(_locker);
+            return span.sequence >= _epoch_pos && _write_pos - span.sequence <= _capacity;
+        }
+
+        // the count of the samples overwritten or discarded before being fetched
+        _u64 getDroppedCount()
+        {
+            rp::hal::AutoLocker l(_locker);
+            return _dropped_count;
+        }
+
+        // the time the producer waited for room and the waits cut by the bound
+        void getBlockStats(_u64& blocked_uS, _u64& timeouts) const
+        {
+            blocked_uS = _blocked_uS.load(std::memory_order_relaxed);
+            timeouts = _block_timeouts.load(std::memory_order_relaxed);
+        }
+
+    protected:
+        // the whole batch fits once the consumer has fetched enough, unless it exceeds the capacity itself
+        void _waitForRoom(size_t count)
+        {
+            _u64 startTs = 0;
+            _u64 deadline = 0;
+            while (_policy.load(std::memory_order_acquire) == LIDAR_BACKPRESSURE_BLOCK) {
+                {
+                    rp::hal::AutoLocker l(_locker);
+                    if (!_capacity || _capacity - (size_t)(_write_pos - _read_pos) >= std::min(count, _capacity)) break;
+                }
+
+                _u64 now = getms();
+                if (!startTs) {
+                    startTs = getus();
+                    deadline = now + _max_block_ms.load(std::memory_order_relaxed);
+                }
+                if (now >= deadline) {
+                    _block_timeouts.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+                _space_waiter.wait((_u32)(deadline - now));
+            }
+            if (startTs) _blocked_uS.fetch_add(getus() - startTs, std::memory_order_relaxed);
+        }
+
+        // the copy is split into at most two contiguous runs at the wrap point
+        void _copyIn(_u64 pos, const T* nodes, const _u64* timestamps_uS, size_t count)
+        {
+            size_t offset = (size_t)(pos & (_capacity - 1));
+            size_t firstRun = std::min(count, _capacity - offset);
+
+            memcpy(&_nodes[offset], nodes, firstRun * sizeof(T));
+            memcpy(&_timestamps[offset], timestamps_uS, firstRun * sizeof(_u64));
+            if (count > firstRun) {
+                memcpy(&_nodes[0], nodes + firstRun, (count - firstRun) * sizeof(T));
+                memcpy(&_timestamps[0], timestamps_uS + firstRun, (count - firstRun) * sizeof(_u64));
+            }
+        }
+
+        void _copyOut(_u64 pos, T* nodes, _u64* timestamps_uS, size_t count)
+        {
+            size_t offset = (size_t)(pos & (_capacity - 1));
+            size_t firstRun = std::min(count, _capacity - offset);
+
+            memcpy(nodes, &_nodes[offset], firstRun * sizeof(T));
+            if (count > firstRun) {
+                memcpy(nodes + firstRun, &_nodes[0], (count - firstRun) * sizeof(T));
+            }
+
+            if (timestamps_uS) {
+                memcpy(timestamps_uS, &_timestamps[offset], firstRun * sizeof(_u64));
+                if (count > firstRun) {
+                    memcpy(timestamps_uS + firstRun, &_timestamps[0], (count - firstRun) * sizeof(_u64));
+                }
+            }
+        }
+
+        // on lines of its own, the producer and the consumer both take the locker for each batch
+        SL_CACHE_ALIGNED size_t _capacity;
+        rp::hal::Locker _locker;
+        rp::hal::Event  _data_waiter;
+
+        internal::sdk_vector<T>    _nodes;
+        internal::sdk_vector<_u64> _timestamps;
+        _u64            _write_pos;
+        _u64            _read_pos;
+        _u64            _epoch_pos;     // the position the ring was allocated at
+        _u64            _dropped_count;
+
+        std::atomic<int>  _policy;  // LidarBackpressurePolicy
+        std::atomic<_u32> _max_block_ms;
+        rp::hal::Event    _space_waiter;    // set by the fetches under LIDAR_BACKPRESSURE_BLOCK
+        std::atomic<_u64> _blocked_uS;
+        std::atomic<_u64> _block_timeouts;
+    };
+
+    // The node fields converted into separate arrays, each one aligned for SIMD loads
+    // The arrays are allocated with the full capacity of the scan on the first use.
+    class ScanSoABuffer
+    {
+    public:
+        enum {
+            ALIGNMENT = 64,
+        };
+
+        ScanSoABuffer()
+            : angle_rad(nullptr)
+            , range_m(nullptr)
+            , quality(nullptr)
+            , _memory(nullptr)
+            , _capacity(0)
+        {
+        }
+
+        ~ScanSoABuffer()
+        {
+            internal::sdkDeallocate(_memory);
+        }
+
+        // the arrays are reallocated if the capacity changes, not kept otherwise
+        bool allocate(size_t capacity)
+        {
+            if (_memory && _capacity == capacity) return true;
+            internal::sdkDeallocate(_memory);
+            _memory = nullptr;
+
+            size_t floatArraySize = _alignedSize(capacity * sizeof(float));
+            size_t qualityArraySize = _alignedSize(capacity * sizeof(_u8));
+            _memory = internal::sdkTryAllocate(floatArraySize * 2 + qualityArraySize + ALIGNMENT);
+            if (!_memory) return false;
+
+            _u8* base = (_u8*)(((size_t)_memory + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1));
+            angle_rad = (float*)base;
+            range_m = (float*)(base + floatArraySize);
+            quality = base + floatArraySize * 2;
+            _capacity = capacity;
+            return true;
+        }
+
+        bool isAllocated() const
+        {
+            return _memory != nullptr;
+        }
+
+        void prefault()
+        {
+            if (!_memory) return;
+            rp::hal::prefaultMemory(_memory, _alignedSize(_capacity * sizeof(float)) * 2 + _alignedSize(_capacity * sizeof(_u8)) + ALIGNMENT);
+        }
+
+        void set(size_t pos, const sl_lidar_response_measurement_node_hq_t& node)
+        {
+            angle_rad[pos] = node.angle_z_q14 * (float)(2 * 3.14159265358979323846 / 65536);
+            range_m[pos] = node.dist_mm_q2 / 4000.f;
+            quality[pos] = node.quality;
+        }
+
+        float* angle_rad;
+        float* range_m;
+        _u8*   quality;
+
+    protected:
+        static size_t _alignedSize(size_t size)
+        {
+            return (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+        }
+
+        void*  _memory;
+        size_t _capacity;
+
+    private:
+        ScanSoABuffer(const ScanSoABuffer&);
+        ScanSoABuffer& operator=(const ScanSoABuffer&);
+    };
+
+    // The x / y arrays of the de-skewed points, aligned like the SoA arrays
+    class ScanPointBuffer
+    {
+    public:
+        enum {
+            ALIGNMENT = 64,
+        };
+
+        ScanPointBuffer()
+            : x_m(nullptr)
+            , y_m(nullptr)
+            , _memory(nullptr)
+            , _capacity(0)
+        {
+        }
+
+        ~ScanPointBuffer()
+        {
+            internal::sdkDeallocate(_memory);
+        }
+
+        // the arrays only grow, so the scans of the usual sizes are all served by the first allocation
+        bool reserve(size_t capacity)
+        {
+            if (_memory && _capacity >= capacity) return true;
+            internal::sdkDeallocate(_memory);
+            _memory = nullptr;
+
+            size_t arraySize = (capacity * sizeof(float) + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+            _memory = internal::sdkTryAllocate(arraySize * 2 + ALIGNMENT);
+            if (!_memory) return false;
+
+            _u8* base = (_u8*)(((size_t)_memory + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1));
+            x_m = (float*)base;
+            y_m = (float*)(base + arraySize);
+            _capacity = capacity;
+            return true;
+        }
+
+        void prefault()
+        {
+            if (!_memory) return;
+            size_t arraySize = (_capacity * sizeof(float) + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+            rp::hal::prefaultMemory(_memory, arraySize * 2 + ALIGNMENT);
+        }
+
+        float* x_m;
+        float* y_m;
+
+    protected:
+        void*  _memory;
+        size_t _capacity;
+
+    private:
+        ScanPointBuffer(const ScanPointBuffer&);
+        ScanPointBuffer& operator=(const ScanPointBuffer&);
+    };
+
+    template<typename T>
+    struct ScanBuffer
+    {
+        ScanBuffer(size_t maxcount)
+            : capacity(maxcount)
+            , overflow_count(0)
+            , bin_policy(LIDAR_SCAN_BIN_NEAREST_ANGLE)
+            , bins_only(false)
+            , layout(LIDAR_SCAN_LAYOUT_AOS)
+            , sample_count(0)
+            , gap_count(0)
+            , max_gap_q14(0)
+            , last_angle_q14(0)
+            , discarded_packet_count(0)
+            , filtered_count(0)
+            , timestamp_uS(0)
+            , end_timestamp_uS(0)
+            , sequence(0)
+#ifdef SL_LIDAR_LATENCY_PROFILING
+            , publish_uS(0)
+#endif
+        {
+            nodes.reserve(maxcount);
+            timestamps.reserve(maxcount);
+            memset(&view, 0, sizeof(view));
+        }
+
+        void clear()
+        {
+            nodes.clear();
+            timestamps.clear();
+            bins.clear();
+            bin_timestamps.clear();
+            bin_states.clear();
+            sample_count = 0;
+            overflow_count = 0;
+            gap_count = 0;
+            max_gap_q14 = 0;
+            discarded_packet_count = 0;
+            filtered_count = 0;
+        }
+
+        // the vectors are made to hold exactly maxcount nodes, so a smaller capacity releases memory
+        void setCapacity(size_t maxcount)
+        {
+            capacity = maxcount;
+            if (nodes.capacity() != maxcount) {
+                internal::sdk_vector<T>().swap(nodes);
+                nodes.reserve(maxcount);
+            }
+            if (timestamps.capacity() != maxcount) {
+                internal::sdk_vector<_u64>().swap(timestamps);
+                timestamps.reserve(maxcount);
+            }
+        }
+
+        // sized for the scans of the given configuration with all the pages touched, so they begin in it without a page fault
+        void prefault(size_t maxcount, _u32 scanLayout, size_t binCount, bool deskewed)
+        {
+            setCapacity(maxcount);
+            nodes.resize(maxcount);
+            timestamps.resize(maxcount);
+            if ((scanLayout & LIDAR_SCAN_LAYOUT_SOA) && soa.allocate(maxcount)) soa.prefault();
+            if (deskewed && deskew.reserve(maxcount)) deskew.prefault();
+            bins.resize(binCount);
+            bin_timestamps.resize(binCount);
+            bin_states.resize(binCount);
+            clear();
+        }
+
+        internal::sdk_vector<T> nodes;
+        internal::sdk_vector<_u64> timestamps; // sample time of each node
+        size_t         capacity;       // of the raw nodes, sampled when the scan begins
+        size_t         overflow_count; // the samples beyond the capacity, each one replaced the last node
+
+        // the fixed angle bins, empty if binning is off
+        internal::sdk_vector<T> bins;
+        internal::sdk_vector<_u64> bin_timestamps;
+        internal::sdk_vector<_u8>  bin_states;  // SCAN_BIN_STATE_xxx
+        _u32           bin_policy;
+        bool           bins_only;   // the raw nodes are not kept
+
+        ScanSoABuffer  soa;         // same positions and timestamps as the raw nodes
+        ScanPointBuffer deskew;
+        _u32           layout;      // LidarScanLayout
+
+        size_t         sample_count; // all the samples received, kept or not
+        size_t         gap_count;
+        _u32           max_gap_q14;    // the widest step between consecutive samples
+        _u16           last_angle_q14; // of the previous sample
+        size_t         discarded_packet_count;
+        size_t         filtered_count;  // the samples removed by the filter chain
+        _u64           timestamp_uS;
+        _u64           end_timestamp_uS; // the latest sample time of the scan
+        _u64           sequence;
+        LidarScanData  view; // filled when the scan is completed
+
+#ifdef SL_LIDAR_LATENCY_PROFILING
+        _u64           publish_uS;  // when the scan was completed
+#endif
+    };
+
+    // Recycles the scan buffers, only used by the producer side
+    // A buffer is shared by the holder slot it sits in and its leases, which alias the same reference,
+    // so lending a scan out does not allocate. The buffers given back while still lent out are only
+    // reused once their leases are all released.
+    template<typename T>
+    class ScanBufferPool
+    {
+    public:
+        typedef std::shared_ptr<ScanBuffer<T> > buffer_ptr_t;
+
+        enum {
+            // the lists only grow beyond it when the leases are hoarded
+            RESERVED_BUFFER_COUNT = 16,
+        };
+
+        ScanBufferPool()
+            : _buffer_count(0)
+        {
+            _free_list.reserve(RESERVED_BUFFER_COUNT);
+            _lent_list.reserve(RESERVED_BUFFER_COUNT);
+        }
+
+        // a new buffer is made for maxcount nodes, the recycled ones are resized by the producer when a scan begins
+        buffer_ptr_t allocate(size_t maxcount)
+        {
+            buffer_ptr_t buffer;
+            if (!_free_list.empty()) {
+                buffer = std::move(_free_list.back());
+                _free_list.pop_back();
+                return buffer;
+            }
+
+            for (size_t pos = 0; pos < _lent_list.size(); ++pos) {
+                if (IsReleased(_lent_list[pos])) {
+                    buffer = std::move(_lent_list[pos]);
+                    _lent_list[pos] = std::move(_lent_list.back());
+                    _lent_list.pop_back();
+                    buffer->clear();
+                    return buffer;
+                }
+            }
+            ++_buffer_count;
+            return std::allocate_shared<ScanBuffer<T> >(internal::SdkAllocator<ScanBuffer<T> >(), maxcount);
+        }
+
+        // makes sure spareCount buffers of maxcount nodes are ready without allocating
+        void reserve(size_t spareCount, size_t maxcount)
+        {
+            while (_free_list.size() < spareCount) {
+                ++_buffer_count;
+                _free_list.push_back(std::allocate_shared<ScanBuffer<T> >(internal::SdkAllocator<ScanBuffer<T> >(), maxcount));
+            }
+        }
+
+        // the spare buffers, see ScanBuffer::prefault
+        void prefault(size_t maxcount, _u32 scanLayout, size_t binCount, bool deskewed)
+        {
+            for (size_t pos = 0; pos < _free_list.size(); ++pos) {
+                _free_list[pos]->prefault(maxcount, scanLayout, binCount, deskewed);
+            }
+        }
+
+        // all the buffers made so far, lent out ones included
+        size_t getBufferCount() const
+        {
+            return _buffer_count;
+        }
+
+        void recycle(buffer_ptr_t&& buffer)
+        {
+            if (IsReleased(buffer)) {
+                buffer->clear();
+                _free_list.push_back(std::move(buffer));
+            }
+            else {
+                _lent_list.push_back(std::move(buffer));
+            }
+        }
+
+        // no new lease can be made on a buffer once it is back to the producer
+        static bool IsReleased(const buffer_ptr_t& buffer)
+        {
+            if (buffer.use_count() != 1) return false;
+            // pairs with the release of the last lease
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return true;
+        }
+
+        // the lease shares the reference of the buffer, only the completed scans may be lent
+        static std::shared_ptr<const LidarScanData> Lease(const buffer_ptr_t& buffer)
+        {
+            return std::shared_ptr<const LidarScanData>(buffer, &buffer->view);
+        }
+
+    protected:
+        size_t          _buffer_count;
+        internal::sdk_vector<buffer_ptr_t> _free_list;
+        internal::sdk_vector<buffer_ptr_t> _lent_list;
+    };
+
+    enum {
+        SCAN_BIN_STATE_EMPTY = 0,
+        SCAN_BIN_STATE_INVALID = 1, // only holds a sample without distance
+        SCAN_BIN_STATE_VALID = 2,
+    };
+
+    // The newest completed scans, in the order they were completed
+    // Each scan is kept by a reference to its buffer, the same way a lease keeps it, so the producer
+    // moves on to recycled buffers and gets a kept one back once it is dropped from the history and
+    // from all its leases. The producer appends the scans, any thread may look them up.
+    template<typename T>
+    class ScanHistory
+    {
+    public:
+        typedef std::shared_ptr<ScanBuffer<T> > buffer_ptr_t;
+
+        ScanHistory()
+            : _depth(0)
+            , _requested_depth(0)
+            , _head(0)
+            , _count(0)
+        {
+        }
+
+        // the scans kept, 0 to keep none; it takes effect from the next reset
+        void setDepth(size_t depth)
+        {
+            _requested_depth.store(depth, std::memory_order_release);
+        }
+
+        size_t getDepth() const
+        {
+            return _depth.load(std::memory_order_acquire);
+        }
+
+        // drops all the scans kept
+        void reset()
+        {
+            rp::hal::AutoLocker l(_locker);
+            size_t depth = _requested_depth.load(std::memory_order_acquire);
+            if (depth != _entries.size()) {
+                internal::sdk_vector<buffer_ptr_t>(depth).swap(_entries);
+            }
+            else {
+                for (size_t pos = 0; pos < _entries.size(); ++pos) _entries[pos].reset();
+            }
+            _head = 0;
+            _count = 0;
+            _depth.store(depth, std::memory_order_release);
+        }
+
+        // producer side, the buffer must hold a completed scan
+        void push(const buffer_ptr_t& buffer)
+        {
+            if (!_depth.load(std::memory_order_acquire)) return;
+
+            rp::hal::AutoLocker l(_locker);
+            if (_entries.empty()) return;
+
+            size_t pos;
+            if (_count == _entries.size()) {
+                // replaces the oldest one
+                pos = _head;
+                _head = (_head + 1) % _entries.size();
+            }
+            else {
+                pos = (_head + _count) % _entries.size();
+                ++_count;
+            }
+            _entries[pos] = buffer;
+        }
+
+        // the sequences kept are consecutive, as each completed scan is pushed
+        std::shared_ptr<const LidarScanData> leaseBySequence(_u64 sequence)
+        {
+            rp::hal::AutoLocker l(_locker);
+            if (!_count) return std::shared_ptr<const LidarScanData>();
+
+            _u64 oldest = _at(0)->sequence;
+            if (sequence < oldest || sequence - oldest >= _count) return std::shared_ptr<const LidarScanData>();
+
+            const buffer_ptr_t& buffer = _at((size_t)(sequence - oldest));
+            if (buffer->sequence != sequence) return std::shared_ptr<const LidarScanData>();
+            return ScanBufferPool<T>::Lease(buffer);
+        }
+
+        // the newest scan begun at or before the timestamp, as long as it is not after the end of the newest scan
+        std::shared_ptr<const LidarScanData> leaseByTimestamp(_u64 timestamp_uS)
+        {
+            rp::hal::AutoLocker l(_locker);
+            if (!_count || timestamp_uS < _at(0)->timestamp_uS || timestamp_uS > _at(_count - 1)->end_timestamp_uS) {
+                return std::shared_ptr<const LidarScanData>();
+            }
+
+            // the first scan begun after the timestamp
+            size_t low = 1, high = _count;
+            while (low < high) {
+                size_t mid = low + (high - low) / 2;
+                if (_at(mid)->timestamp_uS <= timestamp_uS) {
+                    low = mid + 1;
+                }
+                else {
+                    high = mid;
+                }
+            }
+            return ScanBufferPool<T>::Lease(_at(low - 1));
+        }
+
+        // the newest scans, the oldest of them first; count is updated to the scans lent
+        void leaseRecent(std::shared_ptr<const LidarScanData>* leases, size_t& count)
+        {
+            rp::hal::AutoLocker l(_locker);
+            if (count > _count) count = _count;
+            for (size_t pos = 0; pos < count; ++pos) {
+                leases[pos] = ScanBufferPool<T>::Lease(_at(_count - count + pos));
+            }
+        }
+
+    protected:
+        const buffer_ptr_t& _at(size_t index) const
+        {
+            return _entries[(_head + index) % _entries.size()];
+        }
+
+        rp::hal::Locker     _locker;
+        std::atomic<size_t> _depth;           // of the entries, changed under the locker
+        std::atomic<size_t> _requested_depth;
+        internal::sdk_vector<buffer_ptr_t> _entries;
+        size_t              _head;            // the oldest scan
+        size_t              _count;
+    };
+
+    // Triple buffered scan assembly
+    // The producer (decoder) always owns a buffer to fill, the consumer owns the buffer it took last,
+    // and the third one carries the newest completed scan between them. Both sides only exchange
+    // buffer indices atomically, so neither of them has to wait for the other.
+    // A completed scan may also be lent out by reference, the producer replaces a buffer that is still
+    // referenced by a recycled one from the pool when it gets it back. The scan history holds its
+    // scans by reference in the same way.
+    // Only one producer and one consumer at a time are allowed.
+    template<typename T>
+    class ScanDataHolder
+    {
+    public:
+        enum {
+            BUFFER_INDEX_MASK = 0x3,
+            BUFFER_NEW_SCAN_FLAG = 0x4,
+        };
+
+        ScanDataHolder(size_t maxcount = 8192) 
+            : _capacity(maxcount)
+            , _reset_requested(false)
+            , _listener(nullptr)
+            , _ready_notifier(nullptr)
+            , _bin_config(0)
+            , _layout(LIDAR_SCAN_LAYOUT_AOS)
+            , _sample_duration_uS(0)
+            , _rotation_period_uS(0)
+            , _backpressure_policy(LIDAR_BACKPRESSURE_DROP_OLDEST)
+            , _max_block_ms(0)
+            , _scan_sequence(0)
+            , _write_id(0)
+            , _gap_threshold_q14(0)
+            , _warmup_count(0)
+            , _overflow_count(0)
+            , _dropped_count(0)
+            , _blocked_uS(0)
+            , _block_timeouts(0)
+            , _steady_state(false)
+            , _published_state(1)
+            , _read_id(2)
+            , _read_sequence(0)
+            , _first_scan_waiter(false)
+            , _first_scan_uS(0)
+            , _rate_variance(0)
+            , _deskew_provider(nullptr)
+            , _deskew_twist_enabled(false)
+            , _filter_count(0)
+            , _ascending(false)
+#ifdef SL_LIDAR_LATENCY_PROFILING
+            , _latency_profile(nullptr)
+#endif
+        {
+            memset(&_rate_stats, 0, sizeof(_rate_stats));
+            _rate_reseed = false;
+            memset(&_deskew_twist, 0, sizeof(_deskew_twist));
+            // the buffers get their capacity when a scan begins in them
+            for (size_t pos = 0; pos < _countof(_slots); ++pos) {
+                _slots[pos] = _pool.allocate(0);
+            }
+        }
+
+        ~ScanDataHolder()
+        {
+            // the leases keep their buffers alive on their own
+            leaveSteadyState();
+        }
+
+        size_t getMaxCacheCount() const {
+            return _capacity.load(std::memory_order_acquire);
+        }
+
+        // the raw nodes kept in each scan, it takes effect from the next scan
+        void setMaxCacheCount(size_t maxcount) {
+            _capacity.store(std::max<size_t>(maxcount, 1), std::memory_order_release);
+        }
+
+        // the sample duration of the scan mode, for the expected sample count of each scan; 0 if unknown
+        void setSampleDuration(float us_per_sample) {
+            _sample_duration_uS.store(us_per_sample, std::memory_order_release);
+        }
+
+        // the rotation period commanded to the motor while scanning, 0 if the motor speed changed by an unknown amount:
+        // the smoothed rate restarts from it instead of converging from the previous speed over several revolutions,
+        // and the gaps of the next scan are the steps wider than a few samples of it
+        void setRotationPeriod(float period_uS)
+        {
+            {
+                rp::hal::AutoLocker l(_rate_locker);
+                if (period_uS > 0 && _rate_stats.revolutions) {
+                    _rate_stats.period_uS = period_uS;
+                    _rate_stats.frequency_hz = 1000000.f / period_uS;
+                    _rate_stats.min_period_uS = period_uS;
+                    _rate_stats.max_period_uS = period_uS;
+                    _rate_variance = 0;
+                    _rate_stats.jitter_uS = 0;
+                }
+                else {
+                    // the next revolution is taken as measured
+                    _rate_reseed = _rate_stats.revolutions != 0;
+                }
+            }
+            _rotation_period_uS.store(period_uS > 0 ? period_uS : -1.f, std::memory_order_release);
+        }
+
+        // producer side
+        // a sample packet lost to a checksum error, accounted to the scan being received
+        void notifyPacketDiscarded() {
+            ScanBuffer<T>* buffer = _slots[_write_id].get();
+            if (buffer->sample_count) ++buffer->discarded_packet_count;
+        }
+
+        // the motion of the LIDAR corrected in each scan when it is completed, the provider replaces the twist
+        void setDeskewPoseProvider(ILidarPoseProvider* provider)
+        {
+            rp::hal::AutoLocker l(_deskew_locker);
+            _deskew_provider = provider;
+            _deskew_twist_enabled = false;
+        }
+
+        void setDeskewTwist(const LidarTwist2D* twist)
+        {
+            rp::hal::AutoLocker l(_deskew_locker);
+            _deskew_provider = nullptr;
+            _deskew_twist_enabled = twist != nullptr;
+            if (twist) _deskew_twist = *twist;
+        }
+
+        // the filters run on each completed scan, before the de-skew
+        void setFilters(const LidarScanFilter* filters, size_t count)
+        {
+            rp::hal::AutoLocker l(_filter_locker);
+            _filter_count = std::min<size_t>(count, LIDAR_SCAN_FILTER_MAX_COUNT);
+            if (_filter_count) std::copy(filters, filters + _filter_count, _filters);
+        }
+
+        // the completed scans are ascended like ascendScanData after the filters, it takes effect from the next scan
+        void setAscending(bool enabled)
+        {
+            _ascending.store(enabled, std::memory_order_release);
+        }
+
+        // the revolutions measured since the last reset
+        void getRateStats(LidarScanRateStats& stats) {
+            rp::hal::AutoLocker l(_rate_locker);
+            stats = _rate_stats;
+        }
+
+        // all the samples beyond the capacity of their scan so far
+        _u64 getOverflowCount() const {
+            return _overflow_count.load(std::memory_order_relaxed);
+        }
+
+        // what the producer does with a completed scan while the previous one has not been taken;
+        // the listener and the history get every scan whatever the policy
+        void setBackpressurePolicy(LidarBackpressurePolicy policy, _u32 maxBlockMs)
+        {
+            _max_block_ms.store(maxBlockMs, std::memory_order_relaxed);
+            _backpressure_policy.store(policy, std::memory_order_release);
+            // a producer blocked under the previous policy goes on
+            _taken_waiter.set();
+        }
+
+        LidarBackpressurePolicy getBackpressurePolicy() const {
+            return (LidarBackpressurePolicy)_backpressure_policy.load(std::memory_order_acquire);
+        }
+
+        // the completed scans never taken, the time the producer waited for the takes and the waits cut by the bound
+        void getBackpressureStats(_u64& dropped, _u64& blocked_uS, _u64& timeouts) const
+        {
+            dropped = _dropped_count.load(std::memory_order_relaxed);
+            blocked_uS = _blocked_uS.load(std::memory_order_relaxed);
+            timeouts = _block_timeouts.load(std::memory_order_relaxed);
+        }
+
+        // drops the published scan and the history; the producer discards its partial scan on its next push
+        void reset() {
+            leaveSteadyState();
+            _history.reset();
+            {
+                rp::hal::AutoLocker l(_rate_locker);
+                memset(&_rate_stats, 0, sizeof(_rate_stats));
+                _rate_variance = 0;
+                _rate_reseed = false;
+            }
+            _rotation_period_uS.store(0, std::memory_order_release);
+            _published_state.fetch_and(~(int)BUFFER_NEW_SCAN_FLAG, std::memory_order_acq_rel);
+            _read_sequence.store(0, std::memory_order_release);
+            _reset_requested.store(true, std::memory_order_release);
+            _data_waiter.set(false);
+            _first_scan_uS.store(0, std::memory_order_release);
+            _first_scan_waiter.set(false);
+            _taken_waiter.set();
+            _syncReadyNotifier();
+        }
+
+        // the listener is called on the producer side each time a scan is completed
+        void setScanListener(IScanListener* listener) {
+            _listener.store(listener, std::memory_order_release);
+        }
+
+        // the notifier is set while a completed scan has not been taken yet
+        void setReadyNotifier(rp::hal::Notifier* notifier) {
+            _ready_notifier.store(notifier, std::memory_order_release);
+            _syncReadyNotifier();
+        }
+
+        // the holder enters the allocation steady state once the first scans after a reset have filled all its buffers,
+        // it is left here when the scans stop
+        void leaveSteadyState()
+        {
+            if (_steady_state.exchange(false, std::memory_order_acq_rel)) {
+                internal::sdkEndSteadyState();
+            }
+        }
+
+        // resamples each scan into binCount bins of equal width when binCount is not 0,
+        // it takes effect from the next scan.
+        // bins only: the raw nodes are not kept, the bins are published as the nodes of the scan
+        void setBinning(size_t binCount, LidarScanBinPolicy policy, bool binsOnly)
+        {
+            _bin_config.store(((_u32)binCount << 8) | ((_u32)policy << 1) | (binsOnly ? 1 : 0), std::memory_order_release);
+        }
+
+        // the layouts the raw nodes are kept in, it takes effect from the next scan
+        void setLayout(LidarScanLayout layout)
+        {
+            _layout.store(layout, std::memory_order_release);
+        }
+
+        // the completed scans kept for the lookups, it takes effect from the next reset
+        void setHistoryDepth(size_t depth)
+        {
+            _history.setDepth(depth);
+        }
+
+        ScanHistory<T>& getHistory()
+        {
+            return _history;
+        }
+
+        // whether the scans have nodes for the AoS grab APIs: raw nodes or bins only
+        bool hasNodeOutput() const
+        {
+            return (_layout.load(std::memory_order_acquire) & LIDAR_SCAN_LAYOUT_AOS)
+                || ((_bin_config.load(std::memory_order_acquire) >> 8) && (_bin_config.load(std::memory_order_acquire) & 0x1));
+        }
+
+        bool hasSoAOutput() const
+        {
+            return (_layout.load(std::memory_order_acquire) & LIDAR_SCAN_LAYOUT_SOA) != 0;
+        }
+
+#ifdef SL_LIDAR_LATENCY_PROFILING
+        // the scan publish and consumer grab stages are recorded into the profile, set before any scan is pushed
+        void setLatencyProfile(internal::LatencyProfile* profile)
+        {
+            _latency_profile = profile;
+        }
+#endif
+
+        // producer side
+        void pushScanNodeData(_u64 currentSampleTsUs, const T* hqNode)
+        {
+            _checkResetRequest();
+            _pushScanNodeData(currentSampleTsUs, hqNode);
+        }
+
+        // producer side
+        void pushScanNodesData(const _u64* sampleTsUs, const T* hqNodes, size_t count)
+        {
+            _checkResetRequest();
+            for (size_t pos = 0; pos < count; ++pos) {
+                _pushScanNodeData(sampleTsUs[pos], hqNodes + pos);
+            }
+        }
+
+        // producer side
+        void rewindCurrentScanData() {
+            _slots[_write_id]->clear();
+        }
+
+        // consumer side
+        // takes the newest completed scan that has not been taken yet, waits up to timeout ms for one.
+        // The returned buffer stays valid and untouched by the producer until the next call.
+        const ScanBuffer<T>* waitAndTakeNewestScan(_u32 timeout)
+        {
+            _u64 deadline = getms() + timeout;
+
+            while (!_takeNewestScan()) {
+                _u64 now = getms();
+                if (now >= deadline) {
+                    return nullptr;
+                }
+
+                // the event may carry the signal of a scan that has been taken already, always recheck
+                _data_waiter.wait((_u32)(deadline - now));
+            }
+
+#ifdef SL_LIDAR_LATENCY_PROFILING
+            if (_latency_profile) {
+                _latency_profile->recordSince(LIDAR_LATENCY_STAGE_CONSUMER_GRAB, _slots[_read_id]->publish_uS);
+            }
+#endif
+            return _slots[_read_id].get();
+        }
+
+        // consumer side
+        // same as waitAndTakeNewestScan, but the scan is handed over to the returned reference
+        // and goes back to the pool once the last copy of the reference is released
+        std::shared_ptr<const LidarScanData> waitAndLeaseNewestScan(_u32 timeout)
+        {
+            if (!waitAndTakeNewestScan(timeout)) {
+                return std::shared_ptr<const LidarScanData>();
+            }
+            return ScanBufferPool<T>::Lease(_slots[_read_id]);
+        }
+
+        // consumer side
+        // the newest completed scan if its sequence is above the given one, taken now or by an earlier take; never waits.
+        // Unlike the takes above, the scan is returned again until a newer one is completed.
+        const ScanBuffer<T>* takeNewestScanSince(_u64 sequence)
+        {
+            _takeNewestScan();
+            if (_read_sequence.load(std::memory_order_acquire) <= sequence) return nullptr;
+            return _slots[_read_id].get();
+        }
+
+        // producer side, after reset() and before the stream starts: the buffers of the producer, the spare ones and the
+        // work arrays of the filters get the capacity, the layout and the binning of the next scans with all their pages
+        // touched. The buffer the consumer holds is left alone, it is sized on its first use before the steady state.
+        void prefault()
+        {
+            size_t capacity = _capacity.load(std::memory_order_acquire);
+            _u32 layout = _layout.load(std::memory_order_acquire);
+            size_t binCount = _bin_config.load(std::memory_order_acquire) >> 8;
+            bool deskewed;
+            {
+                rp::hal::AutoLocker l(_deskew_locker);
+                deskewed = _deskew_provider || _deskew_twist_enabled;
+            }
+
+            _pool.reserve(SPARE_BUFFER_COUNT, capacity);
+            _pool.prefault(capacity, layout, binCount, deskewed);
+
+            // no scan is pending after reset(), the consumer does not swap the published slot meanwhile
+            int publishedId = _published_state.load(std::memory_order_acquire) & BUFFER_INDEX_MASK;
+            int producerIds[] = { _write_id, publishedId };
+            for (size_t pos = 0; pos < _countof(producerIds); ++pos) {
+                if (ScanBufferPool<T>::IsReleased(_slots[producerIds[pos]])) {
+                    _slots[producerIds[pos]]->prefault(capacity, layout, binCount, deskewed);
+                }
+            }
+
+            rp::hal::AutoLocker l(_filter_locker);
+            if (_filter_count && _filter_ranges.size() < capacity) {
+                _filter_ranges.resize(capacity);
+                _filter_quality.resize(capacity);
+                _filter_index.resize(capacity);
+                _filter_scratch.resize(getScanFilterScratchSize(capacity));
+            }
+            if (_ascending.load(std::memory_order_acquire)) _reserveAscend(capacity);
+        }
+
+        // the time the first scan since reset() was published, waits up to timeout ms for it, 0 if none yet.
+        // The scan is left to the consumer.
+        _u64 waitForFirstScan(_u32 timeout)
+        {
+            if (_first_scan_waiter.wait(timeout) != rp::hal::Event::EVENT_OK) return 0;
+            return _first_scan_uS.load(std::memory_order_acquire);
+        }
+
+    protected:
+        enum {
+            // enough for each slot and the spare buffers of the usual leases to be filled once
+            WARMUP_SCAN_COUNT = 8,
+            // kept ready from the steady state on when the scans are lent out,
+            // for the leases overlapping each other by more than during the warm up
+            SPARE_BUFFER_COUNT = 2,
+            // a step between two consecutive samples wider than these sample steps is a gap
+            GAP_SAMPLE_STEPS = 4,
+            // the weight of the newest revolution in the smoothed rate is 1 / RATE_SMOOTHING_REVOLUTIONS
+            RATE_SMOOTHING_REVOLUTIONS = 8,
+        };
+
+        bool _takeNewestScan()
+        {
+            if (!(_published_state.load(std::memory_order_acquire) & BUFFER_NEW_SCAN_FLAG)) {
+                return false;
+            }
+
+            // the swapped in buffer is free to hold even if reset() has dropped the scan in the meantime
+            int prevState = _published_state.exchange(_read_id, std::memory_order_acq_rel);
+            _read_id = prevState & BUFFER_INDEX_MASK;
+            if (prevState & BUFFER_NEW_SCAN_FLAG) {
+                _read_sequence.store(_slots[_read_id]->sequence, std::memory_order_release);
+            }
+            if (_backpressure_policy.load(std::memory_order_relaxed) == LIDAR_BACKPRESSURE_BLOCK) {
+                _taken_waiter.set();
+            }
+            _syncReadyNotifier();
+            return (prevState & BUFFER_NEW_SCAN_FLAG) != 0;
+        }
+
+        // cleared first and set again if a scan has been published in the meantime, so that
+        // a scan published between the take and the clear still leaves the notifier set
+        void _syncReadyNotifier()
+        {
+            rp::hal::Notifier* notifier = _ready_notifier.load(std::memory_order_acquire);
+            if (!notifier) return;
+
+            notifier->clear();
+            if (_published_state.load(std::memory_order_seq_cst) & BUFFER_NEW_SCAN_FLAG) {
+                notifier->set();
+            }
+        }
+
+        void _checkResetRequest()
+        {
+            if (_reset_requested.load(std::memory_order_acquire)) {
+                _reset_requested.store(false, std::memory_order_relaxed);
+                _slots[_write_id]->clear();
+                _gap_threshold_q14 = 0;
+                _warmup_count = 0;
+            }
+        }
+
+        // nextScanTs: the sample time of the sync of the next scan, which ends this one
+        void _publishCurrentScan(_u64 nextScanTs)
+        {
+            ScanBuffer<T>* completed = _slots[_write_id].get();
+#ifdef SL_LIDAR_LATENCY_PROFILING
+            _u64 publishStartTs = getus();
+            completed->publish_uS = publishStartTs;
+#endif
+            completed->sequence = ++_scan_sequence;
+            _filterScan(completed);
+            bool ascended = _ascendScan(completed);
+            completed->view.nodes = completed->nodes.empty() ? nullptr : &completed->nodes[0];
+            completed->view.timestamps_uS = completed->timestamps.empty() ? nullptr : &completed->timestamps[0];
+            completed->view.count = completed->nodes.size();
+
+            LidarScanSoA& soa = completed->view.soa;
+            memset(&soa, 0, sizeof(soa));
+            if (completed->layout & LIDAR_SCAN_LAYOUT_SOA) {
+                soa.angle_rad = completed->soa.angle_rad;
+                soa.range_m = completed->soa.range_m;
+                soa.quality = completed->soa.quality;
+                soa.timestamps_uS = completed->view.timestamps_uS;
+                soa.count = completed->timestamps.size();
+            }
+            completed->view.bins = completed->bins.empty() ? nullptr : &completed->bins[0];
+            completed->view.bin_timestamps_uS = completed->bin_timestamps.empty() ? nullptr : &completed->bin_timestamps[0];
+            completed->view.bin_count = completed->bins.size();
+            if (completed->bins_only) {
+                completed->view.nodes = completed->view.bins;
+                completed->view.timestamps_uS = completed->view.bin_timestamps_uS;
+                completed->view.count = completed->view.bin_count;
+            }
+            completed->view.timestamp_uS = completed->timestamp_uS;
+            completed->view.end_timestamp_uS = completed->end_timestamp_uS;
+            completed->view.sequence = completed->sequence;
+            completed->view.overflow_count = completed->overflow_count;
+            completed->view.filtered_count = completed->filtered_count;
+            completed->view.ascended = ascended;
+            // the revolution measured from one sync to the next
+            _u64 period = nextScanTs > completed->timestamp_uS ? nextScanTs - completed->timestamp_uS : 0;
+            _updateScanIntegrity(completed, period);
+            if (period) _updateRateStats(period);
+            _deskewScan(completed);
+            SL_TRACE_INSTANT(rp::hal::TRACE_CATEGORY_SCAN, "scan_complete", completed->sequence);
+
+            IScanListener* listener = _listener.load(std::memory_order_acquire);
+            std::shared_ptr<const LidarScanData> listenerLease;
+            if (listener) {
+                listenerLease = ScanBufferPool<T>::Lease(_slots[_write_id]);
+            }
+            _history.push(_slots[_write_id]);
+
+            if (_isPublishedScanPending()) {
+                if (_backpressure_policy.load(std::memory_order_acquire) == LIDAR_BACKPRESSURE_BLOCK) {
+                    _waitPublishedScanTaken();
+                }
+                if (_isPublishedScanPending() && _backpressure_policy.load(std::memory_order_acquire) == LIDAR_BACKPRESSURE_DROP_NEWEST) {
+                    // the completed scan stays in the slot only for the listener and the history
+                    _dropped_count.fetch_add(1, std::memory_order_relaxed);
+                    _prepareWriteBuffer();
+                    _notifyFirstScan();
+                    _countWarmupScan();
+                    if (listener) {
+                        listener->onScanComplete(listenerLease, listenerLease->timestamp_uS);
+                    }
+                    return;
+                }
+            }
+
+            int prevState = _published_state.exchange(_write_id | BUFFER_NEW_SCAN_FLAG, std::memory_order_acq_rel);
+            if (prevState & BUFFER_NEW_SCAN_FLAG) {
+                _dropped_count.fetch_add(1, std::memory_order_relaxed);
+            }
+            _write_id = prevState & BUFFER_INDEX_MASK;
+            _prepareWriteBuffer();
+            _data_waiter.set();
+            rp::hal::Notifier* notifier = _ready_notifier.load(std::memory_order_acquire);
+            if (notifier) notifier->set();
+            _notifyFirstScan();
+            _countWarmupScan();
+
+            if (listener) {
+                listener->onScanComplete(listenerLease, listenerLease->timestamp_uS);
+            }
+#ifdef SL_LIDAR_LATENCY_PROFILING
+            if (_latency_profile) {
+                _latency_profile->recordSince(LIDAR_LATENCY_STAGE_SCAN_PUBLISH, publishStartTs);
+            }
+#endif
+        }
+
+        bool _isPublishedScanPending() const
+        {
+            return (_published_state.load(std::memory_order_acquire) & BUFFER_NEW_SCAN_FLAG) != 0;
+        }
+
+        // up to the bound of the policy, the policy changed or a reset ends the wait as well
+        void _waitPublishedScanTaken()
+        {
+            _u64 startTs = getus();
+            _u64 deadline = getms() + _max_block_ms.load(std::memory_order_relaxed);
+            while (_isPublishedScanPending() && !_reset_requested.load(std::memory_order_acquire)
+                && _backpressure_policy.load(std::memory_order_acquire) == LIDAR_BACKPRESSURE_BLOCK) {
+                _u64 now = getms();
+                if (now >= deadline) {
+                    _block_timeouts.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+                _taken_waiter.wait((_u32)(deadline - now));
+            }
+            _blocked_uS.fetch_add(getus() - startTs, std::memory_order_relaxed);
+        }
+
+        void _notifyFirstScan()
+        {
+            if (!_first_scan_uS.load(std::memory_order_relaxed)) {
+                _first_scan_uS.store(getus(), std::memory_order_release);
+                _first_scan_waiter.set();
+            }
+        }
+
+        void _countWarmupScan()
+        {
+            // each scan kept by the history takes one more buffer
+            size_t warmupScanCount = WARMUP_SCAN_COUNT + _history.getDepth();
+            if (_warmup_count < warmupScanCount && ++_warmup_count == warmupScanCount) {
+                _enterSteadyState();
+            }
+        }
+
+        void _checkAngleGap(ScanBuffer<T>* buffer, const T* hqNode)
+        {
+            // the angles wrap at 360 degree, a step back is the jitter of the encoder
+            _u32 step = (_u16)((_u16)hqNode->angle_z_q14 - buffer->last_angle_q14);
+            buffer->last_angle_q14 = (_u16)hqNode->angle_z_q14;
+            if (step >= 0x8000) return;
+
+            if (step > buffer->max_gap_q14) buffer->max_gap_q14 = step;
+            if (_gap_threshold_q14 && step > _gap_threshold_q14 && !_isCommandedStep(step)) ++buffer->gap_count;
+        }
+
+        void _updateScanIntegrity(ScanBuffer<T>* completed, _u64 period)
+        {
+            LidarScanData& view = completed->view;
+            view.sample_count = completed->sample_count;
+            view.gap_count = completed->gap_count;
+            view.max_gap_deg = completed->max_gap_q14 * 90.f / 16384.f;
+            view.discarded_packet_count = completed->discarded_packet_count;
+            view.expected_sample_count = 0;
+
+            float sampleDuration = _sample_duration_uS.load(std::memory_order_acquire);
+            if (!(sampleDuration > 0) || !period) return;
+
+            view.expected_sample_count = (size_t)(period / sampleDuration + 0.5f);
+
+            // the gaps of the next scan are the steps wider than a few samples of this revolution,
+            // or of the one commanded meanwhile; none are counted after a change to an unknown speed
+            size_t expectedCount = view.expected_sample_count;
+            float commandedPeriod = _rotation_period_uS.exchange(0, std::memory_order_acq_rel);
+            if (commandedPeriod > 0) {
+                expectedCount = (size_t)(commandedPeriod / sampleDuration + 0.5f);
+            }
+            else if (commandedPeriod < 0) {
+                expectedCount = 0;
+                _gap_threshold_q14 = 0;
+            }
+
+            if (expectedCount) {
+                _gap_threshold_q14 = (_u32)(GAP_SAMPLE_STEPS * 65536 / expectedCount);
+            }
+        }
+
+        // a speed commanded within the scan widens its steps at once: the threshold follows it
+        // right away, the period itself is consumed when the scan completes
+        bool _isCommandedStep(_u32 step)
+        {
+            float commandedPeriod = _rotation_period_uS.load(std::memory_order_acquire);
+            if (!commandedPeriod) return false;
+
+            float sampleDuration = _sample_duration_uS.load(std::memory_order_acquire);
+            size_t expectedCount = (commandedPeriod > 0 && sampleDuration > 0) ? (size_t)(commandedPeriod / sampleDuration + 0.5f) : 0;
+            _gap_threshold_q14 = expectedCount ? (_u32)(GAP_SAMPLE_STEPS * 65536 / expectedCount) : 0;
+            return !_gap_threshold_q14 || step <= _gap_threshold_q14;
+        }
+
+        // the raw nodes and the SoA arrays follow the samples kept by the chain
+        void _filterScan(ScanBuffer<T>* completed)
+        {
+            rp::hal::AutoLocker l(_filter_locker);
+            if (!_filter_count) return;
+
+            bool hasNodes = !completed->bins_only && (completed->layout & LIDAR_SCAN_LAYOUT_AOS);
+            bool hasSoA = (completed->layout & LIDAR_SCAN_LAYOUT_SOA) != 0;
+            size_t count = completed->timestamps.size();
+            if (!count || (!hasNodes && !hasSoA)) return;
+
+            // sized once for the capacity of the scans
+            if (_filter_ranges.size() < completed->capacity) {
+                _filter_ranges.resize(completed->capacity);
+                _filter_quality.resize(completed->capacity);
+                _filter_index.resize(completed->capacity);
+                _filter_scratch.resize(getScanFilterScratchSize(completed->capacity));
+            }
+
+            for (size_t pos = 0; pos < count; ++pos) {
+                if (hasNodes) {
+                    _filter_ranges[pos] = completed->nodes[pos].dist_mm_q2 / 4000.f;
+                    _filter_quality[pos] = completed->nodes[pos].quality;
+                }
+                else {
+                    _filter_ranges[pos] = completed->soa.range_m[pos];
+                    _filter_quality[pos] = completed->soa.quality[pos];
+                }
+            }
+
+            size_t kept = filterScan(_filters, _filter_count, &_filter_ranges[0], &_filter_quality[0], &_filter_index[0],
+                count, &_filter_scratch[0]);
+
+            // the positions kept only grow, so each sample is moved down before its slot is reused
+            for (size_t pos = 0; pos < kept; ++pos) {
+                size_t src = _filter_index[pos];
+                completed->timestamps[pos] = completed->timestamps[src];
+                if (hasNodes) {
+                    completed->nodes[pos] = completed->nodes[src];
+                    completed->nodes[pos].dist_mm_q2 = (_u32)(_filter_ranges[pos] * 4000.f + 0.5f);
+                }
+                if (hasSoA) {
+                    completed->soa.angle_rad[pos] = completed->soa.angle_rad[src];
+                    completed->soa.range_m[pos] = _filter_ranges[pos];
+                    completed->soa.quality[pos] = _filter_quality[pos];
+                }
+            }
+            completed->timestamps.resize(kept);
+            if (hasNodes) completed->nodes.resize(kept);
+            completed->filtered_count = count - kept;
+        }
+
+        // the raw nodes fixed and sorted like ascendScanData, the timestamps and the SoA arrays follow them
+        // true if the nodes of the scan are in ascending order, the bins always are
+        bool _ascendScan(ScanBuffer<T>* completed)
+        {
+            if (!_ascending.load(std::memory_order_acquire)) return false;
+            if (completed->bins_only) return true;
+
+            bool hasNodes = (completed->layout & LIDAR_SCAN_LAYOUT_AOS) != 0;
+            bool hasSoA = (completed->layout & LIDAR_SCAN_LAYOUT_SOA) != 0;
+            size_t count = completed->timestamps.size();
+            if (!count) return false;
+
+            if (hasNodes) {
+                // a scan without any distance is left as is, ascendScanData fails on it as well
+                if (!fixScanAngles_(&completed->nodes[0], count)) return false;
+                if (hasSoA) {
+                    for (size_t pos = 0; pos < count; ++pos) {
+                        if (!completed->nodes[pos].dist_mm_q2) completed->soa.angle_rad[pos] = completed->nodes[pos].angle_z_q14 * (float)(2 * 3.14159265358979323846 / 65536);
+                    }
+                }
+            }
+
+            _reserveAscend(completed->capacity);
+            for (size_t pos = 0; pos < count; ++pos) {
+                _ascend_keys[pos] = hasNodes ? (_u16)completed->nodes[pos].angle_z_q14
+                    : (_u16)(_u32)(completed->soa.angle_rad[pos] * (float)(65536 / (2 * 3.14159265358979323846)) + 0.5f);
+            }
+            if (!sortOrderByAngleKey_(&_ascend_keys[0], count, &_ascend_order[0], &_ascend_scratch[0])) return true;
+
+            _applyAscendOrder(&completed->timestamps[0], count);
+            if (hasNodes) _applyAscendOrder(&completed->nodes[0], count);
+            if (hasSoA) {
+                _applyAscendOrder(completed->soa.angle_rad, count);
+                _applyAscendOrder(completed->soa.range_m, count);
+                _applyAscendOrder(completed->soa.quality, count);
+            }
+            return true;
+        }
+
+        // sized once for the capacity of the scans
+        void _reserveAscend(size_t capacity)
+        {
+            if (_ascend_keys.size() >= capacity) return;
+            _ascend_keys.resize(capacity);
+            _ascend_order.resize(capacity);
+            _ascend_scratch.resize(capacity);
+            _ascend_values.resize(capacity * ((std::max(sizeof(T), sizeof(_u64)) + sizeof(_u64) - 1) / sizeof(_u64)));
+        }
+
+        template <class V>
+        void _applyAscendOrder(V* values, size_t count)
+        {
+            V* sorted = reinterpret_cast<V*>(&_ascend_values[0]);
+            for (size_t pos = 0; pos < count; ++pos) {
+                sorted[pos] = values[_ascend_order[pos]];
+            }
+            memcpy(values, sorted, count * sizeof(V));
+        }
+
+        // held under the locker, so a provider replaced is no longer called
+        void _deskewScan(ScanBuffer<T>* completed)
+        {
+            LidarScanData& view = completed->view;
+            view.deskewed_x_m = nullptr;
+            view.deskewed_y_m = nullptr;
+            view.deskewed_count = 0;
+
+            rp::hal::AutoLocker l(_deskew_locker);
+            if (!_deskew_provider && !_deskew_twist_enabled) return;
+
+            // the nodes when they are kept, the bins ones included, or the SoA arrays
+            bool fromNodes = view.nodes && (completed->bins_only || (completed->layout & LIDAR_SCAN_LAYOUT_AOS));
+            size_t count = fromNodes ? view.count : view.soa.count;
+            if (!count || !completed->deskew.reserve(count)) return;
+
+            _u64 start = completed->timestamp_uS;
+            _u64 duration = completed->end_timestamp_uS - start;
+            if (_deskew_provider) {
+                for (size_t pos = 0; pos < LIDAR_DESKEW_POSE_COUNT; ++pos) {
+                    _deskew_times[pos] = start + duration * pos / (LIDAR_DESKEW_POSE_COUNT - 1);
+                }
+                if (!_deskew_provider->getRelativePoses(_deskew_times, LIDAR_DESKEW_POSE_COUNT, _deskew_poses)) return;
+            }
+            else {
+                integrateLidarTwist(_deskew_twist, duration, _deskew_poses, LIDAR_DESKEW_POSE_COUNT);
+            }
+
+            sl_result ans = fromNodes
+                ? deskewScanToCartesian(view.nodes, view.timestamps_uS, count, start, start + duration, _deskew_poses, LIDAR_DESKEW_POSE_COUNT,
+                    completed->deskew.x_m, completed->deskew.y_m)
+                : deskewScanToCartesian(view.soa, start, start + duration, _deskew_poses, LIDAR_DESKEW_POSE_COUNT,
+                    completed->deskew.x_m, completed->deskew.y_m);
+            if (IS_FAIL(ans)) return;
+
+            view.deskewed_x_m = completed->deskew.x_m;
+            view.deskewed_y_m = completed->deskew.y_m;
+            view.deskewed_count = count;
+        }
+
+        void _updateRateStats(_u64 period)
+        {
+            rp::hal::AutoLocker l(_rate_locker);
+            LidarScanRateStats& stats = _rate_stats;
+            float periodUs = (float)period;
+
+            if (!stats.revolutions || _rate_reseed) {
+                _rate_reseed = false;
+                _rate_variance = 0;
+                stats.period_uS = periodUs;
+                stats.min_period_uS = periodUs;
+                stats.max_period_uS = periodUs;
+            }
+            else {
+                float deviation = periodUs - stats.period_uS;
+                stats.period_uS += deviation / RATE_SMOOTHING_REVOLUTIONS;
+                _rate_variance += (deviation * deviation - _rate_variance) / RATE_SMOOTHING_REVOLUTIONS;
+                stats.min_period_uS = std::min(stats.min_period_uS, periodUs);
+                stats.max_period_uS = std::max(stats.max_period_uS, periodUs);
+            }
+            ++stats.revolutions;
+            stats.last_period_uS = periodUs;
+            stats.frequency_hz = 1000000.f / stats.period_uS;
+            stats.jitter_uS = sqrtf(_rate_variance);
+        }
+
+        void _enterSteadyState()
+        {
+            if (_pool.getBufferCount() > _countof(_slots)) {
+                _pool.reserve(SPARE_BUFFER_COUNT, _capacity.load(std::memory_order_acquire));
+            }
+            if (!_steady_state.exchange(true, std::memory_order_acq_rel)) {
+                internal::sdkBeginSteadyState();
+            }
+        }
+
+        void _prepareWriteBuffer()
+        {
+            if (!ScanBufferPool<T>::IsReleased(_slots[_write_id])) {
+                // still lent out, leave it to the leases
+                _pool.recycle(std::move(_slots[_write_id]));
+                _slots[_write_id] = _pool.allocate(_capacity.load(std::memory_order_acquire));
+            }
+            _slots[_write_id]->clear();
+        }
+
+        void _pushScanNodeData(_u64 currentSampleTsUs, const T* hqNode)
+        {
+            ScanBuffer<T>* buffer = _slots[_write_id].get();
+
+            if (hqNode->flag & SL_LIDAR_RESP_HQ_FLAG_SYNCBIT) {
+                if (buffer->sample_count) {
+                    // publish the available scan
+                    _publishCurrentScan(currentSampleTsUs);
+                    buffer = _slots[_write_id].get();
+                }
+
+                assert(buffer->sample_count == 0);
+
+                //store the timestamp info
+                buffer->timestamp_uS = currentSampleTsUs;
+                buffer->end_timestamp_uS = currentSampleTsUs;
+                buffer->last_angle_q14 = (_u16)hqNode->angle_z_q14;
+                _beginScan(buffer);
+            }
+            else {
+                if (buffer->sample_count == 0) {
+                    //discard the data, do not form partial scan
+                    return;
+                }
+            }
+
+            ++buffer->sample_count;
+            // the sample times estimated for a packet may step back a little from the previous one
+            if (currentSampleTsUs > buffer->end_timestamp_uS) buffer->end_timestamp_uS = currentSampleTsUs;
+            _checkAngleGap(buffer, hqNode);
+            if (!buffer->bins.empty()) {
+                _pushBinNode(buffer, currentSampleTsUs, hqNode);
+            }
+
+            bool keepNodes = !buffer->bins_only && (buffer->layout & LIDAR_SCAN_LAYOUT_AOS);
+            bool keepSoA = (buffer->layout & LIDAR_SCAN_LAYOUT_SOA) != 0;
+            if (!keepNodes && !keepSoA) return;
+
+            // the timestamps are shared by both layouts
+            size_t pos = buffer->timestamps.size();
+            if (pos >= buffer->capacity) {
+                //replace the last entry if buffer is full
+                pos = buffer->capacity - 1;
+                ++buffer->overflow_count;
+                _overflow_count.fetch_add(1, std::memory_order_relaxed);
+                buffer->timestamps[pos] = currentSampleTsUs;
+                if (keepNodes) buffer->nodes[pos] = *hqNode;
+            }
+            else {
+                buffer->timestamps.push_back(currentSampleTsUs);
+                if (keepNodes) buffer->nodes.push_back(*hqNode);
+            }
+
+            if (keepSoA) {
+                buffer->soa.set(pos, *hqNode);
+            }
+        }
+
+        // the layout and the binning configuration are sampled once per scan
+        void _beginScan(ScanBuffer<T>* buffer)
+        {
+            buffer->setCapacity(_capacity.load(std::memory_order_acquire));
+            buffer->layout = _layout.load(std::memory_order_acquire);
+            if ((buffer->layout & LIDAR_SCAN_LAYOUT_SOA) && !buffer->soa.allocate(buffer->capacity)) {
+                buffer->layout &= ~(_u32)LIDAR_SCAN_LAYOUT_SOA;
+            }
+
+            _u32 config = _bin_config.load(std::memory_order_acquire);
+            size_t binCount = config >> 8;
+            buffer->bin_policy = (config >> 1) & 0x7F;
+            buffer->bins_only = binCount && (config & 0x1);
+            if (!binCount) return;
+
+            // an empty bin is an invalid node at the bin center
+            buffer->bins.resize(binCount);
+            for (size_t pos = 0; pos < binCount; ++pos) {
+                T& bin = buffer->bins[pos];
+                memset(&bin, 0, sizeof(bin));
+                bin.angle_z_q14 = (sl_u16)(((2 * pos + 1) << 16) / (2 * binCount));
+            }
+            buffer->bin_timestamps.assign(binCount, 0);
+            buffer->bin_states.assign(binCount, SCAN_BIN_STATE_EMPTY);
+        }
+
+        void _pushBinNode(ScanBuffer<T>* buffer, _u64 currentSampleTsUs, const T* hqNode)
+        {
+            size_t binCount = buffer->bins.size();
+            size_t binIdx = ((size_t)hqNode->angle_z_q14 * binCount) >> 16;
+            T& bin = buffer->bins[binIdx];
+            _u8& state = buffer->bin_states[binIdx];
+            _u8 newState = hqNode->dist_mm_q2 ? SCAN_BIN_STATE_VALID : SCAN_BIN_STATE_INVALID;
+
+            // a sample with distance always wins over one without
+            bool replace = newState > state;
+            if (!replace && newState == state) {
+                switch (buffer->bin_policy) {
+                case LIDAR_SCAN_BIN_MIN_RANGE:
+                    replace = hqNode->dist_mm_q2 < bin.dist_mm_q2;
+                    break;
+                case LIDAR_SCAN_BIN_MAX_RANGE:
+                    replace = hqNode->dist_mm_q2 > bin.dist_mm_q2;
+                    break;
+                default:
+                    {
+                        int center = (int)(((2 * binIdx + 1) << 16) / (2 * binCount));
+                        replace = std::abs((int)hqNode->angle_z_q14 - center) < std::abs((int)bin.angle_z_q14 - center);
+                    }
+                    break;
+                }
+            }
+
+            if (replace) {
+                bin = *hqNode;
+                buffer->bin_timestamps[binIdx] = currentSampleTsUs;
+                state = newState;
+            }
+        }
+
+        // The fields are grouped by the side writing them, each group starting a cache line.
+
+        // read for each node, changed from the api threads only
+        std::atomic<size_t> _capacity;  // of the raw nodes of each scan
+        std::atomic<bool>   _reset_requested;
+        std::atomic<IScanListener*> _listener;
+        std::atomic<rp::hal::Notifier*> _ready_notifier;
+        std::atomic<_u32>   _bin_config; // bin count << 8 | policy << 1 | bins only
+        std::atomic<_u32>   _layout;     // LidarScanLayout
+        std::atomic<float>  _sample_duration_uS;
+        std::atomic<float>  _rotation_period_uS; // commanded since the last scan, -1 if unknown, see setRotationPeriod
+        std::atomic<int>    _backpressure_policy; // LidarBackpressurePolicy of the grabs
+        std::atomic<_u32>   _max_block_ms;
+
+        // owned by the producer
+        SL_CACHE_ALIGNED _u64 _scan_sequence;
+        int    _write_id;
+        _u32   _gap_threshold_q14; // 0 until a revolution is measured
+        size_t _warmup_count;      // scans published since the reset
+        std::atomic<_u64>   _overflow_count;
+        std::atomic<_u64>   _dropped_count;
+        std::atomic<_u64>   _blocked_uS;
+        std::atomic<_u64>   _block_timeouts;
+        std::atomic<bool>   _steady_state;
+        ScanBufferPool<T>   _pool;
+
+        // the scan handoff, touched once per scan by both sides
+        SL_CACHE_ALIGNED std::atomic<int> _published_state; // slot index of the newest scan | BUFFER_NEW_SCAN_FLAG
+        int    _read_id;    // owned by the consumer
+        std::atomic<_u64>   _read_sequence; // of the scan held in the slot of the consumer, 0 once reset() drops it
+        rp::hal::Event      _data_waiter;
+        rp::hal::Event      _taken_waiter;      // set by the takes under LIDAR_BACKPRESSURE_BLOCK
+        rp::hal::Event      _first_scan_waiter; // manual reset, see waitForFirstScan
+        std::atomic<_u64>   _first_scan_uS;
+
+        SL_CACHE_ALIGNED rp::hal::Locker _rate_locker;  // held once per revolution by the producer
+        LidarScanRateStats  _rate_stats;
+        float               _rate_variance;
+        bool                _rate_reseed;   // the next revolution restarts the smoothing, see setRotationPeriod
+
+        SL_CACHE_ALIGNED rp::hal::Locker _deskew_locker; // held once per scan by the producer
+        ILidarPoseProvider* _deskew_provider;
+        bool                _deskew_twist_enabled;
+        LidarTwist2D        _deskew_twist;
+        _u64                _deskew_times[LIDAR_DESKEW_POSE_COUNT]; // owned by the producer
+        LidarPose2D         _deskew_poses[LIDAR_DESKEW_POSE_COUNT];
+
+        SL_CACHE_ALIGNED rp::hal::Locker _filter_locker; // held once per scan by the producer
+        LidarScanFilter     _filters[LIDAR_SCAN_FILTER_MAX_COUNT];
+        size_t              _filter_count;
+        internal::sdk_vector<float> _filter_ranges;  // owned by the producer, like the other work arrays
+        internal::sdk_vector<_u8>   _filter_quality;
+        internal::sdk_vector<_u32>  _filter_index;
+        internal::sdk_vector<float> _filter_scratch;
+
+        std::atomic<bool>   _ascending;
+        internal::sdk_vector<_u16> _ascend_keys;    // owned by the producer, like the work arrays of the filters
+        internal::sdk_vector<_u32> _ascend_order;
+        internal::sdk_vector<_u32> _ascend_scratch;
+        internal::sdk_vector<_u64> _ascend_values;  // the sorted copy of each array, of the widest element
+
+        // only the producer replaces the buffer of its slot
+        SL_CACHE_ALIGNED std::shared_ptr<ScanBuffer<T> > _slots[3];
+        ScanHistory<T>      _history;
+
+#ifdef SL_LIDAR_LATENCY_PROFILING
+        internal::LatencyProfile* _latency_profile;
+#endif
+    };
+
+    // Splits the incoming nodes into fixed angular sectors and hands each of them to the listener
+    // as soon as the first node of a later sector arrives, on the producer side.
+    // Only the listener and the sector width are changed from other threads, both atomically.
+    template<typename T>
+    class ScanSectorAssembler
+    {
+    public:
+        enum {
+            FULL_CIRCLE_Q14 = 4 << 14, // angle_z_q14 of 360 degrees
+        };
+
+        ScanSectorAssembler(size_t maxcount = 8192)
+            : _max_count(maxcount)
+            , _capacity(maxcount)
+            , _listener(nullptr)
+            , _sector_width_q14(FULL_CIRCLE_Q14)
+            , _reset_requested(false)
+            , _active_width_q14(0)
+            , _sector_count(1)
+            , _current_sector(-1)
+            , _sync_pending(false)
+            , _scan_sequence(0)
+        {
+            _nodes.reserve(_max_count);
+            _timestamps.reserve(_max_count);
+        }
+
+        // sectorDegrees must be within (0, 360]
+        void setSectorListener(ISectorListener* listener, float sectorDegrees)
+        {
+            int widthQ14 = (int)(sectorDegrees * FULL_CIRCLE_Q14 / 360.f + 0.5f);
+            if (widthQ14 < 1) widthQ14 = 1;
+            if (widthQ14 > FULL_CIRCLE_Q14) widthQ14 = FULL_CIRCLE_Q14;
+
+            _sector_width_q14.store(widthQ14, std::memory_order_relaxed);
+            _listener.store(listener, std::memory_order_release);
+        }
+
+        // drops the partial sector on the next push
+        void reset()
+        {
+            _reset_requested.store(true, std::memory_order_release);
+        }
+
+        // the nodes kept in each sector, it takes effect from the next reset
+        void setMaxCount(size_t maxcount)
+        {
+            _capacity.store(std::max<size_t>(maxcount, 1), std::memory_order_release);
+        }
+
+        // producer side
+        void pushNodes(const _u64* timestamps_uS, const T* nodes, size_t count)
+        {
+            ISectorListener* listener = _listener.load(std::memory_order_acquire);
+            if (!listener) {
+                _current_sector = -1;
+                return;
+            }
+
+            int widthQ14 = _sector_width_q14.load(std::memory_order_relaxed);
+            if (widthQ14 != _active_width_q14 || _reset_requested.load(std::memory_order_acquire)) {
+                _reset_requested.store(false, std::memory_order_relaxed);
+                _active_width_q14 = widthQ14;
+                _sector_count = (FULL_CIRCLE_Q14 + widthQ14 - 1) / widthQ14;
+                rewindCurrentScanData();
+            }
+
+            for (size_t pos = 0; pos < count; ++pos) {
+                _pushNode(listener, timestamps_uS[pos], nodes[pos]);
+            }
+        }
+
+        // producer side, before the stream starts: the sector arrays get the capacity with all their pages touched
+        void prefault()
+        {
+            rewindCurrentScanData();
+            _nodes.resize(_max_count);
+            _timestamps.resize(_max_count);
+            _nodes.clear();
+            _timestamps.clear();
+        }
+
+        // producer side, waits for the next sync node to start over
+        void rewindCurrentScanData()
+        {
+            _current_sector = -1;
+            _sync_pending = false;
+            _nodes.clear();
+            _timestamps.clear();
+
+            size_t capacity = _capacity.load(std::memory_order_acquire);
+            if (capacity != _max_count) {
+                _max_count = capacity;
+                internal::sdk_vector<T>().swap(_nodes);
+                internal::sdk_vector<_u64>().swap(_timestamps);
+                _nodes.reserve(_max_count);
+                _timestamps.reserve(_max_count);
+            }
+        }
+
+    protected:
+        void _pushNode(ISectorListener* listener, _u64 timestamp_uS, const T& node)
+        {
+            int sector = std::min<int>(node.angle_z_q14 / _active_width_q14, _sector_count - 1);
+
+            if (node.flag & SL_LIDAR_RESP_HQ_FLAG_SYNCBIT) {
+                if (_current_sector >= 0 && sector == _current_sector) {
+                    // the sync node is slightly before 0 degree, close the revolution with the sector
+                    _sync_pending = true;
+                }
+                else {
+                    _flushSector(listener);
+                    ++_scan_sequence;
+                    _current_sector = sector;
+                }
+            }
+            else if (_current_sector < 0) {
+                // do not form partial sector before the first sync node
+                return;
+            }
+            else if (sector != _current_sector) {
+                // move on when entering a later sector or wrapping around 0;
+                // samples slightly falling behind the boundary stay in the current sector
+                if (sector > _current_sector || (_current_sector - sector) > _sector_count / 2) {
+                    _flushSector(listener);
+                    _current_sector = sector;
+                }
+            }
+
+            if (_nodes.size() < _max_count) {
+                _nodes.push_back(node);
+                _timestamps.push_back(timestamp_uS);
+            }
+        }
+
+        void _flushSector(ISectorListener* listener)
+        {
+            if (_current_sector >= 0 && !_nodes.empty()) {
+                LidarScanSector sector;
+                sector.nodes = &_nodes[0];
+                sector.timestamps_uS = &_timestamps[0];
+                sector.count = _nodes.size();
+                sector.sector_index = (size_t)_current_sector;
+                sector.start_angle = _current_sector * _active_width_q14 * 360.f / FULL_CIRCLE_Q14;
+                sector.end_angle = std::min(360.f, (_current_sector + 1) * _active_width_q14 * 360.f / FULL_CIRCLE_Q14);
+                sector.scan_sequence = _scan_sequence;
+                listener->onSectorComplete(sector);
+            }
+            _nodes.clear();
+            _timestamps.clear();
+
+            if (_sync_pending) {
+                _sync_pending = false;
+                ++_scan_sequence;
+            }
+        }
+
+        size_t _max_count;  // owned by the producer
+        std::atomic<size_t> _capacity;
+
+        std::atomic<ISectorListener*> _listener;
+        std::atomic<int>    _sector_width_q14;
+        std::atomic<bool>   _reset_requested;
+
+        // owned by the producer
+        int    _active_width_q14;
+        int    _sector_count;
+        int    _current_sector;
+        bool   _sync_pending;
+        _u64   _scan_sequence;
+        internal::sdk_vector<T>    _nodes;
+        internal::sdk_vector<_u64> _timestamps;
+    };
+
+    // The validated sample packets of the newest revolution, kept undecoded until a grab decodes them
+    // A revolution holds the packets from the one before its start to the one starting the next revolution,
+    // the capsules need both neighbours to decode the nodes at each end. The producer and the consumer
+    // each own a buffer and swap it with the published one under the locker, once per revolution.
+    class DeferredScanHolder
+    {
+    public:
+        struct Packet
+        {
+            size_t offset;  // in the bytes of the revolution
+            size_t size;
+            _u64   timestamp_uS;
+        };
+
+        struct Revolution
+        {
+            Revolution() : ans_type(0) {}
+
+            void clear()
+            {
+                bytes.clear();
+                packets.clear();
+            }
+
+            void append(_u64 timestamp_uS, const void* packet, size_t size)
+            {
+                Packet entry = { bytes.size(), size, timestamp_uS };
+                const _u8* data = reinterpret_cast<const _u8*>(packet);
+                bytes.insert(bytes.end(), data, data + size);
+                packets.push_back(entry);
+            }
+
+            void swap(Revolution& other)
+            {
+                std::swap(ans_type, other.ans_type);
+                bytes.swap(other.bytes);
+                packets.swap(other.packets);
+            }
+
+            _u8 ans_type;
+            internal::sdk_vector<_u8>    bytes;
+            internal::sdk_vector<Packet> packets;
+        };
+
+        DeferredScanHolder()
+            : _locker(false, true)
+            , _ready_notifier(nullptr)
+            , _has_new(false)
+            , _reset_requested(false)
+            , _started(false)
+        {
+        }
+
+        // drops the published revolution now and the partial one on the next push
+        void reset()
+        {
+            rp::hal::AutoLocker l(_locker);
+            _has_new = false;
+            _data_waiter.set(false);
+            if (_ready_notifier) _ready_notifier->clear();
+            _reset_requested.store(true, std::memory_order_release);
+        }
+
+        // the notifier is set while a published revolution has not been taken yet
+        void setReadyNotifier(rp::hal::Notifier* notifier)
+        {
+            rp::hal::AutoLocker l(_locker);
+            _ready_notifier = notifier;
+            if (_ready_notifier) _ready_notifier->set(_has_new);
+        }
+
+        // producer side
+        void pushPacket(_u8 ansType, _u64 timestamp_uS, const void* packet, size_t size, bool revolutionStart)
+        {
+            if (_reset_requested.exchange(false, std::memory_order_acq_rel) || ansType != _filling.ans_type) {
+                _filling.clear();
+                _filling.ans_type = ansType;
+                _started = false;
+            }
+
+            if (!_started) {
+                // only the packet right before the first start is needed
+                if (!revolutionStart) _filling.clear();
+                _filling.append(timestamp_uS, packet, size);
+                _started = revolutionStart;
+                return;
+            }
+
+            _filling.append(timestamp_uS, packet, size);
+            if (revolutionStart) _publish();
+        }
+
+        // swaps the newest revolution into the given one, false if none arrives within the timeout
+        bool waitAndTake(Revolution& revolution, _u32 timeout)
+        {
+            if (_data_waiter.wait(timeout) != rp::hal::Event::EVENT_OK) return false;
+
+            rp::hal::AutoLocker l(_locker);
+            if (!_has_new) return false;
+            _published.swap(revolution);
+            _has_new = false;
+            if (_ready_notifier) _ready_notifier->clear();
+            return true;
+        }
+
+    protected:
+        void _publish()
+        {
+            {
+                rp::hal::AutoLocker l(_locker);
+                _published.swap(_filling);
+                _has_new = true;
+
+                // the next revolution starts from the last two packets of this one
+                _filling.clear();
+                _filling.ans_type = _published.ans_type;
+                size_t count = _published.packets.size();
+                for (size_t pos = count - 2; pos < count; ++pos) {
+                    const Packet& entry = _published.packets[pos];
+                    _filling.append(entry.timestamp_uS, &_published.bytes[entry.offset], entry.size);
+                }
+                if (_ready_notifier) _ready_notifier->set();
+            }
+            _data_waiter.set();
+        }
+
+        rp::hal::Locker  _locker;
+        rp::hal::Event   _data_waiter;
+        rp::hal::Notifier* _ready_notifier;
+        Revolution       _published;
+        bool             _has_new;
+        std::atomic<bool> _reset_requested;
+
+        // owned by the producer
+        Revolution       _filling;
+        bool             _started;
+    };
+
+}
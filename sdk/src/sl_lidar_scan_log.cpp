@@ -0,0 +1,340 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/byteorder.h"
+#include "hal/mapped_file.h"
+
+#include "sl_lidar_scan_log.h"
+#include "sl_lidar_scan_log_codec.h"
+
+#include <vector>
+#include <algorithm>
+
+namespace sl {
+
+    namespace internal {
+
+        enum {
+            SCAN_LOG_MAGIC = 0x47534C53, // "SLSG"
+            SCAN_LOG_VERSION = 1,
+        };
+
+#if defined(_WIN32)
+#pragma pack(1)
+#endif
+
+        typedef struct _scan_log_file_header_t {
+            _u32 magic;
+            _u16 version;
+            _u16 node_size;     // sizeof(sl_lidar_response_measurement_node_hq_t)
+            _u64 reserved;
+        } __attribute__((packed)) ScanLogFileHeader;
+
+        typedef struct _scan_log_block_header_t {
+            _u64 timestamp_uS;
+            _u32 node_count;
+            _u32 payload_size;  // the bytes following the header
+            _u8  encoding;      // LIDAR_SCAN_LOG_ENCODING_xxx
+            _u8  reserved[7];   // keeps the nodes of the raw blocks 8 bytes aligned
+        } __attribute__((packed)) ScanLogBlockHeader;
+
+        typedef struct _scan_log_index_entry_t {
+            _u64 timestamp_uS;
+            _u64 offset;        // the file offset of the block header
+        } __attribute__((packed)) ScanLogIndexEntry;
+
+        typedef struct _scan_log_footer_t {
+            _u64 index_offset;
+            _u64 scan_count;
+            _u32 magic;
+            _u32 reserved;
+        } __attribute__((packed)) ScanLogFooter;
+
+#if defined(_WIN32)
+#pragma pack()
+#endif
+
+    }
+
+    using namespace internal;
+
+    static bool _isStartedBy(const ScanLogIndexEntry& entry, sl_u64 timestamp_uS)
+    {
+        return le64_to_cpu(entry.timestamp_uS) <= timestamp_uS;
+    }
+
+    class ScanLogWriter : public ILidarScanLogWriter
+    {
+    public:
+        ScanLogWriter(LidarScanLogEncoding encoding)
+            : _fp(NULL)
+            , _offset(0)
+            , _encoding(encoding)
+        {
+        }
+
+        ~ScanLogWriter()
+        {
+            close();
+        }
+
+        sl_result open(const std::string& path)
+        {
+            _fp = fopen(path.c_str(), "wb");
+            if (!_fp) return SL_RESULT_OPERATION_FAIL;
+
+            ScanLogFileHeader header;
+            header.magic = cpu_to_le32(SCAN_LOG_MAGIC);
+            header.version = cpu_to_le16(SCAN_LOG_VERSION);
+            header.node_size = cpu_to_le16(sizeof(sl_lidar_response_measurement_node_hq_t));
+            header.reserved = 0;
+            return _write(&header, sizeof(header));
+        }
+
+        sl_result appendScan(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS)
+        {
+            if (!_fp) return SL_RESULT_OPERATION_FAIL;
+            if (!_index.empty() && le64_to_cpu(_index.back().timestamp_uS) > timestamp_uS) return SL_RESULT_INVALID_DATA;
+
+            ScanLogIndexEntry entry;
+            entry.timestamp_uS = cpu_to_le64(timestamp_uS);
+            entry.offset = cpu_to_le64(_offset);
+
+            const void* payload = nodes;
+            size_t payloadSize = count * sizeof(*nodes);
+            if (_encoding == LIDAR_SCAN_LOG_ENCODING_DELTA) {
+                _encodeBuffer.clear();
+                encodeScanNodes(nodes, count, _encodeBuffer);
+                payload = &_encodeBuffer[0];
+                payloadSize = _encodeBuffer.size();
+            }
+
+            ScanLogBlockHeader header;
+            memset(&header, 0, sizeof(header));
+            header.timestamp_uS = cpu_to_le64(timestamp_uS);
+            header.node_count = cpu_to_le32((_u32)count);
+            header.payload_size = cpu_to_le32((_u32)payloadSize);
+            header.encoding = (_u8)_encoding;
+
+            sl_result ans = _write(&header, sizeof(header));
+            if (IS_OK(ans) && payloadSize) ans = _write(payload, payloadSize);
+            if (IS_FAIL(ans)) return ans;
+
+            _index.push_back(entry);
+            return SL_RESULT_OK;
+        }
+
+        sl_result close()
+        {
+            if (!_fp) return SL_RESULT_OK;
+
+            ScanLogFooter footer;
+            footer.index_offset = cpu_to_le64(_offset);
+            footer.scan_count = cpu_to_le64(_index.size());
+            footer.magic = cpu_to_le32(SCAN_LOG_MAGIC);
+            footer.reserved = 0;
+
+            sl_result ans = SL_RESULT_OK;
+            if (!_index.empty()) ans = _write(&_index[0], _index.size() * sizeof(ScanLogIndexEntry));
+            if (IS_OK(ans)) ans = _write(&footer, sizeof(footer));
+            if (fclose(_fp) != 0) ans = SL_RESULT_OPERATION_FAIL;
+
+            _fp = NULL;
+            _index.clear();
+            return ans;
+        }
+
+    private:
+        sl_result _write(const void* data, size_t size)
+        {
+            if (fwrite(data, 1, size, _fp) != size) return SL_RESULT_OPERATION_FAIL;
+            _offset += size;
+            return SL_RESULT_OK;
+        }
+
+        FILE* _fp;
+        _u64 _offset;
+        LidarScanLogEncoding _encoding;
+        std::vector<ScanLogIndexEntry> _index;
+        std::vector<_u8> _encodeBuffer;
+    };
+
+    class ScanLogReader : public ILidarScanLogReader
+    {
+    public:
+        ScanLogReader()
+            : _index(NULL)
+            , _scanCount(0)
+            , _blocksEnd(0)
+        {
+        }
+
+        sl_result open(const std::string& path)
+        {
+            if (!_file.open(path.c_str())) return SL_RESULT_OPERATION_FAIL;
+
+            const _u8* data = _file.data();
+            size_t size = _file.size();
+            if (size < sizeof(ScanLogFileHeader)) return SL_RESULT_INVALID_DATA;
+
+            const ScanLogFileHeader* header = reinterpret_cast<const ScanLogFileHeader*>(data);
+            if (le32_to_cpu(header->magic) != SCAN_LOG_MAGIC
+                || le16_to_cpu(header->version) != SCAN_LOG_VERSION
+                || le16_to_cpu(header->node_size) != sizeof(sl_lidar_response_measurement_node_hq_t)) {
+                return SL_RESULT_INVALID_DATA;
+            }
+
+            if (size >= sizeof(ScanLogFileHeader) + sizeof(ScanLogFooter)) {
+                const ScanLogFooter* footer = reinterpret_cast<const ScanLogFooter*>(data + size - sizeof(ScanLogFooter));
+                _u64 indexOffset = le64_to_cpu(footer->index_offset);
+                _u64 scanCount = le64_to_cpu(footer->scan_count);
+                size_t indexEnd = size - sizeof(ScanLogFooter);
+                if (le32_to_cpu(footer->magic) == SCAN_LOG_MAGIC && indexOffset <= indexEnd
+                    && scanCount == (indexEnd - indexOffset) / sizeof(ScanLogIndexEntry)
+                    && scanCount * sizeof(ScanLogIndexEntry) == indexEnd - indexOffset) {
+                    _index = reinterpret_cast<const ScanLogIndexEntry*>(data + indexOffset);
+                    _scanCount = (size_t)scanCount;
+                    _blocksEnd = (size_t)indexOffset;
+                    return SL_RESULT_OK;
+                }
+            }
+
+            _rebuildIndex();
+            return SL_RESULT_OK;
+        }
+
+        size_t getScanCount() const
+        {
+            return _scanCount;
+        }
+
+        sl_result getScan(size_t index, LidarScanLogEntry& scan) const
+        {
+            if (index >= _scanCount) return SL_RESULT_INVALID_DATA;
+
+            _u64 offset = le64_to_cpu(_index[index].offset);
+            if (offset + sizeof(ScanLogBlockHeader) > _blocksEnd) return SL_RESULT_INVALID_DATA;
+
+            const ScanLogBlockHeader* header = reinterpret_cast<const ScanLogBlockHeader*>(_file.data() + offset);
+            size_t count = le32_to_cpu(header->node_count);
+            size_t payloadSize = le32_to_cpu(header->payload_size);
+            if (payloadSize > _blocksEnd - offset - sizeof(ScanLogBlockHeader)) return SL_RESULT_INVALID_DATA;
+
+            const _u8* payload = reinterpret_cast<const _u8*>(header + 1);
+            switch (header->encoding) {
+            case LIDAR_SCAN_LOG_ENCODING_RAW:
+                if (payloadSize != count * sizeof(sl_lidar_response_measurement_node_hq_t)) return SL_RESULT_INVALID_DATA;
+                scan.nodes = reinterpret_cast<const sl_lidar_response_measurement_node_hq_t*>(payload);
+                break;
+            case LIDAR_SCAN_LOG_ENCODING_DELTA:
+                // each node takes at least 1 byte of angle and 1 byte of distance
+                if (count > payloadSize) return SL_RESULT_INVALID_DATA;
+                _decodeBuffer.resize(std::max<size_t>(count, 1));
+                if (!decodeScanNodes(payload, payloadSize, &_decodeBuffer[0], count)) return SL_RESULT_INVALID_DATA;
+                scan.nodes = &_decodeBuffer[0];
+                break;
+            default:
+                return SL_RESULT_OPERATION_NOT_SUPPORT;
+            }
+            scan.count = count;
+            scan.timestamp_uS = le64_to_cpu(header->timestamp_uS);
+            return SL_RESULT_OK;
+        }
+
+        size_t findScan(sl_u64 timestamp_uS) const
+        {
+            const ScanLogIndexEntry* found = std::partition_point(_index, _index + _scanCount,
+                [timestamp_uS](const ScanLogIndexEntry& entry) { return _isStartedBy(entry, timestamp_uS); });
+            return (found == _index) ? 0 : (size_t)(found - _index - 1);
+        }
+
+    private:
+        // the writer did not close the log, walk the complete blocks
+        void _rebuildIndex()
+        {
+            const _u8* data = _file.data();
+            size_t size = _file.size();
+            size_t offset = sizeof(ScanLogFileHeader);
+
+            _rebuiltIndex.clear();
+            while (offset + sizeof(ScanLogBlockHeader) <= size) {
+                const ScanLogBlockHeader* header = reinterpret_cast<const ScanLogBlockHeader*>(data + offset);
+                size_t blockSize = sizeof(ScanLogBlockHeader) + (size_t)le32_to_cpu(header->payload_size);
+                if (blockSize > size - offset) break;
+
+                ScanLogIndexEntry entry;
+                entry.timestamp_uS = header->timestamp_uS;
+                entry.offset = cpu_to_le64(offset);
+                _rebuiltIndex.push_back(entry);
+                offset += blockSize;
+            }
+
+            _index = _rebuiltIndex.empty() ? NULL : &_rebuiltIndex[0];
+            _scanCount = _rebuiltIndex.size();
+            _blocksEnd = offset;
+        }
+
+        rp::hal::MappedFile _file;
+        const ScanLogIndexEntry* _index;    // points into the file, or to _rebuiltIndex
+        size_t _scanCount;
+        size_t _blocksEnd;
+        std::vector<ScanLogIndexEntry> _rebuiltIndex;
+        mutable std::vector<sl_lidar_response_measurement_node_hq_t> _decodeBuffer;  // the last delta encoded scan returned
+    };
+
+    Result<ILidarScanLogWriter*> createScanLogWriter(const std::string& path, LidarScanLogEncoding encoding)
+    {
+        if (encoding != LIDAR_SCAN_LOG_ENCODING_RAW && encoding != LIDAR_SCAN_LOG_ENCODING_DELTA) return SL_RESULT_INVALID_DATA;
+
+        ScanLogWriter* writer = new ScanLogWriter(encoding);
+        sl_result ans = writer->open(path);
+        if (IS_FAIL(ans)) {
+            delete writer;
+            return ans;
+        }
+        return (ILidarScanLogWriter*)writer;
+    }
+
+    Result<ILidarScanLogReader*> createScanLogReader(const std::string& path)
+    {
+        ScanLogReader* reader = new ScanLogReader();
+        sl_result ans = reader->open(path);
+        if (IS_FAIL(ans)) {
+            delete reader;
+            return ans;
+        }
+        return (ILidarScanLogReader*)reader;
+    }
+}
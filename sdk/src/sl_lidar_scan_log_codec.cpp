@@ -0,0 +1,245 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/byteorder.h"
+
+#include "sl_lidar_driver.h"
+#include "sl_lidar_scan_log_codec.h"
+
+namespace sl { namespace internal {
+
+static inline _u32 _zigzag(_s32 v)
+{
+    return ((_u32)v << 1) ^ (_u32)(v >> 31);
+}
+
+static inline _s32 _unzigzag(_u32 v)
+{
+    return (_s32)(v >> 1) ^ -(_s32)(v & 1);
+}
+
+static inline void _putVarint(_u32 v, std::vector<_u8>& output)
+{
+    while (v >= 0x80) {
+        output.push_back((_u8)(v | 0x80));
+        v >>= 7;
+    }
+    output.push_back((_u8)v);
+}
+
+// false on a truncated or overlong varint
+static inline bool _getVarint(const _u8*& pos, const _u8* end, _u32& v)
+{
+    // most of the values fit in a single byte
+    if (pos < end && *pos < 0x80) {
+        v = *pos++;
+        return true;
+    }
+
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (pos >= end) return false;
+        _u8 b = *pos++;
+        v |= (_u32)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static inline _u16 _expectedAngleStep(size_t count)
+{
+    // a scan covers 360 degrees, 65536 in q14
+    return count ? (_u16)((65536 + count / 2) / count) : 0;
+}
+
+static void _putStreamSize(size_t offset, size_t size, std::vector<_u8>& output)
+{
+    _u32 v = cpu_to_le32((_u32)size);
+    memcpy(&output[offset], &v, sizeof(v));
+}
+
+void encodeScanNodes(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, std::vector<_u8>& output)
+{
+    size_t headerPos = output.size();
+    output.resize(headerPos + 2 * sizeof(_u32));
+
+    _u16 step = _expectedAngleStep(count);
+    _u16 lastAngle = 0;
+    for (size_t pos = 0; pos < count; ++pos) {
+        _u16 residual = (_u16)(nodes[pos].angle_z_q14 - lastAngle - step);
+        _putVarint(_zigzag((_s16)residual), output);
+        lastAngle = nodes[pos].angle_z_q14;
+    }
+    size_t distPos = output.size();
+    _putStreamSize(headerPos, distPos - headerPos - 2 * sizeof(_u32), output);
+
+    _u32 lastDist = 0;
+    for (size_t pos = 0; pos < count; ++pos) {
+        _putVarint(_zigzag((_s32)(nodes[pos].dist_mm_q2 - lastDist)), output);
+        lastDist = nodes[pos].dist_mm_q2;
+    }
+    _putStreamSize(headerPos + sizeof(_u32), output.size() - distPos, output);
+
+    for (size_t pos = 0; pos < count; ) {
+        size_t runEnd = pos + 1;
+        while (runEnd < count && nodes[runEnd].quality == nodes[pos].quality && nodes[runEnd].flag == nodes[pos].flag) {
+            ++runEnd;
+        }
+        output.push_back(nodes[pos].quality);
+        output.push_back(nodes[pos].flag);
+        _putVarint((_u32)(runEnd - pos), output);
+        pos = runEnd;
+    }
+}
+
+bool decodeScanNodes(const _u8* data, size_t size, sl_lidar_response_measurement_node_hq_t* nodes, size_t count)
+{
+    if (size < 2 * sizeof(_u32)) return false;
+
+    _u32 angleSize, distSize;
+    memcpy(&angleSize, data, sizeof(_u32));
+    memcpy(&distSize, data + sizeof(_u32), sizeof(_u32));
+    angleSize = le32_to_cpu(angleSize);
+    distSize = le32_to_cpu(distSize);
+
+    const _u8* end = data + size;
+    const _u8* angleStream = data + 2 * sizeof(_u32);
+    if (angleSize > (size_t)(end - angleStream)) return false;
+    const _u8* distStream = angleStream + angleSize;
+    if (distSize > (size_t)(end - distStream)) return false;
+    const _u8* qualityStream = distStream + distSize;
+
+    const _u8* pos = angleStream;
+    const _u8* streamEnd = distStream;
+    _u16 step = _expectedAngleStep(count);
+    _u16 angle = 0;
+    for (size_t idx = 0; idx < count; ++idx) {
+        _u32 v;
+        if (!_getVarint(pos, streamEnd, v)) return false;
+        angle = (_u16)(angle + step + (_u16)_unzigzag(v));
+        nodes[idx].angle_z_q14 = angle;
+    }
+    if (pos != streamEnd) return false;
+
+    pos = distStream;
+    streamEnd = qualityStream;
+    _u32 dist = 0;
+    for (size_t idx = 0; idx < count; ++idx) {
+        _u32 v;
+        if (!_getVarint(pos, streamEnd, v)) return false;
+        dist += (_u32)_unzigzag(v);
+        nodes[idx].dist_mm_q2 = dist;
+    }
+    if (pos != streamEnd) return false;
+
+    pos = qualityStream;
+    size_t idx = 0;
+    while (idx < count) {
+        if (end - pos < 2) return false;
+        _u8 quality = pos[0];
+        _u8 flag = pos[1];
+        pos += 2;
+
+        _u32 run;
+        if (!_getVarint(pos, end, run) || !run || run > count - idx) return false;
+        for (size_t runEnd = idx + run; idx < runEnd; ++idx) {
+            nodes[idx].quality = quality;
+            nodes[idx].flag = flag;
+        }
+    }
+    return pos == end;
+}
+
+size_t encodeScanDelta(const sl_lidar_response_measurement_node_hq_t* nodes, const sl_lidar_response_measurement_node_hq_t* reference, size_t count,
+    _u32 distThreshold_q2, _u8 qualityThreshold, std::vector<_u8>& output)
+{
+    size_t headerPos = output.size();
+    output.resize(headerPos + sizeof(_u32));
+
+    size_t changed = 0;
+    size_t lastIdx = 0;
+    for (size_t idx = 0; idx < count; ++idx) {
+        _s32 distChange = (_s32)(nodes[idx].dist_mm_q2 - reference[idx].dist_mm_q2);
+        int qualityChange = (int)nodes[idx].quality - (int)reference[idx].quality;
+        if ((_u32)(distChange < 0 ? -distChange : distChange) <= distThreshold_q2
+            && (qualityChange < 0 ? -qualityChange : qualityChange) <= qualityThreshold
+            && nodes[idx].flag == reference[idx].flag) {
+            continue;
+        }
+
+        _putVarint((_u32)(idx - lastIdx), output);
+        _putVarint(_zigzag((_s16)(_u16)(nodes[idx].angle_z_q14 - reference[idx].angle_z_q14)), output);
+        _putVarint(_zigzag(distChange), output);
+        output.push_back(nodes[idx].quality);
+        output.push_back(nodes[idx].flag);
+        lastIdx = idx;
+        ++changed;
+    }
+
+    _putStreamSize(headerPos, changed, output);
+    return changed;
+}
+
+bool applyScanDelta(const _u8* data, size_t size, sl_lidar_response_measurement_node_hq_t* nodes, size_t count)
+{
+    if (size < sizeof(_u32)) return false;
+
+    _u32 changed;
+    memcpy(&changed, data, sizeof(_u32));
+    changed = le32_to_cpu(changed);
+    if (changed > count) return false;
+
+    const _u8* pos = data + sizeof(_u32);
+    const _u8* end = data + size;
+
+    size_t idx = 0;
+    for (_u32 change = 0; change < changed; ++change) {
+        _u32 gap, angleChange, distChange;
+        if (!_getVarint(pos, end, gap) || !_getVarint(pos, end, angleChange) || !_getVarint(pos, end, distChange)) return false;
+        // the gap is 0 for the first node only
+        if ((change && !gap) || gap >= count - idx) return false;
+        if (end - pos < 2) return false;
+
+        idx += gap;
+        nodes[idx].angle_z_q14 = (_u16)(nodes[idx].angle_z_q14 + (_u16)_unzigzag(angleChange));
+        nodes[idx].dist_mm_q2 += (_u32)_unzigzag(distChange);
+        nodes[idx].quality = pos[0];
+        nodes[idx].flag = pos[1];
+        pos += 2;
+    }
+    return pos == end;
+}
+
+}}
@@ -0,0 +1,67 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include <vector>
+
+// Compact coding of the nodes of a scan, used by the delta encoded blocks of the scan log.
+// Users must include sdkcommon.h and sl_lidar_driver.h first.
+//
+// Each field goes into a stream of its own so that the decoder runs a tight loop per field:
+//   _u32 angle stream size, _u32 distance stream size (little endian)
+//   angle stream      zigzag varint of the angle step minus the expected 360 / count step
+//   distance stream   zigzag varint of the distance change from the previous node
+//   quality stream    runs of (quality, flag, varint run length)
+
+namespace sl { namespace internal {
+
+// appends the coded nodes to the output
+void encodeScanNodes(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, std::vector<_u8>& output);
+
+// false if the data is corrupted or does not hold exactly count nodes
+bool decodeScanNodes(const _u8* data, size_t size, sl_lidar_response_measurement_node_hq_t* nodes, size_t count);
+
+// Delta coding of a scan against a reference scan of the same node count, e.g. the fixed angle bins of two
+// revolutions: only the nodes whose distance moved by more than distThreshold_q2 or whose quality moved by more
+// than qualityThreshold (or whose flag changed) are kept, the others stay as in the reference.
+//   _u32 count of the changed nodes (little endian), then for each one
+//   varint index gap from the previous changed node, zigzag varint of the angle and of the distance change from
+//   the reference node, quality, flag
+// Returns the count of the changed nodes.
+size_t encodeScanDelta(const sl_lidar_response_measurement_node_hq_t* nodes, const sl_lidar_response_measurement_node_hq_t* reference, size_t count,
+    _u32 distThreshold_q2, _u8 qualityThreshold, std::vector<_u8>& output);
+
+// updates the nodes, holding the reference scan, with the changes; false if the data is corrupted
+bool applyScanDelta(const _u8* data, size_t size, sl_lidar_response_measurement_node_hq_t* nodes, size_t count);
+
+}}
@@ -0,0 +1,360 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/shared_memory.h"
+
+#include "sl_lidar_scan_shm.h"
+
+#include <atomic>
+#include <algorithm>
+#include <new>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <limits.h>
+#endif
+
+namespace sl {
+
+    namespace internal {
+
+        enum {
+            SCAN_SHM_MAGIC = 0x4D534C53, // "SLSM"
+            SCAN_SHM_VERSION = 2,
+            SCAN_SHM_ALIGNMENT = 64,
+            // the attempts of a reader to find a slot not being rewritten
+            SCAN_SHM_READ_ATTEMPTS = 16,
+        };
+
+        // the segment is only shared within the host, so the fields are in the native byte order
+        struct ScanShmHeader {
+            std::atomic<_u32> magic;    // set last by the writer, once the slots are initialized
+            _u16 version;
+            _u16 node_size;             // sizeof(sl_lidar_response_measurement_node_hq_t)
+            _u32 slot_count;
+            _u32 slot_capacity;         // the nodes of a slot
+            _u64 slot_offset;           // the offset of the first slot in the segment
+            _u64 slot_stride;           // the bytes of each slot, its header included
+            std::atomic<_u64> published;  // the sequence of the latest complete scan, 0 before the first one
+            std::atomic<_u32> publish_word; // the low bits of published, the readers of waitNextScan sleep on it
+            _u8  reserved[20];
+        };
+
+        // the counter is odd while the slot is written, the other fields are only consistent with an even one
+        struct ScanShmSlotHeader {
+            std::atomic<_u64> version;
+            std::atomic<_u64> sequence;
+            std::atomic<_u64> timestamp_uS;
+            std::atomic<_u64> end_timestamp_uS;
+            std::atomic<_u32> count;
+            std::atomic<_u32> truncated_count;
+            _u8  reserved[24];          // keeps the nodes cache line aligned
+        };
+
+        static size_t _alignUp(size_t size)
+        {
+            return (size + SCAN_SHM_ALIGNMENT - 1) & ~(size_t)(SCAN_SHM_ALIGNMENT - 1);
+        }
+
+        static size_t _getSlotStride(size_t slotCapacity)
+        {
+            return _alignUp(sizeof(ScanShmSlotHeader) + slotCapacity * sizeof(sl_lidar_response_measurement_node_hq_t));
+        }
+
+#if defined(__linux__)
+        // the futex is shared between the processes mapping the segment, so it has no FUTEX_PRIVATE_FLAG;
+        // the readers map the segment read only, which is enough to wait on it
+        static void _waitPublishWord(const std::atomic<_u32>& word, _u32 expected, _u32 timeoutMs)
+        {
+            struct timespec timeout;
+            timeout.tv_sec = timeoutMs / 1000;
+            timeout.tv_nsec = (long)(timeoutMs % 1000) * 1000000;
+            syscall(SYS_futex, &word, FUTEX_WAIT, expected, &timeout, NULL, 0);
+        }
+
+        static void _wakePublishWord(std::atomic<_u32>& word)
+        {
+            syscall(SYS_futex, &word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+        }
+#endif
+
+    }
+
+    using namespace internal;
+
+    class ScanShmWriter : public ILidarScanShmWriter
+    {
+    public:
+        ScanShmWriter()
+            : _header(NULL)
+            , _published(0)
+        {
+        }
+
+        sl_result create(const std::string& name, size_t slotCount, size_t slotCapacity)
+        {
+            if (name.empty() || slotCount < 2 || slotCount > 0xFFFF || !slotCapacity || slotCapacity > 0x100000) return SL_RESULT_INVALID_DATA;
+
+            size_t slotOffset = _alignUp(sizeof(ScanShmHeader));
+            size_t slotStride = _getSlotStride(slotCapacity);
+            if (!_segment.create(name.c_str(), slotOffset + slotStride * slotCount)) return SL_RESULT_OPERATION_FAIL;
+
+            _header = new (_segment.data()) ScanShmHeader();
+            _header->version = SCAN_SHM_VERSION;
+            _header->node_size = sizeof(sl_lidar_response_measurement_node_hq_t);
+            _header->slot_count = (_u32)slotCount;
+            _header->slot_capacity = (_u32)slotCapacity;
+            _header->slot_offset = slotOffset;
+            _header->slot_stride = slotStride;
+            _header->published.store(0, std::memory_order_relaxed);
+            _header->publish_word.store(0, std::memory_order_relaxed);
+            memset(_header->reserved, 0, sizeof(_header->reserved));
+
+            for (size_t pos = 0; pos < slotCount; ++pos) {
+                ScanShmSlotHeader* slot = new (_getSlot(pos)) ScanShmSlotHeader();
+                slot->version.store(0, std::memory_order_relaxed);
+                slot->sequence.store(0, std::memory_order_relaxed);
+            }
+            _header->magic.store(SCAN_SHM_MAGIC, std::memory_order_release);
+            return SL_RESULT_OK;
+        }
+
+        sl_result publishScan(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS, sl_u64 end_timestamp_uS)
+        {
+            if (!nodes && count) return SL_RESULT_INVALID_DATA;
+
+            sl_u64 sequence = _published + 1;
+            ScanShmSlotHeader* slot = _getSlot((size_t)((sequence - 1) % _header->slot_count));
+            size_t storedCount = std::min(count, (size_t)_header->slot_capacity);
+
+            // the readers of the slot see the odd counter before any of the new nodes
+            _u64 version = slot->version.load(std::memory_order_relaxed);
+            slot->version.store(version + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            if (storedCount) memcpy(_getSlotNodes(slot), nodes, storedCount * sizeof(*nodes));
+            slot->sequence.store(sequence, std::memory_order_relaxed);
+            slot->timestamp_uS.store(timestamp_uS, std::memory_order_relaxed);
+            slot->end_timestamp_uS.store(end_timestamp_uS, std::memory_order_relaxed);
+            slot->count.store((_u32)storedCount, std::memory_order_relaxed);
+            slot->truncated_count.store((_u32)(count - storedCount), std::memory_order_relaxed);
+
+            slot->version.store(version + 2, std::memory_order_release);
+            _header->published.store(sequence, std::memory_order_release);
+            _header->publish_word.store((_u32)sequence, std::memory_order_release);
+#if defined(__linux__)
+            // a syscall per scan, whether a reader is waiting or not: the readers cannot count themselves
+            // in a segment they map read only
+            _wakePublishWord(_header->publish_word);
+#endif
+            _published = sequence;
+            return SL_RESULT_OK;
+        }
+
+        sl_u64 getPublishedSequence() const
+        {
+            return _published;
+        }
+
+        void onScanComplete(const LidarScanLease& scan, sl_u64 timestamp_uS)
+        {
+            // a scan only kept in the SoA layout has no nodes to publish
+            if (scan->nodes) publishScan(scan->nodes, scan->count, timestamp_uS, scan->end_timestamp_uS);
+        }
+
+    private:
+        ScanShmSlotHeader* _getSlot(size_t slot)
+        {
+            return reinterpret_cast<ScanShmSlotHeader*>(_segment.data() + _header->slot_offset + slot * _header->slot_stride);
+        }
+
+        static sl_lidar_response_measurement_node_hq_t* _getSlotNodes(ScanShmSlotHeader* slot)
+        {
+            return reinterpret_cast<sl_lidar_response_measurement_node_hq_t*>(reinterpret_cast<_u8*>(slot) + sizeof(*slot));
+        }
+
+        rp::hal::SharedMemory _segment;
+        ScanShmHeader* _header;
+        sl_u64 _published;
+    };
+
+    class ScanShmReader : public ILidarScanShmReader
+    {
+    public:
+        ScanShmReader()
+            : _header(NULL)
+        {
+        }
+
+        sl_result open(const std::string& name)
+        {
+            if (name.empty()) return SL_RESULT_INVALID_DATA;
+            if (!_segment.open(name.c_str())) return SL_RESULT_OPERATION_FAIL;
+            if (_segment.size() < sizeof(ScanShmHeader)) return SL_RESULT_FORMAT_NOT_SUPPORT;
+
+            const ScanShmHeader* header = reinterpret_cast<const ScanShmHeader*>(_segment.data());
+            if (header->magic.load(std::memory_order_acquire) != SCAN_SHM_MAGIC
+                || header->version != SCAN_SHM_VERSION
+                || header->node_size != sizeof(sl_lidar_response_measurement_node_hq_t)
+                || header->slot_count < 2
+                || header->slot_stride < _getSlotStride(header->slot_capacity)
+                || header->slot_offset < sizeof(ScanShmHeader)
+                || header->slot_offset + header->slot_stride * header->slot_count > _segment.size()) {
+                return SL_RESULT_FORMAT_NOT_SUPPORT;
+            }
+            _header = header;
+            return SL_RESULT_OK;
+        }
+
+        size_t getSlotCount() const
+        {
+            return _header->slot_count;
+        }
+
+        size_t getSlotCapacity() const
+        {
+            return _header->slot_capacity;
+        }
+
+        sl_u64 getPublishedSequence() const
+        {
+            return _header->published.load(std::memory_order_acquire);
+        }
+
+        sl_result getLatestScan(LidarSharedScanView& view) const
+        {
+            for (size_t attempt = 0; attempt < SCAN_SHM_READ_ATTEMPTS; ++attempt) {
+                sl_u64 latest = getPublishedSequence();
+                if (!latest) return SL_RESULT_OPERATION_TIMEOUT;
+                if (_readScan(latest, view)) return SL_RESULT_OK;
+            }
+            return SL_RESULT_OPERATION_TIMEOUT;
+        }
+
+        sl_result getNextScan(sl_u64 afterSequence, LidarSharedScanView& view) const
+        {
+            for (size_t attempt = 0; attempt < SCAN_SHM_READ_ATTEMPTS; ++attempt) {
+                sl_u64 latest = getPublishedSequence();
+                if (latest <= afterSequence) return SL_RESULT_OPERATION_TIMEOUT;
+
+                // the writer rewrites one slot at a time, the oldest one, so the next one in turn is good
+                sl_u64 oldest = latest >= _header->slot_count ? latest - _header->slot_count + 1 : 1;
+                for (sl_u64 sequence = std::max(afterSequence + 1, oldest); sequence <= latest; ++sequence) {
+                    if (_readScan(sequence, view)) return SL_RESULT_OK;
+                }
+            }
+            return SL_RESULT_OPERATION_TIMEOUT;
+        }
+
+        sl_result waitNextScan(sl_u64 afterSequence, LidarSharedScanView& view, sl_u32 timeoutMs) const
+        {
+            _u64 startTs = getms();
+            for (;;) {
+                // read before the check, a scan published after it changes the word and cuts the wait short
+                _u32 publishWord = _header->publish_word.load(std::memory_order_acquire);
+                sl_result ans = getNextScan(afterSequence, view);
+                _u64 elapsedMs = getms() - startTs;
+                if (ans != SL_RESULT_OPERATION_TIMEOUT || elapsedMs >= timeoutMs) return ans;
+#if defined(__linux__)
+                _waitPublishWord(_header->publish_word, publishWord, (_u32)(timeoutMs - elapsedMs));
+#else
+                (void)publishWord;
+                delay(1);
+#endif
+            }
+        }
+
+        bool isScanValid(const LidarSharedScanView& view) const
+        {
+            if (view.slot >= _header->slot_count) return false;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return _getSlot(view.slot)->version.load(std::memory_order_relaxed) == view.version;
+        }
+
+    private:
+        const ScanShmSlotHeader* _getSlot(size_t slot) const
+        {
+            return reinterpret_cast<const ScanShmSlotHeader*>(_segment.data() + _header->slot_offset + slot * _header->slot_stride);
+        }
+
+        // false if the slot holds another scan or is being rewritten
+        bool _readScan(sl_u64 sequence, LidarSharedScanView& view) const
+        {
+            size_t slotIndex = (size_t)((sequence - 1) % _header->slot_count);
+            const ScanShmSlotHeader* slot = _getSlot(slotIndex);
+
+            _u64 version = slot->version.load(std::memory_order_acquire);
+            if (!version || (version & 1)) return false;
+
+            view.nodes = reinterpret_cast<const sl_lidar_response_measurement_node_hq_t*>(reinterpret_cast<const _u8*>(slot) + sizeof(*slot));
+            view.sequence = slot->sequence.load(std::memory_order_relaxed);
+            view.timestamp_uS = slot->timestamp_uS.load(std::memory_order_relaxed);
+            view.end_timestamp_uS = slot->end_timestamp_uS.load(std::memory_order_relaxed);
+            view.count = std::min((size_t)slot->count.load(std::memory_order_relaxed), (size_t)_header->slot_capacity);
+            view.truncated_count = slot->truncated_count.load(std::memory_order_relaxed);
+            view.slot = slotIndex;
+            view.version = version;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return slot->version.load(std::memory_order_relaxed) == version && view.sequence == sequence;
+        }
+
+        rp::hal::SharedMemory _segment;
+        const ScanShmHeader* _header;
+    };
+
+    Result<ILidarScanShmWriter*> createScanShmWriter(const std::string& name, size_t slotCount, size_t slotCapacity)
+    {
+        ScanShmWriter* writer = new ScanShmWriter();
+        sl_result ans = writer->create(name, slotCount, slotCapacity);
+        if (IS_FAIL(ans)) {
+            delete writer;
+            return ans;
+        }
+        return (ILidarScanShmWriter*)writer;
+    }
+
+    Result<ILidarScanShmReader*> createScanShmReader(const std::string& name)
+    {
+        ScanShmReader* reader = new ScanShmReader();
+        sl_result ans = reader->open(name);
+        if (IS_FAIL(ans)) {
+            delete reader;
+            return ans;
+        }
+        return (ILidarScanShmReader*)reader;
+    }
+}
@@ -0,0 +1,578 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/byteorder.h"
+#include "hal/thread.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "hal/socket.h"
+
+#include "sl_lidar_share.h"
+#include "sl_lidar_scan_log_codec.h"
+
+#include <vector>
+#include <algorithm>
+
+namespace sl {
+
+    namespace internal {
+
+        enum {
+            SHARE_MAGIC = 0x48534C53, // "SLSH"
+            SHARE_VERSION = 1,
+            // the scans of the delta mode, a client without it drops them as bad datagrams
+            SHARE_VERSION_DELTA = 2,
+            // the flags of the delta mode
+            SHARE_FLAG_KEYFRAME = 0x1,
+            SHARE_FLAG_DELTA = 0x2,
+            // the coded nodes never take more, see sl_lidar_scan_log_codec.h
+            SHARE_MAX_PAYLOAD_SIZE = LIDAR_SHARE_MAX_SCAN_NODES * 16,
+            SHARE_CLIENT_RX_BUFFER_SIZE = 1024 * 1024,
+            SHARE_CLIENT_WAIT_MS = 100,
+        };
+
+#if defined(_WIN32)
+#pragma pack(1)
+#endif
+
+        // the header of every datagram, followed by its fragment of the coded scan
+        typedef struct _share_datagram_header_t {
+            _u32 magic;
+            _u8  version;
+            _u8  flags;             // SHARE_FLAG_*, 0 in version 1
+            _u16 header_size;       // the newer versions may append fields, the fragment follows the header
+            _u16 fragment_index;
+            _u16 fragment_count;
+            _u32 server_id;         // picked at random by each server, a restarted server starts its sequences again
+            _u64 sequence;          // of the scan, from 1 on
+            _u64 timestamp_uS;
+            _u64 end_timestamp_uS;
+            _u32 node_count;
+            _u32 payload_size;      // the coded scan, all the fragments together
+            _u32 fragment_offset;   // where the fragment goes in the coded scan
+            _u32 base_distance;     // of a delta scan, the sequence of its keyframe is sequence - base_distance
+        } __attribute__((packed)) ShareDatagramHeader;
+
+#if defined(_WIN32)
+#pragma pack()
+#endif
+
+        static sl_result _toGroupAddress(const char* address, int port, rp::net::SocketAddress& group)
+        {
+            if (!address || IS_FAIL(group.setAddressFromString(address))) return SL_RESULT_INVALID_DATA;
+            // 224.0.0.0/4
+            _u8 raw[4];
+            if (IS_FAIL(group.getRawAddress(raw, sizeof(raw))) || (raw[0] & 0xF0) != 0xE0) return SL_RESULT_INVALID_DATA;
+            if (port < 0 || port > 0xFFFF) return SL_RESULT_INVALID_DATA;
+            group.setPort(port ? port : LIDAR_SHARE_DEFAULT_PORT);
+            return SL_RESULT_OK;
+        }
+
+        static sl_result _toInterfaceAddress(const char* address, rp::net::SocketAddress& iface)
+        {
+            if (address && IS_FAIL(iface.setAddressFromString(address))) return SL_RESULT_INVALID_DATA;
+            return SL_RESULT_OK;
+        }
+
+    }
+
+    using namespace internal;
+
+    class LidarShareServer : public ILidarShareServer
+    {
+    public:
+        LidarShareServer()
+            : _socket(NULL)
+            , _serverId(0)
+            , _sequence(0)
+            , _keyframeInterval(0)
+            , _deltaDistance_q2(0)
+            , _deltaQuality(0)
+            , _keyframeSequence(0)
+        {
+            memset(&_stats, 0, sizeof(_stats));
+        }
+
+        virtual ~LidarShareServer()
+        {
+            if (_socket) _socket->dispose();
+        }
+
+        sl_result init(const LidarShareServerOptions& options)
+        {
+            sl_result ans = _toGroupAddress(options.group_address, options.port, _group);
+            if (IS_FAIL(ans)) return ans;
+
+            rp::net::SocketAddress iface;
+            ans = _toInterfaceAddress(options.interface_address, iface);
+            if (IS_FAIL(ans)) return ans;
+
+            size_t datagramSize = options.datagram_size ? options.datagram_size : LIDAR_SHARE_DEFAULT_DATAGRAM_SIZE;
+            if (datagramSize < LIDAR_SHARE_MIN_DATAGRAM_SIZE || datagramSize > LIDAR_SHARE_MAX_DATAGRAM_SIZE) return SL_RESULT_INVALID_DATA;
+            _datagram.resize(datagramSize);
+            _payload.reserve(SHARE_MAX_PAYLOAD_SIZE);
+
+            _keyframeInterval = options.keyframe_interval;
+            _deltaDistance_q2 = options.delta_distance_mm << 2;
+            _deltaQuality = options.delta_quality;
+            if (_keyframeInterval) _keyframe.reserve(LIDAR_SHARE_MAX_SCAN_NODES);
+
+            _socket = rp::net::DGramSocket::CreateSocket();
+            if (!_socket) return SL_RESULT_OPERATION_FAIL;
+            ans = _socket->setMulticastOptions(options.ttl > 0 ? options.ttl : 1, options.loopback, options.interface_address ? &iface : NULL);
+            if (IS_FAIL(ans)) return ans;
+
+            // tells the scans of this server from those of a previous run
+            _serverId = (_u32)(getus() ^ (getus() >> 32) ^ (_u32)(size_t)this);
+            return SL_RESULT_OK;
+        }
+
+        sl_result publishScan(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS, sl_u64 end_timestamp_uS)
+        {
+            if ((!nodes && count) || count > LIDAR_SHARE_MAX_SCAN_NODES) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_locker);
+            ++_sequence;
+            _payload.clear();
+            _u8 flags = 0;
+            _u32 baseDistance = 0;
+            if (_keyframeInterval) {
+                flags = _encodeDelta(nodes, count, baseDistance);
+            } else if (count) {
+                encodeScanNodes(nodes, count, _payload);
+            }
+
+            size_t fragmentCapacity = _datagram.size() - sizeof(ShareDatagramHeader);
+            size_t fragmentCount = std::max<size_t>(1, (_payload.size() + fragmentCapacity - 1) / fragmentCapacity);
+
+            ShareDatagramHeader header;
+            memset(&header, 0, sizeof(header));
+            header.magic = cpu_to_le32(SHARE_MAGIC);
+            header.version = _keyframeInterval ? SHARE_VERSION_DELTA : SHARE_VERSION;
+            header.flags = flags;
+            header.header_size = cpu_to_le16(sizeof(ShareDatagramHeader));
+            header.fragment_count = cpu_to_le16((_u16)fragmentCount);
+            header.server_id = cpu_to_le32(_serverId);
+            header.sequence = cpu_to_le64(_sequence);
+            header.timestamp_uS = cpu_to_le64(timestamp_uS);
+            header.end_timestamp_uS = cpu_to_le64(end_timestamp_uS);
+            header.node_count = cpu_to_le32((_u32)count);
+            header.payload_size = cpu_to_le32((_u32)_payload.size());
+            header.base_distance = cpu_to_le32(baseDistance);
+
+            sl_result ans = SL_RESULT_OK;
+            for (size_t fragment = 0; fragment < fragmentCount; ++fragment) {
+                size_t offset = fragment * fragmentCapacity;
+                size_t fragmentSize = std::min(fragmentCapacity, _payload.size() - offset);
+
+                header.fragment_index = cpu_to_le16((_u16)fragment);
+                header.fragment_offset = cpu_to_le32((_u32)offset);
+                memcpy(&_datagram[0], &header, sizeof(header));
+                if (fragmentSize) memcpy(&_datagram[sizeof(header)], &_payload[offset], fragmentSize);
+
+                if (IS_FAIL(_socket->sendTo(&_group, &_datagram[0], sizeof(header) + fragmentSize))) {
+                    ++_stats.send_errors;
+                    ans = SL_RESULT_OPERATION_FAIL;
+                    continue;
+                }
+                ++_stats.datagrams_sent;
+                _stats.bytes_sent += sizeof(header) + fragmentSize;
+            }
+            ++_stats.scans_sent;
+            return ans;
+        }
+
+        void getStats(LidarShareServerStats& stats)
+        {
+            rp::hal::AutoLocker l(_locker);
+            stats = _stats;
+        }
+
+        void onScanComplete(const LidarScanLease& scan, sl_u64 timestamp_uS)
+        {
+            // the deltas of the bins are much smaller than those of the raw nodes, whose count and angles vary
+            if (_keyframeInterval && scan->bins) {
+                publishScan(scan->bins, std::min<size_t>(scan->bin_count, LIDAR_SHARE_MAX_SCAN_NODES), timestamp_uS, scan->end_timestamp_uS);
+                return;
+            }
+            // a scan only kept in the SoA layout has no nodes to send
+            if (scan->nodes) publishScan(scan->nodes, std::min<size_t>(scan->count, LIDAR_SHARE_MAX_SCAN_NODES), timestamp_uS, scan->end_timestamp_uS);
+        }
+
+    private:
+        // codes the scan as a keyframe or as its changes from the keyframe, returns the flags of the scan
+        _u8 _encodeDelta(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, _u32& baseDistance)
+        {
+            bool isKeyframeDue = !count || !_keyframeSequence || count != _keyframe.size() || _sequence - _keyframeSequence >= _keyframeInterval;
+            if (!isKeyframeDue) {
+                size_t changed = encodeScanDelta(nodes, &_keyframe[0], count, _deltaDistance_q2, _deltaQuality, _payload);
+                // a keyframe costs less than the changes of half of the bins
+                if (changed <= count / 2) {
+                    baseDistance = (_u32)(_sequence - _keyframeSequence);
+                    _stats.delta_bins_sent += changed;
+                    return SHARE_FLAG_DELTA;
+                }
+                _payload.clear();
+            }
+
+            if (count) encodeScanNodes(nodes, count, _payload);
+            _keyframe.assign(nodes, nodes + count);
+            _keyframeSequence = _sequence;
+            ++_stats.keyframes_sent;
+            return SHARE_FLAG_KEYFRAME;
+        }
+
+        rp::hal::Locker         _locker;
+        rp::net::DGramSocket*   _socket;
+        rp::net::SocketAddress  _group;
+        _u32                    _serverId;
+        sl_u64                  _sequence;
+        std::vector<_u8>        _payload;
+        std::vector<_u8>        _datagram;
+        LidarShareServerStats   _stats;
+
+        // the delta mode
+        size_t                  _keyframeInterval;
+        _u32                    _deltaDistance_q2;
+        _u8                     _deltaQuality;
+        sl_u64                  _keyframeSequence;
+        std::vector<sl_lidar_response_measurement_node_hq_t> _keyframe;
+    };
+
+    class LidarShareClient : public ILidarShareClient
+    {
+    public:
+        LidarShareClient()
+            : _socket(NULL)
+            , _isWorking(false)
+            , _serverId(0)
+            , _sequence(0)
+            , _nodeCount(0)
+            , _payloadSize(0)
+            , _fragmentCount(0)
+            , _fragmentsReceived(0)
+            , _timestamp_uS(0)
+            , _end_timestamp_uS(0)
+            , _flags(0)
+            , _baseDistance(0)
+            , _hasScanSource(false)
+            , _keyframeServerId(0)
+            , _keyframeSequence(0)
+            , _keyframeCount(0)
+            , _latestCount(0)
+            , _latestTimestamp_uS(0)
+            , _latestEndTimestamp_uS(0)
+            , _latestSequence(0)
+            , _hasNewScan(false)
+        {
+            memset(&_stats, 0, sizeof(_stats));
+        }
+
+        virtual ~LidarShareClient()
+        {
+            if (_isWorking) {
+                _isWorking = false;
+                _socket->cancelWaits();
+                _rxThread.join();
+            }
+            if (_socket) _socket->dispose();
+        }
+
+        sl_result init(const LidarShareClientOptions& options)
+        {
+            rp::net::SocketAddress group;
+            sl_result ans = _toGroupAddress(options.group_address, options.port, group);
+            if (IS_FAIL(ans)) return ans;
+
+            rp::net::SocketAddress iface;
+            ans = _toInterfaceAddress(options.interface_address, iface);
+            if (IS_FAIL(ans)) return ans;
+
+            _datagram.resize(LIDAR_SHARE_MAX_DATAGRAM_SIZE);
+            _payload.resize(SHARE_MAX_PAYLOAD_SIZE);
+            _fragmentFlags.reserve(SHARE_MAX_PAYLOAD_SIZE / (LIDAR_SHARE_MIN_DATAGRAM_SIZE - sizeof(ShareDatagramHeader)) + 1);
+            _decodedNodes.resize(LIDAR_SHARE_MAX_SCAN_NODES);
+            _latestNodes.resize(LIDAR_SHARE_MAX_SCAN_NODES);
+            _keyframeNodes.resize(LIDAR_SHARE_MAX_SCAN_NODES);
+
+            _socket = rp::net::DGramSocket::CreateSocket();
+            if (!_socket) return SL_RESULT_OPERATION_FAIL;
+
+            // the clients of the same host share the port
+            _socket->enableAddressReuse(true);
+            rp::net::SocketAddress local;
+            local.setAnyAddress();
+            local.setPort(group.getPort());
+            if (IS_FAIL(_socket->bind(local))) return SL_RESULT_OPERATION_FAIL;
+            if (IS_FAIL(_socket->joinMulticastGroup(group, options.interface_address ? &iface : NULL))) return SL_RESULT_OPERATION_FAIL;
+            _socket->setRxBufferSize(SHARE_CLIENT_RX_BUFFER_SIZE);
+
+            _isWorking = true;
+            _rxThread = CLASS_THREAD(LidarShareClient, _proc_rxThread);
+            return SL_RESULT_OK;
+        }
+
+        sl_result grabScanDataHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u32 timeout)
+        {
+            sl_u64 timestamp_uS, end_timestamp_uS, sequence;
+            return grabScanDataHqWithSequence(nodebuffer, count, timestamp_uS, end_timestamp_uS, sequence, timeout);
+        }
+
+        sl_result grabScanDataHqWithTimeStamp(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u64& timestamp_uS, sl_u32 timeout)
+        {
+            sl_u64 end_timestamp_uS, sequence;
+            return grabScanDataHqWithSequence(nodebuffer, count, timestamp_uS, end_timestamp_uS, sequence, timeout);
+        }
+
+        sl_result grabScanDataHqWithSequence(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u64& timestamp_uS, sl_u64& end_timestamp_uS, sl_u64& sequence, sl_u32 timeout)
+        {
+            if (!nodebuffer) return SL_RESULT_INVALID_DATA;
+
+            _u64 deadline = getms() + timeout;
+            for (;;) {
+                {
+                    rp::hal::AutoLocker l(_scanLocker);
+                    if (_hasNewScan) {
+                        count = std::min(count, _latestCount);
+                        std::copy(&_latestNodes[0], &_latestNodes[0] + count, nodebuffer);
+                        timestamp_uS = _latestTimestamp_uS;
+                        end_timestamp_uS = _latestEndTimestamp_uS;
+                        sequence = _latestSequence;
+                        _hasNewScan = false;
+                        return SL_RESULT_OK;
+                    }
+                }
+
+                _u64 now = getms();
+                if (now >= deadline) return SL_RESULT_OPERATION_TIMEOUT;
+                _scanEvent.wait((unsigned long)(deadline - now));
+            }
+        }
+
+        void getStats(LidarShareClientStats& stats)
+        {
+            rp::hal::AutoLocker l(_scanLocker);
+            stats = _stats;
+        }
+
+    private:
+        u_result _proc_rxThread()
+        {
+            rp::hal::Thread::config_t config;
+            memset(&config, 0, sizeof(config));
+            rp::hal::Thread::SetSelfConfig(config, "sl_share_rx", rp::hal::Thread::PRIORITY_NORMAL);
+
+            while (_isWorking) {
+                if (IS_FAIL(_socket->waitforData(SHARE_CLIENT_WAIT_MS))) continue;
+
+                size_t received = 0;
+                if (IS_FAIL(_socket->recvFrom(&_datagram[0], _datagram.size(), received))) continue;
+                _onDatagram(&_datagram[0], received);
+            }
+            return RESULT_OK;
+        }
+
+        void _onDatagram(const _u8* data, size_t size)
+        {
+            ShareDatagramHeader header;
+            if (size < sizeof(header)) {
+                _countDatagram(false);
+                return;
+            }
+            memcpy(&header, data, sizeof(header));
+
+            size_t headerSize = le16_to_cpu(header.header_size);
+            size_t fragmentCount = le16_to_cpu(header.fragment_count);
+            size_t fragmentIndex = le16_to_cpu(header.fragment_index);
+            size_t payloadSize = le32_to_cpu(header.payload_size);
+            size_t fragmentOffset = le32_to_cpu(header.fragment_offset);
+            size_t nodeCount = le32_to_cpu(header.node_count);
+            if (le32_to_cpu(header.magic) != SHARE_MAGIC || (header.version != SHARE_VERSION && header.version != SHARE_VERSION_DELTA)
+                || headerSize < sizeof(header) || headerSize > size
+                || !fragmentCount || fragmentIndex >= fragmentCount
+                || payloadSize > SHARE_MAX_PAYLOAD_SIZE || nodeCount > LIDAR_SHARE_MAX_SCAN_NODES
+                || fragmentOffset > payloadSize || size - headerSize > payloadSize - fragmentOffset
+                || fragmentCount > _fragmentFlags.capacity()) {
+                _countDatagram(false);
+                return;
+            }
+            _countDatagram(true);
+
+            _u32 serverId = le32_to_cpu(header.server_id);
+            sl_u64 sequence = le64_to_cpu(header.sequence);
+            if (!_hasScanSource || serverId != _serverId || sequence != _sequence) {
+                // the late fragments of a scan already given up
+                if (_hasScanSource && serverId == _serverId && sequence < _sequence) return;
+                _beginScan(header, serverId, sequence);
+            }
+
+            if (_fragmentFlags[fragmentIndex]) return;
+            _fragmentFlags[fragmentIndex] = 1;
+            memcpy(&_payload[fragmentOffset], data + headerSize, size - headerSize);
+            if (++_fragmentsReceived == _fragmentCount) _completeScan();
+        }
+
+        void _beginScan(const ShareDatagramHeader& header, _u32 serverId, sl_u64 sequence)
+        {
+            rp::hal::AutoLocker l(_scanLocker);
+            if (_hasScanSource && _fragmentsReceived < _fragmentCount) ++_stats.scans_dropped;
+
+            // no datagram at all came from the scans skipped
+            if (_hasScanSource && serverId == _serverId) _stats.scans_lost += sequence - _sequence - 1;
+            _hasScanSource = true;
+
+            _serverId = serverId;
+            _sequence = sequence;
+            _nodeCount = le32_to_cpu(header.node_count);
+            _payloadSize = le32_to_cpu(header.payload_size);
+            _fragmentCount = le16_to_cpu(header.fragment_count);
+            _fragmentsReceived = 0;
+            _timestamp_uS = le64_to_cpu(header.timestamp_uS);
+            _end_timestamp_uS = le64_to_cpu(header.end_timestamp_uS);
+            _flags = header.version == SHARE_VERSION_DELTA ? header.flags : 0;
+            _baseDistance = le32_to_cpu(header.base_distance);
+            _fragmentFlags.assign(_fragmentCount, 0);
+        }
+
+        void _completeScan()
+        {
+            bool decoded;
+            bool hasKeyframe = true;
+            if (_flags & SHARE_FLAG_DELTA) {
+                // the changes apply to the keyframe held only
+                hasKeyframe = _keyframeCount == _nodeCount && _keyframeServerId == _serverId && _baseDistance
+                    && _keyframeSequence == _sequence - _baseDistance;
+                decoded = hasKeyframe;
+                if (decoded) {
+                    std::copy(&_keyframeNodes[0], &_keyframeNodes[0] + _nodeCount, &_decodedNodes[0]);
+                    decoded = applyScanDelta(&_payload[0], _payloadSize, &_decodedNodes[0], _nodeCount);
+                }
+            } else {
+                decoded = !_nodeCount || decodeScanNodes(&_payload[0], _payloadSize, &_decodedNodes[0], _nodeCount);
+                if (decoded && (_flags & SHARE_FLAG_KEYFRAME)) {
+                    std::copy(&_decodedNodes[0], &_decodedNodes[0] + _nodeCount, &_keyframeNodes[0]);
+                    _keyframeServerId = _serverId;
+                    _keyframeSequence = _sequence;
+                    _keyframeCount = _nodeCount;
+                }
+            }
+
+            rp::hal::AutoLocker l(_scanLocker);
+            if (!decoded) {
+                ++_stats.scans_dropped;
+                if (!hasKeyframe) ++_stats.deltas_without_keyframe;
+                return;
+            }
+            if (_flags & SHARE_FLAG_KEYFRAME) ++_stats.keyframes_received;
+            ++_stats.scans_received;
+            _stats.last_sequence = _sequence;
+
+            _decodedNodes.swap(_latestNodes);
+            _latestCount = _nodeCount;
+            _latestTimestamp_uS = _timestamp_uS;
+            _latestEndTimestamp_uS = _end_timestamp_uS;
+            _latestSequence = _sequence;
+            _hasNewScan = true;
+            _scanEvent.set();
+        }
+
+        void _countDatagram(bool good)
+        {
+            rp::hal::AutoLocker l(_scanLocker);
+            ++_stats.datagrams_received;
+            if (!good) ++_stats.bad_datagrams;
+        }
+
+        rp::net::DGramSocket*   _socket;
+        rp::hal::Thread         _rxThread;
+        volatile bool           _isWorking;
+        std::vector<_u8>        _datagram;
+
+        // the scan being put together, only used by the rx thread
+        _u32                    _serverId;
+        sl_u64                  _sequence;
+        size_t                  _nodeCount;
+        size_t                  _payloadSize;
+        size_t                  _fragmentCount;
+        size_t                  _fragmentsReceived;
+        sl_u64                  _timestamp_uS;
+        sl_u64                  _end_timestamp_uS;
+        _u8                     _flags;
+        _u32                    _baseDistance;
+        bool                    _hasScanSource;
+        std::vector<_u8>        _payload;
+        std::vector<_u8>        _fragmentFlags;
+        std::vector<sl_lidar_response_measurement_node_hq_t> _decodedNodes;
+
+        // the keyframe the delta scans apply to, only used by the rx thread
+        _u32                    _keyframeServerId;
+        sl_u64                  _keyframeSequence;
+        size_t                  _keyframeCount;
+        std::vector<sl_lidar_response_measurement_node_hq_t> _keyframeNodes;
+
+        // the newest complete scan and the stats, guarded by _scanLocker
+        rp::hal::Locker         _scanLocker;
+        rp::hal::Event          _scanEvent;
+        std::vector<sl_lidar_response_measurement_node_hq_t> _latestNodes;
+        size_t                  _latestCount;
+        sl_u64                  _latestTimestamp_uS;
+        sl_u64                  _latestEndTimestamp_uS;
+        sl_u64                  _latestSequence;
+        bool                    _hasNewScan;
+        LidarShareClientStats   _stats;
+    };
+
+    Result<ILidarShareServer*> createLidarShareServer(const LidarShareServerOptions& options)
+    {
+        LidarShareServer* server = new LidarShareServer();
+        sl_result ans = server->init(options);
+        if (IS_FAIL(ans)) {
+            delete server;
+            return ans;
+        }
+        return (ILidarShareServer*)server;
+    }
+
+    Result<ILidarShareClient*> createLidarShareClient(const LidarShareClientOptions& options)
+    {
+        LidarShareClient* client = new LidarShareClient();
+        sl_result ans = client->init(options);
+        if (IS_FAIL(ans)) {
+            delete client;
+            return ans;
+        }
+        return (ILidarShareClient*)client;
+    }
+}
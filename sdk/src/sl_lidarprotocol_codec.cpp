@@ -41,6 +41,7 @@
 #include "hal/locker.h"
 #include "hal/socket.h"
 #include "hal/event.h"
+#include "hal/byte_search.h"
 
 #include "sl_lidar_driver.h"
 #include "sl_crc.h" 
@@ -58,29 +59,150 @@ namespace sl { namespace internal {
 RPLidarProtocolCodec::RPLidarProtocolCodec()
     : IAsyncProtocolCodec()
     , _listener(NULL)
-    , _op_locker(true)
+    , _requests(0)
+    , _working_states(STATUS_WAIT_SYNC1)
+    , _loop_packet_size(0)
+    , _rx_pos(0)
+    , _rx_timestamp_us(0)
+    , _in_stream_ans_total(0)
+    , _probe_pos(0)
+    , _rx_bytes(0)
+    , _messages(0)
+    , _skipped_bytes(0)
+    , _decoder_resets(0)
 {
+    for (size_t pos = 0; pos < sizeof(_in_stream_ans_refs) / sizeof(_in_stream_ans_refs[0]); ++pos) {
+        _in_stream_ans_refs[pos].store(0, std::memory_order_relaxed);
+    }
     onDecodeReset();
+    // the initial reset is not counted
+    _decoder_resets.store(0, std::memory_order_relaxed);
+}
+
+static inline void _addCounter(std::atomic<_u64>& counter, _u64 delta)
+{
+    // the decoding thread is the only writer, no locked read-modify-write is needed
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
 }
 
 void RPLidarProtocolCodec::exitLoopMode() {
-    onDecodeReset();
+    _requests.fetch_or(REQUEST_EXIT_LOOP_MODE, std::memory_order_release);
+}
+
+bool RPLidarProtocolCodec::addInStreamAnswerType(_u8 type)
+{
+    if (_requests.load(std::memory_order_acquire) & REQUEST_EXIT_LOOP_MODE) return false;
+    if (_loop_packet_size.load(std::memory_order_acquire) < sizeof(sl_lidar_ans_header_t)) return false;
+
+    // published before the command is sent, so before its answer is decoded
+    _in_stream_ans_refs[type].fetch_add(1, std::memory_order_release);
+    _in_stream_ans_total.fetch_add(1, std::memory_order_release);
+    return true;
 }
 
+void RPLidarProtocolCodec::removeInStreamAnswerType(_u8 type)
+{
+    _u16 refs = _in_stream_ans_refs[type].load(std::memory_order_relaxed);
+    do {
+        if (!refs) return;
+    } while (!_in_stream_ans_refs[type].compare_exchange_weak(refs, (_u16)(refs - 1), std::memory_order_relaxed));
+
+    _in_stream_ans_total.fetch_sub(1, std::memory_order_relaxed);
+}
 
+void RPLidarProtocolCodec::_setWorkingStates(_u32 states)
+{
+    _working_states = states;
+    if (!(states & STATUS_LOOP_MODE_FLAG)) {
+        _loop_packet_size.store(0, std::memory_order_release);
+    }
+}
+
+// an answer may only start where a loop mode packet would, the bytes are held until its header is told apart
+bool RPLidarProtocolCodec::_beginProbeAnsHeader(_u8 currentByte)
+{
+    if (_rx_pos || currentByte != RPLIDAR_ANS_SYNC_BYTE1 || !_in_stream_ans_total.load(std::memory_order_acquire)) return false;
+
+    _probed_header[0] = currentByte;
+    _probe_pos = 1;
+    _working_states = STATUS_LOOP_MODE_FLAG | STATUS_PROBE_ANS_HEADER;
+    return true;
+}
+
+void RPLidarProtocolCodec::_onAnsHeaderProbed()
+{
+    const sl_lidar_ans_header_t* header = reinterpret_cast<const sl_lidar_ans_header_t*>(_probed_header);
+    _u32 sizeFlag = le32_to_cpu(header->size_q30_subtype);
+
+    if (header->syncByte2 == RPLIDAR_ANS_SYNC_BYTE2 && _in_stream_ans_refs[header->type].load(std::memory_order_acquire)
+        && !(sizeFlag >> RPLIDAR_ANS_HEADER_SUBTYPE_SHIFT)
+        && (sizeFlag & RPLIDAR_ANS_HEADER_SIZE_MASK) <= MAX_IN_STREAM_ANS_SIZE) {
+
+        _inStreamAnswer.cmd = header->type;
+        _inStreamAnswer.fillData(NULL, sizeFlag & RPLIDAR_ANS_HEADER_SIZE_MASK);
+        _probe_pos = 0;
+        _working_states = STATUS_LOOP_MODE_FLAG | STATUS_RECV_IN_STREAM_ANS;
+        if (!_inStreamAnswer.getPayloadSize()) {
+            _working_states = STATUS_LOOP_MODE_FLAG | STATUS_RECV_PAYLOAD;
+            _dispatchMessage(_inStreamAnswer);
+        }
+        return;
+    }
+
+    // not an answer, the held bytes start the next packet
+    memcpy(_decodingMessage.getDataBuf(), _probed_header, _probe_pos);
+    _rx_pos = (int)_probe_pos;
+    _working_states = STATUS_LOOP_MODE_FLAG | STATUS_RECV_PAYLOAD;
+    if ((size_t)_rx_pos == _decodingMessage.getPayloadSize()) {
+        _rx_pos = 0;
+        _dispatchMessage(_decodingMessage);
+    }
+}
+
+void RPLidarProtocolCodec::_dispatchMessage(ProtocolMessage& message)
+{
+    IProtocolMessageListener* cachedLister = _listener.load(std::memory_order_acquire);
+    message.rxTimestamp_uS = _rx_timestamp_us;
+    _addCounter(_messages, 1);
+
+    if (cachedLister) {
+        cachedLister->onProtocolMessageDecoded(message);
+    }
+
+    // the listener typically exits the loop mode on the answer it waited for
+    _applyRequests();
+}
+
+
+
+void RPLidarProtocolCodec::onChannelError(u_result errCode)
+{
+    IProtocolMessageListener* cachedLister = _listener.load(std::memory_order_acquire);
+
+    if (cachedLister) {
+        cachedLister->onProtocolChannelError(errCode);
+    }
+}
 
 void RPLidarProtocolCodec::setMessageListener(IProtocolMessageListener* listener)
 {
-    rp::hal::AutoLocker l(_op_locker);
-    _listener = listener;
+    _listener.store(listener, std::memory_order_release);
 }
 
-size_t RPLidarProtocolCodec::estimateLength(message_autoptr_t& message)
+void RPLidarProtocolCodec::getDecodeStats(LidarDecodeStats& stats) const
+{
+    stats.rx_bytes = _rx_bytes.load(std::memory_order_relaxed);
+    stats.messages = _messages.load(std::memory_order_relaxed);
+    stats.skipped_bytes = _skipped_bytes.load(std::memory_order_relaxed);
+    stats.decoder_resets = _decoder_resets.load(std::memory_order_relaxed);
+}
+
+size_t RPLidarProtocolCodec::estimateLength(const ProtocolMessage& message)
 {
     size_t actualSize = 2; //1-byte's sync byte, 1-byte's cmd byte
 
-    if (message->cmd & RPLIDAR_CMDFLAG_HAS_PAYLOAD) {
-        actualSize += (message->getPayloadSize() & 0xFF);
+    if (message.cmd & RPLIDAR_CMDFLAG_HAS_PAYLOAD) {
+        actualSize += (message.getPayloadSize() & 0xFF);
         actualSize += 2; //1-byte for size field, 1-byte for checksum
     }
 
@@ -88,7 +210,7 @@ size_t RPLidarProtocolCodec::estimateLength(message_autoptr_t& message)
 }
 
 
-void RPLidarProtocolCodec::onEncodeData(message_autoptr_t& message, _u8* buffer, size_t* size)
+void RPLidarProtocolCodec::onEncodeData(const ProtocolMessage& message, _u8* buffer, size_t* size)
 {
     _u8 checksum = 0;
     size_t writeSize = std::min<size_t>(*size, estimateLength(message));
@@ -101,22 +223,22 @@ void RPLidarProtocolCodec::onEncodeData(message_autoptr_t& message, _u8* buffer,
             currentTxByte = RPLIDAR_CMD_SYNC_BYTE;
             break;
         case 1: // cmd byte
-            currentTxByte = message->cmd;
+            currentTxByte = message.cmd;
             break;
         case 2: // size byte
-            currentTxByte = (_u8)message->getPayloadSize();
+            currentTxByte = (_u8)message.getPayloadSize();
             break;
         default:
         {
             size_t payloadPos = currentPos - 3;
-            if (payloadPos == message->getPayloadSize()) {
+            if (payloadPos == message.getPayloadSize()) {
                 // checksum byte
                 currentTxByte = checksum;
                 assert(currentPos + 1 == writeSize);
             }
             else {
                 // payload
-                currentTxByte = message->getDataBuf()[payloadPos];
+                currentTxByte = message.getDataBuf()[payloadPos];
             }
         }
         }
@@ -130,32 +252,106 @@ void RPLidarProtocolCodec::onEncodeData(message_autoptr_t& message, _u8* buffer,
 }
 
 void   RPLidarProtocolCodec::onDecodeReset() {
-    rp::hal::AutoLocker autolock(_op_locker);
+    // the pending requests are covered by the reset
+    _requests.store(0, std::memory_order_relaxed);
+    _resetDecoder();
+}
+
+void RPLidarProtocolCodec::_resetDecoder()
+{
     // flush the pending data
     _decodingMessage.cleanData();
     // reset to initial state
     _rx_pos = 0;
-    _working_states = STATUS_WAIT_SYNC1;
+    _probe_pos = 0;
+    _setWorkingStates(STATUS_WAIT_SYNC1);
+    _addCounter(_decoder_resets, 1);
 }
 
 
-void RPLidarProtocolCodec::onDecodeData(const void* buffer, size_t size)
+void RPLidarProtocolCodec::onDecodeData(const void* buffer, size_t size, _u64 rxTimestamp_uS)
 {
-    rp::hal::AutoLocker autolock(_op_locker);
+    _applyRequests();
+    _rx_timestamp_us = rxTimestamp_uS;
 
     const _u8* data = reinterpret_cast<const _u8*>(buffer);
     const _u8* dataEnd = data + size;
+    size_t skippedBytes = 0;
 
+    _addCounter(_rx_bytes, size);
 
     while (data != dataEnd) {
+
+        if ((_working_states & ((_u32)STATUS_LOOP_MODE_FLAG - 1)) == STATUS_RECV_PAYLOAD) {
+            if ((_working_states & STATUS_LOOP_MODE_FLAG) && _beginProbeAnsHeader(*data)) {
+                ++data;
+                continue;
+            }
+
+            // fast path: the payload size is known, copy the largest contiguous run at once
+            size_t payloadSize = _decodingMessage.getPayloadSize();
+            size_t copySize = std::min<size_t>(payloadSize - (size_t)_rx_pos, (size_t)(dataEnd - data));
+
+            memcpy(_decodingMessage.getDataBuf() + _rx_pos, data, copySize);
+            _rx_pos += (int)copySize;
+            data += copySize;
+
+            if ((size_t)_rx_pos == payloadSize) {
+                if (_working_states & STATUS_LOOP_MODE_FLAG) {
+                    // rewind to the payload recv status in loop mode
+                    _rx_pos = 0;
+                }
+                else {
+                    // reset the decoder
+                    _setWorkingStates(STATUS_WAIT_SYNC1);
+                }
+
+                _dispatchMessage(_decodingMessage);
+            }
+            continue;
+        }
+
+        if ((_working_states & ((_u32)STATUS_LOOP_MODE_FLAG - 1)) == STATUS_RECV_IN_STREAM_ANS) {
+            size_t payloadSize = _inStreamAnswer.getPayloadSize();
+            size_t copySize = std::min<size_t>(payloadSize - _probe_pos, (size_t)(dataEnd - data));
+
+            memcpy(_inStreamAnswer.getDataBuf() + _probe_pos, data, copySize);
+            _probe_pos += copySize;
+            data += copySize;
+
+            if (_probe_pos == payloadSize) {
+                // back to the loop mode packets
+                _working_states = STATUS_LOOP_MODE_FLAG | STATUS_RECV_PAYLOAD;
+                _dispatchMessage(_inStreamAnswer);
+            }
+            continue;
+        }
+
+        if (_working_states == STATUS_WAIT_SYNC1) {
+            // the noise before the next answer is skipped at once
+            const _u8* syncByte = rp::hal::findByte(data, dataEnd, RPLIDAR_ANS_SYNC_BYTE1);
+            skippedBytes += (size_t)(syncByte - data);
+            data = syncByte;
+            if (data == dataEnd) break;
+        }
+
         _u8 currentByte = *data;
         ++data;
 
         switch (_working_states & ((_u32)STATUS_LOOP_MODE_FLAG - 1)) {
+        case STATUS_PROBE_ANS_HEADER:
+            _probed_header[_probe_pos++] = currentByte;
+            if (_probe_pos == sizeof(_probed_header) || (_probe_pos == 2 && currentByte != RPLIDAR_ANS_SYNC_BYTE2)) {
+                _onAnsHeaderProbed();
+            }
+            break;
         case STATUS_WAIT_SYNC1:
             if (currentByte == RPLIDAR_ANS_SYNC_BYTE1) {
                 _working_states = STATUS_WAIT_SYNC2;
             }
+            else {
+                ++skippedBytes;
+            }
             break;
         case STATUS_WAIT_SYNC2:
             if (currentByte == RPLIDAR_ANS_SYNC_BYTE2) {
@@ -165,6 +361,7 @@ void RPLidarProtocolCodec::onDecodeData(const void* buffer, size_t size)
             else {
                 // reset to the initial state
                 _working_states = STATUS_WAIT_SYNC1;
+                skippedBytes += 2;
             }
             break;
         case STATUS_WAIT_SIZE_FLAG:
@@ -201,35 +398,17 @@ void RPLidarProtocolCodec::onDecodeData(const void* buffer, size_t size)
                 // zero payload packet? 
                 _working_states = STATUS_WAIT_SYNC1;
             }
-            break;
-        case STATUS_RECV_PAYLOAD:
-            _decodingMessage.getDataBuf()[_rx_pos++] = currentByte;
-
-            if ((size_t)_rx_pos == _decodingMessage.getPayloadSize()) {
-                if (_working_states & STATUS_LOOP_MODE_FLAG) {
-                    // rewind to the payload recv status in loop mode
-                    _rx_pos = 0;
-                }
-                else {
-                    // reset the decoder
-                    _working_states = STATUS_WAIT_SYNC1;
-                }
-
-                IProtocolMessageListener* cachedLister = _listener;
-
-                autolock.forceUnlock(); //unlock the oplock to prevent deadlock
-
-
-                if (cachedLister) {
-                    cachedLister->onProtocolMessageDecoded(_decodingMessage);
-                }
-
-                _op_locker.lock(); // relock it
+            else if (_working_states & STATUS_LOOP_MODE_FLAG) {
+                _loop_packet_size.store((_u32)_decodingMessage.getPayloadSize(), std::memory_order_release);
             }
             break;
         }
 
     }
+
+    if (skippedBytes) {
+        _addCounter(_skipped_bytes, skippedBytes);
+    }
 }
 
 
@@ -34,6 +34,7 @@
 #pragma once
 
 #include "sl_async_transceiver.h"
+#include <atomic>
 
 namespace sl { namespace internal {
 
@@ -41,9 +42,13 @@ namespace sl { namespace internal {
 class IProtocolMessageListener {
 public:
     virtual void onProtocolMessageDecoded(const ProtocolMessage&) = 0;
+    virtual void onProtocolChannelError(u_result errCode) {}
 };
 
 
+// The decoding state is owned by the thread feeding onDecodeData, which takes no lock: the calls made
+// from the command threads, exitLoopMode(), the in stream answer types and the listener, only post
+// atomic requests and values that the decode loop picks up before its next byte.
 class RPLidarProtocolCodec : public IAsyncProtocolCodec
 {
 public:
@@ -54,32 +59,82 @@ public:
         STATUS_WAIT_SIZE_FLAG = 0x2,
         STATUS_WAIT_TYPE = 0x3,
         STATUS_RECV_PAYLOAD = 0x4,
+        STATUS_PROBE_ANS_HEADER = 0x5,
+        STATUS_RECV_IN_STREAM_ANS = 0x6,
         STATUS_LOOP_MODE_FLAG = 0x80000000,
+
+        // the in stream answers are the queries of a few bytes
+        MAX_IN_STREAM_ANS_SIZE = 1024,
+
+        // the requests posted to the decode loop
+        REQUEST_EXIT_LOOP_MODE = 0x1,
     };
 
     RPLidarProtocolCodec();
 
+    // the decoder is reset before it decodes its next byte, the bytes already decoded are not affected
     void exitLoopMode();
 
+    // Splits the answers of the given type out of the loop mode stream, which keeps being decoded,
+    // until as many removeInStreamAnswerType() calls; several commands may wait for the same type.
+    // The answer headers are probed at the packet boundaries, so it fails when the stream is not in loop mode
+    // or when its packets are shorter than an answer header.
+    bool addInStreamAnswerType(_u8 type);
+    void removeInStreamAnswerType(_u8 type);
+
 
-    virtual size_t estimateLength(message_autoptr_t& message);
+    virtual size_t estimateLength(const ProtocolMessage& message);
 
 
-    virtual void onEncodeData(message_autoptr_t& message, _u8* txbuffer, size_t* size);
+    virtual void onEncodeData(const ProtocolMessage& message, _u8* txbuffer, size_t* size);
 
+    // called by the decoding thread, or while no data is decoded
     virtual void   onDecodeReset();
-    virtual void   onDecodeData(const void* buffer, size_t size);
+    virtual void   onDecodeData(const void* buffer, size_t size, _u64 rxTimestamp_uS = 0);
+    virtual void   onChannelError(u_result errCode);
     
     void setMessageListener(IProtocolMessageListener* l);
 
+    // fills the decoder part of the stats, safe to call from any thread
+    void getDecodeStats(LidarDecodeStats& stats) const;
+
 protected:
 
-    IProtocolMessageListener* _listener;
+    bool _beginProbeAnsHeader(_u8 currentByte);
+    void _onAnsHeaderProbed();
+    void _dispatchMessage(ProtocolMessage& message);
+    void _resetDecoder();
+    void _setWorkingStates(_u32 states);
+
+    // a relaxed load on the hot path, the bytes left are decoded from the state the requests set
+    void _applyRequests()
+    {
+        if (!_requests.load(std::memory_order_relaxed)) return;
+        if (_requests.exchange(0, std::memory_order_acquire) & REQUEST_EXIT_LOOP_MODE) {
+            _resetDecoder();
+        }
+    }
+
+    std::atomic<IProtocolMessageListener*> _listener;
+    std::atomic<_u32>        _requests;                  // REQUEST_*, posted by the command threads
     ProtocolMessage          _decodingMessage;
-    rp::hal::Locker          _op_locker;
-                            
+
     _u32                     _working_states;
+    std::atomic<_u32>        _loop_packet_size;          // published for addInStreamAnswerType(), 0 out of loop mode
     int                      _rx_pos;
+    _u64                     _rx_timestamp_us;           // of the chunk being decoded, stamped on the messages it completes
+
+    std::atomic<_u16>        _in_stream_ans_refs[256];   // the commands waiting in stream, by answer type
+    std::atomic<size_t>      _in_stream_ans_total;
+    _u8                      _probed_header[sizeof(sl_lidar_ans_header_t)];
+    size_t                   _probe_pos;
+    ProtocolMessage          _inStreamAnswer;
+
+    // only updated by the decoding thread, read from any thread
+    std::atomic<_u64>        _rx_bytes;
+    std::atomic<_u64>        _messages;
+    std::atomic<_u64>        _skipped_bytes;
+    std::atomic<_u64>        _decoder_resets;
 };
 
 }}
@@ -0,0 +1,208 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/locker.h"
+
+#include "sl_lidar_driver.h"
+
+#include <atomic>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+
+// the dynamic clock id of an opened PTP clock device, see the kernel's Documentation/driver-api/ptp.rst
+#define SL_PTP_CLOCKFD 3
+#define SL_PTP_FD_TO_CLOCKID(fd) ((~(clockid_t)(fd) << 3) | SL_PTP_CLOCKFD)
+#endif
+
+namespace sl {
+
+#if defined(__linux__)
+
+    // The time of a PTP hardware clock, or of a system clock kept on the PTP time.
+    // The host capture times are converted with the offset of the PTP clock to CLOCK_MONOTONIC, read between two
+    // reads of the host clock; the tightest of a few tries is kept, the PHC reads cross the PCIe bus.
+    class PtpClock : public ILidarClock
+    {
+    public:
+        enum {
+            OFFSET_REFRESH_US = 100000,
+            OFFSET_TRIES = 5,
+        };
+
+        PtpClock()
+            : _fd(-1)
+            , _clockId(CLOCK_MONOTONIC)
+            , _offset_uS(0)
+            , _refreshed_uS(0)
+            , _last_uS(0)
+        {
+        }
+
+        ~PtpClock()
+        {
+            if (_fd >= 0) ::close(_fd);
+        }
+
+        sl_result open(const std::string& device)
+        {
+            if (device == "CLOCK_TAI") {
+                _clockId = CLOCK_TAI;
+            }
+            else if (device == "CLOCK_REALTIME") {
+                _clockId = CLOCK_REALTIME;
+            }
+            else {
+                std::string path = device;
+                if (device.compare(0, 5, "/dev/") != 0) {
+                    int phcIndex = _phcIndexOf(device);
+                    if (phcIndex < 0) return SL_RESULT_OPERATION_NOT_SUPPORT;
+                    char name[32];
+                    snprintf(name, sizeof(name), "/dev/ptp%d", phcIndex);
+                    path = name;
+                }
+
+                _fd = ::open(path.c_str(), O_RDONLY);
+                if (_fd < 0) return SL_RESULT_OPERATION_FAIL;
+                _clockId = SL_PTP_FD_TO_CLOCKID(_fd);
+            }
+
+            timespec ts;
+            if (clock_gettime(_clockId, &ts)) return SL_RESULT_OPERATION_FAIL;
+            _refreshOffset(getus());
+            return SL_RESULT_OK;
+        }
+
+        sl_u64 now_uS()
+        {
+            // a step of the PTP clock does not take the time back
+            _u64 now = _read_uS();
+            _u64 last = _last_uS.load(std::memory_order_relaxed);
+            while (now > last && !_last_uS.compare_exchange_weak(last, now, std::memory_order_relaxed)) {}
+            return now > last ? now : last;
+        }
+
+        sl_u64 fromHostTime_uS(sl_u64 hostTs_uS)
+        {
+            _u64 hostNow = getus();
+            if (hostNow - _refreshed_uS.load(std::memory_order_relaxed) >= OFFSET_REFRESH_US) {
+                _refreshOffset(hostNow);
+            }
+            return (sl_u64)((sl_s64)hostTs_uS + _offset_uS.load(std::memory_order_relaxed));
+        }
+
+    private:
+        _u64 _read_uS()
+        {
+            timespec ts;
+            clock_gettime(_clockId, &ts);
+            return (_u64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+        }
+
+        // the rx threads of several drivers may share the clock, only one of them measures the offset
+        void _refreshOffset(_u64 hostNow)
+        {
+            if (_offsetLocker.lock(0) != rp::hal::Locker::LOCK_OK) return;
+
+            _u64 bestSpan = (_u64)-1;
+            sl_s64 bestOffset = 0;
+            for (int pos = 0; pos < OFFSET_TRIES; ++pos) {
+                _u64 before = getus();
+                _u64 ptp = _read_uS();
+                _u64 after = getus();
+                if (after - before < bestSpan) {
+                    bestSpan = after - before;
+                    bestOffset = (sl_s64)ptp - (sl_s64)(before + (after - before) / 2);
+                }
+            }
+            _offset_uS.store(bestOffset, std::memory_order_relaxed);
+            _refreshed_uS.store(hostNow, std::memory_order_relaxed);
+            _offsetLocker.unlock();
+        }
+
+        // the PTP hardware clock of a network interface, -1 if it has none
+        static int _phcIndexOf(const std::string& interfaceName)
+        {
+            if (interfaceName.empty() || interfaceName.size() >= IFNAMSIZ) return -1;
+            int sock = ::socket(AF_INET, SOCK_DGRAM, 0);
+            if (sock < 0) return -1;
+
+            ethtool_ts_info info;
+            memset(&info, 0, sizeof(info));
+            info.cmd = ETHTOOL_GET_TS_INFO;
+            ifreq request;
+            memset(&request, 0, sizeof(request));
+            strncpy(request.ifr_name, interfaceName.c_str(), IFNAMSIZ - 1);
+            request.ifr_data = (char*)&info;
+
+            int ans = ::ioctl(sock, SIOCETHTOOL, &request);
+            ::close(sock);
+            return ans < 0 ? -1 : info.phc_index;
+        }
+
+        int                     _fd;
+        clockid_t               _clockId;
+        rp::hal::Locker         _offsetLocker;
+        std::atomic<sl_s64>     _offset_uS;     // added to a host time, gives the PTP time
+        std::atomic<_u64>       _refreshed_uS;  // the host time the offset was measured at
+        std::atomic<_u64>       _last_uS;       // the latest now_uS()
+    };
+
+    Result<ILidarClock*> createPtpClock(const std::string& device)
+    {
+        PtpClock* clock = new PtpClock();
+        sl_result ans = clock->open(device);
+        if (SL_IS_FAIL(ans)) {
+            delete clock;
+            return ans;
+        }
+        return (ILidarClock*)clock;
+    }
+
+#else
+
+    Result<ILidarClock*> createPtpClock(const std::string& device)
+    {
+        return SL_RESULT_OPERATION_NOT_SUPPORT;
+    }
+
+#endif
+}
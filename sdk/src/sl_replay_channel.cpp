@@ -0,0 +1,386 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "hal/thread.h"
+#include "hal/byteorder.h"
+#include "hal/mapped_file.h"
+
+#include "sl_lidar_driver.h"
+#include "sl_channel_recorder.h"
+
+#include <atomic>
+
+namespace sl {
+
+    // Plays a ChannelRecorder capture back as the rx data of a channel.
+    // The rx chunks following a recorded command are held until the driver sends the same command,
+    // so the responses line up with the requests whatever the replay speed is.
+    // The commands pipelined by the driver ahead of the answers are matched against the next recorded ones,
+    // they release their data once the answers before them are read.
+    // A file without the recording header is treated as a single rx chunk.
+    // Each read ends with its record, so the clock of the channel gives the recorded time of all the data read.
+    class ReplayChannel : public IChannel
+    {
+    public:
+        ReplayChannel(const std::string& path, float speed)
+            : _path(path)
+            , _speed(speed)
+            , _clock(this)
+            , _captureTs_uS(0)
+            , _locker(false)
+            , _isOpened(false)
+            , _isCanceled(false)
+            , _data(NULL)
+            , _size(0)
+        {
+            _resetCursor();
+        }
+
+        ~ReplayChannel()
+        {
+            close();
+        }
+
+        bool open()
+        {
+            close();
+            if (!_file.open(_path.c_str(), true)) return false;
+            _data = _file.data();
+            _size = _file.size();
+
+            const internal::ChannelRecordFileHeader* fileHeader = reinterpret_cast<const internal::ChannelRecordFileHeader*>(_data);
+            bool isRecording = (_size >= sizeof(*fileHeader) && le32_to_cpu(fileHeader->magic) == internal::CHANNEL_RECORD_MAGIC);
+            if (isRecording && le16_to_cpu(fileHeader->version) != internal::CHANNEL_RECORD_VERSION) {
+                close();
+                return false;
+            }
+
+            rp::hal::AutoLocker l(_locker);
+            _resetCursor();
+            if (isRecording) {
+                _isRaw = false;
+                _pos = sizeof(*fileHeader);
+                _loadRecord();
+                _recordBase_uS = _recordTs;
+            } else {
+                _isRaw = true;
+                _recordDirection = internal::CHANNEL_RECORD_DIR_RX;
+                _recordSize = _size;
+            }
+            _clockBase_uS = getus();
+            _captureTs_uS = 0;
+            _isOpened = true;
+            _isCanceled = false;
+            return true;
+        }
+
+        void cancelWaits()
+        {
+            {
+                rp::hal::AutoLocker l(_locker);
+                _isCanceled = true;
+            }
+            _stateEvt.set();
+        }
+
+        bool isWaitCancellable()
+        {
+            return true;
+        }
+
+        void close()
+        {
+            {
+                rp::hal::AutoLocker l(_locker);
+                _isOpened = false;
+                _file.close();
+                _data = NULL;
+                _size = 0;
+            }
+            _stateEvt.set();
+        }
+
+        void flush()
+        {
+        }
+
+        sl_result waitForDataExt(size_t& size_hint, sl_u32 timeoutInMs)
+        {
+            size_hint = 0;
+            _u64 deadline = getms() + timeoutInMs;
+
+            while (true) {
+                _u64 delay_uS;
+                {
+                    rp::hal::AutoLocker l(_locker);
+                    if (!_isOpened) return SL_RESULT_OPERATION_FAIL;
+                    if (_isCanceled) return SL_RESULT_OPERATION_TIMEOUT;
+
+                    delay_uS = _getRxDelay();
+                    if (!delay_uS) {
+                        size_hint = _recordSize - _recordOffset;
+                        return SL_RESULT_OK;
+                    }
+                }
+
+                _u64 now = getms();
+                if (now >= deadline) return SL_RESULT_OPERATION_TIMEOUT;
+                _u64 waitMs = std::min<_u64>((delay_uS + 999) / 1000, deadline - now);
+                _stateEvt.wait((unsigned long)waitMs);
+            }
+        }
+
+        bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
+        {
+            size_t readySize = 0;
+            bool ans = IS_OK(waitForDataExt(readySize, timeoutInMs));
+            if (actualReady)
+                *actualReady = readySize;
+            return ans;
+        }
+
+        int write(const void* data, size_t size)
+        {
+            {
+                rp::hal::AutoLocker l(_locker);
+                if (!_isOpened) return -1;
+
+                // the next recorded command releases the data behind it once the driver sends it again,
+                // the other commands are unanswered like on a device ignoring them
+                _skipConsumedRecords();
+                if (_pos < _size && _recordDirection == internal::CHANNEL_RECORD_DIR_TX
+                    && _recordSize == size && memcmp(_data + _pos, data, size) == 0) {
+                    _recordBase_uS = _recordTs;
+                    _clockBase_uS = getus();
+                    _nextRecord();
+                } else if (_pos < _size && _isAheadCommand(data, size)) {
+                    ++_releasedCommands;
+                }
+            }
+            _stateEvt.set();
+            return (int)size;
+        }
+
+        int read(void* buffer, size_t size)
+        {
+            rp::hal::AutoLocker l(_locker);
+            if (!_isOpened) return -1;
+
+            _u8* dest = reinterpret_cast<_u8*>(buffer);
+            size_t readSize = 0;
+            while (readSize < size && !_getRxDelay()) {
+                size_t copySize = std::min<size_t>(size - readSize, _recordSize - _recordOffset);
+                memcpy(dest + readSize, _data + _pos + _recordOffset, copySize);
+                readSize += copySize;
+                _recordOffset += copySize;
+                if (!_isRaw) {
+                    _captureTs_uS.store(_recordTs, std::memory_order_release);
+                    break;
+                }
+            }
+            return (int)readSize;
+        }
+
+        void clearReadCache() {}
+
+        int getChannelType() {
+            return CHANNEL_TYPE_REPLAY;
+        }
+
+        ILidarClock* getClock()
+        {
+            return &_clock;
+        }
+
+    private:
+        // the recorded time of the data last read, the host time for a raw capture or before the first read
+        class ReplayClock : public ILidarClock
+        {
+        public:
+            explicit ReplayClock(ReplayChannel* channel)
+                : _channel(channel)
+            {
+            }
+
+            sl_u64 now_uS()
+            {
+                _u64 captureTs = _channel->_captureTs_uS.load(std::memory_order_acquire);
+                return captureTs ? captureTs : getus();
+            }
+
+        private:
+            ReplayChannel* _channel;
+        };
+
+        enum {
+            RX_BLOCKED = 0xFFFFFFFF,    // the delay reported while the replay waits for a command or has ended
+        };
+
+        void _resetCursor()
+        {
+            _isRaw = true;
+            _pos = 0;
+            _recordTs = 0;
+            _recordSize = 0;
+            _recordOffset = 0;
+            _recordDirection = internal::CHANNEL_RECORD_DIR_RX;
+            _recordBase_uS = 0;
+            _clockBase_uS = 0;
+            _releasedCommands = 0;
+        }
+
+        // parse the record at _pos, a truncated one ends the replay
+        void _loadRecord()
+        {
+            _recordOffset = 0;
+            if (_pos + sizeof(internal::ChannelRecordHeader) > _size) {
+                _pos = _size;
+                return;
+            }
+            const internal::ChannelRecordHeader* header = reinterpret_cast<const internal::ChannelRecordHeader*>(_data + _pos);
+            _recordTs = le64_to_cpu(header->timestamp_uS);
+            _recordSize = le32_to_cpu(header->size);
+            _recordDirection = header->direction;
+            _pos += sizeof(internal::ChannelRecordHeader);
+            if (_recordSize > _size - _pos) {
+                _pos = _size;
+            }
+        }
+
+        void _nextRecord()
+        {
+            if (_isRaw) {
+                _pos = _size;
+                return;
+            }
+            _pos += _recordSize;
+            _loadRecord();
+        }
+
+        void _skipConsumedRecords()
+        {
+            while (_pos < _size) {
+                if (_recordDirection == internal::CHANNEL_RECORD_DIR_RX && _recordOffset >= _recordSize) {
+                    _nextRecord();
+                } else if (_recordDirection == internal::CHANNEL_RECORD_DIR_TX && _releasedCommands) {
+                    // sent by the driver while the answers before it were still pending
+                    --_releasedCommands;
+                    _recordBase_uS = _recordTs;
+                    _clockBase_uS = getus();
+                    _nextRecord();
+                } else {
+                    break;
+                }
+            }
+        }
+
+        // whether the command is the first recorded one after the commands already released ahead,
+        // with only rx data in between
+        bool _isAheadCommand(const void* data, size_t size) const
+        {
+            size_t commands = 0;
+            size_t pos = _pos;
+            size_t recordSize = _recordSize;
+            _u8 direction = _recordDirection;
+
+            while (true) {
+                if (direction == internal::CHANNEL_RECORD_DIR_TX) {
+                    if (commands++ == _releasedCommands) {
+                        return recordSize == size && memcmp(_data + pos, data, size) == 0;
+                    }
+                }
+
+                pos += recordSize;
+                if (pos + sizeof(internal::ChannelRecordHeader) > _size) return false;
+                const internal::ChannelRecordHeader* header = reinterpret_cast<const internal::ChannelRecordHeader*>(_data + pos);
+                recordSize = le32_to_cpu(header->size);
+                direction = header->direction;
+                pos += sizeof(internal::ChannelRecordHeader);
+                if (recordSize > _size - pos) return false;
+            }
+        }
+
+        // the uS to wait before the current rx record is due, 0 if some data can be read now
+        _u64 _getRxDelay()
+        {
+            _skipConsumedRecords();
+            if (_pos >= _size || _recordDirection != internal::CHANNEL_RECORD_DIR_RX) return RX_BLOCKED;
+
+            if (_isRaw || _speed <= 0) return 0;
+
+            _u64 elapsed_uS = getus() - _clockBase_uS;
+            _u64 due_uS = (_recordTs > _recordBase_uS) ? (_u64)((_recordTs - _recordBase_uS) / _speed) : 0;
+            return (due_uS > elapsed_uS) ? (due_uS - elapsed_uS) : 0;
+        }
+
+        std::string _path;
+        float _speed;
+        ReplayClock _clock;
+        std::atomic<_u64> _captureTs_uS;    // the recorded time of the data last read, 0 if none
+
+        rp::hal::Locker _locker;    // guards the cursor, write() runs on the caller thread while the rx thread reads
+        rp::hal::Event _stateEvt;   // wakes the readers up on a command, a cancel or close
+        bool _isOpened;
+        bool _isCanceled;           // set by cancelWaits() until the next open()
+
+        rp::hal::MappedFile _file;
+        const _u8* _data;           // the mapped recording
+        size_t _size;
+
+        bool _isRaw;
+        size_t _pos;                // the payload offset of the current record
+        _u64 _recordTs;
+        size_t _recordSize;
+        size_t _recordOffset;       // the bytes of the current record already read
+        _u8 _recordDirection;
+
+        _u64 _recordBase_uS;        // the recorded time matching _clockBase_uS
+        _u64 _clockBase_uS;
+        size_t _releasedCommands;   // the next recorded commands already sent by the driver
+    };
+
+    Result<IChannel*> createReplayChannel(const std::string& path, float speed)
+    {
+        return new ReplayChannel(path, speed);
+    }
+
+    Result<ILidarClock*> getReplayChannelClock(IChannel* replayChannel)
+    {
+        if (!replayChannel || replayChannel->getChannelType() != CHANNEL_TYPE_REPLAY) return SL_RESULT_INVALID_DATA;
+        return static_cast<ReplayChannel*>(replayChannel)->getClock();
+    }
+}
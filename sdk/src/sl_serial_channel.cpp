@@ -40,10 +40,11 @@ namespace sl {
     class SerialPortChannel : public ISerialPortChannel
     {
     public:
-        SerialPortChannel(const std::string& device, int baudrate) :_rxtxSerial(rp::hal::serial_rxtx::CreateRxTx())
+        SerialPortChannel(const std::string& device, int baudrate, const SerialPortOptions& options) :_rxtxSerial(rp::hal::serial_rxtx::CreateRxTx())
         {
             _device = device;
             _baudrate = baudrate;
+            _options = options;
         }
 
         ~SerialPortChannel()
@@ -55,7 +56,9 @@ namespace sl {
         bool bind(const std::string& device, sl_s32 baudrate)
         {
             _closePending = false;
-            return _rxtxSerial->bind(device.c_str(), baudrate);
+            sl_u32 flags = 0;
+            if (_options.low_latency) flags |= rp::hal::serial_rxtx::SERIAL_FLAG_LOW_LATENCY;
+            return _rxtxSerial->bind(device.c_str(), baudrate, flags);
         }
 
         bool open()
@@ -66,10 +69,25 @@ namespace sl {
         }
 
         void close()
+        {
+            cancelWaits();
+            _rxtxSerial->close();
+        }
+
+        void cancelWaits()
         {
             _closePending = true;
             _rxtxSerial->cancelOperation();
-            _rxtxSerial->close();
+        }
+
+        bool isWaitCancellable()
+        {
+            // only the Linux port wakes its waits up in cancelOperation()
+#if defined(__linux__)
+            return true;
+#else
+            return false;
+#endif
         }
         void flush()
         {
@@ -126,21 +144,45 @@ namespace sl {
             dtr ? _rxtxSerial->setDTR() : _rxtxSerial->clearDTR();
         }
 
+        sl_result getSerialPortSettings(SerialPortSettings& settings)
+        {
+            bool lowLatency;
+            int latencyTimerMs;
+            if (!_rxtxSerial->getLatencySettings(lowLatency, latencyTimerMs)) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            settings.baudrate = _baudrate;
+            settings.low_latency = lowLatency;
+            settings.latency_timer_ms = latencyTimerMs;
+            return SL_RESULT_OK;
+        }
+
         int getChannelType() {
             return CHANNEL_TYPE_SERIALPORT;
         }
 
+        int getNativeHandle() {
+            return _rxtxSerial->getNativeHandle();
+        }
+
     private:
         rp::hal::serial_rxtx  * _rxtxSerial;
         bool _closePending;
         std::string _device;
         int _baudrate;
+        SerialPortOptions _options;
 
     };
 
     Result<IChannel*> createSerialPortChannel(const std::string& device, int baudrate)
     {
-        return new  SerialPortChannel(device, baudrate);
+        SerialPortOptions options;
+        options.low_latency = false;
+        return new  SerialPortChannel(device, baudrate, options);
+    }
+
+    Result<IChannel*> createSerialPortChannel(const std::string& device, int baudrate, const SerialPortOptions& options)
+    {
+        return new  SerialPortChannel(device, baudrate, options);
     }
 
 }
\ No newline at end of file
@@ -0,0 +1,636 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "hal/byteorder.h"
+
+#include "sl_lidar_driver.h"
+#include "sl_crc.h"
+
+#include <vector>
+
+namespace sl {
+
+    // Pretends to be a S series device in a rectangular room: it answers the device info, health
+    // and scan mode queries, and streams the configured capsules at the simulated sample rate.
+    // The samples are produced by the reader thread as they become due, there is no thread of its own.
+    class SimulatorChannel : public IChannel
+    {
+    public:
+        enum {
+            SIMULATED_MODEL = 0x61,
+            SCAN_MODE_STANDARD = 0,
+            SCAN_MODE_SIMULATED = 1,
+            SCAN_MODE_COUNT = 2,
+            MAX_DISTANCE_M = 40,
+
+            // bounds the bytes produced in one read when the reader falls behind
+            MAX_PACKETS_PER_ROUND = 256,
+        };
+
+        SimulatorChannel(const LidarSimulatorConfig& config)
+            : _config(config)
+            , _locker(false)
+            , _isOpened(false)
+            , _isCanceled(false)
+        {
+            _resetDevice();
+        }
+
+        bool open()
+        {
+            rp::hal::AutoLocker l(_locker);
+            _resetDevice();
+            _isOpened = true;
+            _isCanceled = false;
+            return true;
+        }
+
+        void cancelWaits()
+        {
+            {
+                rp::hal::AutoLocker l(_locker);
+                _isCanceled = true;
+            }
+            _stateEvt.set();
+        }
+
+        bool isWaitCancellable()
+        {
+            return true;
+        }
+
+        void close()
+        {
+            {
+                rp::hal::AutoLocker l(_locker);
+                _isOpened = false;
+            }
+            _stateEvt.set();
+        }
+
+        void flush()
+        {
+        }
+
+        sl_result waitForDataExt(size_t& size_hint, sl_u32 timeoutInMs)
+        {
+            size_hint = 0;
+            _u64 deadline = getms() + timeoutInMs;
+
+            while (true) {
+                _u64 delay_uS;
+                {
+                    rp::hal::AutoLocker l(_locker);
+                    if (!_isOpened) return SL_RESULT_OPERATION_FAIL;
+                    if (_isCanceled) return SL_RESULT_OPERATION_TIMEOUT;
+
+                    _u64 now = getus();
+                    _produceDuePackets(now);
+                    if (_rxPos < _rxBuffer.size()) {
+                        size_hint = _rxBuffer.size() - _rxPos;
+                        return SL_RESULT_OK;
+                    }
+                    delay_uS = _streamType ? _getNextPacketDelay(now) : 0xFFFFFFFF;
+                }
+
+                _u64 now = getms();
+                if (now >= deadline) return SL_RESULT_OPERATION_TIMEOUT;
+                _u64 waitMs = std::min<_u64>((delay_uS + 999) / 1000, deadline - now);
+                _stateEvt.wait((unsigned long)waitMs);
+            }
+        }
+
+        bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
+        {
+            size_t readySize = 0;
+            bool ans = IS_OK(waitForDataExt(readySize, timeoutInMs));
+            if (actualReady)
+                *actualReady = readySize;
+            return ans;
+        }
+
+        int write(const void* data, size_t size)
+        {
+            {
+                rp::hal::AutoLocker l(_locker);
+                if (!_isOpened) return -1;
+
+                const _u8* bytes = reinterpret_cast<const _u8*>(data);
+                _cmdBuffer.insert(_cmdBuffer.end(), bytes, bytes + size);
+                _parseCommands();
+            }
+            _stateEvt.set();
+            return (int)size;
+        }
+
+        int read(void* buffer, size_t size)
+        {
+            sl_u64 rxTimestamp_uS;
+            return readTimestamped(buffer, size, rxTimestamp_uS);
+        }
+
+        int readTimestamped(void* buffer, size_t size, sl_u64& rxTimestamp_uS)
+        {
+            rxTimestamp_uS = 0;
+            rp::hal::AutoLocker l(_locker);
+            if (!_isOpened) return -1;
+
+            _produceDuePackets(getus());
+            size_t readSize = std::min<size_t>(size, _rxBuffer.size() - _rxPos);
+            if (readSize) {
+                memcpy(buffer, &_rxBuffer[_rxPos], readSize);
+                _rxPos += readSize;
+            }
+            // with generation_timestamps, the time the latest sample packet reached by the read was due
+            while (_duePos < _packetDues.size() && _packetDues[_duePos].end <= _rxPos) {
+                rxTimestamp_uS = _packetDues[_duePos++].due_uS;
+            }
+            if (_duePos < _packetDues.size() && _packetDues[_duePos].begin < _rxPos) {
+                rxTimestamp_uS = _packetDues[_duePos].due_uS;
+            }
+            if (!_config.generation_timestamps) rxTimestamp_uS = 0;
+            if (_rxPos == _rxBuffer.size()) {
+                _clearRxBuffer();
+            }
+            return (int)readSize;
+        }
+
+        void clearReadCache() {}
+
+        int getChannelType() {
+            return CHANNEL_TYPE_SIMULATOR;
+        }
+
+    private:
+        struct PacketDue
+        {
+            size_t begin;   // in _rxBuffer
+            size_t end;
+            _u64 due_uS;    // of the last sample of the packet
+        };
+
+        void _clearRxBuffer()
+        {
+            _rxBuffer.clear();
+            _rxPos = 0;
+            _packetDues.clear();
+            _duePos = 0;
+        }
+
+        void _resetDevice()
+        {
+            _clearRxBuffer();
+            _cmdBuffer.clear();
+            _streamType = 0;
+            _scanFrequency = _config.scan_frequency;
+            _noiseState = 0x12345678;
+        }
+
+        // the commands: A5 cmd [size payload checksum] when cmd has SL_LIDAR_CMDFLAG_HAS_PAYLOAD
+        void _parseCommands()
+        {
+            size_t pos = 0;
+            while (_cmdBuffer.size() - pos >= 2) {
+                if (_cmdBuffer[pos] != SL_LIDAR_CMD_SYNC_BYTE) {
+                    ++pos;
+                    continue;
+                }
+
+                _u8 cmd = _cmdBuffer[pos + 1];
+                if (!(cmd & SL_LIDAR_CMDFLAG_HAS_PAYLOAD)) {
+                    _handleCommand(cmd, NULL, 0);
+                    pos += 2;
+                    continue;
+                }
+
+                if (_cmdBuffer.size() - pos < 3) break;
+                size_t payloadSize = _cmdBuffer[pos + 2];
+                size_t cmdSize = 3 + payloadSize + 1;
+                if (_cmdBuffer.size() - pos < cmdSize) break;
+
+                _u8 checksum = 0;
+                for (size_t idx = 0; idx < cmdSize - 1; ++idx) {
+                    checksum ^= _cmdBuffer[pos + idx];
+                }
+                if (checksum == _cmdBuffer[pos + cmdSize - 1]) {
+                    _handleCommand(cmd, &_cmdBuffer[pos + 3], payloadSize);
+                    pos += cmdSize;
+                }
+                else {
+                    ++pos;
+                }
+            }
+            _cmdBuffer.erase(_cmdBuffer.begin(), _cmdBuffer.begin() + pos);
+        }
+
+        void _handleCommand(_u8 cmd, const _u8* payload, size_t payloadSize)
+        {
+            switch (cmd) {
+            case SL_LIDAR_CMD_STOP:
+            case SL_LIDAR_CMD_RESET:
+                _streamType = 0;
+                _clearRxBuffer();
+                break;
+            case SL_LIDAR_CMD_GET_DEVICE_INFO:
+            {
+                sl_lidar_response_device_info_t info;
+                memset(&info, 0, sizeof(info));
+                info.model = SIMULATED_MODEL;
+                info.firmware_version = cpu_to_le16((1 << 8) | 29);
+                info.hardware_version = 18;
+                memcpy(info.serialnum, "SIMULATOR", 9);
+                _answer(SL_LIDAR_ANS_TYPE_DEVINFO, &info, sizeof(info));
+            }
+            break;
+            case SL_LIDAR_CMD_GET_DEVICE_HEALTH:
+            {
+                sl_lidar_response_device_health_t health;
+                memset(&health, 0, sizeof(health));
+                health.status = SL_LIDAR_STATUS_OK;
+                _answer(SL_LIDAR_ANS_TYPE_DEVHEALTH, &health, sizeof(health));
+            }
+            break;
+            case SL_LIDAR_CMD_GET_SAMPLERATE:
+            {
+                sl_lidar_response_sample_rate_t rate;
+                rate.std_sample_duration_us = cpu_to_le16((_u16)(1000000 / _config.sample_rate));
+                rate.express_sample_duration_us = rate.std_sample_duration_us;
+                _answer(SL_LIDAR_ANS_TYPE_SAMPLE_RATE, &rate, sizeof(rate));
+            }
+            break;
+            case SL_LIDAR_CMD_GET_ACC_BOARD_FLAG:
+            {
+                sl_lidar_response_acc_board_flag_t flag;
+                flag.support_flag = 0;
+                _answer(SL_LIDAR_ANS_TYPE_ACC_BOARD_FLAG, &flag, sizeof(flag));
+            }
+            break;
+            case SL_LIDAR_CMD_GET_LIDAR_CONF:
+                if (payloadSize >= sizeof(sl_lidar_payload_get_scan_conf_t)) {
+                    _answerConf(payload, payloadSize);
+                }
+                break;
+            case SL_LIDAR_CMD_HQ_MOTOR_SPEED_CTRL:
+                if (payloadSize >= sizeof(sl_lidar_payload_hq_spd_ctrl_t)) {
+                    _u16 rpm = le16_to_cpu(reinterpret_cast<const sl_lidar_payload_hq_spd_ctrl_t*>(payload)->rpm);
+                    if (rpm) _scanFrequency = rpm / 60.f;
+                }
+                break;
+            case SL_LIDAR_CMD_SCAN:
+            case SL_LIDAR_CMD_FORCE_SCAN:
+                _startStream(SL_LIDAR_ANS_TYPE_MEASUREMENT);
+                break;
+            case SL_LIDAR_CMD_EXPRESS_SCAN:
+                if (payloadSize >= sizeof(sl_lidar_payload_express_scan_t)) {
+                    _u8 mode = reinterpret_cast<const sl_lidar_payload_express_scan_t*>(payload)->working_mode;
+                    _startStream(mode == SCAN_MODE_STANDARD ? SL_LIDAR_ANS_TYPE_MEASUREMENT : _config.ans_type);
+                }
+                break;
+            }
+        }
+
+        void _answerConf(const _u8* payload, size_t payloadSize)
+        {
+            _u32 type = le32_to_cpu(reinterpret_cast<const sl_lidar_payload_get_scan_conf_t*>(payload)->type);
+            _u16 mode = 0;
+            if (payloadSize >= sizeof(sl_lidar_payload_get_scan_conf_t) + sizeof(_u16)) {
+                memcpy(&mode, payload + sizeof(sl_lidar_payload_get_scan_conf_t), sizeof(mode));
+                mode = le16_to_cpu(mode);
+            }
+
+            std::vector<_u8> answer(sizeof(_u32));
+            _u32 typeLE = cpu_to_le32(type);
+            memcpy(&answer[0], &typeLE, sizeof(typeLE));
+
+            switch (type) {
+            case SL_LIDAR_CONF_SCAN_MODE_COUNT:
+                _appendValue<_u16>(answer, cpu_to_le16(SCAN_MODE_COUNT));
+                break;
+            case SL_LIDAR_CONF_SCAN_MODE_TYPICAL:
+                _appendValue<_u16>(answer, cpu_to_le16(SCAN_MODE_SIMULATED));
+                break;
+            case SL_LIDAR_CONF_SCAN_MODE_US_PER_SAMPLE:
+                _appendValue<_u32>(answer, cpu_to_le32((_u32)((256.0 * 1000000) / _config.sample_rate)));
+                break;
+            case SL_LIDAR_CONF_SCAN_MODE_MAX_DISTANCE:
+                _appendValue<_u32>(answer, cpu_to_le32(MAX_DISTANCE_M << 8));
+                break;
+            case SL_LIDAR_CONF_SCAN_MODE_ANS_TYPE:
+                _appendValue<_u8>(answer, mode == SCAN_MODE_STANDARD ? SL_LIDAR_ANS_TYPE_MEASUREMENT : _config.ans_type);
+                break;
+            case SL_LIDAR_CONF_SCAN_MODE_NAME:
+            {
+                const char* name = (mode == SCAN_MODE_STANDARD) ? "Standard" : "Simulated";
+                answer.insert(answer.end(), name, name + strlen(name) + 1);
+            }
+            break;
+            case SL_LIDAR_CONF_DESIRED_ROT_FREQ:
+            {
+                sl_lidar_response_desired_rot_speed_t speed;
+                speed.rpm = cpu_to_le16((_u16)(_config.scan_frequency * 60));
+                speed.pwm_ref = cpu_to_le16(600);
+                _appendValue(answer, speed);
+            }
+            break;
+            case SL_LIDAR_CONF_MIN_ROT_FREQ:
+                _appendValue<_u16>(answer, cpu_to_le16(60));
+                break;
+            case SL_LIDAR_CONF_MAX_ROT_FREQ:
+                _appendValue<_u16>(answer, cpu_to_le16(6000));
+                break;
+            default:
+                // unknown to the simulated device, answered without payload
+                break;
+            }
+            _answer(SL_LIDAR_ANS_TYPE_GET_LIDAR_CONF, &answer[0], answer.size());
+        }
+
+        template <class T>
+        static void _appendValue(std::vector<_u8>& buffer, const T& value)
+        {
+            const _u8* bytes = reinterpret_cast<const _u8*>(&value);
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+        }
+
+        void _appendAnswerHeader(_u8 ansType, size_t size, bool loop)
+        {
+            _u32 sizeFlag = (_u32)(size & SL_LIDAR_ANS_HEADER_SIZE_MASK);
+            if (loop) sizeFlag |= ((_u32)SL_LIDAR_ANS_PKTFLAG_LOOP << SL_LIDAR_ANS_HEADER_SUBTYPE_SHIFT);
+
+            _rxBuffer.push_back(SL_LIDAR_ANS_SYNC_BYTE1);
+            _rxBuffer.push_back(SL_LIDAR_ANS_SYNC_BYTE2);
+            _appendValue<_u32>(_rxBuffer, cpu_to_le32(sizeFlag));
+            _rxBuffer.push_back(ansType);
+        }
+
+        void _answer(_u8 ansType, const void* payload, size_t size)
+        {
+            _appendAnswerHeader(ansType, size, false);
+            const _u8* bytes = reinterpret_cast<const _u8*>(payload);
+            _rxBuffer.insert(_rxBuffer.end(), bytes, bytes + size);
+        }
+
+        static size_t _getPacketSize(_u8 ansType)
+        {
+            switch (ansType) {
+            case SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ:
+                return sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t);
+            case SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED:
+                return sizeof(sl_lidar_response_dense_capsule_measurement_nodes_t);
+            case SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED:
+                return sizeof(sl_lidar_response_ultra_dense_capsule_measurement_nodes_t);
+            default:
+                return sizeof(sl_lidar_response_measurement_node_t);
+            }
+        }
+
+        static size_t _getSamplesPerPacket(_u8 ansType)
+        {
+            switch (ansType) {
+            case SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ:
+                return _countof(((sl_lidar_response_hq_capsule_measurement_nodes_t*)0)->node_hq);
+            case SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED:
+                return _countof(((sl_lidar_response_dense_capsule_measurement_nodes_t*)0)->cabins);
+            case SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED:
+                return _countof(((sl_lidar_response_ultra_dense_capsule_measurement_nodes_t*)0)->cabins) * 2;
+            default:
+                return 1;
+            }
+        }
+
+        void _startStream(_u8 ansType)
+        {
+            _clearRxBuffer();
+            // room for the packets of a few rounds, the stream does not allocate as long as it is read in time
+            _rxBuffer.reserve(MAX_PACKETS_PER_ROUND * 2 * _getPacketSize(ansType));
+            _packetDues.reserve(MAX_PACKETS_PER_ROUND * 2);
+            _appendAnswerHeader(ansType, _getPacketSize(ansType), true);
+
+            _streamType = ansType;
+            _streamStart_uS = getus();
+            _streamSamples = 0;
+            _phase = 0;
+            _isFirstPacket = true;
+        }
+
+        _u64 _getSampleDue_uS(_u64 sampleCount) const
+        {
+            return _streamStart_uS + sampleCount * 1000000 / _config.sample_rate;
+        }
+
+        _u64 _getNextPacketDelay(_u64 now) const
+        {
+            _u64 due = _getSampleDue_uS(_streamSamples + _getSamplesPerPacket(_streamType));
+            return (due > now) ? (due - now) : 0;
+        }
+
+        void _produceDuePackets(_u64 now)
+        {
+            if (!_streamType) return;
+
+            size_t spp = _getSamplesPerPacket(_streamType);
+            for (int count = 0; count < MAX_PACKETS_PER_ROUND; ++count) {
+                if (_getSampleDue_uS(_streamSamples + spp) > now) break;
+                _emitPacket(now);
+            }
+        }
+
+        // advances the rotation by one sample, true when a new revolution starts
+        bool _nextSample(float& angle)
+        {
+            angle = (float)(_phase * 360);
+            _phase += _scanFrequency / _config.sample_rate;
+            ++_streamSamples;
+            if (_phase >= 1) {
+                _phase -= 1;
+                return true;
+            }
+            return _streamSamples == 1;
+        }
+
+        // the distance in mm to the walls of a 7m x 4.5m room, with a few mm of noise and some dropouts
+        _u32 _getDistance(float angle)
+        {
+            _noiseState = _noiseState * 1664525 + 1013904223;
+            _u32 noise = _noiseState >> 8;
+            if ((noise % 100) < 2) return 0;
+
+            float rad = angle * (float)(3.14159265358979323846 / 180);
+            float c = cosf(rad), s = sinf(rad);
+            float dist = 1e9f;
+            if (c > 1e-6f) dist = std::min(dist, 4000 / c);
+            if (c < -1e-6f) dist = std::min(dist, -3000 / c);
+            if (s > 1e-6f) dist = std::min(dist, 2500 / s);
+            if (s < -1e-6f) dist = std::min(dist, -2000 / s);
+            return (_u32)dist + (noise % 5);
+        }
+
+        static void _sealExpressCapsule(_u8* packet, size_t size)
+        {
+            _u8 checksum = 0;
+            for (size_t pos = 2; pos < size; ++pos) {
+                checksum ^= packet[pos];
+            }
+            packet[0] = (_u8)((SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_1 << 4) | (checksum & 0xF));
+            packet[1] = (_u8)((SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_2 << 4) | (checksum >> 4));
+        }
+
+        // the 20 bits sample of the ultra dense capsules: the scale in the low 2 bits, then the distance and the quality
+        static _u32 _encodeUltraDenseSample(_u32 dist, _u8 quality)
+        {
+            if (dist < 2046) return (((dist * 2) & 0xFFC) | ((_u32)quality << 12));
+            if (dist < 8187) return ((((dist - 2046) * 4 / 3) & 0x1FFC) | ((_u32)(quality >> 1) << 13) | 1);
+            if (dist < 24567) return (((dist - 8187) & 0x3FFC) | ((_u32)(quality >> 2) << 14) | 2);
+            dist = std::min<_u32>(dist, 24567 + 0x7FFC * 5 / 4);
+            return ((((dist - 24567) * 4 / 5) & 0x7FFC) | ((_u32)(quality >> 3) << 15) | 3);
+        }
+
+        void _emitPacket(_u64 now)
+        {
+            size_t packetSize = _getPacketSize(_streamType);
+            size_t packetPos = _rxBuffer.size();
+            _rxBuffer.resize(packetPos + packetSize);
+            _u8* packet = &_rxBuffer[packetPos];
+            memset(packet, 0, packetSize);
+
+            _u32 elapsed_uS = (_u32)(now - _streamStart_uS);
+            float angle;
+
+            switch (_streamType) {
+            case SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ:
+            {
+                sl_lidar_response_hq_capsule_measurement_nodes_t* capsule = reinterpret_cast<sl_lidar_response_hq_capsule_measurement_nodes_t*>(packet);
+                capsule->sync_byte = SL_LIDAR_RESP_MEASUREMENT_HQ_SYNC;
+                capsule->time_stamp = cpu_to_le64(elapsed_uS);
+                for (size_t pos = 0; pos < _countof(capsule->node_hq); ++pos) {
+                    bool syncBit = _nextSample(angle);
+                    _u32 dist = _getDistance(angle);
+                    capsule->node_hq[pos].angle_z_q14 = cpu_to_le16((_u16)(angle * 16384 / 90));
+                    capsule->node_hq[pos].dist_mm_q2 = cpu_to_le32(dist << 2);
+                    capsule->node_hq[pos].quality = dist ? (47 << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
+                    capsule->node_hq[pos].flag = syncBit ? SL_LIDAR_RESP_HQ_FLAG_SYNCBIT : 0;
+                }
+                _u32 crc = cpu_to_le32(crc32::getResult(packet, (_u32)(packetSize - 4)));
+                memcpy(packet + packetSize - 4, &crc, 4);
+            }
+            break;
+            case SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED:
+            {
+                sl_lidar_response_dense_capsule_measurement_nodes_t* capsule = reinterpret_cast<sl_lidar_response_dense_capsule_measurement_nodes_t*>(packet);
+                _u16 startAngle_q6 = (_u16)(_phase * (360 << 6));
+                for (size_t pos = 0; pos < _countof(capsule->cabins); ++pos) {
+                    _nextSample(angle);
+                    capsule->cabins[pos].distance = cpu_to_le16((_u16)std::min<_u32>(_getDistance(angle), 0xFFFF));
+                }
+                capsule->start_angle_sync_q6 = cpu_to_le16(startAngle_q6 | (_isFirstPacket ? SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT : 0));
+                _sealExpressCapsule(packet, packetSize);
+            }
+            break;
+            case SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED:
+            {
+                sl_lidar_response_ultra_dense_capsule_measurement_nodes_t* capsule = reinterpret_cast<sl_lidar_response_ultra_dense_capsule_measurement_nodes_t*>(packet);
+                capsule->time_stamp = cpu_to_le32(elapsed_uS);
+                _u16 startAngle_q6 = (_u16)(_phase * (360 << 6));
+                for (size_t pos = 0; pos < _countof(capsule->cabins); ++pos) {
+                    _u32 samples[2];
+                    for (size_t idx = 0; idx < 2; ++idx) {
+                        _nextSample(angle);
+                        _u32 dist = _getDistance(angle);
+                        samples[idx] = _encodeUltraDenseSample(dist, dist ? 0xBC : 0);
+                    }
+                    capsule->cabins[pos].qualityl_distance_scale[0] = cpu_to_le16((_u16)samples[0]);
+                    capsule->cabins[pos].qualityl_distance_scale[1] = cpu_to_le16((_u16)samples[1]);
+                    capsule->cabins[pos].qualityh_array = (_u8)(((samples[0] >> 16) & 0xF) | ((samples[1] >> 16) << 4));
+                }
+                capsule->start_angle_sync_q6 = cpu_to_le16(startAngle_q6 | (_isFirstPacket ? SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT : 0));
+                _sealExpressCapsule(packet, packetSize);
+            }
+            break;
+            default:
+            {
+                sl_lidar_response_measurement_node_t* node = reinterpret_cast<sl_lidar_response_measurement_node_t*>(packet);
+                bool syncBit = _nextSample(angle);
+                _u32 dist = _getDistance(angle);
+                node->sync_quality = (_u8)((syncBit ? 0x1 : 0x2) | ((dist ? 47 : 0) << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT));
+                node->angle_q6_checkbit = cpu_to_le16((_u16)(((_u16)(angle * 64) << SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) | SL_LIDAR_RESP_MEASUREMENT_CHECKBIT));
+                node->distance_q2 = cpu_to_le16((_u16)std::min<_u32>(dist << 2, 0xFFFF));
+            }
+            break;
+            }
+            _isFirstPacket = false;
+
+            PacketDue packetDue = { packetPos, _rxBuffer.size(), _getSampleDue_uS(_streamSamples) };
+            _packetDues.push_back(packetDue);
+        }
+
+        LidarSimulatorConfig _config;
+
+        rp::hal::Locker _locker;    // write() runs on the caller thread while the rx thread reads
+        rp::hal::Event _stateEvt;   // wakes the readers up on a command, a cancel or close
+        bool _isOpened;
+        bool _isCanceled;           // set by cancelWaits() until the next open()
+
+        std::vector<_u8> _rxBuffer; // the answers and samples not read yet
+        size_t _rxPos;
+        std::vector<PacketDue> _packetDues; // of the sample packets in _rxBuffer
+        size_t _duePos;                     // the first one not read yet
+        std::vector<_u8> _cmdBuffer;
+
+        _u8 _streamType;            // the answer type being streamed, 0 when idle
+        _u64 _streamStart_uS;
+        _u64 _streamSamples;
+        double _phase;              // the rotation of the next sample, in revolutions
+        float _scanFrequency;
+        bool _isFirstPacket;
+        _u32 _noiseState;
+    };
+
+    Result<IChannel*> createSimulatorChannel(const LidarSimulatorConfig& config)
+    {
+        switch (config.ans_type) {
+        case SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ:
+        case SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED:
+        case SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED:
+            break;
+        default:
+            return SL_RESULT_INVALID_DATA;
+        }
+        if (!config.sample_rate || config.scan_frequency <= 0) return SL_RESULT_INVALID_DATA;
+
+        return new SimulatorChannel(config);
+    }
+}
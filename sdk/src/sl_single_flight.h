@@ -0,0 +1,139 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "hal/locker.h"
+#include "hal/event.h"
+
+// Users must include sdkcommon.h first.
+
+namespace sl { namespace internal {
+
+    enum SingleFlightOutcome
+    {
+        SINGLE_FLIGHT_COMMAND = 0,      // the caller ran the query
+        SINGLE_FLIGHT_COALESCED = 1,    // the answer of the query in flight
+        SINGLE_FLIGHT_CACHED = 2,       // the last answer, within the freshness window
+    };
+
+    // Coalesces the concurrent calls of one device query into a single command: the first caller runs the query
+    // and the callers arriving meanwhile wait for its answer instead of queueing commands of their own.
+    // The last answer can also be reused for a freshness window.
+    template <typename T>
+    class SingleFlight
+    {
+    public:
+        SingleFlight()
+            : _completedEvt(false, true)
+            , _isInFlight(false)
+            , _generation(0)
+            , _result(RESULT_OK)
+            , _hasAnswer(false)
+            , _answered_uS(0)
+        {
+        }
+
+        // query(T&) is called without the locker of the flight, a follower waits for it up to timeoutMs
+        template <typename Query>
+        u_result call(T& value, _u64 maxAge_uS, _u32 timeoutMs, SingleFlightOutcome& outcome, Query query)
+        {
+            _u64 deadline_ms = getms() + timeoutMs;
+            _locker.lock();
+            if (maxAge_uS && _hasAnswer && getus() - _answered_uS < maxAge_uS) {
+                value = _value;
+                _locker.unlock();
+                outcome = SINGLE_FLIGHT_CACHED;
+                return RESULT_OK;
+            }
+
+            if (_isInFlight) {
+                outcome = SINGLE_FLIGHT_COALESCED;
+                _u64 generation = _generation;
+                while (_generation == generation) {
+                    _u64 now_ms = getms();
+                    if (now_ms >= deadline_ms) {
+                        _locker.unlock();
+                        return RESULT_OPERATION_TIMEOUT;
+                    }
+                    _locker.unlock();
+                    _completedEvt.wait((unsigned long)(deadline_ms - now_ms));
+                    _locker.lock();
+                }
+                // the answer of a later query if it completed meanwhile, it is as fresh
+                u_result ans = _result;
+                if (IS_OK(ans)) value = _value;
+                _locker.unlock();
+                return ans;
+            }
+
+            _isInFlight = true;
+            _completedEvt.set(false);
+            _locker.unlock();
+
+            outcome = SINGLE_FLIGHT_COMMAND;
+            T answer = T();
+            u_result ans = query(answer);
+
+            rp::hal::AutoLocker l(_locker);
+            _result = ans;
+            if (IS_OK(ans)) {
+                _value = answer;
+                value = answer;
+                _hasAnswer = true;
+                _answered_uS = getus();
+            }
+            ++_generation;
+            _isInFlight = false;
+            _completedEvt.set();
+            return ans;
+        }
+
+        // the answer kept is not reused any longer, e.g. once another device is connected
+        void invalidate()
+        {
+            rp::hal::AutoLocker l(_locker);
+            _hasAnswer = false;
+        }
+
+    private:
+        rp::hal::Locker _locker;
+        rp::hal::Event  _completedEvt;   // manual reset, set while no query is in flight
+        bool            _isInFlight;
+        _u64            _generation;     // of the queries completed
+        u_result        _result;         // of the last query
+        T               _value;          // of the last query answered
+        bool            _hasAnswer;
+        _u64            _answered_uS;
+    };
+
+}}
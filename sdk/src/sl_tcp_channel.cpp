@@ -30,6 +30,7 @@
   *
   */
 
+#include "sdkcommon.h"
 #include "sl_lidar_driver.h"
 #include "hal/abs_rxtx.h"
 #include "hal/socket.h"
@@ -40,7 +41,9 @@ namespace sl {
     class TcpChannel : public IChannel
     {
     public:
-        TcpChannel(const std::string& ip, int port) : _binded_socket(rp::net::StreamSocket::CreateSocket()) {
+        TcpChannel(const std::string& ip, int port, const TcpChannelOptions& options) : _binded_socket(rp::net::StreamSocket::CreateSocket())
+            , _options(options)
+        {
             _ip = ip;
             _port = port;
         }
@@ -55,15 +58,42 @@ namespace sl {
         {
             if(!bind(_ip, _port))
                 return false;
+            // the socket is disposed by close()
+            if (!_binded_socket) _binded_socket = rp::net::StreamSocket::CreateSocket();
+            if (!_binded_socket) return false;
+            // the commands are sent right away, the socket is created with TCP_NODELAY
+            if (_options.rx_buffer_size) {
+                // set before connecting, the window scaling is negotiated at the handshake
+                _binded_socket->setRxBufferSize(_options.rx_buffer_size);
+            }
+            // no timestamps on this platform is fine: the data is then stamped when decoded
+            _binded_socket->enableRxTimestamp(true);
             return IS_OK(_binded_socket->connect(_socket));
             
         }
 
         void close()
         {
+            if (!_binded_socket) return;
             _binded_socket->dispose();
             _binded_socket = NULL;
         }
+
+        void cancelWaits()
+        {
+            if (_binded_socket) _binded_socket->cancelWaits();
+        }
+
+        bool isWaitCancellable()
+        {
+            // the waits of the sockets last until their timeout on Windows
+#ifdef _WIN32
+            return false;
+#else
+            return true;
+#endif
+        }
+
         void flush()
         {
         
@@ -77,7 +107,12 @@ namespace sl {
 
             switch (ans) {
             case RESULT_OK:
-                size_hint = 1024; //dummy value
+                if (IS_OK(_binded_socket->getRxQueueSize(size_hint))) {
+                    // readable with nothing queued means the peer closed, let read() tell it
+                    if (!size_hint) size_hint = 1;
+                } else {
+                    size_hint = 1024; //dummy value
+                }
                 break;
             }
 
@@ -86,10 +121,23 @@ namespace sl {
 
         bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
         {
-            if (actualReady)
-                *actualReady = size;
-            return (_binded_socket->waitforData(timeoutInMs) == RESULT_OK);
+            size_t queued = 0;
+            _u64 deadline = getms() + timeoutInMs;
+            while (true) {
+                if (_binded_socket->waitforData((sl_u32)(deadline > getms() ? deadline - getms() : 0)) != RESULT_OK) break;
+                if (IS_FAIL(_binded_socket->getRxQueueSize(queued))) {
+                    // no queue size on this platform
+                    if (actualReady)
+                        *actualReady = size;
+                    return true;
+                }
+                if (!queued || queued >= size || getms() >= deadline) break;
+                delay(1); // the socket stays readable, poll the queue until enough has arrived
+            }
 
+            if (actualReady)
+                *actualReady = queued;
+            return queued >= size;
         }
 
         int write(const void* data, size_t size)
@@ -104,6 +152,15 @@ namespace sl {
             return (int)lenRec;
         }
 
+        int readTimestamped(void* buffer, size_t size, sl_u64& rxTimestamp_uS)
+        {
+            size_t lenRec = 0;
+            _u64 capturedTs = 0;
+            _binded_socket->recvTimestamped(buffer, size, lenRec, capturedTs);
+            rxTimestamp_uS = capturedTs;
+            return (int)lenRec;
+        }
+
         void clearReadCache() {}
 
         void setStatus(_u32 flag){}
@@ -111,14 +168,27 @@ namespace sl {
         int getChannelType() {
             return CHANNEL_TYPE_TCP;
         }
+
+        int getNativeHandle() {
+            return _binded_socket ? _binded_socket->getNativeHandle() : -1;
+        }
     private:
         rp::net::StreamSocket * _binded_socket;
         rp::net::SocketAddress _socket;
         std::string _ip;
         int _port;
+        TcpChannelOptions _options;
     };
+
     Result<IChannel*> createTcpChannel(const std::string& ip, int port)
     {
-        return new  TcpChannel(ip, port);
+        TcpChannelOptions options;
+        options.rx_buffer_size = 0;
+        return new  TcpChannel(ip, port, options);
+    }
+
+    Result<IChannel*> createTcpChannel(const std::string& ip, int port, const TcpChannelOptions& options)
+    {
+        return new  TcpChannel(ip, port, options);
     }
 }
\ No newline at end of file
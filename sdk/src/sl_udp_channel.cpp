@@ -30,6 +30,7 @@
   *
   */
 
+#include "sdkcommon.h"
 #include "sl_lidar_driver.h"
 #include "hal/abs_rxtx.h"
 #include "hal/socket.h"
@@ -39,9 +40,20 @@ namespace sl {
 	class UdpChannel : public IChannel
 	{
 	public:
-		UdpChannel(const std::string& ip, int port) : _binded_socket(rp::net::DGramSocket::CreateSocket()) {
+        enum {
+            // datagrams fetched by one recvBatch() call, the slot size covers the largest datagram sent by the lidars
+            RX_BATCH_SLOTS = 32,
+            RX_SLOT_SIZE = 2048,
+        };
+
+		UdpChannel(const std::string& ip, int port, const UdpChannelOptions& options) : _binded_socket(rp::net::DGramSocket::CreateSocket())
+            , _options(options)
+            , _rxSlab(RX_BATCH_SLOTS * RX_SLOT_SIZE)
+            , _isBatchSupported(true)
+        {
             _ip = ip;
             _port = port;
+            _resetBatch();
         }
 
 		bool bind(const std::string & ip, sl_s32 port)
@@ -54,14 +66,40 @@ namespace sl {
         {
             if(!bind(_ip, _port))
                 return false;
+            // the socket is disposed by close()
+            if (!_binded_socket) _binded_socket = rp::net::DGramSocket::CreateSocket();
+            if (!_binded_socket) return false;
+            if (_options.rx_buffer_size) {
+                _binded_socket->setRxBufferSize(_options.rx_buffer_size);
+            }
+            _binded_socket->enableRxTimestamp(true);
+            _resetBatch();
+            _isBatchSupported = true;
             return SL_IS_OK(_binded_socket->setPairAddress(&_socket));         
         }
 
         void close()
         {
+            if (!_binded_socket) return;
             _binded_socket->dispose();
             _binded_socket = NULL;
+            _resetBatch();
+        }
+
+        void cancelWaits()
+        {
+            if (_binded_socket) _binded_socket->cancelWaits();
         }
+
+        bool isWaitCancellable()
+        {
+#ifdef _WIN32
+            return false;
+#else
+            return true;
+#endif
+        }
+
         void flush()
         {
             clearReadCache();
@@ -69,14 +107,19 @@ namespace sl {
 
         sl_result waitForDataExt(size_t& size_hint, sl_u32 timeoutInMs)
         {
-            u_result ans;
             size_hint = 0;
-            ans = _binded_socket->waitforData(timeoutInMs);
+            if (_pendingBytes) {
+                size_hint = _pendingBytes;
+                return RESULT_OK;
+            }
 
-            switch (ans) {
-            case RESULT_OK:
-                size_hint = 1024; //dummy value
-                break;
+            u_result ans = _binded_socket->waitforData(timeoutInMs);
+            if (ans == RESULT_OK) {
+                if (_fetchBatch()) {
+                    size_hint = _pendingBytes;
+                } else if (!_isBatchSupported) {
+                    size_hint = 1024; //dummy value
+                }
             }
 
             return ans;
@@ -84,10 +127,26 @@ namespace sl {
 
         bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
         {
-            if (actualReady)
-                *actualReady = size;
-            return (_binded_socket->waitforData(timeoutInMs) == RESULT_OK);
+            if (!_isBatchSupported) {
+                if (actualReady)
+                    *actualReady = size;
+                return (_binded_socket->waitforData(timeoutInMs) == RESULT_OK);
+            }
+
+            // accumulate datagrams until the requested size is queued or the slots are used up
+            _u64 deadline = getms() + timeoutInMs;
+            while (true) {
+                _fetchBatch();
+                if (_pendingBytes >= size || _batchCount == RX_BATCH_SLOTS) break;
+
+                _u64 now = getms();
+                if (now >= deadline) break;
+                if (_binded_socket->waitforData((_u32)(deadline - now)) != RESULT_OK) break;
+            }
 
+            if (actualReady)
+                *actualReady = _pendingBytes;
+            return _pendingBytes && (_pendingBytes >= size || _batchCount == RX_BATCH_SLOTS);
         }
 
         int write(const void* data, size_t size)
@@ -97,15 +156,50 @@ namespace sl {
 
         int read(void* buffer, size_t size)
         {
-            size_t actualGet;
+            sl_u64 rxTimestamp_uS;
+            return readTimestamped(buffer, size, rxTimestamp_uS);
+        }
 
-            u_result ans = _binded_socket->recvFrom(buffer, size, actualGet);
-            if (IS_FAIL(ans)) return 0;
-            return actualGet;
-        
+        int readTimestamped(void* buffer, size_t size, sl_u64& rxTimestamp_uS)
+        {
+            rxTimestamp_uS = 0;
+            if (!_pendingBytes) {
+                _fetchBatch();
+            }
+
+            if (!_pendingBytes) {
+                size_t actualGet;
+
+                u_result ans = _binded_socket->recvFrom(buffer, size, actualGet);
+                if (IS_FAIL(ans)) return 0;
+                return actualGet;
+            }
+
+            // hand over as many queued datagrams as fit, the codec works on the byte stream anyway
+            _u8* dest = reinterpret_cast<_u8*>(buffer);
+            size_t copied = 0;
+            while (copied < size && _batchPos < _batchCount) {
+                size_t remaining = _rxSizes[_batchPos] - _slotOffset;
+                size_t toCopy = std::min(remaining, size - copied);
+                memcpy(dest + copied, &_rxSlab[_batchPos * RX_SLOT_SIZE + _slotOffset], toCopy);
+                // the chunk takes the capture time of its latest datagram
+                rxTimestamp_uS = _rxTimestamps[_batchPos];
+                copied += toCopy;
+                _slotOffset += toCopy;
+                if (_slotOffset == _rxSizes[_batchPos]) {
+                    ++_batchPos;
+                    _slotOffset = 0;
+                }
+            }
+            _pendingBytes -= copied;
+            if (_batchPos == _batchCount) {
+                _resetBatch();
+            }
+            return (int)copied;
         }
 
         void clearReadCache() {
+            _resetBatch();
             _binded_socket->clearRxCache();
         }
 
@@ -115,15 +209,63 @@ namespace sl {
             return CHANNEL_TYPE_UDP;
         }
 
+        int getNativeHandle() {
+            return _binded_socket ? _binded_socket->getNativeHandle() : -1;
+        }
+
 	private:
+        void _resetBatch()
+        {
+            _batchCount = 0;
+            _batchPos = 0;
+            _slotOffset = 0;
+            _pendingBytes = 0;
+        }
+
+        // queues the pending datagrams into the free slots, returns false if nothing is queued
+        bool _fetchBatch()
+        {
+            if (!_isBatchSupported || !_binded_socket) return false;
+            if (_batchCount < RX_BATCH_SLOTS) {
+                size_t received = 0;
+                u_result ans = _binded_socket->recvBatch(&_rxSlab[_batchCount * RX_SLOT_SIZE], RX_SLOT_SIZE, &_rxSizes[_batchCount], &_rxTimestamps[_batchCount], RX_BATCH_SLOTS - _batchCount, received);
+                if (ans == RESULT_OPERATION_NOT_SUPPORT) {
+                    _isBatchSupported = false;
+                    return false;
+                }
+                for (size_t pos = 0; pos < received; ++pos) {
+                    _pendingBytes += _rxSizes[_batchCount + pos];
+                }
+                _batchCount += received;
+            }
+            return _pendingBytes != 0;
+        }
+
 		rp::net::DGramSocket * _binded_socket;
 		rp::net::SocketAddress _socket;
         std::string _ip;
         int _port;
+        UdpChannelOptions _options;
+
+        std::vector<_u8> _rxSlab;
+        size_t _rxSizes[RX_BATCH_SLOTS];
+        _u64 _rxTimestamps[RX_BATCH_SLOTS];
+        size_t _batchCount;
+        size_t _batchPos;
+        size_t _slotOffset;
+        size_t _pendingBytes;
+        bool _isBatchSupported;
 	};
 
     Result<IChannel*> createUdpChannel(const std::string& ip, int port)
     {
-        return new  UdpChannel(ip, port);
+        UdpChannelOptions options;
+        options.rx_buffer_size = 0;
+        return new  UdpChannel(ip, port, options);
+    }
+
+    Result<IChannel*> createUdpChannel(const std::string& ip, int port, const UdpChannelOptions& options)
+    {
+        return new  UdpChannel(ip, port, options);
     }
-}
\ No newline at end of file
+}
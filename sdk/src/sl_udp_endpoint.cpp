@@ -0,0 +1,469 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "sl_lidar_driver.h"
+#include "hal/abs_rxtx.h"
+#include "hal/socket.h"
+#include "hal/thread.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+
+#include <atomic>
+
+
+namespace sl {
+
+    namespace internal {
+
+        enum {
+            // datagrams fetched by one recvBatch() call of the endpoint, the slot size covers the largest datagram sent by the lidars
+            UDP_ENDPOINT_BATCH_SLOTS = 64,
+            UDP_ENDPOINT_SLOT_SIZE = 2048,
+            // datagrams queued per channel until its driver reads them
+            UDP_ENDPOINT_QUEUE_SLOTS = 128,
+            UDP_ENDPOINT_WAIT_MS = 100,
+        };
+
+        // the sender of a datagram in a form compared with memcmp()
+        struct UdpSourceKey
+        {
+            _u8 address[16];
+            _u16 port;
+            _u16 type;
+        };
+
+        static void _makeSourceKey(const rp::net::SocketAddress& address, UdpSourceKey& key)
+        {
+            memset(&key, 0, sizeof(key));
+            address.getRawAddress(key.address, sizeof(key.address));
+            key.port = (_u16)address.getPort();
+            key.type = (_u16)address.getAddressType();
+        }
+
+    }
+
+    using namespace internal;
+
+    class UdpEndpoint;
+
+    class UdpEndpointChannel : public IChannel
+    {
+    public:
+        UdpEndpointChannel(UdpEndpoint* endpoint, const std::string& ip, int port)
+            : _endpoint(endpoint)
+            , _ip(ip)
+            , _port(port)
+            , _queueSlab(UDP_ENDPOINT_QUEUE_SLOTS * UDP_ENDPOINT_SLOT_SIZE)
+            , _head(0)
+            , _tail(0)
+            , _slotOffset(0)
+            , _isOpened(false)
+            , _isCanceled(false)
+        {
+            memset(&_source, 0, sizeof(_source));
+        }
+
+        virtual ~UdpEndpointChannel()
+        {
+            close();
+        }
+
+        const UdpSourceKey& getSource() const
+        {
+            return _source;
+        }
+
+        // called by the rx thread of the endpoint, false if the queue is full
+        bool push(const _u8* data, size_t size, _u64 timestamp_uS)
+        {
+            size_t tail = _tail.load(std::memory_order_relaxed);
+            if (tail - _head.load(std::memory_order_acquire) == UDP_ENDPOINT_QUEUE_SLOTS) return false;
+
+            size_t slot = tail % UDP_ENDPOINT_QUEUE_SLOTS;
+            memcpy(&_queueSlab[slot * UDP_ENDPOINT_SLOT_SIZE], data, size);
+            _sizes[slot] = size;
+            _timestamps[slot] = timestamp_uS;
+            _tail.store(tail + 1, std::memory_order_release);
+            _dataEvt.set();
+            return true;
+        }
+
+        bool open();
+        void close();
+
+        void cancelWaits()
+        {
+            _isCanceled = true;
+            _dataEvt.set();
+        }
+
+        bool isWaitCancellable()
+        {
+            return true;
+        }
+
+        void flush()
+        {
+            clearReadCache();
+        }
+
+        sl_result waitForDataExt(size_t& size_hint, sl_u32 timeoutInMs)
+        {
+            size_hint = 0;
+            _u64 deadline = getms() + timeoutInMs;
+            while (true) {
+                if (!_isOpened) return SL_RESULT_OPERATION_FAIL;
+                if (_isCanceled) return SL_RESULT_OPERATION_TIMEOUT;
+                size_hint = _queuedSize();
+                if (size_hint) return SL_RESULT_OK;
+
+                _u64 now = getms();
+                if (now >= deadline) return SL_RESULT_OPERATION_TIMEOUT;
+                _dataEvt.wait((unsigned long)(deadline - now));
+            }
+        }
+
+        bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
+        {
+            // accumulate datagrams until the requested size is queued or the queue is full
+            _u64 deadline = getms() + timeoutInMs;
+            size_t queued = 0;
+            while (_isOpened && !_isCanceled) {
+                queued = _queuedSize();
+                if (queued >= size || _isQueueFull()) break;
+
+                _u64 now = getms();
+                if (now >= deadline) break;
+                _dataEvt.wait((unsigned long)(deadline - now));
+            }
+
+            if (actualReady)
+                *actualReady = queued;
+            return queued && (queued >= size || _isQueueFull());
+        }
+
+        int write(const void* data, size_t size);
+
+        int read(void* buffer, size_t size)
+        {
+            sl_u64 rxTimestamp_uS;
+            return readTimestamped(buffer, size, rxTimestamp_uS);
+        }
+
+        int readTimestamped(void* buffer, size_t size, sl_u64& rxTimestamp_uS)
+        {
+            rxTimestamp_uS = 0;
+
+            // hand over as many queued datagrams as fit, the codec works on the byte stream anyway
+            _u8* dest = reinterpret_cast<_u8*>(buffer);
+            size_t copied = 0;
+            size_t head = _head.load(std::memory_order_relaxed);
+            size_t tail = _tail.load(std::memory_order_acquire);
+            while (copied < size && head != tail) {
+                size_t slot = head % UDP_ENDPOINT_QUEUE_SLOTS;
+                size_t toCopy = std::min(_sizes[slot] - _slotOffset, size - copied);
+                memcpy(dest + copied, &_queueSlab[slot * UDP_ENDPOINT_SLOT_SIZE + _slotOffset], toCopy);
+                // the chunk takes the capture time of its latest datagram
+                rxTimestamp_uS = _timestamps[slot];
+                copied += toCopy;
+                _slotOffset += toCopy;
+                if (_slotOffset == _sizes[slot]) {
+                    ++head;
+                    _slotOffset = 0;
+                }
+            }
+            _head.store(head, std::memory_order_release);
+            return (int)copied;
+        }
+
+        void clearReadCache()
+        {
+            size_t tail = _tail.load(std::memory_order_acquire);
+            _slotOffset = 0;
+            _head.store(tail, std::memory_order_release);
+        }
+
+        void setStatus(_u32 flag) {}
+
+        int getChannelType()
+        {
+            return CHANNEL_TYPE_UDP;
+        }
+
+        int getNativeHandle()
+        {
+            // the socket is shared with the other channels of the endpoint, nothing for an io reactor to poll
+            return -1;
+        }
+
+    private:
+        // consumer side: the bytes of the datagrams published by the producer and not read yet
+        size_t _queuedSize() const
+        {
+            size_t head = _head.load(std::memory_order_relaxed);
+            size_t tail = _tail.load(std::memory_order_acquire);
+            size_t queued = 0;
+            for (; head != tail; ++head) {
+                queued += _sizes[head % UDP_ENDPOINT_QUEUE_SLOTS];
+            }
+            return queued ? queued - _slotOffset : 0;
+        }
+
+        bool _isQueueFull() const
+        {
+            return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_relaxed) == UDP_ENDPOINT_QUEUE_SLOTS;
+        }
+
+        UdpEndpoint* _endpoint;
+        std::string _ip;
+        int _port;
+        rp::net::SocketAddress _target;
+        UdpSourceKey _source;
+
+        // single producer (the rx thread of the endpoint), single consumer (the driver)
+        std::vector<_u8> _queueSlab;
+        size_t _sizes[UDP_ENDPOINT_QUEUE_SLOTS];
+        _u64 _timestamps[UDP_ENDPOINT_QUEUE_SLOTS];
+        std::atomic<size_t> _head;
+        std::atomic<size_t> _tail;
+        size_t _slotOffset;
+        rp::hal::Event _dataEvt;
+
+        volatile bool _isOpened;
+        volatile bool _isCanceled;
+    };
+
+    class UdpEndpoint : public IUdpEndpoint
+    {
+    public:
+        UdpEndpoint()
+            : _socket(NULL)
+            , _isWorking(false)
+            , _rxSlab(UDP_ENDPOINT_BATCH_SLOTS * UDP_ENDPOINT_SLOT_SIZE)
+            , _isBatchSupported(true)
+        {
+            memset(&_stats, 0, sizeof(_stats));
+        }
+
+        virtual ~UdpEndpoint()
+        {
+            if (_isWorking) {
+                _isWorking = false;
+                _socket->cancelWaits();
+                _rxThread.join();
+            }
+            if (_socket) _socket->dispose();
+        }
+
+        sl_result init(const std::string& ip, int port, const UdpChannelOptions& options)
+        {
+            if (port < 0 || port > 0xFFFF) return SL_RESULT_INVALID_DATA;
+
+            bool isIPv6 = ip.find(':') != std::string::npos;
+            rp::net::SocketAddress address;
+            if (IS_FAIL(address.setAddressFromString(ip.c_str(), isIPv6 ? rp::net::SocketAddress::ADDRESS_TYPE_INET6 : rp::net::SocketAddress::ADDRESS_TYPE_INET))) {
+                return SL_RESULT_INVALID_DATA;
+            }
+            address.setPort(port);
+
+            _socket = rp::net::DGramSocket::CreateSocket(isIPv6 ? rp::net::SocketBase::SOCKET_FAMILY_INET6 : rp::net::SocketBase::SOCKET_FAMILY_INET);
+            if (!_socket) return SL_RESULT_OPERATION_FAIL;
+            if (options.rx_buffer_size) {
+                _socket->setRxBufferSize(options.rx_buffer_size);
+            }
+            _socket->enableRxTimestamp(true);
+            if (IS_FAIL(_socket->bind(address))) return SL_RESULT_OPERATION_FAIL;
+
+            _isWorking = true;
+            _rxThread = CLASS_THREAD(UdpEndpoint, _proc_rxThread);
+            return SL_RESULT_OK;
+        }
+
+        Result<IChannel*> createChannel(const std::string& ip, int port)
+        {
+            return new UdpEndpointChannel(this, ip, port);
+        }
+
+        void getStats(UdpEndpointStats& stats)
+        {
+            rp::hal::AutoLocker l(_locker);
+            stats = _stats;
+        }
+
+        bool attach(UdpEndpointChannel* channel)
+        {
+            rp::hal::AutoLocker l(_locker);
+            // a sender is routed to a single channel
+            for (size_t pos = 0; pos < _channels.size(); ++pos) {
+                if (!memcmp(&_channels[pos]->getSource(), &channel->getSource(), sizeof(UdpSourceKey))) return false;
+            }
+            _channels.push_back(channel);
+            return true;
+        }
+
+        void detach(UdpEndpointChannel* channel)
+        {
+            rp::hal::AutoLocker l(_locker);
+            for (size_t pos = 0; pos < _channels.size(); ++pos) {
+                if (_channels[pos] == channel) {
+                    _channels.erase(_channels.begin() + pos);
+                    break;
+                }
+            }
+        }
+
+        int sendTo(const rp::net::SocketAddress& target, const void* data, size_t size)
+        {
+            rp::hal::AutoLocker l(_txLocker);
+            return IS_OK(_socket->sendTo(&target, data, size)) ? (int)size : -1;
+        }
+
+    private:
+        u_result _proc_rxThread()
+        {
+            rp::hal::Thread::config_t config;
+            memset(&config, 0, sizeof(config));
+            rp::hal::Thread::SetSelfConfig(config, "sl_udp_endpoint", rp::hal::Thread::PRIORITY_NORMAL);
+
+            while (_isWorking) {
+                if (_socket->waitforData(UDP_ENDPOINT_WAIT_MS) != RESULT_OK) continue;
+
+                size_t received = 0;
+                if (_isBatchSupported) {
+                    u_result ans = _socket->recvBatch(&_rxSlab[0], UDP_ENDPOINT_SLOT_SIZE, _rxSizes, _rxTimestamps, UDP_ENDPOINT_BATCH_SLOTS, received, _rxSources);
+                    if (ans == RESULT_OPERATION_NOT_SUPPORT) _isBatchSupported = false;
+                }
+                if (!_isBatchSupported) {
+                    // one datagram per wakeup then, without a capture time
+                    if (IS_OK(_socket->recvFrom(&_rxSlab[0], UDP_ENDPOINT_SLOT_SIZE, _rxSizes[0], &_rxSources[0]))) {
+                        _rxTimestamps[0] = 0;
+                        received = 1;
+                    }
+                }
+                if (received) _dispatch(received);
+            }
+            return RESULT_OK;
+        }
+
+        void _dispatch(size_t received)
+        {
+            rp::hal::AutoLocker l(_locker);
+            ++_stats.batches;
+            UdpEndpointChannel* lastChannel = NULL;
+            UdpSourceKey key;
+            for (size_t pos = 0; pos < received; ++pos) {
+                ++_stats.datagrams;
+                _stats.bytes += _rxSizes[pos];
+
+                _makeSourceKey(_rxSources[pos], key);
+                // the datagrams of a batch mostly come in runs from the same sender
+                UdpEndpointChannel* channel = NULL;
+                if (lastChannel && !memcmp(&lastChannel->getSource(), &key, sizeof(key))) {
+                    channel = lastChannel;
+                } else {
+                    for (size_t index = 0; index < _channels.size(); ++index) {
+                        if (!memcmp(&_channels[index]->getSource(), &key, sizeof(key))) {
+                            channel = _channels[index];
+                            break;
+                        }
+                    }
+                }
+
+                if (!channel) {
+                    ++_stats.unknown_source_datagrams;
+                    continue;
+                }
+                lastChannel = channel;
+                if (!channel->push(&_rxSlab[pos * UDP_ENDPOINT_SLOT_SIZE], _rxSizes[pos], _rxTimestamps[pos])) {
+                    ++_stats.dropped_datagrams;
+                }
+            }
+        }
+
+        rp::net::DGramSocket* _socket;
+        volatile bool _isWorking;
+        rp::hal::Thread _rxThread;
+        rp::hal::Locker _locker;
+        rp::hal::Locker _txLocker;
+        std::vector<UdpEndpointChannel*> _channels;
+        UdpEndpointStats _stats;
+
+        std::vector<_u8> _rxSlab;
+        size_t _rxSizes[UDP_ENDPOINT_BATCH_SLOTS];
+        _u64 _rxTimestamps[UDP_ENDPOINT_BATCH_SLOTS];
+        rp::net::SocketAddress _rxSources[UDP_ENDPOINT_BATCH_SLOTS];
+        bool _isBatchSupported;
+    };
+
+    bool UdpEndpointChannel::open()
+    {
+        if (_isOpened) return true;
+        if (IS_FAIL(_target.setAddressFromString(_ip.c_str(), _ip.find(':') != std::string::npos ? rp::net::SocketAddress::ADDRESS_TYPE_INET6 : rp::net::SocketAddress::ADDRESS_TYPE_INET))) {
+            return false;
+        }
+        _target.setPort(_port);
+        _makeSourceKey(_target, _source);
+
+        clearReadCache();
+        _isCanceled = false;
+        if (!_endpoint->attach(this)) return false;
+        _isOpened = true;
+        return true;
+    }
+
+    void UdpEndpointChannel::close()
+    {
+        if (!_isOpened) return;
+        _endpoint->detach(this);
+        _isOpened = false;
+        clearReadCache();
+        _dataEvt.set();
+    }
+
+    int UdpEndpointChannel::write(const void* data, size_t size)
+    {
+        if (!_isOpened) return -1;
+        return _endpoint->sendTo(_target, data, size);
+    }
+
+    Result<IUdpEndpoint*> createUdpEndpoint(const std::string& ip, int port, const UdpChannelOptions& options)
+    {
+        UdpEndpoint* endpoint = new UdpEndpoint();
+        sl_result ans = endpoint->init(ip, port, options);
+        if (IS_FAIL(ans)) {
+            delete endpoint;
+            return ans;
+        }
+        return (IUdpEndpoint*)endpoint;
+    }
+}
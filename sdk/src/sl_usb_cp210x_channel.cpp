@@ -0,0 +1,495 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "sl_lidar_driver.h"
+#include "hal/thread.h"
+#include "hal/event.h"
+
+#include <atomic>
+
+#if defined(SL_LIDAR_WITH_LIBUSB)
+#include <libusb.h>
+#endif
+
+
+namespace sl {
+
+#if defined(SL_LIDAR_WITH_LIBUSB)
+
+    namespace internal {
+
+        enum {
+            CP210X_VID = 0x10C4,
+            CP210X_PID = 0xEA60,
+
+            CP210X_INTERFACE = 0,
+            CP210X_EP_BULK_IN = 0x81,
+            CP210X_EP_BULK_OUT = 0x01,
+
+            // the vendor requests of AN571, sent to the interface
+            CP210X_REQTYPE_HOST_TO_INTERFACE = 0x41,
+            CP210X_IFC_ENABLE = 0x00,
+            CP210X_SET_LINE_CTL = 0x03,
+            CP210X_SET_MHS = 0x07,
+            CP210X_PURGE = 0x12,
+            CP210X_SET_BAUDRATE = 0x1E,
+
+            CP210X_UART_ENABLE = 0x0001,
+            CP210X_LINE_CTL_8N1 = 0x0800,
+            CP210X_MHS_DTR = 0x0001,
+            CP210X_MHS_DTR_MASK = 0x0100,
+            CP210X_PURGE_ALL = 0x000F,
+
+            CP210X_CONTROL_TIMEOUT_MS = 500,
+            CP210X_WRITE_TIMEOUT_MS = 1000,
+            // how long the event thread blocks in libusb, it is woken up at once on close
+            CP210X_EVENT_WAIT_MS = 100,
+
+            CP210X_DEFAULT_TRANSFER_SIZE = 256,
+            CP210X_DEFAULT_TRANSFER_COUNT = 8,
+            CP210X_PACKET_SIZE = 64,
+            // completed transfers queued until the driver reads them
+            CP210X_QUEUE_SLOTS = 256,
+        };
+
+    }
+
+    using namespace internal;
+
+    class Cp210xUsbChannel : public ISerialPortChannel
+    {
+    public:
+        Cp210xUsbChannel(const std::string& device, int baudrate, const UsbChannelOptions& options)
+            : _device(device)
+            , _baudrate(baudrate)
+            , _context(NULL)
+            , _handle(NULL)
+            , _head(0)
+            , _tail(0)
+            , _slotOffset(0)
+            , _pendingTransfers(0)
+            , _isOpened(false)
+            , _isCanceled(false)
+            , _isWorking(false)
+            , _isDeviceLost(false)
+        {
+            _transferSize = options.transfer_size ? options.transfer_size : CP210X_DEFAULT_TRANSFER_SIZE;
+            // a transfer that is not a multiple of the packet size would overflow on a full packet
+            _transferSize = (_transferSize + CP210X_PACKET_SIZE - 1) / CP210X_PACKET_SIZE * CP210X_PACKET_SIZE;
+            _transferCount = options.transfer_count ? options.transfer_count : CP210X_DEFAULT_TRANSFER_COUNT;
+        }
+
+        virtual ~Cp210xUsbChannel()
+        {
+            close();
+        }
+
+        bool open()
+        {
+            close();
+            _isCanceled = false;
+            _isDeviceLost = false;
+            _head = 0;
+            _tail = 0;
+            _slotOffset = 0;
+
+            if (libusb_init(&_context) != LIBUSB_SUCCESS) {
+                _context = NULL;
+                return false;
+            }
+            if (!_openDevice() || !_setupUart() || !_startTransfers()) {
+                _release();
+                return false;
+            }
+            _isOpened = true;
+            return true;
+        }
+
+        void close()
+        {
+            cancelWaits();
+            _isOpened = false;
+            _release();
+        }
+
+        void cancelWaits()
+        {
+            _isCanceled = true;
+            _dataEvt.set();
+        }
+
+        bool isWaitCancellable()
+        {
+            return true;
+        }
+
+        void flush()
+        {
+            // the writes are synchronous, the data has been handed to the bridge once write() returns
+        }
+
+        sl_result waitForDataExt(size_t& size_hint, sl_u32 timeoutInMs)
+        {
+            size_hint = 0;
+            _u64 deadline = getms() + timeoutInMs;
+            while (true) {
+                if (!_isOpened || _isDeviceLost) return SL_RESULT_OPERATION_FAIL;
+                if (_isCanceled) return SL_RESULT_OPERATION_TIMEOUT;
+                size_hint = _queuedSize();
+                if (size_hint) return SL_RESULT_OK;
+
+                _u64 now = getms();
+                if (now >= deadline) return SL_RESULT_OPERATION_TIMEOUT;
+                _dataEvt.wait((unsigned long)(deadline - now));
+            }
+        }
+
+        bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
+        {
+            _u64 deadline = getms() + timeoutInMs;
+            size_t queued = 0;
+            while (_isOpened && !_isDeviceLost && !_isCanceled) {
+                queued = _queuedSize();
+                if (queued >= size || _isQueueFull()) break;
+
+                _u64 now = getms();
+                if (now >= deadline) break;
+                _dataEvt.wait((unsigned long)(deadline - now));
+            }
+
+            if (actualReady)
+                *actualReady = queued;
+            return queued && (queued >= size || _isQueueFull());
+        }
+
+        int write(const void* data, size_t size)
+        {
+            if (!_isOpened || _isDeviceLost) return -1;
+
+            int transferred = 0;
+            int ans = libusb_bulk_transfer(_handle, CP210X_EP_BULK_OUT, (unsigned char*)const_cast<void*>(data), (int)size, &transferred, CP210X_WRITE_TIMEOUT_MS);
+            if (ans != LIBUSB_SUCCESS && !transferred) return -1;
+            return transferred;
+        }
+
+        int read(void* buffer, size_t size)
+        {
+            sl_u64 rxTimestamp_uS;
+            return readTimestamped(buffer, size, rxTimestamp_uS);
+        }
+
+        int readTimestamped(void* buffer, size_t size, sl_u64& rxTimestamp_uS)
+        {
+            rxTimestamp_uS = 0;
+
+            _u8* dest = reinterpret_cast<_u8*>(buffer);
+            size_t copied = 0;
+            size_t head = _head.load(std::memory_order_relaxed);
+            size_t tail = _tail.load(std::memory_order_acquire);
+            while (copied < size && head != tail) {
+                size_t slot = head % CP210X_QUEUE_SLOTS;
+                size_t toCopy = std::min(_sizes[slot] - _slotOffset, size - copied);
+                memcpy(dest + copied, &_queueSlab[slot * _transferSize + _slotOffset], toCopy);
+                // the chunk takes the completion time of its latest transfer
+                rxTimestamp_uS = _timestamps[slot];
+                copied += toCopy;
+                _slotOffset += toCopy;
+                if (_slotOffset == _sizes[slot]) {
+                    ++head;
+                    _slotOffset = 0;
+                }
+            }
+            _head.store(head, std::memory_order_release);
+            return (int)copied;
+        }
+
+        void clearReadCache()
+        {
+            size_t tail = _tail.load(std::memory_order_acquire);
+            _slotOffset = 0;
+            _head.store(tail, std::memory_order_release);
+        }
+
+        void setDTR(bool dtr)
+        {
+            if (!_handle) return;
+            _control(CP210X_SET_MHS, CP210X_MHS_DTR_MASK | (dtr ? CP210X_MHS_DTR : 0));
+        }
+
+        sl_result getSerialPortSettings(SerialPortSettings& settings)
+        {
+            settings.baudrate = _baudrate;
+            // each bulk-IN transfer is completed by the first short packet, there is no latency timer to wait for
+            settings.low_latency = true;
+            settings.latency_timer_ms = -1;
+            return SL_RESULT_OK;
+        }
+
+        int getChannelType()
+        {
+            // the driver drives the motor through DTR as on any serial port
+            return CHANNEL_TYPE_SERIALPORT;
+        }
+
+    private:
+        // consumer side: the bytes of the transfers published by the event thread and not read yet
+        size_t _queuedSize() const
+        {
+            size_t head = _head.load(std::memory_order_relaxed);
+            size_t tail = _tail.load(std::memory_order_acquire);
+            size_t queued = 0;
+            for (; head != tail; ++head) {
+                queued += _sizes[head % CP210X_QUEUE_SLOTS];
+            }
+            return queued ? queued - _slotOffset : 0;
+        }
+
+        bool _isQueueFull() const
+        {
+            return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_relaxed) == CP210X_QUEUE_SLOTS;
+        }
+
+        bool _control(_u8 request, _u16 value, unsigned char* data = NULL, _u16 size = 0)
+        {
+            return libusb_control_transfer(_handle, CP210X_REQTYPE_HOST_TO_INTERFACE, request, value, CP210X_INTERFACE, data, size, CP210X_CONTROL_TIMEOUT_MS) >= 0;
+        }
+
+        bool _matchDevice(libusb_device* device, const libusb_device_descriptor& desc)
+        {
+            if (desc.idVendor != CP210X_VID || desc.idProduct != CP210X_PID) return false;
+            if (_device.empty()) return true;
+
+            int bus, address;
+            if (_device.find(':') != std::string::npos && sscanf(_device.c_str(), "%d:%d", &bus, &address) == 2) {
+                return libusb_get_bus_number(device) == bus && libusb_get_device_address(device) == address;
+            }
+
+            // by the serial number, which takes opening the device
+            if (!desc.iSerialNumber) return false;
+            libusb_device_handle* handle = NULL;
+            if (libusb_open(device, &handle) != LIBUSB_SUCCESS) return false;
+            unsigned char serial[256];
+            int len = libusb_get_string_descriptor_ascii(handle, desc.iSerialNumber, serial, sizeof(serial));
+            libusb_close(handle);
+            return len > 0 && _device == std::string((const char*)serial, len);
+        }
+
+        bool _openDevice()
+        {
+            libusb_device** devices = NULL;
+            ssize_t count = libusb_get_device_list(_context, &devices);
+            if (count < 0) return false;
+
+            for (ssize_t pos = 0; pos < count && !_handle; ++pos) {
+                libusb_device_descriptor desc;
+                if (libusb_get_device_descriptor(devices[pos], &desc) != LIBUSB_SUCCESS) continue;
+                if (!_matchDevice(devices[pos], desc)) continue;
+                if (libusb_open(devices[pos], &_handle) != LIBUSB_SUCCESS) _handle = NULL;
+            }
+            libusb_free_device_list(devices, 1);
+            if (!_handle) return false;
+
+            // the cp210x kernel driver gets the bridge back on release, not supported off Linux where it is not needed
+            libusb_set_auto_detach_kernel_driver(_handle, 1);
+            if (libusb_claim_interface(_handle, CP210X_INTERFACE) != LIBUSB_SUCCESS) {
+                libusb_close(_handle);
+                _handle = NULL;
+                return false;
+            }
+            return true;
+        }
+
+        bool _setupUart()
+        {
+            unsigned char baudrate[4];
+            baudrate[0] = (unsigned char)(_baudrate);
+            baudrate[1] = (unsigned char)(_baudrate >> 8);
+            baudrate[2] = (unsigned char)(_baudrate >> 16);
+            baudrate[3] = (unsigned char)(_baudrate >> 24);
+
+            if (!_control(CP210X_IFC_ENABLE, CP210X_UART_ENABLE)) return false;
+            if (!_control(CP210X_SET_LINE_CTL, CP210X_LINE_CTL_8N1)) return false;
+            if (!_control(CP210X_SET_BAUDRATE, 0, baudrate, sizeof(baudrate))) return false;
+            // drop what the bridge buffered before the channel was opened
+            _control(CP210X_PURGE, CP210X_PURGE_ALL);
+            // DTR cleared lets the motor spin, as the serial channel does on open
+            return _control(CP210X_SET_MHS, CP210X_MHS_DTR_MASK);
+        }
+
+        bool _startTransfers()
+        {
+            _queueSlab.resize(CP210X_QUEUE_SLOTS * _transferSize);
+            _transferSlab.resize(_transferCount * _transferSize);
+            _transfers.resize(_transferCount, NULL);
+
+            _isWorking = true;
+            for (size_t pos = 0; pos < _transfers.size(); ++pos) {
+                _transfers[pos] = libusb_alloc_transfer(0);
+                if (!_transfers[pos]) return false;
+                libusb_fill_bulk_transfer(_transfers[pos], _handle, CP210X_EP_BULK_IN, &_transferSlab[pos * _transferSize],
+                    (int)_transferSize, &Cp210xUsbChannel::_onTransferDone, this, 0);
+                if (libusb_submit_transfer(_transfers[pos]) != LIBUSB_SUCCESS) return false;
+                ++_pendingTransfers;
+            }
+            _eventThread = CLASS_THREAD(Cp210xUsbChannel, _proc_eventThread);
+            return true;
+        }
+
+        void _release()
+        {
+            if (_isWorking) {
+                _isWorking = false;
+                for (size_t pos = 0; pos < _transfers.size(); ++pos) {
+                    if (_transfers[pos]) libusb_cancel_transfer(_transfers[pos]);
+                }
+                if (_eventThread.getHandle()) {
+                    libusb_interrupt_event_handler(_context);
+                    _eventThread.join();
+                }
+            }
+            // the event thread is gone or never started: reap what is left before freeing the transfers
+            while (_pendingTransfers) {
+                struct timeval tv = { 0, CP210X_EVENT_WAIT_MS * 1000 };
+                if (libusb_handle_events_timeout_completed(_context, &tv, NULL) != LIBUSB_SUCCESS) break;
+            }
+            for (size_t pos = 0; pos < _transfers.size(); ++pos) {
+                if (_transfers[pos]) libusb_free_transfer(_transfers[pos]);
+            }
+            _transfers.clear();
+            _pendingTransfers = 0;
+
+            if (_handle) {
+                libusb_release_interface(_handle, CP210X_INTERFACE);
+                libusb_close(_handle);
+                _handle = NULL;
+            }
+            if (_context) {
+                libusb_exit(_context);
+                _context = NULL;
+            }
+        }
+
+        u_result _proc_eventThread()
+        {
+            rp::hal::Thread::config_t config;
+            memset(&config, 0, sizeof(config));
+            rp::hal::Thread::SetSelfConfig(config, "sl_usb_events", rp::hal::Thread::PRIORITY_HIGH);
+
+            // the canceled transfers complete through here as well
+            while (_isWorking || _pendingTransfers) {
+                struct timeval tv = { 0, CP210X_EVENT_WAIT_MS * 1000 };
+                if (libusb_handle_events_timeout_completed(_context, &tv, NULL) == LIBUSB_ERROR_NO_DEVICE) break;
+            }
+            return RESULT_OK;
+        }
+
+        static void LIBUSB_CALL _onTransferDone(libusb_transfer* transfer)
+        {
+            reinterpret_cast<Cp210xUsbChannel*>(transfer->user_data)->_onTransfer(transfer);
+        }
+
+        // called by the event thread
+        void _onTransfer(libusb_transfer* transfer)
+        {
+            if (transfer->status == LIBUSB_TRANSFER_COMPLETED && transfer->actual_length > 0) {
+                _push(transfer->buffer, (size_t)transfer->actual_length, getus());
+            }
+
+            bool resubmit = _isWorking && (transfer->status == LIBUSB_TRANSFER_COMPLETED || transfer->status == LIBUSB_TRANSFER_TIMED_OUT);
+            if (resubmit && libusb_submit_transfer(transfer) == LIBUSB_SUCCESS) return;
+
+            --_pendingTransfers;
+            if (_isWorking && transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+                // unplugged or failing: the waits of the driver report the channel broken
+                _isDeviceLost = true;
+                _dataEvt.set();
+            }
+        }
+
+        void _push(const _u8* data, size_t size, _u64 timestamp_uS)
+        {
+            size_t tail = _tail.load(std::memory_order_relaxed);
+            // the driver is not keeping up: the transfer is dropped and the decoder resyncs on the next answer header
+            if (tail - _head.load(std::memory_order_acquire) == CP210X_QUEUE_SLOTS) return;
+
+            size_t slot = tail % CP210X_QUEUE_SLOTS;
+            memcpy(&_queueSlab[slot * _transferSize], data, size);
+            _sizes[slot] = size;
+            _timestamps[slot] = timestamp_uS;
+            _tail.store(tail + 1, std::memory_order_release);
+            _dataEvt.set();
+        }
+
+        std::string _device;
+        int _baudrate;
+        size_t _transferSize;
+        size_t _transferCount;
+
+        libusb_context* _context;
+        libusb_device_handle* _handle;
+        std::vector<libusb_transfer*> _transfers;
+        std::vector<_u8> _transferSlab;
+        rp::hal::Thread _eventThread;
+
+        // single producer (the event thread), single consumer (the driver)
+        std::vector<_u8> _queueSlab;
+        size_t _sizes[CP210X_QUEUE_SLOTS];
+        _u64 _timestamps[CP210X_QUEUE_SLOTS];
+        std::atomic<size_t> _head;
+        std::atomic<size_t> _tail;
+        size_t _slotOffset;
+        rp::hal::Event _dataEvt;
+
+        std::atomic<size_t> _pendingTransfers;
+
+        volatile bool _isOpened;
+        volatile bool _isCanceled;
+        volatile bool _isWorking;
+        volatile bool _isDeviceLost;
+    };
+
+    Result<IChannel*> createCp210xUsbChannel(const std::string& device, int baudrate, const UsbChannelOptions& options)
+    {
+        if (baudrate <= 0) return SL_RESULT_INVALID_DATA;
+        return new Cp210xUsbChannel(device, baudrate, options);
+    }
+
+#else
+
+    Result<IChannel*> createCp210xUsbChannel(const std::string& device, int baudrate, const UsbChannelOptions& options)
+    {
+        return SL_RESULT_OPERATION_NOT_SUPPORT;
+    }
+
+#endif
+}